@@ -21,7 +21,7 @@
 int
 main(int argc, char * argv[])
 {
-    if (argc != 2)
+    if (argc != 2 && argc != 3)
     {
         printf("you should not test functionalities directly, instead use 'test all' "
                "command from HyperDbg...\n");
@@ -72,6 +72,34 @@ main(int argc, char * argv[])
             printf("\n[x] The hwdbg test cases failed\n");
         }
     }
+    else if (!strcmp(argv[1], TEST_CASE_PARAMETER_FOR_UNIT_TESTS))
+    {
+        //
+        // # Test the components (unit tests)
+        //
+        if (UnitTestRun(argc == 3 ? argv[2] : NULL))
+        {
+            printf("\n[*] The unit tests passed successfully\n");
+        }
+        else
+        {
+            printf("\n[x] The unit tests failed\n");
+        }
+    }
+    else if (!strcmp(argv[1], TEST_CASE_PARAMETER_FOR_BENCHMARKS))
+    {
+        //
+        // # Benchmark the components
+        //
+        UnitTestRunBenchmark(argc == 3 ? argv[2] : NULL);
+    }
+    else if (!strcmp(argv[1], TEST_CASE_PARAMETER_FOR_UNIT_TESTS_LIST))
+    {
+        //
+        // # Show the list of the unit tests
+        //
+        UnitTestShowList();
+    }
     else
     {
         printf("unknown test case\n");
@@ -0,0 +1,299 @@
+/**
+ * @file test-assembler.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Tests and benchmark of the cached assembler and the batch assembly
+ * @details the bytes of the batch assembly (statement by statement) are
+ * compared with the bytes of assembling the whole code at once
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Start address of the assembled codes
+ *
+ */
+#define TEST_ASSEMBLER_START_ADDRESS 0xfffff80000200000
+
+/**
+ * @brief Maximum size of the assembled codes
+ *
+ */
+#define TEST_ASSEMBLER_BUFFER_SIZE 0x1000
+
+/**
+ * @brief Maximum number of the statements of the assembled codes
+ *
+ */
+#define TEST_ASSEMBLER_MAXIMUM_STATEMENTS 0x200
+
+/**
+ * @brief Number of times that each code is assembled in the benchmark
+ *
+ */
+#define TEST_ASSEMBLER_BENCHMARK_ITERATIONS 500
+
+/**
+ * @brief The (ignored) messages of the assembler
+ *
+ * @param Text
+ *
+ * @return int
+ */
+static int
+TestAssemblerMessageHandler(const char * Text)
+{
+    UNREFERENCED_PARAMETER(Text);
+
+    return 0;
+}
+
+/**
+ * @brief Get a code with a jump over a number of nops
+ *
+ * @param NumberOfNops
+ *
+ * @return std::string
+ */
+static std::string
+TestAssemblerGetJumpOverNops(UINT32 NumberOfNops)
+{
+    std::string Code = "test rax, rax; jz skipped";
+
+    for (UINT32 i = 0; i < NumberOfNops; i++)
+    {
+        Code += "; nop";
+    }
+
+    return Code + "; skipped: ret";
+}
+
+/**
+ * @brief Assemble a code both as a batch and at once, and compare them
+ *
+ * @param Code statements separated by ';'
+ * @param ExpectedStatements
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestAssemblerCompareBatch(const std::string & Code, UINT32 ExpectedStatements)
+{
+    BOOLEAN             Result = TRUE;
+    std::vector<BYTE>   BatchBytes(TEST_ASSEMBLER_BUFFER_SIZE, 0);
+    std::vector<BYTE>   Bytes(TEST_ASSEMBLER_BUFFER_SIZE, 0);
+    std::vector<UINT32> Offsets(TEST_ASSEMBLER_MAXIMUM_STATEMENTS, 0);
+    std::vector<UINT32> Lengths(TEST_ASSEMBLER_MAXIMUM_STATEMENTS, 0);
+    UINT32              NumberOfStatements = 0;
+    UINT32              BatchLength        = 0;
+    UINT32              Length             = 0;
+
+    UnitTestExpect(Result, hyperdbg_u_assemble_batch(Code.c_str(),
+                                                     TEST_ASSEMBLER_START_ADDRESS,
+                                                     BatchBytes.data(),
+                                                     (UINT32)BatchBytes.size(),
+                                                     Offsets.data(),
+                                                     Lengths.data(),
+                                                     (UINT32)Offsets.size(),
+                                                     &NumberOfStatements,
+                                                     &BatchLength));
+
+    UnitTestExpect(Result, hyperdbg_u_assemble_get_length(Code.c_str(), TEST_ASSEMBLER_START_ADDRESS, &Length));
+    UnitTestExpect(Result, hyperdbg_u_assemble(Code.c_str(), TEST_ASSEMBLER_START_ADDRESS, Bytes.data(), (UINT32)Bytes.size()));
+
+    if (!Result)
+    {
+        ShowMessages("\t[x] unable to assemble '%.64s'\n", Code.c_str());
+        return FALSE;
+    }
+
+    UnitTestExpect(Result, NumberOfStatements == ExpectedStatements);
+    UnitTestExpect(Result, BatchLength == Length);
+    UnitTestExpect(Result, memcmp(BatchBytes.data(), Bytes.data(), Length) == 0);
+
+    //
+    // The statements are consecutive
+    //
+    for (UINT32 i = 0; Result && i < NumberOfStatements; i++)
+    {
+        UnitTestExpect(Result, Offsets[i] + Lengths[i] == (i + 1 < NumberOfStatements ? Offsets[i + 1] : BatchLength));
+    }
+
+    if (!Result)
+    {
+        ShowMessages("\t[x] the batch assembly of '%.64s' differs\n", Code.c_str());
+    }
+
+    return Result;
+}
+
+/**
+ * @brief Test the labels of the batch assembly
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestAssemblerLabels()
+{
+    BOOLEAN Result     = TRUE;
+    BYTE    Bytes[16]  = {0};
+    UINT32  Offsets[8] = {0};
+    UINT32  Lengths[8] = {0};
+    UINT32  NumberOfStatements;
+    UINT32  Length;
+
+    //
+    // Backward and forward references to the labels of other statements
+    //
+    UnitTestExpect(Result, TestAssemblerCompareBatch("mov rcx, 5; again: dec rcx; jnz again; ret", 4));
+    UnitTestExpect(Result, TestAssemblerCompareBatch("test rax, rax; jz done; nop; nop; done: ret", 5));
+    UnitTestExpect(Result, TestAssemblerCompareBatch("cmp rax, 1; je first; cmp rax, 2; je second; xor eax, eax; ret; first: mov eax, 1; ret; second: mov eax, 2; ret", 10));
+
+    //
+    // A label without an instruction has no bytes
+    //
+    UnitTestExpect(Result, hyperdbg_u_assemble_batch("jmp finish; int3; finish:; ret",
+                                                     TEST_ASSEMBLER_START_ADDRESS,
+                                                     Bytes,
+                                                     sizeof(Bytes),
+                                                     Offsets,
+                                                     Lengths,
+                                                     8,
+                                                     &NumberOfStatements,
+                                                     &Length));
+
+    UnitTestExpect(Result, NumberOfStatements == 4 && Length == 4);
+    UnitTestExpect(Result, Lengths[2] == 0 && Offsets[2] == 3 && Offsets[3] == 3);
+    UnitTestExpect(Result, Bytes[0] == 0xeb && Bytes[1] == 0x01 && Bytes[2] == 0xcc && Bytes[3] == 0xc3);
+
+    //
+    // The forward jump becomes a near jump once the label is too far
+    // (the statements are assembled again)
+    //
+    UnitTestExpect(Result, TestAssemblerCompareBatch(TestAssemblerGetJumpOverNops(100), 103));
+    UnitTestExpect(Result, TestAssemblerCompareBatch(TestAssemblerGetJumpOverNops(200), 203));
+
+    return Result;
+}
+
+/**
+ * @brief Test the invalidation of the last assembled code
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestAssemblerCachedResult()
+{
+    BOOLEAN Result = TRUE;
+    UINT32  Length = 0;
+
+    UnitTestExpect(Result, hyperdbg_u_assemble_get_length("nop; ret", TEST_ASSEMBLER_START_ADDRESS, &Length) && Length == 2);
+    UnitTestExpect(Result, hyperdbg_u_test_assembler_has_cached_result());
+
+    //
+    // The symbols of the code might be resolved to other addresses after
+    // loading or unloading the symbols
+    //
+    hyperdbg_u_test_unload_module_symbol("hdasmfixture");
+    UnitTestExpect(Result, !hyperdbg_u_test_assembler_has_cached_result());
+
+    UnitTestExpect(Result, hyperdbg_u_assemble_get_length("nop; ret", TEST_ASSEMBLER_START_ADDRESS, &Length) && Length == 2);
+    UnitTestExpect(Result, hyperdbg_u_test_assembler_has_cached_result());
+
+    hyperdbg_u_test_load_symbol_file(TEST_ASSEMBLER_START_ADDRESS, "hdasmfixture.pdb", "hdasmfixture");
+    UnitTestExpect(Result, !hyperdbg_u_test_assembler_has_cached_result());
+
+    return Result;
+}
+
+/**
+ * @brief Tests of the cached assembler and the batch assembly
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+TestAssembler()
+{
+    BOOLEAN Result = TRUE;
+
+    hyperdbg_u_set_text_message_callback((PVOID)TestAssemblerMessageHandler);
+
+    UnitTestExpect(Result, TestAssemblerLabels());
+    UnitTestExpect(Result, TestAssemblerCachedResult());
+
+    hyperdbg_u_unset_text_message_callback();
+
+    return Result;
+}
+
+/**
+ * @brief Benchmark of the assembler
+ * @details querying the length and then assembling the same code (the
+ * cached result), assembling at different addresses, and the batch
+ * assembly with labels
+ *
+ * @return VOID
+ */
+VOID
+BenchmarkAssembler()
+{
+    std::string         Code = TestAssemblerGetJumpOverNops(64);
+    std::vector<BYTE>   Bytes(TEST_ASSEMBLER_BUFFER_SIZE, 0);
+    std::vector<UINT32> Offsets(TEST_ASSEMBLER_MAXIMUM_STATEMENTS, 0);
+    std::vector<UINT32> Lengths(TEST_ASSEMBLER_MAXIMUM_STATEMENTS, 0);
+    UINT32              NumberOfStatements;
+    UINT32              Length;
+    UINT64              StartTime;
+
+    hyperdbg_u_set_text_message_callback((PVOID)TestAssemblerMessageHandler);
+
+    StartTime = UnitTestGetTimeInNanoseconds();
+
+    for (UINT32 i = 0; i < TEST_ASSEMBLER_BENCHMARK_ITERATIONS; i++)
+    {
+        hyperdbg_u_assemble_get_length(Code.c_str(), TEST_ASSEMBLER_START_ADDRESS, &Length);
+        hyperdbg_u_assemble(Code.c_str(), TEST_ASSEMBLER_START_ADDRESS, Bytes.data(), (UINT32)Bytes.size());
+    }
+
+    UnitTestShowBenchmarkResult("length and assemble (same address)",
+                                UnitTestGetTimeInNanoseconds() - StartTime,
+                                TEST_ASSEMBLER_BENCHMARK_ITERATIONS);
+
+    StartTime = UnitTestGetTimeInNanoseconds();
+
+    for (UINT32 i = 0; i < TEST_ASSEMBLER_BENCHMARK_ITERATIONS; i++)
+    {
+        hyperdbg_u_assemble_get_length(Code.c_str(), TEST_ASSEMBLER_START_ADDRESS + i * 2, &Length);
+        hyperdbg_u_assemble(Code.c_str(), TEST_ASSEMBLER_START_ADDRESS + i * 2 + 1, Bytes.data(), (UINT32)Bytes.size());
+    }
+
+    UnitTestShowBenchmarkResult("length and assemble (other addresses)",
+                                UnitTestGetTimeInNanoseconds() - StartTime,
+                                TEST_ASSEMBLER_BENCHMARK_ITERATIONS);
+
+    StartTime = UnitTestGetTimeInNanoseconds();
+
+    for (UINT32 i = 0; i < TEST_ASSEMBLER_BENCHMARK_ITERATIONS; i++)
+    {
+        hyperdbg_u_assemble_batch(Code.c_str(),
+                                  TEST_ASSEMBLER_START_ADDRESS,
+                                  Bytes.data(),
+                                  (UINT32)Bytes.size(),
+                                  Offsets.data(),
+                                  Lengths.data(),
+                                  (UINT32)Offsets.size(),
+                                  &NumberOfStatements,
+                                  &Length);
+    }
+
+    UnitTestShowBenchmarkResult("batch of 67 statements with a label",
+                                UnitTestGetTimeInNanoseconds() - StartTime,
+                                TEST_ASSEMBLER_BENCHMARK_ITERATIONS);
+
+    hyperdbg_u_unset_text_message_callback();
+}
+
+UnitTestRegister("assembler", TestAssembler, BenchmarkAssembler);
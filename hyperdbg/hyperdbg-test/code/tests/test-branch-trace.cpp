@@ -0,0 +1,754 @@
+/**
+ * @file test-branch-trace.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Tests and benchmark of tracing the branches (LBR)
+ * @details the branches of a random walk on a synthetic control flow graph
+ * are pushed to a simulated LBR stack and drained in the same way as the
+ * kernel (LbrStack.c), then they are decoded and the coverage is built in
+ * the same way as the '!track cov' command
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Number of the branches of the random walk
+ *
+ */
+#define TEST_BRANCH_TRACE_NUMBER_OF_BRANCHES 100000
+
+/**
+ * @brief Number of the basic blocks of the synthetic control flow graph
+ *
+ */
+#define TEST_BRANCH_TRACE_NUMBER_OF_BLOCKS 512
+
+/**
+ * @brief Distance between the basic blocks of the synthetic control flow
+ * graph (more than BRANCH_TRACE_MAXIMUM_BASIC_BLOCK_SIZE)
+ *
+ */
+#define TEST_BRANCH_TRACE_BLOCK_DISTANCE 0x2000
+
+/**
+ * @brief Base address of the synthetic control flow graph (kernel-mode)
+ *
+ */
+#define TEST_BRANCH_TRACE_BASE_ADDRESS 0xfffff80012340000ull
+
+/**
+ * @brief Mask of the address bits of the raw records (the upper bits are
+ * the flags or the cycles)
+ *
+ */
+#define TEST_BRANCH_TRACE_ADDRESS_MASK 0x0000ffffffffffffull
+
+/**
+ * @brief A basic block of the synthetic control flow graph
+ *
+ */
+typedef struct _TEST_BRANCH_TRACE_BLOCK
+{
+    UINT64 Start;
+    UINT64 End; // address of the branch at the end of the block
+    UINT32 Successors[2];
+
+} TEST_BRANCH_TRACE_BLOCK, *PTEST_BRANCH_TRACE_BLOCK;
+
+/**
+ * @brief A branch of the random walk
+ *
+ */
+typedef struct _TEST_BRANCH_TRACE_BRANCH
+{
+    UINT32                       Block; // the destination block
+    DEBUGGER_BRANCH_TRACE_RECORD Record;
+
+} TEST_BRANCH_TRACE_BRANCH, *PTEST_BRANCH_TRACE_BRANCH;
+
+/**
+ * @brief Build the synthetic control flow graph
+ *
+ * @param RandomState
+ * @param Blocks
+ *
+ * @return VOID
+ */
+static VOID
+TestBranchTraceBuildGraph(UINT64 * RandomState, std::vector<TEST_BRANCH_TRACE_BLOCK> & Blocks)
+{
+    Blocks.resize(TEST_BRANCH_TRACE_NUMBER_OF_BLOCKS);
+
+    for (UINT32 i = 0; i < TEST_BRANCH_TRACE_NUMBER_OF_BLOCKS; i++)
+    {
+        Blocks[i].Start         = TEST_BRANCH_TRACE_BASE_ADDRESS + i * TEST_BRANCH_TRACE_BLOCK_DISTANCE + UnitTestGetRandom(RandomState) % 0x100;
+        Blocks[i].End           = Blocks[i].Start + UnitTestGetRandom(RandomState) % (BRANCH_TRACE_MAXIMUM_BASIC_BLOCK_SIZE + 1);
+        Blocks[i].Successors[0] = (UINT32)(UnitTestGetRandom(RandomState) % TEST_BRANCH_TRACE_NUMBER_OF_BLOCKS);
+        Blocks[i].Successors[1] = (UINT32)(UnitTestGetRandom(RandomState) % TEST_BRANCH_TRACE_NUMBER_OF_BLOCKS);
+    }
+}
+
+/**
+ * @brief Walk on the synthetic control flow graph
+ * @details the raw records are in the format with the mispredicted flag and
+ * the cycles (BRANCH_TRACE_LBR_FORMAT_64BIT_EIP_FLAGS_CYCLES)
+ *
+ * @param RandomState
+ * @param Blocks
+ * @param NumberOfBranches
+ * @param Branches
+ *
+ * @return VOID
+ */
+static VOID
+TestBranchTraceWalk(UINT64 *                                     RandomState,
+                    const std::vector<TEST_BRANCH_TRACE_BLOCK> & Blocks,
+                    UINT32                                       NumberOfBranches,
+                    std::vector<TEST_BRANCH_TRACE_BRANCH> &      Branches)
+{
+    TEST_BRANCH_TRACE_BRANCH Branch  = {};
+    UINT32                   Current = 0;
+    UINT64                   Random;
+
+    Branches.clear();
+
+    for (UINT32 i = 0; i < NumberOfBranches; i++)
+    {
+        Random       = UnitTestGetRandom(RandomState);
+        Branch.Block = Blocks[Current].Successors[Random & 1];
+
+        Branch.Record.From = (Blocks[Current].End & TEST_BRANCH_TRACE_ADDRESS_MASK) | (((Random >> 1) & 1) << 63);
+        Branch.Record.To   = (Blocks[Branch.Block].Start & TEST_BRANCH_TRACE_ADDRESS_MASK) | (((Random >> 8) & 0xffff) << 48);
+        Branch.Record.Type = DEBUGGER_BRANCH_TRACE_TYPE_JCC;
+
+        Branches.push_back(Branch);
+
+        Current = Branch.Block;
+    }
+}
+
+/**
+ * @brief Record a branch in the simulated LBR stack
+ *
+ * @param Snapshot The simulated stack
+ * @param Record
+ *
+ * @return VOID
+ */
+static VOID
+TestBranchTracePushBranch(PLBR_STACK_SNAPSHOT Snapshot, const DEBUGGER_BRANCH_TRACE_RECORD & Record)
+{
+    Snapshot->Tos                 = (Snapshot->Tos + 1) % Snapshot->Depth;
+    Snapshot->From[Snapshot->Tos] = Record.From;
+    Snapshot->To[Snapshot->Tos]   = Record.To;
+}
+
+/**
+ * @brief Drain the simulated LBR stack in the same way as the hypervisor
+ * @details the entries are cleared, but the top of the stack is not changed
+ *
+ * @param Snapshot The simulated stack
+ * @param Records
+ * @param MaximumNumberOfRecords
+ * @param IsOverflowed
+ *
+ * @return UINT32
+ */
+static UINT32
+TestBranchTraceDrain(PLBR_STACK_SNAPSHOT           Snapshot,
+                     PDEBUGGER_BRANCH_TRACE_RECORD Records,
+                     UINT32                        MaximumNumberOfRecords,
+                     BOOLEAN *                     IsOverflowed)
+{
+    UINT32 Count = LbrStackCollect(Snapshot, Records, MaximumNumberOfRecords, IsOverflowed);
+
+    for (UINT32 i = 0; i < Snapshot->Depth && i < LBR_STACK_MAXIMUM_DEPTH; i++)
+    {
+        Snapshot->From[i] = 0;
+        Snapshot->To[i]   = 0;
+    }
+
+    return Count;
+}
+
+/**
+ * @brief Drain the simulated LBR stack and add the records to the trace in
+ * the same way as the debugger
+ *
+ * @param Snapshot The simulated stack
+ * @param Trace
+ * @param NumberOfLostDrains Number of the drains that some branches might be
+ * lost before them
+ *
+ * @return VOID
+ */
+static VOID
+TestBranchTraceDrainToTrace(PLBR_STACK_SNAPSHOT                         Snapshot,
+                            std::vector<DEBUGGER_BRANCH_TRACE_RECORD> & Trace,
+                            UINT32 *                                    NumberOfLostDrains)
+{
+    DEBUGGER_BRANCH_TRACE_RECORD Records[LBR_STACK_MAXIMUM_DEPTH];
+    BOOLEAN                      IsOverflowed;
+    UINT32                       Count;
+
+    Count = TestBranchTraceDrain(Snapshot, Records, LBR_STACK_MAXIMUM_DEPTH, &IsOverflowed);
+
+    if (Count != 0 && IsOverflowed)
+    {
+        Records[0].Flags |= DEBUGGER_BRANCH_TRACE_RECORD_FLAG_BRANCHES_LOST;
+        (*NumberOfLostDrains)++;
+    }
+
+    Trace.insert(Trace.end(), Records, Records + Count);
+}
+
+/**
+ * @brief Test draining the LBR stack at different intervals
+ * @details the drained branches are the last branches (up to the depth of
+ * the stack) since the previous drain, from the oldest to the newest
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestBranchTraceLbrStack()
+{
+    BOOLEAN                      Result      = TRUE;
+    UINT64                       RandomState = 0x4c4252537461636bull;
+    const UINT32                 Depths[]    = {4, 8, 16, 32};
+    LBR_STACK_SNAPSHOT           Snapshot;
+    DEBUGGER_BRANCH_TRACE_RECORD Record = {};
+    DEBUGGER_BRANCH_TRACE_RECORD Records[LBR_STACK_MAXIMUM_DEPTH];
+    BOOLEAN                      IsOverflowed;
+    UINT32                       Count;
+    UINT64                       NextBranch = 1;
+
+    for (UINT32 Depth : Depths)
+    {
+        RtlZeroMemory(&Snapshot, sizeof(LBR_STACK_SNAPSHOT));
+
+        Snapshot.Depth = Depth;
+        Snapshot.Tos   = (UINT32)(UnitTestGetRandom(&RandomState) % Depth);
+
+        //
+        // Nothing is recorded since the previous drain
+        //
+        Count = TestBranchTraceDrain(&Snapshot, Records, LBR_STACK_MAXIMUM_DEPTH, &IsOverflowed);
+
+        UnitTestExpect(Result, Count == 0 && !IsOverflowed);
+
+        for (UINT32 Round = 0; Round < 200; Round++)
+        {
+            UINT32 Interval = Round < Depth + 4 ? Round + 1 : 1 + (UINT32)(UnitTestGetRandom(&RandomState) % (2 * Depth));
+            UINT64 First    = NextBranch;
+
+            for (UINT32 i = 0; i < Interval; i++)
+            {
+                //
+                // The flags in the upper bits don't change the branches
+                //
+                Record.From = (NextBranch << 4) | ((NextBranch & 1) << 63);
+                Record.To   = (NextBranch << 8) + 1;
+
+                TestBranchTracePushBranch(&Snapshot, Record);
+                NextBranch++;
+            }
+
+            Count = TestBranchTraceDrain(&Snapshot, Records, LBR_STACK_MAXIMUM_DEPTH, &IsOverflowed);
+
+            UnitTestExpect(Result, Count == (Interval < Depth ? Interval : Depth));
+            UnitTestExpect(Result, IsOverflowed == (Interval >= Depth));
+
+            for (UINT32 i = 0; i < Count; i++)
+            {
+                UINT64 Branch = First + Interval - Count + i;
+
+                UnitTestExpect(Result, Records[i].From == ((Branch << 4) | ((Branch & 1) << 63)));
+                UnitTestExpect(Result, Records[i].To == (Branch << 8) + 1);
+                UnitTestExpect(Result, Records[i].Type == 0 && Records[i].CoreId == 0 && Records[i].Flags == 0);
+            }
+        }
+
+        //
+        // The oldest branches are kept if the records are not enough
+        //
+        for (UINT32 i = 0; i < Depth - 1; i++)
+        {
+            Record.From = NextBranch + i;
+            Record.To   = NextBranch + i + 1;
+
+            TestBranchTracePushBranch(&Snapshot, Record);
+        }
+
+        Count = TestBranchTraceDrain(&Snapshot, Records, Depth - 2, &IsOverflowed);
+
+        UnitTestExpect(Result, Count == Depth - 2 && !IsOverflowed);
+
+        for (UINT32 i = 0; i < Count; i++)
+        {
+            UnitTestExpect(Result, Records[i].From == NextBranch + i);
+        }
+
+        Count = TestBranchTraceDrain(&Snapshot, Records, LBR_STACK_MAXIMUM_DEPTH, &IsOverflowed);
+
+        UnitTestExpect(Result, Count == 0);
+
+        NextBranch += Depth;
+    }
+
+    //
+    // The depths that are not supported
+    //
+    Snapshot.Depth   = 0;
+    Snapshot.From[0] = 1;
+
+    UnitTestExpect(Result, LbrStackCollect(&Snapshot, Records, LBR_STACK_MAXIMUM_DEPTH, &IsOverflowed) == 0 && !IsOverflowed);
+
+    for (UINT32 i = 0; i < LBR_STACK_MAXIMUM_DEPTH; i++)
+    {
+        Snapshot.From[i] = i + 1;
+        Snapshot.To[i]   = i + 1;
+    }
+
+    Snapshot.Depth = LBR_STACK_MAXIMUM_DEPTH + 1;
+
+    UnitTestExpect(Result, LbrStackCollect(&Snapshot, Records, LBR_STACK_MAXIMUM_DEPTH, &IsOverflowed) == 0 && !IsOverflowed);
+
+    return Result;
+}
+
+/**
+ * @brief Test the depth of the LBR stack of the processors
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestBranchTraceLbrDepth()
+{
+    BOOLEAN Result = TRUE;
+
+    UnitTestExpect(Result, LbrStackGetDepth(0x17) == 4);  // Penryn
+    UnitTestExpect(Result, LbrStackGetDepth(0x37) == 8);  // Silvermont
+    UnitTestExpect(Result, LbrStackGetDepth(0x1a) == 16); // Nehalem
+    UnitTestExpect(Result, LbrStackGetDepth(0x3c) == 16); // Haswell
+    UnitTestExpect(Result, LbrStackGetDepth(0x9e) == 32); // Kaby Lake
+    UnitTestExpect(Result, LbrStackGetDepth(0x5c) == 32); // Goldmont
+
+    //
+    // The unknown models and the models with the architectural LBRs
+    //
+    UnitTestExpect(Result, LbrStackGetDepth(0x00) == 0);
+    UnitTestExpect(Result, LbrStackGetDepth(0x8f) == 0); // Sapphire Rapids
+    UnitTestExpect(Result, LbrStackGetDepth(0xff) == 0);
+
+    return Result;
+}
+
+/**
+ * @brief Test decoding the records of each format
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestBranchTraceDecoder()
+{
+    BOOLEAN                      Result = TRUE;
+    DEBUGGER_BRANCH_TRACE_RECORD Record = {};
+    BRANCH_TRACE_DECODED_RECORD  Decoded;
+
+    Record.Type   = DEBUGGER_BRANCH_TRACE_TYPE_CALL;
+    Record.CoreId = 7;
+    Record.Flags  = DEBUGGER_BRANCH_TRACE_RECORD_FLAG_THREAD_RESUMED;
+
+    //
+    // The addresses are truncated in the 32-bit format
+    //
+    Record.From = 0xdeadbeef12345678ull;
+    Record.To   = 0xcafebabe87654321ull;
+
+    BranchTraceDecodeRecord(BRANCH_TRACE_LBR_FORMAT_32BIT, &Record, &Decoded);
+
+    UnitTestExpect(Result, Decoded.From == 0x12345678 && Decoded.To == 0x87654321);
+    UnitTestExpect(Result, Decoded.Type == DEBUGGER_BRANCH_TRACE_TYPE_CALL && Decoded.CoreId == 7);
+    UnitTestExpect(Result, Decoded.Flags == DEBUGGER_BRANCH_TRACE_RECORD_FLAG_THREAD_RESUMED);
+    UnitTestExpect(Result, !Decoded.IsMispredicted && Decoded.Cycles == 0);
+
+    //
+    // The mispredicted flag is the bit 63 of the source, the kernel-mode
+    // addresses are sign-extended
+    //
+    Record.From = (1ull << 63) | (0xfffff80012345678ull & TEST_BRANCH_TRACE_ADDRESS_MASK);
+    Record.To   = 0x00007ff612345678ull;
+
+    BranchTraceDecodeRecord(BRANCH_TRACE_LBR_FORMAT_64BIT_EIP_FLAGS, &Record, &Decoded);
+
+    UnitTestExpect(Result, Decoded.From == 0xfffff80012345678ull && Decoded.To == 0x00007ff612345678ull);
+    UnitTestExpect(Result, Decoded.IsMispredicted && !Decoded.IsInTsx && !Decoded.IsTsxAbort);
+
+    Record.From = 0x00007ff612345678ull;
+
+    BranchTraceDecodeRecord(BRANCH_TRACE_LBR_FORMAT_64BIT_EIP_FLAGS, &Record, &Decoded);
+
+    UnitTestExpect(Result, Decoded.From == 0x00007ff612345678ull && !Decoded.IsMispredicted);
+
+    //
+    // The flags of the transactions are the bits 61 and 62 of the source
+    //
+    Record.From = (1ull << 62) | (1ull << 61) | 0x00007ff612345678ull;
+
+    BranchTraceDecodeRecord(BRANCH_TRACE_LBR_FORMAT_64BIT_EIP_FLAGS_TSX, &Record, &Decoded);
+
+    UnitTestExpect(Result, Decoded.From == 0x00007ff612345678ull);
+    UnitTestExpect(Result, !Decoded.IsMispredicted && Decoded.IsInTsx && Decoded.IsTsxAbort);
+
+    Record.From = (1ull << 62) | 0x00007ff612345678ull;
+
+    BranchTraceDecodeRecord(BRANCH_TRACE_LBR_FORMAT_64BIT_EIP_FLAGS_TSX, &Record, &Decoded);
+
+    UnitTestExpect(Result, Decoded.IsInTsx && !Decoded.IsTsxAbort);
+
+    //
+    // The cycles are the upper bits of the destination
+    //
+    Record.From = (1ull << 63) | 0x00007ff612345678ull;
+    Record.To   = (0x1234ull << 48) | (0xfffff80087654321ull & TEST_BRANCH_TRACE_ADDRESS_MASK);
+
+    BranchTraceDecodeRecord(BRANCH_TRACE_LBR_FORMAT_64BIT_EIP_FLAGS_CYCLES, &Record, &Decoded);
+
+    UnitTestExpect(Result, Decoded.From == 0x00007ff612345678ull && Decoded.To == 0xfffff80087654321ull);
+    UnitTestExpect(Result, Decoded.IsMispredicted && Decoded.Cycles == 0x1234);
+    UnitTestExpect(Result, Decoded.Flags == DEBUGGER_BRANCH_TRACE_RECORD_FLAG_THREAD_RESUMED);
+
+    //
+    // The flags of the formats with LBR_INFO are not in the records
+    //
+    Record.From = 0xfffff80012345678ull;
+    Record.To   = 0xfffff80087654321ull;
+
+    BranchTraceDecodeRecord(BRANCH_TRACE_LBR_FORMAT_64BIT_EIP_FLAGS_INFO, &Record, &Decoded);
+
+    UnitTestExpect(Result, Decoded.From == 0xfffff80012345678ull && Decoded.To == 0xfffff80087654321ull);
+    UnitTestExpect(Result, !Decoded.IsMispredicted && Decoded.Cycles == 0);
+
+    UnitTestExpect(Result, BranchTraceIsMispredictionFlagSupported(BRANCH_TRACE_LBR_FORMAT_64BIT_EIP_FLAGS_TSX));
+    UnitTestExpect(Result, !BranchTraceIsMispredictionFlagSupported(BRANCH_TRACE_LBR_FORMAT_64BIT_EIP_FLAGS_INFO));
+
+    return Result;
+}
+
+/**
+ * @brief Test the coverage of a random walk
+ * @details the expected basic blocks, edges and bitmap entries are built
+ * from the blocks of the walk, the walk is resumed from a random block
+ * after the gaps
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestBranchTraceCoverage()
+{
+    BOOLEAN                                     Result      = TRUE;
+    UINT64                                      RandomState = 0x436f766572616765ull;
+    std::vector<TEST_BRANCH_TRACE_BLOCK>        Blocks;
+    std::vector<TEST_BRANCH_TRACE_BRANCH>       Branches;
+    std::vector<DEBUGGER_BRANCH_TRACE_RECORD>   Records;
+    std::vector<BRANCH_TRACE_DECODED_RECORD>    DecodedRecords;
+    std::map<std::pair<UINT64, UINT64>, UINT64> ExpectedBasicBlocks;
+    std::map<std::pair<UINT64, UINT64>, UINT64> ExpectedEdges;
+    std::map<UINT32, UINT64>                    ExpectedBitmap;
+    BRANCH_TRACE_COVERAGE                       Coverage             = {};
+    UINT64                                      ExpectedMispredicted = 0;
+    UINT64                                      ExpectedGaps         = 0;
+    UINT32                                      PreviousLocation     = 0;
+    BOOLEAN                                     IsBitmapCorrect      = TRUE;
+
+    TestBranchTraceBuildGraph(&RandomState, Blocks);
+    TestBranchTraceWalk(&RandomState, Blocks, TEST_BRANCH_TRACE_NUMBER_OF_BRANCHES, Branches);
+
+    for (size_t i = 0; i < Branches.size(); i++)
+    {
+        //
+        // The thread is switched out and its branches are not recorded
+        //
+        if (i != 0 && UnitTestGetRandom(&RandomState) % 64 == 0)
+        {
+            Branches[i].Record.Flags |= (i & 1) ? DEBUGGER_BRANCH_TRACE_RECORD_FLAG_THREAD_RESUMED : DEBUGGER_BRANCH_TRACE_RECORD_FLAG_BRANCHES_LOST;
+            Branches[i].Record.From = Blocks[UnitTestGetRandom(&RandomState) % TEST_BRANCH_TRACE_NUMBER_OF_BLOCKS].End & TEST_BRANCH_TRACE_ADDRESS_MASK;
+
+            ExpectedGaps++;
+            PreviousLocation = 0;
+        }
+
+        Records.push_back(Branches[i].Record);
+
+        ExpectedEdges[std::make_pair((UINT64)(((INT64)(Branches[i].Record.From << 16)) >> 16), Blocks[Branches[i].Block].Start)]++;
+        ExpectedBitmap[BranchTraceGetBitmapLocation(Blocks[Branches[i].Block].Start) ^ PreviousLocation]++;
+        PreviousLocation = BranchTraceGetBitmapLocation(Blocks[Branches[i].Block].Start) >> 1;
+
+        if (Branches[i].Record.From >> 63)
+        {
+            ExpectedMispredicted++;
+        }
+    }
+
+    //
+    // The destination block of each branch ends at the next branch (if it's
+    // not after a gap)
+    //
+    for (size_t i = 0; i + 1 < Branches.size(); i++)
+    {
+        if (Branches[i + 1].Record.Flags == 0)
+        {
+            ExpectedBasicBlocks[std::make_pair(Blocks[Branches[i].Block].Start, Blocks[Branches[i].Block].End)]++;
+        }
+    }
+
+    BranchTraceDecodeRecords(BRANCH_TRACE_LBR_FORMAT_64BIT_EIP_FLAGS_CYCLES, Records.data(), (UINT32)Records.size(), DecodedRecords);
+    BranchTraceBuildCoverage(DecodedRecords, &Coverage);
+
+    UnitTestExpect(Result, DecodedRecords.size() == TEST_BRANCH_TRACE_NUMBER_OF_BRANCHES);
+    UnitTestExpect(Result, Coverage.BasicBlocks == ExpectedBasicBlocks);
+    UnitTestExpect(Result, Coverage.Edges == ExpectedEdges);
+    UnitTestExpect(Result, Coverage.NumberOfMispredictedBranches == ExpectedMispredicted);
+    UnitTestExpect(Result, Coverage.NumberOfGaps == ExpectedGaps && ExpectedGaps != 0);
+    UnitTestExpect(Result, Coverage.NumberOfDiscontinuities == 0);
+
+    for (UINT32 i = 0; i < BRANCH_TRACE_COVERAGE_BITMAP_SIZE; i++)
+    {
+        auto   Iterate  = ExpectedBitmap.find(i);
+        UINT64 Expected = Iterate == ExpectedBitmap.end() ? 0 : Iterate->second;
+
+        if (Coverage.Bitmap[i] != (Expected > 0xff ? 0xff : Expected))
+        {
+            IsBitmapCorrect = FALSE;
+        }
+    }
+
+    UnitTestExpect(Result, IsBitmapCorrect);
+    UnitTestExpect(Result, BranchTraceGetNumberOfCoveredBitmapEntries(&Coverage) == ExpectedBitmap.size());
+
+    //
+    // A loop saturates its entry, the branches to another place (e.g., an
+    // interrupt) don't form a basic block
+    //
+    DecodedRecords.clear();
+
+    for (UINT32 i = 0; i < 300; i++)
+    {
+        BRANCH_TRACE_DECODED_RECORD Decoded = {};
+
+        Decoded.From = 0x1000 + 0x40;
+        Decoded.To   = 0x1000;
+
+        DecodedRecords.push_back(Decoded);
+    }
+
+    DecodedRecords.back().To = 0x1000 + BRANCH_TRACE_MAXIMUM_BASIC_BLOCK_SIZE + 0x41;
+
+    DecodedRecords.push_back(DecodedRecords.front());
+
+    BranchTraceBuildCoverage(DecodedRecords, &Coverage);
+
+    UnitTestExpect(Result, Coverage.Bitmap[BranchTraceGetBitmapLocation(0x1000) ^ (BranchTraceGetBitmapLocation(0x1000) >> 1)] == 0xff);
+    UnitTestExpect(Result, Coverage.BasicBlocks.size() == 1 && Coverage.BasicBlocks.begin()->second == 299);
+    UnitTestExpect(Result, Coverage.NumberOfDiscontinuities == 1 && Coverage.NumberOfGaps == 0);
+
+    //
+    // The largest basic block is still a basic block
+    //
+    DecodedRecords.assign(3, BRANCH_TRACE_DECODED_RECORD {});
+
+    DecodedRecords[0].To   = 0x1000;
+    DecodedRecords[1].From = 0x1000 + BRANCH_TRACE_MAXIMUM_BASIC_BLOCK_SIZE;
+    DecodedRecords[1].To   = 0x3000;
+    DecodedRecords[2].From = 0x3000 + BRANCH_TRACE_MAXIMUM_BASIC_BLOCK_SIZE + 1;
+
+    BranchTraceBuildCoverage(DecodedRecords, &Coverage);
+
+    UnitTestExpect(Result, Coverage.BasicBlocks.size() == 1 && Coverage.BasicBlocks.begin()->first.first == 0x1000);
+    UnitTestExpect(Result, Coverage.NumberOfDiscontinuities == 1);
+
+    return Result;
+}
+
+/**
+ * @brief Test the coverage of the branches that are drained from the LBR
+ * stack at random points
+ * @details the branches before the overflowed drains are lost, so no basic
+ * block is formed across them, if the stack never overflows, the coverage
+ * is the same as the coverage of all the branches
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestBranchTraceDrainedCoverage()
+{
+    BOOLEAN                                     Result      = TRUE;
+    UINT64                                      RandomState = 0x447261696e656421ull;
+    std::vector<TEST_BRANCH_TRACE_BLOCK>        Blocks;
+    std::vector<TEST_BRANCH_TRACE_BRANCH>       Branches;
+    std::vector<DEBUGGER_BRANCH_TRACE_RECORD>   AllRecords;
+    std::vector<DEBUGGER_BRANCH_TRACE_RECORD>   Trace;
+    std::vector<BRANCH_TRACE_DECODED_RECORD>    DecodedRecords;
+    std::map<std::pair<UINT64, UINT64>, UINT32> RealBasicBlocks;
+    BRANCH_TRACE_COVERAGE                       Coverage         = {};
+    BRANCH_TRACE_COVERAGE                       ExpectedCoverage = {};
+    LBR_STACK_SNAPSHOT                          Snapshot;
+    UINT32                                      NumberOfLostDrains;
+    UINT32                                      Interval;
+
+    TestBranchTraceBuildGraph(&RandomState, Blocks);
+    TestBranchTraceWalk(&RandomState, Blocks, TEST_BRANCH_TRACE_NUMBER_OF_BRANCHES, Branches);
+
+    for (const auto & Block : Blocks)
+    {
+        RealBasicBlocks[std::make_pair(Block.Start, Block.End)]++;
+    }
+
+    for (const auto & Branch : Branches)
+    {
+        AllRecords.push_back(Branch.Record);
+    }
+
+    BranchTraceDecodeRecords(BRANCH_TRACE_LBR_FORMAT_64BIT_EIP_FLAGS_CYCLES, AllRecords.data(), (UINT32)AllRecords.size(), DecodedRecords);
+    BranchTraceBuildCoverage(DecodedRecords, &ExpectedCoverage);
+
+    for (UINT32 MaximumInterval : {15u, 24u})
+    {
+        RtlZeroMemory(&Snapshot, sizeof(LBR_STACK_SNAPSHOT));
+
+        Snapshot.Depth     = 16;
+        NumberOfLostDrains = 0;
+        Interval           = 0;
+
+        Trace.clear();
+        DecodedRecords.clear();
+
+        for (const auto & Record : AllRecords)
+        {
+            if (Interval == 0)
+            {
+                TestBranchTraceDrainToTrace(&Snapshot, Trace, &NumberOfLostDrains);
+                Interval = 1 + (UINT32)(UnitTestGetRandom(&RandomState) % MaximumInterval);
+            }
+
+            TestBranchTracePushBranch(&Snapshot, Record);
+            Interval--;
+        }
+
+        TestBranchTraceDrainToTrace(&Snapshot, Trace, &NumberOfLostDrains);
+
+        BranchTraceDecodeRecords(BRANCH_TRACE_LBR_FORMAT_64BIT_EIP_FLAGS_CYCLES, Trace.data(), (UINT32)Trace.size(), DecodedRecords);
+        BranchTraceBuildCoverage(DecodedRecords, &Coverage);
+
+        UnitTestExpect(Result, Coverage.NumberOfGaps == NumberOfLostDrains);
+        UnitTestExpect(Result, Coverage.NumberOfDiscontinuities == 0);
+
+        for (const auto & BasicBlock : Coverage.BasicBlocks)
+        {
+            UnitTestExpect(Result, RealBasicBlocks.count(BasicBlock.first) != 0);
+        }
+
+        if (MaximumInterval < Snapshot.Depth)
+        {
+            UnitTestExpect(Result, NumberOfLostDrains == 0 && Trace.size() == AllRecords.size());
+            UnitTestExpect(Result, Coverage.BasicBlocks == ExpectedCoverage.BasicBlocks);
+            UnitTestExpect(Result, Coverage.Edges == ExpectedCoverage.Edges);
+            UnitTestExpect(Result, Coverage.Bitmap == ExpectedCoverage.Bitmap);
+        }
+        else
+        {
+            UnitTestExpect(Result, NumberOfLostDrains != 0 && Trace.size() < AllRecords.size());
+        }
+    }
+
+    return Result;
+}
+
+/**
+ * @brief Tests of tracing the branches
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+TestBranchTrace()
+{
+    BOOLEAN Result = TRUE;
+
+    UnitTestExpect(Result, TestBranchTraceLbrStack());
+    UnitTestExpect(Result, TestBranchTraceLbrDepth());
+    UnitTestExpect(Result, TestBranchTraceDecoder());
+    UnitTestExpect(Result, TestBranchTraceCoverage());
+    UnitTestExpect(Result, TestBranchTraceDrainedCoverage());
+
+    return Result;
+}
+
+/**
+ * @brief Benchmark of tracing the branches
+ * @details the cost of each branch in draining the LBR stack (by the
+ * hypervisor), and in decoding and building the coverage (by the debugger)
+ *
+ * @return VOID
+ */
+VOID
+BenchmarkBranchTrace()
+{
+    UINT64                                    RandomState = 0x42656e6368ull;
+    std::vector<TEST_BRANCH_TRACE_BLOCK>      Blocks;
+    std::vector<TEST_BRANCH_TRACE_BRANCH>     Branches;
+    std::vector<DEBUGGER_BRANCH_TRACE_RECORD> Trace;
+    std::vector<BRANCH_TRACE_DECODED_RECORD>  DecodedRecords;
+    BRANCH_TRACE_COVERAGE                     Coverage           = {};
+    LBR_STACK_SNAPSHOT                        Snapshot           = {};
+    UINT32                                    NumberOfLostDrains = 0;
+    UINT64                                    StartTime;
+
+    TestBranchTraceBuildGraph(&RandomState, Blocks);
+    TestBranchTraceWalk(&RandomState, Blocks, TEST_BRANCH_TRACE_NUMBER_OF_BRANCHES, Branches);
+
+    Trace.reserve(TEST_BRANCH_TRACE_NUMBER_OF_BRANCHES);
+
+    //
+    // The stack is drained after each 16 branches (a context switch or a
+    // clock interrupt)
+    //
+    Snapshot.Depth = 32;
+
+    StartTime = UnitTestGetTimeInNanoseconds();
+
+    for (UINT32 i = 0; i < TEST_BRANCH_TRACE_NUMBER_OF_BRANCHES; i++)
+    {
+        TestBranchTracePushBranch(&Snapshot, Branches[i].Record);
+
+        if (i % 16 == 15)
+        {
+            TestBranchTraceDrainToTrace(&Snapshot, Trace, &NumberOfLostDrains);
+        }
+    }
+
+    TestBranchTraceDrainToTrace(&Snapshot, Trace, &NumberOfLostDrains);
+
+    UnitTestShowBenchmarkResult("draining the LBR stack (per branch)", UnitTestGetTimeInNanoseconds() - StartTime, TEST_BRANCH_TRACE_NUMBER_OF_BRANCHES);
+
+    StartTime = UnitTestGetTimeInNanoseconds();
+
+    BranchTraceDecodeRecords(BRANCH_TRACE_LBR_FORMAT_64BIT_EIP_FLAGS_CYCLES, Trace.data(), (UINT32)Trace.size(), DecodedRecords);
+
+    UnitTestShowBenchmarkResult("decoding the records", UnitTestGetTimeInNanoseconds() - StartTime, Trace.size());
+
+    StartTime = UnitTestGetTimeInNanoseconds();
+
+    BranchTraceBuildCoverage(DecodedRecords, &Coverage);
+
+    UnitTestShowBenchmarkResult("building the coverage (per branch)", UnitTestGetTimeInNanoseconds() - StartTime, Trace.size());
+
+    ShowMessages("\t%llx basic blocks, %llx edges and %x bitmap entries\n",
+                 (UINT64)Coverage.BasicBlocks.size(),
+                 (UINT64)Coverage.Edges.size(),
+                 BranchTraceGetNumberOfCoveredBitmapEntries(&Coverage));
+}
+
+UnitTestRegister("branch-trace", TestBranchTrace, BenchmarkBranchTrace);
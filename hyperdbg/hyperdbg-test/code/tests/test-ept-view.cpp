@@ -0,0 +1,919 @@
+/**
+ * @file test-ept-view.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Tests and benchmark of the paging tables of the EPT views
+ * @details the view tables (EptViewTable.c) are shared with hyperhv, random
+ * sequences of hooks, unhooks, splits and violations are applied on a model
+ * of a core's EPT and its original view, and both are walked independently
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Physical address of the first synthetic paging table
+ *
+ */
+#define TEST_EPT_VIEW_TABLES_PHYSICAL_BASE 0x7f000000
+
+/**
+ * @brief Number of the operations of each sequence
+ *
+ */
+#define TEST_EPT_VIEW_NUMBER_OF_OPERATIONS 20000
+
+/**
+ * @brief Number of the operations between the full checks
+ *
+ */
+#define TEST_EPT_VIEW_CHECKPOINT_INTERVAL 1000
+
+/**
+ * @brief Number of the violations of the benchmark
+ *
+ */
+#define TEST_EPT_VIEW_NUMBER_OF_VIOLATIONS 100000
+
+/**
+ * @brief The bits of a 4-KByte entry that affect the translation
+ * (R, W, X, memory type and the page frame number)
+ *
+ */
+#define TEST_EPT_VIEW_TRANSLATION_MASK 0x0000fffffffff03full
+
+/**
+ * @brief A model of a core's EPT and its original view
+ * @details the table i is at TEST_EPT_VIEW_TABLES_PHYSICAL_BASE + i * PAGE_SIZE
+ *
+ */
+typedef struct _TEST_EPT_VIEW_MACHINE
+{
+    std::vector<PEPT_VIEW_PAGING_TABLE>   Tables;
+    std::map<PVOID, UINT64>               PhysicalAddresses;
+    std::map<UINT64, std::vector<UINT64>> BaseShadow;       // the expected tables of the core's EPT
+    std::map<UINT64, EPT_PTE>             HookedPages;      // the original entries of the hooked pages
+    std::unordered_set<UINT64>            ViewPages;        // the hooked pages that are set in the view
+    std::unordered_set<UINT64>            HookedRegions[2]; // the 1GB and the 2MB regions that are hooked
+    EPT_PDPTE *                           BasePml3;
+    EPT_PDPTE *                           ViewPml3;
+    UINT32                                ViewTables;
+    UINT32                                MaximumViewTables;
+
+} TEST_EPT_VIEW_MACHINE, *PTEST_EPT_VIEW_MACHINE;
+
+/**
+ * @brief Add a paging table to the synthetic physical memory
+ *
+ * @param Machine
+ *
+ * @return PEPT_VIEW_PAGING_TABLE
+ */
+static PEPT_VIEW_PAGING_TABLE
+TestEptViewNewTable(PTEST_EPT_VIEW_MACHINE Machine)
+{
+    PEPT_VIEW_PAGING_TABLE Table = new EPT_VIEW_PAGING_TABLE;
+
+    memset(Table, 0xcc, sizeof(EPT_VIEW_PAGING_TABLE));
+
+    Machine->PhysicalAddresses[Table] = TEST_EPT_VIEW_TABLES_PHYSICAL_BASE + Machine->Tables.size() * PAGE_SIZE;
+    Machine->Tables.push_back(Table);
+
+    return Table;
+}
+
+/**
+ * @brief Allocate a paging table for the view (EPT_VIEW_TABLE_MEMORY)
+ *
+ * @param Context the machine
+ *
+ * @return PEPT_VIEW_PAGING_TABLE
+ */
+static PEPT_VIEW_PAGING_TABLE
+TestEptViewAllocateTable(PVOID Context)
+{
+    PTEST_EPT_VIEW_MACHINE Machine = (PTEST_EPT_VIEW_MACHINE)Context;
+
+    if (Machine->ViewTables >= Machine->MaximumViewTables)
+    {
+        return NULL;
+    }
+
+    Machine->ViewTables++;
+
+    return TestEptViewNewTable(Machine);
+}
+
+/**
+ * @brief Get the physical address of a paging table (EPT_VIEW_TABLE_MEMORY)
+ *
+ * @param Table
+ * @param Context the machine
+ *
+ * @return UINT64
+ */
+static UINT64
+TestEptViewTableToPhysical(PVOID Table, PVOID Context)
+{
+    PTEST_EPT_VIEW_MACHINE Machine = (PTEST_EPT_VIEW_MACHINE)Context;
+
+    return Machine->PhysicalAddresses.at(Table);
+}
+
+/**
+ * @brief Get the paging table at a physical address
+ * @details used by both the view tables (EPT_VIEW_TABLE_MEMORY) and the walks
+ *
+ * @param Address
+ * @param Context the machine
+ *
+ * @return PVOID NULL if there is no table at the address
+ */
+static PVOID
+TestEptViewPhysicalToTable(UINT64 Address, PVOID Context)
+{
+    PTEST_EPT_VIEW_MACHINE Machine = (PTEST_EPT_VIEW_MACHINE)Context;
+    UINT64                 Index   = (Address - TEST_EPT_VIEW_TABLES_PHYSICAL_BASE) / PAGE_SIZE;
+
+    if (Address < TEST_EPT_VIEW_TABLES_PHYSICAL_BASE || Address % PAGE_SIZE != 0 || Index >= Machine->Tables.size())
+    {
+        return NULL;
+    }
+
+    return Machine->Tables[Index];
+}
+
+/**
+ * @brief Put the original entries of the hooked pages of a 2MB region in a
+ * copied PML1 table (EPT_VIEW_TABLE_MEMORY)
+ *
+ * @param Table
+ * @param PhysicalAddress
+ * @param Context the machine
+ *
+ * @return VOID
+ */
+static VOID
+TestEptViewRestoreOriginalEntries(PEPT_VIEW_PAGING_TABLE Table, UINT64 PhysicalAddress, PVOID Context)
+{
+    PTEST_EPT_VIEW_MACHINE Machine = (PTEST_EPT_VIEW_MACHINE)Context;
+
+    for (auto Page = Machine->HookedPages.lower_bound(PhysicalAddress);
+         Page != Machine->HookedPages.end() && Page->first < PhysicalAddress + 512 * PAGE_SIZE;
+         Page++)
+    {
+        Table->Entries[(Page->first >> 12) & 0x1ff] = Page->second.AsUInt;
+    }
+}
+
+/**
+ * @brief Change an entry of the core's EPT (and its expected table)
+ *
+ * @param Machine
+ * @param Entry
+ * @param Value
+ *
+ * @return VOID
+ */
+static VOID
+TestEptViewWriteBase(PTEST_EPT_VIEW_MACHINE Machine, PVOID Entry, UINT64 Value)
+{
+    UINT64 Table = Machine->PhysicalAddresses.at((PVOID)((UINT64)Entry & ~0xfffull));
+
+    *(UINT64 *)Entry = Value;
+
+    Machine->BaseShadow[Table][((UINT64)Entry & 0xfff) / sizeof(UINT64)] = Value;
+}
+
+/**
+ * @brief Add a table of the core's EPT
+ *
+ * @param Machine
+ *
+ * @return PEPT_VIEW_PAGING_TABLE
+ */
+static PEPT_VIEW_PAGING_TABLE
+TestEptViewNewBaseTable(PTEST_EPT_VIEW_MACHINE Machine)
+{
+    PEPT_VIEW_PAGING_TABLE Table = TestEptViewNewTable(Machine);
+
+    Machine->BaseShadow[Machine->PhysicalAddresses[Table]] = std::vector<UINT64>(Table->Entries, Table->Entries + EPT_VIEW_TABLE_ENTRIES_COUNT);
+
+    return Table;
+}
+
+/**
+ * @brief Build the identity-mapped EPT of a core (2MB pages, like
+ * EptAllocateAndCreateIdentityPageTable) and its original view (like
+ * EptViewInitialize)
+ *
+ * @param Machine
+ * @param MaximumViewTables
+ *
+ * @return VOID
+ */
+static VOID
+TestEptViewInitialize(PTEST_EPT_VIEW_MACHINE Machine, UINT32 MaximumViewTables)
+{
+    PEPT_VIEW_PAGING_TABLE PML3;
+    PEPT_VIEW_PAGING_TABLE PML2;
+    EPT_PDPTE              Pointer = {0};
+    EPT_PDE_2MB            Entry   = {0};
+
+    Machine->ViewTables        = 0;
+    Machine->MaximumViewTables = MaximumViewTables;
+
+    PML3              = TestEptViewNewBaseTable(Machine);
+    Machine->BasePml3 = (EPT_PDPTE *)&PML3->Entries[0];
+
+    Pointer.ReadAccess    = 1;
+    Pointer.WriteAccess   = 1;
+    Pointer.ExecuteAccess = 1;
+
+    Entry.ReadAccess    = 1;
+    Entry.WriteAccess   = 1;
+    Entry.ExecuteAccess = 1;
+    Entry.MemoryType    = MEMORY_TYPE_WRITE_BACK;
+    Entry.LargePage     = 1;
+
+    for (UINT64 i = 0; i < EPT_VIEW_TABLE_ENTRIES_COUNT; i++)
+    {
+        PML2 = TestEptViewNewBaseTable(Machine);
+
+        for (UINT64 j = 0; j < EPT_VIEW_TABLE_ENTRIES_COUNT; j++)
+        {
+            Entry.PageFrameNumber = i * EPT_VIEW_TABLE_ENTRIES_COUNT + j;
+            TestEptViewWriteBase(Machine, &PML2->Entries[j], Entry.AsUInt);
+        }
+
+        Pointer.PageFrameNumber = Machine->PhysicalAddresses[PML2] / PAGE_SIZE;
+        TestEptViewWriteBase(Machine, &Machine->BasePml3[i], Pointer.AsUInt);
+    }
+
+    //
+    // The view has its own PML3 that points to the PML2 tables of the core
+    //
+    Machine->ViewPml3 = (EPT_PDPTE *)&TestEptViewNewTable(Machine)->Entries[0];
+
+    memcpy(Machine->ViewPml3, Machine->BasePml3, sizeof(EPT_VIEW_PAGING_TABLE));
+}
+
+/**
+ * @brief Free the synthetic physical memory
+ *
+ * @param Machine
+ *
+ * @return VOID
+ */
+static VOID
+TestEptViewFree(PTEST_EPT_VIEW_MACHINE Machine)
+{
+    for (PEPT_VIEW_PAGING_TABLE Table : Machine->Tables)
+    {
+        delete Table;
+    }
+
+    Machine->Tables.clear();
+    Machine->PhysicalAddresses.clear();
+    Machine->BaseShadow.clear();
+    Machine->HookedPages.clear();
+    Machine->ViewPages.clear();
+    Machine->HookedRegions[0].clear();
+    Machine->HookedRegions[1].clear();
+}
+
+/**
+ * @brief Walk a PML3 like the processor and get the translation of a page
+ * @details the tables are only read through their physical addresses, the
+ * large pages are returned as their 4-KByte part
+ *
+ * @param Machine
+ * @param Pml3
+ * @param PhysicalAddress
+ * @param Translation the translating bits of the (4-KByte) entry
+ *
+ * @return BOOLEAN FALSE if the walk reaches a table that doesn't exist
+ */
+static BOOLEAN
+TestEptViewTranslate(PTEST_EPT_VIEW_MACHINE Machine, EPT_PDPTE * Pml3, UINT64 PhysicalAddress, UINT64 * Translation)
+{
+    EPT_PDPTE     Pointer = Pml3[(PhysicalAddress >> 30) & 0x1ff];
+    EPT_PDE_2MB * PML2;
+    EPT_PDE_2MB   Entry;
+    EPT_PTE *     PML1;
+
+    PML2 = (EPT_PDE_2MB *)TestEptViewPhysicalToTable((UINT64)Pointer.PageFrameNumber * PAGE_SIZE, Machine);
+
+    if (PML2 == NULL || !Pointer.ReadAccess || !Pointer.WriteAccess || !Pointer.ExecuteAccess)
+    {
+        return FALSE;
+    }
+
+    Entry = PML2[(PhysicalAddress >> 21) & 0x1ff];
+
+    if (Entry.LargePage)
+    {
+        *Translation = (Entry.AsUInt & 0x3f) | (((UINT64)Entry.PageFrameNumber * 512 + ((PhysicalAddress >> 12) & 0x1ff)) << 12);
+        return TRUE;
+    }
+
+    PML1 = (EPT_PTE *)TestEptViewPhysicalToTable((UINT64)((EPT_PDE *)&Entry)->PageFrameNumber * PAGE_SIZE, Machine);
+
+    if (PML1 == NULL || !Entry.ReadAccess || !Entry.WriteAccess || !Entry.ExecuteAccess)
+    {
+        return FALSE;
+    }
+
+    *Translation = PML1[(PhysicalAddress >> 12) & 0x1ff].AsUInt & TEST_EPT_VIEW_TRANSLATION_MASK;
+
+    return TRUE;
+}
+
+/**
+ * @brief Get the PML2 entry of a page in the core's EPT
+ *
+ * @param Machine
+ * @param PhysicalAddress
+ *
+ * @return EPT_PDE_2MB *
+ */
+static EPT_PDE_2MB *
+TestEptViewGetBasePml2(PTEST_EPT_VIEW_MACHINE Machine, UINT64 PhysicalAddress)
+{
+    EPT_PDE_2MB * PML2 = (EPT_PDE_2MB *)TestEptViewPhysicalToTable((UINT64)Machine->BasePml3[(PhysicalAddress >> 30) & 0x1ff].PageFrameNumber * PAGE_SIZE, Machine);
+
+    return &PML2[(PhysicalAddress >> 21) & 0x1ff];
+}
+
+/**
+ * @brief Get the PML1 entry of a page in the core's EPT, the 2MB region
+ * of the page is split if it's a large page (like EptSplitLargePage)
+ *
+ * @param Machine
+ * @param PhysicalAddress
+ *
+ * @return EPT_PTE *
+ */
+static EPT_PTE *
+TestEptViewSplitBase(PTEST_EPT_VIEW_MACHINE Machine, UINT64 PhysicalAddress)
+{
+    EPT_PDE_2MB *          PML2 = TestEptViewGetBasePml2(Machine, PhysicalAddress);
+    PEPT_VIEW_PAGING_TABLE PML1;
+    EPT_PTE                Entry   = {0};
+    EPT_PDE                Pointer = {0};
+
+    if (PML2->LargePage)
+    {
+        PML1 = TestEptViewNewBaseTable(Machine);
+
+        Entry.ReadAccess    = PML2->ReadAccess;
+        Entry.WriteAccess   = PML2->WriteAccess;
+        Entry.ExecuteAccess = PML2->ExecuteAccess;
+        Entry.MemoryType    = PML2->MemoryType;
+
+        for (UINT64 i = 0; i < EPT_VIEW_TABLE_ENTRIES_COUNT; i++)
+        {
+            Entry.PageFrameNumber = (UINT64)PML2->PageFrameNumber * EPT_VIEW_TABLE_ENTRIES_COUNT + i;
+            TestEptViewWriteBase(Machine, &PML1->Entries[i], Entry.AsUInt);
+        }
+
+        Pointer.ReadAccess      = 1;
+        Pointer.WriteAccess     = 1;
+        Pointer.ExecuteAccess   = 1;
+        Pointer.PageFrameNumber = Machine->PhysicalAddresses[PML1] / PAGE_SIZE;
+
+        TestEptViewWriteBase(Machine, PML2, Pointer.AsUInt);
+    }
+
+    return (EPT_PTE *)TestEptViewPhysicalToTable((UINT64)((EPT_PDE *)PML2)->PageFrameNumber * PAGE_SIZE, Machine) + ((PhysicalAddress >> 12) & 0x1ff);
+}
+
+/**
+ * @brief Check that the core's EPT is the same as its expected tables
+ *
+ * @param Machine
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestEptViewCheckBase(PTEST_EPT_VIEW_MACHINE Machine)
+{
+    for (const auto & Table : Machine->BaseShadow)
+    {
+        if (memcmp(TestEptViewPhysicalToTable(Table.first, Machine), Table.second.data(), sizeof(EPT_VIEW_PAGING_TABLE)) != 0)
+        {
+            ShowMessages("\t[x] the EPT table at 0x%llx is modified\n", Table.first);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Check whether the PML1 of a page is copied for the view
+ *
+ * @param Machine
+ * @param PhysicalAddress
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestEptViewIsPml1Copied(PTEST_EPT_VIEW_MACHINE Machine, UINT64 PhysicalAddress)
+{
+    EPT_PDE_2MB * PML2 = (EPT_PDE_2MB *)TestEptViewPhysicalToTable((UINT64)Machine->ViewPml3[(PhysicalAddress >> 30) & 0x1ff].PageFrameNumber * PAGE_SIZE, Machine);
+
+    PML2 = &PML2[(PhysicalAddress >> 21) & 0x1ff];
+
+    return !PML2->LargePage && PML2->AsUInt != TestEptViewGetBasePml2(Machine, PhysicalAddress)->AsUInt;
+}
+
+/**
+ * @brief Check the view of a page against the core's EPT
+ * @details the view is the same as the EPT except at the hooked pages,
+ * which have their original entries if they're set in the view or if
+ * their PML1 is copied for the view
+ *
+ * @param Machine
+ * @param PhysicalAddress
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestEptViewCheckPage(PTEST_EPT_VIEW_MACHINE Machine, UINT64 PhysicalAddress)
+{
+    BOOLEAN Result = TRUE;
+    UINT64  ViewTranslation;
+    UINT64  BaseTranslation;
+    UINT64  Original;
+
+    UnitTestExpect(Result, TestEptViewTranslate(Machine, Machine->BasePml3, PhysicalAddress, &BaseTranslation));
+    UnitTestExpect(Result, TestEptViewTranslate(Machine, Machine->ViewPml3, PhysicalAddress, &ViewTranslation));
+
+    if (!Result)
+    {
+        return FALSE;
+    }
+
+    if (Machine->HookedPages.count(PhysicalAddress) == 0)
+    {
+        UnitTestExpect(Result, ViewTranslation == BaseTranslation);
+    }
+    else
+    {
+        Original = Machine->HookedPages[PhysicalAddress].AsUInt & TEST_EPT_VIEW_TRANSLATION_MASK;
+
+        UnitTestExpect(Result, ViewTranslation == Original || (ViewTranslation == BaseTranslation && Machine->ViewPages.count(PhysicalAddress) == 0 && !TestEptViewIsPml1Copied(Machine, PhysicalAddress)));
+    }
+
+    if (!Result)
+    {
+        ShowMessages("\t[x] the view of the page 0x%llx is 0x%llx, the EPT is 0x%llx\n", PhysicalAddress, ViewTranslation, BaseTranslation);
+    }
+
+    return Result;
+}
+
+/**
+ * @brief Check all the pages of the split regions and the sharing of the
+ * tables of the view
+ *
+ * @param Machine
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestEptViewCheckAll(PTEST_EPT_VIEW_MACHINE Machine)
+{
+    BOOLEAN Result = TRUE;
+
+    UnitTestExpect(Result, TestEptViewCheckBase(Machine));
+
+    for (UINT64 i = 0; Result && i < EPT_VIEW_TABLE_ENTRIES_COUNT; i++)
+    {
+        //
+        // The PML2 tables of the regions that are not hooked are shared
+        //
+        if (Machine->HookedRegions[0].count(i) == 0)
+        {
+            UnitTestExpect(Result, Machine->ViewPml3[i].AsUInt == Machine->BasePml3[i].AsUInt);
+            continue;
+        }
+
+        for (UINT64 j = 0; Result && j < EPT_VIEW_TABLE_ENTRIES_COUNT; j++)
+        {
+            if (!TestEptViewGetBasePml2(Machine, (i << 30) | (j << 21))->LargePage)
+            {
+                for (UINT64 k = 0; Result && k < EPT_VIEW_TABLE_ENTRIES_COUNT; k++)
+                {
+                    UnitTestExpect(Result, TestEptViewCheckPage(Machine, (i << 30) | (j << 21) | (k << 12)));
+                }
+            }
+            else
+            {
+                UnitTestExpect(Result, TestEptViewCheckPage(Machine, (i << 30) | (j << 21)));
+            }
+        }
+    }
+
+    //
+    // Only the PML2 of the hooked 1GB regions and the PML1 of the hooked
+    // 2MB regions are copied
+    //
+    if (Machine->MaximumViewTables == 0xffffffff)
+    {
+        UnitTestExpect(Result, Machine->ViewTables == Machine->HookedRegions[0].size() + Machine->HookedRegions[1].size());
+    }
+
+    return Result;
+}
+
+/**
+ * @brief Get the physical address of a random page, most pages are close
+ * to each other and to the boundaries of the regions
+ *
+ * @param RandomState
+ *
+ * @return UINT64
+ */
+static UINT64
+TestEptViewGetRandomPage(UINT64 * RandomState)
+{
+    static const UINT64 Clusters[] = {0x100000, 0x3ff00000, 0x1234500000};
+
+    if (UnitTestGetRandom(RandomState) % 8 == 0)
+    {
+        return (UnitTestGetRandom(RandomState) % (1ull << 39)) & ~0xfffull;
+    }
+
+    return Clusters[UnitTestGetRandom(RandomState) % 3] + (UnitTestGetRandom(RandomState) % 1024) * PAGE_SIZE;
+}
+
+/**
+ * @brief Hook a page (like EptHookCreateHookPage), the page is added to the
+ * hooked pages, set in the view and then changed in the core's EPT
+ *
+ * @param Machine
+ * @param Memory
+ * @param RandomState
+ * @param PhysicalAddress
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestEptViewHook(PTEST_EPT_VIEW_MACHINE Machine, PEPT_VIEW_TABLE_MEMORY Memory, UINT64 * RandomState, UINT64 PhysicalAddress)
+{
+    BOOLEAN   Result = TRUE;
+    EPT_PTE * BaseEntry;
+    EPT_PTE   Changed;
+
+    if (Machine->HookedPages.count(PhysicalAddress) != 0)
+    {
+        return TRUE;
+    }
+
+    BaseEntry = TestEptViewSplitBase(Machine, PhysicalAddress);
+
+    Machine->HookedPages[PhysicalAddress] = *BaseEntry;
+    Machine->HookedRegions[0].insert(PhysicalAddress >> 30);
+    Machine->HookedRegions[1].insert(PhysicalAddress >> 21);
+
+    if (EptViewTableSetEntry(Machine->ViewPml3, Machine->BasePml3, PhysicalAddress, *BaseEntry, Memory))
+    {
+        Machine->ViewPages.insert(PhysicalAddress);
+    }
+    else
+    {
+        //
+        // Only fails if no table is left
+        //
+        UnitTestExpect(Result, Machine->ViewTables == Machine->MaximumViewTables);
+    }
+
+    //
+    // Hidden breakpoints (execute-only), read/write monitors (no access or
+    // not writable) and execution monitors (not executable)
+    //
+    Changed = *BaseEntry;
+
+    switch (UnitTestGetRandom(RandomState) % 3)
+    {
+    case 0:
+        Changed.ReadAccess  = 0;
+        Changed.WriteAccess = 0;
+        break;
+    case 1:
+        Changed.WriteAccess = 0;
+        break;
+    default:
+        Changed.ExecuteAccess = 0;
+        break;
+    }
+
+    TestEptViewWriteBase(Machine, BaseEntry, Changed.AsUInt);
+
+    return Result;
+}
+
+/**
+ * @brief Unhook a page, the core's EPT gets the original entry
+ *
+ * @param Machine
+ * @param PhysicalAddress
+ *
+ * @return VOID
+ */
+static VOID
+TestEptViewUnhook(PTEST_EPT_VIEW_MACHINE Machine, UINT64 PhysicalAddress)
+{
+    TestEptViewWriteBase(Machine, TestEptViewSplitBase(Machine, PhysicalAddress), Machine->HookedPages[PhysicalAddress].AsUInt);
+
+    Machine->HookedPages.erase(PhysicalAddress);
+    Machine->ViewPages.erase(PhysicalAddress);
+}
+
+/**
+ * @brief Check whether a violation of a hooked page is executed on the view
+ * (like EptViewSwitchToOriginalView)
+ *
+ * @param Machine
+ * @param Memory
+ * @param PhysicalAddress
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestEptViewCanSwitch(PTEST_EPT_VIEW_MACHINE Machine, PEPT_VIEW_TABLE_MEMORY Memory, UINT64 PhysicalAddress)
+{
+    EPT_PTE * Entry = EptViewTableGetPml1Entry(Machine->ViewPml3, PhysicalAddress, Memory);
+
+    return Entry != NULL && Entry->AsUInt == Machine->HookedPages[PhysicalAddress].AsUInt;
+}
+
+/**
+ * @brief Get a random hooked page
+ *
+ * @param Machine
+ * @param RandomState
+ *
+ * @return UINT64
+ */
+static UINT64
+TestEptViewGetRandomHookedPage(PTEST_EPT_VIEW_MACHINE Machine, UINT64 * RandomState)
+{
+    auto Page = Machine->HookedPages.lower_bound(TestEptViewGetRandomPage(RandomState));
+
+    return Page == Machine->HookedPages.end() ? Machine->HookedPages.begin()->first : Page->first;
+}
+
+/**
+ * @brief Apply a random sequence of hooks, unhooks, splits and violations
+ * and check the view after each of them
+ *
+ * @param MaximumViewTables
+ * @param Switches the number of the violations that are executed on the view
+ * @param Violations the number of the violations
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestEptViewSequence(UINT32 MaximumViewTables, UINT32 * Switches, UINT32 * Violations)
+{
+    BOOLEAN               Result      = TRUE;
+    UINT64                RandomState = 0x457074566965ull + MaximumViewTables;
+    TEST_EPT_VIEW_MACHINE Machine;
+    EPT_VIEW_TABLE_MEMORY Memory = {TestEptViewAllocateTable, TestEptViewTableToPhysical, TestEptViewPhysicalToTable, TestEptViewRestoreOriginalEntries, &Machine};
+    UINT64                PhysicalAddress;
+    UINT64                Translation;
+    UINT32                Operation;
+
+    *Switches   = 0;
+    *Violations = 0;
+
+    TestEptViewInitialize(&Machine, MaximumViewTables);
+
+    for (UINT32 i = 0; Result && i < TEST_EPT_VIEW_NUMBER_OF_OPERATIONS; i++)
+    {
+        PhysicalAddress = TestEptViewGetRandomPage(&RandomState);
+        Operation       = (UINT32)(UnitTestGetRandom(&RandomState) % 100);
+
+        if (Operation < 40 || Machine.HookedPages.empty())
+        {
+            UnitTestExpect(Result, TestEptViewHook(&Machine, &Memory, &RandomState, PhysicalAddress));
+        }
+        else if (Operation < 60)
+        {
+            PhysicalAddress = TestEptViewGetRandomHookedPage(&Machine, &RandomState);
+
+            TestEptViewUnhook(&Machine, PhysicalAddress);
+        }
+        else if (Operation < 70)
+        {
+            //
+            // Split by others (e.g., monitors or dirty logging)
+            //
+            TestEptViewSplitBase(&Machine, PhysicalAddress);
+        }
+        else
+        {
+            PhysicalAddress = TestEptViewGetRandomHookedPage(&Machine, &RandomState);
+
+            (*Violations)++;
+
+            if (TestEptViewCanSwitch(&Machine, &Memory, PhysicalAddress))
+            {
+                //
+                // The instruction is executed with the original entry
+                //
+                (*Switches)++;
+
+                UnitTestExpect(Result, TestEptViewTranslate(&Machine, Machine.ViewPml3, PhysicalAddress, &Translation));
+                UnitTestExpect(Result, Translation == (Machine.HookedPages[PhysicalAddress].AsUInt & TEST_EPT_VIEW_TRANSLATION_MASK));
+            }
+            else
+            {
+                //
+                // The pages that are set in the view should never fall back
+                //
+                UnitTestExpect(Result, Machine.ViewPages.count(PhysicalAddress) == 0);
+            }
+        }
+
+        UnitTestExpect(Result, TestEptViewCheckPage(&Machine, PhysicalAddress));
+        UnitTestExpect(Result, TestEptViewCheckPage(&Machine, PhysicalAddress ^ PAGE_SIZE));
+
+        //
+        // The pools are replenished from time to time
+        //
+        if (MaximumViewTables != 0xffffffff && i % 1000 == 999)
+        {
+            Machine.MaximumViewTables += 2;
+        }
+
+        if (i % TEST_EPT_VIEW_CHECKPOINT_INTERVAL == TEST_EPT_VIEW_CHECKPOINT_INTERVAL - 1)
+        {
+            UnitTestExpect(Result, TestEptViewCheckAll(&Machine));
+        }
+
+        if (!Result)
+        {
+            ShowMessages("\t[x] the view differs after the operation %d (%d) on 0x%llx\n", i, Operation, PhysicalAddress);
+        }
+    }
+
+    TestEptViewFree(&Machine);
+
+    return Result;
+}
+
+/**
+ * @brief Test setting the pages that can't be set in the view
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestEptViewUnsplitPages()
+{
+    BOOLEAN               Result = TRUE;
+    TEST_EPT_VIEW_MACHINE Machine;
+    EPT_VIEW_TABLE_MEMORY Memory = {TestEptViewAllocateTable, TestEptViewTableToPhysical, TestEptViewPhysicalToTable, TestEptViewRestoreOriginalEntries, &Machine};
+    EPT_PTE               Entry  = {0};
+    BOOLEAN               IsLargePage;
+
+    TestEptViewInitialize(&Machine, 0xffffffff);
+
+    //
+    // The pages of the large pages (not split) and above 512GB
+    //
+    UnitTestExpect(Result, !EptViewTableSetEntry(Machine.ViewPml3, Machine.BasePml3, 0x40201000, Entry, &Memory));
+    UnitTestExpect(Result, !EptViewTableSetEntry(Machine.ViewPml3, Machine.BasePml3, 0x8000000000, Entry, &Memory));
+    UnitTestExpect(Result, Machine.ViewTables == 0);
+
+    UnitTestExpect(Result, EptViewTableGetPml1Entry(Machine.ViewPml3, 0x40201000, &Memory) == NULL);
+    UnitTestExpect(Result, EptViewTableGetPml1OrPml2Entry(Machine.ViewPml3, 0x40201000, &IsLargePage, &Memory) != NULL && IsLargePage);
+    UnitTestExpect(Result, EptViewTableGetPml1OrPml2Entry(Machine.ViewPml3, 0x8000000000, &IsLargePage, &Memory) == NULL);
+    UnitTestExpect(Result, TestEptViewCheckAll(&Machine));
+
+    TestEptViewFree(&Machine);
+
+    return Result;
+}
+
+/**
+ * @brief Tests of the paging tables of the EPT views
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+TestEptView()
+{
+    BOOLEAN Result = TRUE;
+    UINT32  Switches;
+    UINT32  Violations;
+
+    UnitTestExpect(Result, TestEptViewUnsplitPages());
+
+    //
+    // Enough tables for all the hooks
+    //
+    UnitTestExpect(Result, TestEptViewSequence(0xffffffff, &Switches, &Violations));
+    UnitTestExpect(Result, Switches == Violations);
+
+    //
+    // The pools are exhausted, the hooks fall back to changing the entries
+    //
+    UnitTestExpect(Result, TestEptViewSequence(6, &Switches, &Violations));
+    UnitTestExpect(Result, Switches < Violations);
+
+    return Result;
+}
+
+/**
+ * @brief Benchmark of the paging tables of the EPT views
+ * @details setting the hooked pages in the view and checking the view for
+ * each violation, and the number of the invalidations (INVEPT) of the
+ * violations on the view and with changing the entries
+ *
+ * @return VOID
+ */
+VOID
+BenchmarkEptView()
+{
+    UINT64                RandomState = 0x45707442656eull;
+    TEST_EPT_VIEW_MACHINE Machine;
+    EPT_VIEW_TABLE_MEMORY Memory = {TestEptViewAllocateTable, TestEptViewTableToPhysical, TestEptViewPhysicalToTable, TestEptViewRestoreOriginalEntries, &Machine};
+    std::vector<UINT64>   Pages;
+    UINT64                StartTime;
+    UINT64                ElapsedTime       = 0;
+    UINT64                FlipInvalidations = 0;
+    UINT64                ViewInvalidations = 0;
+    UINT32                Switches          = 0;
+    BOOLEAN               IsModified        = FALSE;
+    UINT64                PhysicalAddress;
+
+    TestEptViewInitialize(&Machine, 0xffffffff);
+
+    for (UINT32 i = 0; i < 2000; i++)
+    {
+        Pages.push_back(TestEptViewGetRandomPage(&RandomState));
+        TestEptViewSplitBase(&Machine, Pages.back());
+    }
+
+    StartTime = UnitTestGetTimeInNanoseconds();
+
+    for (UINT64 Page : Pages)
+    {
+        Machine.HookedPages[Page] = *TestEptViewSplitBase(&Machine, Page);
+        EptViewTableSetEntry(Machine.ViewPml3, Machine.BasePml3, Page, Machine.HookedPages[Page], &Memory);
+    }
+
+    UnitTestShowBenchmarkResult("set a hooked page in the view", UnitTestGetTimeInNanoseconds() - StartTime, Pages.size());
+
+    ShowMessages("\t%d tables are copied for %d hooked pages\n", Machine.ViewTables, (UINT32)Machine.HookedPages.size());
+
+    //
+    // A violation on a random hooked page, and a new hook every 1000 violations
+    //
+    for (UINT32 i = 0; i < TEST_EPT_VIEW_NUMBER_OF_VIOLATIONS; i++)
+    {
+        if (i % 1000 == 999)
+        {
+            PhysicalAddress = TestEptViewGetRandomPage(&RandomState);
+
+            TestEptViewHook(&Machine, &Memory, &RandomState, PhysicalAddress);
+            IsModified = TRUE;
+        }
+
+        PhysicalAddress = TestEptViewGetRandomHookedPage(&Machine, &RandomState);
+
+        StartTime = UnitTestGetTimeInNanoseconds();
+
+        if (TestEptViewCanSwitch(&Machine, &Memory, PhysicalAddress))
+        {
+            Switches++;
+        }
+
+        ElapsedTime += UnitTestGetTimeInNanoseconds() - StartTime;
+
+        //
+        // The entry is restored and changed again, while the view is only
+        // invalidated on the first switch after it is modified
+        //
+        FlipInvalidations += 2;
+        ViewInvalidations += IsModified ? 1 : 0;
+        IsModified = FALSE;
+    }
+
+    UnitTestShowBenchmarkResult("check the view of a violation", ElapsedTime, TEST_EPT_VIEW_NUMBER_OF_VIOLATIONS);
+
+    ShowMessages("\t%d violations on the view, INVEPTs: %lld (changing the entries), %lld (views)\n",
+                 Switches,
+                 FlipInvalidations,
+                 ViewInvalidations);
+
+    TestEptViewFree(&Machine);
+}
+
+UnitTestRegister("ept-view", TestEptView, BenchmarkEptView);
@@ -0,0 +1,571 @@
+/**
+ * @file test-event-throttle.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Tests and benchmark of the sampling and rate limiting of the events
+ * @details the decisions (Throttle.c) are shared with hyperkd, the hits are
+ * simulated on a clock with the frequency of a time stamp counter, and the
+ * shared counters are also updated by several threads at the same time
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Frequency of the simulated time stamp counter
+ *
+ */
+#define TEST_EVENT_THROTTLE_TSC_FREQUENCY 3000000000ull
+
+/**
+ * @brief The time stamp counter at the start of the simulations
+ *
+ */
+#define TEST_EVENT_THROTTLE_START_TIME 1000000000000ull
+
+/**
+ * @brief Number of the emission intervals of each simulation
+ *
+ */
+#define TEST_EVENT_THROTTLE_NUMBER_OF_INTERVALS 2000
+
+/**
+ * @brief Number of the hits of the sampling tests
+ *
+ */
+#define TEST_EVENT_THROTTLE_NUMBER_OF_HITS 1000000
+
+/**
+ * @brief Number of the threads (cores) that hit the same event
+ *
+ */
+#define TEST_EVENT_THROTTLE_NUMBER_OF_THREADS 4
+
+/**
+ * @brief Number of the hits of each thread
+ *
+ */
+#define TEST_EVENT_THROTTLE_HITS_PER_THREAD 100000
+
+/**
+ * @brief The state of an event that is shared between the threads
+ *
+ */
+typedef struct _TEST_EVENT_THROTTLE_SHARED
+{
+    DEBUGGER_EVENT_THROTTLE_OPTIONS Options;
+    volatile LONG64                 NumberOfHits;
+    THROTTLE_RATE                   Rate;
+    UINT64                          Now;    // zero if the sampling is tested
+    volatile LONG64                 Passed; // the hits that are not suppressed
+
+} TEST_EVENT_THROTTLE_SHARED, *PTEST_EVENT_THROTTLE_SHARED;
+
+/**
+ * @brief The state of the event of the threads
+ *
+ */
+static TEST_EVENT_THROTTLE_SHARED TestEventThrottleShared;
+
+/**
+ * @brief The result of a simulation of the rate limiting
+ *
+ */
+typedef struct _TEST_EVENT_THROTTLE_RESULT
+{
+    UINT64  NumberOfHits;
+    UINT64  NumberOfPassedHits;
+    BOOLEAN IsWithinRate;   // no window of the passed hits exceeds the rate and the burst
+    BOOLEAN IsRearmCorrect; // the suppressed hits report the time of the next conforming hit
+
+} TEST_EVENT_THROTTLE_RESULT, *PTEST_EVENT_THROTTLE_RESULT;
+
+/**
+ * @brief Simulate the hits of an event with a rate limit
+ * @details the gaps between the hits are uniformly distributed, the n-th
+ * passed hit should not be earlier than (n - m - BurstSize + 1) emission
+ * intervals after the m-th passed hit
+ *
+ * @param Rate
+ * @param BurstSize
+ * @param MinimumGap
+ * @param MaximumGap
+ * @param RandomState
+ * @param Result
+ *
+ * @return VOID
+ */
+static VOID
+TestEventThrottleSimulate(PTHROTTLE_RATE              Rate,
+                          UINT32                      BurstSize,
+                          UINT64                      MinimumGap,
+                          UINT64                      MaximumGap,
+                          UINT64 *                    RandomState,
+                          PTEST_EVENT_THROTTLE_RESULT Result)
+{
+    UINT64        Now      = TEST_EVENT_THROTTLE_START_TIME;
+    UINT64        EndTime  = TEST_EVENT_THROTTLE_START_TIME + TEST_EVENT_THROTTLE_NUMBER_OF_INTERVALS * Rate->EmissionInterval;
+    INT64         MaximumQ = 0;
+    INT64         Q;
+    UINT64        RearmTime;
+    UINT64        Unused;
+    THROTTLE_RATE Copy;
+
+    Result->NumberOfHits       = 0;
+    Result->NumberOfPassedHits = 0;
+    Result->IsWithinRate       = TRUE;
+    Result->IsRearmCorrect     = TRUE;
+
+    while (Now < EndTime)
+    {
+        Result->NumberOfHits++;
+
+        if (ThrottleConsumeRateBudget(Rate, Now, &RearmTime))
+        {
+            //
+            // The running maximum of (time - n * interval) of the passed hits
+            //
+            Q = (INT64)(Now - TEST_EVENT_THROTTLE_START_TIME) - (INT64)(Result->NumberOfPassedHits * Rate->EmissionInterval);
+
+            if (Result->NumberOfPassedHits != 0 && Q < MaximumQ - (INT64)((BurstSize - 1) * Rate->EmissionInterval))
+            {
+                Result->IsWithinRate = FALSE;
+            }
+
+            if (Result->NumberOfPassedHits == 0 || Q > MaximumQ)
+            {
+                MaximumQ = Q;
+            }
+
+            Result->NumberOfPassedHits++;
+        }
+        else if (Result->NumberOfHits % 64 == 0)
+        {
+            //
+            // The hit that is just before the re-arming time is still suppressed
+            //
+            Copy = *Rate;
+
+            if (RearmTime <= Now ||
+                ThrottleConsumeRateBudget(&Copy, RearmTime - 1, &Unused) ||
+                !ThrottleConsumeRateBudget(&Copy, RearmTime, &Unused))
+            {
+                Result->IsRearmCorrect = FALSE;
+            }
+        }
+
+        Now += MinimumGap;
+
+        if (MaximumGap > MinimumGap)
+        {
+            Now += UnitTestGetRandom(RandomState) % (MaximumGap - MinimumGap + 1);
+        }
+    }
+}
+
+/**
+ * @brief Check whether the number is close to the expected number
+ *
+ * @param Value
+ * @param Expected
+ * @param Tolerance
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestEventThrottleIsClose(UINT64 Value, UINT64 Expected, UINT64 Tolerance)
+{
+    return Value + Tolerance >= Expected && Value <= Expected + Tolerance;
+}
+
+/**
+ * @brief Test the accuracy of the rate limiting
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestEventThrottleRate()
+{
+    BOOLEAN                    Result      = TRUE;
+    UINT64                     RandomState = 0x5468726f74746c65ull;
+    THROTTLE_RATE              Rate;
+    TEST_EVENT_THROTTLE_RESULT Outcome;
+    UINT64                     Expected;
+    UINT64                     RearmTime;
+    UINT64                     Interval;
+
+    const struct
+    {
+        UINT32 MaximumHitsPerSecond;
+        UINT32 BurstSize;
+
+    } Limits[] = {
+        {1, 0},
+        {100, 1},
+        {100, 16},
+        {10000, 1},
+        {10000, 64},
+        {1000000, 8},
+    };
+
+    for (auto & Limit : Limits)
+    {
+        UINT32 BurstSize = Limit.BurstSize != 0 ? Limit.BurstSize : 1;
+
+        ThrottleSetRate(&Rate, TEST_EVENT_THROTTLE_TSC_FREQUENCY, Limit.MaximumHitsPerSecond, Limit.BurstSize);
+
+        Interval = Rate.EmissionInterval;
+        Expected = TEST_EVENT_THROTTLE_NUMBER_OF_INTERVALS + BurstSize - 1;
+
+        UnitTestExpect(Result, Interval == TEST_EVENT_THROTTLE_TSC_FREQUENCY / Limit.MaximumHitsPerSecond);
+        UnitTestExpect(Result, Rate.BurstTolerance == (BurstSize - 1) * Interval);
+
+        //
+        // Exactly the burst is allowed back-to-back from an idle state
+        //
+        for (UINT32 i = 0; i < BurstSize; i++)
+        {
+            UnitTestExpect(Result, ThrottleConsumeRateBudget(&Rate, TEST_EVENT_THROTTLE_START_TIME, &RearmTime));
+        }
+
+        UnitTestExpect(Result, !ThrottleConsumeRateBudget(&Rate, TEST_EVENT_THROTTLE_START_TIME, &RearmTime));
+        UnitTestExpect(Result, RearmTime == TEST_EVENT_THROTTLE_START_TIME + Interval);
+
+        //
+        // Periodic hits at four times the rate
+        //
+        ThrottleSetRate(&Rate, TEST_EVENT_THROTTLE_TSC_FREQUENCY, Limit.MaximumHitsPerSecond, Limit.BurstSize);
+        TestEventThrottleSimulate(&Rate, BurstSize, Interval / 4, Interval / 4, &RandomState, &Outcome);
+
+        UnitTestExpect(Result, Outcome.IsWithinRate && Outcome.IsRearmCorrect);
+        UnitTestExpect(Result, TestEventThrottleIsClose(Outcome.NumberOfPassedHits, Expected, 1));
+
+        //
+        // Random hits at eight times the rate (on average), the burst absorbs
+        // the gaps unless the burst size is one
+        //
+        ThrottleSetRate(&Rate, TEST_EVENT_THROTTLE_TSC_FREQUENCY, Limit.MaximumHitsPerSecond, Limit.BurstSize);
+        TestEventThrottleSimulate(&Rate, BurstSize, 0, Interval / 4, &RandomState, &Outcome);
+
+        UnitTestExpect(Result, Outcome.IsWithinRate && Outcome.IsRearmCorrect);
+        UnitTestExpect(Result, Outcome.NumberOfPassedHits <= Expected + 1);
+
+        if (BurstSize == 1)
+        {
+            UnitTestExpect(Result, Outcome.NumberOfPassedHits * 4 >= Expected * 3);
+        }
+        else
+        {
+            UnitTestExpect(Result, TestEventThrottleIsClose(Outcome.NumberOfPassedHits, Expected, 1));
+        }
+
+        //
+        // Nothing is suppressed below the rate
+        //
+        ThrottleSetRate(&Rate, TEST_EVENT_THROTTLE_TSC_FREQUENCY, Limit.MaximumHitsPerSecond, Limit.BurstSize);
+        TestEventThrottleSimulate(&Rate, BurstSize, Interval, Interval * 3, &RandomState, &Outcome);
+
+        UnitTestExpect(Result, Outcome.NumberOfPassedHits == Outcome.NumberOfHits);
+
+        if (!Result)
+        {
+            ShowMessages("\t[x] unexpected rate limiting of %d hits per second (burst of %d)\n", Limit.MaximumHitsPerSecond, Limit.BurstSize);
+            break;
+        }
+    }
+
+    //
+    // The rates above the frequency are limited to a hit per tick
+    //
+    ThrottleSetRate(&Rate, 10, 1000, 1);
+
+    UnitTestExpect(Result, Rate.EmissionInterval == 1 && Rate.BurstTolerance == 0);
+
+    return Result;
+}
+
+/**
+ * @brief Test the accuracy of the sampling
+ * @details the number of the sampled hits of the probabilities should be
+ * within six standard deviations of the expected number
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestEventThrottleSampling()
+{
+    BOOLEAN                         Result       = TRUE;
+    UINT64                          RandomState  = 0x53616d706c696e67ull;
+    DEBUGGER_EVENT_THROTTLE_OPTIONS Options      = {0};
+    volatile LONG64                 NumberOfHits = 0;
+    UINT64                          Sampled;
+    UINT64                          Trials;
+    double                          Mean;
+    double                          Variance;
+    double                          Probability;
+
+    //
+    // No sampling
+    //
+    UnitTestExpect(Result, !ThrottleIsEnabled(&Options));
+
+    Options.SampleEveryNthHit = 1;
+    Options.SampleProbability = DEBUGGER_EVENT_THROTTLE_PROBABILITY_SCALE;
+
+    UnitTestExpect(Result, !ThrottleIsEnabled(&Options));
+
+    for (UINT32 i = 0; i < 1000; i++)
+    {
+        UnitTestExpect(Result, !ThrottleIsSampledOut(&Options, &NumberOfHits, &RandomState));
+    }
+
+    Options.MaximumHitsPerSecond = 1;
+
+    UnitTestExpect(Result, ThrottleIsEnabled(&Options));
+
+    //
+    // The first hit and then every N-th hit
+    //
+    const UINT32 Intervals[] = {2, 3, 10, 1000};
+
+    for (UINT32 Interval : Intervals)
+    {
+        RtlZeroMemory(&Options, sizeof(Options));
+
+        Options.SampleEveryNthHit = Interval;
+        NumberOfHits              = 0;
+        Sampled                   = 0;
+
+        UnitTestExpect(Result, ThrottleIsEnabled(&Options));
+
+        for (UINT32 i = 0; i < TEST_EVENT_THROTTLE_NUMBER_OF_HITS; i++)
+        {
+            if (!ThrottleIsSampledOut(&Options, &NumberOfHits, &RandomState))
+            {
+                UnitTestExpect(Result, i % Interval == 0);
+                Sampled++;
+            }
+        }
+
+        UnitTestExpect(Result, Sampled == (TEST_EVENT_THROTTLE_NUMBER_OF_HITS + Interval - 1) / Interval);
+    }
+
+    //
+    // The probabilities (and the probability of the 1-in-4 sampled hits)
+    //
+    const struct
+    {
+        UINT32 SampleEveryNthHit;
+        UINT32 SampleProbability;
+
+    } Probabilities[] = {
+        {0, 1},
+        {0, 100},
+        {0, 2500},
+        {0, 5000},
+        {0, 9999},
+        {4, 5000},
+    };
+
+    for (auto & Item : Probabilities)
+    {
+        RtlZeroMemory(&Options, sizeof(Options));
+
+        Options.SampleEveryNthHit = Item.SampleEveryNthHit;
+        Options.SampleProbability = Item.SampleProbability;
+        NumberOfHits              = 0;
+        Sampled                   = 0;
+
+        for (UINT32 i = 0; i < TEST_EVENT_THROTTLE_NUMBER_OF_HITS; i++)
+        {
+            if (!ThrottleIsSampledOut(&Options, &NumberOfHits, &RandomState))
+            {
+                Sampled++;
+            }
+        }
+
+        Trials      = Item.SampleEveryNthHit > 1 ? TEST_EVENT_THROTTLE_NUMBER_OF_HITS / Item.SampleEveryNthHit : TEST_EVENT_THROTTLE_NUMBER_OF_HITS;
+        Probability = (double)Item.SampleProbability / DEBUGGER_EVENT_THROTTLE_PROBABILITY_SCALE;
+        Mean        = Trials * Probability;
+        Variance    = Trials * Probability * (1.0 - Probability);
+
+        if ((Sampled - Mean) * (Sampled - Mean) > 36.0 * Variance)
+        {
+            ShowMessages("\t[x] %lld hits are sampled with the probability of %d (expected %.0f)\n", Sampled, Item.SampleProbability, Mean);
+            Result = FALSE;
+        }
+    }
+
+    return Result;
+}
+
+/**
+ * @brief A core that hits the shared event
+ *
+ * @param Param Index of the thread
+ *
+ * @return DWORD
+ */
+static DWORD WINAPI
+TestEventThrottleCoreThread(LPVOID Param)
+{
+    UINT64 RandomState = ((UINT64)Param + 1) * 0x9E3779B97F4A7C15ull;
+    UINT64 RearmTime;
+
+    for (UINT32 i = 0; i < TEST_EVENT_THROTTLE_HITS_PER_THREAD; i++)
+    {
+        if (TestEventThrottleShared.Now == 0)
+        {
+            if (!ThrottleIsSampledOut(&TestEventThrottleShared.Options, &TestEventThrottleShared.NumberOfHits, &RandomState))
+            {
+                InterlockedIncrement64(&TestEventThrottleShared.Passed);
+            }
+        }
+        else if (ThrottleConsumeRateBudget(&TestEventThrottleShared.Rate, TestEventThrottleShared.Now, &RearmTime))
+        {
+            InterlockedIncrement64(&TestEventThrottleShared.Passed);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Hit the shared event from all threads
+ *
+ * @return UINT64 The number of the hits that are not suppressed
+ */
+static UINT64
+TestEventThrottleRunThreads()
+{
+    HANDLE Threads[TEST_EVENT_THROTTLE_NUMBER_OF_THREADS];
+
+    TestEventThrottleShared.Passed = 0;
+
+    for (UINT64 i = 0; i < TEST_EVENT_THROTTLE_NUMBER_OF_THREADS; i++)
+    {
+        Threads[i] = CreateThread(NULL, 0, TestEventThrottleCoreThread, (LPVOID)i, 0, NULL);
+    }
+
+    WaitForMultipleObjects(TEST_EVENT_THROTTLE_NUMBER_OF_THREADS, Threads, TRUE, INFINITE);
+
+    for (UINT32 i = 0; i < TEST_EVENT_THROTTLE_NUMBER_OF_THREADS; i++)
+    {
+        CloseHandle(Threads[i]);
+    }
+
+    return (UINT64)TestEventThrottleShared.Passed;
+}
+
+/**
+ * @brief Test the counters that are shared between the cores
+ * @details the 1-in-N counter and the compare-exchange of the rate budget
+ * should not lose any hit
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestEventThrottleCores()
+{
+    BOOLEAN      Result = TRUE;
+    const UINT64 Total  = TEST_EVENT_THROTTLE_NUMBER_OF_THREADS * TEST_EVENT_THROTTLE_HITS_PER_THREAD;
+
+    RtlZeroMemory(&TestEventThrottleShared, sizeof(TestEventThrottleShared));
+
+    TestEventThrottleShared.Options.SampleEveryNthHit = 7;
+
+    UnitTestExpect(Result, TestEventThrottleRunThreads() == (Total + 6) / 7);
+    UnitTestExpect(Result, (UINT64)TestEventThrottleShared.NumberOfHits == Total);
+
+    //
+    // All of the cores hit at the same time, the burst is half of the hits
+    // so the cores compete for the budget during the whole test
+    //
+    RtlZeroMemory(&TestEventThrottleShared, sizeof(TestEventThrottleShared));
+
+    ThrottleSetRate(&TestEventThrottleShared.Rate, TEST_EVENT_THROTTLE_TSC_FREQUENCY, 1, (UINT32)(Total / 2));
+
+    TestEventThrottleShared.Now = TEST_EVENT_THROTTLE_START_TIME;
+
+    UnitTestExpect(Result, TestEventThrottleRunThreads() == Total / 2);
+
+    return Result;
+}
+
+/**
+ * @brief Tests of the sampling and rate limiting of the events
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+TestEventThrottle()
+{
+    BOOLEAN Result = TRUE;
+
+    UnitTestExpect(Result, TestEventThrottleSampling());
+    UnitTestExpect(Result, TestEventThrottleRate());
+    UnitTestExpect(Result, TestEventThrottleCores());
+
+    return Result;
+}
+
+/**
+ * @brief Benchmark of the sampling and rate limiting of the events
+ * @details the cost of a hit that is checked by the throttling options
+ * (before the conditions and actions of the event)
+ *
+ * @return VOID
+ */
+VOID
+BenchmarkEventThrottle()
+{
+    DEBUGGER_EVENT_THROTTLE_OPTIONS Options      = {0};
+    THROTTLE_RATE                   Rate;
+    volatile LONG64                 NumberOfHits = 0;
+    UINT64                          RandomState  = 0x42656e6368ull;
+    UINT64                          StartTime;
+    UINT64                          RearmTime;
+    UINT64                          Passed;
+
+    Options.SampleEveryNthHit = 100;
+    Passed                    = 0;
+    StartTime                 = UnitTestGetTimeInNanoseconds();
+
+    for (UINT32 i = 0; i < TEST_EVENT_THROTTLE_NUMBER_OF_HITS; i++)
+    {
+        Passed += !ThrottleIsSampledOut(&Options, &NumberOfHits, &RandomState);
+    }
+
+    UnitTestShowBenchmarkResult("sampling (1-in-100)", UnitTestGetTimeInNanoseconds() - StartTime, TEST_EVENT_THROTTLE_NUMBER_OF_HITS);
+
+    Options.SampleEveryNthHit = 0;
+    Options.SampleProbability = DEBUGGER_EVENT_THROTTLE_PROBABILITY_SCALE / 100;
+    StartTime                 = UnitTestGetTimeInNanoseconds();
+
+    for (UINT32 i = 0; i < TEST_EVENT_THROTTLE_NUMBER_OF_HITS; i++)
+    {
+        Passed += !ThrottleIsSampledOut(&Options, &NumberOfHits, &RandomState);
+    }
+
+    UnitTestShowBenchmarkResult("sampling (1% probability)", UnitTestGetTimeInNanoseconds() - StartTime, TEST_EVENT_THROTTLE_NUMBER_OF_HITS);
+
+    //
+    // A hit every 100 ticks with a rate of 1000 hits per second
+    //
+    ThrottleSetRate(&Rate, TEST_EVENT_THROTTLE_TSC_FREQUENCY, 1000, 16);
+
+    StartTime = UnitTestGetTimeInNanoseconds();
+
+    for (UINT32 i = 0; i < TEST_EVENT_THROTTLE_NUMBER_OF_HITS; i++)
+    {
+        Passed += ThrottleConsumeRateBudget(&Rate, TEST_EVENT_THROTTLE_START_TIME + i * 100ull, &RearmTime);
+    }
+
+    UnitTestShowBenchmarkResult("rate limiting (1000 hits per second)", UnitTestGetTimeInNanoseconds() - StartTime, TEST_EVENT_THROTTLE_NUMBER_OF_HITS);
+
+    ShowMessages("\t%lld hits are not suppressed\n", Passed);
+}
+
+UnitTestRegister("event-throttle", TestEventThrottle, BenchmarkEventThrottle);
@@ -0,0 +1,315 @@
+/**
+ * @file test-hex-dump.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Golden-output tests and benchmark of the hex dumps
+ * @details the expected outputs are the outputs of the d* commands and the
+ * '!pe' command before the dumps were rendered line by line
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Size of the buffer of the benchmark
+ *
+ */
+#define TEST_HEX_DUMP_BENCHMARK_SIZE (1024 * 1024)
+
+/**
+ * @brief Address of the dumps of the d* commands
+ *
+ */
+#define TEST_HEX_DUMP_ADDRESS 0xfffff80000001000
+
+/**
+ * @brief A dump of the d* commands and its expected output
+ *
+ */
+typedef struct _TEST_HEX_DUMP_CASE
+{
+    UINT32       ElementSize;
+    BOOLEAN      ShowAscii;
+    BOOLEAN      PhysicalPrefix;
+    UINT32       Size;
+    UINT32       ValidLength;
+    const CHAR * Expected;
+
+} TEST_HEX_DUMP_CASE, *PTEST_HEX_DUMP_CASE;
+
+/**
+ * @brief A dump of the sections of '!pe' and its expected output
+ *
+ */
+typedef struct _TEST_HEX_DUMP_SECTION_CASE
+{
+    UINT32       Size;
+    UINT32       Address;
+    const CHAR * Expected;
+
+} TEST_HEX_DUMP_SECTION_CASE, *PTEST_HEX_DUMP_SECTION_CASE;
+
+/**
+ * @brief Dumps of the d* commands (db, dc, dd and dq)
+ * @details the last two dumps have unavailable bytes, they're shown as '.'
+ * in the characters column (instead of the bytes after the read data)
+ *
+ */
+static const TEST_HEX_DUMP_CASE TestHexDumpCases[] = {
+    {1, TRUE, FALSE, 32, 32, "fffff800`00001000  3B 00 41 7F 9F A0 FF 7A 23 40 5D 7A 97 B4 D1 EE  ;.A....z#@]z....\n"
+                             "fffff800`00001010  0B 28 45 62 7F 9C B9 D6 F3 10 2D 4A 67 84 A1 BE  .(Eb......-Jg...\n"},
+    {4, TRUE, TRUE, 16, 16, "#\tfffff800`00001000  7F41003B 7AFFA09F 7A5D4023 EED1B497  ;.A....z#@]z....\n"},
+    {4, FALSE, FALSE, 16, 16, "fffff800`00001000  7F41003B 7AFFA09F 7A5D4023 EED1B497 \n"},
+    {8, FALSE, FALSE, 16, 16, "fffff800`00001000  7AFFA09F`7F41003B EED1B497`7A5D4023 \n"},
+    {1, TRUE, FALSE, 32, 20, "fffff800`00001000  3B 00 41 7F 9F A0 FF 7A 23 40 5D 7A 97 B4 D1 EE  ;.A....z#@]z....\n"
+                             "fffff800`00001010  0B 28 45 62 ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ??  .(Eb............\n"},
+    {8, FALSE, FALSE, 16, 8, "fffff800`00001000  7AFFA09F`7F41003B ????????`???????? \n"},
+};
+
+/**
+ * @brief Dumps of the sections of '!pe'
+ *
+ */
+static const TEST_HEX_DUMP_SECTION_CASE TestHexDumpSectionCases[] = {
+    {20, 0x1000, "\n"
+                 "\n"
+                 "1000: |3b 00 41 7f | 9f a0 ff 7a | 23 40 5d 7a | 97 b4 d1 ee  ;.A..\xa0\xffz#@]z.\xb4\xd1\xee\n"
+                 "1010: | 0b 28 45 62 |                                   .(Eb\n"},
+    {32, 0x2000, "\n"
+                 "\n"
+                 "2000: |3b 00 41 7f | 9f a0 ff 7a | 23 40 5d 7a | 97 b4 d1 ee  ;.A..\xa0\xffz#@]z.\xb4\xd1\xee\n"
+                 "2010: | 0b 28 45 62 | 7f 9c b9 d6 | f3 10 2d 4a | 67 84 a1 be  .(Eb..\xb9\xd6\xf3.-Jg.\xa1\xbe\n"
+                 "|                                               \n"},
+    {31, 0x30, "\n"
+               "\n"
+               "30: |3b 00 41 7f | 9f a0 ff 7a | 23 40 5d 7a | 97 b4 d1 ee  ;.A..\xa0\xffz#@]z.\xb4\xd1\xee\n"
+               "40: | 0b 28 45 62 | 7f 9c b9 d6 | f3 10 2d 4a | 67 84 a1 "},
+    {20, 0xfffffff8, "\n"
+                     "\n"
+                     "fffffff8: |3b 00 41 7f | 9f a0 ff 7a | 23 40 5d 7a | 97 b4 d1 ee  ;.A..\xa0\xffz#@]z.\xb4\xd1\xee\n"
+                     "8: | 0b 28 45 62 |                                   .(Eb\n"},
+    {0, 0x400, "\n"
+               "\n"
+               "400: |                                              \n"},
+};
+
+/**
+ * @brief The captured messages
+ *
+ */
+static std::string TestHexDumpOutput;
+
+/**
+ * @brief Capture the messages (instead of showing them)
+ *
+ * @param Text
+ *
+ * @return int
+ */
+static int
+TestHexDumpCaptureMessage(const char * Text)
+{
+    TestHexDumpOutput += Text;
+    return 0;
+}
+
+/**
+ * @brief Drop the messages of the benchmark
+ *
+ * @param Text
+ *
+ * @return int
+ */
+static int
+TestHexDumpDropMessage(const char * Text)
+{
+    UNREFERENCED_PARAMETER(Text);
+    return 0;
+}
+
+/**
+ * @brief Fill the buffer of the tests
+ *
+ * @param Buffer
+ *
+ * @return VOID
+ */
+static VOID
+TestHexDumpFillBuffer(UCHAR * Buffer)
+{
+    for (UINT32 i = 0; i < 40; i++)
+    {
+        Buffer[i] = (UCHAR)(i * 0x1d + 0x3b);
+    }
+
+    //
+    // Control, printable and non-ASCII characters
+    //
+    Buffer[1] = 0x00;
+    Buffer[2] = 'A';
+    Buffer[3] = 0x7f;
+    Buffer[4] = 0x9f;
+    Buffer[5] = 0xa0;
+    Buffer[6] = 0xff;
+    Buffer[7] = 'z';
+}
+
+/**
+ * @brief Format an address in the form of the d* commands (e.g., 00000000`00401000)
+ *
+ * @param Address
+ *
+ * @return std::string
+ */
+static std::string
+TestHexDumpFormatAddress(UINT64 Address)
+{
+    CHAR Text[20] = {0};
+
+    sprintf_s(Text, sizeof(Text), "%08llx`%08llx", Address >> 32, Address & 0xffffffff);
+
+    return Text;
+}
+
+/**
+ * @brief The old form of the db command (one message for each part)
+ *
+ * @param Buffer
+ * @param Size
+ * @param Address
+ *
+ * @return VOID
+ */
+static VOID
+TestHexDumpShowBytesOneByOne(const UCHAR * Buffer, UINT32 Size, UINT64 Address)
+{
+    for (UINT32 i = 0; i < Size; i += 16)
+    {
+        ShowMessages("%s  ", TestHexDumpFormatAddress(Address + i).c_str());
+
+        for (size_t j = 0; j < 16; j++)
+        {
+            ShowMessages("%02X ", Buffer[i + j]);
+        }
+
+        ShowMessages(" ");
+
+        for (size_t j = 0; j < 16; j++)
+        {
+            if (isprint(Buffer[i + j]))
+            {
+                ShowMessages("%c", Buffer[i + j]);
+            }
+            else
+            {
+                ShowMessages(".");
+            }
+        }
+
+        ShowMessages("\n");
+    }
+}
+
+/**
+ * @brief Golden-output test of the hex dumps
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+TestHexDump()
+{
+    BOOLEAN          Result         = TRUE;
+    PVOID            MessageHandler = g_MessageHandler;
+    UCHAR            Buffer[40]     = {0};
+    HEX_DUMP_OPTIONS Options        = {0};
+
+    TestHexDumpFillBuffer(Buffer);
+
+    g_MessageHandler = (PVOID)TestHexDumpCaptureMessage;
+
+    for (UINT32 i = 0; i < sizeof(TestHexDumpCases) / sizeof(TestHexDumpCases[0]); i++)
+    {
+        Options.ElementSize    = TestHexDumpCases[i].ElementSize;
+        Options.UpperCase      = TRUE;
+        Options.ShowAscii      = TestHexDumpCases[i].ShowAscii;
+        Options.PhysicalPrefix = TestHexDumpCases[i].PhysicalPrefix;
+
+        TestHexDumpOutput.clear();
+
+        HexDumpShow(&Options, Buffer, TestHexDumpCases[i].Size, TestHexDumpCases[i].ValidLength, TEST_HEX_DUMP_ADDRESS);
+
+        if (TestHexDumpOutput != TestHexDumpCases[i].Expected)
+        {
+            Result = FALSE;
+            break;
+        }
+    }
+
+    for (UINT32 i = 0; Result && i < sizeof(TestHexDumpSectionCases) / sizeof(TestHexDumpSectionCases[0]); i++)
+    {
+        TestHexDumpOutput.clear();
+
+        HexDumpShowSection(Buffer, TestHexDumpSectionCases[i].Size, TestHexDumpSectionCases[i].Address);
+
+        if (TestHexDumpOutput != TestHexDumpSectionCases[i].Expected)
+        {
+            Result = FALSE;
+        }
+    }
+
+    g_MessageHandler = MessageHandler;
+
+    if (!Result)
+    {
+        ShowMessages("\t[x] unexpected output:\n%s\n", TestHexDumpOutput.c_str());
+    }
+
+    return Result;
+}
+
+/**
+ * @brief Benchmark of showing the hex dumps line by line and byte by byte
+ *
+ * @return VOID
+ */
+VOID
+BenchmarkHexDump()
+{
+    PVOID              MessageHandler = g_MessageHandler;
+    HEX_DUMP_OPTIONS   Options        = {0};
+    std::vector<UCHAR> Buffer(TEST_HEX_DUMP_BENCHMARK_SIZE);
+    UINT64             State = 0x5e2d58d8b3bce8f1;
+    UINT64             StartTime;
+    UINT64             ElapsedTime[2];
+
+    for (UINT32 i = 0; i < TEST_HEX_DUMP_BENCHMARK_SIZE; i++)
+    {
+        Buffer[i] = (UCHAR)UnitTestGetRandom(&State);
+    }
+
+    Options.ElementSize = 1;
+    Options.UpperCase   = TRUE;
+    Options.ShowAscii   = TRUE;
+
+    //
+    // The messages are dropped, so only the rendering is measured
+    //
+    g_MessageHandler = (PVOID)TestHexDumpDropMessage;
+
+    StartTime = UnitTestGetTimeInNanoseconds();
+    TestHexDumpShowBytesOneByOne(Buffer.data(), TEST_HEX_DUMP_BENCHMARK_SIZE, TEST_HEX_DUMP_ADDRESS);
+    ElapsedTime[0] = UnitTestGetTimeInNanoseconds() - StartTime;
+
+    StartTime = UnitTestGetTimeInNanoseconds();
+    HexDumpShow(&Options, Buffer.data(), TEST_HEX_DUMP_BENCHMARK_SIZE, TEST_HEX_DUMP_BENCHMARK_SIZE, TEST_HEX_DUMP_ADDRESS);
+    ElapsedTime[1] = UnitTestGetTimeInNanoseconds() - StartTime;
+
+    g_MessageHandler = MessageHandler;
+
+    UnitTestShowBenchmarkResult("db (1 MB) byte by byte", ElapsedTime[0], TEST_HEX_DUMP_BENCHMARK_SIZE / HEX_DUMP_BYTES_PER_LINE);
+    UnitTestShowBenchmarkResult("db (1 MB) line by line", ElapsedTime[1], TEST_HEX_DUMP_BENCHMARK_SIZE / HEX_DUMP_BYTES_PER_LINE);
+}
+
+UnitTestRegister("hex-dump", TestHexDump, BenchmarkHexDump);
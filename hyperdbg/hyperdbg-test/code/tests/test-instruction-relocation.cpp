@@ -0,0 +1,506 @@
+/**
+ * @file test-instruction-relocation.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Tests and benchmark of the relocation of instructions into trampolines
+ * @details the relocation (InstructionRelocation.c) is shared with hyperhv, the
+ * trampolines of a corpus of instructions are compared with the trampolines that
+ * are expected from the encoding of each instruction
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Size of the trampolines of the test (same as the pool of the trampolines)
+ *
+ */
+#define TEST_INSTRUCTION_RELOCATION_TRAMPOLINE_SIZE 100
+
+/**
+ * @brief Size of the buffer of the instructions of the test
+ *
+ */
+#define TEST_INSTRUCTION_RELOCATION_BUFFER_SIZE 16
+
+/**
+ * @brief Number of the random placements of each instruction
+ *
+ */
+#define TEST_INSTRUCTION_RELOCATION_PLACEMENTS 2000
+
+/**
+ * @brief Address of the instructions of the test
+ *
+ */
+#define TEST_INSTRUCTION_RELOCATION_ADDRESS 0xfffff80412345670ull
+
+/**
+ * @brief The expected relocations
+ *
+ */
+typedef enum _TEST_INSTRUCTION_RELOCATION_KIND
+{
+    TEST_INSTRUCTION_RELOCATION_KIND_REJECTED,         // not relocated (executed using MTF)
+    TEST_INSTRUCTION_RELOCATION_KIND_COPY,             // copied as is
+    TEST_INSTRUCTION_RELOCATION_KIND_RIP_RELATIVE,     // copied and the displacement is fixed up
+    TEST_INSTRUCTION_RELOCATION_KIND_JUMP,             // converted to an absolute jump
+    TEST_INSTRUCTION_RELOCATION_KIND_CONDITIONAL_JUMP, // converted to a 32-bit Jcc and two absolute jumps
+
+} TEST_INSTRUCTION_RELOCATION_KIND;
+
+/**
+ * @brief An instruction of the corpus
+ *
+ */
+typedef struct _TEST_INSTRUCTION_RELOCATION_ENTRY
+{
+    const CHAR *                     Name;
+    BYTE                             Bytes[TEST_INSTRUCTION_RELOCATION_BUFFER_SIZE];
+    UINT32                           Length;
+    TEST_INSTRUCTION_RELOCATION_KIND Kind;
+    UINT32                           DisplacementOffset; // the offset of the RIP-relative displacement
+    INT64                            Relative;           // the RIP-relative displacement or the offset of the branch
+    UINT8                            ConditionCode;
+
+} TEST_INSTRUCTION_RELOCATION_ENTRY, *PTEST_INSTRUCTION_RELOCATION_ENTRY;
+
+/**
+ * @brief The corpus of the instructions
+ *
+ */
+static const TEST_INSTRUCTION_RELOCATION_ENTRY TestInstructionRelocationCorpus[] = {
+    {"push rbp", {0x55}, 1, TEST_INSTRUCTION_RELOCATION_KIND_COPY, 0, 0, 0},
+    {"mov rbp, rsp", {0x48, 0x89, 0xe5}, 3, TEST_INSTRUCTION_RELOCATION_KIND_COPY, 0, 0, 0},
+    {"sub rsp, 0x28", {0x48, 0x83, 0xec, 0x28}, 4, TEST_INSTRUCTION_RELOCATION_KIND_COPY, 0, 0, 0},
+    {"mov [rsp+8], rbx", {0x48, 0x89, 0x5c, 0x24, 0x08}, 5, TEST_INSTRUCTION_RELOCATION_KIND_COPY, 0, 0, 0},
+    {"lea rax, [rcx+rdx*8+0x10]", {0x48, 0x8d, 0x44, 0xd1, 0x10}, 5, TEST_INSTRUCTION_RELOCATION_KIND_COPY, 0, 0, 0},
+    {"xor eax, eax", {0x31, 0xc0}, 2, TEST_INSTRUCTION_RELOCATION_KIND_COPY, 0, 0, 0},
+    {"ret", {0xc3}, 1, TEST_INSTRUCTION_RELOCATION_KIND_COPY, 0, 0, 0},
+    {"jmp rax", {0xff, 0xe0}, 2, TEST_INSTRUCTION_RELOCATION_KIND_COPY, 0, 0, 0},
+
+    {"mov rax, [rip+0x1000]", {0x48, 0x8b, 0x05, 0x00, 0x10, 0x00, 0x00}, 7, TEST_INSTRUCTION_RELOCATION_KIND_RIP_RELATIVE, 3, 0x1000, 0},
+    {"lea rcx, [rip-0x20]", {0x48, 0x8d, 0x0d, 0xe0, 0xff, 0xff, 0xff}, 7, TEST_INSTRUCTION_RELOCATION_KIND_RIP_RELATIVE, 3, -0x20, 0},
+    {"cmp dword ptr [rip+0x100], 5", {0x83, 0x3d, 0x00, 0x01, 0x00, 0x00, 0x05}, 7, TEST_INSTRUCTION_RELOCATION_KIND_RIP_RELATIVE, 2, 0x100, 0},
+    {"push qword ptr [rip+0x10]", {0xff, 0x35, 0x10, 0x00, 0x00, 0x00}, 6, TEST_INSTRUCTION_RELOCATION_KIND_RIP_RELATIVE, 2, 0x10, 0},
+    {"jmp qword ptr [rip+0x8]", {0xff, 0x25, 0x08, 0x00, 0x00, 0x00}, 6, TEST_INSTRUCTION_RELOCATION_KIND_RIP_RELATIVE, 2, 0x8, 0},
+
+    {"jmp short +0x10", {0xeb, 0x10}, 2, TEST_INSTRUCTION_RELOCATION_KIND_JUMP, 0, 0x10, 0},
+    {"jmp near -0x100", {0xe9, 0x00, 0xff, 0xff, 0xff}, 5, TEST_INSTRUCTION_RELOCATION_KIND_JUMP, 0, -0x100, 0},
+    {"je short +5", {0x74, 0x05}, 2, TEST_INSTRUCTION_RELOCATION_KIND_CONDITIONAL_JUMP, 0, 5, 0x4},
+    {"jg short -2", {0x7f, 0xfe}, 2, TEST_INSTRUCTION_RELOCATION_KIND_CONDITIONAL_JUMP, 0, -2, 0xf},
+    {"jne near +0x1000", {0x0f, 0x85, 0x00, 0x10, 0x00, 0x00}, 6, TEST_INSTRUCTION_RELOCATION_KIND_CONDITIONAL_JUMP, 0, 0x1000, 0x5},
+
+    {"call +0", {0xe8, 0x00, 0x00, 0x00, 0x00}, 5, TEST_INSTRUCTION_RELOCATION_KIND_REJECTED, 0, 0, 0},
+    {"call qword ptr [rip+0]", {0xff, 0x15, 0x00, 0x00, 0x00, 0x00}, 6, TEST_INSTRUCTION_RELOCATION_KIND_REJECTED, 0, 0, 0},
+    {"int3", {0xcc}, 1, TEST_INSTRUCTION_RELOCATION_KIND_REJECTED, 0, 0, 0},
+    {"int 0x2e", {0xcd, 0x2e}, 2, TEST_INSTRUCTION_RELOCATION_KIND_REJECTED, 0, 0, 0},
+    {"syscall", {0x0f, 0x05}, 2, TEST_INSTRUCTION_RELOCATION_KIND_REJECTED, 0, 0, 0},
+    {"ud2", {0x0f, 0x0b}, 2, TEST_INSTRUCTION_RELOCATION_KIND_REJECTED, 0, 0, 0},
+    {"mov rax, [rcx]", {0x48, 0x8b, 0x01}, 3, TEST_INSTRUCTION_RELOCATION_KIND_REJECTED, 0, 0, 0},
+    {"mov rax, [0x1234]", {0x48, 0xa1, 0x34, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, 10, TEST_INSTRUCTION_RELOCATION_KIND_REJECTED, 0, 0, 0},
+    {"jrcxz +5", {0xe3, 0x05}, 2, TEST_INSTRUCTION_RELOCATION_KIND_REJECTED, 0, 0, 0},
+    {"loop -2", {0xe2, 0xfe}, 2, TEST_INSTRUCTION_RELOCATION_KIND_REJECTED, 0, 0, 0},
+    {"xbegin +0", {0xc7, 0xf8, 0x00, 0x00, 0x00, 0x00}, 6, TEST_INSTRUCTION_RELOCATION_KIND_REJECTED, 0, 0, 0},
+    {"(invalid) push es", {0x06}, 1, TEST_INSTRUCTION_RELOCATION_KIND_REJECTED, 0, 0, 0},
+};
+
+/**
+ * @brief Write the expected absolute jump
+ *
+ * @param Buffer
+ * @param TargetAddress
+ *
+ * @return UINT32 The size of the jump
+ */
+static UINT32
+TestInstructionRelocationExpectJump(BYTE * Buffer, UINT64 TargetAddress)
+{
+    Buffer[0] = 0xff;
+    Buffer[1] = 0x25;
+
+    memset(&Buffer[2], 0, sizeof(UINT32));
+    memcpy(&Buffer[6], &TargetAddress, sizeof(UINT64));
+
+    return 14;
+}
+
+/**
+ * @brief Build the expected trampoline of an instruction
+ *
+ * @param Entry
+ * @param OriginalAddress
+ * @param TrampolineAddress
+ * @param Buffer
+ *
+ * @return UINT32 The size of the trampoline or zero if it should not be relocated
+ */
+static UINT32
+TestInstructionRelocationExpect(const TEST_INSTRUCTION_RELOCATION_ENTRY * Entry,
+                                UINT64                                    OriginalAddress,
+                                UINT64                                    TrampolineAddress,
+                                BYTE *                                    Buffer)
+{
+    UINT64 NextInstruction = OriginalAddress + Entry->Length;
+    INT64  Displacement;
+    INT32  Displacement32;
+
+    switch (Entry->Kind)
+    {
+    case TEST_INSTRUCTION_RELOCATION_KIND_COPY:
+
+        memcpy(Buffer, Entry->Bytes, Entry->Length);
+
+        return Entry->Length + TestInstructionRelocationExpectJump(&Buffer[Entry->Length], NextInstruction);
+
+    case TEST_INSTRUCTION_RELOCATION_KIND_RIP_RELATIVE:
+
+        //
+        // The operand should point to the same address from the trampoline
+        //
+        Displacement = (INT64)(NextInstruction + Entry->Relative) - (INT64)(TrampolineAddress + Entry->Length);
+
+        if (Displacement != (INT32)Displacement)
+        {
+            return 0;
+        }
+
+        Displacement32 = (INT32)Displacement;
+
+        memcpy(Buffer, Entry->Bytes, Entry->Length);
+        memcpy(&Buffer[Entry->DisplacementOffset], &Displacement32, sizeof(INT32));
+
+        return Entry->Length + TestInstructionRelocationExpectJump(&Buffer[Entry->Length], NextInstruction);
+
+    case TEST_INSTRUCTION_RELOCATION_KIND_JUMP:
+
+        return TestInstructionRelocationExpectJump(Buffer, NextInstruction + Entry->Relative);
+
+    case TEST_INSTRUCTION_RELOCATION_KIND_CONDITIONAL_JUMP:
+
+        //
+        // jcc rel32 (over the jump back), the jump back, the jump to the target
+        //
+        Buffer[0] = 0x0f;
+        Buffer[1] = 0x80 | Entry->ConditionCode;
+        Buffer[2] = 14;
+        Buffer[3] = 0;
+        Buffer[4] = 0;
+        Buffer[5] = 0;
+
+        TestInstructionRelocationExpectJump(&Buffer[6], NextInstruction);
+        TestInstructionRelocationExpectJump(&Buffer[20], NextInstruction + Entry->Relative);
+
+        return 34;
+
+    default:
+
+        return 0;
+    }
+}
+
+/**
+ * @brief Relocate an instruction of the corpus and compare the trampoline with
+ * the expected one
+ *
+ * @param Entry
+ * @param OriginalAddress
+ * @param TrampolineAddress
+ * @param TrampolineSize
+ * @param BufferLength
+ * @param ShouldFail Whether the relocation should fail regardless of the kind
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestInstructionRelocationCheck(const TEST_INSTRUCTION_RELOCATION_ENTRY * Entry,
+                               UINT64                                    OriginalAddress,
+                               UINT64                                    TrampolineAddress,
+                               UINT32                                    TrampolineSize,
+                               UINT32                                    BufferLength,
+                               BOOLEAN                                   ShouldFail)
+{
+    BYTE   Instruction[TEST_INSTRUCTION_RELOCATION_BUFFER_SIZE];
+    CHAR   Trampoline[TEST_INSTRUCTION_RELOCATION_TRAMPOLINE_SIZE];
+    BYTE   Expected[TEST_INSTRUCTION_RELOCATION_TRAMPOLINE_SIZE];
+    UINT32 ExpectedSize;
+    UINT32 Size;
+
+    //
+    // The bytes after the instruction are breakpoints
+    //
+    memset(Instruction, 0xcc, sizeof(Instruction));
+    memcpy(Instruction, Entry->Bytes, Entry->Length);
+    memset(Trampoline, 0xcc, sizeof(Trampoline));
+
+    ExpectedSize = ShouldFail ? 0 : TestInstructionRelocationExpect(Entry, OriginalAddress, TrampolineAddress, Expected);
+    Size         = InstructionRelocationRelocate(Instruction, BufferLength, OriginalAddress, Trampoline, TrampolineAddress, TrampolineSize);
+
+    if (Size != ExpectedSize)
+    {
+        ShowMessages("\t[x] '%s' at %llx (trampoline at %llx, %d bytes): relocated to %d bytes (expected %d)\n",
+                     Entry->Name,
+                     OriginalAddress,
+                     TrampolineAddress,
+                     TrampolineSize,
+                     Size,
+                     ExpectedSize);
+        return FALSE;
+    }
+
+    if (Size != 0 && memcmp(Trampoline, Expected, Size) != 0)
+    {
+        ShowMessages("\t[x] '%s' at %llx (trampoline at %llx): unexpected trampoline\n", Entry->Name, OriginalAddress, TrampolineAddress);
+        return FALSE;
+    }
+
+    //
+    // Nothing is written after the trampoline
+    //
+    for (UINT32 i = Size; i < sizeof(Trampoline); i++)
+    {
+        if ((BYTE)Trampoline[i] != 0xcc)
+        {
+            ShowMessages("\t[x] '%s': the byte %d after the trampoline is changed\n", Entry->Name, i);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Test the corpus with a near trampoline
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestInstructionRelocationCorpusNear()
+{
+    BOOLEAN Result = TRUE;
+
+    for (const TEST_INSTRUCTION_RELOCATION_ENTRY & Entry : TestInstructionRelocationCorpus)
+    {
+        UnitTestExpect(Result,
+                       TestInstructionRelocationCheck(&Entry,
+                                                      TEST_INSTRUCTION_RELOCATION_ADDRESS,
+                                                      TEST_INSTRUCTION_RELOCATION_ADDRESS + 0x100000,
+                                                      TEST_INSTRUCTION_RELOCATION_TRAMPOLINE_SIZE,
+                                                      TEST_INSTRUCTION_RELOCATION_BUFFER_SIZE,
+                                                      FALSE));
+    }
+
+    return Result;
+}
+
+/**
+ * @brief Test the corpus with truncated buffers and small trampolines
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestInstructionRelocationLimits()
+{
+    BOOLEAN Result = TRUE;
+    BYTE    Expected[TEST_INSTRUCTION_RELOCATION_TRAMPOLINE_SIZE];
+    UINT32  ExpectedSize;
+    UINT64  TrampolineAddress = TEST_INSTRUCTION_RELOCATION_ADDRESS - 0x2000;
+
+    for (const TEST_INSTRUCTION_RELOCATION_ENTRY & Entry : TestInstructionRelocationCorpus)
+    {
+        ExpectedSize = TestInstructionRelocationExpect(&Entry, TEST_INSTRUCTION_RELOCATION_ADDRESS, TrampolineAddress, Expected);
+
+        //
+        // The instruction is not complete in the buffer (e.g., crosses the page)
+        //
+        UnitTestExpect(Result,
+                       TestInstructionRelocationCheck(&Entry,
+                                                      TEST_INSTRUCTION_RELOCATION_ADDRESS,
+                                                      TrampolineAddress,
+                                                      TEST_INSTRUCTION_RELOCATION_TRAMPOLINE_SIZE,
+                                                      Entry.Length - 1,
+                                                      TRUE));
+
+        //
+        // The instruction ends at the end of the buffer
+        //
+        UnitTestExpect(Result,
+                       TestInstructionRelocationCheck(&Entry,
+                                                      TEST_INSTRUCTION_RELOCATION_ADDRESS,
+                                                      TrampolineAddress,
+                                                      TEST_INSTRUCTION_RELOCATION_TRAMPOLINE_SIZE,
+                                                      Entry.Length,
+                                                      FALSE));
+
+        if (ExpectedSize == 0)
+        {
+            continue;
+        }
+
+        //
+        // The trampoline fits exactly, or is one byte short
+        //
+        UnitTestExpect(Result,
+                       TestInstructionRelocationCheck(&Entry,
+                                                      TEST_INSTRUCTION_RELOCATION_ADDRESS,
+                                                      TrampolineAddress,
+                                                      ExpectedSize,
+                                                      TEST_INSTRUCTION_RELOCATION_BUFFER_SIZE,
+                                                      FALSE));
+        UnitTestExpect(Result,
+                       TestInstructionRelocationCheck(&Entry,
+                                                      TEST_INSTRUCTION_RELOCATION_ADDRESS,
+                                                      TrampolineAddress,
+                                                      ExpectedSize - 1,
+                                                      TEST_INSTRUCTION_RELOCATION_BUFFER_SIZE,
+                                                      TRUE));
+    }
+
+    return Result;
+}
+
+/**
+ * @brief Test the RIP-relative displacements at the limits of the 32-bit range
+ * and at random distances between the instructions and the trampolines
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestInstructionRelocationPlacements()
+{
+    BOOLEAN Result      = TRUE;
+    UINT64  RandomState = 0x52656c6f63ull;
+    UINT64  Target;
+    UINT64  TrampolineAddress;
+    INT64   Distance;
+
+    for (const TEST_INSTRUCTION_RELOCATION_ENTRY & Entry : TestInstructionRelocationCorpus)
+    {
+        if (Entry.Kind == TEST_INSTRUCTION_RELOCATION_KIND_RIP_RELATIVE)
+        {
+            //
+            // The new displacement is exactly MAXLONG or MINLONG (accepted), or
+            // one beyond them (rejected)
+            //
+            Target = TEST_INSTRUCTION_RELOCATION_ADDRESS + Entry.Length + Entry.Relative;
+
+            UnitTestExpect(Result,
+                           TestInstructionRelocationCheck(&Entry,
+                                                          TEST_INSTRUCTION_RELOCATION_ADDRESS,
+                                                          Target - Entry.Length - MAXLONG,
+                                                          TEST_INSTRUCTION_RELOCATION_TRAMPOLINE_SIZE,
+                                                          TEST_INSTRUCTION_RELOCATION_BUFFER_SIZE,
+                                                          FALSE));
+            UnitTestExpect(Result,
+                           TestInstructionRelocationCheck(&Entry,
+                                                          TEST_INSTRUCTION_RELOCATION_ADDRESS,
+                                                          Target - Entry.Length - MAXLONG - 1,
+                                                          TEST_INSTRUCTION_RELOCATION_TRAMPOLINE_SIZE,
+                                                          TEST_INSTRUCTION_RELOCATION_BUFFER_SIZE,
+                                                          TRUE));
+            UnitTestExpect(Result,
+                           TestInstructionRelocationCheck(&Entry,
+                                                          TEST_INSTRUCTION_RELOCATION_ADDRESS,
+                                                          Target - Entry.Length + ((UINT64)MAXLONG + 1),
+                                                          TEST_INSTRUCTION_RELOCATION_TRAMPOLINE_SIZE,
+                                                          TEST_INSTRUCTION_RELOCATION_BUFFER_SIZE,
+                                                          FALSE));
+            UnitTestExpect(Result,
+                           TestInstructionRelocationCheck(&Entry,
+                                                          TEST_INSTRUCTION_RELOCATION_ADDRESS,
+                                                          Target - Entry.Length + ((UINT64)MAXLONG + 2),
+                                                          TEST_INSTRUCTION_RELOCATION_TRAMPOLINE_SIZE,
+                                                          TEST_INSTRUCTION_RELOCATION_BUFFER_SIZE,
+                                                          TRUE));
+        }
+
+        //
+        // The trampolines within +-4GB of the instruction (the expected trampoline
+        // tells whether the displacement fits)
+        //
+        for (UINT32 i = 0; i < TEST_INSTRUCTION_RELOCATION_PLACEMENTS; i++)
+        {
+            Distance          = (INT64)(UnitTestGetRandom(&RandomState) % 0x200000000ull) - 0x100000000ll;
+            TrampolineAddress = TEST_INSTRUCTION_RELOCATION_ADDRESS + Distance;
+
+            UnitTestExpect(Result,
+                           TestInstructionRelocationCheck(&Entry,
+                                                          TEST_INSTRUCTION_RELOCATION_ADDRESS,
+                                                          TrampolineAddress,
+                                                          TEST_INSTRUCTION_RELOCATION_TRAMPOLINE_SIZE,
+                                                          TEST_INSTRUCTION_RELOCATION_BUFFER_SIZE,
+                                                          FALSE));
+
+            if (!Result)
+            {
+                return FALSE;
+            }
+        }
+    }
+
+    return Result;
+}
+
+/**
+ * @brief Tests of the relocation of instructions into trampolines
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+TestInstructionRelocation()
+{
+    BOOLEAN Result = TRUE;
+
+    UnitTestExpect(Result, TestInstructionRelocationCorpusNear());
+    UnitTestExpect(Result, TestInstructionRelocationLimits());
+    UnitTestExpect(Result, TestInstructionRelocationPlacements());
+
+    return Result;
+}
+
+/**
+ * @brief Benchmark of the relocation of instructions into trampolines
+ *
+ * @return VOID
+ */
+VOID
+BenchmarkInstructionRelocation()
+{
+    CHAR   Trampoline[TEST_INSTRUCTION_RELOCATION_TRAMPOLINE_SIZE];
+    BYTE   Instruction[TEST_INSTRUCTION_RELOCATION_BUFFER_SIZE];
+    UINT64 Iterations = 100000;
+    UINT64 Relocated  = 0;
+    UINT64 Count      = 0;
+    UINT64 StartTime;
+
+    StartTime = UnitTestGetTimeInNanoseconds();
+
+    for (UINT64 i = 0; i < Iterations; i++)
+    {
+        for (const TEST_INSTRUCTION_RELOCATION_ENTRY & Entry : TestInstructionRelocationCorpus)
+        {
+            memset(Instruction, 0xcc, sizeof(Instruction));
+            memcpy(Instruction, Entry.Bytes, Entry.Length);
+
+            if (InstructionRelocationRelocate(Instruction,
+                                              sizeof(Instruction),
+                                              TEST_INSTRUCTION_RELOCATION_ADDRESS,
+                                              Trampoline,
+                                              TEST_INSTRUCTION_RELOCATION_ADDRESS + 0x100000,
+                                              sizeof(Trampoline)) != 0)
+            {
+                Relocated++;
+            }
+
+            Count++;
+        }
+    }
+
+    UnitTestShowBenchmarkResult("relocation of an instruction", UnitTestGetTimeInNanoseconds() - StartTime, Count);
+
+    ShowMessages("\t%lld of %lld instructions of the corpus are relocated\n", Relocated / Iterations, Count / Iterations);
+}
+
+UnitTestRegister("instruction-relocation", TestInstructionRelocation, BenchmarkInstructionRelocation);
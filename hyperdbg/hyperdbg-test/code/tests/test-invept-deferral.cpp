@@ -0,0 +1,616 @@
+/**
+ * @file test-invept-deferral.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Tests and benchmark of the deferred invalidations of the EPT caches
+ * @details the bookkeeping of the deferred invalidations (InveptDeferral.c) is
+ * shared with hyperhv, the cores, their EPT caches (a TLB that is tagged by the
+ * EPTP) and the editors of the EPT of all cores are interleaved randomly
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Number of the cores of the model
+ *
+ */
+#define TEST_INVEPT_DEFERRAL_NUMBER_OF_CORES 8
+
+/**
+ * @brief Number of the pages of the EPT of each core
+ *
+ */
+#define TEST_INVEPT_DEFERRAL_NUMBER_OF_PAGES 64
+
+/**
+ * @brief Number of the pages whose tables are shared between the EPT of a
+ * core and its view (the other pages have separate entries in the view)
+ *
+ */
+#define TEST_INVEPT_DEFERRAL_SHARED_PAGES 16
+
+/**
+ * @brief Number of the editors of the EPT of all cores (e.g., applying hooks)
+ *
+ */
+#define TEST_INVEPT_DEFERRAL_NUMBER_OF_EDITORS 2
+
+/**
+ * @brief Number of the steps of the model
+ *
+ */
+#define TEST_INVEPT_DEFERRAL_NUMBER_OF_STEPS 1000000
+
+/**
+ * @brief Number of the edits of a batch of an editor
+ *
+ */
+#define TEST_INVEPT_DEFERRAL_BATCH_SIZE 8
+
+/**
+ * @brief A translation that is not cached
+ *
+ */
+#define TEST_INVEPT_DEFERRAL_NOT_CACHED ((UINT64)-1)
+
+/**
+ * @brief States of a core of the model
+ *
+ */
+typedef enum _TEST_INVEPT_DEFERRAL_CORE_STATE
+{
+    TEST_INVEPT_DEFERRAL_CORE_STATE_GUEST,    // executing the guest
+    TEST_INVEPT_DEFERRAL_CORE_STATE_ROOT,     // in a VM-exit
+    TEST_INVEPT_DEFERRAL_CORE_STATE_ENTERING, // the deferred invalidation is taken, not performed yet
+
+} TEST_INVEPT_DEFERRAL_CORE_STATE;
+
+/**
+ * @brief An edit of the EPT of a core by an editor
+ *
+ */
+typedef struct _TEST_INVEPT_DEFERRAL_EDIT
+{
+    UINT64 Generation;
+    UINT32 Page;
+    UINT64 Version;
+
+} TEST_INVEPT_DEFERRAL_EDIT, *PTEST_INVEPT_DEFERRAL_EDIT;
+
+/**
+ * @brief A core of the model
+ * @details the context 0 is the EPT of the core (its EPTP is used for the
+ * single-context invalidations) and the context 1 is a view of it
+ *
+ */
+typedef struct _TEST_INVEPT_DEFERRAL_CORE
+{
+    INVEPT_DEFERRAL                        Deferral;
+    TEST_INVEPT_DEFERRAL_CORE_STATE        State;
+    UINT32                                 Context;
+    BOOLEAN                                ForceExit;
+    UINT32                                 PlannedInvalidation;
+    UINT64                                 Entries[2][TEST_INVEPT_DEFERRAL_NUMBER_OF_PAGES];  // the versions of the entries of the contexts
+    UINT64                                 Cached[2][TEST_INVEPT_DEFERRAL_NUMBER_OF_PAGES];   // the versions that are cached in the TLB
+    UINT64                                 Required[2][TEST_INVEPT_DEFERRAL_NUMBER_OF_PAGES]; // the oldest versions that can be cached after the VM-entry
+    UINT64                                 Local[2][TEST_INVEPT_DEFERRAL_NUMBER_OF_PAGES];    // the versions of the edits of the current VM-exit
+    std::vector<TEST_INVEPT_DEFERRAL_EDIT> RemoteEdits;                                      // the edits of the editors that are not taken yet
+
+} TEST_INVEPT_DEFERRAL_CORE, *PTEST_INVEPT_DEFERRAL_CORE;
+
+/**
+ * @brief An editor of the EPT of all cores
+ *
+ */
+typedef struct _TEST_INVEPT_DEFERRAL_EDITOR
+{
+    UINT32 Phase; // 0: idle, 1: edited, 2: generation is advanced and the cores are forced to exit
+    UINT32 Pages[TEST_INVEPT_DEFERRAL_BATCH_SIZE];
+    UINT64 Versions[TEST_INVEPT_DEFERRAL_NUMBER_OF_CORES][TEST_INVEPT_DEFERRAL_BATCH_SIZE];
+    UINT64 Generation;
+
+} TEST_INVEPT_DEFERRAL_EDITOR, *PTEST_INVEPT_DEFERRAL_EDITOR;
+
+/**
+ * @brief The model
+ *
+ */
+typedef struct _TEST_INVEPT_DEFERRAL_MACHINE
+{
+    TEST_INVEPT_DEFERRAL_CORE   Cores[TEST_INVEPT_DEFERRAL_NUMBER_OF_CORES];
+    TEST_INVEPT_DEFERRAL_EDITOR Editors[TEST_INVEPT_DEFERRAL_NUMBER_OF_EDITORS];
+    volatile LONG64             Generation;
+    UINT64                      Version;
+    UINT64                      Invalidations;          // the INVEPTs that are performed
+    UINT64                      ImmediateInvalidations; // the INVEPTs if each edit is invalidated immediately on each core
+    UINT64                      Edits;
+    UINT64                      Acknowledgements;
+
+} TEST_INVEPT_DEFERRAL_MACHINE, *PTEST_INVEPT_DEFERRAL_MACHINE;
+
+/**
+ * @brief Get the context of the entry of a page, the pages whose tables are
+ * shared use the entries of the EPT of the core in both contexts
+ *
+ * @param Context
+ * @param Page
+ *
+ * @return UINT32
+ */
+static UINT32
+TestInveptDeferralEntryContext(UINT32 Context, UINT32 Page)
+{
+    return Page < TEST_INVEPT_DEFERRAL_SHARED_PAGES ? 0 : Context;
+}
+
+/**
+ * @brief Make a version required after the next VM-entry of a core
+ *
+ * @param Core
+ * @param Context the context of the entry
+ * @param Page
+ * @param Version
+ *
+ * @return VOID
+ */
+static VOID
+TestInveptDeferralRequire(PTEST_INVEPT_DEFERRAL_CORE Core, UINT32 Context, UINT32 Page, UINT64 Version)
+{
+    if (Core->Required[Context][Page] < Version)
+    {
+        Core->Required[Context][Page] = Version;
+    }
+
+    //
+    // The entries of the shared tables are cached in both contexts
+    //
+    if (Context == 0 && Page < TEST_INVEPT_DEFERRAL_SHARED_PAGES && Core->Required[1][Page] < Version)
+    {
+        Core->Required[1][Page] = Version;
+    }
+}
+
+/**
+ * @brief Check that the TLB of a core holds no translation that is older
+ * than the required versions
+ *
+ * @param Core
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestInveptDeferralCheckTlb(PTEST_INVEPT_DEFERRAL_CORE Core)
+{
+    for (UINT32 Context = 0; Context < 2; Context++)
+    {
+        for (UINT32 Page = 0; Page < TEST_INVEPT_DEFERRAL_NUMBER_OF_PAGES; Page++)
+        {
+            if (Core->Cached[Context][Page] != TEST_INVEPT_DEFERRAL_NOT_CACHED && Core->Cached[Context][Page] < Core->Required[Context][Page])
+            {
+                ShowMessages("\t[x] the context %d of the page %d is cached with the version %lld (required %lld)\n",
+                             Context,
+                             Page,
+                             Core->Cached[Context][Page],
+                             Core->Required[Context][Page]);
+                return FALSE;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief A step of a core that executes the guest
+ * @details the guest accesses a page (the translation is cached in the TLB
+ * of the current context), evicts a translation or causes a VM-exit
+ *
+ * @param Core
+ * @param RandomState
+ *
+ * @return VOID
+ */
+static VOID
+TestInveptDeferralGuestStep(PTEST_INVEPT_DEFERRAL_CORE Core, UINT64 * RandomState)
+{
+    UINT32 Page   = (UINT32)(UnitTestGetRandom(RandomState) % TEST_INVEPT_DEFERRAL_NUMBER_OF_PAGES);
+    UINT32 Action = (UINT32)(UnitTestGetRandom(RandomState) % 32);
+
+    if (Core->ForceExit || Action == 0)
+    {
+        Core->ForceExit = FALSE;
+        Core->State     = TEST_INVEPT_DEFERRAL_CORE_STATE_ROOT;
+    }
+    else if (Action == 1)
+    {
+        Core->Cached[Core->Context][Page] = TEST_INVEPT_DEFERRAL_NOT_CACHED;
+    }
+    else if (Core->Cached[Core->Context][Page] == TEST_INVEPT_DEFERRAL_NOT_CACHED)
+    {
+        Core->Cached[Core->Context][Page] = Core->Entries[TestInveptDeferralEntryContext(Core->Context, Page)][Page];
+    }
+}
+
+/**
+ * @brief A step of a core in a VM-exit
+ * @details the core edits its own EPT (and defers the invalidation), switches
+ * its EPTP or takes the deferred invalidation before the VM-entry
+ *
+ * @param Machine
+ * @param Core
+ * @param RandomState
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestInveptDeferralRootStep(PTEST_INVEPT_DEFERRAL_MACHINE Machine, PTEST_INVEPT_DEFERRAL_CORE Core, UINT64 * RandomState)
+{
+    BOOLEAN Result  = TRUE;
+    UINT32  Page    = (UINT32)(UnitTestGetRandom(RandomState) % TEST_INVEPT_DEFERRAL_NUMBER_OF_PAGES);
+    UINT32  Context = TestInveptDeferralEntryContext((UINT32)(UnitTestGetRandom(RandomState) % 2), Page);
+    UINT32  Action  = (UINT32)(UnitTestGetRandom(RandomState) % 4);
+
+    if (Action == 0)
+    {
+        //
+        // The entries of the shared tables and of the view are cached with
+        // other EPTPs, so they need an all-contexts invalidation
+        //
+        Core->Entries[Context][Page] = ++Machine->Version;
+        Core->Local[Context][Page]   = Machine->Version;
+
+        UnitTestExpect(Result,
+                       InveptDeferralRequest(&Core->Deferral,
+                                             Context == 0 && Page >= TEST_INVEPT_DEFERRAL_SHARED_PAGES ? InveptSingleContext : InveptAllContext));
+
+        Machine->Edits++;
+        Machine->ImmediateInvalidations++;
+    }
+    else if (Action == 1)
+    {
+        Core->Context = (UINT32)(UnitTestGetRandom(RandomState) % 2);
+    }
+    else
+    {
+        Core->PlannedInvalidation = InveptDeferralTake(&Core->Deferral, &Machine->Generation);
+
+        UnitTestExpect(Result, !InveptDeferralIsPending(&Core->Deferral, &Machine->Generation));
+
+        //
+        // The edits of this VM-exit and the edits of the editors that are
+        // announced before the generation is read should be visible
+        //
+        for (UINT32 i = 0; i < TEST_INVEPT_DEFERRAL_NUMBER_OF_PAGES; i++)
+        {
+            TestInveptDeferralRequire(Core, 0, i, Core->Local[0][i]);
+            TestInveptDeferralRequire(Core, 1, i, Core->Local[1][i]);
+        }
+
+        memset(Core->Local, 0, sizeof(Core->Local));
+
+        for (size_t i = 0; i < Core->RemoteEdits.size();)
+        {
+            if (Core->RemoteEdits[i].Generation <= Core->Deferral.Generation)
+            {
+                TestInveptDeferralRequire(Core, 0, Core->RemoteEdits[i].Page, Core->RemoteEdits[i].Version);
+
+                Core->RemoteEdits[i] = Core->RemoteEdits.back();
+                Core->RemoteEdits.pop_back();
+            }
+            else
+            {
+                i++;
+            }
+        }
+
+        Core->State = TEST_INVEPT_DEFERRAL_CORE_STATE_ENTERING;
+    }
+
+    return Result;
+}
+
+/**
+ * @brief A step of a core that performs the taken invalidation and enters
+ * the guest
+ *
+ * @param Machine
+ * @param Core
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestInveptDeferralEntryStep(PTEST_INVEPT_DEFERRAL_MACHINE Machine, PTEST_INVEPT_DEFERRAL_CORE Core)
+{
+    if (Core->PlannedInvalidation == InveptAllContext)
+    {
+        memset(Core->Cached, 0xff, sizeof(Core->Cached));
+        Machine->Invalidations++;
+    }
+    else if (Core->PlannedInvalidation == InveptSingleContext)
+    {
+        memset(Core->Cached[0], 0xff, sizeof(Core->Cached[0]));
+        Machine->Invalidations++;
+    }
+
+    Core->State = TEST_INVEPT_DEFERRAL_CORE_STATE_GUEST;
+
+    return TestInveptDeferralCheckTlb(Core);
+}
+
+/**
+ * @brief A step of an editor of the EPT of all cores (like applying a batch
+ * of hooks and broadcasting them)
+ * @details the entries of all cores are edited, then the generation is
+ * advanced and the cores are forced to exit, and once all cores enter the
+ * guest again with the new generation, none of them should hold the old
+ * translations
+ *
+ * @param Machine
+ * @param Editor
+ * @param RandomState
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestInveptDeferralEditorStep(PTEST_INVEPT_DEFERRAL_MACHINE Machine, PTEST_INVEPT_DEFERRAL_EDITOR Editor, UINT64 * RandomState)
+{
+    BOOLEAN                    Result = TRUE;
+    PTEST_INVEPT_DEFERRAL_CORE Core;
+    TEST_INVEPT_DEFERRAL_EDIT  Edit;
+
+    if (Editor->Phase == 0)
+    {
+        for (UINT32 j = 0; j < TEST_INVEPT_DEFERRAL_BATCH_SIZE; j++)
+        {
+            Editor->Pages[j] = (UINT32)(UnitTestGetRandom(RandomState) % TEST_INVEPT_DEFERRAL_NUMBER_OF_PAGES);
+
+            for (UINT32 i = 0; i < TEST_INVEPT_DEFERRAL_NUMBER_OF_CORES; i++)
+            {
+                Machine->Cores[i].Entries[0][Editor->Pages[j]] = ++Machine->Version;
+                Editor->Versions[i][j]                         = Machine->Version;
+            }
+
+            Machine->Edits++;
+            Machine->ImmediateInvalidations += TEST_INVEPT_DEFERRAL_NUMBER_OF_CORES;
+        }
+
+        Editor->Phase = 1;
+    }
+    else if (Editor->Phase == 1)
+    {
+        InveptDeferralAdvanceGeneration(&Machine->Generation);
+
+        Editor->Generation = (UINT64)Machine->Generation;
+
+        for (UINT32 i = 0; i < TEST_INVEPT_DEFERRAL_NUMBER_OF_CORES; i++)
+        {
+            UnitTestExpect(Result, InveptDeferralIsPending(&Machine->Cores[i].Deferral, &Machine->Generation));
+
+            for (UINT32 j = 0; j < TEST_INVEPT_DEFERRAL_BATCH_SIZE; j++)
+            {
+                Edit.Generation = Editor->Generation;
+                Edit.Page       = Editor->Pages[j];
+                Edit.Version    = Editor->Versions[i][j];
+
+                Machine->Cores[i].RemoteEdits.push_back(Edit);
+            }
+
+            Machine->Cores[i].ForceExit = Machine->Cores[i].State == TEST_INVEPT_DEFERRAL_CORE_STATE_GUEST;
+        }
+
+        Editor->Phase = 2;
+    }
+    else
+    {
+        //
+        // Wait for all cores to enter the guest with the new generation
+        //
+        for (UINT32 i = 0; i < TEST_INVEPT_DEFERRAL_NUMBER_OF_CORES; i++)
+        {
+            Core = &Machine->Cores[i];
+
+            if (Core->State != TEST_INVEPT_DEFERRAL_CORE_STATE_GUEST || Core->Deferral.Generation < Editor->Generation)
+            {
+                return TRUE;
+            }
+        }
+
+        for (UINT32 i = 0; i < TEST_INVEPT_DEFERRAL_NUMBER_OF_CORES; i++)
+        {
+            for (UINT32 j = 0; j < TEST_INVEPT_DEFERRAL_BATCH_SIZE; j++)
+            {
+                for (UINT32 Context = 0; Context < 2; Context++)
+                {
+                    if (Context == 0 || Editor->Pages[j] < TEST_INVEPT_DEFERRAL_SHARED_PAGES)
+                    {
+                        UnitTestExpect(Result,
+                                       Machine->Cores[i].Cached[Context][Editor->Pages[j]] == TEST_INVEPT_DEFERRAL_NOT_CACHED ||
+                                           Machine->Cores[i].Cached[Context][Editor->Pages[j]] >= Editor->Versions[i][j]);
+                    }
+                }
+            }
+        }
+
+        Machine->Acknowledgements++;
+        Editor->Phase = 0;
+    }
+
+    return Result;
+}
+
+/**
+ * @brief Run the model
+ *
+ * @param Machine
+ * @param Seed
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestInveptDeferralRun(PTEST_INVEPT_DEFERRAL_MACHINE Machine, UINT64 Seed)
+{
+    BOOLEAN                    Result      = TRUE;
+    UINT64                     RandomState = Seed;
+    PTEST_INVEPT_DEFERRAL_CORE Core;
+    UINT32                     Actor;
+
+    for (UINT32 i = 0; i < TEST_INVEPT_DEFERRAL_NUMBER_OF_CORES; i++)
+    {
+        Core = &Machine->Cores[i];
+
+        Core->Deferral.Generation = 0;
+        Core->Deferral.Pending    = 0;
+        Core->State               = TEST_INVEPT_DEFERRAL_CORE_STATE_GUEST;
+        Core->Context             = 0;
+        Core->ForceExit           = FALSE;
+
+        memset(Core->Entries, 0, sizeof(Core->Entries));
+        memset(Core->Cached, 0xff, sizeof(Core->Cached));
+        memset(Core->Required, 0, sizeof(Core->Required));
+        memset(Core->Local, 0, sizeof(Core->Local));
+
+        Core->RemoteEdits.clear();
+    }
+
+    memset(Machine->Editors, 0, sizeof(Machine->Editors));
+
+    Machine->Generation             = 0;
+    Machine->Version                = 0;
+    Machine->Invalidations          = 0;
+    Machine->ImmediateInvalidations = 0;
+    Machine->Edits                  = 0;
+    Machine->Acknowledgements       = 0;
+
+    for (UINT32 Step = 0; Result && Step < TEST_INVEPT_DEFERRAL_NUMBER_OF_STEPS; Step++)
+    {
+        Actor = (UINT32)(UnitTestGetRandom(&RandomState) % (TEST_INVEPT_DEFERRAL_NUMBER_OF_CORES * 4 + TEST_INVEPT_DEFERRAL_NUMBER_OF_EDITORS));
+
+        if (Actor >= TEST_INVEPT_DEFERRAL_NUMBER_OF_CORES * 4)
+        {
+            UnitTestExpect(Result, TestInveptDeferralEditorStep(Machine, &Machine->Editors[Actor - TEST_INVEPT_DEFERRAL_NUMBER_OF_CORES * 4], &RandomState));
+            continue;
+        }
+
+        Core = &Machine->Cores[Actor % TEST_INVEPT_DEFERRAL_NUMBER_OF_CORES];
+
+        switch (Core->State)
+        {
+        case TEST_INVEPT_DEFERRAL_CORE_STATE_GUEST:
+            TestInveptDeferralGuestStep(Core, &RandomState);
+            break;
+
+        case TEST_INVEPT_DEFERRAL_CORE_STATE_ROOT:
+            UnitTestExpect(Result, TestInveptDeferralRootStep(Machine, Core, &RandomState));
+            break;
+
+        default:
+            UnitTestExpect(Result, TestInveptDeferralEntryStep(Machine, Core));
+            break;
+        }
+
+        if (!Result)
+        {
+            ShowMessages("\t[x] a stale translation at the step %d on the core %d\n", Step, Actor % TEST_INVEPT_DEFERRAL_NUMBER_OF_CORES);
+        }
+    }
+
+    return Result;
+}
+
+/**
+ * @brief Test the requests and the generations of a single core
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestInveptDeferralRequests()
+{
+    BOOLEAN         Result     = TRUE;
+    volatile LONG64 Generation = 0;
+    INVEPT_DEFERRAL Deferral   = {0};
+
+    UnitTestExpect(Result, !InveptDeferralIsPending(&Deferral, &Generation));
+    UnitTestExpect(Result, InveptDeferralTake(&Deferral, &Generation) == 0);
+
+    //
+    // The invalidations of several edits are coalesced
+    //
+    UnitTestExpect(Result, InveptDeferralRequest(&Deferral, InveptSingleContext));
+    UnitTestExpect(Result, InveptDeferralRequest(&Deferral, InveptSingleContext));
+    UnitTestExpect(Result, InveptDeferralIsPending(&Deferral, &Generation));
+    UnitTestExpect(Result, InveptDeferralTake(&Deferral, &Generation) == InveptSingleContext);
+    UnitTestExpect(Result, InveptDeferralTake(&Deferral, &Generation) == 0);
+
+    UnitTestExpect(Result, InveptDeferralRequest(&Deferral, InveptSingleContext));
+    UnitTestExpect(Result, InveptDeferralRequest(&Deferral, InveptAllContext));
+    UnitTestExpect(Result, InveptDeferralRequest(&Deferral, InveptSingleContext));
+    UnitTestExpect(Result, InveptDeferralTake(&Deferral, &Generation) == InveptAllContext);
+
+    UnitTestExpect(Result, !InveptDeferralRequest(&Deferral, (INVEPT_TYPE)3));
+    UnitTestExpect(Result, !InveptDeferralIsPending(&Deferral, &Generation));
+
+    //
+    // The edits of all cores need an all-contexts invalidation
+    //
+    InveptDeferralAdvanceGeneration(&Generation);
+    InveptDeferralAdvanceGeneration(&Generation);
+
+    UnitTestExpect(Result, InveptDeferralIsPending(&Deferral, &Generation));
+    UnitTestExpect(Result, InveptDeferralRequest(&Deferral, InveptSingleContext));
+    UnitTestExpect(Result, InveptDeferralTake(&Deferral, &Generation) == InveptAllContext);
+    UnitTestExpect(Result, Deferral.Generation == 2);
+    UnitTestExpect(Result, !InveptDeferralIsPending(&Deferral, &Generation));
+    UnitTestExpect(Result, InveptDeferralTake(&Deferral, &Generation) == 0);
+
+    return Result;
+}
+
+/**
+ * @brief Tests of the deferred invalidations of the EPT caches
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+TestInveptDeferral()
+{
+    BOOLEAN                                       Result  = TRUE;
+    std::unique_ptr<TEST_INVEPT_DEFERRAL_MACHINE> Machine = std::make_unique<TEST_INVEPT_DEFERRAL_MACHINE>();
+
+    UnitTestExpect(Result, TestInveptDeferralRequests());
+    UnitTestExpect(Result, TestInveptDeferralRun(Machine.get(), 0x496e76657074ull));
+    UnitTestExpect(Result, Machine->Acknowledgements > 0);
+
+    return Result;
+}
+
+/**
+ * @brief Benchmark of the deferred invalidations of the EPT caches
+ * @details the number of the INVEPTs of the model compared to invalidating
+ * each edit immediately on each core
+ *
+ * @return VOID
+ */
+VOID
+BenchmarkInveptDeferral()
+{
+    std::unique_ptr<TEST_INVEPT_DEFERRAL_MACHINE> Machine = std::make_unique<TEST_INVEPT_DEFERRAL_MACHINE>();
+    UINT64                                        StartTime;
+
+    StartTime = UnitTestGetTimeInNanoseconds();
+
+    TestInveptDeferralRun(Machine.get(), 0x496e7642656eull);
+
+    UnitTestShowBenchmarkResult("step of the model", UnitTestGetTimeInNanoseconds() - StartTime, TEST_INVEPT_DEFERRAL_NUMBER_OF_STEPS);
+
+    ShowMessages("\t%lld edits (%lld broadcasts), INVEPTs: %lld (immediate), %lld (deferred), %.1f%% fewer\n",
+                 Machine->Edits,
+                 Machine->Acknowledgements,
+                 Machine->ImmediateInvalidations,
+                 Machine->Invalidations,
+                 100.0 * (Machine->ImmediateInvalidations - Machine->Invalidations) / Machine->ImmediateInvalidations);
+}
+
+UnitTestRegister("invept-deferral", TestInveptDeferral, BenchmarkInveptDeferral);
@@ -0,0 +1,956 @@
+/**
+ * @file test-kd-batch.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Encode/decode tests and link benchmark of the batch operations
+ * @details the batches are performed by the batch operations component
+ * (the same as hyperkd) on a stubbed memory, registers and breakpoints,
+ * and the link is a model of the serial connection
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Address of the stubbed memory of the debuggee
+ *
+ */
+#define TEST_KD_BATCH_MEMORY_ADDRESS 0xfffff80000100000
+
+/**
+ * @brief Size of the stubbed memory of the debuggee
+ *
+ */
+#define TEST_KD_BATCH_MEMORY_SIZE 0x1000
+
+/**
+ * @brief Number of the stubbed registers of the debuggee
+ *
+ */
+#define TEST_KD_BATCH_REGISTERS 32
+
+/**
+ * @brief Number of the randomized results that are parsed
+ *
+ */
+#define TEST_KD_BATCH_RANDOM_RESULTS 2000
+
+/**
+ * @brief Baud rate of the simulated link (the default rate of the serial
+ * connection), each byte is 10 bits (8N1)
+ *
+ */
+#define TEST_KD_BATCH_LINK_BAUD_RATE 115200
+
+/**
+ * @brief Turnaround time of each round trip of the simulated link (the
+ * debuggee receives the packet, performs it and starts the response)
+ *
+ */
+#define TEST_KD_BATCH_LINK_TURNAROUND_NS 200000
+
+/**
+ * @brief Number of batches that are encoded and decoded in the benchmark
+ *
+ */
+#define TEST_KD_BATCH_BENCHMARK_ITERATIONS 2000
+
+/**
+ * @brief The stubbed state of the debuggee
+ *
+ */
+typedef struct _TEST_KD_BATCH_DEBUGGEE
+{
+    BYTE                     Memory[TEST_KD_BATCH_MEMORY_SIZE];
+    UINT64                   Registers[TEST_KD_BATCH_REGISTERS];
+    std::map<UINT64, UINT64> Breakpoints; // id -> address
+    UINT64                   NextBreakpointId;
+    std::vector<CHAR>        Response;
+
+} TEST_KD_BATCH_DEBUGGEE, *PTEST_KD_BATCH_DEBUGGEE;
+
+/**
+ * @brief The (ignored) messages of the rejected operations
+ *
+ * @param Text
+ *
+ * @return int
+ */
+static int
+TestKdBatchMessageHandler(const char * Text)
+{
+    UNREFERENCED_PARAMETER(Text);
+
+    return 0;
+}
+
+/**
+ * @brief Initialize the stubbed state of the debuggee
+ *
+ * @param Debuggee
+ *
+ * @return VOID
+ */
+static VOID
+TestKdBatchInitializeDebuggee(PTEST_KD_BATCH_DEBUGGEE Debuggee)
+{
+    for (UINT32 i = 0; i < TEST_KD_BATCH_MEMORY_SIZE; i++)
+    {
+        Debuggee->Memory[i] = (BYTE)(i * 7 + 3);
+    }
+
+    for (UINT32 i = 0; i < TEST_KD_BATCH_REGISTERS; i++)
+    {
+        Debuggee->Registers[i] = 0x1111111111111111ull * (i % 16);
+    }
+
+    Debuggee->Breakpoints.clear();
+    Debuggee->NextBreakpointId = 0;
+    Debuggee->Response.assign(MaxBatchPacketSize, 0);
+}
+
+/**
+ * @brief Get the stubbed memory of a range of addresses
+ *
+ * @param Debuggee
+ * @param Address
+ * @param Size
+ *
+ * @return BYTE * NULL if the range is not in the memory
+ */
+static BYTE *
+TestKdBatchGetMemory(PTEST_KD_BATCH_DEBUGGEE Debuggee, UINT64 Address, UINT64 Size)
+{
+    if (Address < TEST_KD_BATCH_MEMORY_ADDRESS ||
+        Size > TEST_KD_BATCH_MEMORY_SIZE ||
+        Address - TEST_KD_BATCH_MEMORY_ADDRESS > TEST_KD_BATCH_MEMORY_SIZE - Size)
+    {
+        return NULL;
+    }
+
+    return &Debuggee->Memory[Address - TEST_KD_BATCH_MEMORY_ADDRESS];
+}
+
+/**
+ * @brief Read the stubbed memory (back end of the batch operations)
+ *
+ * @param ReadMemRequest
+ * @param TargetBuffer
+ * @param ReturnSize
+ * @param Context The stubbed debuggee
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestKdBatchReadMemory(PDEBUGGER_READ_MEMORY ReadMemRequest, UCHAR * TargetBuffer, UINT32 * ReturnSize, PVOID Context)
+{
+    BYTE * Memory = TestKdBatchGetMemory((PTEST_KD_BATCH_DEBUGGEE)Context, ReadMemRequest->Address, ReadMemRequest->Size);
+
+    if (Memory == NULL)
+    {
+        return FALSE;
+    }
+
+    memcpy(TargetBuffer, Memory, ReadMemRequest->Size);
+    *ReturnSize = ReadMemRequest->Size;
+
+    return TRUE;
+}
+
+/**
+ * @brief Edit the stubbed memory (back end of the batch operations)
+ *
+ * @param EditMemRequest
+ * @param Context The stubbed debuggee
+ *
+ * @return VOID
+ */
+static VOID
+TestKdBatchEditMemory(PDEBUGGER_EDIT_MEMORY EditMemRequest, PVOID Context)
+{
+    UINT64 * Chunks            = (UINT64 *)((CHAR *)EditMemRequest + SIZEOF_DEBUGGER_EDIT_MEMORY);
+    UINT32   LengthOfEachChunk = EditMemRequest->ByteSize == EDIT_QWORD ? sizeof(UINT64) : sizeof(BYTE);
+    BYTE *   Memory;
+
+    Memory = TestKdBatchGetMemory((PTEST_KD_BATCH_DEBUGGEE)Context,
+                                  EditMemRequest->Address,
+                                  (UINT64)EditMemRequest->CountOf64Chunks * LengthOfEachChunk);
+
+    if (Memory == NULL)
+    {
+        EditMemRequest->Result = DEBUGGER_ERROR_INVALID_ADDRESS;
+        return;
+    }
+
+    for (UINT32 i = 0; i < EditMemRequest->CountOf64Chunks; i++)
+    {
+        memcpy(&Memory[i * LengthOfEachChunk], &Chunks[i], LengthOfEachChunk);
+    }
+
+    EditMemRequest->Result = DEBUGGER_OPERATION_WAS_SUCCESSFUL;
+}
+
+/**
+ * @brief Read the stubbed registers (back end of the batch operations)
+ *
+ * @param ReadRegisterRequest
+ * @param Context The stubbed debuggee
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestKdBatchReadRegister(PDEBUGGEE_REGISTER_READ_DESCRIPTION ReadRegisterRequest, PVOID Context)
+{
+    PTEST_KD_BATCH_DEBUGGEE Debuggee = (PTEST_KD_BATCH_DEBUGGEE)Context;
+    CHAR *                  AllRegisters;
+
+    if (ReadRegisterRequest->RegisterId == DEBUGGEE_SHOW_ALL_REGISTERS)
+    {
+        AllRegisters = (CHAR *)ReadRegisterRequest + sizeof(DEBUGGEE_REGISTER_READ_DESCRIPTION);
+
+        for (UINT32 i = 0; i < sizeof(GUEST_REGS) + sizeof(GUEST_EXTRA_REGISTERS); i++)
+        {
+            AllRegisters[i] = (CHAR)i;
+        }
+
+        return TRUE;
+    }
+
+    if (ReadRegisterRequest->RegisterId >= TEST_KD_BATCH_REGISTERS)
+    {
+        return FALSE;
+    }
+
+    ReadRegisterRequest->Value = Debuggee->Registers[ReadRegisterRequest->RegisterId];
+
+    return TRUE;
+}
+
+/**
+ * @brief Write the stubbed registers (back end of the batch operations)
+ *
+ * @param RegisterId
+ * @param Value
+ * @param Context The stubbed debuggee
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestKdBatchWriteRegister(UINT32 RegisterId, UINT64 Value, PVOID Context)
+{
+    if (RegisterId >= TEST_KD_BATCH_REGISTERS)
+    {
+        return FALSE;
+    }
+
+    ((PTEST_KD_BATCH_DEBUGGEE)Context)->Registers[RegisterId] = Value;
+
+    return TRUE;
+}
+
+/**
+ * @brief Set a stubbed breakpoint (back end of the batch operations)
+ *
+ * @param BpRequest
+ * @param Context The stubbed debuggee
+ *
+ * @return VOID
+ */
+static VOID
+TestKdBatchSetBreakpoint(PDEBUGGEE_BP_PACKET BpRequest, PVOID Context)
+{
+    PTEST_KD_BATCH_DEBUGGEE Debuggee = (PTEST_KD_BATCH_DEBUGGEE)Context;
+
+    Debuggee->Breakpoints[++Debuggee->NextBreakpointId] = BpRequest->Address;
+    BpRequest->Result                                   = DEBUGGER_OPERATION_WAS_SUCCESSFUL;
+}
+
+/**
+ * @brief Clear a stubbed breakpoint (back end of the batch operations)
+ *
+ * @param BpModifyRequest
+ * @param Context The stubbed debuggee
+ *
+ * @return VOID
+ */
+static VOID
+TestKdBatchModifyBreakpoint(PDEBUGGEE_BP_LIST_OR_MODIFY_PACKET BpModifyRequest, PVOID Context)
+{
+    if (((PTEST_KD_BATCH_DEBUGGEE)Context)->Breakpoints.erase(BpModifyRequest->BreakpointId) != 0)
+    {
+        BpModifyRequest->Result = DEBUGGER_OPERATION_WAS_SUCCESSFUL;
+    }
+    else
+    {
+        BpModifyRequest->Result = DEBUGGER_ERROR_BREAKPOINT_ID_NOT_FOUND;
+    }
+}
+
+/**
+ * @brief Accept the page-in request (back end of the batch operations)
+ *
+ * @param PageinRequest
+ * @param Context not used
+ *
+ * @return VOID
+ */
+static VOID
+TestKdBatchPagein(PDEBUGGER_PAGE_IN_REQUEST PageinRequest, PVOID Context)
+{
+    UNREFERENCED_PARAMETER(Context);
+
+    PageinRequest->KernelStatus = DEBUGGER_OPERATION_WAS_SUCCESSFUL;
+}
+
+/**
+ * @brief Perform the batch on the stubbed debuggee
+ * @details the packet is validated and performed by the same component
+ * as hyperkd (KdPerformBatchOperations)
+ *
+ * @param Debuggee
+ * @param BatchPacket
+ * @param BatchPacketSize
+ *
+ * @return UINT32 size of the result
+ */
+static UINT32
+TestKdBatchPerform(PTEST_KD_BATCH_DEBUGGEE Debuggee,
+                   PDEBUGGEE_BATCH_PACKET  BatchPacket,
+                   UINT32                  BatchPacketSize)
+{
+    BATCH_OPERATIONS_BACK_END BackEnd = {
+        TestKdBatchReadMemory,
+        TestKdBatchEditMemory,
+        TestKdBatchReadRegister,
+        TestKdBatchWriteRegister,
+        TestKdBatchSetBreakpoint,
+        TestKdBatchModifyBreakpoint,
+        TestKdBatchPagein,
+        Debuggee,
+    };
+
+    return BatchOperationsPerform(BatchPacket,
+                                  BatchPacketSize,
+                                  Debuggee->Response.data(),
+                                  (UINT32)Debuggee->Response.size(),
+                                  &BackEnd);
+}
+
+/**
+ * @brief Send the batch to the stubbed debuggee and parse the result
+ * @details the same steps as KdBatchExecute (without the serial connection)
+ *
+ * @param Batch
+ * @param Debuggee
+ *
+ * @return BOOLEAN TRUE if the result is parsed
+ */
+static BOOLEAN
+TestKdBatchExecute(PKD_BATCH Batch, PTEST_KD_BATCH_DEBUGGEE Debuggee)
+{
+    PDEBUGGEE_BATCH_PACKET BatchPacket = KdBatchPrepareRequest(Batch);
+    UINT32                 ResultSize;
+
+    ResultSize = TestKdBatchPerform(Debuggee, BatchPacket, (UINT32)Batch->Request.size());
+
+    //
+    // The debugger receives the response into the result of the batch
+    //
+    if (ResultSize > Batch->Result.size())
+    {
+        return FALSE;
+    }
+
+    memcpy(Batch->Result.data(), Debuggee->Response.data(), ResultSize);
+
+    if (!KdBatchParseResult(Batch, (UINT32)Batch->Result.size()))
+    {
+        return FALSE;
+    }
+
+    Batch->IsExecuted = TRUE;
+
+    return TRUE;
+}
+
+/**
+ * @brief Check the layout of the request of a batch
+ *
+ * @param Batch
+ * @param ExpectedSizes the expected size of the request of each operation
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestKdBatchCheckRequest(PKD_BATCH Batch, const std::vector<UINT32> & ExpectedSizes)
+{
+    BOOLEAN                          Result = TRUE;
+    UINT32                           Offset = sizeof(DEBUGGEE_BATCH_PACKET);
+    PDEBUGGEE_BATCH_OPERATION_HEADER Operation;
+
+    UnitTestExpect(Result, Batch->OperationTypes.size() == ExpectedSizes.size());
+
+    for (UINT32 i = 0; Result && i < ExpectedSizes.size(); i++)
+    {
+        UnitTestExpect(Result, Offset % DEBUGGEE_BATCH_OPERATION_ALIGNMENT == 0);
+        UnitTestExpect(Result, Offset + sizeof(DEBUGGEE_BATCH_OPERATION_HEADER) + ExpectedSizes[i] <= Batch->Request.size());
+
+        if (!Result)
+        {
+            break;
+        }
+
+        Operation = (PDEBUGGEE_BATCH_OPERATION_HEADER)&Batch->Request[Offset];
+
+        UnitTestExpect(Result, Operation->Type == (UINT32)Batch->OperationTypes[i]);
+        UnitTestExpect(Result, Operation->Size == ExpectedSizes[i]);
+        UnitTestExpect(Result, Operation->KernelStatus == 0 && Operation->Reserved == 0);
+
+        //
+        // The alignment is zero-filled
+        //
+        for (UINT32 j = Offset + sizeof(DEBUGGEE_BATCH_OPERATION_HEADER) + Operation->Size;
+             j < Offset + DEBUGGEE_BATCH_OPERATION_SIZE(Operation->Size);
+             j++)
+        {
+            UnitTestExpect(Result, Batch->Request[j] == 0);
+        }
+
+        Offset += DEBUGGEE_BATCH_OPERATION_SIZE(Operation->Size);
+    }
+
+    UnitTestExpect(Result, Offset == Batch->Request.size());
+
+    return Result;
+}
+
+/**
+ * @brief Test the encoding of the operations and the rejected operations
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestKdBatchEncoding()
+{
+    BOOLEAN                Result    = TRUE;
+    PKD_BATCH              Batch     = KdBatchCreate();
+    BYTE                   Bytes[16] = {0};
+    UINT32                 Index     = (UINT32)-1;
+    PDEBUGGEE_BATCH_PACKET BatchPacket;
+    UINT32                 RequestSize;
+    UINT32                 ExpectedResultSize;
+
+    if (Batch == NULL)
+    {
+        return FALSE;
+    }
+
+    UnitTestExpect(Result, KdBatchAddReadMemory(Batch, TEST_KD_BATCH_MEMORY_ADDRESS, DEBUGGER_READ_VIRTUAL_ADDRESS, 13, &Index) && Index == 0);
+    UnitTestExpect(Result, KdBatchAddWriteMemory(Batch, TEST_KD_BATCH_MEMORY_ADDRESS, EDIT_VIRTUAL_MEMORY, Bytes, 16, &Index) && Index == 1);
+    UnitTestExpect(Result, KdBatchAddWriteMemory(Batch, TEST_KD_BATCH_MEMORY_ADDRESS, EDIT_VIRTUAL_MEMORY, Bytes, 3, &Index) && Index == 2);
+    UnitTestExpect(Result, KdBatchAddReadRegister(Batch, 1, &Index) && Index == 3);
+    UnitTestExpect(Result, KdBatchAddReadRegister(Batch, DEBUGGEE_SHOW_ALL_REGISTERS, &Index) && Index == 4);
+    UnitTestExpect(Result, KdBatchAddWriteRegister(Batch, 2, 0x1234, &Index) && Index == 5);
+    UnitTestExpect(Result, KdBatchAddSetBreakpoint(Batch, TEST_KD_BATCH_MEMORY_ADDRESS, 4, 8, 0, &Index) && Index == 6);
+    UnitTestExpect(Result, KdBatchAddClearBreakpoint(Batch, 1, &Index) && Index == 7);
+    UnitTestExpect(Result, KdBatchAddPagein(Batch, 0x10000, 0x20000, 0, &Index) && Index == 8);
+
+    UnitTestExpect(Result, TestKdBatchCheckRequest(Batch,
+                                                   {sizeof(DEBUGGER_READ_MEMORY),
+                                                    SIZEOF_DEBUGGER_EDIT_MEMORY + 2 * sizeof(UINT64),
+                                                    SIZEOF_DEBUGGER_EDIT_MEMORY + 3 * sizeof(UINT64),
+                                                    sizeof(DEBUGGEE_REGISTER_READ_DESCRIPTION),
+                                                    sizeof(DEBUGGEE_REGISTER_READ_DESCRIPTION),
+                                                    sizeof(DEBUGGEE_REGISTER_WRITE_DESCRIPTION),
+                                                    sizeof(DEBUGGEE_BP_PACKET),
+                                                    sizeof(DEBUGGEE_BP_LIST_OR_MODIFY_PACKET),
+                                                    sizeof(DEBUGGER_PAGE_IN_REQUEST)}));
+
+    ExpectedResultSize = sizeof(DEBUGGEE_BATCH_PACKET) +
+                         DEBUGGEE_BATCH_OPERATION_SIZE(sizeof(DEBUGGER_READ_MEMORY) + 13) +
+                         2 * DEBUGGEE_BATCH_OPERATION_SIZE(SIZEOF_DEBUGGER_EDIT_MEMORY) +
+                         DEBUGGEE_BATCH_OPERATION_SIZE(sizeof(DEBUGGEE_REGISTER_READ_DESCRIPTION)) +
+                         DEBUGGEE_BATCH_OPERATION_SIZE(sizeof(DEBUGGEE_REGISTER_READ_DESCRIPTION) + sizeof(GUEST_REGS) + sizeof(GUEST_EXTRA_REGISTERS)) +
+                         DEBUGGEE_BATCH_OPERATION_SIZE(sizeof(DEBUGGEE_REGISTER_WRITE_DESCRIPTION)) +
+                         DEBUGGEE_BATCH_OPERATION_SIZE(sizeof(DEBUGGEE_BP_PACKET)) +
+                         DEBUGGEE_BATCH_OPERATION_SIZE(sizeof(DEBUGGEE_BP_LIST_OR_MODIFY_PACKET)) +
+                         DEBUGGEE_BATCH_OPERATION_SIZE(sizeof(DEBUGGER_PAGE_IN_REQUEST));
+
+    UnitTestExpect(Result, Batch->ExpectedResultSize == ExpectedResultSize);
+
+    //
+    // Rejected operations don't change the batch
+    //
+    RequestSize = (UINT32)Batch->Request.size();
+
+    UnitTestExpect(Result, !KdBatchAddPagein(Batch, 0x30000, 0x40000, 0, &Index));
+    UnitTestExpect(Result, !KdBatchAddReadMemory(Batch, TEST_KD_BATCH_MEMORY_ADDRESS, DEBUGGER_READ_VIRTUAL_ADDRESS, 0, &Index));
+    UnitTestExpect(Result, !KdBatchAddReadMemory(Batch, TEST_KD_BATCH_MEMORY_ADDRESS, DEBUGGER_READ_VIRTUAL_ADDRESS, MaxBatchPacketSize, &Index));
+    UnitTestExpect(Result, !KdBatchAddWriteMemory(Batch, TEST_KD_BATCH_MEMORY_ADDRESS, EDIT_VIRTUAL_MEMORY, Bytes, MaxBatchPacketSize, &Index));
+    UnitTestExpect(Result, !KdBatchAddWriteMemory(Batch, TEST_KD_BATCH_MEMORY_ADDRESS, EDIT_VIRTUAL_MEMORY, NULL, 8, &Index));
+
+    UnitTestExpect(Result, Batch->Request.size() == RequestSize);
+    UnitTestExpect(Result, Batch->OperationTypes.size() == 9);
+    UnitTestExpect(Result, Batch->ExpectedResultSize == ExpectedResultSize);
+
+    //
+    // The header of the request is filled once it's sent
+    //
+    BatchPacket = KdBatchPrepareRequest(Batch);
+
+    UnitTestExpect(Result, BatchPacket->NumberOfOperations == 9);
+    UnitTestExpect(Result, BatchPacket->TotalSize == RequestSize);
+    UnitTestExpect(Result, Batch->Result.size() == ExpectedResultSize);
+
+    KdBatchFree(Batch);
+
+    //
+    // Operations are added until the result doesn't fit in the batch
+    //
+    Batch = KdBatchCreate();
+
+    if (Batch == NULL)
+    {
+        return FALSE;
+    }
+
+    while (KdBatchAddReadMemory(Batch, TEST_KD_BATCH_MEMORY_ADDRESS, DEBUGGER_READ_VIRTUAL_ADDRESS, NORMAL_PAGE_SIZE, &Index))
+    {
+    }
+
+    UnitTestExpect(Result, Batch->ExpectedResultSize <= MaxBatchPacketSize);
+    UnitTestExpect(Result, Batch->ExpectedResultSize + DEBUGGEE_BATCH_OPERATION_SIZE(sizeof(DEBUGGER_READ_MEMORY) + NORMAL_PAGE_SIZE) > MaxBatchPacketSize);
+    UnitTestExpect(Result, Index + 1 == Batch->OperationTypes.size());
+
+    KdBatchFree(Batch);
+
+    return Result;
+}
+
+/**
+ * @brief Test the results of the operations which are performed on the
+ * stubbed debuggee
+ *
+ * @param Debuggee
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestKdBatchRoundTrip(PTEST_KD_BATCH_DEBUGGEE Debuggee)
+{
+    BOOLEAN           Result     = TRUE;
+    PKD_BATCH         Batch      = KdBatchCreate();
+    BYTE              Bytes[3]   = {0xaa, 0xbb, 0xcc};
+    BYTE              Buffer[64] = {0};
+    UINT64            Value      = 0;
+    std::vector<BYTE> AllRegisters(sizeof(GUEST_REGS) + sizeof(GUEST_EXTRA_REGISTERS), 0xff);
+    BYTE              Qwords[16];
+    UINT32            KernelStatus;
+    UINT32            ReturnLength;
+    UINT32            NumberOfPerformedOperations;
+
+    if (Batch == NULL)
+    {
+        return FALSE;
+    }
+
+    for (UINT32 i = 0; i < sizeof(Qwords); i++)
+    {
+        Qwords[i] = (BYTE)(0xf0 - i);
+    }
+
+    //
+    // Operations are performed in order, so the reads after the writes
+    // return the written values
+    //
+    KdBatchAddReadMemory(Batch, TEST_KD_BATCH_MEMORY_ADDRESS + 0x10, DEBUGGER_READ_VIRTUAL_ADDRESS, 13, NULL);
+    KdBatchAddWriteMemory(Batch, TEST_KD_BATCH_MEMORY_ADDRESS + 0x10, EDIT_VIRTUAL_MEMORY, Qwords, 16, NULL);
+    KdBatchAddWriteMemory(Batch, TEST_KD_BATCH_MEMORY_ADDRESS + 0x21, EDIT_VIRTUAL_MEMORY, Bytes, 3, NULL);
+    KdBatchAddReadMemory(Batch, TEST_KD_BATCH_MEMORY_ADDRESS + 0x10, DEBUGGER_READ_VIRTUAL_ADDRESS, 0x20, NULL);
+    KdBatchAddReadMemory(Batch, TEST_KD_BATCH_MEMORY_ADDRESS + TEST_KD_BATCH_MEMORY_SIZE - 4, DEBUGGER_READ_VIRTUAL_ADDRESS, 8, NULL);
+    KdBatchAddReadRegister(Batch, 5, NULL);
+    KdBatchAddWriteRegister(Batch, 5, 0xdeadbeefcafe, NULL);
+    KdBatchAddReadRegister(Batch, 5, NULL);
+    KdBatchAddReadRegister(Batch, TEST_KD_BATCH_REGISTERS, NULL);
+    KdBatchAddReadRegister(Batch, DEBUGGEE_SHOW_ALL_REGISTERS, NULL);
+    KdBatchAddSetBreakpoint(Batch, TEST_KD_BATCH_MEMORY_ADDRESS, 0, 0, 0, NULL);
+    KdBatchAddClearBreakpoint(Batch, 1, NULL);
+    KdBatchAddClearBreakpoint(Batch, 1, NULL);
+    KdBatchAddPagein(Batch, 0x10000, 0x20000, 0, NULL);
+
+    UnitTestExpect(Result, Batch->OperationTypes.size() == 14);
+    UnitTestExpect(Result, TestKdBatchExecute(Batch, Debuggee));
+
+    NumberOfPerformedOperations = ((PDEBUGGEE_BATCH_PACKET)Batch->Result.data())->NumberOfPerformedOperations;
+
+    UnitTestExpect(Result, NumberOfPerformedOperations == 14);
+    UnitTestExpect(Result, ((PDEBUGGEE_BATCH_PACKET)Batch->Result.data())->KernelStatus == DEBUGGER_OPERATION_WAS_SUCCESSFUL);
+
+    //
+    // Memory
+    //
+    UnitTestExpect(Result, KdBatchGetResult(Batch, 0, &KernelStatus, Buffer, sizeof(Buffer), &ReturnLength));
+    UnitTestExpect(Result, KernelStatus == DEBUGGER_OPERATION_WAS_SUCCESSFUL && ReturnLength == 13);
+
+    for (UINT32 i = 0; i < 13; i++)
+    {
+        UnitTestExpect(Result, Buffer[i] == (BYTE)((0x10 + i) * 7 + 3));
+    }
+
+    UnitTestExpect(Result, KdBatchGetResult(Batch, 1, &KernelStatus, NULL, 0, &ReturnLength));
+    UnitTestExpect(Result, KernelStatus == DEBUGGER_OPERATION_WAS_SUCCESSFUL && ReturnLength == 0);
+
+    UnitTestExpect(Result, KdBatchGetResult(Batch, 3, &KernelStatus, Buffer, sizeof(Buffer), &ReturnLength));
+    UnitTestExpect(Result, KernelStatus == DEBUGGER_OPERATION_WAS_SUCCESSFUL && ReturnLength == 0x20);
+    UnitTestExpect(Result, memcmp(Buffer, Qwords, sizeof(Qwords)) == 0);
+    UnitTestExpect(Result, Buffer[0x10] == (BYTE)(0x20 * 7 + 3));
+    UnitTestExpect(Result, memcmp(&Buffer[0x11], Bytes, sizeof(Bytes)) == 0);
+    UnitTestExpect(Result, Buffer[0x14] == (BYTE)(0x24 * 7 + 3));
+
+    UnitTestExpect(Result, KdBatchGetResult(Batch, 4, &KernelStatus, Buffer, sizeof(Buffer), &ReturnLength));
+    UnitTestExpect(Result, KernelStatus == DEBUGGER_ERROR_INVALID_ADDRESS && ReturnLength == 0);
+
+    //
+    // The result is truncated to the size of the buffer
+    //
+    memset(Buffer, 0, sizeof(Buffer));
+
+    UnitTestExpect(Result, KdBatchGetResult(Batch, 3, &KernelStatus, Buffer, 4, &ReturnLength));
+    UnitTestExpect(Result, ReturnLength == 0x20 && memcmp(Buffer, Qwords, 4) == 0 && Buffer[4] == 0);
+
+    //
+    // Registers
+    //
+    UnitTestExpect(Result, KdBatchGetResult(Batch, 5, &KernelStatus, &Value, sizeof(Value), &ReturnLength));
+    UnitTestExpect(Result, KernelStatus == DEBUGGER_OPERATION_WAS_SUCCESSFUL && ReturnLength == sizeof(UINT64) && Value == 0x5555555555555555ull);
+
+    UnitTestExpect(Result, KdBatchGetResult(Batch, 6, &KernelStatus, NULL, 0, &ReturnLength));
+    UnitTestExpect(Result, KernelStatus == DEBUGGER_OPERATION_WAS_SUCCESSFUL && ReturnLength == 0);
+
+    UnitTestExpect(Result, KdBatchGetResult(Batch, 7, &KernelStatus, &Value, sizeof(Value), &ReturnLength));
+    UnitTestExpect(Result, KernelStatus == DEBUGGER_OPERATION_WAS_SUCCESSFUL && Value == 0xdeadbeefcafe);
+
+    UnitTestExpect(Result, KdBatchGetResult(Batch, 8, &KernelStatus, &Value, sizeof(Value), &ReturnLength));
+    UnitTestExpect(Result, KernelStatus == DEBUGGER_ERROR_INVALID_REGISTER_NUMBER);
+
+    UnitTestExpect(Result, KdBatchGetResult(Batch, 9, &KernelStatus, AllRegisters.data(), (UINT32)AllRegisters.size(), &ReturnLength));
+    UnitTestExpect(Result, KernelStatus == DEBUGGER_OPERATION_WAS_SUCCESSFUL && ReturnLength == AllRegisters.size());
+    UnitTestExpect(Result, AllRegisters[0] == 0 && AllRegisters[AllRegisters.size() - 1] == (BYTE)(AllRegisters.size() - 1));
+
+    //
+    // Breakpoints (the second clear doesn't find the breakpoint) and page-in
+    //
+    UnitTestExpect(Result, KdBatchGetResult(Batch, 10, &KernelStatus, NULL, 0, NULL) && KernelStatus == DEBUGGER_OPERATION_WAS_SUCCESSFUL);
+    UnitTestExpect(Result, KdBatchGetResult(Batch, 11, &KernelStatus, NULL, 0, NULL) && KernelStatus == DEBUGGER_OPERATION_WAS_SUCCESSFUL);
+    UnitTestExpect(Result, KdBatchGetResult(Batch, 12, &KernelStatus, NULL, 0, NULL) && KernelStatus == DEBUGGER_ERROR_BREAKPOINT_ID_NOT_FOUND);
+    UnitTestExpect(Result, KdBatchGetResult(Batch, 13, &KernelStatus, NULL, 0, NULL) && KernelStatus == DEBUGGER_OPERATION_WAS_SUCCESSFUL);
+    UnitTestExpect(Result, Debuggee->Breakpoints.empty());
+
+    UnitTestExpect(Result, !KdBatchGetResult(Batch, 14, &KernelStatus, NULL, 0, NULL));
+
+    //
+    // Adding an operation invalidates the result
+    //
+    KdBatchAddReadRegister(Batch, 0, NULL);
+
+    UnitTestExpect(Result, !KdBatchGetResult(Batch, 0, &KernelStatus, NULL, 0, NULL));
+
+    KdBatchFree(Batch);
+
+    return Result;
+}
+
+/**
+ * @brief Test the batches that are stopped by an invalid operation
+ *
+ * @param Debuggee
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestKdBatchInvalidOperation(PTEST_KD_BATCH_DEBUGGEE Debuggee)
+{
+    BOOLEAN                          Result = TRUE;
+    PKD_BATCH                        Batch  = KdBatchCreate();
+    PDEBUGGEE_BATCH_PACKET           BatchResult;
+    PDEBUGGEE_BATCH_OPERATION_HEADER Operation;
+    UINT32                           KernelStatus;
+    UINT64                           Value;
+
+    if (Batch == NULL)
+    {
+        return FALSE;
+    }
+
+    KdBatchAddWriteRegister(Batch, 3, 0x33, NULL);
+    KdBatchAddReadRegister(Batch, 3, NULL);
+    KdBatchAddWriteRegister(Batch, 3, 0x44, NULL);
+    KdBatchAddReadRegister(Batch, 3, NULL);
+
+    //
+    // The third operation is corrupted, the operations after it are
+    // not performed
+    //
+    Operation = (PDEBUGGEE_BATCH_OPERATION_HEADER)&Batch->Request[sizeof(DEBUGGEE_BATCH_PACKET) +
+                                                                  2 * DEBUGGEE_BATCH_OPERATION_SIZE(sizeof(DEBUGGEE_REGISTER_WRITE_DESCRIPTION))];
+    Operation->Type = 0x99;
+
+    UnitTestExpect(Result, TestKdBatchExecute(Batch, Debuggee));
+
+    BatchResult = (PDEBUGGEE_BATCH_PACKET)Batch->Result.data();
+
+    UnitTestExpect(Result, BatchResult->NumberOfPerformedOperations == 2);
+    UnitTestExpect(Result, BatchResult->KernelStatus == DEBUGGER_ERROR_INVALID_BATCH_OPERATION);
+    UnitTestExpect(Result, KdBatchGetResult(Batch, 1, &KernelStatus, &Value, sizeof(Value), NULL) && Value == 0x33);
+    UnitTestExpect(Result, !KdBatchGetResult(Batch, 2, &KernelStatus, NULL, 0, NULL));
+    UnitTestExpect(Result, Debuggee->Registers[3] == 0x33);
+
+    //
+    // An operation which is bigger than the packet is not performed
+    //
+    Operation       = (PDEBUGGEE_BATCH_OPERATION_HEADER)&Batch->Request[sizeof(DEBUGGEE_BATCH_PACKET)];
+    Operation->Size = (UINT32)Batch->Request.size();
+
+    UnitTestExpect(Result, TestKdBatchExecute(Batch, Debuggee));
+    UnitTestExpect(Result, ((PDEBUGGEE_BATCH_PACKET)Batch->Result.data())->NumberOfPerformedOperations == 0);
+    UnitTestExpect(Result, ((PDEBUGGEE_BATCH_PACKET)Batch->Result.data())->KernelStatus == DEBUGGER_ERROR_INVALID_BATCH_OPERATION);
+
+    KdBatchFree(Batch);
+
+    return Result;
+}
+
+/**
+ * @brief Test the malformed results which are rejected by the parser
+ *
+ * @param Debuggee
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestKdBatchMalformedResults(PTEST_KD_BATCH_DEBUGGEE Debuggee)
+{
+    BOOLEAN                          Result = TRUE;
+    PKD_BATCH                        Batch  = KdBatchCreate();
+    std::vector<CHAR>                ValidResult;
+    PDEBUGGEE_BATCH_PACKET           BatchResult;
+    PDEBUGGEE_BATCH_OPERATION_HEADER Operation;
+    UINT64                           Random = 0x5eed;
+    UINT32                           ResultSize;
+    UINT32                           NumberOfCorruptedBytes;
+
+    if (Batch == NULL)
+    {
+        return FALSE;
+    }
+
+    KdBatchAddReadMemory(Batch, TEST_KD_BATCH_MEMORY_ADDRESS, DEBUGGER_READ_VIRTUAL_ADDRESS, 24, NULL);
+    KdBatchAddReadRegister(Batch, 1, NULL);
+
+    UnitTestExpect(Result, TestKdBatchExecute(Batch, Debuggee));
+
+    ValidResult = Batch->Result;
+    BatchResult = (PDEBUGGEE_BATCH_PACKET)Batch->Result.data();
+    Operation   = (PDEBUGGEE_BATCH_OPERATION_HEADER)&Batch->Result[sizeof(DEBUGGEE_BATCH_PACKET)];
+
+    //
+    // Truncated result
+    //
+    UnitTestExpect(Result, !KdBatchParseResult(Batch, sizeof(DEBUGGEE_BATCH_PACKET) - 1));
+    UnitTestExpect(Result, !KdBatchParseResult(Batch, BatchResult->TotalSize - 1));
+    UnitTestExpect(Result, !KdBatchParseResult(Batch, (UINT32)Batch->Result.size() + 1));
+
+    //
+    // More performed operations than the operations of the batch
+    //
+    BatchResult->NumberOfPerformedOperations = 3;
+    UnitTestExpect(Result, !KdBatchParseResult(Batch, (UINT32)Batch->Result.size()));
+    Batch->Result = ValidResult;
+
+    //
+    // The type of the result is not the type of the operation
+    //
+    Operation->Type = DEBUGGEE_BATCH_OPERATION_TYPE_READ_REGISTER;
+    UnitTestExpect(Result, !KdBatchParseResult(Batch, (UINT32)Batch->Result.size()));
+    Batch->Result = ValidResult;
+
+    //
+    // The size of the result is outside of the result
+    //
+    Operation->Size = BatchResult->TotalSize;
+    UnitTestExpect(Result, !KdBatchParseResult(Batch, (UINT32)Batch->Result.size()));
+    Batch->Result = ValidResult;
+
+    UnitTestExpect(Result, KdBatchParseResult(Batch, (UINT32)Batch->Result.size()));
+    UnitTestExpect(Result, Batch->ResultOffsets.size() == 2);
+
+    //
+    // Randomized results are either rejected or all of the operations are
+    // inside the result
+    //
+    for (UINT32 i = 0; i < TEST_KD_BATCH_RANDOM_RESULTS; i++)
+    {
+        Batch->Result = ValidResult;
+        ResultSize    = (UINT32)Batch->Result.size();
+
+        NumberOfCorruptedBytes = 1 + UnitTestGetRandom(&Random) % 4;
+
+        for (UINT32 j = 0; j < NumberOfCorruptedBytes; j++)
+        {
+            Batch->Result[UnitTestGetRandom(&Random) % Batch->Result.size()] = (CHAR)UnitTestGetRandom(&Random);
+        }
+
+        if (KdBatchParseResult(Batch, ResultSize))
+        {
+            BatchResult = (PDEBUGGEE_BATCH_PACKET)Batch->Result.data();
+
+            for (UINT32 Offset : Batch->ResultOffsets)
+            {
+                Operation = (PDEBUGGEE_BATCH_OPERATION_HEADER)&Batch->Result[Offset];
+
+                UnitTestExpect(Result, Offset + sizeof(DEBUGGEE_BATCH_OPERATION_HEADER) + Operation->Size <= BatchResult->TotalSize);
+                UnitTestExpect(Result, BatchResult->TotalSize <= ResultSize);
+            }
+        }
+    }
+
+    KdBatchFree(Batch);
+
+    return Result;
+}
+
+/**
+ * @brief Encode/decode tests of the batch operations
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+TestKdBatch()
+{
+    BOOLEAN                 Result = TRUE;
+    PVOID                   MessageHandler;
+    PTEST_KD_BATCH_DEBUGGEE Debuggee = new TEST_KD_BATCH_DEBUGGEE;
+
+    //
+    // Rejected operations show an error
+    //
+    MessageHandler   = g_MessageHandler;
+    g_MessageHandler = (PVOID)TestKdBatchMessageHandler;
+
+    TestKdBatchInitializeDebuggee(Debuggee);
+
+    UnitTestExpect(Result, TestKdBatchEncoding());
+    UnitTestExpect(Result, TestKdBatchRoundTrip(Debuggee));
+    UnitTestExpect(Result, TestKdBatchInvalidOperation(Debuggee));
+    UnitTestExpect(Result, TestKdBatchMalformedResults(Debuggee));
+
+    g_MessageHandler = MessageHandler;
+
+    delete Debuggee;
+
+    return Result;
+}
+
+/**
+ * @brief Time of sending a packet over the simulated link
+ *
+ * @param PayloadSize size of the packet without the headers
+ *
+ * @return UINT64 nanoseconds
+ */
+static UINT64
+TestKdBatchGetLinkTime(UINT64 PayloadSize)
+{
+    UINT64 PacketSize = sizeof(DEBUGGER_REMOTE_PACKET) + PayloadSize + SERIAL_END_OF_BUFFER_CHARS_COUNT;
+
+    return PacketSize * 10 * 1000000000ull / TEST_KD_BATCH_LINK_BAUD_RATE;
+}
+
+/**
+ * @brief Benchmark of the batch operations
+ * @details the simulated link compares sending each read as a separate
+ * round trip (the 'db' command) with a batch of the same reads, and the
+ * cost of encoding and decoding the batches is measured
+ *
+ * @return VOID
+ */
+VOID
+BenchmarkKdBatch()
+{
+    static const UINT32     NumberOfReads[] = {1, 4, 16, 64, 256};
+    PTEST_KD_BATCH_DEBUGGEE Debuggee        = new TEST_KD_BATCH_DEBUGGEE;
+    PKD_BATCH               Batch;
+    UINT64                  SeparateTime;
+    UINT64                  BatchTime;
+    UINT64                  StartTime;
+    UINT64                  Value;
+    UINT32                  NumberOfOperations = 0;
+    CHAR                    Name[64];
+
+    TestKdBatchInitializeDebuggee(Debuggee);
+
+    for (UINT32 Reads : NumberOfReads)
+    {
+        //
+        // Reads of 8 bytes, each one as a separate round trip
+        //
+        SeparateTime = Reads * (TestKdBatchGetLinkTime(sizeof(DEBUGGER_READ_MEMORY)) +
+                                TestKdBatchGetLinkTime(sizeof(DEBUGGER_READ_MEMORY) + sizeof(UINT64)) +
+                                TEST_KD_BATCH_LINK_TURNAROUND_NS);
+
+        Batch = KdBatchCreate();
+
+        for (UINT32 i = 0; i < Reads; i++)
+        {
+            KdBatchAddReadMemory(Batch, TEST_KD_BATCH_MEMORY_ADDRESS + (i * 8) % TEST_KD_BATCH_MEMORY_SIZE, DEBUGGER_READ_VIRTUAL_ADDRESS, 8, NULL);
+        }
+
+        BatchTime = TestKdBatchGetLinkTime(Batch->Request.size()) +
+                    TestKdBatchGetLinkTime(Batch->ExpectedResultSize) +
+                    TEST_KD_BATCH_LINK_TURNAROUND_NS;
+
+        KdBatchFree(Batch);
+
+        sprintf_s(Name, sizeof(Name), "simulated link, %u separate reads", Reads);
+        UnitTestShowBenchmarkResult(Name, SeparateTime, Reads);
+
+        sprintf_s(Name, sizeof(Name), "simulated link, batch of %u reads", Reads);
+        UnitTestShowBenchmarkResult(Name, BatchTime, Reads);
+    }
+
+    //
+    // Encoding, performing (on the stubbed debuggee) and decoding the batches
+    //
+    StartTime = UnitTestGetTimeInNanoseconds();
+
+    for (UINT32 i = 0; i < TEST_KD_BATCH_BENCHMARK_ITERATIONS; i++)
+    {
+        Batch = KdBatchCreate();
+
+        for (UINT32 j = 0; j < 64; j++)
+        {
+            KdBatchAddReadMemory(Batch, TEST_KD_BATCH_MEMORY_ADDRESS + j * 8, DEBUGGER_READ_VIRTUAL_ADDRESS, 8, NULL);
+        }
+
+        TestKdBatchExecute(Batch, Debuggee);
+
+        for (UINT32 j = 0; j < 64; j++)
+        {
+            KdBatchGetResult(Batch, j, NULL, &Value, sizeof(Value), NULL);
+        }
+
+        NumberOfOperations += 64;
+
+        KdBatchFree(Batch);
+    }
+
+    UnitTestShowBenchmarkResult("encode, perform and decode (64 reads)",
+                                UnitTestGetTimeInNanoseconds() - StartTime,
+                                NumberOfOperations);
+
+    delete Debuggee;
+}
+
+UnitTestRegister("kd-batch", TestKdBatch, BenchmarkKdBatch);
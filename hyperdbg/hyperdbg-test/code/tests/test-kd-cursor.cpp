@@ -0,0 +1,410 @@
+/**
+ * @file test-kd-cursor.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Tests and slice latency measurement of the resumable operations
+ * @details the cursor (KdCursor.c) is shared with hyperkd, the sliced
+ * operation is the multi-pattern search (sm) on a synthetic image, and
+ * the results of the slices are compared with an unsliced search
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Address of the first page of the synthetic images
+ *
+ */
+#define TEST_KD_CURSOR_BASE_ADDRESS 0xfffff80000000000
+
+/**
+ * @brief Number of the pages of the image of the test
+ *
+ */
+#define TEST_KD_CURSOR_TEST_PAGES 2048
+
+/**
+ * @brief Budget (TSC cycles) of each slice in the test, small enough to
+ * have many slices
+ *
+ */
+#define TEST_KD_CURSOR_TEST_SLICE_CYCLES 20000
+
+/**
+ * @brief Size of the image of the slice latency measurement
+ *
+ */
+#define TEST_KD_CURSOR_BENCHMARK_IMAGE_SIZE (256 * 1024 * 1024)
+
+/**
+ * @brief Read a part of a page of the image (like SearchMultiplePatternsReadChunk)
+ * @details every 64th page is not valid
+ *
+ * @param SearchRequest
+ * @param Address
+ * @param Buffer
+ * @param Size
+ * @param Context the image
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestKdCursorReadChunk(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS SearchRequest,
+                      UINT64                             Address,
+                      PVOID                              Buffer,
+                      UINT32                             Size,
+                      PVOID                              Context)
+{
+    std::vector<BYTE> * Image  = (std::vector<BYTE> *)Context;
+    UINT64              Offset = Address - TEST_KD_CURSOR_BASE_ADDRESS;
+
+    UNREFERENCED_PARAMETER(SearchRequest);
+
+    if (Address < TEST_KD_CURSOR_BASE_ADDRESS || Offset + Size > Image->size() || (Offset / PAGE_SIZE) % 64 == 63)
+    {
+        return FALSE;
+    }
+
+    memcpy(Buffer, Image->data() + Offset, Size);
+
+    return TRUE;
+}
+
+/**
+ * @brief Make a search request of a few short patterns (to have many
+ * results) on the whole image
+ *
+ * @param Request
+ * @param Image
+ * @param RandomState
+ *
+ * @return VOID
+ */
+static VOID
+TestKdCursorMakeRequest(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS Request, std::vector<BYTE> & Image, UINT64 * RandomState)
+{
+    RtlZeroMemory(Request, sizeof(DEBUGGER_SEARCH_MULTIPLE_PATTERNS));
+
+    for (BYTE & Byte : Image)
+    {
+        Byte = (BYTE)(UnitTestGetRandom(RandomState) % 8);
+    }
+
+    Request->MemoryType       = SEARCH_VIRTUAL_MEMORY;
+    Request->NumberOfPatterns = 4;
+    Request->NumberOfRanges   = 2;
+    Request->Ranges[0]        = {TEST_KD_CURSOR_BASE_ADDRESS + 0x10, Image.size() / 2};
+    Request->Ranges[1]        = {TEST_KD_CURSOR_BASE_ADDRESS + Image.size() / 2 + 0x123, Image.size() / 2 - 0x123};
+
+    for (UINT32 i = 0; i < Request->NumberOfPatterns; i++)
+    {
+        Request->Patterns[i].Length = 3 + i;
+
+        for (UINT32 j = 0; j < Request->Patterns[i].Length; j++)
+        {
+            Request->Patterns[i].Bytes[j] = (BYTE)(UnitTestGetRandom(RandomState) % 8);
+            Request->Patterns[i].Masks[j] = 0xff;
+        }
+    }
+}
+
+/**
+ * @brief Search the image in slices (like KdPerformSearchMultiplePatterns)
+ *
+ * @param Request
+ * @param Automaton
+ * @param Image
+ * @param SliceCycles the budget of each slice, zero for the default budget
+ * of the cursor
+ * @param Results the results of all of the slices
+ * @param NumberOfSlices
+ * @param MaximumSliceTime the latency of the longest slice (ns)
+ *
+ * @return BOOLEAN whether the request is valid and each slice made progress
+ */
+static BOOLEAN
+TestKdCursorSearch(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS                      Request,
+                   PSEARCH_MULTIPLE_PATTERNS_AUTOMATON                     Automaton,
+                   std::vector<BYTE> &                                     Image,
+                   UINT64                                                  SliceCycles,
+                   std::vector<DEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT> & Results,
+                   UINT32 *                                                NumberOfSlices,
+                   UINT64 *                                                MaximumSliceTime)
+{
+    std::vector<DEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT> SliceResults(MaximumSearchMultiplePatternsResults);
+    KD_CURSOR                                             Cursor     = {0};
+    BOOLEAN                                               IsFinished = FALSE;
+    UINT64                                                StartTime;
+    UINT64                                                SliceTime;
+    UINT64                                                Address;
+    UINT32                                                RangeIndex;
+
+    Results.clear();
+    *NumberOfSlices   = 0;
+    *MaximumSliceTime = 0;
+
+    if (!SearchMultiplePatternsCompile(Request, Automaton))
+    {
+        return FALSE;
+    }
+
+    KdCursorOpen(&Cursor);
+
+    while (!IsFinished)
+    {
+        Address    = Automaton->Address;
+        RangeIndex = Automaton->RangeIndex;
+        StartTime  = UnitTestGetTimeInNanoseconds();
+
+        KdCursorStartSlice(&Cursor);
+
+        if (SliceCycles != 0)
+        {
+            Cursor.SliceDeadline = __rdtsc() + SliceCycles;
+        }
+
+        IsFinished = SearchMultiplePatternsScanRanges(Request,
+                                                      Automaton,
+                                                      SliceResults.data(),
+                                                      TestKdCursorReadChunk,
+                                                      &Image,
+                                                      &Cursor);
+
+        SliceTime = UnitTestGetTimeInNanoseconds() - StartTime;
+
+        if (SliceTime > *MaximumSliceTime)
+        {
+            *MaximumSliceTime = SliceTime;
+        }
+
+        (*NumberOfSlices)++;
+
+        Results.insert(Results.end(), SliceResults.begin(), SliceResults.begin() + Request->NumberOfResults);
+
+        if (!IsFinished && Address == Automaton->Address && RangeIndex == Automaton->RangeIndex && Request->NumberOfResults == 0)
+        {
+            //
+            // Each slice should search at least one chunk
+            //
+            return FALSE;
+        }
+    }
+
+    KdCursorClose(&Cursor);
+
+    return TRUE;
+}
+
+/**
+ * @brief Test the tokens of the cursor
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestKdCursorTokens()
+{
+    BOOLEAN   Result      = TRUE;
+    KD_CURSOR Cursor      = {0};
+    KD_CURSOR OtherCursor = {0};
+    UINT64    Token       = 0;
+    UINT64    PreviousToken;
+
+    //
+    // There is no operation in progress
+    //
+    UnitTestExpect(Result, !KdCursorIsValid(&Cursor, 0));
+    UnitTestExpect(Result, !KdCursorIsValid(&Cursor, 1));
+
+    for (UINT32 i = 0; i < 1000 && Result; i++)
+    {
+        PreviousToken = Token;
+        Token         = KdCursorOpen(&Cursor);
+
+        UnitTestExpect(Result, Token != 0 && Token != PreviousToken);
+        UnitTestExpect(Result, KdCursorIsValid(&Cursor, Token));
+
+        //
+        // A new operation replaces the previous one
+        //
+        UnitTestExpect(Result, !KdCursorIsValid(&Cursor, PreviousToken));
+    }
+
+    //
+    // The tokens of another cursor are not accepted
+    //
+    UnitTestExpect(Result, !KdCursorIsValid(&Cursor, KdCursorOpen(&OtherCursor)));
+    UnitTestExpect(Result, KdCursorIsValid(&Cursor, Token));
+
+    KdCursorClose(&Cursor);
+    UnitTestExpect(Result, !KdCursorIsValid(&Cursor, Token));
+    UnitTestExpect(Result, !KdCursorIsValid(&Cursor, 0));
+
+    //
+    // The operations are not resumed after the debuggee is continued
+    //
+    Token = KdCursorOpen(&Cursor);
+    KdCursorInvalidateAll();
+
+    UnitTestExpect(Result, !KdCursorIsValid(&Cursor, Token));
+    UnitTestExpect(Result, !KdCursorIsValid(&OtherCursor, OtherCursor.Token));
+
+    Token = KdCursorOpen(&Cursor);
+    UnitTestExpect(Result, KdCursorIsValid(&Cursor, Token));
+
+    return Result;
+}
+
+/**
+ * @brief Test the deadlines of the slices
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestKdCursorSlices()
+{
+    BOOLEAN   Result = TRUE;
+    KD_CURSOR Cursor = {0};
+
+    KdCursorOpen(&Cursor);
+    KdCursorStartSlice(&Cursor);
+
+    UnitTestExpect(Result, !KdCursorIsSliceExpired(&Cursor));
+    UnitTestExpect(Result, Cursor.SliceDeadline - __rdtsc() <= KD_CURSOR_SLICE_MAXIMUM_CYCLES);
+
+    Cursor.SliceDeadline = __rdtsc();
+    UnitTestExpect(Result, KdCursorIsSliceExpired(&Cursor));
+
+    //
+    // A new slice has a new deadline
+    //
+    KdCursorStartSlice(&Cursor);
+    UnitTestExpect(Result, !KdCursorIsSliceExpired(&Cursor));
+
+    return Result;
+}
+
+/**
+ * @brief Compare the results of the sliced search with the unsliced search
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestKdCursorSlicedSearch()
+{
+    static SEARCH_MULTIPLE_PATTERNS_AUTOMATON             Automaton;
+    BOOLEAN                                               Result      = TRUE;
+    UINT64                                                RandomState = 0x00c0ffee00c0ffee;
+    std::vector<BYTE>                                     Image((SIZE_T)TEST_KD_CURSOR_TEST_PAGES * PAGE_SIZE);
+    std::vector<DEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT> Results;
+    std::vector<DEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT> SlicedResults;
+    DEBUGGER_SEARCH_MULTIPLE_PATTERNS                     Request;
+    UINT32                                                NumberOfCalls;
+    UINT32                                                NumberOfSlices;
+    UINT64                                                MaximumSliceTime;
+
+    TestKdCursorMakeRequest(&Request, Image, &RandomState);
+
+    //
+    // The slices of the default budget are only stopped when the results
+    // are full
+    //
+    UnitTestExpect(Result, TestKdCursorSearch(&Request, &Automaton, Image, 0, Results, &NumberOfCalls, &MaximumSliceTime));
+
+    UnitTestExpect(Result, TestKdCursorSearch(&Request, &Automaton, Image, TEST_KD_CURSOR_TEST_SLICE_CYCLES, SlicedResults, &NumberOfSlices, &MaximumSliceTime));
+
+    UnitTestExpect(Result, NumberOfSlices > NumberOfCalls);
+    UnitTestExpect(Result, Results.size() > MaximumSearchMultiplePatternsResults);
+    UnitTestExpect(Result, SlicedResults.size() == Results.size());
+
+    for (SIZE_T i = 0; Result && i < Results.size(); i++)
+    {
+        UnitTestExpect(Result, SlicedResults[i].Address == Results[i].Address && SlicedResults[i].PatternId == Results[i].PatternId);
+    }
+
+    if (!Result)
+    {
+        ShowMessages("\t[x] %llu results in %u slices, %llu results in %u calls\n",
+                     (UINT64)SlicedResults.size(),
+                     NumberOfSlices,
+                     (UINT64)Results.size(),
+                     NumberOfCalls);
+    }
+
+    //
+    // An expired slice still searches one chunk
+    //
+    UnitTestExpect(Result, TestKdCursorSearch(&Request, &Automaton, Image, 1, SlicedResults, &NumberOfSlices, &MaximumSliceTime));
+    UnitTestExpect(Result, SlicedResults.size() == Results.size());
+
+    return Result;
+}
+
+/**
+ * @brief Tests of the resumable operations
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+TestKdCursor()
+{
+    BOOLEAN Result = TRUE;
+
+    UnitTestExpect(Result, TestKdCursorTokens());
+    UnitTestExpect(Result, TestKdCursorSlices());
+    UnitTestExpect(Result, TestKdCursorSlicedSearch());
+
+    return Result;
+}
+
+/**
+ * @brief Per-slice latency of the resumable operations
+ * @details the search of a large image with the budget of the cursor
+ * (KD_CURSOR_SLICE_MAXIMUM_CYCLES), the latency of the longest slice is
+ * how long the debugger waits for a response (and the debuggee is held
+ * in vmx-root) at most
+ *
+ * @return VOID
+ */
+VOID
+BenchmarkKdCursor()
+{
+    static SEARCH_MULTIPLE_PATTERNS_AUTOMATON             Automaton;
+    UINT64                                                RandomState = 0x0123456789abcdef;
+    std::vector<BYTE>                                     Image(TEST_KD_CURSOR_BENCHMARK_IMAGE_SIZE);
+    std::vector<DEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT> Results;
+    DEBUGGER_SEARCH_MULTIPLE_PATTERNS                     Request;
+    UINT32                                                NumberOfSlices;
+    UINT64                                                MaximumSliceTime;
+    UINT64                                                StartTime;
+    UINT64                                                ElapsedTime;
+
+    TestKdCursorMakeRequest(&Request, Image, &RandomState);
+
+    //
+    // The patterns are not found (the bytes of the image are less than 8),
+    // so the slices are only stopped by their deadline
+    //
+    for (UINT32 i = 0; i < Request.NumberOfPatterns; i++)
+    {
+        Request.Patterns[i].Length = MaximumSearchPatternLength;
+
+        for (UINT32 j = 0; j < MaximumSearchPatternLength; j++)
+        {
+            Request.Patterns[i].Bytes[j] = 0xff;
+            Request.Patterns[i].Masks[j] = 0xff;
+        }
+    }
+
+    StartTime = UnitTestGetTimeInNanoseconds();
+
+    TestKdCursorSearch(&Request, &Automaton, Image, 0, Results, &NumberOfSlices, &MaximumSliceTime);
+
+    ElapsedTime = UnitTestGetTimeInNanoseconds() - StartTime;
+
+    UnitTestShowBenchmarkResult("slices of the search (256 MB)", ElapsedTime, NumberOfSlices);
+    UnitTestShowBenchmarkResult("longest slice", MaximumSliceTime, 1);
+}
+
+UnitTestRegister("kd-cursor", TestKdCursor, BenchmarkKdCursor);
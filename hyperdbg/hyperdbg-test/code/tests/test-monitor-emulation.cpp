@@ -0,0 +1,1270 @@
+/**
+ * @file test-monitor-emulation.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Tests and benchmark of the emulation of the memory accesses
+ * @details the emulator (MonitorEmulation.c) is shared with hyperhv, random
+ * instructions are encoded here, their lengths are compared with Zydis, and
+ * their emulation is compared with a reference model that executes the
+ * instructions operand by operand (and the string instructions element by
+ * element) on a synthetic page
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+#include "Zydis/Zydis.h"
+
+/**
+ * @brief Physical address of the monitored page
+ *
+ */
+#define TEST_MONITOR_EMULATION_PHYSICAL_PAGE 0x12345000
+
+/**
+ * @brief Linear address of the monitored page
+ *
+ */
+#define TEST_MONITOR_EMULATION_PAGE 0x00007ff612340000
+
+/**
+ * @brief Linear address of the (not monitored) page of the MOVS sources
+ *
+ */
+#define TEST_MONITOR_EMULATION_SOURCE_PAGE 0x00007ff612350000
+
+/**
+ * @brief Number of the random instructions of the test
+ *
+ */
+#define TEST_MONITOR_EMULATION_ITERATIONS 50000
+
+/**
+ * @brief Number of the different instructions of the benchmark
+ *
+ */
+#define TEST_MONITOR_EMULATION_BENCHMARK_INSTRUCTIONS 4096
+
+/**
+ * @brief Number of the emulated accesses of the benchmark
+ *
+ */
+#define TEST_MONITOR_EMULATION_BENCHMARK_ITERATIONS 1000000
+
+/**
+ * @brief State of the synthetic machine
+ *
+ */
+typedef struct _TEST_MONITOR_EMULATION_MACHINE
+{
+    GUEST_REGS Regs;
+    UINT64     Rflags;
+    BYTE       Page[PAGE_SIZE];       // the monitored page
+    BYTE       SourcePage[PAGE_SIZE]; // the page of the MOVS sources
+
+} TEST_MONITOR_EMULATION_MACHINE, *PTEST_MONITOR_EMULATION_MACHINE;
+
+/**
+ * @brief A random instruction and the fields that are encoded in it
+ *
+ */
+typedef struct _TEST_MONITOR_EMULATION_FORM
+{
+    BYTE                        Bytes[MONITOR_EMULATION_MAXIMUM_INSTRUCTION_LENGTH];
+    UINT32                      Length;
+    MONITOR_EMULATION_OPERATION Operation;
+    UINT32                      OperandSize;
+    UINT32                      MemorySize;
+    BOOLEAN                     IsMemoryDestination;
+    BOOLEAN                     HasImmediate;
+    BOOLEAN                     IsHighByteRegister;
+    BOOLEAN                     HasRepeatPrefix;
+    UINT8                       SegmentPrefix; // the FS or GS prefix (if any)
+    UINT32                      Register;      // number of the register in the encoding
+    UINT64                      Immediate;     // sign-extended immediate
+    BOOLEAN                     IsRipRelative;
+    UINT32                      BaseRegister;
+    UINT32                      IndexRegister;
+    UINT32                      Scale;
+    INT64                       Displacement;
+
+} TEST_MONITOR_EMULATION_FORM, *PTEST_MONITOR_EMULATION_FORM;
+
+/**
+ * @brief The arithmetic operations of the '0x00-0x3f' opcodes and the
+ * '0x80-0x83' group
+ *
+ */
+static const struct
+{
+    UINT32                      Number; // the 'reg' field (or bits 3-5 of the opcode)
+    MONITOR_EMULATION_OPERATION Operation;
+
+} TestMonitorEmulationArithmetic[] = {
+    {0, MONITOR_EMULATION_OPERATION_ADD},
+    {1, MONITOR_EMULATION_OPERATION_OR},
+    {4, MONITOR_EMULATION_OPERATION_AND},
+    {5, MONITOR_EMULATION_OPERATION_SUB},
+    {6, MONITOR_EMULATION_OPERATION_XOR},
+    {7, MONITOR_EMULATION_OPERATION_CMP},
+};
+
+/**
+ * @brief Opcodes of the '0x80-0x83' group
+ *
+ */
+static const UINT8 TestMonitorEmulationGroupOpcodes[] = {0x80, 0x81, 0x83};
+
+/**
+ * @brief Opcodes (after 0x0f) of MOVZX and MOVSX
+ *
+ */
+static const UINT8 TestMonitorEmulationExtendOpcodes[] = {0xb6, 0xb7, 0xbe, 0xbf};
+
+/**
+ * @brief Opcodes of MOVS and STOS
+ *
+ */
+static const UINT8 TestMonitorEmulationStringOpcodes[] = {0xa4, 0xa5, 0xaa, 0xab};
+
+/**
+ * @brief Get a register of the synthetic machine by its number in the encoding
+ *
+ * @param Regs
+ * @param Register
+ *
+ * @return UINT64 *
+ */
+static UINT64 *
+TestMonitorEmulationGetRegister(GUEST_REGS * Regs, UINT32 Register)
+{
+    UINT64 * Registers[16] = {&Regs->rax, &Regs->rcx, &Regs->rdx, &Regs->rbx, &Regs->rsp, &Regs->rbp, &Regs->rsi, &Regs->rdi, &Regs->r8, &Regs->r9, &Regs->r10, &Regs->r11, &Regs->r12, &Regs->r13, &Regs->r14, &Regs->r15};
+
+    return Registers[Register];
+}
+
+/**
+ * @brief Get the mask of an operand
+ *
+ * @param Size
+ *
+ * @return UINT64
+ */
+static UINT64
+TestMonitorEmulationGetMask(UINT32 Size)
+{
+    return Size == 8 ? ~0ull : (1ull << (Size * 8)) - 1;
+}
+
+/**
+ * @brief Read a page of the synthetic machine by its linear address
+ *
+ * @param Machine
+ * @param Address
+ *
+ * @return BYTE * NULL if the address is not mapped
+ */
+static BYTE *
+TestMonitorEmulationGetLinear(PTEST_MONITOR_EMULATION_MACHINE Machine, UINT64 Address)
+{
+    if (Address - TEST_MONITOR_EMULATION_PAGE < PAGE_SIZE)
+    {
+        return &Machine->Page[Address - TEST_MONITOR_EMULATION_PAGE];
+    }
+
+    if (Address - TEST_MONITOR_EMULATION_SOURCE_PAGE < PAGE_SIZE)
+    {
+        return &Machine->SourcePage[Address - TEST_MONITOR_EMULATION_SOURCE_PAGE];
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Read the monitored page (MONITOR_EMULATION_MEMORY)
+ *
+ * @param Address
+ * @param Buffer
+ * @param Size
+ * @param Context the machine
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestMonitorEmulationReadPhysical(UINT64 Address, PVOID Buffer, UINT32 Size, PVOID Context)
+{
+    PTEST_MONITOR_EMULATION_MACHINE Machine = (PTEST_MONITOR_EMULATION_MACHINE)Context;
+
+    if (Address < TEST_MONITOR_EMULATION_PHYSICAL_PAGE || Address - TEST_MONITOR_EMULATION_PHYSICAL_PAGE + Size > PAGE_SIZE)
+    {
+        return FALSE;
+    }
+
+    memcpy(Buffer, &Machine->Page[Address - TEST_MONITOR_EMULATION_PHYSICAL_PAGE], Size);
+
+    return TRUE;
+}
+
+/**
+ * @brief Write the monitored page (MONITOR_EMULATION_MEMORY)
+ *
+ * @param Address
+ * @param Buffer
+ * @param Size
+ * @param Context the machine
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestMonitorEmulationWritePhysical(UINT64 Address, PVOID Buffer, UINT32 Size, PVOID Context)
+{
+    PTEST_MONITOR_EMULATION_MACHINE Machine = (PTEST_MONITOR_EMULATION_MACHINE)Context;
+
+    if (Address < TEST_MONITOR_EMULATION_PHYSICAL_PAGE || Address - TEST_MONITOR_EMULATION_PHYSICAL_PAGE + Size > PAGE_SIZE)
+    {
+        return FALSE;
+    }
+
+    memcpy(&Machine->Page[Address - TEST_MONITOR_EMULATION_PHYSICAL_PAGE], Buffer, Size);
+
+    return TRUE;
+}
+
+/**
+ * @brief Read the linear memory (MONITOR_EMULATION_MEMORY)
+ *
+ * @param Address
+ * @param Buffer
+ * @param Size
+ * @param Context the machine
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestMonitorEmulationReadLinear(UINT64 Address, PVOID Buffer, UINT32 Size, PVOID Context)
+{
+    PTEST_MONITOR_EMULATION_MACHINE Machine = (PTEST_MONITOR_EMULATION_MACHINE)Context;
+    BYTE *                          First   = TestMonitorEmulationGetLinear(Machine, Address);
+
+    if (Size == 0 || First == NULL || TestMonitorEmulationGetLinear(Machine, Address + Size - 1) != First + Size - 1)
+    {
+        return FALSE;
+    }
+
+    memcpy(Buffer, First, Size);
+
+    return TRUE;
+}
+
+/**
+ * @brief Encode a random instruction that is emulated
+ *
+ * @param RandomState
+ * @param Form the encoded instruction
+ *
+ * @return VOID
+ */
+static VOID
+TestMonitorEmulationGenerate(UINT64 * RandomState, PTEST_MONITOR_EMULATION_FORM Form)
+{
+    UINT32  Kind              = (UINT32)(UnitTestGetRandom(RandomState) % 9);
+    UINT32  Offset            = 0;
+    UINT8   Rex               = 0;
+    BOOLEAN OperandSizePrefix = FALSE;
+    BOOLEAN IsByteOperation   = FALSE;
+    UINT32  ImmediateSize     = 0;
+    UINT32  ModRmReg          = (UINT32)(UnitTestGetRandom(RandomState) % 8);
+    UINT32  Mod               = (UINT32)(UnitTestGetRandom(RandomState) % 3);
+    UINT32  Rm                = (UINT32)(UnitTestGetRandom(RandomState) % 8);
+    UINT32  Arithmetic        = (UINT32)(UnitTestGetRandom(RandomState) % 6);
+    UINT32  DisplacementSize  = Mod == 1 ? 1 : (Mod == 2 ? 4 : 0);
+    UINT8   Opcode;
+    UINT8   Sib;
+
+    memset(Form, 0, sizeof(TEST_MONITOR_EMULATION_FORM));
+
+    Form->BaseRegister  = MONITOR_EMULATION_NO_REGISTER;
+    Form->IndexRegister = MONITOR_EMULATION_NO_REGISTER;
+
+    //
+    // Legacy prefixes (MOVSXD doesn't have a 16-bit form)
+    //
+    if (Kind != 7 && UnitTestGetRandom(RandomState) % 3 == 0)
+    {
+        Form->Bytes[Offset++] = 0x66;
+        OperandSizePrefix     = TRUE;
+    }
+
+    switch (UnitTestGetRandom(RandomState) % 8)
+    {
+    case 0:
+        Form->SegmentPrefix = 0x64;
+        break;
+    case 1:
+        Form->SegmentPrefix = 0x65;
+        break;
+    case 2:
+        Form->Bytes[Offset++] = 0x2e;
+        break;
+    case 3:
+        Form->Bytes[Offset++] = 0x3e;
+        break;
+    default:
+        break;
+    }
+
+    if (Form->SegmentPrefix != 0)
+    {
+        Form->Bytes[Offset++] = Form->SegmentPrefix;
+    }
+
+    if (Kind == 8 && UnitTestGetRandom(RandomState) % 4 != 0)
+    {
+        Form->Bytes[Offset++] = UnitTestGetRandom(RandomState) % 4 == 0 ? 0xf2 : 0xf3;
+        Form->HasRepeatPrefix = TRUE;
+    }
+
+    if (UnitTestGetRandom(RandomState) % 2 == 0)
+    {
+        Rex                   = (UINT8)(0x40 | (UnitTestGetRandom(RandomState) % 16));
+        Form->Bytes[Offset++] = Rex;
+    }
+
+    Form->OperandSize = (Rex & 0x8) ? 8 : (OperandSizePrefix ? 2 : 4);
+
+    switch (Kind)
+    {
+    case 0:
+
+        //
+        // ADD, OR, AND, SUB, XOR, and CMP between a register and the memory
+        //
+        IsByteOperation           = UnitTestGetRandom(RandomState) % 2 == 0;
+        Form->IsMemoryDestination = UnitTestGetRandom(RandomState) % 2 == 0;
+        Form->Operation           = TestMonitorEmulationArithmetic[Arithmetic].Operation;
+        Opcode                    = (UINT8)((TestMonitorEmulationArithmetic[Arithmetic].Number << 3) | (Form->IsMemoryDestination ? 0 : 2) | (IsByteOperation ? 0 : 1));
+        break;
+
+    case 1:
+        IsByteOperation           = UnitTestGetRandom(RandomState) % 2 == 0;
+        Form->IsMemoryDestination = UnitTestGetRandom(RandomState) % 2 == 0;
+        Form->Operation           = Form->IsMemoryDestination ? MONITOR_EMULATION_OPERATION_MOV_TO_MEMORY : MONITOR_EMULATION_OPERATION_MOV_FROM_MEMORY;
+        Opcode                    = (UINT8)(0x88 | (Form->IsMemoryDestination ? 0 : 2) | (IsByteOperation ? 0 : 1));
+        break;
+
+    case 2:
+        IsByteOperation           = UnitTestGetRandom(RandomState) % 2 == 0;
+        Form->IsMemoryDestination = TRUE;
+        Form->Operation           = MONITOR_EMULATION_OPERATION_TEST;
+        Opcode                    = IsByteOperation ? 0x84 : 0x85;
+        break;
+
+    case 3:
+        Opcode                    = TestMonitorEmulationGroupOpcodes[UnitTestGetRandom(RandomState) % 3];
+        IsByteOperation           = Opcode == 0x80;
+        ModRmReg                  = TestMonitorEmulationArithmetic[Arithmetic].Number;
+        Form->IsMemoryDestination = TRUE;
+        Form->HasImmediate        = TRUE;
+        Form->Operation           = TestMonitorEmulationArithmetic[Arithmetic].Operation;
+        ImmediateSize             = Opcode == 0x81 ? (Form->OperandSize == 2 ? 2 : 4) : 1;
+        break;
+
+    case 4:
+    case 5:
+        IsByteOperation           = UnitTestGetRandom(RandomState) % 2 == 0;
+        Opcode                    = (UINT8)((Kind == 4 ? 0xc6 : 0xf6) | (IsByteOperation ? 0 : 1));
+        ModRmReg                  = 0;
+        Form->IsMemoryDestination = TRUE;
+        Form->HasImmediate        = TRUE;
+        Form->Operation           = Kind == 4 ? MONITOR_EMULATION_OPERATION_MOV_TO_MEMORY : MONITOR_EMULATION_OPERATION_TEST;
+        ImmediateSize             = IsByteOperation ? 1 : (Form->OperandSize == 2 ? 2 : 4);
+        break;
+
+    case 6:
+
+        //
+        // MOVZX and MOVSX (two-byte opcodes)
+        //
+        Form->Bytes[Offset++] = 0x0f;
+        Opcode                = TestMonitorEmulationExtendOpcodes[UnitTestGetRandom(RandomState) % 4];
+        Form->Operation       = (Opcode & 0x8) ? MONITOR_EMULATION_OPERATION_MOVSX : MONITOR_EMULATION_OPERATION_MOVZX;
+        Form->MemorySize      = (Opcode & 0x1) ? 2 : 1;
+        break;
+
+    case 7:
+        Opcode           = 0x63;
+        Form->Operation  = MONITOR_EMULATION_OPERATION_MOVSX;
+        Form->MemorySize = 4;
+        break;
+
+    default:
+
+        //
+        // MOVS and STOS (without the ModR/M)
+        //
+        Opcode                    = TestMonitorEmulationStringOpcodes[UnitTestGetRandom(RandomState) % 4];
+        IsByteOperation           = !(Opcode & 0x1);
+        Form->IsMemoryDestination = TRUE;
+        Form->Operation           = (Opcode & 0x8) ? MONITOR_EMULATION_OPERATION_STOS : MONITOR_EMULATION_OPERATION_MOVS;
+        break;
+    }
+
+    Form->Bytes[Offset++] = Opcode;
+
+    if (IsByteOperation)
+    {
+        Form->OperandSize = 1;
+    }
+
+    if (Form->MemorySize == 0)
+    {
+        Form->MemorySize = Form->OperandSize;
+    }
+
+    if (Kind == 8)
+    {
+        Form->Length = Offset;
+        return;
+    }
+
+    //
+    // The ModR/M, SIB, and the displacement
+    //
+    Form->Bytes[Offset++] = (UINT8)((Mod << 6) | (ModRmReg << 3) | Rm);
+
+    if (!Form->HasImmediate)
+    {
+        Form->Register = ModRmReg | ((Rex & 0x4) ? 8 : 0);
+
+        if (Form->OperandSize == 1 && Rex == 0 && Form->Register >= 4)
+        {
+            Form->IsHighByteRegister = TRUE;
+        }
+    }
+
+    if (Rm == 4)
+    {
+        Sib                   = (UINT8)UnitTestGetRandom(RandomState);
+        Form->Bytes[Offset++] = Sib;
+        Form->Scale           = 1 << (Sib >> 6);
+
+        if ((((Sib >> 3) & 0x7) | ((Rex & 0x2) ? 8 : 0)) != 4)
+        {
+            Form->IndexRegister = ((Sib >> 3) & 0x7) | ((Rex & 0x2) ? 8 : 0);
+        }
+
+        if ((Sib & 0x7) == 5 && Mod == 0)
+        {
+            DisplacementSize = 4;
+        }
+        else
+        {
+            Form->BaseRegister = (Sib & 0x7) | ((Rex & 0x1) ? 8 : 0);
+        }
+    }
+    else if (Rm == 5 && Mod == 0)
+    {
+        Form->IsRipRelative = TRUE;
+        DisplacementSize    = 4;
+    }
+    else
+    {
+        Form->BaseRegister = Rm | ((Rex & 0x1) ? 8 : 0);
+    }
+
+    if (DisplacementSize != 0)
+    {
+        Form->Displacement = DisplacementSize == 1 ? (INT8)UnitTestGetRandom(RandomState) : (INT32)UnitTestGetRandom(RandomState);
+
+        for (UINT32 i = 0; i < DisplacementSize; i++)
+        {
+            Form->Bytes[Offset++] = (UINT8)((UINT64)Form->Displacement >> (i * 8));
+        }
+    }
+
+    if (ImmediateSize != 0)
+    {
+        Form->Immediate = ImmediateSize == 1 ? (UINT64)(INT8)UnitTestGetRandom(RandomState) : (ImmediateSize == 2 ? (UINT64)(INT16)UnitTestGetRandom(RandomState) : (UINT64)(INT32)UnitTestGetRandom(RandomState));
+
+        for (UINT32 i = 0; i < ImmediateSize; i++)
+        {
+            Form->Bytes[Offset++] = (UINT8)(Form->Immediate >> (i * 8));
+        }
+    }
+
+    Form->Length = Offset;
+}
+
+/**
+ * @brief Compute the effective address of an encoded instruction
+ *
+ * @param Form
+ * @param Regs
+ * @param Rip
+ * @param SegmentBase
+ *
+ * @return UINT64
+ */
+static UINT64
+TestMonitorEmulationGetEffectiveAddress(PTEST_MONITOR_EMULATION_FORM Form, GUEST_REGS * Regs, UINT64 Rip, UINT64 SegmentBase)
+{
+    UINT64 Address = SegmentBase + (UINT64)Form->Displacement;
+
+    if (Form->IsRipRelative)
+    {
+        Address += Rip + Form->Length;
+    }
+
+    if (Form->BaseRegister != MONITOR_EMULATION_NO_REGISTER)
+    {
+        Address += *TestMonitorEmulationGetRegister(Regs, Form->BaseRegister);
+    }
+
+    if (Form->IndexRegister != MONITOR_EMULATION_NO_REGISTER)
+    {
+        Address += *TestMonitorEmulationGetRegister(Regs, Form->IndexRegister) * Form->Scale;
+    }
+
+    return Address;
+}
+
+/**
+ * @brief The status flags of the reference model
+ *
+ * @param Operation
+ * @param Size
+ * @param Destination
+ * @param Source
+ * @param Result
+ *
+ * @return UINT64
+ */
+static UINT64
+TestMonitorEmulationReferenceFlags(MONITOR_EMULATION_OPERATION Operation, UINT32 Size, UINT64 Destination, UINT64 Source, UINT64 Result)
+{
+    UINT64  Mask    = TestMonitorEmulationGetMask(Size);
+    UINT64  SignBit = 1ull << (Size * 8 - 1);
+    UINT64  Flags   = 0;
+    UINT32  SetBits = 0;
+    BOOLEAN IsAdd   = Operation == MONITOR_EMULATION_OPERATION_ADD;
+    BOOLEAN IsSub   = Operation == MONITOR_EMULATION_OPERATION_SUB || Operation == MONITOR_EMULATION_OPERATION_CMP;
+
+    Destination &= Mask;
+    Source &= Mask;
+    Result &= Mask;
+
+    for (UINT32 i = 0; i < 8; i++)
+    {
+        SetBits += (Result >> i) & 1;
+    }
+
+    Flags |= SetBits % 2 == 0 ? X86_FLAGS_PF : 0;
+    Flags |= Result == 0 ? X86_FLAGS_ZF : 0;
+    Flags |= (Result & SignBit) ? X86_FLAGS_SF : 0;
+
+    if (IsAdd)
+    {
+        //
+        // The carry out of the operand (and out of the low nibble)
+        //
+        Flags |= Source > Mask - Destination ? X86_FLAGS_CF : 0;
+        Flags |= (Destination & 0xf) + (Source & 0xf) > 0xf ? X86_FLAGS_AF : 0;
+        Flags |= ((Destination & SignBit) == (Source & SignBit) && (Result & SignBit) != (Destination & SignBit)) ? X86_FLAGS_OF : 0;
+    }
+    else if (IsSub)
+    {
+        Flags |= Destination < Source ? X86_FLAGS_CF : 0;
+        Flags |= (Destination & 0xf) < (Source & 0xf) ? X86_FLAGS_AF : 0;
+        Flags |= ((Destination & SignBit) != (Source & SignBit) && (Result & SignBit) != (Destination & SignBit)) ? X86_FLAGS_OF : 0;
+    }
+
+    return Flags;
+}
+
+/**
+ * @brief Write a register of the reference model
+ *
+ * @param Regs
+ * @param Form
+ * @param Size
+ * @param Value
+ *
+ * @return VOID
+ */
+static VOID
+TestMonitorEmulationReferenceWriteRegister(GUEST_REGS * Regs, PTEST_MONITOR_EMULATION_FORM Form, UINT32 Size, UINT64 Value)
+{
+    UINT64 * Register;
+
+    if (Form->IsHighByteRegister)
+    {
+        Register  = TestMonitorEmulationGetRegister(Regs, Form->Register - 4);
+        *Register = (*Register & ~0xff00ull) | ((Value & 0xff) << 8);
+        return;
+    }
+
+    Register = TestMonitorEmulationGetRegister(Regs, Form->Register);
+
+    //
+    // Writing a 32-bit register clears the upper half
+    //
+    *Register = Size == 4 ? (Value & 0xffffffff) : ((*Register & ~TestMonitorEmulationGetMask(Size)) | (Value & TestMonitorEmulationGetMask(Size)));
+}
+
+/**
+ * @brief Execute a string instruction on the reference model (element by element)
+ *
+ * @param Form
+ * @param Machine
+ * @param SegmentBase
+ * @param LinearAddress the linear address that caused the violation
+ * @param IsWriteViolation
+ *
+ * @return BOOLEAN FALSE if the emulator should not emulate the instruction
+ */
+static BOOLEAN
+TestMonitorEmulationReferenceString(PTEST_MONITOR_EMULATION_FORM    Form,
+                                    PTEST_MONITOR_EMULATION_MACHINE Machine,
+                                    UINT64                          SegmentBase,
+                                    UINT64                          LinearAddress,
+                                    BOOLEAN                         IsWriteViolation)
+{
+    GUEST_REGS * Regs  = &Machine->Regs;
+    UINT64       Count = Form->HasRepeatPrefix ? Regs->rcx : 1;
+    INT64        Step  = (Machine->Rflags & X86_FLAGS_DF) ? -(INT64)Form->MemorySize : (INT64)Form->MemorySize;
+    UINT64       Rsi   = Regs->rsi + SegmentBase;
+    UINT64       Rdi   = Regs->rdi;
+    UINT64       Value = Regs->rax;
+    UINT64       Size;
+
+    //
+    // Only the accesses that fit in the pages are emulated, and the source
+    // and the destination should not overlap
+    //
+    if (!IsWriteViolation || LinearAddress != Rdi || Count == 0 || Count * Form->MemorySize > MONITOR_EMULATION_MAXIMUM_STRING_SIZE)
+    {
+        return FALSE;
+    }
+
+    for (UINT64 i = 0; i < Count; i++)
+    {
+        if (PAGE_ALIGN(Rdi + i * Step) != PAGE_ALIGN(Rdi) || PAGE_ALIGN(Rdi + i * Step + Form->MemorySize - 1) != PAGE_ALIGN(Rdi))
+        {
+            return FALSE;
+        }
+
+        if (Form->Operation == MONITOR_EMULATION_OPERATION_MOVS &&
+            (PAGE_ALIGN(Rsi + i * Step) != PAGE_ALIGN(Rsi) ||
+             PAGE_ALIGN(Rsi + i * Step + Form->MemorySize - 1) != PAGE_ALIGN(Rsi) ||
+             TestMonitorEmulationGetLinear(Machine, Rsi + i * Step) == NULL))
+        {
+            return FALSE;
+        }
+    }
+
+    //
+    // The elements are adjacent, so the bytes of the source and the
+    // destination overlap if their first elements are closer than the
+    // whole string
+    //
+    Size = Count * Form->MemorySize;
+
+    if (Form->Operation == MONITOR_EMULATION_OPERATION_MOVS && (Rsi > Rdi ? Rsi - Rdi : Rdi - Rsi) < Size)
+    {
+        return FALSE;
+    }
+
+    for (UINT64 i = 0; i < Count; i++)
+    {
+        if (Form->Operation == MONITOR_EMULATION_OPERATION_MOVS)
+        {
+            memcpy(TestMonitorEmulationGetLinear(Machine, Regs->rdi), TestMonitorEmulationGetLinear(Machine, Regs->rsi + SegmentBase), Form->MemorySize);
+            Regs->rsi += Step;
+        }
+        else
+        {
+            memcpy(TestMonitorEmulationGetLinear(Machine, Regs->rdi), &Value, Form->MemorySize);
+        }
+
+        Regs->rdi += Step;
+    }
+
+    if (Form->HasRepeatPrefix)
+    {
+        Regs->rcx = 0;
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Execute an instruction on the reference model
+ *
+ * @param Form
+ * @param Machine
+ * @param Rip
+ * @param SegmentBase
+ * @param LinearAddress the linear address that caused the violation
+ * @param PhysicalAddress the physical address that caused the violation
+ * @param IsWriteViolation
+ *
+ * @return BOOLEAN FALSE if the emulator should not emulate the instruction
+ */
+static BOOLEAN
+TestMonitorEmulationReference(PTEST_MONITOR_EMULATION_FORM    Form,
+                              PTEST_MONITOR_EMULATION_MACHINE Machine,
+                              UINT64                          Rip,
+                              UINT64                          SegmentBase,
+                              UINT64                          LinearAddress,
+                              UINT64                          PhysicalAddress,
+                              BOOLEAN                         IsWriteViolation)
+{
+    UINT64  Mask        = TestMonitorEmulationGetMask(Form->OperandSize);
+    UINT64  Address     = TestMonitorEmulationGetEffectiveAddress(Form, &Machine->Regs, Rip, SegmentBase);
+    BOOLEAN IsRead      = Form->Operation != MONITOR_EMULATION_OPERATION_MOV_TO_MEMORY;
+    BOOLEAN IsWritten   = Form->IsMemoryDestination && Form->Operation != MONITOR_EMULATION_OPERATION_CMP && Form->Operation != MONITOR_EMULATION_OPERATION_TEST;
+    UINT64  MemoryValue = 0;
+    UINT64  Register;
+    UINT64  Destination;
+    UINT64  Source;
+    UINT64  Result;
+    BYTE *  Memory;
+
+    if (Form->Operation == MONITOR_EMULATION_OPERATION_MOVS || Form->Operation == MONITOR_EMULATION_OPERATION_STOS)
+    {
+        return TestMonitorEmulationReferenceString(Form, Machine, SegmentBase, LinearAddress, IsWriteViolation);
+    }
+
+    if (IsWriteViolation ? !IsWritten : !IsRead)
+    {
+        return FALSE;
+    }
+
+    //
+    // RSP (and SPL) are not written by the emulator
+    //
+    if (!Form->IsMemoryDestination && Form->Register == 4 && !Form->IsHighByteRegister)
+    {
+        return FALSE;
+    }
+
+    if (Address != LinearAddress ||
+        PhysicalAddress != TEST_MONITOR_EMULATION_PHYSICAL_PAGE + (Address & (PAGE_SIZE - 1)) ||
+        (Address & (PAGE_SIZE - 1)) + Form->MemorySize > PAGE_SIZE)
+    {
+        return FALSE;
+    }
+
+    Memory = &Machine->Page[Address & (PAGE_SIZE - 1)];
+
+    for (UINT32 i = 0; i < Form->MemorySize; i++)
+    {
+        MemoryValue |= (UINT64)Memory[i] << (i * 8);
+    }
+
+    if (Form->IsHighByteRegister)
+    {
+        Register = (*TestMonitorEmulationGetRegister(&Machine->Regs, Form->Register - 4) >> 8) & 0xff;
+    }
+    else
+    {
+        Register = *TestMonitorEmulationGetRegister(&Machine->Regs, Form->Register) & Mask;
+    }
+
+    Source = Form->HasImmediate ? Form->Immediate & Mask : Register;
+
+    switch (Form->Operation)
+    {
+    case MONITOR_EMULATION_OPERATION_MOV_TO_MEMORY:
+        Result = Source;
+        break;
+
+    case MONITOR_EMULATION_OPERATION_MOV_FROM_MEMORY:
+    case MONITOR_EMULATION_OPERATION_MOVZX:
+        TestMonitorEmulationReferenceWriteRegister(&Machine->Regs, Form, Form->OperandSize, MemoryValue);
+        return TRUE;
+
+    case MONITOR_EMULATION_OPERATION_MOVSX:
+
+        //
+        // Shift the sign bit of the memory operand to the top, then back
+        //
+        Result = (UINT64)((INT64)(MemoryValue << (64 - Form->MemorySize * 8)) >> (64 - Form->MemorySize * 8));
+        TestMonitorEmulationReferenceWriteRegister(&Machine->Regs, Form, Form->OperandSize, Result);
+        return TRUE;
+
+    default:
+        Destination = Form->IsMemoryDestination ? MemoryValue : Register;
+        Source      = Form->IsMemoryDestination ? Source : MemoryValue;
+
+        switch (Form->Operation)
+        {
+        case MONITOR_EMULATION_OPERATION_ADD:
+            Result = (Destination + Source) & Mask;
+            break;
+        case MONITOR_EMULATION_OPERATION_OR:
+            Result = Destination | Source;
+            break;
+        case MONITOR_EMULATION_OPERATION_XOR:
+            Result = Destination ^ Source;
+            break;
+        case MONITOR_EMULATION_OPERATION_SUB:
+        case MONITOR_EMULATION_OPERATION_CMP:
+            Result = (Destination - Source) & Mask;
+            break;
+        default:
+            Result = Destination & Source;
+            break;
+        }
+
+        Machine->Rflags = (Machine->Rflags & ~(UINT64)MONITOR_EMULATION_STATUS_FLAGS) |
+                          TestMonitorEmulationReferenceFlags(Form->Operation, Form->OperandSize, Destination, Source, Result);
+
+        if (!IsWritten)
+        {
+            if (!Form->IsMemoryDestination && Form->Operation != MONITOR_EMULATION_OPERATION_CMP)
+            {
+                TestMonitorEmulationReferenceWriteRegister(&Machine->Regs, Form, Form->OperandSize, Result);
+            }
+
+            return TRUE;
+        }
+
+        break;
+    }
+
+    for (UINT32 i = 0; i < Form->MemorySize; i++)
+    {
+        Memory[i] = (BYTE)(Result >> (i * 8));
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Check the decoded fields of an encoded instruction
+ *
+ * @param Form
+ * @param Instruction
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestMonitorEmulationCheckDecoded(PTEST_MONITOR_EMULATION_FORM Form, PMONITOR_EMULATION_INSTRUCTION Instruction)
+{
+    BOOLEAN Result = TRUE;
+
+    UnitTestExpect(Result, Instruction->Operation == Form->Operation);
+    UnitTestExpect(Result, Instruction->Length == Form->Length);
+    UnitTestExpect(Result, Instruction->OperandSize == Form->OperandSize && Instruction->MemorySize == Form->MemorySize);
+    UnitTestExpect(Result, Instruction->IsMemoryDestination == Form->IsMemoryDestination);
+    UnitTestExpect(Result, Instruction->HasImmediate == Form->HasImmediate && Instruction->Immediate == Form->Immediate);
+    UnitTestExpect(Result, Instruction->HasRepeatPrefix == Form->HasRepeatPrefix);
+    UnitTestExpect(Result, Instruction->SegmentPrefix == Form->SegmentPrefix);
+
+    if (Form->Operation == MONITOR_EMULATION_OPERATION_MOVS || Form->Operation == MONITOR_EMULATION_OPERATION_STOS)
+    {
+        return Result;
+    }
+
+    //
+    // The high byte registers are stored as the index of the full register
+    //
+    if (!Form->HasImmediate)
+    {
+        UnitTestExpect(Result, Instruction->IsHighByteRegister == Form->IsHighByteRegister);
+        UnitTestExpect(Result, Instruction->Register == (Form->IsHighByteRegister ? Form->Register - 4 : Form->Register));
+    }
+
+    UnitTestExpect(Result, Instruction->IsRipRelative == Form->IsRipRelative);
+    UnitTestExpect(Result, Instruction->BaseRegister == Form->BaseRegister && Instruction->IndexRegister == Form->IndexRegister);
+    UnitTestExpect(Result, Form->IndexRegister == MONITOR_EMULATION_NO_REGISTER || Instruction->Scale == Form->Scale);
+    UnitTestExpect(Result, Instruction->Displacement == Form->Displacement);
+
+    return Result;
+}
+
+/**
+ * @brief Fill the synthetic machine with random registers, flags, and memory
+ * @details the string registers point to the pages of the machine
+ *
+ * @param RandomState
+ * @param Form
+ * @param Machine
+ * @param SegmentBase
+ *
+ * @return VOID
+ */
+static VOID
+TestMonitorEmulationRandomizeMachine(UINT64 *                        RandomState,
+                                     PTEST_MONITOR_EMULATION_FORM    Form,
+                                     PTEST_MONITOR_EMULATION_MACHINE Machine,
+                                     UINT64                          SegmentBase)
+{
+    UINT64 * Gprs = (UINT64 *)&Machine->Regs;
+
+    for (UINT32 i = 0; i < sizeof(GUEST_REGS) / sizeof(UINT64); i++)
+    {
+        //
+        // Small values make the carries and the overflows of the narrow
+        // operands as likely as the wide ones
+        //
+        Gprs[i] = UnitTestGetRandom(RandomState) >> (UnitTestGetRandom(RandomState) % 64);
+    }
+
+    for (UINT32 i = 0; i < PAGE_SIZE; i += sizeof(UINT64))
+    {
+        *(UINT64 *)&Machine->Page[i]       = UnitTestGetRandom(RandomState);
+        *(UINT64 *)&Machine->SourcePage[i] = UnitTestGetRandom(RandomState);
+    }
+
+    Machine->Rflags = X86_FLAGS_FIXED | (UnitTestGetRandom(RandomState) & (MONITOR_EMULATION_STATUS_FLAGS | X86_FLAGS_DF));
+
+    if (Form->Operation == MONITOR_EMULATION_OPERATION_MOVS || Form->Operation == MONITOR_EMULATION_OPERATION_STOS)
+    {
+        Machine->Regs.rdi = TEST_MONITOR_EMULATION_PAGE + UnitTestGetRandom(RandomState) % PAGE_SIZE;
+        Machine->Regs.rsi = (UnitTestGetRandom(RandomState) % 4 == 0 ? TEST_MONITOR_EMULATION_PAGE : TEST_MONITOR_EMULATION_SOURCE_PAGE) +
+                            UnitTestGetRandom(RandomState) % PAGE_SIZE - SegmentBase;
+        Machine->Regs.rcx = UnitTestGetRandom(RandomState) % 80;
+    }
+}
+
+/**
+ * @brief Get the length of an instruction by Zydis (as the reference)
+ *
+ * @param Buffer
+ * @param Length
+ *
+ * @return UINT32 zero if the instruction is not decoded
+ */
+static UINT32
+TestMonitorEmulationGetZydisLength(const UINT8 * Buffer, UINT32 Length)
+{
+    ZydisDecoder            Decoder;
+    ZydisDecodedInstruction Instruction;
+    ZydisDecodedOperand     Operands[ZYDIS_MAX_OPERAND_COUNT];
+
+    if (!ZYAN_SUCCESS(ZydisDecoderInit(&Decoder, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64)) ||
+        !ZYAN_SUCCESS(ZydisDecoderDecodeFull(&Decoder, Buffer, Length, &Instruction, Operands)))
+    {
+        return 0;
+    }
+
+    return Instruction.length;
+}
+
+/**
+ * @brief Emulate random instructions and compare them with the reference model
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestMonitorEmulationDifferential()
+{
+    BOOLEAN                        Result      = TRUE;
+    UINT64                         RandomState = 0x4d6f6e69746f72ull;
+    UINT32                         Emulated    = 0;
+    UINT32                         Rejected    = 0;
+    TEST_MONITOR_EMULATION_FORM    Form;
+    TEST_MONITOR_EMULATION_MACHINE Machine;
+    TEST_MONITOR_EMULATION_MACHINE Expected;
+    MONITOR_EMULATION_INSTRUCTION  Instruction;
+    MONITOR_EMULATION_MEMORY       Memory = {TestMonitorEmulationReadPhysical, TestMonitorEmulationWritePhysical, TestMonitorEmulationReadLinear, &Machine};
+    UINT64                         SegmentBase;
+    UINT64                         Rip;
+    UINT64                         LinearAddress;
+    UINT64                         PhysicalAddress;
+    UINT64                         FlagsMask;
+    BOOLEAN                        IsWriteViolation;
+    BOOLEAN                        IsEmulated;
+    BOOLEAN                        IsExpected;
+
+    for (UINT32 i = 0; Result && i < TEST_MONITOR_EMULATION_ITERATIONS; i++)
+    {
+        TestMonitorEmulationGenerate(&RandomState, &Form);
+
+        //
+        // The encoded length should match Zydis, and the truncated
+        // instructions should not be decoded
+        //
+        UnitTestExpect(Result, TestMonitorEmulationGetZydisLength(Form.Bytes, Form.Length) == Form.Length);
+        UnitTestExpect(Result, MonitorEmulationDecode(Form.Bytes, Form.Length, &Instruction));
+        UnitTestExpect(Result, TestMonitorEmulationCheckDecoded(&Form, &Instruction));
+
+        for (UINT32 j = 0; j < Form.Length; j++)
+        {
+            MONITOR_EMULATION_INSTRUCTION Truncated;
+
+            UnitTestExpect(Result, !MonitorEmulationDecode(Form.Bytes, j, &Truncated));
+        }
+
+        if (!Result)
+        {
+            ShowMessages("\t[x] instruction %d (%d bytes) is not decoded as encoded\n", i, Form.Length);
+            break;
+        }
+
+        //
+        // The FS and GS bases are filled by the caller of the emulator
+        //
+        SegmentBase             = Form.SegmentPrefix != 0 ? UnitTestGetRandom(&RandomState) : 0;
+        Instruction.SegmentBase = SegmentBase;
+        Rip                     = UnitTestGetRandom(&RandomState);
+
+        TestMonitorEmulationRandomizeMachine(&RandomState, &Form, &Machine, SegmentBase);
+
+        if (Form.Operation == MONITOR_EMULATION_OPERATION_MOVS || Form.Operation == MONITOR_EMULATION_OPERATION_STOS)
+        {
+            LinearAddress    = Machine.Regs.rdi;
+            IsWriteViolation = UnitTestGetRandom(&RandomState) % 8 != 0;
+        }
+        else
+        {
+            LinearAddress    = TestMonitorEmulationGetEffectiveAddress(&Form, &Machine.Regs, Rip, SegmentBase);
+            IsWriteViolation = UnitTestGetRandom(&RandomState) % 2 == 0;
+        }
+
+        PhysicalAddress = TEST_MONITOR_EMULATION_PHYSICAL_PAGE + (LinearAddress & (PAGE_SIZE - 1));
+
+        //
+        // A few violations of other addresses (these are not emulated), the
+        // physical address of the string instructions is not checked as it's
+        // the translation of RDI
+        //
+        switch (UnitTestGetRandom(&RandomState) % 32)
+        {
+        case 0:
+            LinearAddress += 1;
+            break;
+        case 1:
+            PhysicalAddress ^= Form.Operation == MONITOR_EMULATION_OPERATION_MOVS || Form.Operation == MONITOR_EMULATION_OPERATION_STOS ? 0 : 8;
+            break;
+        default:
+            break;
+        }
+
+        Expected = Machine;
+
+        IsExpected = TestMonitorEmulationReference(&Form, &Expected, Rip, SegmentBase, LinearAddress, PhysicalAddress, IsWriteViolation);
+        IsEmulated = MonitorEmulationExecute(&Instruction, &Machine.Regs, &Machine.Rflags, Rip, LinearAddress, PhysicalAddress, IsWriteViolation, &Memory);
+
+        //
+        // AF is undefined after the logical operations
+        //
+        FlagsMask = ~0ull;
+
+        if (Form.Operation == MONITOR_EMULATION_OPERATION_OR || Form.Operation == MONITOR_EMULATION_OPERATION_AND ||
+            Form.Operation == MONITOR_EMULATION_OPERATION_XOR || Form.Operation == MONITOR_EMULATION_OPERATION_TEST)
+        {
+            FlagsMask = ~(UINT64)X86_FLAGS_AF;
+        }
+
+        UnitTestExpect(Result, IsEmulated == IsExpected);
+        UnitTestExpect(Result, memcmp(&Machine.Regs, &Expected.Regs, sizeof(GUEST_REGS)) == 0);
+        UnitTestExpect(Result, (Machine.Rflags & FlagsMask) == (Expected.Rflags & FlagsMask));
+        UnitTestExpect(Result, memcmp(Machine.Page, Expected.Page, PAGE_SIZE) == 0);
+        UnitTestExpect(Result, memcmp(Machine.SourcePage, Expected.SourcePage, PAGE_SIZE) == 0);
+
+        if (!Result)
+        {
+            ShowMessages("\t[x] instruction %d (operation: %d, %d bytes) differs from the reference (emulated: %d, expected: %d)\n",
+                         i,
+                         Form.Operation,
+                         Form.Length,
+                         IsEmulated,
+                         IsExpected);
+        }
+
+        IsEmulated ? Emulated++ : Rejected++;
+    }
+
+    //
+    // Most of the random accesses should be emulated
+    //
+    UnitTestExpect(Result, Emulated > Rejected);
+
+    return Result;
+}
+
+/**
+ * @brief Test the decoder with known encodings and the instructions that
+ * are not emulated
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestMonitorEmulationCorpus()
+{
+    BOOLEAN                       Result = TRUE;
+    MONITOR_EMULATION_INSTRUCTION Instruction;
+
+    static const struct
+    {
+        BYTE   Bytes[MONITOR_EMULATION_MAXIMUM_INSTRUCTION_LENGTH + 2];
+        UINT32 Size;
+        UINT32 Length; // zero if the instruction is not emulated
+
+    } Corpus[] = {
+        {{0x48, 0x89, 0x05, 0x10, 0x00, 0x00, 0x00}, 7, 7},             // mov [rip+0x10], rax
+        {{0x65, 0x48, 0x8b, 0x04, 0x25, 0x28, 0x00, 0x00, 0x00}, 9, 9}, // mov rax, gs:[0x28]
+        {{0xf3, 0x48, 0xab}, 3, 3},                                     // rep stosq
+        {{0x0f, 0xb6, 0x41, 0x08}, 4, 4},                               // movzx eax, byte [rcx+8]
+        {{0x80, 0x7c, 0x24, 0x30, 0x00}, 5, 5},                         // cmp byte [rsp+0x30], 0
+        {{0x66, 0x81, 0x48, 0x02, 0x34, 0x12}, 6, 6},                   // or word [rax+2], 0x1234
+        {{0x4a, 0x63, 0x44, 0xe5, 0x00}, 5, 5},                         // movsxd rax, dword [rbp+r12*8]
+        {{0x88, 0x20}, 2, 2},                                           // mov [rax], ah
+        {{0x11, 0x08}, 2, 0},                                           // adc [rax], ecx
+        {{0x19, 0x08}, 2, 0},                                           // sbb [rax], ecx
+        {{0x01, 0xc8}, 2, 0},                                           // add eax, ecx
+        {{0xf0, 0x01, 0x08}, 3, 0},                                     // lock add [rax], ecx
+        {{0x67, 0x01, 0x08}, 3, 0},                                     // add [eax], ecx
+        {{0xf3, 0x01, 0x08}, 3, 0},                                     // rep add [rax], ecx
+        {{0x66, 0x63, 0x08}, 3, 0},                                     // movsxd cx, [rax]
+        {{0x83, 0x10, 0x01}, 3, 0},                                     // adc dword [rax], 1
+        {{0xc7, 0x08, 0x00, 0x00, 0x00, 0x00}, 6, 0},                   // invalid group 11
+        {{0xf7, 0x10}, 2, 0},                                           // not dword [rax]
+        {{0x0f, 0xaf, 0x08}, 3, 0},                                     // imul ecx, [rax]
+        {{0xff, 0x30}, 2, 0},                                           // push qword [rax]
+
+        //
+        // Longer than the maximum length of an instruction
+        //
+        {{0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x01, 0x04, 0x24}, 17, 0},
+    };
+
+    for (UINT32 i = 0; i < sizeof(Corpus) / sizeof(Corpus[0]); i++)
+    {
+        if (Corpus[i].Length == 0)
+        {
+            UnitTestExpect(Result, !MonitorEmulationDecode(Corpus[i].Bytes, Corpus[i].Size, &Instruction));
+        }
+        else
+        {
+            UnitTestExpect(Result, MonitorEmulationDecode(Corpus[i].Bytes, Corpus[i].Size, &Instruction) && Instruction.Length == Corpus[i].Length);
+        }
+
+        if (!Result)
+        {
+            ShowMessages("\t[x] instruction %d of the corpus is not decoded as expected\n", i);
+            return FALSE;
+        }
+    }
+
+    //
+    // A few fields of the known encodings
+    //
+    MonitorEmulationDecode(Corpus[1].Bytes, Corpus[1].Size, &Instruction);
+    UnitTestExpect(Result, Instruction.SegmentPrefix == 0x65 && Instruction.BaseRegister == MONITOR_EMULATION_NO_REGISTER && Instruction.Displacement == 0x28);
+
+    MonitorEmulationDecode(Corpus[6].Bytes, Corpus[6].Size, &Instruction);
+    UnitTestExpect(Result, Instruction.BaseRegister == 5 && Instruction.IndexRegister == 12 && Instruction.Scale == 8 && Instruction.MemorySize == 4);
+
+    MonitorEmulationDecode(Corpus[7].Bytes, Corpus[7].Size, &Instruction);
+    UnitTestExpect(Result, Instruction.IsHighByteRegister && Instruction.Register == MONITOR_EMULATION_REGISTER_RAX);
+
+    return Result;
+}
+
+/**
+ * @brief Tests of the emulation of the memory accesses
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+TestMonitorEmulation()
+{
+    BOOLEAN Result = TRUE;
+
+    UnitTestExpect(Result, TestMonitorEmulationCorpus());
+    UnitTestExpect(Result, TestMonitorEmulationDifferential());
+
+    return Result;
+}
+
+/**
+ * @brief Benchmark of the emulation of the memory accesses
+ * @details decoding and executing random instructions (the work of the
+ * emulator on each EPT violation, without the vm-exit)
+ *
+ * @return VOID
+ */
+VOID
+BenchmarkMonitorEmulation()
+{
+    UINT64                                   RandomState = 0x42656e6368ull;
+    std::vector<TEST_MONITOR_EMULATION_FORM> Forms(TEST_MONITOR_EMULATION_BENCHMARK_INSTRUCTIONS);
+    std::vector<UINT64>                      LinearAddresses(TEST_MONITOR_EMULATION_BENCHMARK_INSTRUCTIONS);
+    TEST_MONITOR_EMULATION_MACHINE *         Machine = new TEST_MONITOR_EMULATION_MACHINE;
+    MONITOR_EMULATION_INSTRUCTION            Instruction;
+    MONITOR_EMULATION_MEMORY                 Memory = {TestMonitorEmulationReadPhysical, TestMonitorEmulationWritePhysical, TestMonitorEmulationReadLinear, Machine};
+    GUEST_REGS                               Regs;
+    UINT64                                   Emulated = 0;
+    UINT64                                   StartTime;
+    UINT32                                   Index;
+
+    //
+    // The string instructions are not in the benchmark (their registers
+    // point to the pages of the machine)
+    //
+    for (UINT32 i = 0; i < TEST_MONITOR_EMULATION_BENCHMARK_INSTRUCTIONS; i++)
+    {
+        do
+        {
+            TestMonitorEmulationGenerate(&RandomState, &Forms[i]);
+
+        } while (Forms[i].Operation == MONITOR_EMULATION_OPERATION_MOVS || Forms[i].Operation == MONITOR_EMULATION_OPERATION_STOS);
+    }
+
+    TestMonitorEmulationRandomizeMachine(&RandomState, &Forms[0], Machine, 0);
+
+    Regs = Machine->Regs;
+
+    for (UINT32 i = 0; i < TEST_MONITOR_EMULATION_BENCHMARK_INSTRUCTIONS; i++)
+    {
+        LinearAddresses[i] = TestMonitorEmulationGetEffectiveAddress(&Forms[i], &Regs, 0, 0);
+    }
+
+    StartTime = UnitTestGetTimeInNanoseconds();
+
+    for (UINT32 i = 0; i < TEST_MONITOR_EMULATION_BENCHMARK_ITERATIONS; i++)
+    {
+        MonitorEmulationDecode(Forms[i % TEST_MONITOR_EMULATION_BENCHMARK_INSTRUCTIONS].Bytes,
+                               MONITOR_EMULATION_MAXIMUM_INSTRUCTION_LENGTH,
+                               &Instruction);
+    }
+
+    UnitTestShowBenchmarkResult("decode", UnitTestGetTimeInNanoseconds() - StartTime, TEST_MONITOR_EMULATION_BENCHMARK_ITERATIONS);
+
+    StartTime = UnitTestGetTimeInNanoseconds();
+
+    for (UINT32 i = 0; i < TEST_MONITOR_EMULATION_BENCHMARK_ITERATIONS; i++)
+    {
+        //
+        // The registers are restored, so the effective addresses don't change
+        //
+        Index         = i % TEST_MONITOR_EMULATION_BENCHMARK_INSTRUCTIONS;
+        Machine->Regs = Regs;
+
+        if (MonitorEmulationDecode(Forms[Index].Bytes, MONITOR_EMULATION_MAXIMUM_INSTRUCTION_LENGTH, &Instruction) &&
+            MonitorEmulationExecute(&Instruction,
+                                    &Machine->Regs,
+                                    &Machine->Rflags,
+                                    0,
+                                    LinearAddresses[Index],
+                                    TEST_MONITOR_EMULATION_PHYSICAL_PAGE + (LinearAddresses[Index] & (PAGE_SIZE - 1)),
+                                    Instruction.IsMemoryWritten,
+                                    &Memory))
+        {
+            Emulated++;
+        }
+    }
+
+    UnitTestShowBenchmarkResult("decode and execute (per access)", UnitTestGetTimeInNanoseconds() - StartTime, TEST_MONITOR_EMULATION_BENCHMARK_ITERATIONS);
+
+    ShowMessages("\t%lld of %d accesses are emulated\n", Emulated, TEST_MONITOR_EMULATION_BENCHMARK_ITERATIONS);
+
+    delete Machine;
+}
+
+UnitTestRegister("monitor-emulation", TestMonitorEmulation, BenchmarkMonitorEmulation);
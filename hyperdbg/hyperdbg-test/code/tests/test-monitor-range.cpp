@@ -0,0 +1,886 @@
+/**
+ * @file test-monitor-range.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Tests and benchmark of the EPT entries of the monitored ranges
+ * @details the changes of the entries (MonitorRangeTable.c) are shared with
+ * hyperhv, the EPT of a core is modeled by its PML2 entries and the PML1 tables
+ * that are split on demand, and its view shares some of these entries
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Number of the 2MB regions of the model
+ *
+ */
+#define TEST_MONITOR_RANGE_NUMBER_OF_REGIONS 64
+
+/**
+ * @brief Number of the regions whose PML2 entries are shared between the
+ * EPT of the core and its view (the view has a copy of the other entries)
+ *
+ */
+#define TEST_MONITOR_RANGE_SHARED_REGIONS 32
+
+/**
+ * @brief Number of the pages of a region
+ *
+ */
+#define TEST_MONITOR_RANGE_PAGES_PER_REGION 512
+
+/**
+ * @brief Maximum number of the ranges that are monitored at the same time
+ *
+ */
+#define TEST_MONITOR_RANGE_MAXIMUM_RANGES 8
+
+/**
+ * @brief Maximum number of the pages that are unprotected for a single
+ * instruction (same as hyperhv)
+ *
+ */
+#define TEST_MONITOR_RANGE_RESTORE_POINTS 4
+
+/**
+ * @brief Number of the steps of the model
+ *
+ */
+#define TEST_MONITOR_RANGE_NUMBER_OF_STEPS 1000
+
+/**
+ * @brief Number of the regions of the benchmark (a 1GB range that doesn't
+ * start at the beginning of a region)
+ *
+ */
+#define TEST_MONITOR_RANGE_BENCHMARK_REGIONS 514
+
+/**
+ * @brief The large page bit of a PML2 entry
+ *
+ */
+#define TEST_MONITOR_RANGE_LARGE_PAGE (1ull << 7)
+
+/**
+ * @brief The (write-back) memory type of the entries of the model
+ *
+ */
+#define TEST_MONITOR_RANGE_MEMORY_TYPE (6ull << 3)
+
+/**
+ * @brief The page frame number bits of an entry
+ *
+ */
+#define TEST_MONITOR_RANGE_FRAME_MASK 0x000ffffffffff000ull
+
+/**
+ * @brief The EPT of a core and its view
+ * @details the PML2 entries that are not large pages keep the index of
+ * their PML1 table, the view uses the entries of the core for the shared
+ * regions and its own copy for the others
+ *
+ */
+typedef struct _TEST_MONITOR_RANGE_EPT
+{
+    std::vector<UINT64>              Pml2;        // the PML2 entries of the EPT of the core
+    std::vector<UINT64>              ViewPml2;    // the copied PML2 entries of the view
+    std::vector<std::vector<UINT64>> Tables;      // the PML1 tables of the core and of the view
+    std::vector<UINT8>               Original;    // the original accesses of the pages
+    UINT64                           Splits;      // the number of the split large pages
+    UINT64                           SplitBudget; // the number of the splits that succeed
+
+} TEST_MONITOR_RANGE_EPT, *PTEST_MONITOR_RANGE_EPT;
+
+/**
+ * @brief A monitored range of the model
+ *
+ */
+typedef struct _TEST_MONITOR_RANGE_DESCRIPTOR
+{
+    UINT64 PhysicalBaseAddress;
+    UINT64 PhysicalEndAddress;
+    UINT64 MonitoredAccess;
+
+} TEST_MONITOR_RANGE_DESCRIPTOR, *PTEST_MONITOR_RANGE_DESCRIPTOR;
+
+/**
+ * @brief The accesses of the entries of the model (write-only entries
+ * are not valid)
+ *
+ */
+static const UINT8 TestMonitorRangeAccesses[] = {0x7, 0x3, 0x5, 0x1, 0x4};
+
+/**
+ * @brief Get the PML1 entry of an address from a PML2 entry, or the PML2
+ * entry itself if it's a large page
+ *
+ * @param Ept
+ * @param Pml2Entry
+ * @param PhysicalAddress
+ * @param IsLargePage
+ *
+ * @return UINT64 *
+ */
+static UINT64 *
+TestMonitorRangeGetEntryOfPml2(PTEST_MONITOR_RANGE_EPT Ept, UINT64 * Pml2Entry, UINT64 PhysicalAddress, BOOLEAN * IsLargePage)
+{
+    if (*Pml2Entry & TEST_MONITOR_RANGE_LARGE_PAGE)
+    {
+        *IsLargePage = TRUE;
+        return Pml2Entry;
+    }
+
+    *IsLargePage = FALSE;
+
+    return &Ept->Tables[*Pml2Entry >> 12][(PhysicalAddress / PAGE_SIZE) % TEST_MONITOR_RANGE_PAGES_PER_REGION];
+}
+
+/**
+ * @brief Get the entry of an address in the EPT of the core
+ *
+ * @param PhysicalAddress
+ * @param IsLargePage
+ * @param Context
+ *
+ * @return PVOID
+ */
+static PVOID
+TestMonitorRangeGetEntry(UINT64 PhysicalAddress, BOOLEAN * IsLargePage, PVOID Context)
+{
+    PTEST_MONITOR_RANGE_EPT Ept    = (PTEST_MONITOR_RANGE_EPT)Context;
+    UINT64                  Region = PhysicalAddress / MONITOR_RANGE_TABLE_LARGE_PAGE_SIZE;
+
+    if (Region >= Ept->Pml2.size())
+    {
+        return NULL;
+    }
+
+    return TestMonitorRangeGetEntryOfPml2(Ept, &Ept->Pml2[Region], PhysicalAddress, IsLargePage);
+}
+
+/**
+ * @brief Get the entry of an address in the view
+ *
+ * @param PhysicalAddress
+ * @param IsLargePage
+ * @param Context
+ *
+ * @return PVOID
+ */
+static PVOID
+TestMonitorRangeGetViewEntry(UINT64 PhysicalAddress, BOOLEAN * IsLargePage, PVOID Context)
+{
+    PTEST_MONITOR_RANGE_EPT Ept    = (PTEST_MONITOR_RANGE_EPT)Context;
+    UINT64                  Region = PhysicalAddress / MONITOR_RANGE_TABLE_LARGE_PAGE_SIZE;
+
+    if (Region >= Ept->ViewPml2.size())
+    {
+        return NULL;
+    }
+
+    return TestMonitorRangeGetEntryOfPml2(Ept,
+                                          Region < TEST_MONITOR_RANGE_SHARED_REGIONS ? &Ept->Pml2[Region] : &Ept->ViewPml2[Region],
+                                          PhysicalAddress,
+                                          IsLargePage);
+}
+
+/**
+ * @brief Split the large page of an address in the EPT of the core
+ * @details the pages keep the accesses of the large page
+ *
+ * @param PhysicalAddress
+ * @param Context
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestMonitorRangeSplitLargePage(UINT64 PhysicalAddress, PVOID Context)
+{
+    PTEST_MONITOR_RANGE_EPT Ept    = (PTEST_MONITOR_RANGE_EPT)Context;
+    UINT64                  Region = PhysicalAddress / MONITOR_RANGE_TABLE_LARGE_PAGE_SIZE;
+    UINT64                  Entry  = Ept->Pml2[Region];
+    std::vector<UINT64>     Table(TEST_MONITOR_RANGE_PAGES_PER_REGION);
+
+    if (!(Entry & TEST_MONITOR_RANGE_LARGE_PAGE) || Ept->SplitBudget == 0)
+    {
+        return FALSE;
+    }
+
+    for (UINT64 i = 0; i < TEST_MONITOR_RANGE_PAGES_PER_REGION; i++)
+    {
+        Table[i] = ((Region * TEST_MONITOR_RANGE_PAGES_PER_REGION + i) * PAGE_SIZE) | TEST_MONITOR_RANGE_MEMORY_TYPE | (Entry & MONITOR_RANGE_TABLE_ACCESS_MASK);
+    }
+
+    Ept->Tables.push_back(std::move(Table));
+
+    Ept->Pml2[Region] = ((UINT64)(Ept->Tables.size() - 1) << 12) | MONITOR_RANGE_TABLE_ACCESS_MASK;
+
+    Ept->SplitBudget--;
+    Ept->Splits++;
+
+    return TRUE;
+}
+
+/**
+ * @brief Build the EPT of the model
+ * @details without a random state, all the regions are large pages with
+ * all the accesses (like the identity mapping of hyperhv)
+ *
+ * @param Ept
+ * @param NumberOfRegions
+ * @param RandomState NULL or the random state
+ *
+ * @return VOID
+ */
+static VOID
+TestMonitorRangeInitialize(PTEST_MONITOR_RANGE_EPT Ept, UINT32 NumberOfRegions, UINT64 * RandomState)
+{
+    UINT64              Access;
+    std::vector<UINT64> Table(TEST_MONITOR_RANGE_PAGES_PER_REGION);
+
+    Ept->Pml2.assign(NumberOfRegions, 0);
+    Ept->Original.assign((size_t)NumberOfRegions * TEST_MONITOR_RANGE_PAGES_PER_REGION, 0);
+    Ept->Tables.clear();
+    Ept->Tables.reserve((size_t)NumberOfRegions * 2);
+
+    Ept->Splits      = 0;
+    Ept->SplitBudget = (UINT64)-1;
+
+    for (UINT64 Region = 0; Region < NumberOfRegions; Region++)
+    {
+        Access = RandomState == NULL ? MONITOR_RANGE_TABLE_ACCESS_MASK : TestMonitorRangeAccesses[UnitTestGetRandom(RandomState) % sizeof(TestMonitorRangeAccesses)];
+
+        if (RandomState == NULL || UnitTestGetRandom(RandomState) % 4 != 0)
+        {
+            Ept->Pml2[Region] = (Region * MONITOR_RANGE_TABLE_LARGE_PAGE_SIZE) | TEST_MONITOR_RANGE_MEMORY_TYPE | TEST_MONITOR_RANGE_LARGE_PAGE | Access;
+
+            memset(&Ept->Original[Region * TEST_MONITOR_RANGE_PAGES_PER_REGION], (int)Access, TEST_MONITOR_RANGE_PAGES_PER_REGION);
+            continue;
+        }
+
+        //
+        // The pages of the regions that are already split have their own accesses
+        //
+        for (UINT64 i = 0; i < TEST_MONITOR_RANGE_PAGES_PER_REGION; i++)
+        {
+            Access = TestMonitorRangeAccesses[UnitTestGetRandom(RandomState) % sizeof(TestMonitorRangeAccesses)];
+
+            Table[i] = ((Region * TEST_MONITOR_RANGE_PAGES_PER_REGION + i) * PAGE_SIZE) | TEST_MONITOR_RANGE_MEMORY_TYPE | Access;
+
+            Ept->Original[Region * TEST_MONITOR_RANGE_PAGES_PER_REGION + i] = (UINT8)Access;
+        }
+
+        Ept->Tables.push_back(Table);
+
+        Ept->Pml2[Region] = ((UINT64)(Ept->Tables.size() - 1) << 12) | MONITOR_RANGE_TABLE_ACCESS_MASK;
+    }
+
+    //
+    // The view copies the PML2 entries of the regions that are not shared, and
+    // the PML1 tables of some of the split regions (e.g., for its hooked pages)
+    //
+    Ept->ViewPml2 = Ept->Pml2;
+
+    for (UINT64 Region = TEST_MONITOR_RANGE_SHARED_REGIONS; RandomState != NULL && Region < NumberOfRegions; Region++)
+    {
+        if (!(Ept->ViewPml2[Region] & TEST_MONITOR_RANGE_LARGE_PAGE) && UnitTestGetRandom(RandomState) % 2 == 0)
+        {
+            Ept->Tables.push_back(Ept->Tables[Ept->ViewPml2[Region] >> 12]);
+
+            Ept->ViewPml2[Region] = ((UINT64)(Ept->Tables.size() - 1) << 12) | MONITOR_RANGE_TABLE_ACCESS_MASK;
+        }
+    }
+}
+
+/**
+ * @brief Protect or restore a range in the EPT of the core and in its view
+ * (same as hyperhv)
+ *
+ * @param Ept
+ * @param Range
+ * @param Operation
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestMonitorRangeApplyToCore(PTEST_MONITOR_RANGE_EPT Ept, PTEST_MONITOR_RANGE_DESCRIPTOR Range, MONITOR_RANGE_TABLE_OPERATION Operation)
+{
+    MONITOR_RANGE_TABLE_MEMORY Memory;
+
+    Memory.GetEntry       = TestMonitorRangeGetEntry;
+    Memory.SplitLargePage = TestMonitorRangeSplitLargePage;
+    Memory.Context        = Ept;
+
+    if (!MonitorRangeTableApply(Range->PhysicalBaseAddress, Range->PhysicalEndAddress, Range->MonitoredAccess, Operation, &Memory))
+    {
+        return FALSE;
+    }
+
+    Memory.GetEntry       = TestMonitorRangeGetViewEntry;
+    Memory.SplitLargePage = NULL;
+
+    return MonitorRangeTableApply(Range->PhysicalBaseAddress, Range->PhysicalEndAddress, Range->MonitoredAccess, Operation, &Memory);
+}
+
+/**
+ * @brief Find the range that contains a page
+ *
+ * @param Ranges
+ * @param Page
+ *
+ * @return PTEST_MONITOR_RANGE_DESCRIPTOR
+ */
+static PTEST_MONITOR_RANGE_DESCRIPTOR
+TestMonitorRangeFind(std::vector<TEST_MONITOR_RANGE_DESCRIPTOR> & Ranges, UINT64 Page)
+{
+    for (auto & Range : Ranges)
+    {
+        if (Page * PAGE_SIZE >= Range.PhysicalBaseAddress && Page * PAGE_SIZE <= Range.PhysicalEndAddress)
+        {
+            return &Range;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Check the entry of a page in the EPT of the core or in the view
+ * @details the pages of the ranges lose the monitored accesses (unless they
+ * are unprotected for an instruction), the other pages keep their original
+ * entries, and the large pages at the edges of the ranges are split in the
+ * EPT of the core (the copied entries of the view are not split)
+ *
+ * @param Ept
+ * @param Ranges
+ * @param Unprotected The entries that are unprotected for an instruction
+ * @param Page
+ * @param IsView
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestMonitorRangeCheckPage(PTEST_MONITOR_RANGE_EPT                      Ept,
+                          std::vector<TEST_MONITOR_RANGE_DESCRIPTOR> & Ranges,
+                          std::set<UINT64 *> &                         Unprotected,
+                          UINT64                                       Page,
+                          BOOLEAN                                      IsView)
+{
+    UINT64 *                       Entry;
+    UINT64                         Expected;
+    UINT64                         Frame;
+    PTEST_MONITOR_RANGE_DESCRIPTOR Range;
+    BOOLEAN                        IsLargePage     = FALSE;
+    UINT64                         PhysicalAddress = Page * PAGE_SIZE;
+    UINT64                         Region          = PhysicalAddress & ~(MONITOR_RANGE_TABLE_LARGE_PAGE_SIZE - 1);
+
+    Entry = (UINT64 *)(IsView ? TestMonitorRangeGetViewEntry : TestMonitorRangeGetEntry)(PhysicalAddress, &IsLargePage, Ept);
+    Range = TestMonitorRangeFind(Ranges, Page);
+
+    if (Range != NULL && IsLargePage &&
+        (Range->PhysicalBaseAddress > Region || Range->PhysicalEndAddress < Region + MONITOR_RANGE_TABLE_LARGE_PAGE_SIZE - 1))
+    {
+        if (!IsView)
+        {
+            ShowMessages("\t[x] the large page of the page 0x%llx is not split\n", Page);
+            return FALSE;
+        }
+
+        Range = NULL;
+    }
+
+    Expected = Ept->Original[Page];
+
+    if (Range != NULL && Unprotected.count(Entry) == 0)
+    {
+        Expected &= ~Range->MonitoredAccess;
+    }
+
+    Frame = IsLargePage ? Region : PhysicalAddress;
+
+    if ((*Entry & MONITOR_RANGE_TABLE_ACCESS_MASK) != Expected ||
+        (*Entry & TEST_MONITOR_RANGE_FRAME_MASK) != Frame ||
+        (*Entry & 0xf8) != (TEST_MONITOR_RANGE_MEMORY_TYPE | (IsLargePage ? TEST_MONITOR_RANGE_LARGE_PAGE : 0)) ||
+        ((*Entry & MONITOR_RANGE_TABLE_PROTECTED_FLAG) != 0) != (Range != NULL) ||
+        (Range == NULL && (*Entry >> MONITOR_RANGE_TABLE_SAVED_ACCESS_SHIFT) != 0))
+    {
+        ShowMessages("\t[x] the entry of the page 0x%llx in the %s is 0x%llx (expected accesses 0x%llx)\n",
+                     Page,
+                     IsView ? "view" : "EPT",
+                     *Entry,
+                     Expected);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Check the entries of all the pages
+ *
+ * @param Ept
+ * @param Ranges
+ * @param Unprotected
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestMonitorRangeCheckAll(PTEST_MONITOR_RANGE_EPT                      Ept,
+                         std::vector<TEST_MONITOR_RANGE_DESCRIPTOR> & Ranges,
+                         std::set<UINT64 *> &                         Unprotected)
+{
+    for (UINT64 Page = 0; Page < Ept->Original.size(); Page++)
+    {
+        if (!TestMonitorRangeCheckPage(Ept, Ranges, Unprotected, Page, FALSE) ||
+            !TestMonitorRangeCheckPage(Ept, Ranges, Unprotected, Page, TRUE))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Monitor a random range that doesn't overlap the other ranges
+ *
+ * @param Ept
+ * @param Ranges
+ * @param RandomState
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestMonitorRangeAdd(PTEST_MONITOR_RANGE_EPT Ept, std::vector<TEST_MONITOR_RANGE_DESCRIPTOR> & Ranges, UINT64 * RandomState)
+{
+    TEST_MONITOR_RANGE_DESCRIPTOR Range;
+    UINT64                        Start;
+    UINT64                        NumberOfPages;
+    UINT32                        Kind = (UINT32)(UnitTestGetRandom(RandomState) % 4);
+
+    if (Ranges.size() == TEST_MONITOR_RANGE_MAXIMUM_RANGES)
+    {
+        return TRUE;
+    }
+
+    if (Kind == 0)
+    {
+        NumberOfPages = 1 + UnitTestGetRandom(RandomState) % 4;
+        Start         = UnitTestGetRandom(RandomState) % Ept->Original.size();
+    }
+    else if (Kind == 1)
+    {
+        NumberOfPages = 1 + UnitTestGetRandom(RandomState) % (3 * TEST_MONITOR_RANGE_PAGES_PER_REGION);
+        Start         = UnitTestGetRandom(RandomState) % Ept->Original.size();
+    }
+    else
+    {
+        //
+        // The regions that are completely in the range keep their large pages
+        //
+        NumberOfPages = TEST_MONITOR_RANGE_PAGES_PER_REGION * (1 + UnitTestGetRandom(RandomState) % 3);
+        Start         = TEST_MONITOR_RANGE_PAGES_PER_REGION * (UnitTestGetRandom(RandomState) % TEST_MONITOR_RANGE_NUMBER_OF_REGIONS);
+
+        if (Kind == 3)
+        {
+            Start += UnitTestGetRandom(RandomState) % TEST_MONITOR_RANGE_PAGES_PER_REGION;
+        }
+    }
+
+    if (Start + NumberOfPages > Ept->Original.size())
+    {
+        return TRUE;
+    }
+
+    Range.PhysicalBaseAddress = Start * PAGE_SIZE;
+    Range.PhysicalEndAddress  = (Start + NumberOfPages) * PAGE_SIZE - 1;
+    Range.MonitoredAccess     = 1 + UnitTestGetRandom(RandomState) % MONITOR_RANGE_TABLE_ACCESS_MASK;
+
+    for (auto & Other : Ranges)
+    {
+        if (Other.PhysicalBaseAddress <= Range.PhysicalEndAddress && Other.PhysicalEndAddress >= Range.PhysicalBaseAddress)
+        {
+            return TRUE;
+        }
+    }
+
+    if (!TestMonitorRangeApplyToCore(Ept, &Range, MonitorRangeTableProtect))
+    {
+        ShowMessages("\t[x] the range 0x%llx-0x%llx is not protected\n", Range.PhysicalBaseAddress, Range.PhysicalEndAddress);
+        return FALSE;
+    }
+
+    Ranges.push_back(Range);
+
+    return TRUE;
+}
+
+/**
+ * @brief Remove a random range
+ *
+ * @param Ept
+ * @param Ranges
+ * @param RandomState
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestMonitorRangeRemove(PTEST_MONITOR_RANGE_EPT Ept, std::vector<TEST_MONITOR_RANGE_DESCRIPTOR> & Ranges, UINT64 * RandomState)
+{
+    size_t Index = (size_t)(UnitTestGetRandom(RandomState) % Ranges.size());
+
+    if (!TestMonitorRangeApplyToCore(Ept, &Ranges[Index], MonitorRangeTableRestore))
+    {
+        return FALSE;
+    }
+
+    Ranges.erase(Ranges.begin() + Index);
+
+    return TRUE;
+}
+
+/**
+ * @brief An instruction that accesses the pages of a range
+ * @details the pages are unprotected in the EPT of the core or in the view
+ * (whichever the core is on), a range might be removed while the instruction
+ * is executed, and the pages of the remaining ranges are protected again in
+ * the same tables (like the MTF vm-exit of hyperhv)
+ *
+ * @param Ept
+ * @param Ranges
+ * @param RandomState
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestMonitorRangeInstruction(PTEST_MONITOR_RANGE_EPT Ept, std::vector<TEST_MONITOR_RANGE_DESCRIPTOR> & Ranges, UINT64 * RandomState)
+{
+    BOOLEAN                        Result = TRUE;
+    UINT64                         Pages[TEST_MONITOR_RANGE_RESTORE_POINTS];
+    BOOLEAN                        IsOnView[TEST_MONITOR_RANGE_RESTORE_POINTS];
+    std::set<UINT64 *>             Unprotected;
+    PTEST_MONITOR_RANGE_DESCRIPTOR Range         = &Ranges[UnitTestGetRandom(RandomState) % Ranges.size()];
+    UINT32                         NumberOfPages = 1 + (UINT32)(UnitTestGetRandom(RandomState) % TEST_MONITOR_RANGE_RESTORE_POINTS);
+    BOOLEAN                        IsLargePage   = FALSE;
+    UINT64 *                       Entry;
+
+    for (UINT32 i = 0; i < NumberOfPages; i++)
+    {
+        Pages[i]    = Range->PhysicalBaseAddress / PAGE_SIZE + UnitTestGetRandom(RandomState) % ((Range->PhysicalEndAddress - Range->PhysicalBaseAddress + 1) / PAGE_SIZE);
+        IsOnView[i] = UnitTestGetRandom(RandomState) % 2 == 0;
+
+        Entry = (UINT64 *)(IsOnView[i] ? TestMonitorRangeGetViewEntry : TestMonitorRangeGetEntry)(Pages[i] * PAGE_SIZE, &IsLargePage, Ept);
+
+        MonitorRangeTableSetEntry(Entry, 0, MonitorRangeTableUnprotect);
+
+        Unprotected.insert(Entry);
+    }
+
+    UnitTestExpect(Result, TestMonitorRangeCheckAll(Ept, Ranges, Unprotected));
+
+    if (UnitTestGetRandom(RandomState) % 4 == 0)
+    {
+        UnitTestExpect(Result, TestMonitorRangeRemove(Ept, Ranges, RandomState));
+        UnitTestExpect(Result, TestMonitorRangeCheckAll(Ept, Ranges, Unprotected));
+    }
+
+    for (UINT32 i = 0; i < NumberOfPages; i++)
+    {
+        Range = TestMonitorRangeFind(Ranges, Pages[i]);
+
+        if (Range == NULL)
+        {
+            continue;
+        }
+
+        Entry = (UINT64 *)(IsOnView[i] ? TestMonitorRangeGetViewEntry : TestMonitorRangeGetEntry)(Pages[i] * PAGE_SIZE, &IsLargePage, Ept);
+
+        MonitorRangeTableSetEntry(Entry, Range->MonitoredAccess, MonitorRangeTableReprotect);
+    }
+
+    return Result;
+}
+
+/**
+ * @brief Run the model
+ *
+ * @param Seed
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestMonitorRangeRun(UINT64 Seed)
+{
+    BOOLEAN                                    Result      = TRUE;
+    UINT64                                     RandomState = Seed;
+    UINT32                                     Action;
+    std::unique_ptr<TEST_MONITOR_RANGE_EPT>    Ept = std::make_unique<TEST_MONITOR_RANGE_EPT>();
+    std::vector<TEST_MONITOR_RANGE_DESCRIPTOR> Ranges;
+    std::set<UINT64 *>                         Unprotected;
+
+    TestMonitorRangeInitialize(Ept.get(), TEST_MONITOR_RANGE_NUMBER_OF_REGIONS, &RandomState);
+
+    UnitTestExpect(Result, TestMonitorRangeCheckAll(Ept.get(), Ranges, Unprotected));
+
+    for (UINT32 Step = 0; Result && Step < TEST_MONITOR_RANGE_NUMBER_OF_STEPS; Step++)
+    {
+        Action = (UINT32)(UnitTestGetRandom(&RandomState) % 4);
+
+        if (Action == 0 || Ranges.empty())
+        {
+            UnitTestExpect(Result, TestMonitorRangeAdd(Ept.get(), Ranges, &RandomState));
+        }
+        else if (Action == 1)
+        {
+            UnitTestExpect(Result, TestMonitorRangeRemove(Ept.get(), Ranges, &RandomState));
+        }
+        else
+        {
+            UnitTestExpect(Result, TestMonitorRangeInstruction(Ept.get(), Ranges, &RandomState));
+        }
+
+        UnitTestExpect(Result, TestMonitorRangeCheckAll(Ept.get(), Ranges, Unprotected));
+
+        if (!Result)
+        {
+            ShowMessages("\t[x] an unexpected entry at the step %d\n", Step);
+        }
+    }
+
+    //
+    // The original entries are restored (the split large pages are not merged)
+    //
+    while (Result && !Ranges.empty())
+    {
+        UnitTestExpect(Result, TestMonitorRangeRemove(Ept.get(), Ranges, &RandomState));
+    }
+
+    UnitTestExpect(Result, TestMonitorRangeCheckAll(Ept.get(), Ranges, Unprotected));
+
+    return Result;
+}
+
+/**
+ * @brief Test the operations on a single entry
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestMonitorRangeEntries()
+{
+    BOOLEAN Result   = TRUE;
+    UINT64  Original = (0x1234ull * PAGE_SIZE) | TEST_MONITOR_RANGE_MEMORY_TYPE | 0x5;
+    UINT64  Entry    = Original;
+
+    //
+    // The entries that are not protected are only changed by protecting them
+    //
+    MonitorRangeTableSetEntry(&Entry, 0x1, MonitorRangeTableUnprotect);
+    MonitorRangeTableSetEntry(&Entry, 0x1, MonitorRangeTableReprotect);
+    MonitorRangeTableSetEntry(&Entry, 0x1, MonitorRangeTableRestore);
+
+    UnitTestExpect(Result, Entry == Original);
+
+    //
+    // A read-execute page that is monitored for read and write accesses
+    //
+    MonitorRangeTableSetEntry(&Entry, 0x3, MonitorRangeTableProtect);
+
+    UnitTestExpect(Result, (Entry & MONITOR_RANGE_TABLE_ACCESS_MASK) == 0x4);
+    UnitTestExpect(Result, (Entry & MONITOR_RANGE_TABLE_PROTECTED_FLAG) != 0);
+    UnitTestExpect(Result, (Entry & TEST_MONITOR_RANGE_FRAME_MASK) == (Original & TEST_MONITOR_RANGE_FRAME_MASK));
+
+    MonitorRangeTableSetEntry(&Entry, 0x3, MonitorRangeTableProtect);
+
+    UnitTestExpect(Result, (Entry & MONITOR_RANGE_TABLE_ACCESS_MASK) == 0x4);
+
+    //
+    // The instruction gets the original accesses (not all the accesses)
+    //
+    MonitorRangeTableSetEntry(&Entry, 0, MonitorRangeTableUnprotect);
+    MonitorRangeTableSetEntry(&Entry, 0, MonitorRangeTableUnprotect);
+
+    UnitTestExpect(Result, (Entry & MONITOR_RANGE_TABLE_ACCESS_MASK) == 0x5);
+    UnitTestExpect(Result, (Entry & MONITOR_RANGE_TABLE_PROTECTED_FLAG) != 0);
+
+    MonitorRangeTableSetEntry(&Entry, 0x4, MonitorRangeTableReprotect);
+
+    UnitTestExpect(Result, (Entry & MONITOR_RANGE_TABLE_ACCESS_MASK) == 0x1);
+
+    MonitorRangeTableSetEntry(&Entry, 0, MonitorRangeTableRestore);
+
+    UnitTestExpect(Result, Entry == Original);
+
+    MonitorRangeTableSetEntry(&Entry, 0, MonitorRangeTableRestore);
+
+    UnitTestExpect(Result, Entry == Original);
+
+    return Result;
+}
+
+/**
+ * @brief Test the failures of protecting a range
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestMonitorRangeFailures()
+{
+    BOOLEAN                                 Result = TRUE;
+    TEST_MONITOR_RANGE_DESCRIPTOR           Range;
+    MONITOR_RANGE_TABLE_MEMORY              Memory;
+    std::unique_ptr<TEST_MONITOR_RANGE_EPT> Ept = std::make_unique<TEST_MONITOR_RANGE_EPT>();
+
+    TestMonitorRangeInitialize(Ept.get(), TEST_MONITOR_RANGE_NUMBER_OF_REGIONS, NULL);
+
+    Memory.GetEntry       = TestMonitorRangeGetEntry;
+    Memory.SplitLargePage = TestMonitorRangeSplitLargePage;
+    Memory.Context        = Ept.get();
+
+    Range.PhysicalBaseAddress = 3 * PAGE_SIZE;
+    Range.PhysicalEndAddress  = 5 * PAGE_SIZE - 1;
+    Range.MonitoredAccess     = 0x2;
+
+    //
+    // The large page at the edge can't be split
+    //
+    Ept->SplitBudget = 0;
+
+    UnitTestExpect(Result, !MonitorRangeTableApply(Range.PhysicalBaseAddress, Range.PhysicalEndAddress, Range.MonitoredAccess, MonitorRangeTableProtect, &Memory));
+    UnitTestExpect(Result, Ept->Splits == 0);
+
+    //
+    // The tables that can't be split are skipped
+    //
+    Memory.SplitLargePage = NULL;
+
+    UnitTestExpect(Result, MonitorRangeTableApply(Range.PhysicalBaseAddress, Range.PhysicalEndAddress, Range.MonitoredAccess, MonitorRangeTableProtect, &Memory));
+    UnitTestExpect(Result, !(Ept->Pml2[0] & MONITOR_RANGE_TABLE_PROTECTED_FLAG));
+
+    //
+    // The range is not mapped by the EPT
+    //
+    UnitTestExpect(Result, !MonitorRangeTableApply(TEST_MONITOR_RANGE_NUMBER_OF_REGIONS * MONITOR_RANGE_TABLE_LARGE_PAGE_SIZE - PAGE_SIZE, TEST_MONITOR_RANGE_NUMBER_OF_REGIONS * MONITOR_RANGE_TABLE_LARGE_PAGE_SIZE + PAGE_SIZE - 1, Range.MonitoredAccess, MonitorRangeTableProtect, &Memory));
+
+    return Result;
+}
+
+/**
+ * @brief Tests of the EPT entries of the monitored ranges
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+TestMonitorRange()
+{
+    BOOLEAN Result = TRUE;
+
+    UnitTestExpect(Result, TestMonitorRangeEntries());
+    UnitTestExpect(Result, TestMonitorRangeFailures());
+    UnitTestExpect(Result, TestMonitorRangeRun(0x4d6f6e52616e6765ull));
+
+    return Result;
+}
+
+/**
+ * @brief Protect and restore the pages of a range with a hook for each page
+ * @details each large page that is touched is split
+ *
+ * @param Ept
+ * @param PhysicalBaseAddress
+ * @param NumberOfPages
+ *
+ * @return VOID
+ */
+static VOID
+TestMonitorRangeHookEachPage(PTEST_MONITOR_RANGE_EPT Ept, UINT64 PhysicalBaseAddress, UINT64 NumberOfPages)
+{
+    PVOID   Entry;
+    BOOLEAN IsLargePage = FALSE;
+
+    for (UINT64 i = 0; i < NumberOfPages; i++)
+    {
+        Entry = TestMonitorRangeGetEntry(PhysicalBaseAddress + i * PAGE_SIZE, &IsLargePage, Ept);
+
+        if (IsLargePage)
+        {
+            TestMonitorRangeSplitLargePage(PhysicalBaseAddress + i * PAGE_SIZE, Ept);
+
+            Entry = TestMonitorRangeGetEntry(PhysicalBaseAddress + i * PAGE_SIZE, &IsLargePage, Ept);
+        }
+
+        MonitorRangeTableSetEntry(Entry, 0x2, MonitorRangeTableProtect);
+    }
+
+    for (UINT64 i = 0; i < NumberOfPages; i++)
+    {
+        Entry = TestMonitorRangeGetEntry(PhysicalBaseAddress + i * PAGE_SIZE, &IsLargePage, Ept);
+
+        MonitorRangeTableSetEntry(Entry, 0, MonitorRangeTableRestore);
+    }
+}
+
+/**
+ * @brief Benchmark of the EPT entries of the monitored ranges
+ * @details a range of 4KB to 1GB (that doesn't start at the beginning of a
+ * region) is protected and restored by a single descriptor, compared to a
+ * hook for each page
+ *
+ * @return VOID
+ */
+VOID
+BenchmarkMonitorRange()
+{
+    std::unique_ptr<TEST_MONITOR_RANGE_EPT> Ept = std::make_unique<TEST_MONITOR_RANGE_EPT>();
+    MONITOR_RANGE_TABLE_MEMORY              Memory;
+    UINT64                                  StartTime;
+    UINT64                                  Splits;
+    UINT64                                  PhysicalBaseAddress = 3 * PAGE_SIZE;
+
+    const struct
+    {
+        const CHAR * Name;
+        const CHAR * PerPageName;
+        UINT64       NumberOfPages;
+
+    } Sizes[] = {
+        {"range of 4 KB (a descriptor)", "range of 4 KB (a hook per page)", 1},
+        {"range of 64 KB (a descriptor)", "range of 64 KB (a hook per page)", 16},
+        {"range of 2 MB (a descriptor)", "range of 2 MB (a hook per page)", TEST_MONITOR_RANGE_PAGES_PER_REGION},
+        {"range of 64 MB (a descriptor)", "range of 64 MB (a hook per page)", 32 * TEST_MONITOR_RANGE_PAGES_PER_REGION},
+        {"range of 1 GB (a descriptor)", "range of 1 GB (a hook per page)", 512 * TEST_MONITOR_RANGE_PAGES_PER_REGION},
+    };
+
+    for (auto & Size : Sizes)
+    {
+        TestMonitorRangeInitialize(Ept.get(), TEST_MONITOR_RANGE_BENCHMARK_REGIONS, NULL);
+
+        Memory.GetEntry       = TestMonitorRangeGetEntry;
+        Memory.SplitLargePage = TestMonitorRangeSplitLargePage;
+        Memory.Context        = Ept.get();
+
+        StartTime = UnitTestGetTimeInNanoseconds();
+
+        MonitorRangeTableApply(PhysicalBaseAddress, PhysicalBaseAddress + Size.NumberOfPages * PAGE_SIZE - 1, 0x2, MonitorRangeTableProtect, &Memory);
+        MonitorRangeTableApply(PhysicalBaseAddress, PhysicalBaseAddress + Size.NumberOfPages * PAGE_SIZE - 1, 0x2, MonitorRangeTableRestore, &Memory);
+
+        UnitTestShowBenchmarkResult(Size.Name, UnitTestGetTimeInNanoseconds() - StartTime, Size.NumberOfPages);
+
+        Splits = Ept->Splits;
+
+        TestMonitorRangeInitialize(Ept.get(), TEST_MONITOR_RANGE_BENCHMARK_REGIONS, NULL);
+
+        StartTime = UnitTestGetTimeInNanoseconds();
+
+        TestMonitorRangeHookEachPage(Ept.get(), PhysicalBaseAddress, Size.NumberOfPages);
+
+        UnitTestShowBenchmarkResult(Size.PerPageName, UnitTestGetTimeInNanoseconds() - StartTime, Size.NumberOfPages);
+
+        ShowMessages("\t%lld split large pages (a descriptor), %lld split large pages (a hook per page)\n", Splits, Ept->Splits);
+    }
+}
+
+UnitTestRegister("monitor-range", TestMonitorRange, BenchmarkMonitorRange);
@@ -0,0 +1,675 @@
+/**
+ * @file test-pool-watermark.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Tests and benchmark of the watermarks of the pre-allocated pools
+ * @details the watermarks (PoolWatermark.c) are shared with hyperhv, the
+ * requests of the instant events arrive in bursts (in ticks of 1ms), and the
+ * pools are either replaced one-for-one once an IOCTL is received, or they
+ * are replenished by the worker of the pool manager (every 10ms)
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Number of the ticks (milliseconds) of the simulation
+ *
+ */
+#define TEST_POOL_WATERMARK_NUMBER_OF_TICKS 30000
+
+/**
+ * @brief Interval of the replenishment worker in ticks (same as hyperhv)
+ *
+ */
+#define TEST_POOL_WATERMARK_WORKER_INTERVAL 10
+
+/**
+ * @brief Maximum number of the replacements that are queued until an IOCTL
+ * is received (same as hyperhv)
+ *
+ */
+#define TEST_POOL_WATERMARK_QUEUE_DEPTH 300
+
+/**
+ * @brief The average number of ticks between two IOCTLs
+ *
+ */
+#define TEST_POOL_WATERMARK_IOCTL_INTERVAL 500
+
+/**
+ * @brief Maximum number of ticks that a pool is used by an event
+ *
+ */
+#define TEST_POOL_WATERMARK_MAXIMUM_LIFETIME 2000
+
+/**
+ * @brief Size of the pools (about the size of a regular instant event and
+ * its conditional buffer)
+ *
+ */
+#define TEST_POOL_WATERMARK_POOL_SIZE 0x200
+
+/**
+ * @brief The requests of a simulation
+ *
+ */
+typedef struct _TEST_POOL_WATERMARK_REQUESTS
+{
+    std::vector<UINT32>  Requests;  // the number of requests of each tick
+    std::vector<UINT32>  Lifetimes; // the lifetime of the pool of each request
+    std::vector<BOOLEAN> Ioctls;    // whether an IOCTL is received at each tick or not
+    UINT32               WorkerPhase;
+    UINT32               NumberOfRequests;
+    UINT32               MaximumRequestsPerInterval; // in any TEST_POOL_WATERMARK_WORKER_INTERVAL ticks
+
+} TEST_POOL_WATERMARK_REQUESTS, *PTEST_POOL_WATERMARK_REQUESTS;
+
+/**
+ * @brief A strategy for replacing the pools
+ *
+ */
+typedef struct _TEST_POOL_WATERMARK_STRATEGY
+{
+    const CHAR * Name;
+    UINT32       LowWatermark;
+    UINT32       HighWatermark; // zero for one-for-one replacement (after an IOCTL)
+    UINT32       Reserve;       // the pools that are pre-allocated for one-for-one replacement
+
+} TEST_POOL_WATERMARK_STRATEGY, *PTEST_POOL_WATERMARK_STRATEGY;
+
+/**
+ * @brief The result of a simulation
+ *
+ */
+typedef struct _TEST_POOL_WATERMARK_RESULT
+{
+    BOOLEAN IsConsistent;
+    UINT64  NumberOfFailedRequests;
+    UINT64  NumberOfDroppedReplacements;
+    UINT64  AverageIdleBytes;
+    UINT32  MaximumBurst;
+    UINT32  MissingPools;
+
+} TEST_POOL_WATERMARK_RESULT, *PTEST_POOL_WATERMARK_RESULT;
+
+/**
+ * @brief Generate the requests of a simulation
+ * @details the bursts are limited to the given number of requests in every
+ * TEST_POOL_WATERMARK_WORKER_INTERVAL ticks (e.g., by throttling the events)
+ *
+ * @param Requests
+ * @param Seed
+ * @param BurstsPerSecond
+ * @param MaximumBurstSize
+ * @param RateLimit Zero if the bursts are not limited
+ *
+ * @return VOID
+ */
+static VOID
+TestPoolWatermarkGenerate(PTEST_POOL_WATERMARK_REQUESTS Requests,
+                          UINT64                        Seed,
+                          UINT32                        BurstsPerSecond,
+                          UINT32                        MaximumBurstSize,
+                          UINT32                        RateLimit)
+{
+    UINT64 RandomState = Seed;
+    UINT32 Remaining   = 0;
+    UINT32 Window      = 0;
+    UINT32 Count;
+
+    Requests->Requests.assign(TEST_POOL_WATERMARK_NUMBER_OF_TICKS, 0);
+    Requests->Ioctls.assign(TEST_POOL_WATERMARK_NUMBER_OF_TICKS, FALSE);
+    Requests->Lifetimes.clear();
+
+    Requests->WorkerPhase                = (UINT32)(UnitTestGetRandom(&RandomState) % TEST_POOL_WATERMARK_WORKER_INTERVAL);
+    Requests->NumberOfRequests           = 0;
+    Requests->MaximumRequestsPerInterval = 0;
+
+    for (UINT32 Tick = 0; Tick < TEST_POOL_WATERMARK_NUMBER_OF_TICKS; Tick++)
+    {
+        //
+        // A burst is a few requests in each tick until it's done
+        //
+        if (UnitTestGetRandom(&RandomState) % 1000 < BurstsPerSecond)
+        {
+            Remaining += 1 + (UINT32)(UnitTestGetRandom(&RandomState) % MaximumBurstSize);
+        }
+
+        Count = 0;
+
+        if (Remaining != 0)
+        {
+            Count = 1 + (UINT32)(UnitTestGetRandom(&RandomState) % 3);
+
+            if (Count > Remaining)
+            {
+                Count = Remaining;
+            }
+
+            Remaining -= Count;
+        }
+
+        if (Tick >= TEST_POOL_WATERMARK_WORKER_INTERVAL)
+        {
+            Window -= Requests->Requests[Tick - TEST_POOL_WATERMARK_WORKER_INTERVAL];
+        }
+
+        if (RateLimit != 0 && Window + Count > RateLimit)
+        {
+            Count = RateLimit - Window;
+        }
+
+        Requests->Requests[Tick] = Count;
+        Window += Count;
+
+        if (Window > Requests->MaximumRequestsPerInterval)
+        {
+            Requests->MaximumRequestsPerInterval = Window;
+        }
+
+        for (UINT32 i = 0; i < Count; i++)
+        {
+            Requests->Lifetimes.push_back(1 + (UINT32)(UnitTestGetRandom(&RandomState) % TEST_POOL_WATERMARK_MAXIMUM_LIFETIME));
+        }
+
+        Requests->NumberOfRequests += Count;
+
+        Requests->Ioctls[Tick] = UnitTestGetRandom(&RandomState) % TEST_POOL_WATERMARK_IOCTL_INTERVAL == 0;
+    }
+}
+
+/**
+ * @brief Perform a replenishment pass (same as PlmgrReplenishPools)
+ *
+ * @param State
+ * @param IsReplenishmentRequested The flag of the worker
+ *
+ * @return UINT32 The number of the allocated pools
+ */
+static UINT32
+TestPoolWatermarkReplenish(PPOOL_WATERMARK_STATE State, BOOLEAN * IsReplenishmentRequested)
+{
+    SIZE_T Size = 0;
+    UINT32 Count;
+
+    *IsReplenishmentRequested = FALSE;
+
+    Count = PoolWatermarkGetReplenishmentCount(State, &Size);
+
+    if (Count == 0)
+    {
+        return 0;
+    }
+
+    for (UINT32 i = 0; i < Count; i++)
+    {
+        PoolWatermarkAddPool(State, Size);
+    }
+
+    if (PoolWatermarkCompleteReplenishment(State, Count, TRUE))
+    {
+        *IsReplenishmentRequested = TRUE;
+    }
+
+    return Count;
+}
+
+/**
+ * @brief Run a simulation
+ * @details the pools of the events that are cleared are freed, the pools are
+ * only allocated from PASSIVE_LEVEL (the worker or an IOCTL)
+ *
+ * @param Requests
+ * @param Strategy
+ * @param Result
+ *
+ * @return VOID
+ */
+static VOID
+TestPoolWatermarkRun(PTEST_POOL_WATERMARK_REQUESTS Requests, PTEST_POOL_WATERMARK_STRATEGY Strategy, PTEST_POOL_WATERMARK_RESULT Result)
+{
+    POOL_WATERMARK_STATE              State                    = {0};
+    POOL_MANAGER_INTENTION_STATISTICS Statistics               = {0};
+    BOOLEAN                           IsReplenishmentRequested = FALSE;
+    BOOLEAN                           IsSuccessful;
+    UINT32                            NumberOfFreePools        = 0;
+    UINT32                            NumberOfBusyPools        = 0;
+    UINT32                            QueuedReplacements       = 0;
+    UINT32                            Request                  = 0;
+    UINT64                            IdlePools                = 0;
+    std::vector<UINT32>               Expirations(TEST_POOL_WATERMARK_NUMBER_OF_TICKS + TEST_POOL_WATERMARK_MAXIMUM_LIFETIME + 1, 0);
+
+    RtlZeroMemory(Result, sizeof(TEST_POOL_WATERMARK_RESULT));
+
+    Result->IsConsistent = TRUE;
+
+    for (UINT32 i = 0; i < Strategy->Reserve; i++)
+    {
+        PoolWatermarkAddPool(&State, TEST_POOL_WATERMARK_POOL_SIZE);
+        NumberOfFreePools++;
+    }
+
+    //
+    // The intention is filled up to the high watermark before the events are used
+    //
+    if (PoolWatermarkSet(&State, TEST_POOL_WATERMARK_POOL_SIZE, Strategy->LowWatermark, Strategy->HighWatermark))
+    {
+        IsReplenishmentRequested = TRUE;
+    }
+
+    while (IsReplenishmentRequested)
+    {
+        NumberOfFreePools += TestPoolWatermarkReplenish(&State, &IsReplenishmentRequested);
+    }
+
+    for (UINT32 Tick = 0; Tick < TEST_POOL_WATERMARK_NUMBER_OF_TICKS; Tick++)
+    {
+        //
+        // The pools of the cleared events are freed
+        //
+        for (UINT32 i = 0; i < Expirations[Tick]; i++)
+        {
+            PoolWatermarkRemovePool(&State, TRUE);
+            NumberOfBusyPools--;
+        }
+
+        //
+        // The requests from vmx-root
+        //
+        for (UINT32 i = 0; i < Requests->Requests[Tick]; i++, Request++)
+        {
+            IsSuccessful = NumberOfFreePools != 0;
+
+            if (IsSuccessful)
+            {
+                NumberOfFreePools--;
+                NumberOfBusyPools++;
+                Expirations[Tick + Requests->Lifetimes[Request]]++;
+            }
+            else
+            {
+                Result->NumberOfFailedRequests++;
+            }
+
+            if (PoolWatermarkCountRequest(&State, IsSuccessful))
+            {
+                IsReplenishmentRequested = TRUE;
+            }
+
+            if (Strategy->HighWatermark == 0)
+            {
+                if (QueuedReplacements < TEST_POOL_WATERMARK_QUEUE_DEPTH)
+                {
+                    QueuedReplacements++;
+                }
+                else
+                {
+                    Result->NumberOfDroppedReplacements++;
+                }
+            }
+        }
+
+        //
+        // The one-for-one replacements are allocated once an IOCTL is received
+        //
+        if (Requests->Ioctls[Tick])
+        {
+            for (; QueuedReplacements != 0; QueuedReplacements--)
+            {
+                PoolWatermarkAddPool(&State, TEST_POOL_WATERMARK_POOL_SIZE);
+                NumberOfFreePools++;
+            }
+        }
+
+        //
+        // The worker only checks the flag after each interval
+        //
+        if (Tick % TEST_POOL_WATERMARK_WORKER_INTERVAL == Requests->WorkerPhase && IsReplenishmentRequested)
+        {
+            NumberOfFreePools += TestPoolWatermarkReplenish(&State, &IsReplenishmentRequested);
+        }
+
+        if (State.NumberOfFreePools != NumberOfFreePools || State.NumberOfBusyPools != NumberOfBusyPools)
+        {
+            Result->IsConsistent = FALSE;
+        }
+
+        IdlePools += NumberOfFreePools;
+    }
+
+    PoolWatermarkQueryStatistics(&State, &Statistics);
+
+    if (Statistics.NumberOfRequests != Requests->NumberOfRequests ||
+        Statistics.NumberOfFailedRequests != Result->NumberOfFailedRequests ||
+        Statistics.PeakDemand < Statistics.PeakNumberOfBusyPools)
+    {
+        Result->IsConsistent = FALSE;
+    }
+
+    Result->AverageIdleBytes = IdlePools * TEST_POOL_WATERMARK_POOL_SIZE / TEST_POOL_WATERMARK_NUMBER_OF_TICKS;
+    Result->MaximumBurst     = Statistics.MaximumBurst;
+    Result->MissingPools     = PoolWatermarkGetMissingPools(&Statistics);
+}
+
+/**
+ * @brief Test the counters of an intention
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestPoolWatermarkCounters()
+{
+    BOOLEAN                           Result     = TRUE;
+    POOL_WATERMARK_STATE              State      = {0};
+    POOL_MANAGER_INTENTION_STATISTICS Statistics = {0};
+    SIZE_T                            Size       = 0;
+
+    //
+    // The intention is filled up to the high watermark
+    //
+    for (UINT32 i = 0; i < 3; i++)
+    {
+        PoolWatermarkAddPool(&State, 0x100);
+    }
+
+    UnitTestExpect(Result, PoolWatermarkSet(&State, 0x100, 5, 20));
+    UnitTestExpect(Result, PoolWatermarkGetReplenishmentCount(&State, &Size) == 17 && Size == 0x100);
+
+    for (UINT32 i = 0; i < 17; i++)
+    {
+        PoolWatermarkAddPool(&State, 0x100);
+    }
+
+    UnitTestExpect(Result, !PoolWatermarkCompleteReplenishment(&State, 17, TRUE));
+    UnitTestExpect(Result, !State.IsReplenishmentRequested && State.NumberOfReplenishedPools == 17);
+
+    //
+    // Only the request that crosses the low watermark wakes up the worker
+    //
+    for (UINT32 i = 0; i < 14; i++)
+    {
+        UnitTestExpect(Result, !PoolWatermarkCountRequest(&State, TRUE));
+    }
+
+    UnitTestExpect(Result, PoolWatermarkCountRequest(&State, TRUE));
+
+    for (UINT32 i = 0; i < 5; i++)
+    {
+        UnitTestExpect(Result, !PoolWatermarkCountRequest(&State, TRUE));
+    }
+
+    UnitTestExpect(Result, !PoolWatermarkCountRequest(&State, FALSE));
+    UnitTestExpect(Result, !PoolWatermarkCountRequest(&State, FALSE));
+
+    PoolWatermarkQueryStatistics(&State, &Statistics);
+
+    UnitTestExpect(Result, Statistics.NumberOfFreePools == 0 && Statistics.NumberOfBusyPools == 20);
+    UnitTestExpect(Result, Statistics.NumberOfRequests == 22 && Statistics.NumberOfFailedRequests == 2);
+    UnitTestExpect(Result, Statistics.PeakDemand == 22 && Statistics.MaximumBurst == 7);
+    UnitTestExpect(Result, PoolWatermarkGetMissingPools(&Statistics) == 2);
+
+    //
+    // The intention is still below the low watermark after a batch
+    //
+    State.HighWatermark = POOL_WATERMARK_MAXIMUM_REPLENISHMENT_BATCH * 2;
+    State.LowWatermark  = POOL_WATERMARK_MAXIMUM_REPLENISHMENT_BATCH + 10;
+
+    UnitTestExpect(Result, PoolWatermarkGetReplenishmentCount(&State, &Size) == POOL_WATERMARK_MAXIMUM_REPLENISHMENT_BATCH);
+
+    for (UINT32 i = 0; i < POOL_WATERMARK_MAXIMUM_REPLENISHMENT_BATCH; i++)
+    {
+        PoolWatermarkAddPool(&State, 0x100);
+    }
+
+    UnitTestExpect(Result, State.NumberOfFailuresSinceLastAllocation == 0);
+    UnitTestExpect(Result, PoolWatermarkCompleteReplenishment(&State, POOL_WATERMARK_MAXIMUM_REPLENISHMENT_BATCH, TRUE));
+    UnitTestExpect(Result, State.IsReplenishmentRequested);
+
+    //
+    // A failed allocation drops the request until the next crossing
+    //
+    UnitTestExpect(Result, !PoolWatermarkCompleteReplenishment(&State, 1, FALSE));
+    UnitTestExpect(Result, !State.IsReplenishmentRequested);
+    UnitTestExpect(Result, PoolWatermarkCountRequest(&State, TRUE));
+
+    //
+    // The request is dropped if the pools are allocated in the meantime
+    // (e.g., by the 'prealloc' command), so the next crossing is not lost
+    //
+    for (UINT32 i = 0; i < POOL_WATERMARK_MAXIMUM_REPLENISHMENT_BATCH * 2; i++)
+    {
+        PoolWatermarkAddPool(&State, 0x100);
+    }
+
+    UnitTestExpect(Result, PoolWatermarkGetReplenishmentCount(&State, &Size) == 0);
+    UnitTestExpect(Result, !State.IsReplenishmentRequested);
+
+    while (State.NumberOfFreePools > State.LowWatermark + 1)
+    {
+        UnitTestExpect(Result, !PoolWatermarkCountRequest(&State, TRUE));
+    }
+
+    UnitTestExpect(Result, PoolWatermarkCountRequest(&State, TRUE));
+
+    //
+    // The pools are freed
+    //
+    PoolWatermarkRemovePool(&State, TRUE);
+    PoolWatermarkRemovePool(&State, FALSE);
+
+    UnitTestExpect(Result, State.NumberOfFreePools == State.LowWatermark - 1);
+
+    //
+    // Without the high watermark, the intention is never replenished, and the
+    // missing pools are based on the peak demand
+    //
+    UnitTestExpect(Result, !PoolWatermarkSet(&State, 0x100, 0, 0));
+    UnitTestExpect(Result, PoolWatermarkGetReplenishmentCount(&State, &Size) == 0);
+
+    RtlZeroMemory(&State, sizeof(State));
+
+    PoolWatermarkAddPool(&State, 0x100);
+
+    UnitTestExpect(Result, !PoolWatermarkCountRequest(&State, TRUE));
+    UnitTestExpect(Result, !PoolWatermarkCountRequest(&State, FALSE));
+    UnitTestExpect(Result, !PoolWatermarkCountRequest(&State, FALSE));
+
+    PoolWatermarkQueryStatistics(&State, &Statistics);
+
+    UnitTestExpect(Result, PoolWatermarkGetMissingPools(&Statistics) == 2);
+
+    //
+    // The intention is already filled up to the high watermark
+    //
+    PoolWatermarkAddPool(&State, 0x100);
+    PoolWatermarkAddPool(&State, 0x100);
+
+    UnitTestExpect(Result, !PoolWatermarkSet(&State, 0x100, 1, 2));
+    UnitTestExpect(Result, PoolWatermarkSet(&State, 0x100, 1, 3));
+
+    return Result;
+}
+
+/**
+ * @brief Test the simulation of the bursts
+ * @details the intention doesn't run out of pools if the requests in every
+ * interval of the worker don't exceed the low watermark, and the usage
+ * statistics recommend more pools if it does
+ *
+ * @param Seed
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestPoolWatermarkBursts(UINT64 Seed)
+{
+    BOOLEAN                      Result = TRUE;
+    TEST_POOL_WATERMARK_REQUESTS Requests;
+    TEST_POOL_WATERMARK_RESULT   Outcome;
+    TEST_POOL_WATERMARK_STRATEGY Strategy;
+
+    //
+    // Default watermarks of the regular instant events
+    //
+    Strategy = {"", REGULAR_INSTANT_EVENTS_LOW_WATERMARK, MAXIMUM_REGULAR_INSTANT_EVENTS, 0};
+
+    TestPoolWatermarkGenerate(&Requests, Seed, 2, 40, REGULAR_INSTANT_EVENTS_LOW_WATERMARK);
+    TestPoolWatermarkRun(&Requests, &Strategy, &Outcome);
+
+    UnitTestExpect(Result, Outcome.IsConsistent);
+    UnitTestExpect(Result, Outcome.NumberOfFailedRequests == 0);
+    UnitTestExpect(Result, Outcome.MaximumBurst <= REGULAR_INSTANT_EVENTS_LOW_WATERMARK && Outcome.MissingPools == 0);
+
+    //
+    // Larger watermarks for a higher rate
+    //
+    Strategy = {"", 32, 48, 0};
+
+    TestPoolWatermarkGenerate(&Requests, Seed, 10, 80, 32);
+    TestPoolWatermarkRun(&Requests, &Strategy, &Outcome);
+
+    UnitTestExpect(Result, Outcome.IsConsistent);
+    UnitTestExpect(Result, Outcome.NumberOfFailedRequests == 0);
+
+    //
+    // The bursts are not limited
+    //
+    Strategy = {"", REGULAR_INSTANT_EVENTS_LOW_WATERMARK, MAXIMUM_REGULAR_INSTANT_EVENTS, 0};
+
+    TestPoolWatermarkGenerate(&Requests, Seed, 2, 40, 0);
+    TestPoolWatermarkRun(&Requests, &Strategy, &Outcome);
+
+    UnitTestExpect(Result, Outcome.IsConsistent);
+    UnitTestExpect(Result, Outcome.NumberOfFailedRequests != 0);
+    UnitTestExpect(Result, Outcome.MissingPools != 0);
+    UnitTestExpect(Result, Outcome.MissingPools + Strategy.LowWatermark <= Requests.MaximumRequestsPerInterval);
+
+    //
+    // The low watermark covers the requests of any interval
+    //
+    Strategy.HighWatermark += Requests.MaximumRequestsPerInterval - Strategy.LowWatermark;
+    Strategy.LowWatermark = Requests.MaximumRequestsPerInterval;
+
+    TestPoolWatermarkRun(&Requests, &Strategy, &Outcome);
+
+    UnitTestExpect(Result, Outcome.IsConsistent);
+    UnitTestExpect(Result, Outcome.NumberOfFailedRequests == 0);
+
+    //
+    // Nothing is replenished without the high watermark
+    //
+    Strategy = {"", 0, 0, 20};
+
+    TestPoolWatermarkRun(&Requests, &Strategy, &Outcome);
+
+    UnitTestExpect(Result, Outcome.IsConsistent);
+
+    if (!Result)
+    {
+        ShowMessages("\t[x] unexpected result of the simulation (seed %llx)\n", Seed);
+    }
+
+    return Result;
+}
+
+/**
+ * @brief Tests of the watermarks of the pre-allocated pools
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+TestPoolWatermark()
+{
+    BOOLEAN Result = TRUE;
+
+    UnitTestExpect(Result, TestPoolWatermarkCounters());
+
+    for (UINT64 Seed = 1; Seed <= 4; Seed++)
+    {
+        UnitTestExpect(Result, TestPoolWatermarkBursts(0x506f6f6c57617465ull * Seed));
+    }
+
+    return Result;
+}
+
+/**
+ * @brief Benchmark of the watermarks of the pre-allocated pools
+ * @details the same requests are served by the one-for-one replacement (after
+ * the IOCTLs) and by the watermarks, the recommended pools of the unlimited
+ * bursts are added to the watermarks (like the 'prealloc' command)
+ *
+ * @return VOID
+ */
+VOID
+BenchmarkPoolWatermark()
+{
+    TEST_POOL_WATERMARK_REQUESTS Requests;
+    TEST_POOL_WATERMARK_RESULT   Outcome;
+    UINT64                       StartTime;
+
+    const struct
+    {
+        const CHAR *                 Name;
+        UINT32                       BurstsPerSecond;
+        UINT32                       MaximumBurstSize;
+        UINT32                       RateLimit;
+        TEST_POOL_WATERMARK_STRATEGY Strategies[2];
+
+    } Scenarios[] = {
+        {"bursts of up to 5 requests per 10 ms", 2, 40, REGULAR_INSTANT_EVENTS_LOW_WATERMARK, {{"1:1 on IOCTLs, reserve 80", 0, 0, 80}, {"watermarks 5/20", REGULAR_INSTANT_EVENTS_LOW_WATERMARK, MAXIMUM_REGULAR_INSTANT_EVENTS, 0}}},
+        {"bursts of up to 32 requests per 10 ms", 10, 80, 32, {{"1:1 on IOCTLs, reserve 512", 0, 0, 512}, {"watermarks 32/48", 32, 48, 0}}},
+        {"unlimited bursts", 2, 40, 0, {{"1:1 on IOCTLs, reserve 80", 0, 0, 80}, {"watermarks 5/20", REGULAR_INSTANT_EVENTS_LOW_WATERMARK, MAXIMUM_REGULAR_INSTANT_EVENTS, 0}}},
+    };
+
+    for (auto & Scenario : Scenarios)
+    {
+        TestPoolWatermarkGenerate(&Requests, 0x506f6f6c57617465ull, Scenario.BurstsPerSecond, Scenario.MaximumBurstSize, Scenario.RateLimit);
+
+        ShowMessages("\t%s (%d requests per second, at most %d per 10 ms)\n",
+                     Scenario.Name,
+                     Requests.NumberOfRequests * 1000 / TEST_POOL_WATERMARK_NUMBER_OF_TICKS,
+                     Requests.MaximumRequestsPerInterval);
+
+        for (auto & Strategy : Scenario.Strategies)
+        {
+            TEST_POOL_WATERMARK_STRATEGY Raised = Strategy;
+
+            StartTime = UnitTestGetTimeInNanoseconds();
+
+            TestPoolWatermarkRun(&Requests, &Raised, &Outcome);
+
+            UnitTestShowBenchmarkResult(Strategy.Name, UnitTestGetTimeInNanoseconds() - StartTime, Requests.NumberOfRequests);
+
+            ShowMessages("\t%lld failures, %lld dropped replacements, %lld KB of idle pools on average, burst of %d, %d missing pools\n",
+                         Outcome.NumberOfFailedRequests,
+                         Outcome.NumberOfDroppedReplacements,
+                         Outcome.AverageIdleBytes / 1024,
+                         Outcome.MaximumBurst,
+                         Outcome.MissingPools);
+
+            if (Strategy.HighWatermark == 0 || Outcome.MissingPools == 0)
+            {
+                continue;
+            }
+
+            //
+            // Raise the watermarks by the recommended number of pools
+            //
+            Raised.LowWatermark += Outcome.MissingPools;
+            Raised.HighWatermark += Outcome.MissingPools;
+
+            TestPoolWatermarkRun(&Requests, &Raised, &Outcome);
+
+            ShowMessages("\traised to %d/%d: %lld failures, %lld KB of idle pools on average\n",
+                         Raised.LowWatermark,
+                         Raised.HighWatermark,
+                         Outcome.NumberOfFailedRequests,
+                         Outcome.AverageIdleBytes / 1024);
+        }
+    }
+}
+
+UnitTestRegister("pool-watermark", TestPoolWatermark, BenchmarkPoolWatermark);
@@ -0,0 +1,770 @@
+/**
+ * @file test-profiler.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Tests and benchmark of the samples of the profiler
+ * @details the samples of a synthetic workload (with known self and
+ * inclusive samples of each function) pass through the ring of the kernel
+ * (SamplesRing.c), then they are aggregated and folded to the functions
+ * in the same way as the '!profile' command
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Number of the samples of the synthetic workload
+ *
+ */
+#define TEST_PROFILER_NUMBER_OF_SAMPLES 200000
+
+/**
+ * @brief Number of the samples that are written by the core in the
+ * producer and consumer test
+ *
+ */
+#define TEST_PROFILER_NUMBER_OF_RING_SAMPLES 1000000
+
+/**
+ * @brief Number of the functions of the synthetic workload (half in the
+ * kernel-mode and half in the user-mode)
+ *
+ */
+#define TEST_PROFILER_NUMBER_OF_FUNCTIONS 64
+
+/**
+ * @brief Size of each function of the synthetic workload
+ *
+ */
+#define TEST_PROFILER_FUNCTION_SIZE 0x800
+
+/**
+ * @brief Distance between the functions of the synthetic workload, the
+ * addresses after DISASSEMBLY_MAXIMUM_DISTANCE_FROM_OBJECT_NAME are not
+ * in any function
+ *
+ */
+#define TEST_PROFILER_FUNCTION_DISTANCE 0x20000
+
+/**
+ * @brief Base address of the kernel-mode functions
+ *
+ */
+#define TEST_PROFILER_KERNEL_BASE_ADDRESS 0xfffff80012340000ull
+
+/**
+ * @brief Base address of the user-mode functions
+ *
+ */
+#define TEST_PROFILER_USER_BASE_ADDRESS 0x00007ff612340000ull
+
+/**
+ * @brief Number of the processes of the synthetic workload
+ *
+ */
+#define TEST_PROFILER_NUMBER_OF_PROCESSES 4
+
+/**
+ * @brief The expected samples of a function
+ *
+ */
+typedef struct _TEST_PROFILER_EXPECTED_SAMPLES
+{
+    UINT64 SelfSamples;
+    UINT64 InclusiveSamples;
+
+} TEST_PROFILER_EXPECTED_SAMPLES, *PTEST_PROFILER_EXPECTED_SAMPLES;
+
+/**
+ * @brief The synthetic workload
+ *
+ */
+typedef struct _TEST_PROFILER_WORKLOAD
+{
+    std::map<UINT64, LOCAL_FUNCTION_DESCRIPTION>          SymbolMap;
+    std::map<std::string, TEST_PROFILER_EXPECTED_SAMPLES> Functions;
+    std::map<UINT32, UINT64>                              Processes;
+    std::map<std::pair<UINT32, UINT64>, UINT64>           Locations;
+
+} TEST_PROFILER_WORKLOAD, *PTEST_PROFILER_WORKLOAD;
+
+/**
+ * @brief The ring that is shared with the core (the producer)
+ *
+ */
+static PPROFILER_SAMPLES_RING TestProfilerSharedRing;
+
+/**
+ * @brief Shows whether the core wrote all of its samples
+ *
+ */
+static volatile BOOLEAN TestProfilerCoreIsFinished;
+
+/**
+ * @brief Get the start address of a function of the synthetic workload
+ *
+ * @param Index
+ *
+ * @return UINT64
+ */
+static UINT64
+TestProfilerGetFunctionAddress(UINT32 Index)
+{
+    if (Index < TEST_PROFILER_NUMBER_OF_FUNCTIONS / 2)
+    {
+        return TEST_PROFILER_KERNEL_BASE_ADDRESS + Index * TEST_PROFILER_FUNCTION_DISTANCE;
+    }
+
+    return TEST_PROFILER_USER_BASE_ADDRESS + (Index - TEST_PROFILER_NUMBER_OF_FUNCTIONS / 2) * TEST_PROFILER_FUNCTION_DISTANCE;
+}
+
+/**
+ * @brief Get the name of a function of the synthetic workload
+ *
+ * @param Index
+ *
+ * @return std::string
+ */
+static std::string
+TestProfilerGetFunctionName(UINT32 Index)
+{
+    return (Index < TEST_PROFILER_NUMBER_OF_FUNCTIONS / 2 ? "nt!Function" : "test!Function") + std::to_string(Index);
+}
+
+/**
+ * @brief Get an address of the synthetic workload and its expected name
+ * @details one of sixteen addresses is not in any function (it's shown as
+ * the address itself)
+ *
+ * @param RandomState
+ * @param IsUserMode
+ * @param Name
+ *
+ * @return UINT64
+ */
+static UINT64
+TestProfilerGetRandomAddress(UINT64 * RandomState, BOOLEAN IsUserMode, std::string & Name)
+{
+    CHAR   AddressString[0x20] = {0};
+    UINT32 Index               = (UINT32)(UnitTestGetRandom(RandomState) % (TEST_PROFILER_NUMBER_OF_FUNCTIONS / 2));
+    UINT64 Address;
+
+    if (IsUserMode)
+    {
+        Index += TEST_PROFILER_NUMBER_OF_FUNCTIONS / 2;
+    }
+
+    if (UnitTestGetRandom(RandomState) % 16 == 0)
+    {
+        Address = TestProfilerGetFunctionAddress(Index) + DISASSEMBLY_MAXIMUM_DISTANCE_FROM_OBJECT_NAME + 1 +
+                  UnitTestGetRandom(RandomState) % TEST_PROFILER_FUNCTION_SIZE;
+
+        snprintf(AddressString, sizeof(AddressString), "%016llx", Address);
+        Name = AddressString;
+    }
+    else
+    {
+        Address = TestProfilerGetFunctionAddress(Index) + UnitTestGetRandom(RandomState) % TEST_PROFILER_FUNCTION_SIZE;
+        Name    = TestProfilerGetFunctionName(Index);
+    }
+
+    return Address;
+}
+
+/**
+ * @brief Build the symbols of the synthetic workload
+ *
+ * @param Workload
+ *
+ * @return VOID
+ */
+static VOID
+TestProfilerBuildSymbolMap(PTEST_PROFILER_WORKLOAD Workload)
+{
+    for (UINT32 i = 0; i < TEST_PROFILER_NUMBER_OF_FUNCTIONS; i++)
+    {
+        Workload->SymbolMap[TestProfilerGetFunctionAddress(i)] = {TestProfilerGetFunctionName(i), TEST_PROFILER_FUNCTION_SIZE};
+    }
+}
+
+/**
+ * @brief Generate a sample of the synthetic workload and count its
+ * expected samples
+ * @details the stacks might contain the same function more than once
+ * (recursion)
+ *
+ * @param Workload
+ * @param RandomState
+ * @param Sample
+ *
+ * @return VOID
+ */
+static VOID
+TestProfilerGenerateSample(PTEST_PROFILER_WORKLOAD   Workload,
+                           UINT64 *                  RandomState,
+                           PDEBUGGER_PROFILER_SAMPLE Sample)
+{
+    std::unordered_set<std::string> Seen;
+    std::string                     Name;
+    UINT32                          Depth;
+
+    RtlZeroMemory(Sample, sizeof(DEBUGGER_PROFILER_SAMPLE));
+
+    Sample->IsUserMode = UnitTestGetRandom(RandomState) % 3 != 0;
+    Sample->ProcessId  = 4 + (UINT32)(UnitTestGetRandom(RandomState) % TEST_PROFILER_NUMBER_OF_PROCESSES) * 4;
+    Sample->ThreadId   = Sample->ProcessId + 1;
+    Sample->Rip        = TestProfilerGetRandomAddress(RandomState, Sample->IsUserMode, Name);
+    Depth              = (UINT32)(UnitTestGetRandom(RandomState) % (MaximumProfilerStackDepth + 1));
+
+    Workload->Functions[Name].SelfSamples++;
+    Workload->Processes[Sample->ProcessId]++;
+    Workload->Locations[std::make_pair(Sample->IsUserMode ? Sample->ProcessId : 0, Sample->Rip)]++;
+
+    Seen.insert(Name);
+
+    for (UINT32 i = 0; i < Depth; i++)
+    {
+        //
+        // Recursion (the caller is the same function)
+        //
+        if (i != 0 && UnitTestGetRandom(RandomState) % 8 == 0)
+        {
+            Sample->Stack[i] = Sample->Stack[i - 1];
+        }
+        else
+        {
+            Sample->Stack[i] = TestProfilerGetRandomAddress(RandomState, Sample->IsUserMode, Name);
+            Seen.insert(Name);
+        }
+    }
+
+    Sample->StackDepth = (UINT8)Depth;
+
+    for (const auto & Function : Seen)
+    {
+        Workload->Functions[Function].InclusiveSamples++;
+    }
+}
+
+/**
+ * @brief Compare the folded functions with the expected samples
+ *
+ * @param Workload
+ * @param Functions
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestProfilerCompareFunctions(PTEST_PROFILER_WORKLOAD Workload, const std::vector<PROFILER_FUNCTION_SAMPLES> & Functions)
+{
+    BOOLEAN Result = TRUE;
+
+    UnitTestExpect(Result, Functions.size() == Workload->Functions.size());
+
+    for (size_t i = 0; i < Functions.size() && Result; i++)
+    {
+        auto Expected = Workload->Functions.find(Functions[i].Name);
+
+        if (Expected == Workload->Functions.end() ||
+            Expected->second.SelfSamples != Functions[i].SelfSamples ||
+            Expected->second.InclusiveSamples != Functions[i].InclusiveSamples)
+        {
+            ShowMessages("\t[x] unexpected samples of '%s' (self: %llx, inclusive: %llx)\n",
+                         Functions[i].Name.c_str(),
+                         Functions[i].SelfSamples,
+                         Functions[i].InclusiveSamples);
+            Result = FALSE;
+        }
+
+        //
+        // The hottest functions are the first ones
+        //
+        if (i != 0)
+        {
+            UnitTestExpect(Result, Functions[i - 1].SelfSamples > Functions[i].SelfSamples || (Functions[i - 1].SelfSamples == Functions[i].SelfSamples && Functions[i - 1].InclusiveSamples >= Functions[i].InclusiveSamples));
+        }
+    }
+
+    return Result;
+}
+
+/**
+ * @brief Test the conversion of the addresses to the functions
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestProfilerSymbolization()
+{
+    BOOLEAN                                      Result = TRUE;
+    std::map<UINT64, LOCAL_FUNCTION_DESCRIPTION> SymbolMap;
+    std::map<UINT64, LOCAL_FUNCTION_DESCRIPTION> EmptySymbolMap;
+    PROFILER_AGGREGATED_SAMPLES                  Aggregated = {};
+    DEBUGGER_PROFILER_SAMPLE                     Samples[3] = {0};
+    std::vector<PROFILER_FUNCTION_SAMPLES>       Functions;
+
+    SymbolMap[0x1000] = {"test!First", 0x100};
+    SymbolMap[0x2000] = {"test!Second", 0x100};
+
+    UnitTestExpect(Result, ProfilerGetFunctionName(SymbolMap, 0x1000) == "test!First");
+    UnitTestExpect(Result, ProfilerGetFunctionName(SymbolMap, 0x10ff) == "test!First");
+    UnitTestExpect(Result, ProfilerGetFunctionName(SymbolMap, 0x1fff) == "test!First");
+    UnitTestExpect(Result, ProfilerGetFunctionName(SymbolMap, 0x2000) == "test!Second");
+    UnitTestExpect(Result, ProfilerGetFunctionName(SymbolMap, 0x2000 + DISASSEMBLY_MAXIMUM_DISTANCE_FROM_OBJECT_NAME) == "test!Second");
+    UnitTestExpect(Result, ProfilerGetFunctionName(SymbolMap, 0x2000 + DISASSEMBLY_MAXIMUM_DISTANCE_FROM_OBJECT_NAME + 1) == "0000000000012000");
+    UnitTestExpect(Result, ProfilerGetFunctionName(SymbolMap, 0xfff) == "0000000000000fff");
+    UnitTestExpect(Result, ProfilerGetFunctionName(EmptySymbolMap, 0xfffff80012345678) == "fffff80012345678");
+
+    //
+    // A recursive function is counted once in the inclusive samples of
+    // each stack, and the different addresses of a function are merged
+    //
+    Samples[0].Rip        = 0x1010;
+    Samples[0].Stack[0]   = 0x1020;
+    Samples[0].Stack[1]   = 0x1030;
+    Samples[0].Stack[2]   = 0x2040;
+    Samples[0].StackDepth = 3;
+
+    Samples[1].Rip        = 0x2050;
+    Samples[1].Stack[0]   = 0x1060;
+    Samples[1].StackDepth = 1;
+
+    Samples[2].Rip        = 0x1010;
+    Samples[2].StackDepth = 0;
+
+    ProfilerAggregateSamples(&Aggregated, Samples, 3);
+
+    Functions = ProfilerFoldToFunctions(&Aggregated, SymbolMap);
+
+    UnitTestExpect(Result, Functions.size() == 2);
+
+    if (Functions.size() == 2)
+    {
+        UnitTestExpect(Result, Functions[0].Name == "test!First" && Functions[0].SelfSamples == 2 && Functions[0].InclusiveSamples == 3);
+        UnitTestExpect(Result, Functions[1].Name == "test!Second" && Functions[1].SelfSamples == 1 && Functions[1].InclusiveSamples == 2);
+    }
+
+    return Result;
+}
+
+/**
+ * @brief Test the aggregation of the samples of the synthetic workload
+ * @details the samples are read from the ring in the same batches as the
+ * '!profile' command
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestProfilerAggregation()
+{
+    BOOLEAN                                     Result      = TRUE;
+    UINT64                                      RandomState = 0x50726f66696c6572ull;
+    TEST_PROFILER_WORKLOAD                      Workload;
+    PROFILER_AGGREGATED_SAMPLES                 Aggregated = {};
+    std::unique_ptr<PROFILER_SAMPLES_RING>      Ring(new PROFILER_SAMPLES_RING);
+    std::unique_ptr<DEBUGGER_PROFILER_SAMPLE[]> Samples(new DEBUGGER_PROFILER_SAMPLE[MaximumProfilerSamplesPerRequest]);
+    PDEBUGGER_PROFILER_SAMPLE                   Sample;
+    UINT32                                      NumberOfSamples;
+    UINT64                                      NumberOfReadSamples = 0;
+
+    TestProfilerBuildSymbolMap(&Workload);
+
+    SamplesRingReset(Ring.get());
+
+    for (UINT32 i = 0; i < TEST_PROFILER_NUMBER_OF_SAMPLES; i++)
+    {
+        Sample = SamplesRingAcquireEntry(Ring.get());
+
+        UnitTestExpect(Result, Sample != NULL);
+
+        if (Sample == NULL)
+        {
+            return FALSE;
+        }
+
+        TestProfilerGenerateSample(&Workload, &RandomState, Sample);
+
+        SamplesRingPublishEntry(Ring.get());
+
+        //
+        // Drain the ring from time to time
+        //
+        if (i % 3000 == 2999 || i == TEST_PROFILER_NUMBER_OF_SAMPLES - 1)
+        {
+            do
+            {
+                NumberOfSamples = SamplesRingRead(Ring.get(), Samples.get(), MaximumProfilerSamplesPerRequest);
+
+                ProfilerAggregateSamples(&Aggregated, Samples.get(), NumberOfSamples);
+                ProfilerAggregateCoreCounters(&Aggregated, 0, Ring->TotalSamples, Ring->DroppedSamples);
+
+                NumberOfReadSamples += NumberOfSamples;
+
+            } while (NumberOfSamples == MaximumProfilerSamplesPerRequest);
+        }
+    }
+
+    UnitTestExpect(Result, NumberOfReadSamples == TEST_PROFILER_NUMBER_OF_SAMPLES);
+    UnitTestExpect(Result, Aggregated.NumberOfSamples == TEST_PROFILER_NUMBER_OF_SAMPLES);
+    UnitTestExpect(Result, Aggregated.TotalSamplesOfCores[0] == TEST_PROFILER_NUMBER_OF_SAMPLES);
+    UnitTestExpect(Result, Aggregated.DroppedSamplesOfCores[0] == 0);
+    UnitTestExpect(Result, Aggregated.Processes == Workload.Processes);
+    UnitTestExpect(Result, Aggregated.Locations == Workload.Locations);
+
+    UnitTestExpect(Result, TestProfilerCompareFunctions(&Workload, ProfilerFoldToFunctions(&Aggregated, Workload.SymbolMap)));
+
+    //
+    // The stacks that are deeper than the maximum depth are truncated
+    //
+    Sample = &Samples[0];
+
+    RtlZeroMemory(Sample, sizeof(DEBUGGER_PROFILER_SAMPLE));
+
+    Sample->StackDepth = MaximumProfilerStackDepth + 4;
+
+    ProfilerClearAggregatedSamples(&Aggregated);
+    ProfilerAggregateSamples(&Aggregated, Sample, 1);
+
+    UnitTestExpect(Result, Aggregated.Stacks.size() == 1 && Aggregated.Stacks.begin()->first.size() == 2 + MaximumProfilerStackDepth);
+
+    //
+    // The counters of the cores are cumulative
+    //
+    ProfilerAggregateCoreCounters(&Aggregated, 1, 10, 1);
+    ProfilerAggregateCoreCounters(&Aggregated, 1, 25, 3);
+    ProfilerAggregateCoreCounters(&Aggregated, 2, 7, 0);
+
+    UnitTestExpect(Result, Aggregated.TotalSamplesOfCores[1] == 25 && Aggregated.DroppedSamplesOfCores[1] == 3);
+    UnitTestExpect(Result, Aggregated.TotalSamplesOfCores[2] == 7);
+
+    ProfilerClearAggregatedSamples(&Aggregated);
+
+    UnitTestExpect(Result, Aggregated.NumberOfSamples == 0 && Aggregated.Locations.empty() && Aggregated.Stacks.empty());
+    UnitTestExpect(Result, Aggregated.Processes.empty() && Aggregated.TotalSamplesOfCores.empty() && Aggregated.DroppedSamplesOfCores.empty());
+    UnitTestExpect(Result, ProfilerFoldToFunctions(&Aggregated, Workload.SymbolMap).empty());
+
+    return Result;
+}
+
+/**
+ * @brief Test the ring of the samples
+ * @details the indexes of the ring are also tested when they wrap around
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestProfilerRing()
+{
+    BOOLEAN                                     Result = TRUE;
+    std::unique_ptr<PROFILER_SAMPLES_RING>      Ring(new PROFILER_SAMPLES_RING);
+    std::unique_ptr<DEBUGGER_PROFILER_SAMPLE[]> Samples(new DEBUGGER_PROFILER_SAMPLE[PROFILER_SAMPLES_RING_CAPACITY]);
+    PDEBUGGER_PROFILER_SAMPLE                   Sample;
+    UINT64                                      NextWritten = 0;
+    UINT64                                      NextRead    = 0;
+    UINT32                                      Count;
+
+    SamplesRingReset(Ring.get());
+
+    //
+    // Nothing to read
+    //
+    UnitTestExpect(Result, SamplesRingRead(Ring.get(), Samples.get(), PROFILER_SAMPLES_RING_CAPACITY) == 0);
+
+    //
+    // The new samples are dropped if the ring is full
+    //
+    for (UINT32 i = 0; i < PROFILER_SAMPLES_RING_CAPACITY + 3; i++)
+    {
+        Sample = SamplesRingAcquireEntry(Ring.get());
+
+        if (i < PROFILER_SAMPLES_RING_CAPACITY)
+        {
+            UnitTestExpect(Result, Sample != NULL);
+
+            if (Sample != NULL)
+            {
+                Sample->Rip = NextWritten++;
+                SamplesRingPublishEntry(Ring.get());
+            }
+        }
+        else
+        {
+            UnitTestExpect(Result, Sample == NULL);
+        }
+    }
+
+    UnitTestExpect(Result, Ring->TotalSamples == PROFILER_SAMPLES_RING_CAPACITY + 3 && Ring->DroppedSamples == 3);
+
+    //
+    // Read a part, then fill the ring again (so it's wrapped)
+    //
+    Count = SamplesRingRead(Ring.get(), Samples.get(), 100);
+
+    UnitTestExpect(Result, Count == 100);
+
+    for (UINT32 i = 0; i < Count; i++)
+    {
+        UnitTestExpect(Result, Samples[i].Rip == NextRead++);
+    }
+
+    while ((Sample = SamplesRingAcquireEntry(Ring.get())) != NULL)
+    {
+        Sample->Rip = NextWritten++;
+        SamplesRingPublishEntry(Ring.get());
+    }
+
+    UnitTestExpect(Result, NextWritten == PROFILER_SAMPLES_RING_CAPACITY + 100 && Ring->DroppedSamples == 4);
+
+    Count = SamplesRingRead(Ring.get(), Samples.get(), PROFILER_SAMPLES_RING_CAPACITY);
+
+    UnitTestExpect(Result, Count == PROFILER_SAMPLES_RING_CAPACITY);
+
+    for (UINT32 i = 0; i < Count; i++)
+    {
+        UnitTestExpect(Result, Samples[i].Rip == NextRead++);
+    }
+
+    //
+    // No more than the maximum number of samples is read
+    //
+    for (UINT32 i = 0; i < 5; i++)
+    {
+        Sample = SamplesRingAcquireEntry(Ring.get());
+
+        if (Sample != NULL)
+        {
+            Sample->Rip = NextWritten++;
+            SamplesRingPublishEntry(Ring.get());
+        }
+    }
+
+    UnitTestExpect(Result, SamplesRingRead(Ring.get(), Samples.get(), 4) == 4 && Samples[3].Rip == NextRead + 3);
+    UnitTestExpect(Result, SamplesRingRead(Ring.get(), Samples.get(), 4) == 1 && Samples[0].Rip == NextRead + 4);
+
+    //
+    // The indexes wrap around (after 2^32 samples)
+    //
+    SamplesRingReset(Ring.get());
+
+    Ring->Head  = MAXUINT32 - 1000;
+    Ring->Tail  = MAXUINT32 - 1000;
+    NextWritten = 0;
+    NextRead    = 0;
+
+    for (UINT32 Round = 0; Round < 100; Round++)
+    {
+        for (UINT32 i = 0; i < 37; i++)
+        {
+            Sample = SamplesRingAcquireEntry(Ring.get());
+
+            UnitTestExpect(Result, Sample != NULL);
+
+            if (Sample != NULL)
+            {
+                Sample->Rip = NextWritten++;
+                SamplesRingPublishEntry(Ring.get());
+            }
+        }
+
+        Count = SamplesRingRead(Ring.get(), Samples.get(), 29 + Round % 16);
+
+        for (UINT32 i = 0; i < Count; i++)
+        {
+            UnitTestExpect(Result, Samples[i].Rip == NextRead++);
+        }
+    }
+
+    Count = SamplesRingRead(Ring.get(), Samples.get(), PROFILER_SAMPLES_RING_CAPACITY);
+
+    for (UINT32 i = 0; i < Count; i++)
+    {
+        UnitTestExpect(Result, Samples[i].Rip == NextRead++);
+    }
+
+    UnitTestExpect(Result, NextRead == 3700 && Ring->Head == Ring->Tail && Ring->DroppedSamples == 0);
+
+    return Result;
+}
+
+/**
+ * @brief The core that writes the samples to the ring
+ *
+ * @param Param
+ *
+ * @return DWORD
+ */
+static DWORD WINAPI
+TestProfilerCoreThread(LPVOID Param)
+{
+    PDEBUGGER_PROFILER_SAMPLE Sample;
+
+    UNREFERENCED_PARAMETER(Param);
+
+    for (UINT64 i = 0; i < TEST_PROFILER_NUMBER_OF_RING_SAMPLES; i++)
+    {
+        Sample = SamplesRingAcquireEntry(TestProfilerSharedRing);
+
+        if (Sample != NULL)
+        {
+            Sample->Rip      = i;
+            Sample->Cr3      = i * 3;
+            Sample->Stack[0] = ~i;
+            SamplesRingPublishEntry(TestProfilerSharedRing);
+        }
+    }
+
+    TestProfilerCoreIsFinished = TRUE;
+
+    return 0;
+}
+
+/**
+ * @brief Test the ring while the core writes the samples and the
+ * user-mode reads them
+ * @details the samples are read in order, each sample is either read
+ * (completely written) or dropped
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestProfilerRingConcurrency()
+{
+    BOOLEAN                                     Result = TRUE;
+    std::unique_ptr<PROFILER_SAMPLES_RING>      Ring(new PROFILER_SAMPLES_RING);
+    std::unique_ptr<DEBUGGER_PROFILER_SAMPLE[]> Samples(new DEBUGGER_PROFILER_SAMPLE[MaximumProfilerSamplesPerRequest]);
+    UINT64                                      NumberOfReadSamples = 0;
+    UINT64                                      LastRip             = 0;
+    UINT32                                      Count;
+    BOOLEAN                                     IsFinished;
+    HANDLE                                      Thread;
+
+    SamplesRingReset(Ring.get());
+
+    TestProfilerSharedRing     = Ring.get();
+    TestProfilerCoreIsFinished = FALSE;
+
+    Thread = CreateThread(NULL, 0, TestProfilerCoreThread, NULL, 0, NULL);
+
+    do
+    {
+        IsFinished = TestProfilerCoreIsFinished;
+        Count      = SamplesRingRead(Ring.get(), Samples.get(), MaximumProfilerSamplesPerRequest);
+
+        for (UINT32 i = 0; i < Count; i++)
+        {
+            if ((NumberOfReadSamples != 0 && Samples[i].Rip <= LastRip) ||
+                Samples[i].Cr3 != Samples[i].Rip * 3 ||
+                Samples[i].Stack[0] != ~Samples[i].Rip)
+            {
+                Result = FALSE;
+            }
+
+            LastRip = Samples[i].Rip;
+            NumberOfReadSamples++;
+        }
+
+    } while (!IsFinished || Count != 0);
+
+    WaitForSingleObject(Thread, INFINITE);
+    CloseHandle(Thread);
+
+    UnitTestExpect(Result, Ring->TotalSamples == TEST_PROFILER_NUMBER_OF_RING_SAMPLES);
+    UnitTestExpect(Result, NumberOfReadSamples + Ring->DroppedSamples == TEST_PROFILER_NUMBER_OF_RING_SAMPLES);
+
+    return Result;
+}
+
+/**
+ * @brief Tests of the samples of the profiler
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+TestProfiler()
+{
+    BOOLEAN Result = TRUE;
+
+    UnitTestExpect(Result, TestProfilerRing());
+    UnitTestExpect(Result, TestProfilerRingConcurrency());
+    UnitTestExpect(Result, TestProfilerSymbolization());
+    UnitTestExpect(Result, TestProfilerAggregation());
+
+    return Result;
+}
+
+/**
+ * @brief Benchmark of the samples of the profiler
+ * @details the cost of each sample in the ring and in the aggregation,
+ * and the cost of folding the aggregated samples to the functions
+ *
+ * @return VOID
+ */
+VOID
+BenchmarkProfiler()
+{
+    UINT64                                      RandomState = 0x42656e6368ull;
+    TEST_PROFILER_WORKLOAD                      Workload;
+    PROFILER_AGGREGATED_SAMPLES                 Aggregated = {};
+    std::unique_ptr<PROFILER_SAMPLES_RING>      Ring(new PROFILER_SAMPLES_RING);
+    std::unique_ptr<DEBUGGER_PROFILER_SAMPLE[]> Samples(new DEBUGGER_PROFILER_SAMPLE[TEST_PROFILER_NUMBER_OF_SAMPLES]);
+    std::vector<PROFILER_FUNCTION_SAMPLES>      Functions;
+    PDEBUGGER_PROFILER_SAMPLE                   Sample;
+    UINT64                                      StartTime;
+
+    TestProfilerBuildSymbolMap(&Workload);
+
+    for (UINT32 i = 0; i < TEST_PROFILER_NUMBER_OF_SAMPLES; i++)
+    {
+        TestProfilerGenerateSample(&Workload, &RandomState, &Samples[i]);
+    }
+
+    //
+    // Write and read the samples through the ring
+    //
+    SamplesRingReset(Ring.get());
+
+    StartTime = UnitTestGetTimeInNanoseconds();
+
+    for (UINT32 i = 0; i < TEST_PROFILER_NUMBER_OF_SAMPLES; i += MaximumProfilerSamplesPerRequest)
+    {
+        for (UINT32 j = i; j < i + MaximumProfilerSamplesPerRequest && j < TEST_PROFILER_NUMBER_OF_SAMPLES; j++)
+        {
+            Sample = SamplesRingAcquireEntry(Ring.get());
+
+            if (Sample != NULL)
+            {
+                *Sample = Samples[j];
+                SamplesRingPublishEntry(Ring.get());
+            }
+        }
+
+        SamplesRingRead(Ring.get(), &Samples[i], MaximumProfilerSamplesPerRequest);
+    }
+
+    UnitTestShowBenchmarkResult("samples ring (write and read)", UnitTestGetTimeInNanoseconds() - StartTime, TEST_PROFILER_NUMBER_OF_SAMPLES);
+
+    StartTime = UnitTestGetTimeInNanoseconds();
+
+    for (UINT32 i = 0; i < TEST_PROFILER_NUMBER_OF_SAMPLES; i += MaximumProfilerSamplesPerRequest)
+    {
+        ProfilerAggregateSamples(&Aggregated,
+                                 &Samples[i],
+                                 TEST_PROFILER_NUMBER_OF_SAMPLES - i < MaximumProfilerSamplesPerRequest ? TEST_PROFILER_NUMBER_OF_SAMPLES - i : MaximumProfilerSamplesPerRequest);
+    }
+
+    UnitTestShowBenchmarkResult("aggregation of the samples", UnitTestGetTimeInNanoseconds() - StartTime, TEST_PROFILER_NUMBER_OF_SAMPLES);
+
+    StartTime = UnitTestGetTimeInNanoseconds();
+    Functions = ProfilerFoldToFunctions(&Aggregated, Workload.SymbolMap);
+
+    UnitTestShowBenchmarkResult("folding to the functions (per sample)", UnitTestGetTimeInNanoseconds() - StartTime, TEST_PROFILER_NUMBER_OF_SAMPLES);
+
+    ShowMessages("\t%llx locations, %llx stacks and %llx functions\n",
+                 (UINT64)Aggregated.Locations.size(),
+                 (UINT64)Aggregated.Stacks.size(),
+                 (UINT64)Functions.size());
+}
+
+UnitTestRegister("profiler", TestProfiler, BenchmarkProfiler);
@@ -0,0 +1,609 @@
+/**
+ * @file test-remote-frames.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Loopback tests and benchmark of the framed remote connections
+ * @details the debugger and the debuggee sides are connected over a
+ * loopback socket, the debuggee side receives the frames with the thread
+ * of the remote connections and the commands are "executed" by the test
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Number of the threads that send commands at the same time
+ *
+ */
+#define TEST_REMOTE_FRAMES_NUMBER_OF_SENDERS 4
+
+/**
+ * @brief Number of the commands of each sender
+ *
+ */
+#define TEST_REMOTE_FRAMES_COMMANDS_PER_SENDER 32
+
+/**
+ * @brief Number of the outputs without a command (events) of the debuggee
+ *
+ */
+#define TEST_REMOTE_FRAMES_NUMBER_OF_EVENTS 256
+
+/**
+ * @brief Size of the large (compressed) output of each command
+ *
+ */
+#define TEST_REMOTE_FRAMES_OUTPUT_SIZE 8192
+
+/**
+ * @brief Number of the commands of each form in the benchmark
+ *
+ */
+#define TEST_REMOTE_FRAMES_BENCHMARK_COMMANDS 1000
+
+/**
+ * @brief Maximum time (in milliseconds) of waiting for a thread of the test
+ *
+ */
+#define TEST_REMOTE_FRAMES_TIMEOUT 10000
+
+/**
+ * @brief State of the loopback connection
+ *
+ */
+typedef struct _TEST_REMOTE_FRAMES_STATE
+{
+    SOCKET                        DebuggeeSocket;
+    SOCKET                        DebuggerSocket;
+    SRWLOCK                       OutputsLock;
+    std::map<UINT32, std::string> Outputs; // request id to the received outputs
+    volatile LONG                 NumberOfInvalidFrames;
+
+} TEST_REMOTE_FRAMES_STATE, *PTEST_REMOTE_FRAMES_STATE;
+
+/**
+ * @brief State of the loopback connection
+ *
+ */
+static TEST_REMOTE_FRAMES_STATE TestRemoteFramesState;
+
+/**
+ * @brief Drop the messages of the debuggee side (e.g., 'pausing...')
+ *
+ * @param Text
+ *
+ * @return int
+ */
+static int
+TestRemoteFramesDropMessage(const char * Text)
+{
+    UNREFERENCED_PARAMETER(Text);
+    return 0;
+}
+
+/**
+ * @brief Get the large output of a command
+ *
+ * @param Text
+ *
+ * @return std::string
+ */
+static std::string
+TestRemoteFramesGetLargeOutput(const std::string & Text)
+{
+    std::string Output;
+
+    while (Output.size() < TEST_REMOTE_FRAMES_OUTPUT_SIZE)
+    {
+        Output += Text + " ";
+    }
+
+    Output.resize(TEST_REMOTE_FRAMES_OUTPUT_SIZE);
+
+    return Output;
+}
+
+/**
+ * @brief Send a frame of the debuggee side
+ *
+ * @param Type
+ * @param RequestId
+ * @param Payload
+ *
+ * @return VOID
+ */
+static VOID
+TestRemoteFramesSendFromDebuggee(REMOTE_FRAME_TYPE Type, UINT32 RequestId, const std::string & Payload)
+{
+    if (!RemoteFrameSend(TestRemoteFramesState.DebuggeeSocket, TRUE, Type, RequestId, Payload.data(), (UINT32)Payload.size()))
+    {
+        InterlockedIncrement(&TestRemoteFramesState.NumberOfInvalidFrames);
+    }
+}
+
+/**
+ * @brief The executer of the commands (debuggee side)
+ * @details 'nop' only finishes, 'echo <text>' sends the text and a large
+ * output, and 'wait-break' waits for the break of the debugger
+ *
+ * @param Param
+ *
+ * @return DWORD
+ */
+static DWORD WINAPI
+TestRemoteFramesExecuterThread(LPVOID Param)
+{
+    UINT32            RequestId;
+    std::vector<CHAR> Command;
+
+    UNREFERENCED_PARAMETER(Param);
+
+    while (RemoteFrameWaitForCommand(&RequestId, Command))
+    {
+        std::string CommandString(Command.data());
+
+        if (CommandString.rfind("echo ", 0) == 0)
+        {
+            std::string Text = CommandString.substr(5);
+
+            TestRemoteFramesSendFromDebuggee(REMOTE_FRAME_TYPE_OUTPUT, RequestId, Text + "\n");
+            TestRemoteFramesSendFromDebuggee(REMOTE_FRAME_TYPE_OUTPUT, RequestId, TestRemoteFramesGetLargeOutput(Text));
+        }
+        else if (CommandString == "wait-break")
+        {
+            //
+            // The break is received by another thread while this
+            // command is executed
+            //
+            for (UINT32 i = 0; i < TEST_REMOTE_FRAMES_TIMEOUT && !g_BreakPrintingOutput; i++)
+            {
+                Sleep(1);
+            }
+
+            TestRemoteFramesSendFromDebuggee(REMOTE_FRAME_TYPE_OUTPUT, RequestId, g_BreakPrintingOutput ? "break\n" : "timeout\n");
+        }
+
+        TestRemoteFramesSendFromDebuggee(REMOTE_FRAME_TYPE_COMMAND_FINISHED, RequestId, "");
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Send the outputs without a command (events) of the debuggee
+ *
+ * @param Param
+ *
+ * @return DWORD
+ */
+static DWORD WINAPI
+TestRemoteFramesEventsThread(LPVOID Param)
+{
+    CHAR Event[32];
+
+    UNREFERENCED_PARAMETER(Param);
+
+    for (UINT32 i = 0; i < TEST_REMOTE_FRAMES_NUMBER_OF_EVENTS; i++)
+    {
+        sprintf_s(Event, sizeof(Event), "event %u\n", i);
+
+        TestRemoteFramesSendFromDebuggee(REMOTE_FRAME_TYPE_OUTPUT, 0, Event);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief The receiver of the frames of the debugger side
+ *
+ * @param Param
+ *
+ * @return DWORD
+ */
+static DWORD WINAPI
+TestRemoteFramesDebuggerThread(LPVOID Param)
+{
+    REMOTE_FRAME_HEADER FrameHeader;
+    std::vector<CHAR>   FramePayload;
+
+    UNREFERENCED_PARAMETER(Param);
+
+    while (RemoteFrameReceive(TestRemoteFramesState.DebuggerSocket, &FrameHeader, FramePayload))
+    {
+        if (FrameHeader.Type == REMOTE_FRAME_TYPE_OUTPUT)
+        {
+            AcquireSRWLockExclusive(&TestRemoteFramesState.OutputsLock);
+            TestRemoteFramesState.Outputs[FrameHeader.RequestId].append(FramePayload.data(), FrameHeader.OriginalSize);
+            ReleaseSRWLockExclusive(&TestRemoteFramesState.OutputsLock);
+        }
+        else if (FrameHeader.Type == REMOTE_FRAME_TYPE_COMMAND_FINISHED)
+        {
+            RemoteFrameCompleteCommand(FrameHeader.RequestId);
+        }
+        else
+        {
+            InterlockedIncrement(&TestRemoteFramesState.NumberOfInvalidFrames);
+        }
+    }
+
+    //
+    // Wake up the senders of the commands that won't be finished
+    //
+    RemoteFrameCompleteCommand(0);
+
+    return 0;
+}
+
+/**
+ * @brief Find the outputs of a finished 'echo' command
+ *
+ * @param Text
+ *
+ * @return BOOLEAN TRUE if the outputs are complete and not mixed with
+ * the other outputs
+ */
+static BOOLEAN
+TestRemoteFramesCheckEchoOutput(const std::string & Text)
+{
+    BOOLEAN     Result   = FALSE;
+    std::string Expected = Text + "\n" + TestRemoteFramesGetLargeOutput(Text);
+
+    AcquireSRWLockShared(&TestRemoteFramesState.OutputsLock);
+
+    for (auto & Output : TestRemoteFramesState.Outputs)
+    {
+        if (Output.first != 0 && Output.second.rfind(Text + "\n", 0) == 0)
+        {
+            Result = Output.second == Expected;
+            break;
+        }
+    }
+
+    ReleaseSRWLockShared(&TestRemoteFramesState.OutputsLock);
+
+    return Result;
+}
+
+/**
+ * @brief A sender of the commands (debugger side)
+ *
+ * @param Param Index of the sender
+ *
+ * @return DWORD number of the commands with invalid outputs
+ */
+static DWORD WINAPI
+TestRemoteFramesSenderThread(LPVOID Param)
+{
+    DWORD       NumberOfErrors = 0;
+    std::string Command;
+
+    for (UINT32 i = 0; i < TEST_REMOTE_FRAMES_COMMANDS_PER_SENDER; i++)
+    {
+        Command = "echo sender-" + std::to_string((UINT64)Param) + "-command-" + std::to_string(i);
+
+        //
+        // The outputs are received before the command is finished
+        //
+        if (RemoteFrameSendCommandAndWait(TestRemoteFramesState.DebuggerSocket, Command.c_str(), (int)Command.size() + 1) != 0 ||
+            !TestRemoteFramesCheckEchoOutput(Command.substr(5)))
+        {
+            NumberOfErrors++;
+        }
+    }
+
+    return NumberOfErrors;
+}
+
+/**
+ * @brief Send a command of the test
+ *
+ * @param Param The command
+ *
+ * @return DWORD
+ */
+static DWORD WINAPI
+TestRemoteFramesCommandThread(LPVOID Param)
+{
+    const CHAR * Command = (const CHAR *)Param;
+
+    return RemoteFrameSendCommandAndWait(TestRemoteFramesState.DebuggerSocket, Command, (int)strlen(Command) + 1);
+}
+
+/**
+ * @brief Wait for a thread of the test
+ *
+ * @param Thread
+ * @param ExitCode
+ *
+ * @return BOOLEAN FALSE if the thread is not finished
+ */
+static BOOLEAN
+TestRemoteFramesWaitForThread(HANDLE Thread, DWORD * ExitCode)
+{
+    BOOLEAN Result = FALSE;
+
+    if (Thread == NULL)
+    {
+        return FALSE;
+    }
+
+    if (WaitForSingleObject(Thread, TEST_REMOTE_FRAMES_TIMEOUT) == WAIT_OBJECT_0)
+    {
+        Result = TRUE;
+
+        if (ExitCode != NULL)
+        {
+            GetExitCodeThread(Thread, ExitCode);
+        }
+    }
+
+    return Result;
+}
+
+/**
+ * @brief Connect the debugger and the debuggee sides over a loopback
+ * socket and start their receivers
+ *
+ * @param Threads The receivers of the debugger side, the debuggee side
+ * and the executer of the commands
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestRemoteFramesConnect(HANDLE * Threads)
+{
+    WSADATA     WsaData;
+    SOCKET      ListenSocket = INVALID_SOCKET;
+    SOCKADDR_IN Address      = {0};
+    int         AddressSize  = sizeof(Address);
+    BOOL        NoDelay      = TRUE;
+
+    if (WSAStartup(MAKEWORD(2, 2), &WsaData) != 0)
+    {
+        return FALSE;
+    }
+
+    TestRemoteFramesState.DebuggeeSocket        = INVALID_SOCKET;
+    TestRemoteFramesState.DebuggerSocket        = INVALID_SOCKET;
+    TestRemoteFramesState.NumberOfInvalidFrames = 0;
+    TestRemoteFramesState.Outputs.clear();
+    InitializeSRWLock(&TestRemoteFramesState.OutputsLock);
+
+    Address.sin_family      = AF_INET;
+    Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    Address.sin_port        = 0;
+
+    ListenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+    if (ListenSocket == INVALID_SOCKET ||
+        bind(ListenSocket, (SOCKADDR *)&Address, sizeof(Address)) == SOCKET_ERROR ||
+        listen(ListenSocket, 1) == SOCKET_ERROR ||
+        getsockname(ListenSocket, (SOCKADDR *)&Address, &AddressSize) == SOCKET_ERROR)
+    {
+        ShowMessages("\t[x] unable to listen on the loopback (%x)\n", WSAGetLastError());
+        closesocket(ListenSocket);
+        WSACleanup();
+        return FALSE;
+    }
+
+    TestRemoteFramesState.DebuggerSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+    if (TestRemoteFramesState.DebuggerSocket == INVALID_SOCKET ||
+        connect(TestRemoteFramesState.DebuggerSocket, (SOCKADDR *)&Address, sizeof(Address)) == SOCKET_ERROR ||
+        (TestRemoteFramesState.DebuggeeSocket = accept(ListenSocket, NULL, NULL)) == INVALID_SOCKET)
+    {
+        ShowMessages("\t[x] unable to connect on the loopback (%x)\n", WSAGetLastError());
+        closesocket(TestRemoteFramesState.DebuggerSocket);
+        closesocket(ListenSocket);
+        WSACleanup();
+        return FALSE;
+    }
+
+    closesocket(ListenSocket);
+
+    //
+    // Each frame is sent without waiting for the next frames (the same as
+    // a remote connection with a round trip time)
+    //
+    setsockopt(TestRemoteFramesState.DebuggerSocket, IPPROTO_TCP, TCP_NODELAY, (const char *)&NoDelay, sizeof(NoDelay));
+    setsockopt(TestRemoteFramesState.DebuggeeSocket, IPPROTO_TCP, TCP_NODELAY, (const char *)&NoDelay, sizeof(NoDelay));
+
+    RemoteFrameInitialize();
+
+    Threads[0] = CreateThread(NULL, 0, TestRemoteFramesDebuggerThread, NULL, 0, NULL);
+    Threads[1] = CreateThread(NULL, 0, RemoteFrameReceiveCommandsThread, (LPVOID)TestRemoteFramesState.DebuggeeSocket, 0, NULL);
+    Threads[2] = CreateThread(NULL, 0, TestRemoteFramesExecuterThread, NULL, 0, NULL);
+
+    return TRUE;
+}
+
+/**
+ * @brief Close the loopback connection and wait for the receivers
+ *
+ * @param Threads
+ *
+ * @return BOOLEAN FALSE if a receiver is not stopped
+ */
+static BOOLEAN
+TestRemoteFramesDisconnect(HANDLE * Threads)
+{
+    BOOLEAN Result = TRUE;
+
+    shutdown(TestRemoteFramesState.DebuggerSocket, SD_BOTH);
+    shutdown(TestRemoteFramesState.DebuggeeSocket, SD_BOTH);
+
+    for (UINT32 i = 0; i < 3; i++)
+    {
+        if (!TestRemoteFramesWaitForThread(Threads[i], NULL))
+        {
+            Result = FALSE;
+        }
+    }
+
+    closesocket(TestRemoteFramesState.DebuggerSocket);
+    closesocket(TestRemoteFramesState.DebuggeeSocket);
+
+    for (UINT32 i = 0; i < 3; i++)
+    {
+        if (Threads[i] != NULL)
+        {
+            CloseHandle(Threads[i]);
+        }
+    }
+
+    WSACleanup();
+
+    return Result;
+}
+
+/**
+ * @brief Loopback test of the framed remote connections
+ * @details commands of several threads, the outputs of the commands and
+ * the events are interleaved on the same connection; a break is sent
+ * (without waiting) while a command is executed by the debuggee
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+TestRemoteFrames()
+{
+    BOOLEAN     Result         = TRUE;
+    PVOID       MessageHandler = g_MessageHandler;
+    HANDLE      Threads[3]     = {0};
+    HANDLE      Senders[TEST_REMOTE_FRAMES_NUMBER_OF_SENDERS];
+    HANDLE      EventsThread;
+    HANDLE      BreakThread;
+    DWORD       ExitCode;
+    UINT64      StartTime;
+    std::string ExpectedEvents;
+
+    if (!TestRemoteFramesConnect(Threads))
+    {
+        return FALSE;
+    }
+
+    //
+    // The 'pausing...' of the break is not shown
+    //
+    g_MessageHandler = (PVOID)TestRemoteFramesDropMessage;
+
+    //
+    // Commands of the senders and the events at the same time
+    //
+    EventsThread = CreateThread(NULL, 0, TestRemoteFramesEventsThread, NULL, 0, NULL);
+
+    for (UINT64 i = 0; i < TEST_REMOTE_FRAMES_NUMBER_OF_SENDERS; i++)
+    {
+        Senders[i] = CreateThread(NULL, 0, TestRemoteFramesSenderThread, (LPVOID)i, 0, NULL);
+    }
+
+    for (UINT32 i = 0; i < TEST_REMOTE_FRAMES_NUMBER_OF_SENDERS; i++)
+    {
+        ExitCode = (DWORD)-1;
+
+        UnitTestExpect(Result, TestRemoteFramesWaitForThread(Senders[i], &ExitCode) && ExitCode == 0);
+    }
+
+    UnitTestExpect(Result, TestRemoteFramesWaitForThread(EventsThread, NULL));
+
+    //
+    // A break while the debuggee executes a command, the break doesn't
+    // wait for the command
+    //
+    g_BreakPrintingOutput = FALSE;
+
+    BreakThread = CreateThread(NULL, 0, TestRemoteFramesCommandThread, (LPVOID) "wait-break", 0, NULL);
+
+    Sleep(50);
+
+    StartTime = UnitTestGetTimeInNanoseconds();
+    UnitTestExpect(Result, RemoteFrameSendBreak(TestRemoteFramesState.DebuggerSocket));
+    UnitTestExpect(Result, UnitTestGetTimeInNanoseconds() - StartTime < 1000000000);
+
+    UnitTestExpect(Result, TestRemoteFramesWaitForThread(BreakThread, &ExitCode) && ExitCode == 0);
+
+    g_BreakPrintingOutput = FALSE;
+
+    //
+    // The events are in order and not mixed with the outputs of the commands
+    //
+    for (UINT32 i = 0; i < TEST_REMOTE_FRAMES_NUMBER_OF_EVENTS; i++)
+    {
+        ExpectedEvents += "event " + std::to_string(i) + "\n";
+    }
+
+    AcquireSRWLockShared(&TestRemoteFramesState.OutputsLock);
+
+    UnitTestExpect(Result, TestRemoteFramesState.Outputs[0] == ExpectedEvents);
+    UnitTestExpect(Result, TestRemoteFramesState.Outputs.size() == 1 + TEST_REMOTE_FRAMES_NUMBER_OF_SENDERS * TEST_REMOTE_FRAMES_COMMANDS_PER_SENDER + 1);
+    UnitTestExpect(Result, TestRemoteFramesState.Outputs.rbegin()->second == "break\n");
+
+    ReleaseSRWLockShared(&TestRemoteFramesState.OutputsLock);
+
+    UnitTestExpect(Result, TestRemoteFramesState.NumberOfInvalidFrames == 0);
+
+    //
+    // The waiters and the executer are released after the connection is closed
+    //
+    UnitTestExpect(Result, TestRemoteFramesDisconnect(Threads));
+
+    for (UINT32 i = 0; i < TEST_REMOTE_FRAMES_NUMBER_OF_SENDERS; i++)
+    {
+        CloseHandle(Senders[i]);
+    }
+
+    CloseHandle(EventsThread);
+    CloseHandle(BreakThread);
+
+    g_MessageHandler = MessageHandler;
+
+    return Result;
+}
+
+/**
+ * @brief Benchmark of the round trip of the commands over the loopback
+ *
+ * @return VOID
+ */
+VOID
+BenchmarkRemoteFrames()
+{
+    HANDLE       Threads[3] = {0};
+    const CHAR * Commands[] = {"nop", "echo benchmark"};
+    UINT64       StartTime;
+    UINT64       ElapsedTime;
+
+    if (!TestRemoteFramesConnect(Threads))
+    {
+        return;
+    }
+
+    for (UINT32 Form = 0; Form < 2; Form++)
+    {
+        StartTime = UnitTestGetTimeInNanoseconds();
+
+        for (UINT32 i = 0; i < TEST_REMOTE_FRAMES_BENCHMARK_COMMANDS; i++)
+        {
+            RemoteFrameSendCommandAndWait(TestRemoteFramesState.DebuggerSocket, Commands[Form], (int)strlen(Commands[Form]) + 1);
+        }
+
+        ElapsedTime = UnitTestGetTimeInNanoseconds() - StartTime;
+
+        UnitTestShowBenchmarkResult(Form == 0 ? "round trip of a command (no output)" : "round trip of a command (8 KB output)",
+                                    ElapsedTime,
+                                    TEST_REMOTE_FRAMES_BENCHMARK_COMMANDS);
+
+        //
+        // The outputs are not kept
+        //
+        AcquireSRWLockExclusive(&TestRemoteFramesState.OutputsLock);
+        TestRemoteFramesState.Outputs.clear();
+        ReleaseSRWLockExclusive(&TestRemoteFramesState.OutputsLock);
+    }
+
+    TestRemoteFramesDisconnect(Threads);
+}
+
+UnitTestRegister("remote-frames", TestRemoteFrames, BenchmarkRemoteFrames);
@@ -0,0 +1,220 @@
+/**
+ * @file test-script-compiled.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Tests and benchmark of the relocatable compiled scripts
+ * @details the scripts are parsed with the test module at one base and
+ * loaded with the test module at another base
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Number of statements of the script of the benchmark
+ *
+ */
+#define TEST_SCRIPT_COMPILED_BENCHMARK_STATEMENTS 200
+
+/**
+ * @brief Number of runs of each form in the benchmark
+ *
+ */
+#define TEST_SCRIPT_COMPILED_BENCHMARK_RUNS 50
+
+/**
+ * @brief A test script and the number of its relocated addresses
+ *
+ */
+typedef struct _TEST_SCRIPT_COMPILED_CASE
+{
+    const CHAR * Script;
+    UINT32       NumberOfRelocations;
+
+} TEST_SCRIPT_COMPILED_CASE, *PTEST_SCRIPT_COMPILED_CASE;
+
+/**
+ * @brief Test scripts of the compiled scripts
+ *
+ */
+static const TEST_SCRIPT_COMPILED_CASE TestScriptCompiledCases[] = {
+    {"test_statement(0x1230);", 0},
+    {"lv0 = testmod!func_1230; test_statement(lv0);", 1},
+    {"lv0 = testmod!func_1230; lv1 = testmod!data_20 + 0x10; test_statement(lv0 ^ lv1);", 2},
+    {"if (@rax == testmod!func_1230) { test_statement(testmod!func_1230); } else { test_statement(0); }", 2},
+    {".gv_compiled = testmod!var_fff0; test_statement(.gv_compiled);", 1},
+    {"printf(\"%llx\\n\", testmod!func_40); test_statement(poi(testmod!var_80));", 2},
+
+    //
+    // Numbers that are equal to a resolved address are not relocated
+    //
+    {"lv0 = testmod!func_1230; lv1 = 0xfffff80000001230; test_statement(lv0 + lv1);", 1},
+    {"test_statement(0xfffff80000000000 + testmod!func_0);", 1},
+};
+
+/**
+ * @brief Check that a compiled script is not loaded when its module is not
+ * loaded
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestScriptCompiledModuleIsNotLoaded()
+{
+    PSYMBOL_BUFFER CodeBuffer;
+    PSYMBOL_BUFFER LoadedCodeBuffer;
+    PVOID          Image     = NULL;
+    UINT32         ImageSize = 0;
+    BOOLEAN        Result    = FALSE;
+
+    hyperdbg_u_test_script_set_module_base(SCRIPT_ENGINE_TEST_MODULE_PARSE_BASE);
+
+    CodeBuffer = (PSYMBOL_BUFFER)ScriptEngineParse((char *)"test_statement(testmod!func_100);");
+
+    if (CodeBuffer->Message == NULL && ScriptEngineSerializeCompiledScript(CodeBuffer, &Image, &ImageSize))
+    {
+        //
+        // The test module is not in the symbols
+        //
+        hyperdbg_u_test_script_set_module_base(NULL);
+
+        LoadedCodeBuffer = (PSYMBOL_BUFFER)ScriptEngineLoadCompiledScript(Image, ImageSize);
+
+        Result = LoadedCodeBuffer != NULL && LoadedCodeBuffer->Message != NULL;
+
+        if (LoadedCodeBuffer != NULL)
+        {
+            RemoveSymbolBuffer(LoadedCodeBuffer);
+        }
+
+        ScriptEngineFreeCompiledScript(Image);
+    }
+
+    hyperdbg_u_test_script_set_module_base(NULL);
+    RemoveSymbolBuffer(CodeBuffer);
+
+    return Result;
+}
+
+/**
+ * @brief Test of serializing and loading the compiled scripts against
+ * different bases of the modules
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+TestScriptCompiled()
+{
+    BOOLEAN Result = TRUE;
+    UINT32  NumberOfRelocations;
+    UINT64  LoadBases[] = {SCRIPT_ENGINE_TEST_MODULE_PARSE_BASE,
+                          SCRIPT_ENGINE_TEST_MODULE_LOAD_BASE,
+                          SCRIPT_ENGINE_TEST_MODULE_PARSE_BASE - 0x10000000,
+                          0x7ff712340000};
+
+    for (UINT32 i = 0; i < sizeof(TestScriptCompiledCases) / sizeof(TestScriptCompiledCases[0]); i++)
+    {
+        for (UINT32 j = 0; j < sizeof(LoadBases) / sizeof(LoadBases[0]); j++)
+        {
+            NumberOfRelocations = 0;
+
+            if (!hyperdbg_u_test_script_compiled_round_trip(TestScriptCompiledCases[i].Script,
+                                                            SCRIPT_ENGINE_TEST_MODULE_PARSE_BASE,
+                                                            LoadBases[j],
+                                                            &NumberOfRelocations) ||
+                NumberOfRelocations != TestScriptCompiledCases[i].NumberOfRelocations)
+            {
+                ShowMessages("\t[x] round-trip failed at base %llx (%d relocations): %s\n",
+                             LoadBases[j],
+                             NumberOfRelocations,
+                             TestScriptCompiledCases[i].Script);
+                Result = FALSE;
+            }
+        }
+    }
+
+    UnitTestExpect(Result, TestScriptCompiledModuleIsNotLoaded());
+
+    return Result;
+}
+
+/**
+ * @brief Benchmark of parsing a script and loading its compiled form
+ *
+ * @return VOID
+ */
+VOID
+BenchmarkScriptCompiled()
+{
+    std::string Script;
+    PVOID       CodeBuffer;
+    PVOID       Image     = NULL;
+    UINT32      ImageSize = 0;
+    UINT64      StartTime;
+    UINT64      ElapsedTime;
+    CHAR        Statement[128];
+
+    for (UINT32 i = 0; i < TEST_SCRIPT_COMPILED_BENCHMARK_STATEMENTS; i++)
+    {
+        sprintf_s(Statement,
+                  sizeof(Statement),
+                  "if (@rax == testmod!func_%x) { lv%d = lv%d + 0x%x; } ",
+                  i * 0x10,
+                  i % 4,
+                  (i + 1) % 4,
+                  i);
+        Script += Statement;
+    }
+
+    Script += "test_statement(lv0);";
+
+    hyperdbg_u_test_script_set_module_base(SCRIPT_ENGINE_TEST_MODULE_PARSE_BASE);
+
+    CodeBuffer = ScriptEngineParse((char *)Script.c_str());
+
+    if (((PSYMBOL_BUFFER)CodeBuffer)->Message != NULL ||
+        !ScriptEngineSerializeCompiledScript(CodeBuffer, &Image, &ImageSize))
+    {
+        ShowMessages("err, unable to compile the benchmark script\n");
+        hyperdbg_u_test_script_set_module_base(NULL);
+        RemoveSymbolBuffer(CodeBuffer);
+        return;
+    }
+
+    RemoveSymbolBuffer(CodeBuffer);
+
+    //
+    // Parse the script
+    //
+    StartTime = UnitTestGetTimeInNanoseconds();
+
+    for (UINT32 i = 0; i < TEST_SCRIPT_COMPILED_BENCHMARK_RUNS; i++)
+    {
+        RemoveSymbolBuffer(ScriptEngineParse((char *)Script.c_str()));
+    }
+
+    ElapsedTime = UnitTestGetTimeInNanoseconds() - StartTime;
+
+    UnitTestShowBenchmarkResult("parse the script", ElapsedTime, TEST_SCRIPT_COMPILED_BENCHMARK_RUNS);
+
+    //
+    // Load the compiled script
+    //
+    StartTime = UnitTestGetTimeInNanoseconds();
+
+    for (UINT32 i = 0; i < TEST_SCRIPT_COMPILED_BENCHMARK_RUNS; i++)
+    {
+        RemoveSymbolBuffer(ScriptEngineLoadCompiledScript(Image, ImageSize));
+    }
+
+    ElapsedTime = UnitTestGetTimeInNanoseconds() - StartTime;
+
+    UnitTestShowBenchmarkResult("load the compiled script", ElapsedTime, TEST_SCRIPT_COMPILED_BENCHMARK_RUNS);
+
+    hyperdbg_u_test_script_set_module_base(NULL);
+    ScriptEngineFreeCompiledScript(Image);
+}
+
+UnitTestRegister("script-compiled", TestScriptCompiled, BenchmarkScriptCompiled);
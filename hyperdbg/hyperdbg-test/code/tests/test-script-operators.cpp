@@ -0,0 +1,381 @@
+/**
+ * @file test-script-operators.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Differential test and benchmark of the operand-specialized operators
+ * @details random scripts are evaluated with the specialized operators and
+ * with the generic operators (as the reference) and the results are compared
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Number of random scripts of the differential test
+ *
+ */
+#define TEST_SCRIPT_OPERATORS_NUMBER_OF_SCRIPTS 400
+
+/**
+ * @brief Number of runs of each form in the benchmark
+ *
+ */
+#define TEST_SCRIPT_OPERATORS_BENCHMARK_RUNS 20
+
+/**
+ * @brief Variables of the random scripts
+ * @details the registers that hold pointers in the test parser (rcx, rsp,
+ * r14 and r15) are not used as they're different in each run
+ *
+ */
+static const CHAR * TestScriptOperatorsVariables[] = {
+    "lv0",
+    "lv1",
+    "lv2",
+    "lv3",
+    ".gv0",
+    ".gv1",
+    ".gv2",
+    "@rax",
+    "@rbx",
+    "@rdx",
+    "@r8",
+    "@r12",
+};
+
+/**
+ * @brief Two-operand operators of the random scripts
+ *
+ */
+static const CHAR * TestScriptOperatorsBinaryOperators[] = {"|", "^", "&", "+", "-", "*"};
+
+/**
+ * @brief Comparison operators of the random scripts
+ *
+ */
+static const CHAR * TestScriptOperatorsComparisons[] = {">", "<", ">=", "<=", "==", "!="};
+
+/**
+ * @brief Script of the benchmark
+ *
+ */
+static const CHAR TestScriptOperatorsBenchmarkScript[] =
+    "lv0 = 0; lv1 = 0; .gv0 = 0; "
+    "for (i = 0; i < 0x4000; i++) { "
+    "lv0 = lv0 + i; lv1 = lv1 ^ lv0; lv2 = lv1 & 0xff; "
+    "if (lv2 > 0x80) { lv1 = lv1 + 1; } else { lv1 = lv1 - 1; } "
+    ".gv0 = .gv0 + 1; @rax = lv1; lv3 = @rbx + 0x10; } ";
+
+/**
+ * @brief Get a random immediate value for the scripts
+ *
+ * @param State
+ *
+ * @return std::string
+ */
+static std::string
+TestScriptOperatorsGetImmediate(UINT64 * State)
+{
+    CHAR   Buffer[32] = {0};
+    UINT64 Value      = UnitTestGetRandom(State);
+
+    switch (Value % 3)
+    {
+    case 0:
+        Value = (Value >> 8) % 0x20;
+        break;
+    case 1:
+        Value = 0 - ((Value >> 8) % 0x20);
+        break;
+    default:
+        break;
+    }
+
+    sprintf_s(Buffer, sizeof(Buffer), "0x%llx", Value);
+
+    return Buffer;
+}
+
+/**
+ * @brief Get a random operand (a variable or an immediate value)
+ *
+ * @param State
+ *
+ * @return std::string
+ */
+static std::string
+TestScriptOperatorsGetOperand(UINT64 * State)
+{
+    UINT64 Value = UnitTestGetRandom(State);
+
+    if (Value % 4 == 0)
+    {
+        return TestScriptOperatorsGetImmediate(State);
+    }
+
+    return TestScriptOperatorsVariables[(Value >> 8) % (sizeof(TestScriptOperatorsVariables) / sizeof(TestScriptOperatorsVariables[0]))];
+}
+
+/**
+ * @brief Get a random variable
+ *
+ * @param State
+ *
+ * @return std::string
+ */
+static std::string
+TestScriptOperatorsGetVariable(UINT64 * State)
+{
+    return TestScriptOperatorsVariables[UnitTestGetRandom(State) % (sizeof(TestScriptOperatorsVariables) / sizeof(TestScriptOperatorsVariables[0]))];
+}
+
+/**
+ * @brief Generate a random statement
+ *
+ * @param State
+ * @param Depth Depth of the nested statements
+ *
+ * @return std::string
+ */
+static std::string
+TestScriptOperatorsGenerateStatement(UINT64 * State, UINT32 Depth)
+{
+    CHAR        Buffer[32] = {0};
+    std::string Destination;
+    std::string Statement;
+    UINT64      Kind = UnitTestGetRandom(State) % (Depth == 0 ? 7 : 4);
+
+    Destination = TestScriptOperatorsGetVariable(State);
+
+    switch (Kind)
+    {
+    case 0:
+    case 1:
+
+        //
+        // Two-operand operators
+        //
+        Statement = Destination + " = " + TestScriptOperatorsGetOperand(State) + " " +
+                    TestScriptOperatorsBinaryOperators[UnitTestGetRandom(State) % (sizeof(TestScriptOperatorsBinaryOperators) / sizeof(TestScriptOperatorsBinaryOperators[0]))] +
+                    " " + TestScriptOperatorsGetOperand(State) + "; ";
+        break;
+
+    case 2:
+
+        //
+        // Moves and modifying a variable by an immediate value
+        //
+        if (UnitTestGetRandom(State) % 2)
+        {
+            Statement = Destination + " = " + TestScriptOperatorsGetOperand(State) + "; ";
+        }
+        else
+        {
+            Statement = Destination + " = " + Destination + (UnitTestGetRandom(State) % 2 ? " + " : " - ") +
+                        TestScriptOperatorsGetImmediate(State) + "; ";
+        }
+        break;
+
+    case 3:
+
+        //
+        // Shifts (the number of bits is less than 64, otherwise it's not defined)
+        //
+        sprintf_s(Buffer, sizeof(Buffer), "0x%llx", UnitTestGetRandom(State) % 64);
+
+        Statement = Destination + " = " + TestScriptOperatorsGetVariable(State) +
+                    (UnitTestGetRandom(State) % 2 ? " >> " : " << ") + Buffer + "; ";
+        break;
+
+    case 4:
+    case 5:
+
+        //
+        // Conditions
+        //
+        Statement = "if (" + TestScriptOperatorsGetOperand(State) + " " +
+                    TestScriptOperatorsComparisons[UnitTestGetRandom(State) % (sizeof(TestScriptOperatorsComparisons) / sizeof(TestScriptOperatorsComparisons[0]))] +
+                    " " + TestScriptOperatorsGetOperand(State) + ") { " +
+                    TestScriptOperatorsGenerateStatement(State, Depth + 1) + "} else { " +
+                    TestScriptOperatorsGenerateStatement(State, Depth + 1) + "} ";
+        break;
+
+    default:
+
+        //
+        // Loops (the counter is not one of the random variables)
+        //
+        sprintf_s(Buffer, sizeof(Buffer), "0x%llx", UnitTestGetRandom(State) % 8);
+
+        Statement = std::string("for (i = 0; i < ") + Buffer + "; i++) { " +
+                    TestScriptOperatorsGenerateStatement(State, Depth + 1) +
+                    TestScriptOperatorsGenerateStatement(State, Depth + 1) + "} ";
+        break;
+    }
+
+    return Statement;
+}
+
+/**
+ * @brief Generate a random script that passes the hash of its variables
+ * to test_statement
+ *
+ * @param State
+ *
+ * @return std::string
+ */
+static std::string
+TestScriptOperatorsGenerateScript(UINT64 * State)
+{
+    std::string Script;
+    std::string Hash = "0x0";
+    UINT32      NumberOfStatements;
+
+    //
+    // Global variables keep their values between runs, so all the variables
+    // are initialized
+    //
+    for (UINT32 i = 0; i < sizeof(TestScriptOperatorsVariables) / sizeof(TestScriptOperatorsVariables[0]); i++)
+    {
+        Script += std::string(TestScriptOperatorsVariables[i]) + " = " + TestScriptOperatorsGetImmediate(State) + "; ";
+    }
+
+    NumberOfStatements = 1 + UnitTestGetRandom(State) % 12;
+
+    for (UINT32 i = 0; i < NumberOfStatements; i++)
+    {
+        Script += TestScriptOperatorsGenerateStatement(State, 0);
+    }
+
+    for (UINT32 i = 0; i < sizeof(TestScriptOperatorsVariables) / sizeof(TestScriptOperatorsVariables[0]); i++)
+    {
+        Hash = "(" + Hash + " * 0x100000001b3) ^ " + TestScriptOperatorsVariables[i];
+    }
+
+    return Script + "test_statement(" + Hash + "); ";
+}
+
+/**
+ * @brief Count the operand-specialized operators of a script
+ *
+ * @param Expr
+ *
+ * @return UINT32
+ */
+static UINT32
+TestScriptOperatorsCountSpecialized(const std::string & Expr)
+{
+    PSYMBOL_BUFFER CodeBuffer;
+    UINT32         Count = 0;
+
+    CodeBuffer = (PSYMBOL_BUFFER)ScriptEngineParse((char *)Expr.c_str());
+
+    if (CodeBuffer->Message == NULL)
+    {
+        for (UINT32 i = 0; i < CodeBuffer->Pointer; i++)
+        {
+            if (CodeBuffer->Head[i].Type == SYMBOL_SEMANTIC_RULE_TYPE &&
+                CodeBuffer->Head[i].Value >= FUNC_SPECIALIZED_OPERATORS_START)
+            {
+                Count++;
+            }
+        }
+    }
+
+    RemoveSymbolBuffer(CodeBuffer);
+
+    return Count;
+}
+
+/**
+ * @brief Differential test of the operand-specialized operators
+ * @details the statements of the script engine test-cases are also
+ * compared in the '? test' command
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+TestScriptOperatorSpecialization()
+{
+    BOOLEAN     Result                       = TRUE;
+    UINT64      State                        = 0x76c4a1f3d2e5b697;
+    UINT64      NumberOfSpecializedOperators = 0;
+    std::string Script;
+
+    for (UINT32 i = 0; i < TEST_SCRIPT_OPERATORS_NUMBER_OF_SCRIPTS; i++)
+    {
+        Script = TestScriptOperatorsGenerateScript(&State);
+
+        NumberOfSpecializedOperators += TestScriptOperatorsCountSpecialized(Script);
+
+        if (!hyperdbg_u_test_script_operator_specialization(Script.c_str()))
+        {
+            ShowMessages("\t[x] different results for: %s\n", Script.c_str());
+            Result = FALSE;
+        }
+    }
+
+    //
+    // Make sure the specialized operators are actually generated, and
+    // they're not generated when the specialization is disabled
+    //
+    UnitTestExpect(Result, NumberOfSpecializedOperators != 0);
+
+    ScriptEngineSetOperatorSpecialization(FALSE);
+    UnitTestExpect(Result, TestScriptOperatorsCountSpecialized(TestScriptOperatorsBenchmarkScript) == 0);
+    ScriptEngineSetOperatorSpecialization(TRUE);
+
+    return Result;
+}
+
+/**
+ * @brief Benchmark of the generic and the operand-specialized operators
+ *
+ * @return VOID
+ */
+VOID
+BenchmarkScriptOperatorSpecialization()
+{
+    PSYMBOL_BUFFER CodeBuffer;
+    UINT64         NumberOfOperators;
+    UINT64         StartTime;
+    UINT64         ElapsedTime;
+
+    for (UINT32 Form = 0; Form < 2; Form++)
+    {
+        ScriptEngineSetOperatorSpecialization(Form == 1);
+        CodeBuffer = (PSYMBOL_BUFFER)ScriptEngineParse((char *)TestScriptOperatorsBenchmarkScript);
+        ScriptEngineSetOperatorSpecialization(TRUE);
+
+        if (CodeBuffer->Message != NULL)
+        {
+            ShowMessages("err, unable to parse the benchmark script (%s)\n", CodeBuffer->Message);
+            RemoveSymbolBuffer(CodeBuffer);
+            return;
+        }
+
+        NumberOfOperators = 0;
+        StartTime         = UnitTestGetTimeInNanoseconds();
+
+        for (UINT32 i = 0; i < TEST_SCRIPT_OPERATORS_BENCHMARK_RUNS; i++)
+        {
+            if (!hyperdbg_u_test_script_execute(CodeBuffer, &NumberOfOperators))
+            {
+                ShowMessages("err, unable to execute the benchmark script\n");
+                break;
+            }
+        }
+
+        ElapsedTime = UnitTestGetTimeInNanoseconds() - StartTime;
+
+        UnitTestShowBenchmarkResult(Form == 1 ? "specialized operators" : "generic operators",
+                                    ElapsedTime,
+                                    NumberOfOperators);
+
+        RemoveSymbolBuffer(CodeBuffer);
+    }
+}
+
+UnitTestRegister("script-operators", TestScriptOperatorSpecialization, BenchmarkScriptOperatorSpecialization);
@@ -0,0 +1,208 @@
+/**
+ * @file test-script-parser.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Tests and benchmark of reusing the buffers of the parser
+ * @details the scripts are parsed with the reused buffers and with the
+ * buffers that are allocated for each parse (as the reference) and the
+ * generated codes are compared
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Number of parses of each form in the benchmark
+ *
+ */
+#define TEST_SCRIPT_PARSER_BENCHMARK_RUNS 200
+
+/**
+ * @brief Test scripts of the parser
+ * @details the scripts with syntax errors stop the parser in the middle,
+ * so the buffers are not empty for the next parse
+ *
+ */
+static const CHAR * TestScriptParserCases[] = {
+    "test_statement(0x1230);",
+    "lv0 = 0x10; lv1 = lv0 + 0x20; test_statement(lv0 ^ lv1);",
+    "if (@rax == 0x55) { test_statement(1); } elsif (@rbx > 2) { test_statement(2); } else { test_statement(3); }",
+    "lv0 = 0; for (i = 0; i < 0x10; i++) { lv0 = lv0 + i; } test_statement(lv0);",
+    "lv0 = ((0x10 + 0x20) * (0x30 - ",
+    ".gv_parser = 0x20; while (.gv_parser > 0) { .gv_parser--; } test_statement(.gv_parser);",
+    "printf(\"%llx %llx\\n\", @rax, @rcx); test_statement(strlen(\"parser\"));",
+    "if (@rax == { test_statement(1); }",
+    "? test_statement(0x1);",
+    "int add(int a, int b) { return a + b; } test_statement(add(0x10, 0x20));",
+    "lv0 = 0x10; do { lv0 = lv0 - 1; } while (lv0 > 0); test_statement(lv0);",
+    "test_statement(undefined_function(0x10));",
+    "test_statement(dq(@rsp) + db(@rsp + 8));",
+};
+
+/**
+ * @brief Script of the benchmark
+ *
+ */
+static const CHAR TestScriptParserBenchmarkScript[] =
+    "lv0 = 0; lv1 = 0; .gv0 = 0; "
+    "for (i = 0; i < 0x40; i++) { "
+    "lv0 = lv0 + i; lv1 = lv1 ^ lv0; lv2 = lv1 & 0xff; "
+    "if (lv2 > 0x80) { lv1 = lv1 + 1; } elsif (lv2 == 0x10) { lv1 = lv1 * 2; } else { lv1 = lv1 - 1; } "
+    ".gv0 = .gv0 + 1; @rax = lv1; lv3 = @rbx + 0x10; } "
+    "printf(\"%llx\\n\", lv1); test_statement(lv0 + lv1);";
+
+/**
+ * @brief Check whether two parsed scripts are the same
+ * @details the bytes after the strings (to the end of their last symbol)
+ * are not initialized, so only the strings themselves are compared
+ *
+ * @param CodeBuffer
+ * @param ReferenceCodeBuffer
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestScriptParserIsSameCode(PSYMBOL_BUFFER CodeBuffer, PSYMBOL_BUFFER ReferenceCodeBuffer)
+{
+    PSYMBOL Symbol;
+    PSYMBOL ReferenceSymbol;
+    UINT64  Type;
+
+    if ((CodeBuffer->Message == NULL) != (ReferenceCodeBuffer->Message == NULL))
+    {
+        return FALSE;
+    }
+
+    if (CodeBuffer->Message != NULL)
+    {
+        return strcmp(CodeBuffer->Message, ReferenceCodeBuffer->Message) == 0;
+    }
+
+    if (CodeBuffer->Pointer != ReferenceCodeBuffer->Pointer)
+    {
+        return FALSE;
+    }
+
+    for (UINT32 i = 0; i < CodeBuffer->Pointer;)
+    {
+        Symbol          = &CodeBuffer->Head[i];
+        ReferenceSymbol = &ReferenceCodeBuffer->Head[i];
+        Type            = Symbol->Type & 0x7fffffff;
+
+        if (Symbol->Type != ReferenceSymbol->Type || Symbol->Len != ReferenceSymbol->Len)
+        {
+            return FALSE;
+        }
+
+        if (Type == SYMBOL_STRING_TYPE || Type == SYMBOL_WSTRING_TYPE)
+        {
+            if (memcmp(&Symbol->Value, &ReferenceSymbol->Value, Symbol->Len))
+            {
+                return FALSE;
+            }
+
+            i += (UINT32)((SIZE_SYMBOL_WITHOUT_LEN + Symbol->Len) / sizeof(SYMBOL) + 1);
+            continue;
+        }
+
+        if (Symbol->Value != ReferenceSymbol->Value)
+        {
+            return FALSE;
+        }
+
+        i++;
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Test of reusing the buffers of the parser
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+TestScriptParserContextReuse()
+{
+    BOOLEAN        Result         = TRUE;
+    UINT32         NumberOfCases  = sizeof(TestScriptParserCases) / sizeof(TestScriptParserCases[0]);
+    UINT32         NumberOfErrors = 0;
+    PSYMBOL_BUFFER CodeBuffer;
+    PSYMBOL_BUFFER ReferenceCodeBuffer;
+
+    //
+    // Each script is parsed after all the other scripts (including the ones
+    // with errors), so the buffers are reused in different states
+    //
+    for (UINT32 Offset = 0; Offset < NumberOfCases; Offset++)
+    {
+        for (UINT32 i = 0; i < NumberOfCases; i++)
+        {
+            const CHAR * Script = TestScriptParserCases[(i + Offset) % NumberOfCases];
+
+            ScriptEngineSetParserContextReuse(FALSE);
+            ReferenceCodeBuffer = (PSYMBOL_BUFFER)ScriptEngineParse((char *)Script);
+            ScriptEngineSetParserContextReuse(TRUE);
+
+            CodeBuffer = (PSYMBOL_BUFFER)ScriptEngineParse((char *)Script);
+
+            if (CodeBuffer->Message != NULL)
+            {
+                NumberOfErrors++;
+            }
+
+            if (!TestScriptParserIsSameCode(CodeBuffer, ReferenceCodeBuffer))
+            {
+                ShowMessages("\t[x] different codes for: %s\n", Script);
+                Result = FALSE;
+            }
+
+            RemoveSymbolBuffer(CodeBuffer);
+            RemoveSymbolBuffer(ReferenceCodeBuffer);
+        }
+    }
+
+    //
+    // Make sure the scripts with errors are actually tested
+    //
+    UnitTestExpect(Result, NumberOfErrors != 0 && NumberOfErrors != NumberOfCases * NumberOfCases);
+
+    return Result;
+}
+
+/**
+ * @brief Benchmark of parsing with the reused buffers and with the buffers
+ * that are allocated for each parse
+ *
+ * @return VOID
+ */
+VOID
+BenchmarkScriptParserContextReuse()
+{
+    UINT64 StartTime;
+    UINT64 ElapsedTime;
+
+    for (UINT32 Form = 0; Form < 2; Form++)
+    {
+        ScriptEngineSetParserContextReuse(Form == 1);
+
+        StartTime = UnitTestGetTimeInNanoseconds();
+
+        for (UINT32 i = 0; i < TEST_SCRIPT_PARSER_BENCHMARK_RUNS; i++)
+        {
+            RemoveSymbolBuffer(ScriptEngineParse((char *)TestScriptParserBenchmarkScript));
+        }
+
+        ElapsedTime = UnitTestGetTimeInNanoseconds() - StartTime;
+
+        UnitTestShowBenchmarkResult(Form == 1 ? "parse with the reused buffers" : "parse with the allocated buffers",
+                                    ElapsedTime,
+                                    TEST_SCRIPT_PARSER_BENCHMARK_RUNS);
+    }
+
+    ScriptEngineSetParserContextReuse(TRUE);
+}
+
+UnitTestRegister("script-parser", TestScriptParserContextReuse, BenchmarkScriptParserContextReuse);
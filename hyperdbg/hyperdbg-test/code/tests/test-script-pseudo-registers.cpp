@@ -0,0 +1,265 @@
+/**
+ * @file test-script-pseudo-registers.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Tests and benchmark of the memoized pseudo-registers
+ * @details the comparisons of $pname by the interned ids are compared with
+ * strcmp (as the reference)
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Number of runs of each form in the benchmark
+ *
+ */
+#define TEST_SCRIPT_PSEUDO_REGISTERS_BENCHMARK_RUNS 20
+
+/**
+ * @brief Number of calls of the benchmark of the memoized pseudo-registers
+ *
+ */
+#define TEST_SCRIPT_PSEUDO_REGISTERS_BENCHMARK_CALLS 0x100000
+
+/**
+ * @brief Script of the benchmark
+ *
+ */
+static const CHAR TestScriptPseudoRegistersBenchmarkScript[] =
+    ".gv0 = 0; "
+    "for (i = 0; i < 0x4000; i++) { "
+    "if (strcmp($pname, \"notepad.exe\") == 0) { .gv0 = .gv0 + 1; } "
+    "if (strcmp(\"explorer.exe\", $pname) == 0) { .gv0 = .gv0 + 1; } } ";
+
+/**
+ * @brief Get the sign of the result of strcmp
+ *
+ * @param Result
+ *
+ * @return INT32
+ */
+static INT32
+TestScriptPseudoRegistersGetSign(INT64 Result)
+{
+    return Result < 0 ? -1 : (Result > 0 ? 1 : 0);
+}
+
+/**
+ * @brief Compare $pname with a string by the interned ids and by strcmp
+ *
+ * @param Pname
+ * @param String
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestScriptPseudoRegistersCompare(const CHAR * Pname, const CHAR * String)
+{
+    BOOLEAN Result = TRUE;
+
+    if (TestScriptPseudoRegistersGetSign((INT64)hyperdbg_u_test_script_compare_pname(String, TRUE)) !=
+            TestScriptPseudoRegistersGetSign(strcmp(Pname, String)) ||
+        TestScriptPseudoRegistersGetSign((INT64)hyperdbg_u_test_script_compare_pname(String, FALSE)) !=
+            TestScriptPseudoRegistersGetSign(strcmp(String, Pname)))
+    {
+        ShowMessages("\t[x] different result for comparing '%s' and '%s'\n", Pname, String);
+        Result = FALSE;
+    }
+
+    return Result;
+}
+
+/**
+ * @brief Count the comparisons of $pname by the interned ids in a script
+ *
+ * @param Expr
+ *
+ * @return UINT32
+ */
+static UINT32
+TestScriptPseudoRegistersCountComparisons(const std::string & Expr)
+{
+    PSYMBOL_BUFFER CodeBuffer;
+    UINT32         Count = 0;
+
+    CodeBuffer = (PSYMBOL_BUFFER)ScriptEngineParse((char *)Expr.c_str());
+
+    if (CodeBuffer->Message == NULL)
+    {
+        for (UINT32 i = 0; i < CodeBuffer->Pointer; i++)
+        {
+            if (CodeBuffer->Head[i].Type == SYMBOL_SEMANTIC_RULE_TYPE &&
+                (CodeBuffer->Head[i].Value == FUNC_STRCMP_TMP_PNAME_STR ||
+                 CodeBuffer->Head[i].Value == FUNC_STRCMP_TMP_STR_PNAME))
+            {
+                Count++;
+            }
+        }
+    }
+
+    RemoveSymbolBuffer(CodeBuffer);
+
+    return Count;
+}
+
+/**
+ * @brief Test of the memoized pseudo-registers and the interned ids of $pname
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+TestScriptPseudoRegisters()
+{
+    BOOLEAN     Result = TRUE;
+    CHAR *      Pname;
+    std::string Name;
+    std::string String;
+    std::string Script;
+
+    //
+    // The memoized values should be the same in each call
+    //
+    Pname = hyperdbg_u_test_script_get_pname();
+
+    UnitTestExpect(Result, Pname != NULL);
+    UnitTestExpect(Result, hyperdbg_u_test_script_get_pname() == Pname);
+    UnitTestExpect(Result, hyperdbg_u_test_script_get_peb() == hyperdbg_u_test_script_get_peb());
+
+    if (Pname == NULL)
+    {
+        return FALSE;
+    }
+
+    //
+    // The interned ids keep 15 characters (process names in EPROCESS are
+    // not longer than that), the strings are derived from the current name,
+    // so the prefixes and the characters around it are checked
+    //
+    Name = std::string(Pname).substr(0, 15);
+
+    UnitTestExpect(Result, TestScriptPseudoRegistersCompare(Pname, ""));
+    UnitTestExpect(Result, TestScriptPseudoRegistersCompare(Pname, "\x7f"));
+    UnitTestExpect(Result, TestScriptPseudoRegistersCompare(Pname, "\x90\x91"));
+
+    for (size_t i = 0; i <= Name.size(); i++)
+    {
+        String = Name.substr(0, i);
+
+        UnitTestExpect(Result, TestScriptPseudoRegistersCompare(Pname, String.c_str()));
+
+        if (i < Name.size())
+        {
+            for (INT32 Delta = -1; Delta <= 1; Delta += 2)
+            {
+                String    = Name;
+                String[i] = (CHAR)(String[i] + Delta);
+
+                if (String[i] != 0)
+                {
+                    UnitTestExpect(Result, TestScriptPseudoRegistersCompare(Pname, String.c_str()));
+                }
+            }
+        }
+    }
+
+    //
+    // The comparisons in the scripts should be replaced by the interned ids
+    // and they should have the same results as strcmp
+    //
+    Script = "test_statement(strcmp($pname, \"" + Name + "\") + strcmp(\"" + Name.substr(0, 3) + "\", $pname));";
+
+    UnitTestExpect(Result, TestScriptPseudoRegistersCountComparisons(Script) == 2);
+    UnitTestExpect(Result, hyperdbg_u_test_script_operator_specialization(Script.c_str()));
+    UnitTestExpect(Result, hyperdbg_u_test_script_operator_specialization("test_statement(strcmp($pname, \"a.exe\"));"));
+    UnitTestExpect(Result, hyperdbg_u_test_script_operator_specialization("test_statement(strcmp(\"~~~\", $pname));"));
+
+    //
+    // Strings that are longer than the interned ids use strcmp
+    //
+    UnitTestExpect(Result, TestScriptPseudoRegistersCountComparisons("test_statement(strcmp($pname, \"a-very-long-process-name.exe\"));") == 0);
+
+    return Result;
+}
+
+/**
+ * @brief Benchmark of the memoized pseudo-registers and the comparison of
+ * $pname by strcmp and by the interned ids
+ *
+ * @return VOID
+ */
+VOID
+BenchmarkScriptPseudoRegisters()
+{
+    PSYMBOL_BUFFER CodeBuffer;
+    UINT64         NumberOfOperators;
+    UINT64         StartTime;
+    UINT64         ElapsedTime;
+    UINT64         Sum = 0;
+
+    //
+    // Memoized pseudo-registers (the first call resolves them)
+    //
+    hyperdbg_u_test_script_get_pname();
+    hyperdbg_u_test_script_get_peb();
+
+    StartTime = UnitTestGetTimeInNanoseconds();
+
+    for (UINT32 i = 0; i < TEST_SCRIPT_PSEUDO_REGISTERS_BENCHMARK_CALLS; i++)
+    {
+        Sum += (UINT64)hyperdbg_u_test_script_get_pname() + hyperdbg_u_test_script_get_peb();
+    }
+
+    ElapsedTime = UnitTestGetTimeInNanoseconds() - StartTime;
+
+    UnitTestShowBenchmarkResult("memoized $pname and $peb", ElapsedTime, TEST_SCRIPT_PSEUDO_REGISTERS_BENCHMARK_CALLS);
+
+    //
+    // Comparisons of $pname in the scripts
+    //
+    for (UINT32 Form = 0; Form < 2; Form++)
+    {
+        ScriptEngineSetOperatorSpecialization(Form == 1);
+        CodeBuffer = (PSYMBOL_BUFFER)ScriptEngineParse((char *)TestScriptPseudoRegistersBenchmarkScript);
+        ScriptEngineSetOperatorSpecialization(TRUE);
+
+        if (CodeBuffer->Message != NULL)
+        {
+            ShowMessages("err, unable to parse the benchmark script (%s)\n", CodeBuffer->Message);
+            RemoveSymbolBuffer(CodeBuffer);
+            return;
+        }
+
+        NumberOfOperators = 0;
+        StartTime         = UnitTestGetTimeInNanoseconds();
+
+        for (UINT32 i = 0; i < TEST_SCRIPT_PSEUDO_REGISTERS_BENCHMARK_RUNS; i++)
+        {
+            if (!hyperdbg_u_test_script_execute(CodeBuffer, &NumberOfOperators))
+            {
+                ShowMessages("err, unable to execute the benchmark script\n");
+                break;
+            }
+        }
+
+        ElapsedTime = UnitTestGetTimeInNanoseconds() - StartTime;
+
+        UnitTestShowBenchmarkResult(Form == 1 ? "$pname comparisons by interned ids" : "$pname comparisons by strcmp",
+                                    ElapsedTime,
+                                    NumberOfOperators);
+
+        RemoveSymbolBuffer(CodeBuffer);
+    }
+
+    //
+    // Keep the sum, so the calls are not removed by the compiler
+    //
+    if (Sum == 0)
+    {
+        ShowMessages("\n");
+    }
+}
+
+UnitTestRegister("script-pseudo-registers", TestScriptPseudoRegisters, BenchmarkScriptPseudoRegisters);
@@ -0,0 +1,382 @@
+/**
+ * @file test-script-registers.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Tests and benchmark of the registers snapshot of the script engine
+ * @details the reads and writes through the snapshot are compared with the
+ * direct accesses to the registers (as the reference)
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Number of registers (the last register is DR7)
+ *
+ */
+#define TEST_SCRIPT_REGISTERS_COUNT (REGISTER_DR7 + 1)
+
+/**
+ * @brief Number of random accesses of the write-back test
+ *
+ */
+#define TEST_SCRIPT_REGISTERS_NUMBER_OF_ACCESSES 0x4000
+
+/**
+ * @brief Number of reads of each run of the benchmark
+ *
+ */
+#define TEST_SCRIPT_REGISTERS_BENCHMARK_READS 0x100000
+
+/**
+ * @brief All the slots of the snapshot are valid
+ *
+ */
+#define TEST_SCRIPT_REGISTERS_ALL_SLOTS ((1 << SCRIPT_ENGINE_REGISTERS_SNAPSHOT_COUNT) - 1)
+
+/**
+ * @brief Registers that are read by the benchmark (a mix of general purpose
+ * registers and registers that are kept in the snapshot, as in the usual
+ * conditions of the events)
+ *
+ */
+static const REGS_ENUM TestScriptRegistersBenchmarkRegisters[] = {
+    REGISTER_RAX,
+    REGISTER_RIP,
+    REGISTER_RCX,
+    REGISTER_RFLAGS,
+    REGISTER_ZF,
+    REGISTER_CR3,
+    REGISTER_RDX,
+    REGISTER_CS,
+};
+
+/**
+ * @brief Statements that check the write-back of the registers from the
+ * scripts (the initial registers are set by the test parser)
+ *
+ */
+static const struct
+{
+    const CHAR * Statement;
+    UINT64       Expected;
+
+} TestScriptRegistersStatements[] = {
+    {"@rax = 0x1122334455667788; @al = 0x99; @ah = 0xaa; test_statement(@rax);", 0x112233445566aa99},
+    {"@rax = 0x1122334455667788; @ax = 0xbbcc; test_statement(@rax);", 0x112233445566bbcc},
+    {"@rbx = 0x1122334455667788; @ebx = 0xffffffff; test_statement(@rbx);", 0x11223344ffffffff},
+    {"@rdx = 0x55; @dl = 0x66; test_statement(@edx);", 0x66},
+    {"@r8w = 0x1234; test_statement(@r8);", 0x1234},
+    {"@r12 = 0xff00; @r12l = 0x11; test_statement(@r12w);", 0xff11},
+    {"@r13 = 0x10; x = @r13; @r13 = x + 1; test_statement(@r13 + x);", 0x21},
+    {"x = @rflags; @rflags = 0x246; test_statement(@rflags);", 0},
+    {"x = @cf; @cf = 1; test_statement(@cf);", 0},
+    {"x = @rip; @rip = 0x1000; test_statement(@ip);", 0},
+};
+
+/**
+ * @brief Get a random register
+ *
+ * @param State
+ *
+ * @return REGS_ENUM
+ */
+static REGS_ENUM
+TestScriptRegistersGetRandomRegister(UINT64 * State)
+{
+    return (REGS_ENUM)(UnitTestGetRandom(State) % TEST_SCRIPT_REGISTERS_COUNT);
+}
+
+/**
+ * @brief Fill the general purpose registers with random values
+ *
+ * @param State
+ * @param GuestRegs
+ *
+ * @return VOID
+ */
+static VOID
+TestScriptRegistersFillRandom(UINT64 * State, PGUEST_REGS GuestRegs)
+{
+    for (UINT32 i = 0; i < sizeof(GUEST_REGS) / sizeof(UINT64); i++)
+    {
+        ((UINT64 *)GuestRegs)[i] = UnitTestGetRandom(State);
+    }
+}
+
+/**
+ * @brief Get the number of the valid slots of a snapshot
+ *
+ * @param Snapshot
+ *
+ * @return UINT32
+ */
+static UINT32
+TestScriptRegistersCountValidSlots(PSCRIPT_ENGINE_REGISTERS_SNAPSHOT Snapshot)
+{
+    UINT32 Count = 0;
+
+    for (UINT32 i = 0; i < SCRIPT_ENGINE_REGISTERS_SNAPSHOT_COUNT; i++)
+    {
+        if (Snapshot->ValidMask & (1 << i))
+        {
+            Count++;
+        }
+    }
+
+    return Count;
+}
+
+/**
+ * @brief Test of the reads through the snapshot
+ * @details each register (and each sub-register and flag) should be
+ * the same as the direct read, both in the first and in the cached read
+ *
+ * @param State
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestScriptRegistersReads(UINT64 * State)
+{
+    BOOLEAN                          Result    = TRUE;
+    GUEST_REGS                       GuestRegs = {0};
+    SCRIPT_ENGINE_REGISTERS_SNAPSHOT Snapshot  = {0};
+
+    TestScriptRegistersFillRandom(State, &GuestRegs);
+
+    for (UINT32 Round = 0; Round < 2; Round++)
+    {
+        for (UINT32 i = 0; i < TEST_SCRIPT_REGISTERS_COUNT; i++)
+        {
+            if (hyperdbg_u_test_script_get_register(&GuestRegs, &Snapshot, (REGS_ENUM)i) != hyperdbg_u_test_script_get_register(&GuestRegs, NULL, (REGS_ENUM)i))
+            {
+                ShowMessages("\t[x] different value for register %d (round %d)\n", i, Round);
+                Result = FALSE;
+            }
+        }
+    }
+
+    //
+    // All the slots should be filled after reading all the registers
+    //
+    UnitTestExpect(Result, Snapshot.ValidMask == TEST_SCRIPT_REGISTERS_ALL_SLOTS);
+
+    return Result;
+}
+
+/**
+ * @brief Test of the write-back semantics
+ * @details random reads and writes are performed on the registers through
+ * the snapshot and directly on a copy of the registers (as the reference),
+ * the written registers and every read should be the same
+ *
+ * @param State
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestScriptRegistersWrites(UINT64 * State)
+{
+    BOOLEAN                          Result             = TRUE;
+    GUEST_REGS                       GuestRegs          = {0};
+    GUEST_REGS                       ReferenceGuestRegs = {0};
+    SCRIPT_ENGINE_REGISTERS_SNAPSHOT Snapshot           = {0};
+    REGS_ENUM                        RegId;
+    UINT64                           Value;
+
+    TestScriptRegistersFillRandom(State, &GuestRegs);
+    memcpy(&ReferenceGuestRegs, &GuestRegs, sizeof(GUEST_REGS));
+
+    for (UINT32 i = 0; i < TEST_SCRIPT_REGISTERS_NUMBER_OF_ACCESSES; i++)
+    {
+        RegId = TestScriptRegistersGetRandomRegister(State);
+        Value = UnitTestGetRandom(State);
+
+        if (Value % 2)
+        {
+            hyperdbg_u_test_script_set_register(&GuestRegs, &Snapshot, RegId, Value);
+            hyperdbg_u_test_script_set_register(&ReferenceGuestRegs, NULL, RegId, Value);
+
+            if (memcmp(&GuestRegs, &ReferenceGuestRegs, sizeof(GUEST_REGS)) != 0)
+            {
+                ShowMessages("\t[x] different registers after writing %llx to register %d\n", Value, RegId);
+                return FALSE;
+            }
+        }
+        else if (hyperdbg_u_test_script_get_register(&GuestRegs, &Snapshot, RegId) != hyperdbg_u_test_script_get_register(&ReferenceGuestRegs, NULL, RegId))
+        {
+            ShowMessages("\t[x] different value for register %d after %d accesses\n", RegId, i);
+            return FALSE;
+        }
+    }
+
+    return Result;
+}
+
+/**
+ * @brief Test of dropping the snapshot entries on writes
+ * @details a write should drop only the entry of the written register, so
+ * the stale values are never read again and the other entries are kept
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestScriptRegistersInvalidation()
+{
+    BOOLEAN                          Result    = TRUE;
+    GUEST_REGS                       GuestRegs = {0};
+    SCRIPT_ENGINE_REGISTERS_SNAPSHOT Snapshot  = {0};
+
+    for (UINT32 i = 0; i < TEST_SCRIPT_REGISTERS_COUNT; i++)
+    {
+        //
+        // Fill the snapshot with stale values (all bits are set, so the
+        // stale value of any sub-register or flag is not zero)
+        //
+        for (UINT32 j = 0; j < SCRIPT_ENGINE_REGISTERS_SNAPSHOT_COUNT; j++)
+        {
+            Snapshot.Registers[j] = 0xffffffffffffffff;
+        }
+
+        Snapshot.ValidMask = TEST_SCRIPT_REGISTERS_ALL_SLOTS;
+
+        hyperdbg_u_test_script_set_register(&GuestRegs, &Snapshot, (REGS_ENUM)i, 0);
+
+        if (i < REGISTER_DS)
+        {
+            //
+            // General purpose registers are not in the snapshot
+            //
+            if (Snapshot.ValidMask != TEST_SCRIPT_REGISTERS_ALL_SLOTS)
+            {
+                ShowMessages("\t[x] writing register %d dropped the snapshot\n", i);
+                Result = FALSE;
+            }
+        }
+        else if (TestScriptRegistersCountValidSlots(&Snapshot) != SCRIPT_ENGINE_REGISTERS_SNAPSHOT_COUNT - 1 ||
+                 hyperdbg_u_test_script_get_register(&GuestRegs, &Snapshot, (REGS_ENUM)i) != hyperdbg_u_test_script_get_register(&GuestRegs, NULL, (REGS_ENUM)i))
+        {
+            ShowMessages("\t[x] writing register %d didn't drop (only) its entry\n", i);
+            Result = FALSE;
+        }
+    }
+
+    return Result;
+}
+
+/**
+ * @brief Test of the registers snapshot of the script engine
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+TestScriptRegistersSnapshot()
+{
+    BOOLEAN Result = TRUE;
+    UINT64  State  = 0x1d8e4e27c47d124f;
+
+    UnitTestExpect(Result, TestScriptRegistersReads(&State));
+    UnitTestExpect(Result, TestScriptRegistersWrites(&State));
+    UnitTestExpect(Result, TestScriptRegistersInvalidation());
+
+    //
+    // Check the write-back from the scripts
+    //
+    for (UINT32 i = 0; i < sizeof(TestScriptRegistersStatements) / sizeof(TestScriptRegistersStatements[0]); i++)
+    {
+        if (!hyperdbg_u_test_script_statement(TestScriptRegistersStatements[i].Statement,
+                                              TestScriptRegistersStatements[i].Expected,
+                                              FALSE))
+        {
+            ShowMessages("\t[x] unexpected result for: %s\n", TestScriptRegistersStatements[i].Statement);
+            Result = FALSE;
+        }
+    }
+
+    return Result;
+}
+
+/**
+ * @brief Benchmark of the reads through the snapshot and the direct reads
+ * @details in user-mode, the registers other than the general purpose
+ * registers are not accessible, so the benchmark shows the cost of the
+ * lookups and the number of the reads of the guest state (each of them
+ * is a VMREAD or a privileged instruction in the hypervisor)
+ *
+ * @return VOID
+ */
+VOID
+BenchmarkScriptRegistersSnapshot()
+{
+    GUEST_REGS                       GuestRegs = {0};
+    SCRIPT_ENGINE_REGISTERS_SNAPSHOT Snapshot  = {0};
+    UINT64                           State     = 0x1d8e4e27c47d124f;
+    UINT64                           Sum       = 0;
+    UINT64                           NumberOfGuestStateReads;
+    UINT64                           StartTime;
+    UINT64                           ElapsedTime;
+    REGS_ENUM                        RegId;
+
+    TestScriptRegistersFillRandom(&State, &GuestRegs);
+
+    //
+    // Direct reads
+    //
+    NumberOfGuestStateReads = 0;
+    StartTime               = UnitTestGetTimeInNanoseconds();
+
+    for (UINT32 i = 0; i < TEST_SCRIPT_REGISTERS_BENCHMARK_READS; i++)
+    {
+        RegId = TestScriptRegistersBenchmarkRegisters[i % (sizeof(TestScriptRegistersBenchmarkRegisters) / sizeof(TestScriptRegistersBenchmarkRegisters[0]))];
+        Sum += hyperdbg_u_test_script_get_register(&GuestRegs, NULL, RegId);
+
+        if (RegId >= REGISTER_DS)
+        {
+            NumberOfGuestStateReads++;
+        }
+    }
+
+    ElapsedTime = UnitTestGetTimeInNanoseconds() - StartTime;
+
+    UnitTestShowBenchmarkResult("direct reads", ElapsedTime, TEST_SCRIPT_REGISTERS_BENCHMARK_READS);
+    ShowMessages("\t%-48s %10llu\n", "reads of the guest state (direct)", NumberOfGuestStateReads);
+
+    //
+    // Reads through the snapshot (the snapshot is dropped at the start of
+    // each run of the script, here every 0x100 reads)
+    //
+    NumberOfGuestStateReads = 0;
+    StartTime               = UnitTestGetTimeInNanoseconds();
+
+    for (UINT32 i = 0; i < TEST_SCRIPT_REGISTERS_BENCHMARK_READS; i++)
+    {
+        if (i % 0x100 == 0)
+        {
+            NumberOfGuestStateReads += TestScriptRegistersCountValidSlots(&Snapshot);
+            Snapshot.ValidMask = 0;
+        }
+
+        RegId = TestScriptRegistersBenchmarkRegisters[i % (sizeof(TestScriptRegistersBenchmarkRegisters) / sizeof(TestScriptRegistersBenchmarkRegisters[0]))];
+        Sum += hyperdbg_u_test_script_get_register(&GuestRegs, &Snapshot, RegId);
+    }
+
+    ElapsedTime = UnitTestGetTimeInNanoseconds() - StartTime;
+
+    NumberOfGuestStateReads += TestScriptRegistersCountValidSlots(&Snapshot);
+
+    UnitTestShowBenchmarkResult("reads through the snapshot", ElapsedTime, TEST_SCRIPT_REGISTERS_BENCHMARK_READS);
+    ShowMessages("\t%-48s %10llu\n", "reads of the guest state (snapshot)", NumberOfGuestStateReads);
+
+    //
+    // Keep the sum, so the reads are not removed by the compiler
+    //
+    if (Sum == 0x1d8e4e27c47d124f)
+    {
+        ShowMessages("\n");
+    }
+}
+
+UnitTestRegister("script-registers", TestScriptRegistersSnapshot, BenchmarkScriptRegistersSnapshot);
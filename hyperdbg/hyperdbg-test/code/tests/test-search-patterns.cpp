@@ -0,0 +1,559 @@
+/**
+ * @file test-search-patterns.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Tests and scaling benchmark of the multi-pattern search (sm, !sm)
+ * @details the search (MultiPatternSearch.c) is shared with hyperkd,
+ * the memory is a synthetic image with pages that are not valid, and the
+ * results are compared with a naive matcher
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Address of the first page of the synthetic images
+ *
+ */
+#define TEST_SEARCH_PATTERNS_BASE_ADDRESS 0x7ff600000000
+
+/**
+ * @brief Number of the randomized searches that are compared with the
+ * naive matcher
+ *
+ */
+#define TEST_SEARCH_PATTERNS_RANDOM_SEARCHES 2000
+
+/**
+ * @brief Size of the image of the benchmark
+ *
+ */
+#define TEST_SEARCH_PATTERNS_BENCHMARK_IMAGE_SIZE (16 * 1024 * 1024)
+
+/**
+ * @brief Length of the patterns of the benchmark
+ *
+ */
+#define TEST_SEARCH_PATTERNS_BENCHMARK_PATTERN_LENGTH 16
+
+/**
+ * @brief A synthetic image of memory
+ *
+ */
+typedef struct _TEST_SEARCH_PATTERNS_IMAGE
+{
+    std::vector<BYTE>    Bytes;
+    std::vector<BOOLEAN> IsPageValid;
+
+} TEST_SEARCH_PATTERNS_IMAGE, *PTEST_SEARCH_PATTERNS_IMAGE;
+
+/**
+ * @brief A result of the search (address, pattern id)
+ *
+ */
+typedef std::pair<UINT64, UINT32> TEST_SEARCH_PATTERNS_MATCH;
+
+/**
+ * @brief Check whether a byte of the image is readable or not
+ *
+ * @param Image
+ * @param Address
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestSearchPatternsIsValid(PTEST_SEARCH_PATTERNS_IMAGE Image, UINT64 Address)
+{
+    if (Address < TEST_SEARCH_PATTERNS_BASE_ADDRESS ||
+        Address - TEST_SEARCH_PATTERNS_BASE_ADDRESS >= Image->Bytes.size())
+    {
+        return FALSE;
+    }
+
+    return Image->IsPageValid[(Address - TEST_SEARCH_PATTERNS_BASE_ADDRESS) / PAGE_SIZE];
+}
+
+/**
+ * @brief Read a part of a page of the image (like SearchMultiplePatternsReadChunk)
+ *
+ * @param SearchRequest
+ * @param Address
+ * @param Buffer
+ * @param Size
+ * @param Context the image
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestSearchPatternsReadChunk(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS SearchRequest,
+                            UINT64                             Address,
+                            PVOID                              Buffer,
+                            UINT32                             Size,
+                            PVOID                              Context)
+{
+    PTEST_SEARCH_PATTERNS_IMAGE Image = (PTEST_SEARCH_PATTERNS_IMAGE)Context;
+
+    UNREFERENCED_PARAMETER(SearchRequest);
+
+    if (!TestSearchPatternsIsValid(Image, Address) || !TestSearchPatternsIsValid(Image, Address + Size - 1))
+    {
+        return FALSE;
+    }
+
+    memcpy(Buffer, &Image->Bytes[Address - TEST_SEARCH_PATTERNS_BASE_ADDRESS], Size);
+
+    return TRUE;
+}
+
+/**
+ * @brief Search the image with the automaton
+ * @details the search is continued (like the continuation requests of
+ * the debugger) each time that the buffer of the results is full
+ *
+ * @param Request
+ * @param Automaton
+ * @param Image
+ * @param Matches
+ * @param NumberOfFullResults number of times that the results were full
+ *
+ * @return BOOLEAN whether the request is valid and the results never
+ * overflowed or not
+ */
+static BOOLEAN
+TestSearchPatternsSearch(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS        Request,
+                         PSEARCH_MULTIPLE_PATTERNS_AUTOMATON       Automaton,
+                         PTEST_SEARCH_PATTERNS_IMAGE               Image,
+                         std::vector<TEST_SEARCH_PATTERNS_MATCH> & Matches,
+                         UINT32 *                                  NumberOfFullResults)
+{
+    std::vector<DEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT> Results(MaximumSearchMultiplePatternsResults);
+    BOOLEAN                                               IsFinished = FALSE;
+
+    Matches.clear();
+    *NumberOfFullResults = 0;
+
+    if (!SearchMultiplePatternsCompile(Request, Automaton))
+    {
+        return FALSE;
+    }
+
+    while (!IsFinished)
+    {
+        IsFinished = SearchMultiplePatternsScanRanges(Request,
+                                                      Automaton,
+                                                      Results.data(),
+                                                      TestSearchPatternsReadChunk,
+                                                      Image,
+                                                      NULL);
+
+        if (Request->NumberOfResults > MaximumSearchMultiplePatternsResults)
+        {
+            return FALSE;
+        }
+
+        for (UINT32 i = 0; i < Request->NumberOfResults; i++)
+        {
+            Matches.push_back({Results[i].Address, Results[i].PatternId});
+        }
+
+        if (!IsFinished)
+        {
+            (*NumberOfFullResults)++;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Search the image by comparing each pattern at each address
+ *
+ * @param Request
+ * @param Image
+ *
+ * @return std::vector<TEST_SEARCH_PATTERNS_MATCH>
+ */
+static std::vector<TEST_SEARCH_PATTERNS_MATCH>
+TestSearchPatternsSearchNaive(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS Request, PTEST_SEARCH_PATTERNS_IMAGE Image)
+{
+    std::vector<TEST_SEARCH_PATTERNS_MATCH> Matches;
+    std::vector<UINT32>                     ResultsPerPattern(Request->NumberOfPatterns, 0);
+
+    for (UINT32 RangeIndex = 0; RangeIndex < Request->NumberOfRanges; RangeIndex++)
+    {
+        UINT64 StartAddress = Request->Ranges[RangeIndex].Address;
+        UINT64 EndAddress   = StartAddress + Request->Ranges[RangeIndex].Length;
+
+        //
+        // The matches are reported in the order of their last byte
+        //
+        for (UINT64 Address = StartAddress; Address < EndAddress; Address++)
+        {
+            for (UINT32 PatternId = 0; PatternId < Request->NumberOfPatterns; PatternId++)
+            {
+                PDEBUGGER_SEARCH_PATTERN Pattern      = &Request->Patterns[PatternId];
+                UINT64                   MatchAddress = Address + 1 - Pattern->Length;
+                BOOLEAN                  IsMatched    = TRUE;
+
+                if (Address + 1 < StartAddress + Pattern->Length)
+                {
+                    continue;
+                }
+
+                for (UINT32 i = 0; i < Pattern->Length && IsMatched; i++)
+                {
+                    IsMatched = TestSearchPatternsIsValid(Image, MatchAddress + i) &&
+                                ((Image->Bytes[MatchAddress + i - TEST_SEARCH_PATTERNS_BASE_ADDRESS] ^ Pattern->Bytes[i]) & Pattern->Masks[i]) == 0;
+                }
+
+                if (!IsMatched ||
+                    (Request->MaximumResultsPerPattern != 0 && ResultsPerPattern[PatternId] == Request->MaximumResultsPerPattern))
+                {
+                    continue;
+                }
+
+                ResultsPerPattern[PatternId]++;
+                Matches.push_back({MatchAddress, PatternId});
+            }
+        }
+    }
+
+    return Matches;
+}
+
+/**
+ * @brief Sort the results by their last byte and the pattern id
+ *
+ * @param Request
+ * @param Matches
+ *
+ * @return VOID
+ */
+static VOID
+TestSearchPatternsSort(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS Request, std::vector<TEST_SEARCH_PATTERNS_MATCH> & Matches)
+{
+    std::stable_sort(Matches.begin(), Matches.end(), [Request](const TEST_SEARCH_PATTERNS_MATCH & A, const TEST_SEARCH_PATTERNS_MATCH & B) {
+        UINT64 EndA = A.first + Request->Patterns[A.second].Length;
+        UINT64 EndB = B.first + Request->Patterns[B.second].Length;
+
+        return EndA != EndB ? EndA < EndB : A.second < B.second;
+    });
+}
+
+/**
+ * @brief Fill an image with random bytes of a small alphabet (to have
+ * many matches) and a few pages that are not valid
+ *
+ * @param Image
+ * @param NumberOfPages
+ * @param AlphabetSize
+ * @param RandomState
+ *
+ * @return VOID
+ */
+static VOID
+TestSearchPatternsRandomImage(PTEST_SEARCH_PATTERNS_IMAGE Image,
+                              UINT32                      NumberOfPages,
+                              UINT32                      AlphabetSize,
+                              UINT64 *                    RandomState)
+{
+    Image->Bytes.resize((SIZE_T)NumberOfPages * PAGE_SIZE);
+    Image->IsPageValid.assign(NumberOfPages, TRUE);
+
+    for (BYTE & Byte : Image->Bytes)
+    {
+        Byte = (BYTE)(UnitTestGetRandom(RandomState) % AlphabetSize);
+    }
+
+    if (UnitTestGetRandom(RandomState) % 3 == 0)
+    {
+        Image->IsPageValid[UnitTestGetRandom(RandomState) % NumberOfPages] = FALSE;
+    }
+}
+
+/**
+ * @brief Compare the automaton with the naive matcher on random images,
+ * patterns (with wildcards), ranges and limits
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestSearchPatternsRandomized()
+{
+    static SEARCH_MULTIPLE_PATTERNS_AUTOMATON Automaton;
+    BOOLEAN                                   Result      = TRUE;
+    UINT64                                    RandomState = 0x5eed5eed12345678;
+    UINT32                                    NumberOfFullResults;
+    UINT32                                    TotalFullResults = 0;
+    TEST_SEARCH_PATTERNS_IMAGE                Image;
+    DEBUGGER_SEARCH_MULTIPLE_PATTERNS         Request;
+    std::vector<TEST_SEARCH_PATTERNS_MATCH>   Matches;
+    std::vector<TEST_SEARCH_PATTERNS_MATCH>   ExpectedMatches;
+    const BYTE                                Masks[] = {0xff, 0xff, 0xff, 0xf0, 0x0f, 0x00};
+
+    for (UINT32 Iteration = 0; Iteration < TEST_SEARCH_PATTERNS_RANDOM_SEARCHES && Result; Iteration++)
+    {
+        UINT32 NumberOfPages = 1 + (UINT32)(UnitTestGetRandom(&RandomState) % 6);
+
+        TestSearchPatternsRandomImage(&Image, NumberOfPages, Iteration % 2 ? 4 : 2, &RandomState);
+
+        RtlZeroMemory(&Request, sizeof(Request));
+
+        Request.MemoryType               = (UnitTestGetRandom(&RandomState) % 2) ? SEARCH_VIRTUAL_MEMORY : SEARCH_PHYSICAL_MEMORY;
+        Request.NumberOfPatterns         = 1 + (UINT32)(UnitTestGetRandom(&RandomState) % MaximumSearchPatterns);
+        Request.MaximumResultsPerPattern = (UnitTestGetRandom(&RandomState) % 2) ? 0 : 1 + (UINT32)(UnitTestGetRandom(&RandomState) % 200);
+
+        for (UINT32 i = 0; i < Request.NumberOfPatterns; i++)
+        {
+            PDEBUGGER_SEARCH_PATTERN Pattern = &Request.Patterns[i];
+
+            Pattern->Length = 1 + (UINT32)(UnitTestGetRandom(&RandomState) % ((UnitTestGetRandom(&RandomState) % 4) ? 6 : MaximumSearchPatternLength));
+
+            for (UINT32 j = 0; j < Pattern->Length; j++)
+            {
+                Pattern->Bytes[j] = (BYTE)(UnitTestGetRandom(&RandomState) % 4);
+                Pattern->Masks[j] = Masks[UnitTestGetRandom(&RandomState) % sizeof(Masks)];
+            }
+        }
+
+        //
+        // The ranges might overlap, cross the pages that are not valid and
+        // end after the image
+        //
+        Request.NumberOfRanges = 1 + (UINT32)(UnitTestGetRandom(&RandomState) % 4);
+
+        for (UINT32 i = 0; i < Request.NumberOfRanges; i++)
+        {
+            UINT64 Offset = UnitTestGetRandom(&RandomState) % Image.Bytes.size();
+
+            Request.Ranges[i].Address = TEST_SEARCH_PATTERNS_BASE_ADDRESS + Offset;
+            Request.Ranges[i].Length  = 1 + UnitTestGetRandom(&RandomState) % (Image.Bytes.size() - Offset + 0x100);
+        }
+
+        ExpectedMatches = TestSearchPatternsSearchNaive(&Request, &Image);
+
+        UnitTestExpect(Result, TestSearchPatternsSearch(&Request, &Automaton, &Image, Matches, &NumberOfFullResults));
+
+        TestSearchPatternsSort(&Request, Matches);
+        TestSearchPatternsSort(&Request, ExpectedMatches);
+
+        UnitTestExpect(Result, Matches == ExpectedMatches);
+
+        TotalFullResults += NumberOfFullResults;
+
+        if (!Result)
+        {
+            ShowMessages("\t[x] search %u: %llu results, %llu expected\n",
+                         Iteration,
+                         (UINT64)Matches.size(),
+                         (UINT64)ExpectedMatches.size());
+        }
+    }
+
+    //
+    // The buffer of the results should be full (and continued) in some of
+    // the searches
+    //
+    UnitTestExpect(Result, TotalFullResults != 0);
+
+    return Result;
+}
+
+/**
+ * @brief Test the wildcards, the matches that cross the pages and the
+ * pages that are not valid
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestSearchPatternsPages()
+{
+    static SEARCH_MULTIPLE_PATTERNS_AUTOMATON Automaton;
+    BOOLEAN                                   Result = TRUE;
+    UINT32                                    NumberOfFullResults;
+    TEST_SEARCH_PATTERNS_IMAGE                Image;
+    DEBUGGER_SEARCH_MULTIPLE_PATTERNS         Request = {0};
+    std::vector<TEST_SEARCH_PATTERNS_MATCH>   Matches;
+    const BYTE                                Code[] = {0x48, 0x89, 0x5c, 0x24, 0x08};
+
+    Image.Bytes.assign(3 * PAGE_SIZE, 0x90);
+    Image.IsPageValid.assign(3, TRUE);
+
+    //
+    // "48895c2408" at the end of the first page (crossing the second page) and
+    // at the end of the second page (crossing the third page that is not valid,
+    // so it's not matched)
+    //
+    memcpy(&Image.Bytes[PAGE_SIZE - 2], Code, sizeof(Code));
+    memcpy(&Image.Bytes[2 * PAGE_SIZE - 2], Code, sizeof(Code));
+    Image.IsPageValid[2] = FALSE;
+
+    Request.MemoryType       = SEARCH_VIRTUAL_MEMORY;
+    Request.NumberOfPatterns = 2;
+    Request.NumberOfRanges   = 1;
+    Request.Ranges[0]        = {TEST_SEARCH_PATTERNS_BASE_ADDRESS, Image.Bytes.size()};
+
+    UnitTestExpect(Result, hyperdbg_u_test_search_convert_pattern("4889??24", &Request.Patterns[0]));
+    UnitTestExpect(Result, hyperdbg_u_test_search_convert_pattern("0x?c24", &Request.Patterns[1]));
+
+    UnitTestExpect(Result, Request.Patterns[0].Length == 4 && Request.Patterns[0].Masks[2] == 0);
+    UnitTestExpect(Result, Request.Patterns[1].Length == 2 && Request.Patterns[1].Masks[0] == 0x0f);
+
+    UnitTestExpect(Result, TestSearchPatternsSearch(&Request, &Automaton, &Image, Matches, &NumberOfFullResults));
+
+    TestSearchPatternsSort(&Request, Matches);
+
+    UnitTestExpect(Result, Matches.size() == 2);
+    UnitTestExpect(Result, Matches.size() != 2 || Matches[0] == TEST_SEARCH_PATTERNS_MATCH(TEST_SEARCH_PATTERNS_BASE_ADDRESS + PAGE_SIZE - 2, 0));
+    UnitTestExpect(Result, Matches.size() != 2 || Matches[1] == TEST_SEARCH_PATTERNS_MATCH(TEST_SEARCH_PATTERNS_BASE_ADDRESS + PAGE_SIZE, 1));
+
+    //
+    // Only the first match of each pattern
+    //
+    Request.MaximumResultsPerPattern = 1;
+
+    UnitTestExpect(Result, TestSearchPatternsSearch(&Request, &Automaton, &Image, Matches, &NumberOfFullResults));
+    UnitTestExpect(Result, Matches.size() == 2 && Automaton.NumberOfSaturatedPatterns == 2);
+
+    return Result;
+}
+
+/**
+ * @brief Test the requests that are not valid
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestSearchPatternsInvalidRequests()
+{
+    static SEARCH_MULTIPLE_PATTERNS_AUTOMATON Automaton;
+    BOOLEAN                                   Result  = TRUE;
+    DEBUGGER_SEARCH_MULTIPLE_PATTERNS         Request = {0};
+    DEBUGGER_SEARCH_PATTERN                   Pattern;
+
+    Request.MemoryType           = SEARCH_VIRTUAL_MEMORY;
+    Request.NumberOfPatterns     = 1;
+    Request.NumberOfRanges       = 1;
+    Request.Ranges[0]            = {TEST_SEARCH_PATTERNS_BASE_ADDRESS, PAGE_SIZE};
+    Request.Patterns[0].Length   = 1;
+    Request.Patterns[0].Masks[0] = 0xff;
+
+    UnitTestExpect(Result, SearchMultiplePatternsCompile(&Request, &Automaton));
+
+    Request.Patterns[0].Length = 0;
+    UnitTestExpect(Result, !SearchMultiplePatternsCompile(&Request, &Automaton));
+
+    Request.Patterns[0].Length = MaximumSearchPatternLength + 1;
+    UnitTestExpect(Result, !SearchMultiplePatternsCompile(&Request, &Automaton));
+
+    Request.Patterns[0].Length = 1;
+    Request.NumberOfPatterns   = MaximumSearchPatterns + 1;
+    UnitTestExpect(Result, !SearchMultiplePatternsCompile(&Request, &Automaton));
+
+    Request.NumberOfPatterns = 1;
+    Request.Ranges[0]        = {~0ull - 2, 0x10};
+    UnitTestExpect(Result, !SearchMultiplePatternsCompile(&Request, &Automaton));
+
+    Request.Ranges[0] = {TEST_SEARCH_PATTERNS_BASE_ADDRESS, 0};
+    UnitTestExpect(Result, !SearchMultiplePatternsCompile(&Request, &Automaton));
+
+    //
+    // The patterns (strings) that are not valid
+    //
+    UnitTestExpect(Result, !hyperdbg_u_test_search_convert_pattern("", &Pattern));
+    UnitTestExpect(Result, !hyperdbg_u_test_search_convert_pattern("489", &Pattern));
+    UnitTestExpect(Result, !hyperdbg_u_test_search_convert_pattern("48g9", &Pattern));
+    UnitTestExpect(Result, !hyperdbg_u_test_search_convert_pattern(std::string(2 * (MaximumSearchPatternLength + 1), 'c').c_str(), &Pattern));
+
+    return Result;
+}
+
+/**
+ * @brief Tests of the multi-pattern search
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+TestSearchPatterns()
+{
+    BOOLEAN Result = TRUE;
+
+    UnitTestExpect(Result, TestSearchPatternsInvalidRequests());
+    UnitTestExpect(Result, TestSearchPatternsPages());
+    UnitTestExpect(Result, TestSearchPatternsRandomized());
+
+    return Result;
+}
+
+/**
+ * @brief Scaling benchmark of the multi-pattern search
+ * @details one search of N patterns compared with N searches of one
+ * pattern on the same image (random bytes)
+ *
+ * @return VOID
+ */
+VOID
+BenchmarkSearchPatterns()
+{
+    static SEARCH_MULTIPLE_PATTERNS_AUTOMATON Automaton;
+    UINT64                                    RandomState = 0x0123456789abcdef;
+    UINT32                                    NumberOfFullResults;
+    TEST_SEARCH_PATTERNS_IMAGE                Image;
+    DEBUGGER_SEARCH_MULTIPLE_PATTERNS         Request    = {0};
+    DEBUGGER_SEARCH_MULTIPLE_PATTERNS         OneRequest = {0};
+    std::vector<TEST_SEARCH_PATTERNS_MATCH>   Matches;
+    UINT64                                    StartTime;
+    CHAR                                      Name[64];
+
+    TestSearchPatternsRandomImage(&Image,
+                                  TEST_SEARCH_PATTERNS_BENCHMARK_IMAGE_SIZE / PAGE_SIZE,
+                                  256,
+                                  &RandomState);
+
+    Image.IsPageValid.assign(Image.IsPageValid.size(), TRUE);
+
+    Request.MemoryType     = SEARCH_VIRTUAL_MEMORY;
+    Request.NumberOfRanges = 1;
+    Request.Ranges[0]      = {TEST_SEARCH_PATTERNS_BASE_ADDRESS, Image.Bytes.size()};
+
+    for (UINT32 i = 0; i < MaximumSearchPatterns; i++)
+    {
+        Request.Patterns[i].Length = TEST_SEARCH_PATTERNS_BENCHMARK_PATTERN_LENGTH;
+
+        for (UINT32 j = 0; j < TEST_SEARCH_PATTERNS_BENCHMARK_PATTERN_LENGTH; j++)
+        {
+            Request.Patterns[i].Bytes[j] = (BYTE)UnitTestGetRandom(&RandomState);
+            Request.Patterns[i].Masks[j] = 0xff;
+        }
+    }
+
+    OneRequest                  = Request;
+    OneRequest.NumberOfPatterns = 1;
+
+    for (UINT32 NumberOfPatterns = 1; NumberOfPatterns <= MaximumSearchPatterns; NumberOfPatterns *= 2)
+    {
+        Request.NumberOfPatterns = NumberOfPatterns;
+
+        StartTime = UnitTestGetTimeInNanoseconds();
+
+        TestSearchPatternsSearch(&Request, &Automaton, &Image, Matches, &NumberOfFullResults);
+
+        sprintf_s(Name, sizeof(Name), "one pass, %u patterns (16 MB)", NumberOfPatterns);
+        UnitTestShowBenchmarkResult(Name, UnitTestGetTimeInNanoseconds() - StartTime, Image.Bytes.size());
+
+        StartTime = UnitTestGetTimeInNanoseconds();
+
+        for (UINT32 i = 0; i < NumberOfPatterns; i++)
+        {
+            OneRequest.Patterns[0] = Request.Patterns[i];
+            TestSearchPatternsSearch(&OneRequest, &Automaton, &Image, Matches, &NumberOfFullResults);
+        }
+
+        sprintf_s(Name, sizeof(Name), "%u passes, one pattern each (16 MB)", NumberOfPatterns);
+        UnitTestShowBenchmarkResult(Name, UnitTestGetTimeInNanoseconds() - StartTime, Image.Bytes.size());
+    }
+}
+
+UnitTestRegister("search-patterns", TestSearchPatterns, BenchmarkSearchPatterns);
@@ -0,0 +1,742 @@
+/**
+ * @file test-sub-page-permissions.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Tests and benchmark of the sub-page permission (SPP) table
+ * @details the table builder (SppTable.c) is shared with hyperhv, the built
+ * tables are walked by a model of the processor's SPPT walk (including the
+ * reserved bits), and the EPT violations of write traces are simulated
+ * with and without the sub-page permissions
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Physical address of the first synthetic level of the SPP tables
+ *
+ */
+#define TEST_SPP_TABLES_PHYSICAL_BASE 0x7f000000
+
+/**
+ * @brief Maximum physical address width of the model
+ *
+ */
+#define TEST_SPP_MAXIMUM_PHYSICAL_ADDRESS_WIDTH 48
+
+/**
+ * @brief Number of the pages of the table test
+ *
+ */
+#define TEST_SPP_NUMBER_OF_PAGES 2000
+
+/**
+ * @brief Size of the watched field of the write traces
+ *
+ */
+#define TEST_SPP_WATCHED_FIELD_SIZE 16
+
+/**
+ * @brief Offset of the watched field of the write traces
+ *
+ */
+#define TEST_SPP_WATCHED_FIELD_OFFSET 0x250
+
+/**
+ * @brief Number of the writes of each trace
+ *
+ */
+#define TEST_SPP_NUMBER_OF_WRITES 200000
+
+/**
+ * @brief The result of walking the SPP table for a page
+ *
+ */
+typedef enum _TEST_SPP_WALK_RESULT
+{
+    TEST_SPP_WALK_RESULT_FOUND,
+    TEST_SPP_WALK_RESULT_MISS,             // a non-leaf entry is not valid
+    TEST_SPP_WALK_RESULT_MISCONFIGURATION, // a reserved bit is set
+
+} TEST_SPP_WALK_RESULT;
+
+/**
+ * @brief The write traces of the simulation
+ *
+ */
+typedef enum _TEST_SPP_TRACE
+{
+    TEST_SPP_TRACE_UNIFORM, // 8-byte writes anywhere in the page
+    TEST_SPP_TRACE_ZIPF,    // Zipf-distributed writes to 64-byte objects
+    TEST_SPP_TRACE_STACK,   // pushes and writes to the locals of a stack
+
+} TEST_SPP_TRACE;
+
+/**
+ * @brief Synthetic physical memory of the levels of the SPP table
+ * @details the level i is at TEST_SPP_TABLES_PHYSICAL_BASE + i * PAGE_SIZE
+ *
+ */
+typedef struct _TEST_SPP_MEMORY
+{
+    std::vector<PSPP_TABLE>      Tables;
+    std::map<PSPP_TABLE, UINT64> PhysicalAddresses;
+    UINT32                       MaximumTables;
+
+} TEST_SPP_MEMORY, *PTEST_SPP_MEMORY;
+
+/**
+ * @brief The exits of a simulated write trace
+ *
+ */
+typedef struct _TEST_SPP_TRACE_RESULT
+{
+    UINT64 Writes;
+    UINT64 PageExits;     // exits with the page granularity (all of the writes)
+    UINT64 SubPageExits;  // exits with the sub-page permissions
+    UINT64 WatchedWrites; // writes to the watched field
+
+} TEST_SPP_TRACE_RESULT, *PTEST_SPP_TRACE_RESULT;
+
+/**
+ * @brief Allocate a level of the SPP table (SPP_TABLE_MEMORY)
+ * @details the table is filled with garbage, the builder should zero it
+ *
+ * @param Context the synthetic memory
+ *
+ * @return PSPP_TABLE
+ */
+static PSPP_TABLE
+TestSppAllocateTable(PVOID Context)
+{
+    PTEST_SPP_MEMORY Memory = (PTEST_SPP_MEMORY)Context;
+    PSPP_TABLE       Table;
+
+    if (Memory->Tables.size() >= Memory->MaximumTables)
+    {
+        return NULL;
+    }
+
+    Table = new SPP_TABLE;
+
+    memset(Table, 0xcc, sizeof(SPP_TABLE));
+
+    Memory->PhysicalAddresses[Table] = TEST_SPP_TABLES_PHYSICAL_BASE + Memory->Tables.size() * PAGE_SIZE;
+    Memory->Tables.push_back(Table);
+
+    return Table;
+}
+
+/**
+ * @brief Get the physical address of a level (SPP_TABLE_MEMORY)
+ *
+ * @param Table
+ * @param Context the synthetic memory
+ *
+ * @return UINT64
+ */
+static UINT64
+TestSppTableToPhysical(PSPP_TABLE Table, PVOID Context)
+{
+    PTEST_SPP_MEMORY Memory = (PTEST_SPP_MEMORY)Context;
+
+    return Memory->PhysicalAddresses.at(Table);
+}
+
+/**
+ * @brief Get the level at a physical address
+ * @details used by both the builder (SPP_TABLE_MEMORY) and the model
+ *
+ * @param Address
+ * @param Context the synthetic memory
+ *
+ * @return PSPP_TABLE NULL if there is no level at the address
+ */
+static PSPP_TABLE
+TestSppPhysicalToTable(UINT64 Address, PVOID Context)
+{
+    PTEST_SPP_MEMORY Memory = (PTEST_SPP_MEMORY)Context;
+    UINT64           Index  = (Address - TEST_SPP_TABLES_PHYSICAL_BASE) / PAGE_SIZE;
+
+    if (Address < TEST_SPP_TABLES_PHYSICAL_BASE || Address % PAGE_SIZE != 0 || Index >= Memory->Tables.size())
+    {
+        return NULL;
+    }
+
+    return Memory->Tables[Index];
+}
+
+/**
+ * @brief Free the levels of the synthetic memory
+ *
+ * @param Memory
+ *
+ * @return VOID
+ */
+static VOID
+TestSppFreeMemory(PTEST_SPP_MEMORY Memory)
+{
+    for (PSPP_TABLE Table : Memory->Tables)
+    {
+        delete Table;
+    }
+
+    Memory->Tables.clear();
+    Memory->PhysicalAddresses.clear();
+}
+
+/**
+ * @brief Walk the SPP table like the processor
+ * @details the table is only read through the physical addresses of its
+ * levels, starting from the SPPTP
+ *
+ * @param Memory
+ * @param SppTablePointer the physical address of the root (SPPL4)
+ * @param PhysicalAddress the guest-physical address of the write
+ * @param WritePermissions the SPPL1 entry of the page (if found)
+ *
+ * @return TEST_SPP_WALK_RESULT
+ */
+static TEST_SPP_WALK_RESULT
+TestSppWalk(PTEST_SPP_MEMORY Memory, UINT64 SppTablePointer, UINT64 PhysicalAddress, UINT64 * WritePermissions)
+{
+    UINT64     ReservedBits = ~((1ull << TEST_SPP_MAXIMUM_PHYSICAL_ADDRESS_WIDTH) - 1) | 0xffe;
+    UINT64     Entry        = 0;
+    PSPP_TABLE Table        = TestSppPhysicalToTable(SppTablePointer, Memory);
+
+    for (UINT32 Level = 4; Level > 1; Level--)
+    {
+        Entry = Table->Entries[(PhysicalAddress >> (12 + (Level - 1) * 9)) & 0x1ff].AsUInt;
+
+        if (!(Entry & 1))
+        {
+            return TEST_SPP_WALK_RESULT_MISS;
+        }
+
+        if (Entry & ReservedBits)
+        {
+            return TEST_SPP_WALK_RESULT_MISCONFIGURATION;
+        }
+
+        Table = TestSppPhysicalToTable(Entry & ~0xfffull, Memory);
+
+        if (Table == NULL)
+        {
+            //
+            // The entry points to a page that is not a level of the table
+            //
+            return TEST_SPP_WALK_RESULT_MISCONFIGURATION;
+        }
+    }
+
+    Entry = Table->Entries[(PhysicalAddress >> 12) & 0x1ff].AsUInt;
+
+    //
+    // The odd bits of the sub-page permission vector are reserved
+    //
+    if (Entry & 0xaaaaaaaaaaaaaaaaull)
+    {
+        return TEST_SPP_WALK_RESULT_MISCONFIGURATION;
+    }
+
+    *WritePermissions = Entry;
+
+    return TEST_SPP_WALK_RESULT_FOUND;
+}
+
+/**
+ * @brief Check whether a write causes an EPT violation on a page with
+ * sub-page permissions
+ *
+ * @param WritePermissions the SPPL1 entry of the page
+ * @param Offset offset of the write in the page
+ * @param Size size of the write
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestSppIsWriteBlocked(UINT64 WritePermissions, UINT32 Offset, UINT32 Size)
+{
+    //
+    // Each of the sub-pages that are written should be writable
+    //
+    for (UINT32 i = Offset / SPP_SUB_PAGE_SIZE; i <= (Offset + Size - 1) / SPP_SUB_PAGE_SIZE; i++)
+    {
+        if (!((WritePermissions >> (i * 2)) & 1))
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/**
+ * @brief Get a random range around a page, the ends are often close to
+ * the boundaries of the sub-pages
+ *
+ * @param RandomState
+ * @param PhysicalBaseAddress
+ * @param Start
+ * @param End inclusive
+ *
+ * @return VOID
+ */
+static VOID
+TestSppGetRandomRange(UINT64 * RandomState, UINT64 PhysicalBaseAddress, UINT64 * Start, UINT64 * End)
+{
+    INT64 StartOffset;
+    INT64 EndOffset;
+
+    if (UnitTestGetRandom(RandomState) % 2 == 0)
+    {
+        StartOffset = (INT64)(UnitTestGetRandom(RandomState) % (SPP_SUB_PAGES_COUNT + 2)) * SPP_SUB_PAGE_SIZE - SPP_SUB_PAGE_SIZE + (INT64)(UnitTestGetRandom(RandomState) % 3) - 1;
+        EndOffset   = StartOffset + (INT64)(UnitTestGetRandom(RandomState) % 4) * SPP_SUB_PAGE_SIZE + (INT64)(UnitTestGetRandom(RandomState) % 3) - 1;
+    }
+    else
+    {
+        StartOffset = (INT64)(UnitTestGetRandom(RandomState) % (PAGE_SIZE + 256)) - 128;
+        EndOffset   = StartOffset + (INT64)(UnitTestGetRandom(RandomState) % (UnitTestGetRandom(RandomState) % 2 == 0 ? 32 : PAGE_SIZE));
+    }
+
+    if (EndOffset < StartOffset)
+    {
+        EndOffset = StartOffset;
+    }
+
+    *Start = PhysicalBaseAddress + StartOffset;
+    *End   = PhysicalBaseAddress + EndOffset;
+}
+
+/**
+ * @brief Test the sub-page permission vectors of the monitored ranges
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestSppWritePermissions()
+{
+    BOOLEAN Result              = TRUE;
+    UINT64  RandomState         = 0x5370705065726dull;
+    UINT64  PhysicalBaseAddress = 0x12345000;
+    UINT64  WritePermissions;
+    UINT64  Start;
+    UINT64  End;
+    BOOLEAN IsMonitored;
+
+    for (UINT32 i = 0; Result && i < 20000; i++)
+    {
+        TestSppGetRandomRange(&RandomState, PhysicalBaseAddress, &Start, &End);
+
+        WritePermissions = SppComputeWritePermissions(PhysicalBaseAddress, Start, End);
+
+        UnitTestExpect(Result, (WritePermissions & 0xaaaaaaaaaaaaaaaaull) == 0);
+
+        //
+        // A sub-page is write-protected if any of its bytes is monitored
+        //
+        for (UINT32 SubPage = 0; SubPage < SPP_SUB_PAGES_COUNT; SubPage++)
+        {
+            IsMonitored = FALSE;
+
+            for (UINT32 Byte = 0; Byte < SPP_SUB_PAGE_SIZE; Byte++)
+            {
+                IsMonitored |= PhysicalBaseAddress + SubPage * SPP_SUB_PAGE_SIZE + Byte >= Start &&
+                               PhysicalBaseAddress + SubPage * SPP_SUB_PAGE_SIZE + Byte <= End;
+            }
+
+            UnitTestExpect(Result, ((WritePermissions >> (SubPage * 2)) & 1) == !IsMonitored);
+        }
+
+        if (!Result)
+        {
+            ShowMessages("\t[x] wrong permissions for the range 0x%llx-0x%llx\n", Start, End);
+        }
+    }
+
+    UnitTestExpect(Result, SppComputeWritePermissions(PhysicalBaseAddress, PhysicalBaseAddress, PhysicalBaseAddress + PAGE_SIZE - 1) == 0);
+    UnitTestExpect(Result, SppComputeWritePermissions(PhysicalBaseAddress, PhysicalBaseAddress + PAGE_SIZE, PhysicalBaseAddress + 2 * PAGE_SIZE) == 0x5555555555555555ull);
+
+    return Result;
+}
+
+/**
+ * @brief Get the physical address of a random page, most pages are close
+ * to each other (and share the levels of the table)
+ *
+ * @param RandomState
+ *
+ * @return UINT64
+ */
+static UINT64
+TestSppGetRandomPage(UINT64 * RandomState)
+{
+    static const UINT64 Clusters[] = {0x1000000, 0x3fe00000, 0x7fffe00000, 0x80000000};
+
+    switch (UnitTestGetRandom(RandomState) % 4)
+    {
+    case 0:
+
+        //
+        // Anywhere in the physical address space
+        //
+        return (UnitTestGetRandom(RandomState) % (1ull << TEST_SPP_MAXIMUM_PHYSICAL_ADDRESS_WIDTH)) & ~0xfffull;
+
+    default:
+
+        //
+        // Around the boundaries of the levels
+        //
+        return Clusters[UnitTestGetRandom(RandomState) % 4] + (UnitTestGetRandom(RandomState) % 1024) * PAGE_SIZE;
+    }
+}
+
+/**
+ * @brief Test building the SPP table against the model of the walk
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestSppTable()
+{
+    BOOLEAN                    Result      = TRUE;
+    UINT64                     RandomState = 0x53707054626cull;
+    TEST_SPP_MEMORY            Memory;
+    SPP_TABLE_MEMORY           Routines = {TestSppAllocateTable, TestSppTableToPhysical, TestSppPhysicalToTable, &Memory};
+    std::map<UINT64, UINT64>   Expected;
+    std::unordered_set<UINT64> Levels[3];
+    PSPP_TABLE                 Root;
+    UINT64                     PhysicalBaseAddress;
+    UINT64                     WritePermissions;
+    UINT64                     Start;
+    UINT64                     End;
+
+    Memory.MaximumTables = 0xffffffff;
+
+    //
+    // The root is allocated by the caller (zeroed)
+    //
+    Root = TestSppAllocateTable(&Memory);
+    RtlZeroMemory(Root, sizeof(SPP_TABLE));
+
+    for (UINT32 i = 0; Result && i < TEST_SPP_NUMBER_OF_PAGES; i++)
+    {
+        PhysicalBaseAddress = TestSppGetRandomPage(&RandomState);
+
+        TestSppGetRandomRange(&RandomState, PhysicalBaseAddress, &Start, &End);
+
+        WritePermissions = SppComputeWritePermissions(PhysicalBaseAddress, Start, End);
+
+        UnitTestExpect(Result, SppTableSetWritePermissions(Root, PhysicalBaseAddress, WritePermissions, &Routines));
+
+        Expected[PhysicalBaseAddress] = WritePermissions;
+
+        Levels[0].insert(PhysicalBaseAddress >> 39);
+        Levels[1].insert(PhysicalBaseAddress >> 30);
+        Levels[2].insert(PhysicalBaseAddress >> 21);
+    }
+
+    //
+    // Each page (and only the pages of the same SPPL1 table) should be found
+    //
+    for (const auto & Page : Expected)
+    {
+        UnitTestExpect(Result, TestSppWalk(&Memory, TEST_SPP_TABLES_PHYSICAL_BASE, Page.first + 0x7f8, &WritePermissions) == TEST_SPP_WALK_RESULT_FOUND);
+        UnitTestExpect(Result, WritePermissions == Page.second);
+
+        if (Expected.count(Page.first + PAGE_SIZE) == 0 && ((Page.first + PAGE_SIZE) >> 21) == (Page.first >> 21))
+        {
+            UnitTestExpect(Result, TestSppWalk(&Memory, TEST_SPP_TABLES_PHYSICAL_BASE, Page.first + PAGE_SIZE, &WritePermissions) == TEST_SPP_WALK_RESULT_FOUND);
+            UnitTestExpect(Result, WritePermissions == 0);
+        }
+
+        if (!Result)
+        {
+            ShowMessages("\t[x] the SPP table of the page 0x%llx differs from the model\n", Page.first);
+            break;
+        }
+    }
+
+    UnitTestExpect(Result, TestSppWalk(&Memory, TEST_SPP_TABLES_PHYSICAL_BASE, 0xfffffffff000, &WritePermissions) == TEST_SPP_WALK_RESULT_MISS);
+
+    //
+    // A level is only built once for each of the regions
+    //
+    UnitTestExpect(Result, Memory.Tables.size() == 1 + Levels[0].size() + Levels[1].size() + Levels[2].size());
+
+    TestSppFreeMemory(&Memory);
+
+    return Result;
+}
+
+/**
+ * @brief Test building the SPP table when no table is left
+ * @details the pages that are already in the table are not affected,
+ * and no entry points to a level that is not built
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestSppTableExhaustion()
+{
+    BOOLEAN          Result = TRUE;
+    TEST_SPP_MEMORY  Memory;
+    SPP_TABLE_MEMORY Routines = {TestSppAllocateTable, TestSppTableToPhysical, TestSppPhysicalToTable, &Memory};
+    PSPP_TABLE       Root;
+    UINT64           WritePermissions;
+
+    //
+    // The root and a single path
+    //
+    Memory.MaximumTables = 4;
+
+    Root = TestSppAllocateTable(&Memory);
+    RtlZeroMemory(Root, sizeof(SPP_TABLE));
+
+    UnitTestExpect(Result, SppTableSetWritePermissions(Root, 0x1000000, 0x5555555555555550ull, &Routines));
+    UnitTestExpect(Result, SppTableSetWritePermissions(Root, 0x1001000, 0x5555555555555505ull, &Routines));
+
+    //
+    // Another 512-GByte region (no level is left) and another 1-GByte region
+    // (only the SPPL1 table is missing)
+    //
+    UnitTestExpect(Result, !SppTableSetWritePermissions(Root, 0x8000000000, 0x5555555555555550ull, &Routines));
+
+    Memory.MaximumTables = 5;
+
+    UnitTestExpect(Result, !SppTableSetWritePermissions(Root, 0x40000000, 0x5555555555555550ull, &Routines));
+
+    UnitTestExpect(Result, TestSppWalk(&Memory, TEST_SPP_TABLES_PHYSICAL_BASE, 0x1000000, &WritePermissions) == TEST_SPP_WALK_RESULT_FOUND && WritePermissions == 0x5555555555555550ull);
+    UnitTestExpect(Result, TestSppWalk(&Memory, TEST_SPP_TABLES_PHYSICAL_BASE, 0x1001000, &WritePermissions) == TEST_SPP_WALK_RESULT_FOUND && WritePermissions == 0x5555555555555505ull);
+    UnitTestExpect(Result, TestSppWalk(&Memory, TEST_SPP_TABLES_PHYSICAL_BASE, 0x8000000000, &WritePermissions) == TEST_SPP_WALK_RESULT_MISS);
+    UnitTestExpect(Result, TestSppWalk(&Memory, TEST_SPP_TABLES_PHYSICAL_BASE, 0x40000000, &WritePermissions) == TEST_SPP_WALK_RESULT_MISS);
+
+    TestSppFreeMemory(&Memory);
+
+    return Result;
+}
+
+/**
+ * @brief Simulate the EPT violations of a write trace on a page with a
+ * watched field (a write-only monitor)
+ *
+ * @param Trace
+ * @param TraceResult
+ *
+ * @return BOOLEAN FALSE if a write to the watched field doesn't cause an exit
+ */
+static BOOLEAN
+TestSppSimulateTrace(TEST_SPP_TRACE Trace, PTEST_SPP_TRACE_RESULT TraceResult)
+{
+    BOOLEAN          Result              = TRUE;
+    UINT64           RandomState         = 0x5472616365ull + Trace;
+    UINT64           PhysicalBaseAddress = 0x23456000;
+    TEST_SPP_MEMORY  Memory;
+    SPP_TABLE_MEMORY Routines = {TestSppAllocateTable, TestSppTableToPhysical, TestSppPhysicalToTable, &Memory};
+    PSPP_TABLE       Root;
+    UINT64           WritePermissions;
+    double           ZipfWeights[PAGE_SIZE / 64];
+    double           ZipfSum     = 0;
+    UINT32           StackOffset = PAGE_SIZE;
+    UINT32           Offset;
+    BOOLEAN          IsWatched;
+    double           Random;
+
+    memset(TraceResult, 0, sizeof(TEST_SPP_TRACE_RESULT));
+
+    Memory.MaximumTables = 0xffffffff;
+
+    Root = TestSppAllocateTable(&Memory);
+    RtlZeroMemory(Root, sizeof(SPP_TABLE));
+
+    SppTableSetWritePermissions(Root,
+                                PhysicalBaseAddress,
+                                SppComputeWritePermissions(PhysicalBaseAddress,
+                                                           PhysicalBaseAddress + TEST_SPP_WATCHED_FIELD_OFFSET,
+                                                           PhysicalBaseAddress + TEST_SPP_WATCHED_FIELD_OFFSET + TEST_SPP_WATCHED_FIELD_SIZE - 1),
+                                &Routines);
+
+    //
+    // The object i is written with the probability of 1/(i+1)
+    //
+    for (UINT32 i = 0; i < PAGE_SIZE / 64; i++)
+    {
+        ZipfSum += 1.0 / (i + 1);
+        ZipfWeights[i] = ZipfSum;
+    }
+
+    for (UINT32 i = 0; i < TEST_SPP_NUMBER_OF_WRITES; i++)
+    {
+        switch (Trace)
+        {
+        case TEST_SPP_TRACE_UNIFORM:
+            Offset = (UINT32)(UnitTestGetRandom(&RandomState) % (PAGE_SIZE / 8)) * 8;
+            break;
+
+        case TEST_SPP_TRACE_ZIPF:
+
+            Random = (double)(UnitTestGetRandom(&RandomState) >> 11) / (double)(1ull << 53) * ZipfSum;
+            Offset = (UINT32)(std::lower_bound(ZipfWeights, ZipfWeights + PAGE_SIZE / 64 - 1, Random) - ZipfWeights);
+            Offset = Offset * 64 + (UINT32)(UnitTestGetRandom(&RandomState) % 8) * 8;
+            break;
+
+        default:
+
+            //
+            // Push or write a local (up to 1 KB of the stack, at the end of the page)
+            //
+            if (UnitTestGetRandom(&RandomState) % 2 == 0 && StackOffset > PAGE_SIZE - 1024)
+            {
+                StackOffset -= 8;
+                Offset = StackOffset;
+            }
+            else
+            {
+                if (StackOffset < PAGE_SIZE && UnitTestGetRandom(&RandomState) % 2 == 0)
+                {
+                    StackOffset += 8;
+                }
+
+                Offset = StackOffset + (UINT32)(UnitTestGetRandom(&RandomState) % 8) * 8;
+
+                if (Offset >= PAGE_SIZE)
+                {
+                    Offset = PAGE_SIZE - 8;
+                }
+            }
+
+            break;
+        }
+
+        IsWatched = Offset < TEST_SPP_WATCHED_FIELD_OFFSET + TEST_SPP_WATCHED_FIELD_SIZE && Offset + 8 > TEST_SPP_WATCHED_FIELD_OFFSET;
+
+        TraceResult->Writes++;
+        TraceResult->PageExits++;
+        TraceResult->WatchedWrites += IsWatched ? 1 : 0;
+
+        UnitTestExpect(Result, TestSppWalk(&Memory, TEST_SPP_TABLES_PHYSICAL_BASE, PhysicalBaseAddress + Offset, &WritePermissions) == TEST_SPP_WALK_RESULT_FOUND);
+
+        if (TestSppIsWriteBlocked(WritePermissions, Offset, 8))
+        {
+            TraceResult->SubPageExits++;
+        }
+        else
+        {
+            //
+            // The writes to the watched field should never be missed
+            //
+            UnitTestExpect(Result, !IsWatched);
+        }
+    }
+
+    TestSppFreeMemory(&Memory);
+
+    return Result;
+}
+
+/**
+ * @brief Test the simulated exits of the write traces
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestSppTraces()
+{
+    BOOLEAN               Result = TRUE;
+    TEST_SPP_TRACE_RESULT TraceResult;
+
+    for (UINT32 Trace = TEST_SPP_TRACE_UNIFORM; Trace <= TEST_SPP_TRACE_STACK; Trace++)
+    {
+        UnitTestExpect(Result, TestSppSimulateTrace((TEST_SPP_TRACE)Trace, &TraceResult));
+        UnitTestExpect(Result, TraceResult.SubPageExits >= TraceResult.WatchedWrites);
+
+        //
+        // A single sub-page is write-protected, so most of the exits are avoided
+        //
+        UnitTestExpect(Result, TraceResult.SubPageExits * 10 < TraceResult.PageExits);
+    }
+
+    return Result;
+}
+
+/**
+ * @brief Tests of the sub-page permission (SPP) table
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+TestSubPagePermissions()
+{
+    BOOLEAN Result = TRUE;
+
+    UnitTestExpect(Result, TestSppWritePermissions());
+    UnitTestExpect(Result, TestSppTable());
+    UnitTestExpect(Result, TestSppTableExhaustion());
+    UnitTestExpect(Result, TestSppTraces());
+
+    return Result;
+}
+
+/**
+ * @brief Benchmark of the sub-page permission (SPP) table
+ * @details building the table for the monitored pages, and the exits
+ * that are avoided in the simulated write traces
+ *
+ * @return VOID
+ */
+VOID
+BenchmarkSubPagePermissions()
+{
+    static const CHAR *   TraceNames[] = {"uniform 8-byte writes", "Zipf writes to 64-byte objects", "stack writes"};
+    UINT64                RandomState  = 0x53707042656eull;
+    TEST_SPP_MEMORY       Memory;
+    SPP_TABLE_MEMORY      Routines = {TestSppAllocateTable, TestSppTableToPhysical, TestSppPhysicalToTable, &Memory};
+    std::vector<UINT64>   Pages(TEST_SPP_NUMBER_OF_PAGES);
+    TEST_SPP_TRACE_RESULT TraceResult;
+    PSPP_TABLE            Root;
+    UINT64                StartTime;
+
+    Memory.MaximumTables = 0xffffffff;
+
+    Root = TestSppAllocateTable(&Memory);
+    RtlZeroMemory(Root, sizeof(SPP_TABLE));
+
+    for (UINT32 i = 0; i < TEST_SPP_NUMBER_OF_PAGES; i++)
+    {
+        Pages[i] = TestSppGetRandomPage(&RandomState);
+    }
+
+    StartTime = UnitTestGetTimeInNanoseconds();
+
+    for (UINT32 i = 0; i < TEST_SPP_NUMBER_OF_PAGES; i++)
+    {
+        SppTableSetWritePermissions(Root,
+                                    Pages[i],
+                                    SppComputeWritePermissions(Pages[i], Pages[i] + 0x100, Pages[i] + 0x10f),
+                                    &Routines);
+    }
+
+    UnitTestShowBenchmarkResult("compute and set the permissions of a page",
+                                UnitTestGetTimeInNanoseconds() - StartTime,
+                                TEST_SPP_NUMBER_OF_PAGES);
+
+    ShowMessages("\t%d levels for %d pages\n", (UINT32)Memory.Tables.size(), TEST_SPP_NUMBER_OF_PAGES);
+
+    TestSppFreeMemory(&Memory);
+
+    for (UINT32 Trace = TEST_SPP_TRACE_UNIFORM; Trace <= TEST_SPP_TRACE_STACK; Trace++)
+    {
+        TestSppSimulateTrace((TEST_SPP_TRACE)Trace, &TraceResult);
+
+        ShowMessages("\t%-32s %lld writes, %lld exits (page), %lld exits (sub-page), %.1f%% avoided\n",
+                     TraceNames[Trace],
+                     TraceResult.Writes,
+                     TraceResult.PageExits,
+                     TraceResult.SubPageExits,
+                     100.0 * (TraceResult.PageExits - TraceResult.SubPageExits) / TraceResult.PageExits);
+    }
+}
+
+UnitTestRegister("sub-page-permissions", TestSubPagePermissions, BenchmarkSubPagePermissions);
@@ -0,0 +1,427 @@
+/**
+ * @file test-symbol-download.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Tests and benchmark of downloading the pdb files in parallel
+ * @details the pdb files are "downloaded" by a stub that waits instead of
+ * connecting to the symbol server, so the tests don't need the network
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Number of modules of the tests
+ *
+ */
+#define TEST_SYMBOL_DOWNLOAD_NUMBER_OF_MODULES 24
+
+/**
+ * @brief Number of modules of the benchmark
+ *
+ */
+#define TEST_SYMBOL_DOWNLOAD_BENCHMARK_MODULES 40
+
+/**
+ * @brief Time (in milliseconds) of each download of the benchmark
+ *
+ */
+#define TEST_SYMBOL_DOWNLOAD_BENCHMARK_DELAY 20
+
+/**
+ * @brief Maximum number of the download workers of the symbol parser
+ *
+ */
+#define TEST_SYMBOL_DOWNLOAD_MAXIMUM_WORKERS 8
+
+/**
+ * @brief Server of the test symbol path
+ *
+ */
+#define TEST_SYMBOL_DOWNLOAD_SERVER "https://symbols.test"
+
+/**
+ * @brief Guid and age of the test modules
+ *
+ */
+#define TEST_SYMBOL_DOWNLOAD_GUID "0123456789ABCDEF0123456789ABCDEF1"
+
+/**
+ * @brief State of the stub downloads
+ *
+ */
+typedef struct _TEST_SYMBOL_DOWNLOAD_STATE
+{
+    volatile LONG NumberOfCalls[TEST_SYMBOL_DOWNLOAD_BENCHMARK_MODULES];
+    volatile LONG TotalCalls;
+    volatile LONG RunningDownloads;
+    volatile LONG MaximumRunningDownloads;
+    volatile LONG NumberOfInvalidRequests;
+    UINT32        NumberOfModules;
+    UINT32        Delay;
+    LONG          AbortAfterCalls;
+    std::string   SymbolDirectory;
+
+} TEST_SYMBOL_DOWNLOAD_STATE, *PTEST_SYMBOL_DOWNLOAD_STATE;
+
+/**
+ * @brief State of the stub downloads
+ *
+ */
+static TEST_SYMBOL_DOWNLOAD_STATE TestSymbolDownloadState;
+
+/**
+ * @brief The captured messages
+ *
+ */
+static std::string TestSymbolDownloadOutput;
+
+/**
+ * @brief Get the pdb name of a test module
+ *
+ * @param Index
+ *
+ * @return std::string
+ */
+static std::string
+TestSymbolDownloadGetPdbName(UINT32 Index)
+{
+    CHAR Name[32] = {0};
+
+    sprintf_s(Name, sizeof(Name), "hdtest%02u.pdb", Index);
+
+    return Name;
+}
+
+/**
+ * @brief Check whether a test module fails to download
+ *
+ * @param Index
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestSymbolDownloadIsFailedModule(UINT32 Index)
+{
+    return Index % 7 == 3;
+}
+
+/**
+ * @brief Capture the messages (instead of showing them)
+ *
+ * @param Text
+ *
+ * @return int
+ */
+static int
+TestSymbolDownloadCaptureMessage(const char * Text)
+{
+    TestSymbolDownloadOutput += Text;
+    return 0;
+}
+
+/**
+ * @brief The stub of downloading a pdb file
+ * @details later modules are downloaded faster, so the downloads are
+ * finished in the reverse order of the modules
+ *
+ * @param Url
+ * @param FilePath
+ *
+ * @return UINT32
+ */
+static UINT32
+TestSymbolDownloadStub(const char * Url, const char * FilePath)
+{
+    PTEST_SYMBOL_DOWNLOAD_STATE State = &TestSymbolDownloadState;
+    UINT32                      Index;
+    LONG                        Running;
+    LONG                        Maximum;
+    std::string                 PdbName;
+
+    if (sscanf_s(Url, TEST_SYMBOL_DOWNLOAD_SERVER "/hdtest%02u.pdb/", &Index) != 1 || Index >= State->NumberOfModules)
+    {
+        InterlockedIncrement(&State->NumberOfInvalidRequests);
+        return (UINT32)E_INVALIDARG;
+    }
+
+    //
+    // The request should have the name, the guid and the symbol directory
+    //
+    PdbName = TestSymbolDownloadGetPdbName(Index);
+
+    if (std::string(Url) != std::string(TEST_SYMBOL_DOWNLOAD_SERVER "/") + PdbName + "/" TEST_SYMBOL_DOWNLOAD_GUID "/" + PdbName ||
+        std::string(FilePath).find(State->SymbolDirectory + "\\" + PdbName + "\\" TEST_SYMBOL_DOWNLOAD_GUID "\\") != 0)
+    {
+        InterlockedIncrement(&State->NumberOfInvalidRequests);
+    }
+
+    InterlockedIncrement(&State->NumberOfCalls[Index]);
+
+    if (InterlockedIncrement(&State->TotalCalls) == State->AbortAfterCalls)
+    {
+        ScriptEngineSymbolAbortLoading();
+    }
+
+    Running = InterlockedIncrement(&State->RunningDownloads);
+
+    do
+    {
+        Maximum = State->MaximumRunningDownloads;
+    } while (Running > Maximum && InterlockedCompareExchange(&State->MaximumRunningDownloads, Running, Maximum) != Maximum);
+
+    Sleep(State->Delay != 0 ? State->Delay : (State->NumberOfModules - Index) * 2);
+
+    InterlockedDecrement(&State->RunningDownloads);
+
+    //
+    // The pdb files are not created, so they're not loaded after the download
+    //
+    return TestSymbolDownloadIsFailedModule(Index) ? (UINT32)E_FAIL : (UINT32)S_OK;
+}
+
+/**
+ * @brief Reload the symbols of the test modules with the stub downloads
+ *
+ * @param NumberOfModules
+ * @param MaximumWorkers
+ * @param AbortAfterCalls Number of downloads before aborting (zero to not abort)
+ * @param Delay Time of each download (zero for a different time for each module)
+ *
+ * @return BOOLEAN the result of SymbolInitLoad
+ */
+static BOOLEAN
+TestSymbolDownloadReload(UINT32 NumberOfModules, UINT32 MaximumWorkers, LONG AbortAfterCalls, UINT32 Delay)
+{
+    PTEST_SYMBOL_DOWNLOAD_STATE       State = &TestSymbolDownloadState;
+    std::vector<MODULE_SYMBOL_DETAIL> Modules(NumberOfModules);
+    std::string                       SymbolPath;
+    BOOLEAN                           Result;
+
+    for (UINT32 i = 0; i < TEST_SYMBOL_DOWNLOAD_BENCHMARK_MODULES; i++)
+    {
+        State->NumberOfCalls[i] = 0;
+    }
+
+    State->TotalCalls              = 0;
+    State->RunningDownloads        = 0;
+    State->MaximumRunningDownloads = 0;
+    State->NumberOfInvalidRequests = 0;
+    State->NumberOfModules         = NumberOfModules;
+    State->Delay                   = Delay;
+    State->AbortAfterCalls         = AbortAfterCalls;
+
+    for (UINT32 i = 0; i < NumberOfModules; i++)
+    {
+        RtlZeroMemory(&Modules[i], sizeof(MODULE_SYMBOL_DETAIL));
+
+        Modules[i].IsSymbolDetailsFound = TRUE;
+        Modules[i].BaseAddress          = 0x7ff700000000 + (UINT64)i * 0x100000;
+
+        strcpy_s(Modules[i].ModuleSymbolPath, sizeof(Modules[i].ModuleSymbolPath), TestSymbolDownloadGetPdbName(i).c_str());
+        strcpy_s(Modules[i].ModuleSymbolGuidAndAge, sizeof(Modules[i].ModuleSymbolGuidAndAge), TEST_SYMBOL_DOWNLOAD_GUID);
+    }
+
+    SymbolPath = "srv*" + State->SymbolDirectory + "*" TEST_SYMBOL_DOWNLOAD_SERVER;
+
+    ScriptEngineSymbolSetPdbDownloadCallback((PVOID)TestSymbolDownloadStub, MaximumWorkers);
+
+    Result = ScriptEngineSymbolInitLoad(Modules.data(),
+                                        (UINT32)(Modules.size() * sizeof(MODULE_SYMBOL_DETAIL)),
+                                        TRUE,
+                                        SymbolPath.c_str(),
+                                        FALSE);
+
+    ScriptEngineSymbolSetPdbDownloadCallback(NULL, 0);
+
+    return Result;
+}
+
+/**
+ * @brief Remove the directories of the test modules
+ *
+ * @return VOID
+ */
+static VOID
+TestSymbolDownloadRemoveDirectories()
+{
+    std::string Directory;
+
+    for (UINT32 i = 0; i < TEST_SYMBOL_DOWNLOAD_BENCHMARK_MODULES; i++)
+    {
+        Directory = TestSymbolDownloadState.SymbolDirectory + "\\" + TestSymbolDownloadGetPdbName(i);
+
+        RemoveDirectoryA((Directory + "\\" TEST_SYMBOL_DOWNLOAD_GUID).c_str());
+        RemoveDirectoryA(Directory.c_str());
+    }
+
+    RemoveDirectoryA(TestSymbolDownloadState.SymbolDirectory.c_str());
+}
+
+/**
+ * @brief Check the results of the downloads of a reload
+ *
+ * @param IsParallel Whether more than one download should be running
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestSymbolDownloadCheckResults(BOOLEAN IsParallel)
+{
+    PTEST_SYMBOL_DOWNLOAD_STATE State          = &TestSymbolDownloadState;
+    BOOLEAN                     Result         = TRUE;
+    size_t                      LastPosition   = 0;
+    size_t                      Position;
+    std::string                 ExpectedResult;
+
+    UnitTestExpect(Result, State->NumberOfInvalidRequests == 0);
+
+    if (IsParallel)
+    {
+        UnitTestExpect(Result, State->MaximumRunningDownloads > 1 && State->MaximumRunningDownloads <= TEST_SYMBOL_DOWNLOAD_MAXIMUM_WORKERS);
+    }
+    else
+    {
+        UnitTestExpect(Result, State->MaximumRunningDownloads == 1);
+    }
+
+    for (UINT32 i = 0; i < State->NumberOfModules; i++)
+    {
+        //
+        // Each pdb file is downloaded once, and the results are shown in
+        // the order of the modules (not in the order of the downloads)
+        //
+        UnitTestExpect(Result, State->NumberOfCalls[i] == 1);
+
+        ExpectedResult = "downloading symbol '" + TestSymbolDownloadGetPdbName(i) + "'...\t" +
+                         (TestSymbolDownloadIsFailedModule(i) ? "could not be downloaded (80004005)" : "downloaded");
+
+        Position = TestSymbolDownloadOutput.find(ExpectedResult);
+
+        UnitTestExpect(Result, Position != std::string::npos && Position >= LastPosition);
+
+        if (Position != std::string::npos)
+        {
+            LastPosition = Position;
+        }
+    }
+
+    return Result;
+}
+
+/**
+ * @brief Test of downloading the pdb files in parallel
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+TestSymbolDownload()
+{
+    BOOLEAN Result             = TRUE;
+    PVOID   MessageHandler     = g_MessageHandler;
+    CHAR    TempPath[MAX_PATH] = {0};
+    CHAR    DirectoryName[64]  = {0};
+
+    if (GetTempPathA(MAX_PATH, TempPath) == 0)
+    {
+        ShowMessages("\t[x] unable to get the temp directory\n");
+        return FALSE;
+    }
+
+    sprintf_s(DirectoryName, sizeof(DirectoryName), "hyperdbg-symbol-test-%x", GetCurrentProcessId());
+
+    TestSymbolDownloadState.SymbolDirectory = std::string(TempPath) + DirectoryName;
+
+    //
+    // The messages of the symbol parser are shown by ShowMessages
+    //
+    ScriptEngineSetTextMessageCallback((PVOID)ShowMessages);
+
+    g_MessageHandler = (PVOID)TestSymbolDownloadCaptureMessage;
+
+    //
+    // Parallel downloads
+    //
+    TestSymbolDownloadOutput.clear();
+
+    UnitTestExpect(Result, TestSymbolDownloadReload(TEST_SYMBOL_DOWNLOAD_NUMBER_OF_MODULES, 0, 0, 0));
+    UnitTestExpect(Result, TestSymbolDownloadCheckResults(TRUE));
+
+    //
+    // One download worker
+    //
+    TestSymbolDownloadOutput.clear();
+
+    UnitTestExpect(Result, TestSymbolDownloadReload(TEST_SYMBOL_DOWNLOAD_NUMBER_OF_MODULES, 1, 0, 0));
+    UnitTestExpect(Result, TestSymbolDownloadCheckResults(FALSE));
+
+    //
+    // Abort after a few downloads, the workers don't start new downloads
+    // and the next reload is not aborted
+    //
+    TestSymbolDownloadOutput.clear();
+
+    UnitTestExpect(Result, !TestSymbolDownloadReload(TEST_SYMBOL_DOWNLOAD_NUMBER_OF_MODULES, 0, 3, 0));
+    UnitTestExpect(Result, TestSymbolDownloadState.TotalCalls < TEST_SYMBOL_DOWNLOAD_NUMBER_OF_MODULES);
+    UnitTestExpect(Result, TestSymbolDownloadState.RunningDownloads == 0);
+
+    TestSymbolDownloadOutput.clear();
+
+    UnitTestExpect(Result, TestSymbolDownloadReload(TEST_SYMBOL_DOWNLOAD_NUMBER_OF_MODULES, 0, 0, 0));
+    UnitTestExpect(Result, TestSymbolDownloadCheckResults(TRUE));
+
+    g_MessageHandler = MessageHandler;
+
+    TestSymbolDownloadRemoveDirectories();
+
+    return Result;
+}
+
+/**
+ * @brief Benchmark of downloading the pdb files by one worker and in parallel
+ *
+ * @return VOID
+ */
+VOID
+BenchmarkSymbolDownload()
+{
+    PVOID  MessageHandler     = g_MessageHandler;
+    CHAR   TempPath[MAX_PATH] = {0};
+    CHAR   DirectoryName[64]  = {0};
+    UINT64 StartTime;
+    UINT64 ElapsedTime[2];
+
+    if (GetTempPathA(MAX_PATH, TempPath) == 0)
+    {
+        ShowMessages("err, unable to get the temp directory\n");
+        return;
+    }
+
+    sprintf_s(DirectoryName, sizeof(DirectoryName), "hyperdbg-symbol-test-%x", GetCurrentProcessId());
+
+    TestSymbolDownloadState.SymbolDirectory = std::string(TempPath) + DirectoryName;
+
+    ScriptEngineSetTextMessageCallback((PVOID)ShowMessages);
+
+    g_MessageHandler = (PVOID)TestSymbolDownloadCaptureMessage;
+
+    for (UINT32 Form = 0; Form < 2; Form++)
+    {
+        TestSymbolDownloadOutput.clear();
+
+        StartTime = UnitTestGetTimeInNanoseconds();
+        TestSymbolDownloadReload(TEST_SYMBOL_DOWNLOAD_BENCHMARK_MODULES, Form == 0 ? 1 : 0, 0, TEST_SYMBOL_DOWNLOAD_BENCHMARK_DELAY);
+        ElapsedTime[Form] = UnitTestGetTimeInNanoseconds() - StartTime;
+    }
+
+    g_MessageHandler = MessageHandler;
+
+    TestSymbolDownloadRemoveDirectories();
+
+    UnitTestShowBenchmarkResult("download (20 ms each) by one worker", ElapsedTime[0], TEST_SYMBOL_DOWNLOAD_BENCHMARK_MODULES);
+    UnitTestShowBenchmarkResult("download (20 ms each) in parallel", ElapsedTime[1], TEST_SYMBOL_DOWNLOAD_BENCHMARK_MODULES);
+}
+
+UnitTestRegister("symbol-download", TestSymbolDownload, BenchmarkSymbolDownload);
@@ -0,0 +1,286 @@
+/**
+ * @file test-symbol-types.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Fixture tests and benchmark of the cache of the type members
+ * @details the fixture is a structure of this file, its layout is read from
+ * the pdb file of the test process and compared with the layout of the compiler
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Base address of the fixture module
+ *
+ */
+#define TEST_SYMBOL_TYPES_BASE_ADDRESS 0x7ffe10000000
+
+/**
+ * @brief Name of the fixture module
+ *
+ */
+#define TEST_SYMBOL_TYPES_MODULE_NAME "hdtypesfixture"
+
+/**
+ * @brief Name of the fixture structure
+ *
+ */
+#define TEST_SYMBOL_TYPES_FIXTURE_NAME TEST_SYMBOL_TYPES_MODULE_NAME "!_TEST_SYMBOL_TYPES_FIXTURE"
+
+/**
+ * @brief Number of queries of each form in the benchmark
+ *
+ */
+#define TEST_SYMBOL_TYPES_BENCHMARK_QUERIES 20000
+
+/**
+ * @brief The fixture structure
+ *
+ */
+typedef struct _TEST_SYMBOL_TYPES_FIXTURE
+{
+    UINT32 Signature;
+    UINT8  Flags;
+    UINT64 Address;
+    UINT32 IsValid : 1;
+    UINT32 IsLast : 1;
+    UINT32 Reserved : 30;
+
+    union
+    {
+        UINT64 Value;
+        PVOID  Pointer;
+    };
+
+    CHAR                                Name[13];
+    UINT16                              Length;
+    struct _TEST_SYMBOL_TYPES_FIXTURE * Next;
+
+} TEST_SYMBOL_TYPES_FIXTURE, *PTEST_SYMBOL_TYPES_FIXTURE;
+
+/**
+ * @brief A field of the fixture structure and its expected offset
+ *
+ */
+typedef struct _TEST_SYMBOL_TYPES_FIELD
+{
+    const CHAR * Name;
+    UINT32       Offset; // bit position for one-bit fields
+
+} TEST_SYMBOL_TYPES_FIELD, *PTEST_SYMBOL_TYPES_FIELD;
+
+/**
+ * @brief Fields of the fixture structure
+ *
+ */
+static const TEST_SYMBOL_TYPES_FIELD TestSymbolTypesFields[] = {
+    {"Signature", FIELD_OFFSET(TEST_SYMBOL_TYPES_FIXTURE, Signature)},
+    {"Flags", FIELD_OFFSET(TEST_SYMBOL_TYPES_FIXTURE, Flags)},
+    {"Address", FIELD_OFFSET(TEST_SYMBOL_TYPES_FIXTURE, Address)},
+    {"IsValid", 0},
+    {"IsLast", 1},
+    {"Value", FIELD_OFFSET(TEST_SYMBOL_TYPES_FIXTURE, Value)},
+    {"Pointer", FIELD_OFFSET(TEST_SYMBOL_TYPES_FIXTURE, Pointer)},
+    {"Name", FIELD_OFFSET(TEST_SYMBOL_TYPES_FIXTURE, Name)},
+    {"Length", FIELD_OFFSET(TEST_SYMBOL_TYPES_FIXTURE, Length)},
+    {"Next", FIELD_OFFSET(TEST_SYMBOL_TYPES_FIXTURE, Next)},
+};
+
+/**
+ * @brief Get the path of a pdb file next to the test process
+ *
+ * @param PdbName
+ * @param PdbPath
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestSymbolTypesGetPdbPath(const CHAR * PdbName, std::string & PdbPath)
+{
+    HMODULE Module               = NULL;
+    CHAR    ModulePath[MAX_PATH] = {0};
+    CHAR *  FileName;
+
+    if (!GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                            (LPCSTR)TestSymbolTypesGetPdbPath,
+                            &Module) ||
+        GetModuleFileNameA(Module, ModulePath, MAX_PATH) == 0)
+    {
+        return FALSE;
+    }
+
+    FileName = strrchr(ModulePath, '\\');
+
+    if (FileName == NULL)
+    {
+        return FALSE;
+    }
+
+    FileName[1] = '\0';
+    PdbPath     = std::string(ModulePath) + PdbName;
+
+    return std::filesystem::exists(PdbPath);
+}
+
+/**
+ * @brief Load a pdb file as the fixture module
+ *
+ * @param PdbName
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestSymbolTypesLoadModule(const CHAR * PdbName)
+{
+    std::string PdbPath;
+
+    if (!TestSymbolTypesGetPdbPath(PdbName, PdbPath))
+    {
+        ShowMessages("\t[x] unable to find '%s' next to the test process\n", PdbName);
+        return FALSE;
+    }
+
+    return ScriptEngineLoadFileSymbol(TEST_SYMBOL_TYPES_BASE_ADDRESS, PdbPath.c_str(), TEST_SYMBOL_TYPES_MODULE_NAME) == 0;
+}
+
+/**
+ * @brief Check the fields and the size of the fixture structure
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+TestSymbolTypesCheckFixture()
+{
+    BOOLEAN Result = TRUE;
+    UINT32  FieldOffset;
+    UINT64  TypeSize;
+
+    for (UINT32 i = 0; i < sizeof(TestSymbolTypesFields) / sizeof(TestSymbolTypesFields[0]); i++)
+    {
+        FieldOffset = (UINT32)-1;
+
+        if (!ScriptEngineGetFieldOffset((CHAR *)TEST_SYMBOL_TYPES_FIXTURE_NAME, (CHAR *)TestSymbolTypesFields[i].Name, &FieldOffset) ||
+            FieldOffset != TestSymbolTypesFields[i].Offset)
+        {
+            ShowMessages("\t[x] unexpected offset of '%s' (%x)\n", TestSymbolTypesFields[i].Name, FieldOffset);
+            Result = FALSE;
+        }
+    }
+
+    UnitTestExpect(Result, ScriptEngineGetDataTypeSize((CHAR *)TEST_SYMBOL_TYPES_FIXTURE_NAME, &TypeSize));
+    UnitTestExpect(Result, TypeSize == sizeof(TEST_SYMBOL_TYPES_FIXTURE));
+
+    //
+    // Unknown fields and types are not found (even after the type is cached)
+    //
+    UnitTestExpect(Result, !ScriptEngineGetFieldOffset((CHAR *)TEST_SYMBOL_TYPES_FIXTURE_NAME, (CHAR *)"Unknown", &FieldOffset));
+    UnitTestExpect(Result, !ScriptEngineGetFieldOffset((CHAR *)TEST_SYMBOL_TYPES_FIXTURE_NAME, (CHAR *)"signatur", &FieldOffset));
+    UnitTestExpect(Result, !ScriptEngineGetFieldOffset((CHAR *)TEST_SYMBOL_TYPES_MODULE_NAME "!_TEST_SYMBOL_TYPES_UNKNOWN", (CHAR *)"Signature", &FieldOffset));
+    UnitTestExpect(Result, !ScriptEngineGetDataTypeSize((CHAR *)TEST_SYMBOL_TYPES_MODULE_NAME "!_TEST_SYMBOL_TYPES_UNKNOWN", &TypeSize));
+
+    return Result;
+}
+
+/**
+ * @brief Fixture tests of the cache of the type members
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+TestSymbolTypes()
+{
+    BOOLEAN                   Result  = TRUE;
+    TEST_SYMBOL_TYPES_FIXTURE Fixture = {0};
+    UINT32                    FieldOffset;
+
+    //
+    // The fixture is used here, so its type is in the pdb file
+    //
+    Fixture.Next = &Fixture;
+
+    if (!TestSymbolTypesLoadModule("hyperdbg-test.pdb"))
+    {
+        return FALSE;
+    }
+
+    //
+    // The first check fills the cache and the second check is answered
+    // by the cache, both are the same as the checks without the cache
+    //
+    UnitTestExpect(Result, TestSymbolTypesCheckFixture());
+    UnitTestExpect(Result, TestSymbolTypesCheckFixture());
+
+    ScriptEngineSymbolSetTypeMembersCache(FALSE);
+    UnitTestExpect(Result, TestSymbolTypesCheckFixture());
+    ScriptEngineSymbolSetTypeMembersCache(TRUE);
+
+    //
+    // The cached types of the module are not used after unloading it, or
+    // after loading another pdb file at the same base address
+    //
+    UnitTestExpect(Result, ScriptEngineUnloadModuleSymbol((CHAR *)TEST_SYMBOL_TYPES_MODULE_NAME) == 0);
+    UnitTestExpect(Result, !ScriptEngineGetFieldOffset((CHAR *)TEST_SYMBOL_TYPES_FIXTURE_NAME, (CHAR *)"Signature", &FieldOffset));
+
+    if (TestSymbolTypesLoadModule("script-engine.pdb"))
+    {
+        UnitTestExpect(Result, !ScriptEngineGetFieldOffset((CHAR *)TEST_SYMBOL_TYPES_FIXTURE_NAME, (CHAR *)"Signature", &FieldOffset));
+        UnitTestExpect(Result, ScriptEngineUnloadModuleSymbol((CHAR *)TEST_SYMBOL_TYPES_MODULE_NAME) == 0);
+    }
+    else
+    {
+        Result = FALSE;
+    }
+
+    UnitTestExpect(Result, TestSymbolTypesLoadModule("hyperdbg-test.pdb"));
+    UnitTestExpect(Result, TestSymbolTypesCheckFixture());
+
+    ScriptEngineUnloadModuleSymbol((CHAR *)TEST_SYMBOL_TYPES_MODULE_NAME);
+
+    return Result && Fixture.Next == &Fixture;
+}
+
+/**
+ * @brief Benchmark of the field-offset queries with and without the cache
+ *
+ * @return VOID
+ */
+VOID
+BenchmarkSymbolTypes()
+{
+    UINT32 NumberOfFields = sizeof(TestSymbolTypesFields) / sizeof(TestSymbolTypesFields[0]);
+    UINT32 FieldOffset;
+    UINT64 StartTime;
+    UINT64 ElapsedTime;
+
+    if (!TestSymbolTypesLoadModule("hyperdbg-test.pdb"))
+    {
+        return;
+    }
+
+    for (UINT32 Form = 0; Form < 2; Form++)
+    {
+        ScriptEngineSymbolSetTypeMembersCache(Form == 1);
+
+        StartTime = UnitTestGetTimeInNanoseconds();
+
+        for (UINT32 i = 0; i < TEST_SYMBOL_TYPES_BENCHMARK_QUERIES; i++)
+        {
+            ScriptEngineGetFieldOffset((CHAR *)TEST_SYMBOL_TYPES_FIXTURE_NAME, (CHAR *)TestSymbolTypesFields[i % NumberOfFields].Name, &FieldOffset);
+        }
+
+        ElapsedTime = UnitTestGetTimeInNanoseconds() - StartTime;
+
+        UnitTestShowBenchmarkResult(Form == 1 ? "field offset with the cache" : "field offset without the cache",
+                                    ElapsedTime,
+                                    TEST_SYMBOL_TYPES_BENCHMARK_QUERIES);
+    }
+
+    ScriptEngineSymbolSetTypeMembersCache(TRUE);
+
+    ScriptEngineUnloadModuleSymbol((CHAR *)TEST_SYMBOL_TYPES_MODULE_NAME);
+}
+
+UnitTestRegister("symbol-types", TestSymbolTypes, BenchmarkSymbolTypes);
@@ -0,0 +1,191 @@
+/**
+ * @file unit-tests-environment.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief The environment of the shared sources of the unit tests
+ * @details the sources of libhyperdbg that are compiled into the test
+ * process use these routines and global variables instead of the ones
+ * of the debugger
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+//
+// Global Variables
+//
+
+/**
+ * @brief The handler of the messages of the unit tests (NULL to show
+ * the messages by printf)
+ *
+ */
+PVOID g_MessageHandler = NULL;
+
+/**
+ * @brief Shows whether the pause request is received or not
+ *
+ */
+BOOLEAN g_BreakPrintingOutput = FALSE;
+
+/**
+ * @brief The test process is never connected to a debuggee
+ *
+ */
+BOOLEAN g_IsSerialConnectedToRemoteDebuggee = FALSE;
+
+/**
+ * @brief The test process is never connected to a debuggee
+ *
+ */
+BOOLEAN g_IsDebuggeeRunning = FALSE;
+
+/**
+ * @brief Lock for the pending requests and the received commands
+ * of the remote frames
+ *
+ */
+CRITICAL_SECTION g_RemoteFrameLock;
+
+/**
+ * @brief Lock for sending the remote frames
+ *
+ */
+CRITICAL_SECTION g_RemoteFrameSendLock;
+
+/**
+ * @brief Whether the locks of remote frames are initialized or not
+ *
+ */
+BOOLEAN g_RemoteFrameLockInitialized = FALSE;
+
+/**
+ * @brief Signaled when a command is received or the connection is closed
+ *
+ */
+CONDITION_VARIABLE g_RemoteFrameCommandAvailable = CONDITION_VARIABLE_INIT;
+
+/**
+ * @brief Commands that are received and are waiting to be executed
+ *
+ */
+std::list<REMOTE_FRAME_COMMAND> g_RemoteReceivedCommands;
+
+/**
+ * @brief Whether the receiver of the commands is closed
+ *
+ */
+BOOLEAN g_RemoteCommandsReceiverClosed = FALSE;
+
+/**
+ * @brief Request id of the last sent command
+ *
+ */
+UINT32 g_RemoteLastRequestId = 0;
+
+/**
+ * @brief Commands that are sent and are waiting to be finished
+ *
+ */
+std::map<UINT32, HANDLE> g_RemotePendingRequests;
+
+/**
+ * @brief Show messages (to the handler of the unit tests or by printf)
+ *
+ * @param Fmt format string message
+ * @param ...
+ *
+ * @return VOID
+ */
+VOID
+ShowMessages(const char * Fmt, ...)
+{
+    va_list     ArgList;
+    int         Length;
+    std::string Message;
+
+    va_start(ArgList, Fmt);
+    Length = _vscprintf(Fmt, ArgList);
+    va_end(ArgList);
+
+    if (Length == -1)
+    {
+        return;
+    }
+
+    Message.resize((SIZE_T)Length + 1);
+
+    va_start(ArgList, Fmt);
+    Length = vsprintf_s(&Message[0], Message.size(), Fmt, ArgList);
+    va_end(ArgList);
+
+    if (Length == -1)
+    {
+        return;
+    }
+
+    if (g_MessageHandler == NULL)
+    {
+        printf("%s", Message.c_str());
+    }
+    else
+    {
+        ((SendMessageWithParamCallback)g_MessageHandler)(Message.c_str());
+    }
+}
+
+/**
+ * @brief Show the errors of the shared sources
+ *
+ * @param Error
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+ShowErrorMessage(UINT32 Error)
+{
+    ShowMessages("err, error code (%x)\n", Error);
+
+    return TRUE;
+}
+
+/**
+ * @brief The pause request of the shared sources (CTRL+C of the
+ * remote connections)
+ *
+ * @return VOID
+ */
+VOID
+CommandPauseRequest()
+{
+    g_BreakPrintingOutput = TRUE;
+
+    ShowMessages("pausing...\n");
+}
+
+/**
+ * @brief The test process is never connected to a debuggee, so the
+ * batches are not sent
+ *
+ * @param BatchPacket
+ * @param BatchPacketSize
+ * @param BatchResult
+ * @param BatchResultSize
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+KdSendBatchPacketToDebuggee(PDEBUGGEE_BATCH_PACKET BatchPacket,
+                            UINT32                 BatchPacketSize,
+                            PDEBUGGEE_BATCH_PACKET BatchResult,
+                            UINT32                 BatchResultSize)
+{
+    UNREFERENCED_PARAMETER(BatchPacket);
+    UNREFERENCED_PARAMETER(BatchPacketSize);
+    UNREFERENCED_PARAMETER(BatchResult);
+    UNREFERENCED_PARAMETER(BatchResultSize);
+
+    return FALSE;
+}
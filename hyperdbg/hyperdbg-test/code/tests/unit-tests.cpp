@@ -0,0 +1,230 @@
+/**
+ * @file unit-tests.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Running the unit tests and benchmarks of the debugger's components
+ * @details the components are compiled into the test process, and the
+ * parts of the debugger that are not shared are tested through the testing
+ * exports of libhyperdbg, so these tests don't need a debuggee
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Get the list of the unit tests
+ * @details the list is constructed on its first use, as the tests are
+ * registered by the initializers of their own files
+ *
+ * @return std::vector<UNIT_TEST_ENTRY>&
+ */
+static std::vector<UNIT_TEST_ENTRY> &
+UnitTestGetList()
+{
+    static std::vector<UNIT_TEST_ENTRY> UnitTestsList;
+
+    return UnitTestsList;
+}
+
+/**
+ * @brief Add a unit test to the list (by UnitTestRegister)
+ * @details the list is sorted by the name of the tests, so the order
+ * doesn't depend on the order of the initialization of the files
+ *
+ * @param Name
+ * @param TestRoutine
+ * @param BenchmarkRoutine NULL if the component has no benchmark
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+UnitTestAdd(const CHAR * Name, BOOLEAN (*TestRoutine)(), VOID (*BenchmarkRoutine)())
+{
+    std::vector<UNIT_TEST_ENTRY> & UnitTestsList = UnitTestGetList();
+    UNIT_TEST_ENTRY                Entry         = {Name, TestRoutine, BenchmarkRoutine};
+
+    UnitTestsList.insert(std::upper_bound(UnitTestsList.begin(),
+                                          UnitTestsList.end(),
+                                          Entry,
+                                          [](const UNIT_TEST_ENTRY & Left, const UNIT_TEST_ENTRY & Right) {
+                                              return strcmp(Left.Name, Right.Name) < 0;
+                                          }),
+                         Entry);
+
+    return TRUE;
+}
+
+/**
+ * @brief Get the current time in nanoseconds (for benchmarks)
+ *
+ * @return UINT64
+ */
+UINT64
+UnitTestGetTimeInNanoseconds()
+{
+    static LARGE_INTEGER Frequency = {0};
+    LARGE_INTEGER        Counter;
+
+    if (Frequency.QuadPart == 0)
+    {
+        QueryPerformanceFrequency(&Frequency);
+    }
+
+    QueryPerformanceCounter(&Counter);
+
+    return (UINT64)((Counter.QuadPart / Frequency.QuadPart) * 1000000000 +
+                    ((Counter.QuadPart % Frequency.QuadPart) * 1000000000) / Frequency.QuadPart);
+}
+
+/**
+ * @brief Get the next value of a deterministic pseudo-random generator
+ * @details the tests use a fixed seed, so a failed randomized test
+ * is reproducible
+ *
+ * @param State The state of the generator (should not be zero)
+ *
+ * @return UINT64
+ */
+UINT64
+UnitTestGetRandom(UINT64 * State)
+{
+    //
+    // xorshift64*
+    //
+    *State ^= *State >> 12;
+    *State ^= *State << 25;
+    *State ^= *State >> 27;
+
+    return *State * 0x2545f4914f6cdd1dULL;
+}
+
+/**
+ * @brief Show the result of a benchmark
+ *
+ * @param Name
+ * @param ElapsedNanoseconds
+ * @param NumberOfOperations
+ *
+ * @return VOID
+ */
+VOID
+UnitTestShowBenchmarkResult(const CHAR * Name, UINT64 ElapsedNanoseconds, UINT64 NumberOfOperations)
+{
+    if (NumberOfOperations == 0)
+    {
+        NumberOfOperations = 1;
+    }
+
+    ShowMessages("\t%-48s %10llu ops %14llu ns %10.2f ns/op\n",
+                 Name,
+                 NumberOfOperations,
+                 ElapsedNanoseconds,
+                 (double)ElapsedNanoseconds / (double)NumberOfOperations);
+}
+
+/**
+ * @brief Run the unit tests
+ *
+ * @param Name Name of the test or NULL to run all tests
+ *
+ * @return BOOLEAN TRUE if the tests passed
+ */
+BOOLEAN
+UnitTestRun(const CHAR * Name)
+{
+    BOOLEAN Result         = TRUE;
+    BOOLEAN IsFound        = FALSE;
+    UINT32  NumberOfPassed = 0;
+    UINT32  NumberOfFailed = 0;
+
+    for (const UNIT_TEST_ENTRY & Entry : UnitTestGetList())
+    {
+        if (Name != NULL && strcmp(Name, Entry.Name))
+        {
+            continue;
+        }
+
+        IsFound = TRUE;
+
+        ShowMessages("[*] testing %s\n", Entry.Name);
+
+        if (Entry.TestRoutine())
+        {
+            ShowMessages("[*] %s passed\n", Entry.Name);
+            NumberOfPassed++;
+        }
+        else
+        {
+            ShowMessages("[x] %s failed\n", Entry.Name);
+            NumberOfFailed++;
+            Result = FALSE;
+        }
+    }
+
+    if (!IsFound)
+    {
+        ShowMessages("err, unit test '%s' not found\n", Name);
+        UnitTestShowList();
+        return FALSE;
+    }
+
+    ShowMessages("\nunit tests: %d passed, %d failed\n", NumberOfPassed, NumberOfFailed);
+
+    return Result;
+}
+
+/**
+ * @brief Run the benchmarks
+ *
+ * @param Name Name of the test or NULL to run all benchmarks
+ *
+ * @return BOOLEAN TRUE if the benchmark is found
+ */
+BOOLEAN
+UnitTestRunBenchmark(const CHAR * Name)
+{
+    BOOLEAN IsFound = FALSE;
+
+    for (const UNIT_TEST_ENTRY & Entry : UnitTestGetList())
+    {
+        if (Entry.BenchmarkRoutine == NULL ||
+            (Name != NULL && strcmp(Name, Entry.Name)))
+        {
+            continue;
+        }
+
+        IsFound = TRUE;
+
+        ShowMessages("[*] benchmark of %s\n", Entry.Name);
+        Entry.BenchmarkRoutine();
+    }
+
+    if (!IsFound)
+    {
+        ShowMessages("err, benchmark '%s' not found\n", Name);
+        UnitTestShowList();
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Show the list of the unit tests
+ *
+ * @return VOID
+ */
+VOID
+UnitTestShowList()
+{
+    ShowMessages("unit tests:\n");
+
+    for (const UNIT_TEST_ENTRY & Entry : UnitTestGetList())
+    {
+        ShowMessages("\t%s%s\n",
+                     Entry.Name,
+                     Entry.BenchmarkRoutine != NULL ? " (has benchmark)" : "");
+    }
+}
@@ -0,0 +1,108 @@
+/**
+ * @file unit-tests.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of the unit tests and benchmarks of the debugger's components
+ * @details
+ * @version 0.11
+ * @date 2024-11-12
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//					Externs                     //
+//////////////////////////////////////////////////
+
+extern PVOID   g_MessageHandler;
+extern BOOLEAN g_BreakPrintingOutput;
+
+//////////////////////////////////////////////////
+//					Macros                      //
+//////////////////////////////////////////////////
+
+/**
+ * @brief Check a condition in a unit test
+ * @details the test continues after a failed check (so all failures are
+ * shown), but its result becomes FALSE
+ *
+ */
+#define UnitTestExpect(Result, Condition)                                        \
+    do                                                                           \
+    {                                                                            \
+        if (!(Condition))                                                        \
+        {                                                                        \
+            ShowMessages("\t[x] %s (%s:%d)\n", #Condition, __FILE__, __LINE__); \
+            Result = FALSE;                                                      \
+        }                                                                        \
+    } while (FALSE)
+
+/**
+ * @brief Register the unit test (and the benchmark) of a component
+ * @details the test is added to the list before main runs, so a new test
+ * only needs its source file in the project
+ *
+ */
+#define UnitTestRegister(Name, TestRoutine, BenchmarkRoutine) \
+    static const BOOLEAN g_UnitTestIsRegistered = UnitTestAdd(Name, TestRoutine, BenchmarkRoutine)
+
+//////////////////////////////////////////////////
+//					Structures                  //
+//////////////////////////////////////////////////
+
+/**
+ * @brief A unit test and the (optional) benchmark of a component
+ *
+ */
+typedef struct _UNIT_TEST_ENTRY
+{
+    const CHAR * Name;
+    BOOLEAN (*TestRoutine)();
+    VOID (*BenchmarkRoutine)(); // NULL if the component has no benchmark
+
+} UNIT_TEST_ENTRY, *PUNIT_TEST_ENTRY;
+
+//////////////////////////////////////////////////
+//					Functions                   //
+//////////////////////////////////////////////////
+
+BOOLEAN
+UnitTestAdd(const CHAR * Name, BOOLEAN (*TestRoutine)(), VOID (*BenchmarkRoutine)());
+
+UINT64
+UnitTestGetTimeInNanoseconds();
+
+UINT64
+UnitTestGetRandom(UINT64 * State);
+
+VOID
+UnitTestShowBenchmarkResult(const CHAR * Name, UINT64 ElapsedNanoseconds, UINT64 NumberOfOperations);
+
+BOOLEAN
+UnitTestRun(const CHAR * Name);
+
+BOOLEAN
+UnitTestRunBenchmark(const CHAR * Name);
+
+VOID
+UnitTestShowList();
+
+//////////////////////////////////////////////////
+//					Environment                 //
+//////////////////////////////////////////////////
+
+VOID
+ShowMessages(const char * Fmt, ...);
+
+BOOLEAN
+ShowErrorMessage(UINT32 Error);
+
+VOID
+CommandPauseRequest();
+
+BOOLEAN
+KdSendBatchPacketToDebuggee(PDEBUGGEE_BATCH_PACKET BatchPacket,
+                            UINT32                 BatchPacketSize,
+                            PDEBUGGEE_BATCH_PACKET BatchResult,
+                            UINT32                 BatchResultSize);
@@ -21,10 +21,26 @@ using namespace std;
 //
 #include "platform/user/header/Environment.h"
 
+//
+// IA32-doc has structures for the entire intel SDM (used by the components)
+//
+#define USE_LIB_IA32
+#if defined(USE_LIB_IA32)
+#    pragma warning(push, 0)
+#    include <ia32-doc/out/ia32.h>
+#    pragma warning(pop)
+typedef RFLAGS * PRFLAGS;
+#endif // USE_LIB_IA32
+
 //
 // General Headers
 //
+#define WIN32_LEAN_AND_MEAN
+#include <winternl.h>
 #include <Windows.h>
+#include <platform/user/header/Windows.h>
+#include <winsock2.h>
+#include <ws2tcpip.h>
 #include <iostream>
 #include <string>
 #include <conio.h>
@@ -34,6 +50,19 @@ using namespace std;
 #include <iomanip>
 #include <fstream>
 #include <filesystem>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <list>
+#include <memory>
+#include <unordered_set>
+
+//
+// Zydis Debug Disable Flag
+//
+#ifndef NDEBUG
+#    define NDEBUG
+#endif // !NDEBUG
 
 //
 // Program Defined Headers
@@ -50,6 +79,54 @@ using namespace std;
 #include "../hyperdbg-test/header/hwdbg-tests.h"
 
 //
-// import libhyperdbg
+// import libhyperdbg and script-engine
 //
 #include "SDK/imports/user/HyperDbgLibImports.h"
+#include "SDK/imports/user/HyperDbgScriptImports.h"
+
+//
+// Shared sources of libhyperdbg (unit tests)
+//
+#include "../libhyperdbg/header/symbol.h"
+#include "../libhyperdbg/header/hex-dump.h"
+#include "../libhyperdbg/header/branch-trace.h"
+#include "../libhyperdbg/header/profiler.h"
+#include "../libhyperdbg/header/kd-batch.h"
+#include "../libhyperdbg/header/communication.h"
+
+//
+// Components (shared with the kernel)
+//
+#ifndef PAGE_SIZE
+#    define PAGE_SIZE 0x1000
+#endif // !PAGE_SIZE
+
+#ifndef PAGE_ALIGN
+#    define PAGE_ALIGN(Va) ((PVOID)((ULONG_PTR)(Va) & ~(PAGE_SIZE - 1)))
+#endif // !PAGE_ALIGN
+
+#include "components/batch/header/BatchOperations.h"
+#include "components/branch-trace/header/LbrStack.h"
+#include "components/cursor/header/KdCursor.h"
+#include "components/emulation/header/MonitorEmulation.h"
+#include "components/ept-view/header/EptViewTable.h"
+#include "components/invept/header/InveptDeferral.h"
+#include "components/monitor-range/header/MonitorRangeTable.h"
+#include "components/pool/header/PoolWatermark.h"
+#include "components/profiler/header/SamplesRing.h"
+#include "components/relocation/header/InstructionRelocation.h"
+#include "components/search/header/MultiPatternSearch.h"
+#include "components/spp/header/SppTable.h"
+#include "components/throttle/header/Throttle.h"
+
+//
+// Unit tests
+//
+#include "../hyperdbg-test/header/unit-tests.h"
+
+//
+// Libraries
+//
+#pragma comment(lib, "ntdll.lib")
+#pragma comment(lib, "Ws2_32.lib")
+#pragma comment(lib, "Mswsock.lib")
@@ -536,3 +536,25 @@ BroadcastDisablePmlOnAllProcessors()
 {
     KeGenericCallDpc(DpcRoutineDisablePml, 0x0);
 }
+
+/**
+ * @brief routines for enabling the profiler on all cores
+ *
+ * @return VOID
+ */
+VOID
+BroadcastEnableProfilerOnAllProcessors()
+{
+    KeGenericCallDpc(DpcRoutineEnableProfiler, 0x0);
+}
+
+/**
+ * @brief routines for disabling the profiler on all cores
+ *
+ * @return VOID
+ */
+VOID
+BroadcastDisableProfilerOnAllProcessors()
+{
+    KeGenericCallDpc(DpcRoutineDisableProfiler, 0x0);
+}
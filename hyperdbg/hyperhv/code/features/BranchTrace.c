@@ -0,0 +1,155 @@
+/**
+ * @file BranchTrace.c
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Implementation of tracing the branches (last branch records)
+ * @details The LBR of the guest is only enabled on the core that runs the
+ * traced thread, the branches are recorded without any vm-exit, and the
+ * whole stack is drained at the drain points of the debugger (e.g., when
+ * the thread is switched out)
+ *
+ * @version 0.11
+ * @date 2024-11-08
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Clear the LBR stack of the current core
+ * @details the cleared entries are not drained, so the next drain only
+ * contains the new branches
+ *
+ * @return VOID
+ */
+static VOID
+BranchTraceClearStack()
+{
+    for (UINT32 i = 0; i < g_CompatibilityCheck.LastBranchRecordDepth; i++)
+    {
+        __writemsr(BRANCH_TRACE_MSR_LASTBRANCH_0_FROM_IP + i, 0);
+        __writemsr(BRANCH_TRACE_MSR_LASTBRANCH_0_TO_IP + i, 0);
+    }
+}
+
+/**
+ * @brief Check whether the branch tracing is supported or not
+ *
+ * @param LbrFormat The format of the last branch records
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+BranchTraceQuerySupport(UINT32 * LbrFormat)
+{
+    *LbrFormat = g_CompatibilityCheck.LastBranchRecordFormat;
+
+    return g_CompatibilityCheck.LastBranchRecordSupport;
+}
+
+/**
+ * @brief Enable or disable the branch tracing on the current core
+ * @details should be called in vmx-root mode, only the LBR bit of the
+ * guest's IA32_DEBUGCTL is changed, and the previous debug controls and
+ * LBR bit are restored when it's disabled
+ *
+ * @param VCpu The virtual processor's state
+ * @param Enable Enable or disable
+ *
+ * @return VOID
+ */
+VOID
+BranchTraceEnableOnCurrentCore(VIRTUAL_MACHINE_STATE * VCpu, BOOLEAN Enable)
+{
+    IA32_DEBUGCTL_REGISTER Debugctl;
+    UINT32                 VmentryControls = 0;
+    UINT32                 VmexitControls  = 0;
+
+    if (!g_CompatibilityCheck.LastBranchRecordSupport || VCpu->BranchTraceState.IsEnabled == Enable)
+    {
+        return;
+    }
+
+    if (Enable)
+    {
+        //
+        // The guest's IA32_DEBUGCTL should be loaded on vm-entries and
+        // saved on vm-exits, otherwise the LBR bit is lost
+        //
+        VmxVmread32P(VMCS_CTRL_VMENTRY_CONTROLS, &VmentryControls);
+        VmxVmread32P(VMCS_CTRL_PRIMARY_VMEXIT_CONTROLS, &VmexitControls);
+
+        VCpu->BranchTraceState.WereDebugControlsLoaded = (VmentryControls & VM_ENTRY_LOAD_DEBUG_CONTROLS) != 0;
+        VCpu->BranchTraceState.WereDebugControlsSaved  = (VmexitControls & VM_EXIT_SAVE_DEBUG_CONTROLS) != 0;
+
+        HvSetLoadDebugControls(TRUE);
+        HvSetSaveDebugControls(TRUE);
+
+        Debugctl.AsUInt                      = HvGetDebugctl();
+        VCpu->BranchTraceState.WasLbrEnabled = (BOOLEAN)Debugctl.Lbr;
+
+        //
+        // The previous entries are not related to the traced thread
+        //
+        BranchTraceClearStack();
+
+        Debugctl.Lbr = TRUE;
+        HvSetDebugctl(Debugctl.AsUInt);
+    }
+    else
+    {
+        Debugctl.AsUInt = HvGetDebugctl();
+        Debugctl.Lbr    = VCpu->BranchTraceState.WasLbrEnabled;
+        HvSetDebugctl(Debugctl.AsUInt);
+
+        HvSetLoadDebugControls(VCpu->BranchTraceState.WereDebugControlsLoaded);
+        HvSetSaveDebugControls(VCpu->BranchTraceState.WereDebugControlsSaved);
+    }
+
+    VCpu->BranchTraceState.IsEnabled = Enable;
+}
+
+/**
+ * @brief Drain the branches that are recorded on the current core since
+ * the previous drain
+ * @details should be called in vmx-root mode, the LBRs are not changed in
+ * vmx-root as the IA32_DEBUGCTL is cleared on vm-exits
+ *
+ * @param VCpu The virtual processor's state
+ * @param Records The drained records (from the oldest to the newest)
+ * @param MaximumNumberOfRecords Maximum number of the drained records
+ * @param IsOverflowed Whether the older branches might be lost or not
+ *
+ * @return UINT32 Number of the drained records
+ */
+UINT32
+BranchTraceDrainOnCurrentCore(VIRTUAL_MACHINE_STATE *       VCpu,
+                              PDEBUGGER_BRANCH_TRACE_RECORD Records,
+                              UINT32                        MaximumNumberOfRecords,
+                              BOOLEAN *                     IsOverflowed)
+{
+    LBR_STACK_SNAPSHOT Snapshot;
+    UINT32             Count;
+
+    *IsOverflowed = FALSE;
+
+    if (!VCpu->BranchTraceState.IsEnabled)
+    {
+        return 0;
+    }
+
+    Snapshot.Depth = g_CompatibilityCheck.LastBranchRecordDepth;
+    Snapshot.Tos   = (UINT32)__readmsr(BRANCH_TRACE_MSR_LASTBRANCH_TOS);
+
+    for (UINT32 i = 0; i < Snapshot.Depth; i++)
+    {
+        Snapshot.From[i] = __readmsr(BRANCH_TRACE_MSR_LASTBRANCH_0_FROM_IP + i);
+        Snapshot.To[i]   = __readmsr(BRANCH_TRACE_MSR_LASTBRANCH_0_TO_IP + i);
+    }
+
+    Count = LbrStackCollect(&Snapshot, Records, MaximumNumberOfRecords, IsOverflowed);
+
+    BranchTraceClearStack();
+
+    return Count;
+}
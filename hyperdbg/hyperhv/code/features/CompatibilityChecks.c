@@ -144,6 +144,130 @@ CompatibilityCheckPml()
     }
 }
 
+/**
+ * @brief Check for sub-page write permissions (SPP) support
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+CompatibilityCheckSubPageWritePermissions()
+{
+    //
+    // The SPP-table pointer field exists only on processors that support the 1-setting of
+    // the "sub-page write permissions for EPT" VM-execution control
+    //
+    UINT32 SecondaryProcBasedVmExecControls = HvAdjustControls(CPU_BASED_CTL2_SUB_PAGE_WRITE_PERMISSIONS, IA32_VMX_PROCBASED_CTLS2);
+
+    if (SecondaryProcBasedVmExecControls & CPU_BASED_CTL2_SUB_PAGE_WRITE_PERMISSIONS)
+    {
+        //
+        // The processor support SPP
+        //
+        return TRUE;
+    }
+    else
+    {
+        //
+        // Not supported
+        //
+        return FALSE;
+    }
+}
+
+/**
+ * @brief Check for the VMX-preemption timer support
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+CompatibilityCheckVmxPreemptionTimer()
+{
+    //
+    // The timer should be activated from the pin-based controls and its value
+    // should be saved on vm-exits, otherwise, the timer is reloaded on each
+    // vm-entry
+    //
+    UINT32 PinBasedControls = HvAdjustControls(PIN_BASED_VM_EXECUTION_CONTROLS_ACTIVE_VMX_TIMER, IA32_VMX_PINBASED_CTLS);
+    UINT32 VmExitControls   = HvAdjustControls(VM_EXIT_SAVE_VMX_PREEMPTION_TIMER, IA32_VMX_EXIT_CTLS);
+
+    if ((PinBasedControls & PIN_BASED_VM_EXECUTION_CONTROLS_ACTIVE_VMX_TIMER) &&
+        (VmExitControls & VM_EXIT_SAVE_VMX_PREEMPTION_TIMER))
+    {
+        //
+        // The processor support the VMX-preemption timer
+        //
+        return TRUE;
+    }
+    else
+    {
+        //
+        // Not supported
+        //
+        return FALSE;
+    }
+}
+
+/**
+ * @brief Check for the legacy last branch records (LBR) support
+ * @details the architectural LBRs use different MSRs, so they're not
+ * supported
+ *
+ * @param LbrFormat The format of the last branch records
+ * @param LbrDepth The number of the entries of the LBR stack
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+CompatibilityCheckLastBranchRecords(UINT32 * LbrFormat, UINT32 * LbrDepth)
+{
+    int    Regs1[4];
+    int    Regs2[4];
+    int    Regs3[4];
+    UINT32 DisplayModel;
+
+    *LbrFormat = 0;
+    *LbrDepth  = 0;
+
+    CommonCpuidInstruction(0, 0, Regs1);
+    CommonCpuidInstruction(1, 0, Regs2);
+
+    //
+    // The legacy LBRs are model-specific (family 6), and their format is
+    // only enumerated when the IA32_PERF_CAPABILITIES is supported (PDCM)
+    //
+    if (((Regs2[0] >> 8) & 0xf) != 6 || !(Regs2[2] & (1 << 15)))
+    {
+        return FALSE;
+    }
+
+    //
+    // Check for the architectural LBRs (CPUID.07H.0H:EDX[19])
+    //
+    if (Regs1[0] >= 0x7)
+    {
+        CommonCpuidInstruction(7, 0, Regs3);
+
+        if (Regs3[3] & (1 << 19))
+        {
+            return FALSE;
+        }
+    }
+
+    *LbrFormat = (UINT32)(__readmsr(BRANCH_TRACE_MSR_PERF_CAPABILITIES) & BRANCH_TRACE_PERF_CAPABILITIES_LBR_FORMAT_MASK);
+
+    //
+    // The depth of the stack is not enumerated, it's based on the model
+    // (the extended model is a part of the display model of family 6)
+    //
+    DisplayModel = ((Regs2[0] >> 4) & 0xf) | (((Regs2[0] >> 16) & 0xf) << 4);
+    *LbrDepth    = LbrStackGetDepth(DisplayModel);
+
+    //
+    // The first format (32-bit records) and the unknown models are not supported
+    //
+    return *LbrFormat != 0 && *LbrDepth != 0;
+}
+
 /**
  * @brief Checks for the compatibility features based on current processor
  * @detail NOTE: NOT ALL OF THE CHECKS ARE PERFORMED HERE
@@ -177,10 +301,31 @@ CompatibilityCheckPerformChecks()
     //
     g_CompatibilityCheck.PmlSupport = CompatibilityCheckPml();
 
+    //
+    // Check SPP support
+    //
+    g_CompatibilityCheck.SubPageWritePermissionsSupport = CompatibilityCheckSubPageWritePermissions();
+
+    //
+    // Check VMX-preemption timer support
+    //
+    g_CompatibilityCheck.VmxPreemptionTimerSupport = CompatibilityCheckVmxPreemptionTimer();
+
+    //
+    // Check last branch records (LBR) support
+    //
+    g_CompatibilityCheck.LastBranchRecordSupport = CompatibilityCheckLastBranchRecords(&g_CompatibilityCheck.LastBranchRecordFormat,
+                                                                                       &g_CompatibilityCheck.LastBranchRecordDepth);
+
     //
     // Log for testing
     //
-    LogDebugInfo("Mode based execution: %s | PML: %s",
+    LogDebugInfo("Mode based execution: %s | PML: %s | SPP: %s | VMX-preemption timer: %s | LBR: %s (format: %x, depth: %d)",
                  g_CompatibilityCheck.ModeBasedExecutionSupport ? "true" : "false",
-                 g_CompatibilityCheck.PmlSupport ? "true" : "false");
+                 g_CompatibilityCheck.PmlSupport ? "true" : "false",
+                 g_CompatibilityCheck.SubPageWritePermissionsSupport ? "true" : "false",
+                 g_CompatibilityCheck.VmxPreemptionTimerSupport ? "true" : "false",
+                 g_CompatibilityCheck.LastBranchRecordSupport ? "true" : "false",
+                 g_CompatibilityCheck.LastBranchRecordFormat,
+                 g_CompatibilityCheck.LastBranchRecordDepth);
 }
@@ -0,0 +1,399 @@
+/**
+ * @file Profiler.c
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Implementation of the sampling profiler (VMX-preemption timer)
+ * @details Each core arms the VMX-preemption timer and on each expiration,
+ * the RIP (and the possible return addresses on the stack) of the guest
+ * is stored in a per-core ring which is later drained by the user-mode
+ *
+ * @version 0.11
+ * @date 2024-11-01
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Free the samples rings of all cores
+ *
+ * @return VOID
+ */
+static VOID
+ProfilerFreeSamplesRings()
+{
+    ULONG ProcessorsCount = KeQueryActiveProcessorCount(0);
+
+    for (size_t i = 0; i < ProcessorsCount; i++)
+    {
+        if (g_GuestState[i].ProfilerSamplesRing != NULL)
+        {
+            PlatformMemFreePool(g_GuestState[i].ProfilerSamplesRing);
+            g_GuestState[i].ProfilerSamplesRing = NULL;
+        }
+    }
+}
+
+/**
+ * @brief Start the profiler on all cores
+ * @details should be called in vmx non-root mode (PASSIVE_LEVEL)
+ *
+ * @param ProfilerRequest The start request of the profiler
+ * @param SamplingPeriod The sampling period (in TSC ticks)
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+ProfilerStart(PDEBUGGER_PROFILER_REQUEST ProfilerRequest, UINT64 SamplingPeriod)
+{
+    IA32_VMX_MISC_REGISTER VmxMisc;
+    UINT64                 TimerValue;
+    ULONG                  ProcessorsCount;
+
+    //
+    // Check for the support of the VMX-preemption timer
+    //
+    if (!g_CompatibilityCheck.VmxPreemptionTimerSupport)
+    {
+        ProfilerRequest->KernelStatus = DEBUGGER_ERROR_PROFILER_IS_NOT_SUPPORTED;
+        return FALSE;
+    }
+
+    if (g_ProfilerIsRunning)
+    {
+        ProfilerRequest->KernelStatus = DEBUGGER_ERROR_PROFILER_IS_ALREADY_RUNNING;
+        return FALSE;
+    }
+
+    if (SamplingPeriod == 0 || ProfilerRequest->StackDepth > MaximumProfilerStackDepth)
+    {
+        ProfilerRequest->KernelStatus = DEBUGGER_ERROR_INVALID_PROFILER_OPTIONS;
+        return FALSE;
+    }
+
+    //
+    // The VMX-preemption timer counts down by 1 every time bit X in the TSC
+    // changes due to a TSC increment, where X is reported in IA32_VMX_MISC[4:0]
+    //
+    VmxMisc.AsUInt = __readmsr(IA32_VMX_MISC);
+    TimerValue     = SamplingPeriod >> VmxMisc.PreemptionTimerTscRelationship;
+
+    if (TimerValue == 0)
+    {
+        TimerValue = 1;
+    }
+    else if (TimerValue > MAXUINT32)
+    {
+        TimerValue = MAXUINT32;
+    }
+
+    //
+    // Allocate the samples ring of each core (if not allocated before)
+    //
+    ProcessorsCount = KeQueryActiveProcessorCount(0);
+
+    for (size_t i = 0; i < ProcessorsCount; i++)
+    {
+        if (g_GuestState[i].ProfilerSamplesRing == NULL)
+        {
+            g_GuestState[i].ProfilerSamplesRing = PlatformMemAllocateNonPagedPool(sizeof(PROFILER_SAMPLES_RING));
+        }
+
+        if (g_GuestState[i].ProfilerSamplesRing == NULL)
+        {
+            //
+            // Allocation failed
+            //
+            ProfilerFreeSamplesRings();
+
+            ProfilerRequest->KernelStatus = DEBUGGER_ERROR_INVALID_PROFILER_OPTIONS;
+            return FALSE;
+        }
+
+        //
+        // Discard the samples of the previous session
+        //
+        SamplesRingReset(g_GuestState[i].ProfilerSamplesRing);
+    }
+
+    g_ProfilerTimerValue = (UINT32)TimerValue;
+    g_ProfilerStackDepth = ProfilerRequest->StackDepth;
+    g_ProfilerProcessId  = ProfilerRequest->ProcessId;
+
+    //
+    // The flag should be set before arming the timers as the vm-exit handler
+    // disables the timer if the profiler is not running
+    //
+    g_ProfilerIsRunning = TRUE;
+
+    //
+    // Broadcast VMCALL to arm the VMX-preemption timer from vmx-root
+    //
+    BroadcastEnableProfilerOnAllProcessors();
+
+    ProfilerRequest->KernelStatus = DEBUGGER_OPERATION_WAS_SUCCESSFUL;
+
+    return TRUE;
+}
+
+/**
+ * @brief Stop the profiler on all cores
+ * @details the samples rings are not freed so the remaining samples
+ * could be read after stopping the profiler
+ *
+ * @return VOID
+ */
+VOID
+ProfilerStop()
+{
+    if (!g_ProfilerIsRunning)
+    {
+        return;
+    }
+
+    g_ProfilerIsRunning = FALSE;
+
+    //
+    // Broadcast VMCALL to disarm the VMX-preemption timer from vmx-root
+    //
+    BroadcastDisableProfilerOnAllProcessors();
+}
+
+/**
+ * @brief Stop the profiler and free its resources
+ *
+ * @return VOID
+ */
+VOID
+ProfilerUninitialize()
+{
+    ProfilerStop();
+
+    ProfilerFreeSamplesRings();
+}
+
+/**
+ * @brief Arm the VMX-preemption timer for the profiler
+ * @details should be called in vmx-root mode
+ *
+ * @param VCpu The virtual processor's state
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+ProfilerEnable(VIRTUAL_MACHINE_STATE * VCpu)
+{
+    if (VCpu->ProfilerSamplesRing == NULL)
+    {
+        return FALSE;
+    }
+
+    //
+    // Without saving the timer on vm-exits, the timer is reloaded on each
+    // vm-entry and never expires if other vm-exits are frequent
+    //
+    HvSetSaveVmxPreemptionTimerValue(TRUE);
+
+    CounterSetPreemptionTimer(g_ProfilerTimerValue);
+
+    HvSetVmxPreemptionTimerExiting(TRUE);
+
+    return TRUE;
+}
+
+/**
+ * @brief Disarm the VMX-preemption timer of the profiler
+ * @details should be called in vmx-root mode
+ *
+ * @param VCpu The virtual processor's state
+ *
+ * @return VOID
+ */
+VOID
+ProfilerDisable(VIRTUAL_MACHINE_STATE * VCpu)
+{
+    UNREFERENCED_PARAMETER(VCpu);
+
+    HvSetVmxPreemptionTimerExiting(FALSE);
+
+    HvSetSaveVmxPreemptionTimerValue(FALSE);
+
+    CounterClearPreemptionTimer();
+}
+
+/**
+ * @brief Collect the values on the stack of the guest that might be
+ * return addresses
+ * @details should be called in vmx-root mode
+ *
+ * @param VCpu The virtual processor's state
+ * @param Sample The sample to fill its stack
+ *
+ * @return VOID
+ */
+static VOID
+ProfilerCollectStack(VIRTUAL_MACHINE_STATE * VCpu, PDEBUGGER_PROFILER_SAMPLE Sample)
+{
+    UINT64  StackValues[PROFILER_STACK_SCAN_WINDOW] = {0};
+    UINT64  Rsp                                     = VCpu->Regs->rsp;
+    UINT32  CountOfValues                           = 0;
+    BOOLEAN IsKernelAddress                         = FALSE;
+
+    if (g_ProfilerStackDepth == 0)
+    {
+        return;
+    }
+
+    //
+    // The stack is not read after the end of the current page
+    // to avoid touching more than a single page of the guest
+    //
+    CountOfValues = (UINT32)((PAGE_SIZE - (Rsp & (PAGE_SIZE - 1))) / sizeof(UINT64));
+
+    if (CountOfValues > PROFILER_STACK_SCAN_WINDOW)
+    {
+        CountOfValues = PROFILER_STACK_SCAN_WINDOW;
+    }
+
+    if (!MemoryMapperReadMemorySafeOnTargetProcess(Rsp, StackValues, CountOfValues * sizeof(UINT64)))
+    {
+        return;
+    }
+
+    for (UINT32 i = 0; i < CountOfValues && Sample->StackDepth < g_ProfilerStackDepth; i++)
+    {
+        UINT64 Value = StackValues[i];
+
+        //
+        // The return addresses are canonical and in the same half of the
+        // address space as the interrupted code
+        //
+        if (!CheckAddressCanonicality(Value, &IsKernelAddress) || IsKernelAddress == Sample->IsUserMode)
+        {
+            continue;
+        }
+
+        //
+        // Values close to the RSP are (most likely) saved frame pointers
+        //
+        if ((Value > Rsp ? Value - Rsp : Rsp - Value) < PROFILER_STACK_POINTER_DISTANCE)
+        {
+            continue;
+        }
+
+        Sample->Stack[Sample->StackDepth] = Value;
+        Sample->StackDepth++;
+    }
+}
+
+/**
+ * @brief Take a sample of the guest
+ * @details should be called in vmx-root mode
+ *
+ * @param VCpu The virtual processor's state
+ * @param Ring The samples ring of the current core
+ *
+ * @return VOID
+ */
+static VOID
+ProfilerTakeSample(VIRTUAL_MACHINE_STATE * VCpu, PPROFILER_SAMPLES_RING Ring)
+{
+    PDEBUGGER_PROFILER_SAMPLE Sample;
+    UINT32                    ProcessId = HANDLE_TO_UINT32(PsGetCurrentProcessId());
+
+    if (g_ProfilerProcessId != DEBUGGER_EVENT_APPLY_TO_ALL_PROCESSES && g_ProfilerProcessId != ProcessId)
+    {
+        return;
+    }
+
+    Sample = SamplesRingAcquireEntry(Ring);
+
+    if (Sample == NULL)
+    {
+        return;
+    }
+
+    Sample->Cr3        = LayoutGetCurrentProcessCr3().Flags;
+    Sample->Rip        = VCpu->LastVmexitRip;
+    Sample->ProcessId  = ProcessId;
+    Sample->ThreadId   = HANDLE_TO_UINT32(PsGetCurrentThreadId());
+    Sample->CoreId     = (UINT16)VCpu->CoreId;
+    Sample->IsUserMode = GetGuestCs().Attributes.DescriptorPrivilegeLevel == 3 ? TRUE : FALSE;
+    Sample->StackDepth = 0;
+
+    ProfilerCollectStack(VCpu, Sample);
+
+    SamplesRingPublishEntry(Ring);
+}
+
+/**
+ * @brief Handle the expiration of the VMX-preemption timer for the profiler
+ * @details should be called in vmx-root mode
+ *
+ * @param VCpu The virtual processor's state
+ *
+ * @return VOID
+ */
+VOID
+ProfilerHandleVmxPreemptionTimerVmexit(VIRTUAL_MACHINE_STATE * VCpu)
+{
+    PPROFILER_SAMPLES_RING Ring = VCpu->ProfilerSamplesRing;
+
+    if (!g_ProfilerIsRunning || Ring == NULL)
+    {
+        //
+        // The timer is saved as zero, so it should be disarmed, otherwise
+        // it immediately expires after the vm-entry
+        //
+        ProfilerDisable(VCpu);
+        return;
+    }
+
+    ProfilerTakeSample(VCpu, Ring);
+
+    //
+    // Reload the timer for the next sample
+    //
+    CounterSetPreemptionTimer(g_ProfilerTimerValue);
+}
+
+/**
+ * @brief Read (and remove) the samples of a core
+ * @details should be called in vmx non-root mode, the samples are
+ * placed after the request
+ *
+ * @param ProfilerRequest The read request of the profiler
+ * @param MaximumNumberOfSamples The maximum number of samples that
+ * could be placed after the request
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+ProfilerReadSamples(PDEBUGGER_PROFILER_REQUEST ProfilerRequest, UINT32 MaximumNumberOfSamples)
+{
+    PPROFILER_SAMPLES_RING    Ring;
+    PDEBUGGER_PROFILER_SAMPLE Samples = (PDEBUGGER_PROFILER_SAMPLE)((UINT64)ProfilerRequest + SIZEOF_DEBUGGER_PROFILER_REQUEST);
+
+    ProfilerRequest->NumberOfSamples = 0;
+
+    if (ProfilerRequest->CoreId >= KeQueryActiveProcessorCount(0))
+    {
+        ProfilerRequest->KernelStatus = DEBUGGER_ERROR_INVALID_CORE_ID;
+        return FALSE;
+    }
+
+    Ring = g_GuestState[ProfilerRequest->CoreId].ProfilerSamplesRing;
+
+    if (Ring == NULL)
+    {
+        ProfilerRequest->KernelStatus = DEBUGGER_ERROR_INVALID_PROFILER_OPTIONS;
+        return FALSE;
+    }
+
+    ProfilerRequest->NumberOfSamples = SamplesRingRead(Ring, Samples, MaximumNumberOfSamples);
+    ProfilerRequest->TotalSamples    = Ring->TotalSamples;
+    ProfilerRequest->DroppedSamples  = Ring->DroppedSamples;
+    ProfilerRequest->KernelStatus    = DEBUGGER_OPERATION_WAS_SUCCESSFUL;
+
+    return TRUE;
+}
@@ -0,0 +1,266 @@
+/**
+ * @file SubPagePermissions.c
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Implementation of the sub-page write permissions (SPP) of EPT
+ * @details SPP lets a page that is write-protected in EPT accept the writes
+ * to some of its 128-byte sub-pages, so the monitors of a small range of a
+ * page won't cause EPT violations for the writes to the rest of the page
+ *
+ * @version 0.11
+ * @date 2024-10-28
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Initialize the sub-page write permissions mechanism
+ * @details allocates the root (SPPL4) of the SPP table, should be
+ * called before setting up the VMCS of the cores
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+SppInitialize()
+{
+    //
+    // Check for the support of SPP
+    //
+    if (!g_CompatibilityCheck.SubPageWritePermissionsSupport)
+    {
+        LogDebugInfo("Sub-page write permissions (SPP) is not supported, monitors use page granularity");
+        return FALSE;
+    }
+
+    //
+    // The SPP table is indexed by the guest-physical address, thus, a single
+    // table is shared between all the cores
+    //
+    if (g_EptState->SppTable == NULL)
+    {
+        g_EptState->SppTable = PlatformMemAllocateZeroedNonPagedPool(sizeof(SPP_TABLE));
+    }
+
+    if (g_EptState->SppTable == NULL)
+    {
+        LogWarning("Warning, unable to allocate the SPP table, monitors use page granularity");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Uninitialize the sub-page write permissions mechanism
+ * @details the lower levels of the table are freed by the pool manager
+ *
+ * @return VOID
+ */
+VOID
+SppUninitialize()
+{
+    if (g_EptState->SppTable != NULL)
+    {
+        PlatformMemFreePool(g_EptState->SppTable);
+        g_EptState->SppTable = NULL;
+    }
+}
+
+/**
+ * @brief Enables the sub-page write permissions on the current VMCS
+ * @details the pages are not affected until bit 61 of their EPT entry is set
+ *
+ * @param VCpu The virtual processor's state
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+SppEnable(VIRTUAL_MACHINE_STATE * VCpu)
+{
+    UNREFERENCED_PARAMETER(VCpu);
+
+    if (g_EptState->SppTable == NULL)
+    {
+        return FALSE;
+    }
+
+    //
+    // Write the physical address of the root of the SPP table (SPPTP)
+    //
+    VmxVmwrite64(SPP_VMCS_CTRL_TABLE_POINTER, VirtualAddressToPhysicalAddress(g_EptState->SppTable));
+
+    //
+    // Secondary processor-based VM-execution control 23 is defined
+    // as sub-page write permissions for EPT
+    //
+    HvSetSubPageWritePermissionsEnableFlag(TRUE);
+
+    return TRUE;
+}
+
+/**
+ * @brief Allocate a level of the SPP table (SPP_TABLE_MEMORY)
+ * @details the tables are requested from the pre-allocated pools as
+ * we're in VMX-root mode
+ *
+ * @param Context not used
+ *
+ * @return PSPP_TABLE
+ */
+static PSPP_TABLE
+SppAllocateTable(PVOID Context)
+{
+    UNREFERENCED_PARAMETER(Context);
+
+    return (PSPP_TABLE)PoolManagerRequestPool(SUB_PAGE_PERMISSION_TABLE, TRUE, sizeof(SPP_TABLE));
+}
+
+/**
+ * @brief Get the physical address of a level of the SPP table (SPP_TABLE_MEMORY)
+ *
+ * @param Table
+ * @param Context not used
+ *
+ * @return UINT64
+ */
+static UINT64
+SppTableToPhysical(PSPP_TABLE Table, PVOID Context)
+{
+    UNREFERENCED_PARAMETER(Context);
+
+    return VirtualAddressToPhysicalAddress(Table);
+}
+
+/**
+ * @brief Get the level of the SPP table at a physical address (SPP_TABLE_MEMORY)
+ *
+ * @param Address
+ * @param Context not used
+ *
+ * @return PSPP_TABLE
+ */
+static PSPP_TABLE
+SppPhysicalToTable(UINT64 Address, PVOID Context)
+{
+    UNREFERENCED_PARAMETER(Context);
+
+    return (PSPP_TABLE)PhysicalAddressToVirtualAddress(Address);
+}
+
+/**
+ * @brief Routines that allocate and translate the levels of the SPP table
+ *
+ */
+static SPP_TABLE_MEMORY SppTableMemory = {
+    SppAllocateTable,
+    SppTableToPhysical,
+    SppPhysicalToTable,
+    NULL,
+};
+
+/**
+ * @brief Set the sub-page permission vector of a page
+ * @details should be called from VMX-root mode, the missing levels of the
+ * table are built from the pre-allocated pools
+ *
+ * @param PhysicalBaseAddress The physical address of the page
+ * @param WritePermissions The SPPL1 entry of the page
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+SppSetWritePermissions(UINT64 PhysicalBaseAddress, UINT64 WritePermissions)
+{
+    if (g_EptState->SppTable == NULL)
+    {
+        return FALSE;
+    }
+
+    return SppTableSetWritePermissions(g_EptState->SppTable, PhysicalBaseAddress, WritePermissions, &SppTableMemory);
+}
+
+/**
+ * @brief Set the sub-page permissions for a page that is monitored for writes
+ * @details should be called from VMX-root mode
+ *
+ * @param PhysicalBaseAddress The physical address of the page
+ * @param StartOfTargetPhysicalAddress Start of the monitored range
+ * @param EndOfTargetPhysicalAddress End of the monitored range (inclusive)
+ *
+ * @return BOOLEAN TRUE if bit 61 of the EPT entry should be set for the page
+ * and FALSE if the whole page should be write-protected
+ */
+BOOLEAN
+SppApplyToMonitoredPage(UINT64 PhysicalBaseAddress,
+                        UINT64 StartOfTargetPhysicalAddress,
+                        UINT64 EndOfTargetPhysicalAddress)
+{
+    UINT64 WritePermissions;
+
+    if (g_EptState->SppTable == NULL)
+    {
+        return FALSE;
+    }
+
+    WritePermissions = SppComputeWritePermissions(PhysicalBaseAddress,
+                                                  StartOfTargetPhysicalAddress,
+                                                  EndOfTargetPhysicalAddress);
+
+    //
+    // If all of the sub-pages are monitored, SPP doesn't avoid any EPT violation
+    //
+    if (WritePermissions == 0)
+    {
+        return FALSE;
+    }
+
+    return SppSetWritePermissions(PhysicalBaseAddress, WritePermissions);
+}
+
+/**
+ * @brief Handle the SPP-related vm-exits
+ * @details SPPT misses and misconfigurations are not expected as the table
+ * is built before the EPT entries are changed, however, if they happen, the
+ * page is changed back to the page granularity on the current core and the
+ * instruction is re-executed
+ *
+ * @param VCpu The virtual processor's state
+ *
+ * @return VOID
+ */
+VOID
+SppHandleVmexit(VIRTUAL_MACHINE_STATE * VCpu)
+{
+    UINT64          GuestPhysicalAddr;
+    PEPT_PML1_ENTRY TargetPage;
+
+    __vmx_vmread(VMCS_GUEST_PHYSICAL_ADDRESS, &GuestPhysicalAddr);
+
+    LogDebugInfo("SPP %s at guest physical address : 0x%llx",
+                 (VCpu->ExitQualification & SPP_EXIT_QUALIFICATION_MISCONFIGURATION_FLAG) ? "misconfiguration" : "miss",
+                 GuestPhysicalAddr);
+
+    LIST_FOR_EACH_LINK(g_EptState->HookedPagesList, EPT_HOOKED_PAGE_DETAIL, PageHookList, HookedEntry)
+    {
+        if (HookedEntry->PhysicalBaseAddress == (SIZE_T)PAGE_ALIGN(GuestPhysicalAddr))
+        {
+            HookedEntry->ChangedEntry.AsUInt &= ~SPP_EPT_ENTRY_SUB_PAGE_WRITE_PERMISSIONS_FLAG;
+            break;
+        }
+    }
+
+    TargetPage = EptGetPml1Entry(VCpu->EptPageTable, (SIZE_T)PAGE_ALIGN(GuestPhysicalAddr));
+
+    if (TargetPage != NULL)
+    {
+        TargetPage->AsUInt &= ~SPP_EPT_ENTRY_SUB_PAGE_WRITE_PERMISSIONS_FLAG;
+    }
+
+    EptInveptDefer(VCpu, InveptSingleContext);
+
+    //
+    // Redo the instruction
+    //
+    HvSuppressRipIncrement(VCpu);
+}
@@ -0,0 +1,231 @@
+/**
+ * @file DisplacedExecution.c
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Displaced execution of the instructions of hidden breakpoints
+ * @details The instruction that is overwritten by a hidden breakpoint (!epthook)
+ * is relocated into a trampoline when the breakpoint is applied. Once the breakpoint
+ * is hit, the guest continues from the trampoline which executes the instruction and
+ * jumps back after it, so there is no need to restore the original entry of the page
+ * and wait for an MTF vm-exit to apply the hook again. The instructions that can't be
+ * relocated still use the MTF mechanism
+ *
+ * The trampolines are never freed, a thread might be interrupted (or rescheduled) while
+ * its RIP is still inside a trampoline, so the trampolines of the removed breakpoints
+ * are kept in the hooked page and only reused by a breakpoint on the same address that
+ * relocates the same instruction into exactly the same bytes
+ *
+ * @version 0.11
+ * @date 2024-10-30
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Build the trampoline of a hidden breakpoint
+ * @details should be called before the 0xcc of the breakpoint is written to the
+ * fake page, the trampolines are only built for the kernel addresses (64-bit)
+ * and if it's not possible to build the trampoline, the breakpoint uses MTF
+ *
+ * @param HookedEntry The hooked page
+ * @param BreakpointIndex The index of the breakpoint in the hooked page
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+DisplacedExecutionBuildTrampoline(PEPT_HOOKED_PAGE_DETAIL HookedEntry, UINT32 BreakpointIndex)
+{
+    BYTE    InstructionBuffer[MAXIMUM_INSTR_SIZE];
+    CHAR    RelocatedTrampoline[MAX_EXEC_TRAMPOLINE_SIZE];
+    UINT64  Address = HookedEntry->BreakpointAddresses[BreakpointIndex];
+    UINT32  OffsetInPage;
+    UINT32  BufferLength;
+    UINT32  TrampolineSize;
+    PCHAR   Trampoline;
+    BOOLEAN IsKernelAddress = FALSE;
+
+    HookedEntry->DisplacedTrampolines[BreakpointIndex] = NULL;
+
+    //
+    // The trampolines are not accessible from the user-mode
+    //
+    if (!CheckAddressCanonicality(Address, &IsKernelAddress) || !IsKernelAddress)
+    {
+        return FALSE;
+    }
+
+    //
+    // Read the original instruction from the fake page (the instructions that
+    // cross the page are not relocated)
+    //
+    OffsetInPage = (UINT32)(UINT64)PAGE_OFFSET(Address);
+    BufferLength = PAGE_SIZE - OffsetInPage;
+
+    if (BufferLength > MAXIMUM_INSTR_SIZE)
+    {
+        BufferLength = MAXIMUM_INSTR_SIZE;
+    }
+
+    RtlCopyMemory(InstructionBuffer, (PVOID)((UINT64)PAGE_ALIGN(&HookedEntry->FakePageContents) + OffsetInPage), BufferLength);
+
+    //
+    // The other breakpoints of the page are replaced by their original bytes
+    //
+    for (UINT32 i = 0; i < HookedEntry->CountOfBreakpoints; i++)
+    {
+        if (i != BreakpointIndex &&
+            HookedEntry->BreakpointAddresses[i] > Address &&
+            HookedEntry->BreakpointAddresses[i] < Address + BufferLength)
+        {
+            InstructionBuffer[HookedEntry->BreakpointAddresses[i] - Address] = HookedEntry->PreviousBytesOnBreakpointAddresses[i];
+        }
+    }
+
+    //
+    // Reuse the trampoline of a removed breakpoint on the same address if the
+    // relocated instruction is the same, a thread that is still executing it
+    // runs the same bytes
+    //
+    for (UINT32 i = 0; i < MaximumHiddenBreakpointsOnPage; i++)
+    {
+        Trampoline = HookedEntry->RetiredTrampolines[i];
+
+        if (Trampoline == NULL || HookedEntry->RetiredTrampolineAddresses[i] != Address)
+        {
+            continue;
+        }
+
+        TrampolineSize = InstructionRelocationRelocate(InstructionBuffer,
+                                                       BufferLength,
+                                                       Address,
+                                                       RelocatedTrampoline,
+                                                       (UINT64)Trampoline,
+                                                       MAX_EXEC_TRAMPOLINE_SIZE);
+
+        if (TrampolineSize != 0 && RtlCompareMemory(RelocatedTrampoline, Trampoline, TrampolineSize) == TrampolineSize)
+        {
+            HookedEntry->RetiredTrampolines[i]                 = NULL;
+            HookedEntry->RetiredTrampolineAddresses[i]         = NULL64_ZERO;
+            HookedEntry->DisplacedTrampolines[BreakpointIndex] = Trampoline;
+
+            return TRUE;
+        }
+    }
+
+    Trampoline = (PCHAR)PoolManagerRequestPool(EXEC_TRAMPOLINE, TRUE, MAX_EXEC_TRAMPOLINE_SIZE);
+
+    if (Trampoline == NULL)
+    {
+        return FALSE;
+    }
+
+    if (!InstructionRelocationRelocate(InstructionBuffer,
+                                       BufferLength,
+                                       Address,
+                                       Trampoline,
+                                       (UINT64)Trampoline,
+                                       MAX_EXEC_TRAMPOLINE_SIZE))
+    {
+        PoolManagerFreePool((UINT64)Trampoline);
+        return FALSE;
+    }
+
+    HookedEntry->DisplacedTrampolines[BreakpointIndex] = Trampoline;
+
+    return TRUE;
+}
+
+/**
+ * @brief Retire the trampoline of a hidden breakpoint that is removed
+ * @details the trampoline is not freed as a thread might still be executing it,
+ * it's kept in the hooked page to be reused by DisplacedExecutionBuildTrampoline,
+ * if there is no empty slot, the trampoline is left allocated without being tracked
+ *
+ * @param HookedEntry The hooked page
+ * @param BreakpointIndex The index of the breakpoint in the hooked page
+ *
+ * @return VOID
+ */
+VOID
+DisplacedExecutionRetireTrampoline(PEPT_HOOKED_PAGE_DETAIL HookedEntry, UINT32 BreakpointIndex)
+{
+    PCHAR Trampoline = HookedEntry->DisplacedTrampolines[BreakpointIndex];
+
+    HookedEntry->DisplacedTrampolines[BreakpointIndex] = NULL;
+
+    if (Trampoline == NULL)
+    {
+        return;
+    }
+
+    for (UINT32 i = 0; i < MaximumHiddenBreakpointsOnPage; i++)
+    {
+        if (HookedEntry->RetiredTrampolines[i] == NULL)
+        {
+            HookedEntry->RetiredTrampolineAddresses[i] = HookedEntry->BreakpointAddresses[BreakpointIndex];
+            HookedEntry->RetiredTrampolines[i]         = Trampoline;
+
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Continue the guest from the trampoline of a hidden breakpoint
+ * @details should be called from vmx-root mode after triggering the event,
+ * the guest is not redirected if the event changed the RIP, or if the
+ * instruction should be single-stepped (trap flag, MTF, data breakpoints)
+ *
+ * @param VCpu The virtual processor's state
+ * @param HookedEntry The hooked page
+ * @param GuestRip The address of the breakpoint
+ *
+ * @return BOOLEAN FALSE if the instruction should be executed using MTF
+ */
+BOOLEAN
+DisplacedExecutionResumeInTrampoline(VIRTUAL_MACHINE_STATE * VCpu,
+                                     PEPT_HOOKED_PAGE_DETAIL HookedEntry,
+                                     UINT64                  GuestRip)
+{
+    PCHAR  Trampoline = NULL;
+    UINT32 ProcessorBasedControls;
+    DR7    Dr7 = {0};
+
+    for (UINT32 i = 0; i < HookedEntry->CountOfBreakpoints; i++)
+    {
+        if (HookedEntry->BreakpointAddresses[i] == GuestRip && HookedEntry->DisplacedTrampolines[i] != NULL)
+        {
+            Trampoline = HookedEntry->DisplacedTrampolines[i];
+            break;
+        }
+    }
+
+    if (Trampoline == NULL || VCpu->RegisterBreakOnMtf || HvGetRip() != GuestRip)
+    {
+        return FALSE;
+    }
+
+    if (HvGetRflags() & X86_FLAGS_TF)
+    {
+        return FALSE;
+    }
+
+    VmxVmread32P(VMCS_CTRL_PROCESSOR_BASED_VM_EXECUTION_CONTROLS, &ProcessorBasedControls);
+
+    if (ProcessorBasedControls & CPU_BASED_MONITOR_TRAP_FLAG)
+    {
+        return FALSE;
+    }
+
+    VmxVmread64P(VMCS_GUEST_DR7, &Dr7.AsUInt);
+
+    if (Dr7.AsUInt & 0xff)
+    {
+        return FALSE;
+    }
+
+    HvSetRip((UINT64)Trampoline);
+
+    return TRUE;
+}
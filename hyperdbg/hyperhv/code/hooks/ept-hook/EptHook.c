@@ -89,6 +89,7 @@ EptHookReservePreallocatedPoolsForEptHooks(UINT32 Count)
 
     //
     // Request pages to be allocated for Trampoline of Executable hooked pages
+    // (or the trampoline of the displaced instruction of hidden breakpoints)
     //
     PoolManagerRequestAllocation(MAX_EXEC_TRAMPOLINE_SIZE, Count, EXEC_TRAMPOLINE);
 
@@ -96,6 +97,30 @@ EptHookReservePreallocatedPoolsForEptHooks(UINT32 Count)
     // Request pages to be allocated for detour hooked pages details
     //
     PoolManagerRequestAllocation(sizeof(HIDDEN_HOOKS_DETOUR_DETAILS), Count, DETOUR_HOOK_DETAILS);
+
+    //
+    // Request pages to be allocated for the sub-page permission (SPP) tables
+    //
+    if (g_CompatibilityCheck.SubPageWritePermissionsSupport)
+    {
+        PoolManagerRequestAllocation(sizeof(SPP_TABLE), Count, SUB_PAGE_PERMISSION_TABLE);
+    }
+
+    //
+    // Request pages to be allocated for the paging tables that are copied
+    // for the original EPT view of each core
+    //
+    PoolManagerRequestAllocation(sizeof(EPT_VIEW_PAGING_TABLE),
+                                 Count * ProcessorsCount,
+                                 EPT_VIEW_PAGING_STRUCTURE);
+
+    //
+    // Request pages to be allocated for the descriptors of the monitored
+    // physical ranges
+    //
+    PoolManagerRequestAllocation(sizeof(EPT_MONITOR_RANGE),
+                                 Count,
+                                 MONITOR_RANGE_DESCRIPTOR);
 }
 
 /**
@@ -130,6 +155,33 @@ EptHookAllocateExtraHookingPagesForMemoryMonitorsAndExecEptHooks(UINT32 Count)
     PoolManagerRequestAllocation(sizeof(EPT_HOOKED_PAGE_DETAIL),
                                  Count,
                                  TRACKING_HOOKED_PAGES);
+
+    //
+    // Request pages to be allocated for the sub-page permission (SPP) tables
+    // of the memory monitors (mostly a single SPPL1 table for each page)
+    //
+    if (g_CompatibilityCheck.SubPageWritePermissionsSupport)
+    {
+        PoolManagerRequestAllocation(sizeof(SPP_TABLE),
+                                     Count,
+                                     SUB_PAGE_PERMISSION_TABLE);
+    }
+
+    //
+    // Request pages to be allocated for the paging tables that are copied
+    // for the original EPT view of each core
+    //
+    PoolManagerRequestAllocation(sizeof(EPT_VIEW_PAGING_TABLE),
+                                 Count * ProcessorsCount,
+                                 EPT_VIEW_PAGING_STRUCTURE);
+
+    //
+    // Request pages to be allocated for the descriptors of the monitored
+    // physical ranges
+    //
+    PoolManagerRequestAllocation(sizeof(EPT_MONITOR_RANGE),
+                                 Count,
+                                 MONITOR_RANGE_DESCRIPTOR);
 }
 
 /**
@@ -156,6 +208,12 @@ EptHookCreateHookPage(_Inout_ VIRTUAL_MACHINE_STATE * VCpu,
     PEPT_HOOKED_PAGE_DETAIL HookedPage;
     CR3_TYPE                Cr3OfCurrentProcess;
 
+    //
+    // The EPT caches of all the cores (including the current core) are invalidated
+    // before their next VM-entry
+    //
+    UNREFERENCED_PARAMETER(VCpu);
+
     //
     // Get number of processors
     //
@@ -185,6 +243,15 @@ EptHookCreateHookPage(_Inout_ VIRTUAL_MACHINE_STATE * VCpu,
         return FALSE;
     }
 
+    //
+    // The pages of the monitored ranges can't be hooked
+    //
+    if (MonitorRangeIsOverlapping(PhysicalBaseAddress, PhysicalBaseAddress + PAGE_SIZE - 1))
+    {
+        VmmCallbackSetLastError(DEBUGGER_ERROR_EPT_MULTIPLE_HOOKS_IN_A_SINGLE_PAGE);
+        return FALSE;
+    }
+
     //
     // Save the detail of hooked page to keep track of it
     //
@@ -250,6 +317,14 @@ EptHookCreateHookPage(_Inout_ VIRTUAL_MACHINE_STATE * VCpu,
     //
     MemoryMapperReadMemorySafe((UINT64)VirtualTarget, &HookedPage->FakePageContents, PAGE_SIZE);
 
+    //
+    // Save the previous byte and relocate the instruction into a trampoline
+    // (if possible) before it's overwritten
+    //
+    HookedPage->PreviousBytesOnBreakpointAddresses[0] = *(BYTE *)TargetAddressInFakePageContent;
+
+    DisplacedExecutionBuildTrampoline(HookedPage, 0);
+
     //
     // we set the breakpoint on the fake page
     //
@@ -350,19 +425,21 @@ EptHookCreateHookPage(_Inout_ VIRTUAL_MACHINE_STATE * VCpu,
         }
 
         //
-        // Apply the hook to EPT
+        // The original view of the core keeps the original entry of the page
         //
-        TargetPage->AsUInt = ChangedEntry.AsUInt;
+        EptViewSetOriginalEntry(&g_GuestState[i], HookedPage->PhysicalBaseAddress, HookedPage->OriginalEntry);
 
         //
-        // If it's the current core then we invalidate the EPT
+        // Apply the hook to EPT
         //
-        if (VCpu->CoreId == i && g_GuestState[i].HasLaunched)
-        {
-            EptInveptSingleContext(VCpu->EptPointer.AsUInt);
-        }
+        TargetPage->AsUInt = ChangedEntry.AsUInt;
     }
 
+    //
+    // All the cores invalidate their EPT caches before their next VM-entry
+    //
+    EptInveptDeferAllCores();
+
     return TRUE;
 }
 
@@ -422,6 +499,11 @@ EptHookUpdateHookPage(_In_ PVOID                       TargetAddress,
     //
     HookedEntry->PreviousBytesOnBreakpointAddresses[HookedEntry->CountOfBreakpoints] = OriginalByte;
 
+    //
+    // Relocate the instruction into a trampoline (if possible)
+    //
+    DisplacedExecutionBuildTrampoline(HookedEntry, (UINT32)HookedEntry->CountOfBreakpoints);
+
     //
     // Add to the breakpoint counts
     //
@@ -679,9 +761,9 @@ EptHookRestoreSingleHookToOriginalEntry(VIRTUAL_MACHINE_STATE *     VCpu,
         TargetPage->AsUInt = OriginalEntry;
 
         //
-        // Invalidate EPT Cache
+        // Invalidate EPT Cache (before the next VM-entry)
         //
-        EptInveptSingleContext(VCpu->EptPointer.AsUInt);
+        EptInveptDefer(VCpu, InveptSingleContext);
 
         return TRUE;
     }
@@ -713,6 +795,11 @@ EptHookRestoreAllHooksToOriginalEntry(VIRTUAL_MACHINE_STATE * VCpu)
         return;
     }
 
+    //
+    // The monitored ranges are restored on all the cores at once
+    //
+    MonitorRangeRemoveAll();
+
     LIST_FOR_EACH_LINK(g_EptState->HookedPagesList, EPT_HOOKED_PAGE_DETAIL, PageHookList, HookedEntry)
     {
         //
@@ -727,9 +814,9 @@ EptHookRestoreAllHooksToOriginalEntry(VIRTUAL_MACHINE_STATE * VCpu)
     }
 
     //
-    // Invalidate EPT Cache
+    // Invalidate EPT Cache (before the next VM-entry)
     //
-    EptInveptSingleContext(VCpu->EptPointer.AsUInt);
+    EptInveptDefer(VCpu, InveptSingleContext);
 }
 
 /**
@@ -999,12 +1086,30 @@ EptHookPerformPageHookMonitorAndInlineHook(VIRTUAL_MACHINE_STATE * VCpu,
     BOOLEAN                 UnsetRead     = FALSE;
     BOOLEAN                 UnsetWrite    = FALSE;
     BOOLEAN                 EptHiddenHook = FALSE;
+    BOOLEAN                 SubPageWrites = FALSE;
+
+    //
+    // The EPT caches of all the cores (including the current core) are invalidated
+    // before their next VM-entry
+    //
+    UNREFERENCED_PARAMETER(VCpu);
 
     UnsetRead     = (PageHookMask & PAGE_ATTRIB_READ) ? TRUE : FALSE;
     UnsetWrite    = (PageHookMask & PAGE_ATTRIB_WRITE) ? TRUE : FALSE;
     UnsetExecute  = (PageHookMask & PAGE_ATTRIB_EXEC) ? TRUE : FALSE;
     EptHiddenHook = (PageHookMask & PAGE_ATTRIB_EXEC_HIDDEN_HOOK) ? TRUE : FALSE;
 
+    //
+    // The monitors that are larger than a page are kept as a single range
+    // descriptor (instead of a hooked page detail for each page)
+    //
+    if (!EptHiddenHook &&
+        PAGE_ALIGN(((EPT_HOOKS_ADDRESS_DETAILS_FOR_MEMORY_MONITOR *)HookingDetails)->StartAddress) !=
+            PAGE_ALIGN(((EPT_HOOKS_ADDRESS_DETAILS_FOR_MEMORY_MONITOR *)HookingDetails)->EndAddress))
+    {
+        return MonitorRangeApply(HookingDetails, ProcessCr3, PageHookMask);
+    }
+
     //
     // Get number of processors
     //
@@ -1075,6 +1180,15 @@ EptHookPerformPageHookMonitorAndInlineHook(VIRTUAL_MACHINE_STATE * VCpu,
         }
     }
 
+    //
+    // The page might be in a monitored range
+    //
+    if (MonitorRangeIsOverlapping(PhysicalBaseAddress, PhysicalBaseAddress + PAGE_SIZE - 1))
+    {
+        VmmCallbackSetLastError(DEBUGGER_ERROR_EPT_MULTIPLE_HOOKS_IN_A_SINGLE_PAGE);
+        return FALSE;
+    }
+
     //
     // Save the detail of hooked page to keep track of it
     //
@@ -1162,6 +1276,19 @@ EptHookPerformPageHookMonitorAndInlineHook(VIRTUAL_MACHINE_STATE * VCpu,
             VmmCallbackSetLastError(DEBUGGER_ERROR_INVALID_ADDRESS);
             return FALSE;
         }
+
+        //
+        // If only the writes are monitored, the sub-page write permissions (SPP) are
+        // used (if supported) so the writes to the 128-byte sub-pages that are not in
+        // the target range won't cause EPT violations. Otherwise (or if the SPP table
+        // could not be built), the whole page is write-protected
+        //
+        if (UnsetWrite && !UnsetRead)
+        {
+            SubPageWrites = SppApplyToMonitoredPage(HookedPage->PhysicalBaseAddress,
+                                                    HookedPage->StartOfTargetPhysicalAddress,
+                                                    HookedPage->EndOfTargetPhysicalAddress);
+        }
     }
 
     //
@@ -1297,6 +1424,9 @@ EptHookPerformPageHookMonitorAndInlineHook(VIRTUAL_MACHINE_STATE * VCpu,
         else
             ChangedEntry.ExecuteAccess = 1;
 
+        if (SubPageWrites)
+            ChangedEntry.AsUInt |= SPP_EPT_ENTRY_SUB_PAGE_WRITE_PERMISSIONS_FLAG;
+
         //
         // If it's Execution hook then we have to set extra fields
         //
@@ -1336,19 +1466,21 @@ EptHookPerformPageHookMonitorAndInlineHook(VIRTUAL_MACHINE_STATE * VCpu,
         }
 
         //
-        // Apply the hook to EPT
+        // The original view of the core keeps the original entry of the page
         //
-        TargetPage->AsUInt = ChangedEntry.AsUInt;
+        EptViewSetOriginalEntry(&g_GuestState[i], HookedPage->PhysicalBaseAddress, HookedPage->OriginalEntry);
 
         //
-        // If it's the current core then we invalidate the EPT
+        // Apply the hook to EPT
         //
-        if (VCpu->CoreId == i && g_GuestState[i].HasLaunched)
-        {
-            EptInveptSingleContext(VCpu->EptPointer.AsUInt);
-        }
+        TargetPage->AsUInt = ChangedEntry.AsUInt;
     }
 
+    //
+    // All the cores invalidate their EPT caches before their next VM-entry
+    //
+    EptInveptDeferAllCores();
+
     return TRUE;
 }
 
@@ -1953,6 +2085,49 @@ EptHookUnHookSingleAddressDetoursAndMonitor(PEPT_HOOKED_PAGE_DETAIL
     return TRUE;
 }
 
+/**
+ * @brief Trigger the post event of the last violation of a hooked page
+ * @details used for events relating the !monitor command and the emulation
+ * hardware debug registers, after the instruction is executed or emulated
+ *
+ * @param VCpu The virtual processor's state
+ * @param HookedEntry The entry that describes the hooked page
+ * @return VOID
+ */
+VOID
+EptHookTriggerPostEvent(VIRTUAL_MACHINE_STATE * VCpu, PEPT_HOOKED_PAGE_DETAIL HookedEntry)
+{
+    if (!HookedEntry->IsPostEventTriggerAllowed)
+    {
+        return;
+    }
+
+    if (HookedEntry->LastViolation == EPT_HOOKED_LAST_VIOLATION_READ)
+    {
+        //
+        // This is a "read" hook
+        //
+        DispatchEventHiddenHookPageReadWriteExecReadPostEvent(VCpu,
+                                                              &HookedEntry->LastContextState);
+    }
+    else if (HookedEntry->LastViolation == EPT_HOOKED_LAST_VIOLATION_WRITE)
+    {
+        //
+        // This is a "write" hook
+        //
+        DispatchEventHiddenHookPageReadWriteExecWritePostEvent(VCpu,
+                                                               &HookedEntry->LastContextState);
+    }
+    else if (HookedEntry->LastViolation == EPT_HOOKED_LAST_VIOLATION_EXEC)
+    {
+        //
+        // This is a "execute" hook
+        //
+        DispatchEventHiddenHookPageReadWriteExecExecutePostEvent(VCpu,
+                                                                 &HookedEntry->LastContextState);
+    }
+}
+
 /**
  * @brief Handle vm-exits for Monitor Trap Flag to restore previous state
  *
@@ -1963,50 +2138,32 @@ VOID
 EptHookHandleMonitorTrapFlag(VIRTUAL_MACHINE_STATE * VCpu)
 {
     PVOID TargetPage;
-    //
-    // Pointer to the page entry in the page table
-    //
-    TargetPage = EptGetPml1Entry(VCpu->EptPageTable, VCpu->MtfEptHookRestorePoint->PhysicalBaseAddress);
 
     //
-    // restore the hooked state
+    // If the instruction is executed on the original view, switching
+    // back to the core's EPT restores the hooked state
     //
-    EptSetPML1AndInvalidateTLB(VCpu,
-                               TargetPage,
-                               VCpu->MtfEptHookRestorePoint->ChangedEntry,
-                               InveptSingleContext);
+    if (!EptViewRestoreNormalView(VCpu))
+    {
+        //
+        // Pointer to the page entry in the page table
+        //
+        TargetPage = EptGetPml1Entry(VCpu->EptPageTable, VCpu->MtfEptHookRestorePoint->PhysicalBaseAddress);
+
+        //
+        // restore the hooked state
+        //
+        EptSetPML1AndInvalidateTLB(VCpu,
+                                   TargetPage,
+                                   VCpu->MtfEptHookRestorePoint->ChangedEntry,
+                                   InveptSingleContext);
+    }
 
     //
     // Check to trigger the post event (for events relating the !monitor command
     // and the emulation hardware debug registers)
     //
-    if (VCpu->MtfEptHookRestorePoint->IsPostEventTriggerAllowed)
-    {
-        if (VCpu->MtfEptHookRestorePoint->LastViolation == EPT_HOOKED_LAST_VIOLATION_READ)
-        {
-            //
-            // This is a "read" hook
-            //
-            DispatchEventHiddenHookPageReadWriteExecReadPostEvent(VCpu,
-                                                                  &VCpu->MtfEptHookRestorePoint->LastContextState);
-        }
-        else if (VCpu->MtfEptHookRestorePoint->LastViolation == EPT_HOOKED_LAST_VIOLATION_WRITE)
-        {
-            //
-            // This is a "write" hook
-            //
-            DispatchEventHiddenHookPageReadWriteExecWritePostEvent(VCpu,
-                                                                   &VCpu->MtfEptHookRestorePoint->LastContextState);
-        }
-        else if (VCpu->MtfEptHookRestorePoint->LastViolation == EPT_HOOKED_LAST_VIOLATION_EXEC)
-        {
-            //
-            // This is a "execute" hook
-            //
-            DispatchEventHiddenHookPageReadWriteExecExecutePostEvent(VCpu,
-                                                                     &VCpu->MtfEptHookRestorePoint->LastContextState);
-        }
-    }
+    EptHookTriggerPostEvent(VCpu, VCpu->MtfEptHookRestorePoint);
 
     //
     // Check for user-mode attaching mechanisms and callback
@@ -2092,6 +2249,7 @@ EptHookUnHookSingleAddressHiddenBreakpoint(PEPT_HOOKED_PAGE_DETAIL             H
                 //
                 // we add the hooked entry to the list
                 // of pools that will be deallocated on next IOCTL
+                // (its trampolines are not freed as a thread might still be executing them)
                 //
                 if (!PoolManagerFreePool((UINT64)HookedEntry))
                 {
@@ -2158,6 +2316,12 @@ EptHookUnHookSingleAddressHiddenBreakpoint(PEPT_HOOKED_PAGE_DETAIL             H
                     *(BYTE *)TargetAddressInFakePageContent = HookedEntry->PreviousBytesOnBreakpointAddresses[i];
                 }
 
+                //
+                // The trampoline is not freed as a thread might still be executing it,
+                // it's kept to be reused by another breakpoint on the same address
+                //
+                DisplacedExecutionRetireTrampoline(HookedEntry, (UINT32)i);
+
                 //
                 // Remove just that special entry
                 // BTW, No need to remove it, it will be replaced automatically
@@ -2173,6 +2337,7 @@ EptHookUnHookSingleAddressHiddenBreakpoint(PEPT_HOOKED_PAGE_DETAIL             H
                 {
                     HookedEntry->BreakpointAddresses[j]                = HookedEntry->BreakpointAddresses[j + 1];
                     HookedEntry->PreviousBytesOnBreakpointAddresses[j] = HookedEntry->PreviousBytesOnBreakpointAddresses[j + 1];
+                    HookedEntry->DisplacedTrampolines[j]               = HookedEntry->DisplacedTrampolines[j + 1];
                 }
 
                 //
@@ -2244,6 +2409,22 @@ EptHookPerformUnHookSingleAddress(UINT64                              VirtualAdd
         }
     }
 
+    //
+    // The monitored ranges are removed by their tags, the other cores might
+    // hold the protected entries in their EPT caches until their next VM-entry,
+    // but the violations of the removed ranges are retried after invalidating
+    // the caches, so they don't need to be notified
+    //
+    if (HookingTag != NULL64_ZERO &&
+        (ApplyDirectlyFromVmxRoot ? MonitorRangeRemoveByHookingTag(HookingTag)
+                                  : AsmVmxVmcall(VMCALL_REMOVE_MONITOR_RANGE, HookingTag, NULL64_ZERO, NULL64_ZERO) == STATUS_SUCCESS))
+    {
+        TargetUnhookingDetails->CallerNeedsToRestoreEntryAndInvalidateEpt = FALSE;
+        TargetUnhookingDetails->RemoveBreakpointInterception              = FALSE;
+
+        return TRUE;
+    }
+
     LIST_FOR_EACH_LINK(g_EptState->HookedPagesList, EPT_HOOKED_PAGE_DETAIL, PageHookList, CurrEntity)
     {
         //
@@ -2463,7 +2644,9 @@ EptHookUnHookAll()
 
         //
         // As we are in vmx-root here, we add the hooked entry to the list
-        // of pools that will be deallocated on next IOCTL
+        // of pools that will be deallocated on next IOCTL (the trampolines
+        // of hidden breakpoints are not freed as a thread might still be
+        // executing them)
         //
         if (!PoolManagerFreePool((UINT64)CurrEntity))
         {
@@ -2603,9 +2786,9 @@ EptHookModifyInstructionFetchState(VIRTUAL_MACHINE_STATE * VCpu,
     }
 
     //
-    // Invalidate the EPTP (single-context)
+    // Invalidate the EPTP (single-context) before the next VM-entry
     //
-    EptInveptSingleContext(VCpu->EptPointer.AsUInt);
+    EptInveptDefer(VCpu, InveptSingleContext);
 
     return TRUE;
 }
@@ -2661,9 +2844,9 @@ EptHookModifyPageReadState(VIRTUAL_MACHINE_STATE * VCpu,
     }
 
     //
-    // Invalidate the EPTP (single-context)
+    // Invalidate the EPTP (single-context) before the next VM-entry
     //
-    EptInveptSingleContext(VCpu->EptPointer.AsUInt);
+    EptInveptDefer(VCpu, InveptSingleContext);
 
     return TRUE;
 }
@@ -2719,9 +2902,9 @@ EptHookModifyPageWriteState(VIRTUAL_MACHINE_STATE * VCpu,
     }
 
     //
-    // Invalidate the EPTP (single-context)
+    // Invalidate the EPTP (single-context) before the next VM-entry
     //
-    EptInveptSingleContext(VCpu->EptPointer.AsUInt);
+    EptInveptDefer(VCpu, InveptSingleContext);
 
     return TRUE;
 }
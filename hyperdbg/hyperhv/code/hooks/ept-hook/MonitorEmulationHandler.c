@@ -0,0 +1,213 @@
+/**
+ * @file MonitorEmulationHandler.c
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Emulation of the memory accesses to the monitored pages
+ * @details The common data-access instructions that cause EPT violations
+ * on the pages of the '!monitor' command are emulated in VMX-root mode, so
+ * the hook is not removed, and no MTF (and no second vm-exit and INVEPT)
+ * is needed. Other instructions are executed by the guest (MTF)
+ *
+ * @version 0.11
+ * @date 2024-10-27
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Read the accessed page of the guest
+ *
+ * @param Address physical address
+ * @param Buffer
+ * @param Size
+ * @param Context not used
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+MonitorEmulationReadGuestPhysical(UINT64 Address, PVOID Buffer, UINT32 Size, PVOID Context)
+{
+    UNREFERENCED_PARAMETER(Context);
+
+    return MemoryMapperReadMemorySafeByPhysicalAddress(Address, (UINT64)Buffer, Size);
+}
+
+/**
+ * @brief Write the accessed page of the guest
+ *
+ * @param Address physical address
+ * @param Buffer
+ * @param Size
+ * @param Context not used
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+MonitorEmulationWriteGuestPhysical(UINT64 Address, PVOID Buffer, UINT32 Size, PVOID Context)
+{
+    UNREFERENCED_PARAMETER(Context);
+
+    return MemoryMapperWriteMemorySafeByPhysicalAddress(Address, (UINT64)Buffer, Size);
+}
+
+/**
+ * @brief Read the memory of the guest (the source of MOVS)
+ *
+ * @param Address virtual address (in the current process)
+ * @param Buffer
+ * @param Size
+ * @param Context not used
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+MonitorEmulationReadGuestLinear(UINT64 Address, PVOID Buffer, UINT32 Size, PVOID Context)
+{
+    UNREFERENCED_PARAMETER(Context);
+
+    return MemoryMapperReadMemorySafeOnTargetProcess(Address, Buffer, Size);
+}
+
+/**
+ * @brief Routines that access the memory of the guest
+ *
+ */
+static MONITOR_EMULATION_MEMORY MonitorEmulationGuestMemory = {
+    MonitorEmulationReadGuestPhysical,
+    MonitorEmulationWriteGuestPhysical,
+    MonitorEmulationReadGuestLinear,
+    NULL,
+};
+
+/**
+ * @brief Emulate the instruction that caused an EPT violation on a
+ * monitored page
+ * @details This function should be called from VMX-root mode, if the
+ * instruction is emulated, the guest registers and RIP are updated and
+ * the hook should not be restored
+ *
+ * @param VCpu The virtual processor's state
+ * @param ViolationQualification The exit qualification of the EPT violation
+ * @param GuestPhysicalAddr The physical address that caused the violation
+ *
+ * @return BOOLEAN TRUE if the instruction is emulated, FALSE if it should
+ * be executed by the guest (MTF)
+ */
+BOOLEAN
+MonitorEmulationHandleAccess(VIRTUAL_MACHINE_STATE *              VCpu,
+                             VMX_EXIT_QUALIFICATION_EPT_VIOLATION ViolationQualification,
+                             UINT64                               GuestPhysicalAddr)
+{
+    MONITOR_EMULATION_INSTRUCTION Instruction;
+    UINT8                         InstructionBuffer[MONITOR_EMULATION_MAXIMUM_INSTRUCTION_LENGTH];
+    UINT32                        InstructionBufferSize;
+    UINT32                        ProcessorBasedControls = 0;
+    UINT64                        LinearAddress          = 0;
+    UINT64                        Rflags;
+    UINT64                        Rip;
+    DR7                           Dr7 = {0};
+
+    //
+    // Only the data accesses are emulated, the exact linear address is needed,
+    // and the accesses to the guest paging structures are not emulated
+    //
+    if (ViolationQualification.ExecuteAccess ||
+        (!ViolationQualification.ReadAccess && !ViolationQualification.WriteAccess) ||
+        !ViolationQualification.ValidGuestLinearAddress ||
+        !ViolationQualification.CausedByTranslation)
+    {
+        return FALSE;
+    }
+
+    //
+    // The single-step traps, MTF steps, and the data breakpoints should be
+    // delivered after the instruction, so these instructions are not emulated
+    //
+    Rflags = HvGetRflags();
+
+    if (Rflags & X86_FLAGS_TF)
+    {
+        return FALSE;
+    }
+
+    VmxVmread32P(VMCS_CTRL_PROCESSOR_BASED_VM_EXECUTION_CONTROLS, &ProcessorBasedControls);
+
+    if (ProcessorBasedControls & CPU_BASED_MONITOR_TRAP_FLAG)
+    {
+        return FALSE;
+    }
+
+    VmxVmread64P(VMCS_GUEST_DR7, &Dr7.AsUInt);
+
+    if (Dr7.AsUInt & 0xff)
+    {
+        return FALSE;
+    }
+
+    if (CommonIsGuestOnUsermode32Bit())
+    {
+        return FALSE;
+    }
+
+    //
+    // Read the instruction (instructions that cross the page are not emulated)
+    //
+    Rip                   = HvGetRip();
+    InstructionBufferSize = PAGE_SIZE - (UINT32)(Rip & (PAGE_SIZE - 1));
+
+    if (InstructionBufferSize > MONITOR_EMULATION_MAXIMUM_INSTRUCTION_LENGTH)
+    {
+        InstructionBufferSize = MONITOR_EMULATION_MAXIMUM_INSTRUCTION_LENGTH;
+    }
+
+    if (!MemoryMapperReadMemorySafeOnTargetProcess(Rip, InstructionBuffer, InstructionBufferSize) ||
+        !MonitorEmulationDecode(InstructionBuffer, InstructionBufferSize, &Instruction))
+    {
+        return FALSE;
+    }
+
+    //
+    // ReadableWritablePage is the EPT write permission of the page, not the R/W
+    // bit of the guest paging. The instructions that write the memory are only
+    // emulated when the violation itself was a write, as the guest page walk has
+    // already checked the write permission then, or when the EPT entry allows writes
+    //
+    if (Instruction.IsMemoryWritten && !ViolationQualification.WriteAccess && !ViolationQualification.ReadableWritablePage)
+    {
+        return FALSE;
+    }
+
+    if (Instruction.SegmentPrefix == 0x64)
+    {
+        __vmx_vmread(VMCS_GUEST_FS_BASE, &Instruction.SegmentBase);
+    }
+    else if (Instruction.SegmentPrefix == 0x65)
+    {
+        __vmx_vmread(VMCS_GUEST_GS_BASE, &Instruction.SegmentBase);
+    }
+
+    __vmx_vmread(VMCS_EXIT_GUEST_LINEAR_ADDRESS, &LinearAddress);
+
+    if (!MonitorEmulationExecute(&Instruction,
+                                 VCpu->Regs,
+                                 &Rflags,
+                                 Rip,
+                                 LinearAddress,
+                                 GuestPhysicalAddr,
+                                 (BOOLEAN)ViolationQualification.WriteAccess,
+                                 &MonitorEmulationGuestMemory))
+    {
+        return FALSE;
+    }
+
+    //
+    // The instruction is completed, so the STI and MOV SS blocking and the
+    // resume flag are cleared
+    //
+    HvSetRflags(Rflags & ~(UINT64)X86_FLAGS_RF);
+    HvSetRip(Rip + Instruction.Length);
+    HvSetInterruptibilityState(HvClearSteppingBits(HvGetInterruptibilityState()));
+
+    return TRUE;
+}
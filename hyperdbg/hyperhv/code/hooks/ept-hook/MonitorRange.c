@@ -0,0 +1,824 @@
+/**
+ * @file MonitorRange.c
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Implementation of the range descriptors of the memory monitors
+ * @details a physically contiguous range that is larger than a page is kept
+ * as a single descriptor (instead of a hooked page detail for each page), the
+ * 2MB regions that are completely in the range keep their large pages and only
+ * the regions at the edges of the range are split
+ *
+ * @version 0.11
+ * @date 2024-10-31
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Get the number of the ranges that start at or below an address
+ * @details should be called while holding the lock of the ranges
+ *
+ * @param PhysicalAddress The target physical address
+ *
+ * @return UINT32 The index that the descriptor of the address should be inserted
+ */
+static UINT32
+MonitorRangeGetIndex(SIZE_T PhysicalAddress)
+{
+    UINT32 Low  = 0;
+    UINT32 High = g_EptState->NumberOfMonitorRanges;
+    UINT32 Middle;
+
+    while (Low < High)
+    {
+        Middle = Low + (High - Low) / 2;
+
+        if (g_EptState->MonitorRanges[Middle]->PhysicalBaseAddress <= PhysicalAddress)
+        {
+            Low = Middle + 1;
+        }
+        else
+        {
+            High = Middle;
+        }
+    }
+
+    return Low;
+}
+
+/**
+ * @brief Find the range that contains a physical address
+ * @details should be called while holding the lock of the ranges
+ *
+ * @param PhysicalAddress The target physical address
+ *
+ * @return PEPT_MONITOR_RANGE NULL if the address is not monitored by a range
+ */
+static PEPT_MONITOR_RANGE
+MonitorRangeFindUnsafe(SIZE_T PhysicalAddress)
+{
+    UINT32             Index;
+    PEPT_MONITOR_RANGE Range;
+
+    Index = MonitorRangeGetIndex(PhysicalAddress);
+
+    if (Index == 0)
+    {
+        return NULL;
+    }
+
+    Range = g_EptState->MonitorRanges[Index - 1];
+
+    return PhysicalAddress <= Range->PhysicalEndAddress ? Range : NULL;
+}
+
+/**
+ * @brief Find the range that contains a physical address
+ *
+ * @param PhysicalAddress The target physical address
+ *
+ * @return PEPT_MONITOR_RANGE NULL if the address is not monitored by a range
+ */
+PEPT_MONITOR_RANGE
+MonitorRangeFind(SIZE_T PhysicalAddress)
+{
+    PEPT_MONITOR_RANGE Range;
+
+    //
+    // Avoid the lock if there is no range
+    //
+    if (g_EptState->NumberOfMonitorRanges == 0)
+    {
+        return NULL;
+    }
+
+    SpinlockLock(&g_EptState->MonitorRangesLock);
+
+    Range = MonitorRangeFindUnsafe(PhysicalAddress);
+
+    SpinlockUnlock(&g_EptState->MonitorRangesLock);
+
+    return Range;
+}
+
+/**
+ * @brief Check whether a physical range overlaps the monitored ranges
+ * @details should be called while holding the lock of the ranges
+ *
+ * @param PhysicalBaseAddress The first byte of the range
+ * @param PhysicalEndAddress The last byte of the range
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+MonitorRangeIsOverlappingUnsafe(SIZE_T PhysicalBaseAddress, SIZE_T PhysicalEndAddress)
+{
+    UINT32 Index;
+
+    //
+    // As the ranges are sorted and don't overlap, only the last range that
+    // starts at or below the end of the target might overlap it
+    //
+    Index = MonitorRangeGetIndex(PhysicalEndAddress);
+
+    return Index != 0 && g_EptState->MonitorRanges[Index - 1]->PhysicalEndAddress >= PhysicalBaseAddress;
+}
+
+/**
+ * @brief Check whether a physical range overlaps the monitored ranges
+ *
+ * @param PhysicalBaseAddress The first byte of the range
+ * @param PhysicalEndAddress The last byte of the range
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+MonitorRangeIsOverlapping(SIZE_T PhysicalBaseAddress, SIZE_T PhysicalEndAddress)
+{
+    BOOLEAN Result;
+
+    if (g_EptState->NumberOfMonitorRanges == 0)
+    {
+        return FALSE;
+    }
+
+    SpinlockLock(&g_EptState->MonitorRangesLock);
+
+    Result = MonitorRangeIsOverlappingUnsafe(PhysicalBaseAddress, PhysicalEndAddress);
+
+    SpinlockUnlock(&g_EptState->MonitorRangesLock);
+
+    return Result;
+}
+
+/**
+ * @brief Get the PML1 (or the large PML2) entry of an address in the EPT of a core
+ *
+ * @param PhysicalAddress The target physical address
+ * @param IsLargePage Set if the address is mapped by a large page
+ * @param Context The EPT page table of the core
+ *
+ * @return PVOID
+ */
+static PVOID
+MonitorRangeGetEptEntry(UINT64 PhysicalAddress, BOOLEAN * IsLargePage, PVOID Context)
+{
+    PVOID Entry = EptGetPml1OrPml2Entry((PVMM_EPT_PAGE_TABLE)Context, (SIZE_T)PhysicalAddress, IsLargePage);
+
+    if (Entry == NULL)
+    {
+        VmmCallbackSetLastError(DEBUGGER_ERROR_EPT_FAILED_TO_GET_PML1_ENTRY_OF_TARGET_ADDRESS);
+    }
+
+    return Entry;
+}
+
+/**
+ * @brief Split the large page of an address in the EPT of a core
+ *
+ * @param PhysicalAddress The target physical address
+ * @param Context The EPT page table of the core
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+MonitorRangeSplitLargePage(UINT64 PhysicalAddress, PVOID Context)
+{
+    PVOID TargetBuffer;
+
+    TargetBuffer = (PVOID)PoolManagerRequestPool(SPLIT_2MB_PAGING_TO_4KB_PAGE, TRUE, sizeof(VMM_EPT_DYNAMIC_SPLIT));
+
+    if (!TargetBuffer)
+    {
+        VmmCallbackSetLastError(DEBUGGER_ERROR_PRE_ALLOCATED_BUFFER_IS_EMPTY);
+        return FALSE;
+    }
+
+    if (!EptSplitLargePage((PVMM_EPT_PAGE_TABLE)Context, TargetBuffer, (SIZE_T)PhysicalAddress))
+    {
+        PoolManagerFreePool((UINT64)TargetBuffer);
+
+        LogDebugInfo("Err, could not split page for the address : 0x%llx", PhysicalAddress);
+        VmmCallbackSetLastError(DEBUGGER_ERROR_EPT_COULD_NOT_SPLIT_THE_LARGE_PAGE_TO_4KB_PAGES);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Get the PML1 (or the large PML2) entry of an address in the original
+ * EPT view of a core
+ *
+ * @param PhysicalAddress The target physical address
+ * @param IsLargePage Set if the address is mapped by a large page
+ * @param Context The view
+ *
+ * @return PVOID
+ */
+static PVOID
+MonitorRangeGetViewEntry(UINT64 PhysicalAddress, BOOLEAN * IsLargePage, PVOID Context)
+{
+    return EptViewGetPml1OrPml2Entry((PEPT_VIEW)Context, (SIZE_T)PhysicalAddress, IsLargePage);
+}
+
+/**
+ * @brief Convert the mask of the monitored accesses to the access bits of
+ * the EPT entries
+ *
+ * @param PageHookMask Mask of the monitored accesses
+ *
+ * @return UINT64
+ */
+static UINT64
+MonitorRangeGetMonitoredAccess(UINT32 PageHookMask)
+{
+    UINT64 MonitoredAccess = 0;
+
+    if (PageHookMask & PAGE_ATTRIB_READ)
+    {
+        MonitoredAccess |= 0x1;
+    }
+
+    if (PageHookMask & PAGE_ATTRIB_WRITE)
+    {
+        MonitoredAccess |= 0x2;
+    }
+
+    if (PageHookMask & PAGE_ATTRIB_EXEC)
+    {
+        MonitoredAccess |= 0x4;
+    }
+
+    return MonitoredAccess;
+}
+
+/**
+ * @brief Protect (or restore) a range in the EPT and the original EPT view
+ * of a core
+ * @details the large pages at the edges of the range are split in the EPT
+ * of the core, the view shares these tables unless it has copied them (for
+ * its hooked pages), should be called from vmx-root mode
+ *
+ * @param VCpu The virtual processor's state
+ * @param Range The descriptor of the range
+ * @param Operation MonitorRangeTableProtect or MonitorRangeTableRestore
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+MonitorRangeApplyToCore(VIRTUAL_MACHINE_STATE * VCpu, PEPT_MONITOR_RANGE Range, MONITOR_RANGE_TABLE_OPERATION Operation)
+{
+    MONITOR_RANGE_TABLE_MEMORY Memory;
+    UINT64                     MonitoredAccess = MonitorRangeGetMonitoredAccess(Range->PageHookMask);
+
+    Memory.GetEntry       = MonitorRangeGetEptEntry;
+    Memory.SplitLargePage = MonitorRangeSplitLargePage;
+    Memory.Context        = VCpu->EptPageTable;
+
+    if (!MonitorRangeTableApply(Range->PhysicalBaseAddress, Range->PhysicalEndAddress, MonitoredAccess, Operation, &Memory))
+    {
+        return FALSE;
+    }
+
+    if (VCpu->OriginalEptView == NULL)
+    {
+        return TRUE;
+    }
+
+    //
+    // The entries that are shared with the EPT of the core are already changed
+    // (the operations don't change an entry twice)
+    //
+    Memory.GetEntry       = MonitorRangeGetViewEntry;
+    Memory.SplitLargePage = NULL;
+    Memory.Context        = VCpu->OriginalEptView;
+
+    if (!MonitorRangeTableApply(Range->PhysicalBaseAddress, Range->PhysicalEndAddress, MonitoredAccess, Operation, &Memory))
+    {
+        VmmCallbackSetLastError(DEBUGGER_ERROR_EPT_FAILED_TO_GET_PML1_ENTRY_OF_TARGET_ADDRESS);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Restore the range on all the cores and remove its descriptor
+ * @details should be called from vmx-root mode while holding the lock of
+ * the ranges, the descriptor is freed by the caller
+ *
+ * @param Index The index of the descriptor
+ *
+ * @return VOID
+ */
+static VOID
+MonitorRangeRemoveUnsafe(UINT32 Index)
+{
+    ULONG              ProcessorsCount;
+    PEPT_MONITOR_RANGE Range = g_EptState->MonitorRanges[Index];
+
+    ProcessorsCount = KeQueryActiveProcessorCount(0);
+
+    //
+    // The lock is held while the entries are restored, so the cores that are
+    // waiting for MTF won't protect the pages of the range again
+    //
+    for (size_t i = 0; i < ProcessorsCount; i++)
+    {
+        MonitorRangeApplyToCore(&g_GuestState[i], Range, MonitorRangeTableRestore);
+    }
+
+    RtlMoveMemory(&g_EptState->MonitorRanges[Index],
+                  &g_EptState->MonitorRanges[Index + 1],
+                  (g_EptState->NumberOfMonitorRanges - Index - 1) * sizeof(PEPT_MONITOR_RANGE));
+
+    g_EptState->NumberOfMonitorRanges--;
+    g_EptState->MonitorRanges[g_EptState->NumberOfMonitorRanges] = NULL;
+}
+
+/**
+ * @brief Monitor a physically contiguous range of pages with a single descriptor
+ * @details should be called from vmx-root mode, the start and the end of the
+ * range should not be on the same page
+ *
+ * @param HookingDetails The details of the monitor
+ * @param ProcessCr3 The process cr3 to translate based on that process's cr3
+ * @param PageHookMask Mask of the monitored accesses
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+MonitorRangeApply(PVOID HookingDetails, CR3_TYPE ProcessCr3, UINT32 PageHookMask)
+{
+    ULONG                                         ProcessorsCount;
+    SIZE_T                                        PhysicalBaseAddress;
+    SIZE_T                                        PhysicalEndAddress;
+    UINT64                                        AlignedStart;
+    UINT64                                        AlignedEnd;
+    UINT32                                        Index;
+    PEPT_MONITOR_RANGE                            Range;
+    PEPT_HOOKS_ADDRESS_DETAILS_FOR_MEMORY_MONITOR MonitorDetails = (PEPT_HOOKS_ADDRESS_DETAILS_FOR_MEMORY_MONITOR)HookingDetails;
+    BOOLEAN                                       IsPhysical     = MonitorDetails->MemoryType == DEBUGGER_MEMORY_HOOK_PHYSICAL_ADDRESS;
+
+    if (MonitorDetails->EndAddress < MonitorDetails->StartAddress)
+    {
+        VmmCallbackSetLastError(DEBUGGER_ERROR_INVALID_ADDRESS);
+        return FALSE;
+    }
+
+    AlignedStart = (UINT64)PAGE_ALIGN(MonitorDetails->StartAddress);
+    AlignedEnd   = (UINT64)PAGE_ALIGN(MonitorDetails->EndAddress);
+
+    //
+    // Translate the first page of the range, physical addresses don't need conversion
+    //
+    if (IsPhysical)
+    {
+        PhysicalBaseAddress = (SIZE_T)AlignedStart;
+    }
+    else
+    {
+        PhysicalBaseAddress = (SIZE_T)VirtualAddressToPhysicalAddressByProcessCr3((PVOID)AlignedStart, ProcessCr3);
+
+        if (!PhysicalBaseAddress)
+        {
+            VmmCallbackSetLastError(DEBUGGER_ERROR_INVALID_ADDRESS);
+            return FALSE;
+        }
+
+        //
+        // The pages should be physically contiguous (the caller splits the virtual
+        // ranges into the physically contiguous ranges)
+        //
+        for (UINT64 Page = AlignedStart + PAGE_SIZE; Page <= AlignedEnd; Page += PAGE_SIZE)
+        {
+            if (VirtualAddressToPhysicalAddressByProcessCr3((PVOID)Page, ProcessCr3) != PhysicalBaseAddress + (Page - AlignedStart))
+            {
+                VmmCallbackSetLastError(DEBUGGER_ERROR_INVALID_ADDRESS);
+                return FALSE;
+            }
+        }
+    }
+
+    PhysicalEndAddress = PhysicalBaseAddress + (SIZE_T)(AlignedEnd - AlignedStart) + PAGE_SIZE - 1;
+
+    //
+    // The pages of the range should not be hooked by other hooks
+    //
+    LIST_FOR_EACH_LINK(g_EptState->HookedPagesList, EPT_HOOKED_PAGE_DETAIL, PageHookList, HookedEntry)
+    {
+        if (HookedEntry->PhysicalBaseAddress >= PhysicalBaseAddress && HookedEntry->PhysicalBaseAddress <= PhysicalEndAddress)
+        {
+            VmmCallbackSetLastError(DEBUGGER_ERROR_EPT_MULTIPLE_HOOKS_IN_A_SINGLE_PAGE);
+            return FALSE;
+        }
+    }
+
+    Range = (PEPT_MONITOR_RANGE)PoolManagerRequestPool(MONITOR_RANGE_DESCRIPTOR, TRUE, sizeof(EPT_MONITOR_RANGE));
+
+    if (!Range)
+    {
+        VmmCallbackSetLastError(DEBUGGER_ERROR_PRE_ALLOCATED_BUFFER_IS_EMPTY);
+        return FALSE;
+    }
+
+    RtlZeroMemory(Range, sizeof(EPT_MONITOR_RANGE));
+
+    Range->PhysicalBaseAddress          = PhysicalBaseAddress;
+    Range->PhysicalEndAddress           = PhysicalEndAddress;
+    Range->StartOfTargetPhysicalAddress = PhysicalBaseAddress + (SIZE_T)(MonitorDetails->StartAddress - AlignedStart);
+    Range->EndOfTargetPhysicalAddress   = PhysicalBaseAddress + (SIZE_T)(MonitorDetails->EndAddress - AlignedStart);
+    Range->VirtualAddress               = AlignedStart;
+    Range->HookingTag                   = MonitorDetails->Tag;
+    Range->PageHookMask                 = PageHookMask;
+
+    SpinlockLock(&g_EptState->MonitorRangesLock);
+
+    if (g_EptState->NumberOfMonitorRanges == MAXIMUM_NUMBER_OF_MONITOR_RANGES)
+    {
+        SpinlockUnlock(&g_EptState->MonitorRangesLock);
+        PoolManagerFreePool((UINT64)Range);
+
+        VmmCallbackSetLastError(DEBUGGER_ERROR_MAXIMUM_MONITOR_RANGES_IS_HIT);
+        return FALSE;
+    }
+
+    if (MonitorRangeIsOverlappingUnsafe(PhysicalBaseAddress, PhysicalEndAddress))
+    {
+        SpinlockUnlock(&g_EptState->MonitorRangesLock);
+        PoolManagerFreePool((UINT64)Range);
+
+        VmmCallbackSetLastError(DEBUGGER_ERROR_EPT_MULTIPLE_HOOKS_IN_A_SINGLE_PAGE);
+        return FALSE;
+    }
+
+    //
+    // Keep the descriptors sorted by their base address
+    //
+    Index = MonitorRangeGetIndex(PhysicalBaseAddress);
+
+    RtlMoveMemory(&g_EptState->MonitorRanges[Index + 1],
+                  &g_EptState->MonitorRanges[Index],
+                  (g_EptState->NumberOfMonitorRanges - Index) * sizeof(PEPT_MONITOR_RANGE));
+
+    g_EptState->MonitorRanges[Index] = Range;
+    g_EptState->NumberOfMonitorRanges++;
+
+    //
+    // The descriptor is added before changing the entries as the violations
+    // might happen on other cores as soon as an entry is changed
+    //
+    ProcessorsCount = KeQueryActiveProcessorCount(0);
+
+    for (size_t i = 0; i < ProcessorsCount; i++)
+    {
+        if (!MonitorRangeApplyToCore(&g_GuestState[i], Range, MonitorRangeTableProtect))
+        {
+            MonitorRangeRemoveUnsafe(Index);
+
+            SpinlockUnlock(&g_EptState->MonitorRangesLock);
+            PoolManagerFreePool((UINT64)Range);
+
+            EptInveptDeferAllCores();
+
+            return FALSE;
+        }
+    }
+
+    SpinlockUnlock(&g_EptState->MonitorRangesLock);
+
+    //
+    // All the cores invalidate their EPT caches before their next VM-entry
+    //
+    EptInveptDeferAllCores();
+
+    return TRUE;
+}
+
+/**
+ * @brief Remove a monitored range by its hooking tag
+ * @details should be called from vmx-root mode, the EPT caches of all
+ * the cores are invalidated before their next VM-entry
+ *
+ * @param HookingTag The hooking tag of the range
+ *
+ * @return BOOLEAN TRUE if a range is removed
+ */
+BOOLEAN
+MonitorRangeRemoveByHookingTag(UINT64 HookingTag)
+{
+    PEPT_MONITOR_RANGE Range = NULL;
+
+    if (g_EptState->NumberOfMonitorRanges == 0)
+    {
+        return FALSE;
+    }
+
+    SpinlockLock(&g_EptState->MonitorRangesLock);
+
+    for (UINT32 i = 0; i < g_EptState->NumberOfMonitorRanges; i++)
+    {
+        if (g_EptState->MonitorRanges[i]->HookingTag == HookingTag)
+        {
+            Range = g_EptState->MonitorRanges[i];
+            MonitorRangeRemoveUnsafe(i);
+            break;
+        }
+    }
+
+    SpinlockUnlock(&g_EptState->MonitorRangesLock);
+
+    if (Range == NULL)
+    {
+        return FALSE;
+    }
+
+    //
+    // The descriptor is freed later (not in vmx-root mode), so it's still valid for
+    // the cores that are handling its violations
+    //
+    PoolManagerFreePool((UINT64)Range);
+
+    EptInveptDeferAllCores();
+
+    return TRUE;
+}
+
+/**
+ * @brief Remove all the monitored ranges
+ * @details should be called from vmx-root mode
+ *
+ * @return VOID
+ */
+VOID
+MonitorRangeRemoveAll()
+{
+    PEPT_MONITOR_RANGE Range;
+
+    SpinlockLock(&g_EptState->MonitorRangesLock);
+
+    while (g_EptState->NumberOfMonitorRanges != 0)
+    {
+        Range = g_EptState->MonitorRanges[g_EptState->NumberOfMonitorRanges - 1];
+
+        MonitorRangeRemoveUnsafe(g_EptState->NumberOfMonitorRanges - 1);
+
+        PoolManagerFreePool((UINT64)Range);
+    }
+
+    SpinlockUnlock(&g_EptState->MonitorRangesLock);
+
+    EptInveptDeferAllCores();
+}
+
+/**
+ * @brief Trigger the pre events of an access to a monitored range
+ *
+ * @param VCpu The virtual processor's state
+ * @param Range The descriptor of the range
+ * @param ViolationQualification The violation qualification in vm-exit
+ * @param PhysicalAddress The physical address that caused this EPT violation
+ * @param IgnoreReadOrWriteOrExec Whether to ignore the event effects or not
+ * @param IsExecViolation Whether it's execution violation or not
+ *
+ * @return BOOLEAN FALSE if there was an unexpected ept violation
+ */
+BOOLEAN
+MonitorRangeHandleViolation(VIRTUAL_MACHINE_STATE *              VCpu,
+                            PEPT_MONITOR_RANGE                   Range,
+                            VMX_EXIT_QUALIFICATION_EPT_VIOLATION ViolationQualification,
+                            SIZE_T                               PhysicalAddress,
+                            BOOLEAN *                            IgnoreReadOrWriteOrExec,
+                            BOOLEAN *                            IsExecViolation)
+{
+    BOOLEAN                      IsTriggeringPostEventAllowed = FALSE;
+    PEPT_MONITOR_RANGE_VIOLATION Violation                    = &VCpu->MonitorRangeViolation;
+
+    //
+    // Set the last context, the range is virtually contiguous as well (the
+    // context is kept per core as the range might be accessed by other cores)
+    //
+    Violation->LastContextState.HookingTag      = Range->HookingTag;
+    Violation->LastContextState.PhysicalAddress = PhysicalAddress;
+    Violation->LastContextState.VirtualAddress  = Range->VirtualAddress + PhysicalAddress - Range->PhysicalBaseAddress;
+
+    if (!ViolationQualification.EptReadable && ViolationQualification.ReadAccess)
+    {
+        Violation->LastViolation = EPT_HOOKED_LAST_VIOLATION_READ;
+        *IgnoreReadOrWriteOrExec = DispatchEventHiddenHookPageReadWriteExecuteReadPreEvent(VCpu, &Violation->LastContextState, &IsTriggeringPostEventAllowed);
+        *IsExecViolation         = FALSE;
+    }
+    else if (!ViolationQualification.EptWriteable && ViolationQualification.WriteAccess)
+    {
+        Violation->LastViolation = EPT_HOOKED_LAST_VIOLATION_WRITE;
+        *IgnoreReadOrWriteOrExec = DispatchEventHiddenHookPageReadWriteExecuteWritePreEvent(VCpu, &Violation->LastContextState, &IsTriggeringPostEventAllowed);
+        *IsExecViolation         = FALSE;
+    }
+    else if (!ViolationQualification.EptExecutable && ViolationQualification.ExecuteAccess)
+    {
+        Violation->LastViolation = EPT_HOOKED_LAST_VIOLATION_EXEC;
+        *IgnoreReadOrWriteOrExec = DispatchEventHiddenHookPageReadWriteExecuteExecutePreEvent(VCpu, &Violation->LastContextState, &IsTriggeringPostEventAllowed);
+        *IsExecViolation         = TRUE;
+    }
+    else
+    {
+        Violation->IsPostEventTriggerAllowed = FALSE;
+        return FALSE;
+    }
+
+    //
+    // Ignoring read/write/exec will remove the 'post' event
+    //
+    Violation->IsPostEventTriggerAllowed = *IgnoreReadOrWriteOrExec ? FALSE : IsTriggeringPostEventAllowed;
+
+    return TRUE;
+}
+
+/**
+ * @brief Trigger the post events of an access to a monitored range
+ * @details after the instruction is executed or emulated
+ *
+ * @param VCpu The virtual processor's state
+ *
+ * @return VOID
+ */
+VOID
+MonitorRangeTriggerPostEvent(VIRTUAL_MACHINE_STATE * VCpu)
+{
+    PEPT_MONITOR_RANGE_VIOLATION Violation = &VCpu->MonitorRangeViolation;
+
+    if (!Violation->IsPostEventTriggerAllowed)
+    {
+        return;
+    }
+
+    if (Violation->LastViolation == EPT_HOOKED_LAST_VIOLATION_READ)
+    {
+        DispatchEventHiddenHookPageReadWriteExecReadPostEvent(VCpu, &Violation->LastContextState);
+    }
+    else if (Violation->LastViolation == EPT_HOOKED_LAST_VIOLATION_WRITE)
+    {
+        DispatchEventHiddenHookPageReadWriteExecWritePostEvent(VCpu, &Violation->LastContextState);
+    }
+    else if (Violation->LastViolation == EPT_HOOKED_LAST_VIOLATION_EXEC)
+    {
+        DispatchEventHiddenHookPageReadWriteExecExecutePostEvent(VCpu, &Violation->LastContextState);
+    }
+}
+
+/**
+ * @brief Allow the original accesses to a page of a monitored range until
+ * the next MTF vm-exit
+ * @details if the core is on the original view (an instruction that accesses
+ * both a hooked page and a monitored range), the entry of the view is changed
+ *
+ * @param VCpu The virtual processor's state
+ * @param PhysicalAddress The accessed physical address
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+MonitorRangeUnprotectForInstruction(VIRTUAL_MACHINE_STATE * VCpu, SIZE_T PhysicalAddress)
+{
+    PVOID                            Entry;
+    PEPT_MONITOR_RANGE_RESTORE_POINT RestorePoint;
+    BOOLEAN                          IsLargePage = FALSE;
+
+    if (VCpu->IsOnOriginalEptView)
+    {
+        Entry = EptViewGetPml1OrPml2Entry(VCpu->OriginalEptView, PhysicalAddress, &IsLargePage);
+    }
+    else
+    {
+        Entry = EptGetPml1OrPml2Entry(VCpu->EptPageTable, PhysicalAddress, &IsLargePage);
+    }
+
+    if (Entry == NULL)
+    {
+        return FALSE;
+    }
+
+    if (VCpu->NumberOfMtfMonitorRangeRestoreAddresses == MAXIMUM_MONITOR_RANGE_RESTORE_POINTS)
+    {
+        //
+        // The instruction is still executed (otherwise, it never finishes), but the
+        // page is not monitored on this core until the monitor is applied again
+        //
+        LogError("Err, too many pages of the monitored ranges are accessed by a single instruction");
+    }
+    else
+    {
+        //
+        // The handler of the EPT hooks might switch back from the view before
+        // the pages are protected again, so the table of each page is saved
+        //
+        RestorePoint = &VCpu->MtfMonitorRangeRestoreAddresses[VCpu->NumberOfMtfMonitorRangeRestoreAddresses++];
+
+        RestorePoint->PhysicalAddress     = PhysicalAddress;
+        RestorePoint->IsOnOriginalEptView = VCpu->IsOnOriginalEptView;
+    }
+
+    MonitorRangeTableSetEntry(Entry, 0, MonitorRangeTableUnprotect);
+
+    //
+    // The view has a different EPTP
+    //
+    EptInveptDefer(VCpu, VCpu->IsOnOriginalEptView ? InveptAllContext : InveptSingleContext);
+
+    //
+    // Set MTF to protect the page again after this instruction
+    //
+    HvEnableMtfAndChangeExternalInterruptState(VCpu);
+
+    return TRUE;
+}
+
+/**
+ * @brief Handle vm-exits for Monitor Trap Flag to protect the pages of the
+ * monitored ranges again
+ * @details the pages are protected only if their ranges are not removed
+ * while the instruction was executed, in the tables that they were
+ * unprotected in (the EPT of the core or its original view)
+ *
+ * @param VCpu The virtual processor's state
+ *
+ * @return VOID
+ */
+VOID
+MonitorRangeHandleMonitorTrapFlag(VIRTUAL_MACHINE_STATE * VCpu)
+{
+    PVOID                            Entry;
+    PEPT_MONITOR_RANGE               Range;
+    PEPT_MONITOR_RANGE_RESTORE_POINT RestorePoint;
+    INVEPT_TYPE                      InvalidationType   = InveptSingleContext;
+    BOOLEAN                          IsPostEventAllowed = FALSE;
+    BOOLEAN                          IsLargePage        = FALSE;
+
+    SpinlockLock(&g_EptState->MonitorRangesLock);
+
+    for (UINT32 i = 0; i < VCpu->NumberOfMtfMonitorRangeRestoreAddresses; i++)
+    {
+        RestorePoint = &VCpu->MtfMonitorRangeRestoreAddresses[i];
+        Range        = MonitorRangeFindUnsafe(RestorePoint->PhysicalAddress);
+
+        if (Range == NULL)
+        {
+            continue;
+        }
+
+        if (RestorePoint->IsOnOriginalEptView)
+        {
+            Entry = EptViewGetPml1OrPml2Entry(VCpu->OriginalEptView, RestorePoint->PhysicalAddress, &IsLargePage);
+
+            //
+            // The view has a different EPTP
+            //
+            InvalidationType = InveptAllContext;
+        }
+        else
+        {
+            Entry = EptGetPml1OrPml2Entry(VCpu->EptPageTable, RestorePoint->PhysicalAddress, &IsLargePage);
+        }
+
+        if (Entry != NULL)
+        {
+            MonitorRangeTableSetEntry(Entry, MonitorRangeGetMonitoredAccess(Range->PageHookMask), MonitorRangeTableReprotect);
+        }
+    }
+
+    //
+    // The descriptor might be removed (and freed) while the instruction was
+    // executed, so it's compared with the registered ranges without accessing it
+    //
+    for (UINT32 i = 0; i < g_EptState->NumberOfMonitorRanges; i++)
+    {
+        if (g_EptState->MonitorRanges[i] == VCpu->MtfMonitorRangeRestorePoint)
+        {
+            IsPostEventAllowed = TRUE;
+            break;
+        }
+    }
+
+    SpinlockUnlock(&g_EptState->MonitorRangesLock);
+
+    VCpu->NumberOfMtfMonitorRangeRestoreAddresses = 0;
+
+    EptInveptDefer(VCpu, InvalidationType);
+
+    //
+    // Check to trigger the post event
+    //
+    if (IsPostEventAllowed)
+    {
+        MonitorRangeTriggerPostEvent(VCpu);
+    }
+
+    VCpu->MtfMonitorRangeRestorePoint = NULL;
+
+    //
+    // Check for user-mode attaching mechanisms and callback
+    //
+    VmmCallbackRestoreEptState(VCpu->CoreId);
+}
@@ -107,6 +107,42 @@ ConfigureDirtyLoggingUninitializeOnAllProcessors()
     DirtyLoggingUninitialize();
 }
 
+/**
+ * @brief routines for starting the profiler on all cores
+ *
+ * @param ProfilerRequest The profiler request
+ * @param SamplingPeriod The period of taking samples (in TSC ticks)
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+ConfigureProfilerStartOnAllProcessors(PDEBUGGER_PROFILER_REQUEST ProfilerRequest, UINT64 SamplingPeriod)
+{
+    return ProfilerStart(ProfilerRequest, SamplingPeriod);
+}
+
+/**
+ * @brief routines for stopping the profiler on all cores
+ *
+ * @return VOID
+ */
+VOID
+ConfigureProfilerStopOnAllProcessors()
+{
+    ProfilerStop();
+}
+
+/**
+ * @brief routines for uninitializing the profiler
+ *
+ * @return VOID
+ */
+VOID
+ConfigureProfilerUninitializeOnAllProcessors()
+{
+    ProfilerUninitialize();
+}
+
 /**
  * @brief routines for debugging threads (disable mov-to-cr3 exiting)
  *
@@ -269,6 +269,36 @@ VmFuncUnsetExceptionBitmap(UINT32 CoreId, UINT32 IdtIndex)
     HvUnsetExceptionBitmap(&g_GuestState[CoreId], IdtIndex);
 }
 
+/**
+ * @brief Unset the bits of an MSR in the MSR bitmap
+ * @details Should be called in vmx-root
+ *
+ * @param CoreId Target core's ID
+ * @param Msr MSR Address
+ * @param ReadDetection Unset read bit
+ * @param WriteDetection Unset write bit
+ * @return BOOLEAN
+ */
+BOOLEAN
+VmFuncUnsetMsrBitmap(UINT32 CoreId, UINT32 Msr, BOOLEAN ReadDetection, BOOLEAN WriteDetection)
+{
+    return MsrHandleUnSetMsrBitmap(&g_GuestState[CoreId], Msr, ReadDetection, WriteDetection);
+}
+
+/**
+ * @brief Unset the bit of an I/O port in the I/O bitmap
+ * @details Should be called in vmx-root
+ *
+ * @param CoreId Target core's ID
+ * @param Port Target I/O port
+ * @return BOOLEAN
+ */
+BOOLEAN
+VmFuncUnsetIoBitmap(UINT32 CoreId, UINT32 Port)
+{
+    return IoHandleUnSetIoBitmap(&g_GuestState[CoreId], Port);
+}
+
 /**
  * @brief Set the External Interrupt Exiting
  *
@@ -320,6 +350,18 @@ VmFuncGetLastVmexitRip(UINT32 CoreId)
     return g_GuestState[CoreId].LastVmexitRip;
 }
 
+/**
+ * @brief get the exit qualification of the current vm-exit
+ *
+ * @param CoreId Target core's ID
+ * @return UINT32
+ */
+UINT32
+VmFuncGetExitQualification(UINT32 CoreId)
+{
+    return g_GuestState[CoreId].ExitQualification;
+}
+
 /**
  * @brief Inject pending external interrupts
  *
@@ -853,3 +895,64 @@ VmFuncIdtQueryEntries(PINTERRUPT_DESCRIPTOR_TABLE_ENTRIES_PACKETS IdtQueryReques
 {
     IdtEmulationQueryIdtEntriesRequest(IdtQueryRequest, ReadFromVmxRoot);
 }
+
+/**
+ * @brief Read the samples of the profiler on a core
+ * @details The samples are placed after the request
+ *
+ * @param ProfilerRequest The profiler request
+ * @param MaximumNumberOfSamples Maximum number of samples that can be read
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+VmFuncProfilerReadSamples(PDEBUGGER_PROFILER_REQUEST ProfilerRequest, UINT32 MaximumNumberOfSamples)
+{
+    return ProfilerReadSamples(ProfilerRequest, MaximumNumberOfSamples);
+}
+
+/**
+ * @brief Check whether the branch tracing (LBR) is supported or not
+ *
+ * @param LbrFormat The format of the last branch records
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+VmFuncBranchTraceQuerySupport(UINT32 * LbrFormat)
+{
+    return BranchTraceQuerySupport(LbrFormat);
+}
+
+/**
+ * @brief Enable or disable the branch tracing (LBR) on the current core
+ *
+ * @param CoreId Target core's ID
+ * @param Enable Enable or disable
+ *
+ * @return VOID
+ */
+VOID
+VmFuncBranchTraceEnableOnCurrentCore(UINT32 CoreId, BOOLEAN Enable)
+{
+    BranchTraceEnableOnCurrentCore(&g_GuestState[CoreId], Enable);
+}
+
+/**
+ * @brief Drain the branches that are recorded on the current core
+ *
+ * @param CoreId Target core's ID
+ * @param Records The drained records
+ * @param MaximumNumberOfRecords Maximum number of the drained records
+ * @param IsOverflowed Whether the older branches might be lost or not
+ *
+ * @return UINT32
+ */
+UINT32
+VmFuncBranchTraceDrainOnCurrentCore(UINT32                        CoreId,
+                                    PDEBUGGER_BRANCH_TRACE_RECORD Records,
+                                    UINT32                        MaximumNumberOfRecords,
+                                    BOOLEAN *                     IsOverflowed)
+{
+    return BranchTraceDrainOnCurrentCore(&g_GuestState[CoreId], Records, MaximumNumberOfRecords, IsOverflowed);
+}
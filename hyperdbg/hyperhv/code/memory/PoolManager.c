@@ -40,6 +40,89 @@ PlmgrFreeRequestNewAllocation(VOID)
     g_RequestNewAllocation = NULL;
 }
 
+/**
+ * @brief Refill the pools of the intentions that crossed their low watermark
+ * @details should be called from PASSIVE_LEVEL, each intention is refilled up
+ * to its high watermark in batches of POOL_WATERMARK_MAXIMUM_REPLENISHMENT_BATCH
+ *
+ * @return BOOLEAN If all of the allocations were successful it returns true
+ */
+BOOLEAN
+PlmgrReplenishPools()
+{
+    BOOLEAN               Result = TRUE;
+    BOOLEAN               IsSuccessful;
+    SIZE_T                Size = 0;
+    UINT32                Count;
+    PPOOL_WATERMARK_STATE State;
+
+    for (UINT32 i = 0; i < POOL_ALLOCATION_INTENTION_COUNT; i++)
+    {
+        State = &g_PoolManagerIntentionStates[i];
+
+        SpinlockLock(&LockForReadingPool);
+        Count = PoolWatermarkGetReplenishmentCount(State, &Size);
+        SpinlockUnlock(&LockForReadingPool);
+
+        if (Count == 0)
+        {
+            continue;
+        }
+
+        IsSuccessful = PoolManagerAllocateAndAddToPoolTable(Size, Count, (POOL_ALLOCATION_INTENTION)i);
+
+        if (!IsSuccessful)
+        {
+            Result = FALSE;
+        }
+
+        SpinlockLock(&LockForReadingPool);
+
+        if (PoolWatermarkCompleteReplenishment(State, Count, IsSuccessful))
+        {
+            g_IsPoolReplenishmentRequested = TRUE;
+        }
+
+        SpinlockUnlock(&LockForReadingPool);
+    }
+
+    return Result;
+}
+
+/**
+ * @brief The worker that performs the pending allocations from PASSIVE_LEVEL
+ * @details vmx-root cannot signal an event, so the worker checks the flags
+ * that are set by the vmx-root consumers every POOL_MANAGER_REPLENISHMENT_INTERVAL
+ *
+ * @param Context
+ *
+ * @return VOID
+ */
+VOID
+PlmgrReplenishmentWorker(PVOID Context)
+{
+    LARGE_INTEGER Interval;
+
+    UNREFERENCED_PARAMETER(Context);
+
+    //
+    // Relative time in 100-nanosecond units
+    //
+    Interval.QuadPart = -10000LL * POOL_MANAGER_REPLENISHMENT_INTERVAL;
+
+    while (!g_PoolManagerWorkerStopRequested)
+    {
+        KeDelayExecutionThread(KernelMode, FALSE, &Interval);
+
+        if (g_IsPoolReplenishmentRequested || g_IsNewRequestForAllocationReceived || g_IsNewRequestForDeAllocation)
+        {
+            PoolManagerCheckAndPerformAllocationAndDeallocation();
+        }
+    }
+
+    PsTerminateSystemThread(STATUS_SUCCESS);
+}
+
 // ----------------------------------------------------------------------------
 // Public Interfaces
 //
@@ -52,6 +135,8 @@ PlmgrFreeRequestNewAllocation(VOID)
 BOOLEAN
 PoolManagerInitialize()
 {
+    HANDLE WorkerHandle;
+
     //
     // Allocate global requesting variable
     //
@@ -72,6 +157,33 @@ PoolManagerInitialize()
     //
     g_IsNewRequestForDeAllocation = FALSE;
 
+    //
+    // No watermark is set by default (each pool is replaced once it's used)
+    //
+    RtlZeroMemory(g_PoolManagerIntentionStates, sizeof(g_PoolManagerIntentionStates));
+    g_IsPoolReplenishmentRequested = FALSE;
+
+    ExInitializeFastMutex(&g_PoolManagerAllocationMutex);
+
+    g_IsPoolManagerInitialized = TRUE;
+
+    //
+    // Create the replenishment worker, the allocations are still performed on
+    // the IOCTLs if the worker is not available
+    //
+    g_PoolManagerWorkerStopRequested = FALSE;
+    g_PoolManagerWorkerThread        = NULL;
+
+    if (NT_SUCCESS(PsCreateSystemThread(&WorkerHandle, THREAD_ALL_ACCESS, NULL, NULL, NULL, PlmgrReplenishmentWorker, NULL)))
+    {
+        ObReferenceObjectByHandle(WorkerHandle, THREAD_ALL_ACCESS, *PsThreadType, KernelMode, &g_PoolManagerWorkerThread, NULL);
+        ZwClose(WorkerHandle);
+    }
+    else
+    {
+        LogWarning("Warning, unable to create the pool replenishment worker");
+    }
+
     //
     // Initialized successfully
     //
@@ -89,6 +201,21 @@ PoolManagerUninitialize()
     PLIST_ENTRY ListTemp = 0;
     ListTemp             = &g_ListOfAllocatedPoolsHead;
 
+    //
+    // Stop the replenishment worker before freeing the pools
+    //
+    if (g_PoolManagerWorkerThread != NULL)
+    {
+        g_PoolManagerWorkerStopRequested = TRUE;
+
+        KeWaitForSingleObject(g_PoolManagerWorkerThread, Executive, KernelMode, FALSE, NULL);
+        ObDereferenceObject(g_PoolManagerWorkerThread);
+
+        g_PoolManagerWorkerThread = NULL;
+    }
+
+    g_IsPoolManagerInitialized = FALSE;
+
     SpinlockLock(&LockForReadingPool);
 
     while (&g_ListOfAllocatedPoolsHead != ListTemp->Flink)
@@ -109,9 +236,10 @@ PoolManagerUninitialize()
         }
 
         //
-        // Unlink the PoolTable
+        // Unlink the PoolTable (the next record is the first record again)
         //
         RemoveEntryList(&PoolTable->PoolsList);
+        ListTemp = &g_ListOfAllocatedPoolsHead;
 
         //
         // Free the record itself
@@ -119,6 +247,8 @@ PoolManagerUninitialize()
         PlatformMemFreePool(PoolTable);
     }
 
+    RtlZeroMemory(g_PoolManagerIntentionStates, sizeof(g_PoolManagerIntentionStates));
+
     SpinlockUnlock(&LockForReadingPool);
 
     PlmgrFreeRequestNewAllocation();
@@ -211,24 +341,39 @@ PoolManagerShowPreAllocatedPools()
 UINT64
 PoolManagerRequestPool(POOL_ALLOCATION_INTENTION Intention, BOOLEAN RequestNewPool, UINT32 Size)
 {
-    UINT64 Address = 0;
+    UINT64  Address              = 0;
+    BOOLEAN IsReplenishedByWorker = FALSE;
 
-    ScopedSpinlock(
-        LockForReadingPool,
-        LIST_FOR_EACH_LINK(g_ListOfAllocatedPoolsHead, POOL_TABLE, PoolsList, PoolTable) {
-            if (PoolTable->Intention == Intention && PoolTable->IsBusy == FALSE)
-            {
-                PoolTable->IsBusy = TRUE;
-                Address           = PoolTable->Address;
-                break;
-            }
-        });
+    SpinlockLock(&LockForReadingPool);
+
+    LIST_FOR_EACH_LINK(g_ListOfAllocatedPoolsHead, POOL_TABLE, PoolsList, PoolTable)
+    {
+        if (PoolTable->Intention == Intention && PoolTable->IsBusy == FALSE)
+        {
+            PoolTable->IsBusy = TRUE;
+            Address           = PoolTable->Address;
+            break;
+        }
+    }
+
+    if (Intention < POOL_ALLOCATION_INTENTION_COUNT)
+    {
+        if (PoolWatermarkCountRequest(&g_PoolManagerIntentionStates[Intention], Address != 0))
+        {
+            g_IsPoolReplenishmentRequested = TRUE;
+        }
+
+        IsReplenishedByWorker = g_PoolManagerIntentionStates[Intention].HighWatermark != 0;
+    }
+
+    SpinlockUnlock(&LockForReadingPool);
 
     //
     // Check if we need additional pools e.g another pool or the pool
-    // will be available for the next use blah blah
+    // will be available for the next use blah blah (not needed if the
+    // intention is replenished based on its watermarks)
     //
-    if (RequestNewPool)
+    if (RequestNewPool && !IsReplenishedByWorker)
     {
         PoolManagerRequestAllocation(Size, 1, Intention);
     }
@@ -241,7 +386,7 @@ PoolManagerRequestPool(POOL_ALLOCATION_INTENTION Intention, BOOLEAN RequestNewPo
 
 /**
  * @brief Allocate the new pools and add them to pool table
- * @details This function doesn't need lock as it just calls once from PASSIVE_LEVEL
+ * @details This function should be called from PASSIVE_LEVEL
  *
  * @param Size Size of each chunk
  * @param Count Count of chunks
@@ -284,9 +429,18 @@ PoolManagerAllocateAndAddToPoolTable(SIZE_T Size, UINT32 Count, POOL_ALLOCATION_
         SinglePool->Size          = Size;
 
         //
-        // Add it to the list
+        // Add it to the list (vmx-root might read the list at the same time)
         //
+        SpinlockLock(&LockForReadingPool);
+
         InsertHeadList(&g_ListOfAllocatedPoolsHead, &(SinglePool->PoolsList));
+
+        if (Intention < POOL_ALLOCATION_INTENTION_COUNT)
+        {
+            PoolWatermarkAddPool(&g_PoolManagerIntentionStates[Intention], Size);
+        }
+
+        SpinlockUnlock(&LockForReadingPool);
     }
 
     return TRUE;
@@ -301,8 +455,9 @@ PoolManagerAllocateAndAddToPoolTable(SIZE_T Size, UINT32 Count, POOL_ALLOCATION_
 BOOLEAN
 PoolManagerCheckAndPerformAllocationAndDeallocation()
 {
-    BOOLEAN     Result   = TRUE;
-    PLIST_ENTRY ListTemp = 0;
+    BOOLEAN                Result   = TRUE;
+    PLIST_ENTRY            ListTemp = 0;
+    REQUEST_NEW_ALLOCATION Request;
 
     //
     // let's make sure we're on vmx non-root and also we have new allocation
@@ -321,35 +476,75 @@ PoolManagerCheckAndPerformAllocationAndDeallocation()
     PAGED_CODE();
 
     //
-    // Check for new allocation
+    // Nothing is pending before the pool manager is initialized
+    //
+    if (!g_IsPoolManagerInitialized)
+    {
+        return TRUE;
+    }
+
+    //
+    // The IOCTLs and the replenishment worker might call this function at the same time
+    //
+    ExAcquireFastMutex(&g_PoolManagerAllocationMutex);
+
+    //
+    // Check for new allocation (the flag is cleared before reading the requests,
+    // so the requests that are added in the meantime are not lost)
     //
     if (g_IsNewRequestForAllocationReceived)
     {
+        g_IsNewRequestForAllocationReceived = FALSE;
+
         for (SIZE_T i = 0; i < MaximumRequestsQueueDepth; i++)
         {
             REQUEST_NEW_ALLOCATION * CurrentItem = &g_RequestNewAllocation[i];
 
-            if (CurrentItem->Size != 0)
+            if (CurrentItem->Size == 0)
             {
-                Result = PoolManagerAllocateAndAddToPoolTable(CurrentItem->Size,
-                                                              CurrentItem->Count,
-                                                              CurrentItem->Intention);
+                continue;
+            }
 
-                //
-                // Free the data for future use
-                //
-                CurrentItem->Count     = 0;
-                CurrentItem->Intention = 0;
-                CurrentItem->Size      = 0;
+            //
+            // Take the request and free the data for future use
+            //
+            SpinlockLock(&LockForRequestAllocation);
+
+            Request = *CurrentItem;
+
+            CurrentItem->Count     = 0;
+            CurrentItem->Intention = 0;
+            CurrentItem->Size      = 0;
+
+            SpinlockUnlock(&LockForRequestAllocation);
+
+            if (!PoolManagerAllocateAndAddToPoolTable(Request.Size, Request.Count, Request.Intention))
+            {
+                Result = FALSE;
             }
         }
     }
 
+    //
+    // Refill the intentions that crossed their low watermark
+    //
+    if (g_IsPoolReplenishmentRequested)
+    {
+        g_IsPoolReplenishmentRequested = FALSE;
+
+        if (!PlmgrReplenishPools())
+        {
+            Result = FALSE;
+        }
+    }
+
     //
     // Check for deallocation
     //
     if (g_IsNewRequestForDeAllocation)
     {
+        g_IsNewRequestForDeAllocation = FALSE;
+
         ListTemp = &g_ListOfAllocatedPoolsHead;
 
         SpinlockLock(&LockForReadingPool);
@@ -374,6 +569,11 @@ PoolManagerCheckAndPerformAllocationAndDeallocation()
                 //
                 PoolTable->AlreadyFreed = TRUE;
 
+                if (PoolTable->Intention < POOL_ALLOCATION_INTENTION_COUNT)
+                {
+                    PoolWatermarkRemovePool(&g_PoolManagerIntentionStates[PoolTable->Intention], PoolTable->IsBusy);
+                }
+
                 //
                 // This item should be freed
                 //
@@ -381,7 +581,9 @@ PoolManagerCheckAndPerformAllocationAndDeallocation()
 
                 //
                 // Now we should remove the entry from the g_ListOfAllocatedPoolsHead
+                // and continue from the previous entry as this record is freed
                 //
+                ListTemp = ListTemp->Blink;
                 RemoveEntryList(&PoolTable->PoolsList);
 
                 //
@@ -397,8 +599,7 @@ PoolManagerCheckAndPerformAllocationAndDeallocation()
     //
     // All allocation and deallocation are performed
     //
-    g_IsNewRequestForDeAllocation       = FALSE;
-    g_IsNewRequestForAllocationReceived = FALSE;
+    ExReleaseFastMutex(&g_PoolManagerAllocationMutex);
 
     return Result;
 }
@@ -452,3 +653,61 @@ PoolManagerRequestAllocation(SIZE_T Size, UINT32 Count, POOL_ALLOCATION_INTENTIO
     SpinlockUnlock(&LockForRequestAllocation);
     return TRUE;
 }
+
+/**
+ * @brief Set the watermarks of an intention
+ * @details once the number of free pools of the intention drops to the low
+ * watermark, the replenishment worker refills it up to the high watermark,
+ * a high watermark of zero disables the replenishment and each used pool is
+ * replaced separately (if it's requested by the caller)
+ *
+ * @param Intention The intention of the pools (buffer tag)
+ * @param Size Size of each chunk
+ * @param LowWatermark Minimum number of free pools before requesting replenishment
+ * @param HighWatermark Number of free pools after replenishment
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+PoolManagerSetWatermarks(POOL_ALLOCATION_INTENTION Intention,
+                         SIZE_T                    Size,
+                         UINT32                    LowWatermark,
+                         UINT32                    HighWatermark)
+{
+    if (Intention >= POOL_ALLOCATION_INTENTION_COUNT || (HighWatermark != 0 && (Size == 0 || LowWatermark >= HighWatermark)))
+    {
+        return FALSE;
+    }
+
+    SpinlockLock(&LockForReadingPool);
+
+    if (PoolWatermarkSet(&g_PoolManagerIntentionStates[Intention], Size, LowWatermark, HighWatermark))
+    {
+        g_IsPoolReplenishmentRequested = TRUE;
+    }
+
+    SpinlockUnlock(&LockForReadingPool);
+
+    return TRUE;
+}
+
+/**
+ * @brief Query the usage statistics of the pre-allocated pools
+ *
+ * @param Statistics The array of statistics (indexed by the intention)
+ * @param NumberOfIntentions Number of items in the array
+ *
+ * @return VOID
+ */
+VOID
+PoolManagerQueryStatistics(PPOOL_MANAGER_INTENTION_STATISTICS Statistics, UINT32 NumberOfIntentions)
+{
+    SpinlockLock(&LockForReadingPool);
+
+    for (UINT32 i = 0; i < NumberOfIntentions && i < POOL_ALLOCATION_INTENTION_COUNT; i++)
+    {
+        PoolWatermarkQueryStatistics(&g_PoolManagerIntentionStates[i], &Statistics[i]);
+    }
+
+    SpinlockUnlock(&LockForReadingPool);
+}
@@ -827,6 +827,78 @@ EptLogicalProcessorInitialize(VOID)
     return TRUE;
 }
 
+/**
+ * @brief Check whether the accesses to a hooked page can be emulated or not
+ * @details only the pages of the '!monitor' command are emulated, other hooks
+ * (hidden breakpoints, detours, MMIO shadowing) change the contents or the
+ * view of the page
+ *
+ * @param HookedEntry The entry that describes the hooked page
+ * @return BOOLEAN
+ */
+static BOOLEAN
+EptIsMonitorEmulationAllowed(PEPT_HOOKED_PAGE_DETAIL HookedEntry)
+{
+    return !HookedEntry->IsExecutionHook && !HookedEntry->IsHiddenBreakpoint && !HookedEntry->IsMmioShadowing;
+}
+
+/**
+ * @brief Skip or redo the instruction that caused a violation of a hook
+ * @details the ignored read/write accesses skip the instruction and the ignored
+ * execute accesses don't increment the RIP
+ *
+ * @param VCpu The virtual processor's state
+ * @param IgnoreReadOrWriteOrExec Whether to ignore the event effects or not
+ * @param IsExecViolation Whether it's execution violation or not
+ *
+ * @return VOID
+ */
+static VOID
+EptHandleIgnoredAccess(VIRTUAL_MACHINE_STATE * VCpu, BOOLEAN IgnoreReadOrWriteOrExec, BOOLEAN IsExecViolation)
+{
+    UINT64 CurrentRip;
+    UINT32 CurrentInstructionLength;
+
+    //
+    // Check whether the event should be ignored or not
+    //
+    if (IgnoreReadOrWriteOrExec)
+    {
+        //
+        // Do not redo the instruction (EPT hooks won't affect the VMCS_VMEXIT_INSTRUCTION_LENGTH),
+        // thus, we use custom length diassembler engine to ignore the instruction at target address
+        //
+
+        // HvPerformRipIncrement(VCpu); // invalid because EPT Violation won't affect VMCS_VMEXIT_INSTRUCTION_LENGTH
+        HvSuppressRipIncrement(VCpu); // Just to make sure nothing is added to the address
+
+        //
+        // If the target violation is for READ/WRITE, we ignore the current instruction and move to the
+        // next instruction, but if the violation is for execute access, then we just won't increment the RIP
+        //
+        if (!IsExecViolation)
+        {
+            //
+            // Get the RIP here as the RIP might be changed by the user and thus is not valid to be read
+            // from the VCpu
+            //
+            CurrentRip               = HvGetRip();
+            CurrentInstructionLength = DisassemblerLengthDisassembleEngineInVmxRootOnTargetProcess((PVOID)CurrentRip, CommonIsGuestOnUsermode32Bit());
+
+            CurrentRip = CurrentRip + CurrentInstructionLength;
+
+            HvSetRip(CurrentRip);
+        }
+    }
+    else
+    {
+        //
+        // Redo the instruction (it's also not necessary as the EPT Violation won't affect VMCS_VMEXIT_INSTRUCTION_LENGTH)
+        //
+        HvSuppressRipIncrement(VCpu);
+    }
+}
+
 /**
  * @brief Check if this exit is due to a violation caused by a currently hooked page
  * @details If the memory access attempt was RW and the page was marked executable, the page is swapped with
@@ -846,12 +918,11 @@ EptHandlePageHookExit(VIRTUAL_MACHINE_STATE *              VCpu,
                       UINT64                               GuestPhysicalAddr)
 {
     PVOID   TargetPage;
-    UINT64  CurrentRip;
-    UINT32  CurrentInstructionLength;
     BOOLEAN IsHandled               = FALSE;
     BOOLEAN ResultOfHandlingHook    = FALSE;
     BOOLEAN IgnoreReadOrWriteOrExec = FALSE;
     BOOLEAN IsExecViolation         = FALSE;
+    BOOLEAN IsTargetRange           = FALSE;
 
     LIST_FOR_EACH_LINK(g_EptState->HookedPagesList, EPT_HOOKED_PAGE_DETAIL, PageHookList, HookedEntry)
     {
@@ -876,7 +947,10 @@ EptHandlePageHookExit(VIRTUAL_MACHINE_STATE *              VCpu,
             // happens on 0x123b4600, so we perform the necessary checks here
             //
 
-            if (GuestPhysicalAddr >= HookedEntry->StartOfTargetPhysicalAddress && GuestPhysicalAddr <= HookedEntry->EndOfTargetPhysicalAddress)
+            IsTargetRange = GuestPhysicalAddr >= HookedEntry->StartOfTargetPhysicalAddress &&
+                            GuestPhysicalAddr <= HookedEntry->EndOfTargetPhysicalAddress;
+
+            if (IsTargetRange)
             {
                 ResultOfHandlingHook = EptHookHandleHookedPage(VCpu,
                                                                HookedEntry,
@@ -902,20 +976,39 @@ EptHandlePageHookExit(VIRTUAL_MACHINE_STATE *              VCpu,
                 // if we don't apply the below restorations routines, the event
                 // won't redo and the emulation of the memory access is passed
                 //
-                if (!IgnoreReadOrWriteOrExec)
+                if (!IgnoreReadOrWriteOrExec && !IsExecViolation && EptIsMonitorEmulationAllowed(HookedEntry) &&
+                    MonitorEmulationHandleAccess(VCpu, ViolationQualification, GuestPhysicalAddr))
                 {
                     //
-                    // Pointer to the page entry in the page table
+                    // The access is emulated and the hook is kept, so there is no need
+                    // to restore the entry (and to set MTF) for this instruction
                     //
-                    TargetPage = EptGetPml1Entry(VCpu->EptPageTable, HookedEntry->PhysicalBaseAddress);
-
+                    if (IsTargetRange)
+                    {
+                        EptHookTriggerPostEvent(VCpu, HookedEntry);
+                    }
+                }
+                else if (!IgnoreReadOrWriteOrExec)
+                {
                     //
-                    // Restore to its original entry for one instruction
+                    // Execute the instruction on the original view of the EPT, and if the
+                    // view is not available, restore the page to its original entry
                     //
-                    EptSetPML1AndInvalidateTLB(VCpu,
-                                               TargetPage,
-                                               HookedEntry->OriginalEntry,
-                                               InveptSingleContext);
+                    if (!EptViewSwitchToOriginalView(VCpu, HookedEntry))
+                    {
+                        //
+                        // Pointer to the page entry in the page table
+                        //
+                        TargetPage = EptGetPml1Entry(VCpu->EptPageTable, HookedEntry->PhysicalBaseAddress);
+
+                        //
+                        // Restore to its original entry for one instruction
+                        //
+                        EptSetPML1AndInvalidateTLB(VCpu,
+                                                   TargetPage,
+                                                   HookedEntry->OriginalEntry,
+                                                   InveptSingleContext);
+                    }
 
                     //
                     // Next we have to save the current hooked entry to restore on the next instruction's vm-exit
@@ -947,46 +1040,154 @@ EptHandlePageHookExit(VIRTUAL_MACHINE_STATE *              VCpu,
         }
     }
 
+    EptHandleIgnoredAccess(VCpu, IgnoreReadOrWriteOrExec, IsExecViolation);
+
+    return IsHandled;
+}
+
+/**
+ * @brief Check if this exit is due to a violation caused by a monitored range
+ * @details the access is either emulated or the page is accessible until the
+ * next MTF vm-exit, the other pages of the range remain protected
+ *
+ * @param VCpu The virtual processor's state
+ * @param ViolationQualification The violation qualification in vm-exit
+ * @param GuestPhysicalAddr The GUEST_PHYSICAL_ADDRESS that caused this EPT violation
+ *
+ * @return BOOLEAN Returns true if the violation was caused by a monitored range
+ */
+BOOLEAN
+EptHandleMonitorRangeExit(VIRTUAL_MACHINE_STATE *              VCpu,
+                          VMX_EXIT_QUALIFICATION_EPT_VIOLATION ViolationQualification,
+                          UINT64                               GuestPhysicalAddr)
+{
+    PEPT_MONITOR_RANGE Range;
+    BOOLEAN            ResultOfHandlingHook    = FALSE;
+    BOOLEAN            IgnoreReadOrWriteOrExec = FALSE;
+    BOOLEAN            IsExecViolation         = FALSE;
+    BOOLEAN            IsTargetRange           = FALSE;
+
+    Range = MonitorRangeFind((SIZE_T)GuestPhysicalAddr);
+
+    if (Range == NULL)
+    {
+        return FALSE;
+    }
+
     //
-    // Check whether the event should be ignored or not
+    // The range is page aligned, so the access might be outside of the target range
     //
-    if (IgnoreReadOrWriteOrExec)
-    {
-        //
-        // Do not redo the instruction (EPT hooks won't affect the VMCS_VMEXIT_INSTRUCTION_LENGTH),
-        // thus, we use custom length diassembler engine to ignore the instruction at target address
-        //
+    IsTargetRange = GuestPhysicalAddr >= Range->StartOfTargetPhysicalAddress &&
+                    GuestPhysicalAddr <= Range->EndOfTargetPhysicalAddress;
 
-        // HvPerformRipIncrement(VCpu); // invalid because EPT Violation won't affect VMCS_VMEXIT_INSTRUCTION_LENGTH
-        HvSuppressRipIncrement(VCpu); // Just to make sure nothing is added to the address
+    if (IsTargetRange)
+    {
+        ResultOfHandlingHook = MonitorRangeHandleViolation(VCpu,
+                                                           Range,
+                                                           ViolationQualification,
+                                                           (SIZE_T)GuestPhysicalAddr,
+                                                           &IgnoreReadOrWriteOrExec,
+                                                           &IsExecViolation);
+    }
+    else
+    {
+        ResultOfHandlingHook = TRUE;
+    }
 
-        //
-        // If the target violation is for READ/WRITE, we ignore the current instruction and move to the
-        // next instruction, but if the violation is for execute access, then we just won't increment the RIP
-        //
-        if (!IsExecViolation)
+    if (ResultOfHandlingHook && !IgnoreReadOrWriteOrExec)
+    {
+        if (!IsExecViolation && MonitorEmulationHandleAccess(VCpu, ViolationQualification, GuestPhysicalAddr))
         {
             //
-            // Get the RIP here as the RIP might be changed by the user and thus is not valid to be read
-            // from the VCpu
+            // The access is emulated and the range remains protected
             //
-            CurrentRip               = HvGetRip();
-            CurrentInstructionLength = DisassemblerLengthDisassembleEngineInVmxRootOnTargetProcess((PVOID)CurrentRip, CommonIsGuestOnUsermode32Bit());
+            if (IsTargetRange)
+            {
+                MonitorRangeTriggerPostEvent(VCpu);
+            }
+        }
+        else if (MonitorRangeUnprotectForInstruction(VCpu, (SIZE_T)GuestPhysicalAddr))
+        {
+            //
+            // The post event is triggered after the instruction is executed
+            //
+            if (IsTargetRange)
+            {
+                VCpu->MtfMonitorRangeRestorePoint = Range;
+            }
+        }
+    }
 
-            CurrentRip = CurrentRip + CurrentInstructionLength;
+    EptHandleIgnoredAccess(VCpu, IgnoreReadOrWriteOrExec, IsExecViolation);
 
-            HvSetRip(CurrentRip);
-        }
+    return TRUE;
+}
+
+/**
+ * @brief Check if this exit is due to the stale EPT caches of the current core
+ * @details the entries that are restored (e.g., by removing a monitored range
+ * on another core) are invalidated before the next VM-entry of the current
+ * core, thus, the access is retried once the caches are invalidated
+ *
+ * @param VCpu The virtual processor's state
+ * @param ViolationQualification The violation qualification in vm-exit
+ * @param GuestPhysicalAddr The GUEST_PHYSICAL_ADDRESS that caused this EPT violation
+ *
+ * @return BOOLEAN Returns true if the access should be retried
+ */
+static BOOLEAN
+EptHandleStaleViolation(VIRTUAL_MACHINE_STATE *              VCpu,
+                        VMX_EXIT_QUALIFICATION_EPT_VIOLATION ViolationQualification,
+                        UINT64                               GuestPhysicalAddr)
+{
+    PVOID   Entry;
+    BOOLEAN IsLargePage = FALSE;
+    BOOLEAN ReadAccess;
+    BOOLEAN WriteAccess;
+    BOOLEAN ExecuteAccess;
+
+    //
+    // Once the invalidation is performed, the violation is not retried again
+    //
+    if (VCpu->NotNormalEptp || VCpu->IsOnOriginalEptView || !EptInveptIsDeferred(VCpu))
+    {
+        return FALSE;
+    }
+
+    Entry = EptGetPml1OrPml2Entry(VCpu->EptPageTable, (SIZE_T)GuestPhysicalAddr, &IsLargePage);
+
+    if (Entry == NULL)
+    {
+        return FALSE;
+    }
+
+    if (IsLargePage)
+    {
+        ReadAccess    = (BOOLEAN)((PEPT_PML2_ENTRY)Entry)->ReadAccess;
+        WriteAccess   = (BOOLEAN)((PEPT_PML2_ENTRY)Entry)->WriteAccess;
+        ExecuteAccess = (BOOLEAN)((PEPT_PML2_ENTRY)Entry)->ExecuteAccess;
     }
     else
     {
-        //
-        // Redo the instruction (it's also not necessary as the EPT Violation won't affect VMCS_VMEXIT_INSTRUCTION_LENGTH)
-        //
-        HvSuppressRipIncrement(VCpu);
+        ReadAccess    = (BOOLEAN)((PEPT_PML1_ENTRY)Entry)->ReadAccess;
+        WriteAccess   = (BOOLEAN)((PEPT_PML1_ENTRY)Entry)->WriteAccess;
+        ExecuteAccess = (BOOLEAN)((PEPT_PML1_ENTRY)Entry)->ExecuteAccess;
     }
 
-    return IsHandled;
+    if ((ViolationQualification.ReadAccess && !ReadAccess) ||
+        (ViolationQualification.WriteAccess && !WriteAccess) ||
+        (ViolationQualification.ExecuteAccess && !ExecuteAccess))
+    {
+        return FALSE;
+    }
+
+    //
+    // Redo the instruction after the invalidation
+    //
+    EptInveptDefer(VCpu, InveptSingleContext);
+    HvSuppressRipIncrement(VCpu);
+
+    return TRUE;
 }
 
 /**
@@ -1020,6 +1221,20 @@ EptHandleEptViolation(VIRTUAL_MACHINE_STATE * VCpu)
         //
         return TRUE;
     }
+    else if (EptHandleMonitorRangeExit(VCpu, ViolationQualification, GuestPhysicalAddr))
+    {
+        //
+        // Handled by the monitored ranges
+        //
+        return TRUE;
+    }
+    else if (EptHandleStaleViolation(VCpu, ViolationQualification, GuestPhysicalAddr))
+    {
+        //
+        // The entry is already restored, but not invalidated yet
+        //
+        return TRUE;
+    }
     else if (VmmCallbackUnhandledEptViolation(VCpu->CoreId, (UINT64)ViolationQualification.AsUInt, GuestPhysicalAddr))
     {
         //
@@ -1062,7 +1277,8 @@ EptHandleMisconfiguration(VOID)
 
 /**
  * @brief This function set the specific PML1 entry in a spinlock protected area then invalidate the TLB
- * @details This function should be called from vmx root-mode
+ * @details This function should be called from vmx root-mode, the TLB is invalidated
+ * before the next VM-entry of the core
  *
  * @param VCpu The virtual processor's state
  * @param EntryAddress PML1 entry information (the target address)
@@ -1083,20 +1299,9 @@ EptSetPML1AndInvalidateTLB(VIRTUAL_MACHINE_STATE * VCpu,
     EntryAddress->AsUInt = EntryValue.AsUInt;
 
     //
-    // invalidate the cache
+    // invalidate the cache (coalesced with other edits of this VM-exit)
     //
-    if (InvalidationType == InveptSingleContext)
-    {
-        EptInveptSingleContext(VCpu->EptPointer.AsUInt);
-    }
-    else if (InvalidationType == InveptAllContext)
-    {
-        EptInveptAllContexts();
-    }
-    else
-    {
-        LogError("Err, invalid invalidation parameter");
-    }
+    EptInveptDefer(VCpu, InvalidationType);
 }
 
 /**
@@ -1145,17 +1350,34 @@ EptCheckAndHandleEptHookBreakpoints(VIRTUAL_MACHINE_STATE * VCpu, UINT64 GuestRi
                     DispatchEventHiddenHookExecCc(VCpu, (PVOID)GuestRip);
 
                     //
-                    // Pointer to the page entry in the page table
+                    // If the instruction is relocated into a trampoline, the guest continues
+                    // from the trampoline and the hook remains applied (no MTF is needed)
                     //
-                    TargetPage = EptGetPml1Entry(VCpu->EptPageTable, HookedEntry->PhysicalBaseAddress);
+                    if (DisplacedExecutionResumeInTrampoline(VCpu, HookedEntry, GuestRip))
+                    {
+                        IsHandledByEptHook = TRUE;
+                        break;
+                    }
 
                     //
-                    // Restore to its original entry for one instruction
+                    // Execute the instruction on the original view of the EPT, and if the
+                    // view is not available, restore the page to its original entry
                     //
-                    EptSetPML1AndInvalidateTLB(VCpu,
-                                               TargetPage,
-                                               HookedEntry->OriginalEntry,
-                                               InveptSingleContext);
+                    if (!EptViewSwitchToOriginalView(VCpu, HookedEntry))
+                    {
+                        //
+                        // Pointer to the page entry in the page table
+                        //
+                        TargetPage = EptGetPml1Entry(VCpu->EptPageTable, HookedEntry->PhysicalBaseAddress);
+
+                        //
+                        // Restore to its original entry for one instruction
+                        //
+                        EptSetPML1AndInvalidateTLB(VCpu,
+                                                   TargetPage,
+                                                   HookedEntry->OriginalEntry,
+                                                   InveptSingleContext);
+                    }
 
                     //
                     // Next we have to save the current hooked entry to restore on the next instruction's vm-exit
@@ -0,0 +1,342 @@
+/**
+ * @file EptView.c
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Alternate views of the EPT
+ * @details Each core has an 'original' view of its EPT in which the hooked
+ * pages are mapped with their original (unhooked) entries. Instead of changing
+ * the entry of a hooked page and invalidating the EPT twice for each access,
+ * the instruction that accesses the page is executed on the original view and
+ * the core is switched back to its EPT on the next MTF. The EPT caches are tagged
+ * with the EPTP, so none of these switches needs an INVEPT
+ *
+ * @version 0.11
+ * @date 2024-10-29
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Initialize the original EPT views of all cores
+ * @details should be called from vmx non-root mode after the EPT of the cores
+ * is initialized, the views are optional and if they're not available, the
+ * entries of the hooked pages are changed for each access
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+EptViewInitialize()
+{
+    ULONG       ProcessorsCount;
+    PEPT_VIEW   View;
+    EPT_POINTER EPTP;
+
+    //
+    // Get number of processors
+    //
+    ProcessorsCount = KeQueryActiveProcessorCount(0);
+
+    for (size_t i = 0; i < ProcessorsCount; i++)
+    {
+        View = PlatformMemAllocateContiguousZeroedMemory(sizeof(EPT_VIEW));
+
+        if (View == NULL)
+        {
+            LogWarning("Warning, unable to allocate the EPT views, hooks change the EPT entries instead");
+
+            EptViewUninitialize();
+            return FALSE;
+        }
+
+        //
+        // The first PML4 entry points to the PML3 of the view
+        //
+        View->PML4[0]                 = g_GuestState[i].EptPageTable->PML4[0];
+        View->PML4[0].PageFrameNumber = (SIZE_T)VirtualAddressToPhysicalAddress(&View->PML3[0]) / PAGE_SIZE;
+
+        //
+        // All the PML3 entries point to the PML2 tables of the core's EPT, so
+        // the view is the same as the EPT until a hook is applied
+        //
+        RtlCopyMemory(&View->PML3[0], &g_GuestState[i].EptPageTable->PML3[0], sizeof(View->PML3));
+
+        //
+        // The EPTP of the view only differs in the page frame number
+        //
+        EPTP                 = g_GuestState[i].EptPointer;
+        EPTP.PageFrameNumber = (SIZE_T)VirtualAddressToPhysicalAddress(&View->PML4[0]) / PAGE_SIZE;
+        View->EptPointer     = EPTP;
+
+        g_GuestState[i].OriginalEptView = View;
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Uninitialize the EPT views of all cores
+ * @details the copied paging tables are freed by the pool manager
+ *
+ * @return VOID
+ */
+VOID
+EptViewUninitialize()
+{
+    ULONG ProcessorsCount;
+
+    //
+    // Get number of processors
+    //
+    ProcessorsCount = KeQueryActiveProcessorCount(0);
+
+    for (size_t i = 0; i < ProcessorsCount; i++)
+    {
+        if (g_GuestState[i].OriginalEptView != NULL)
+        {
+            MmFreeContiguousMemory(g_GuestState[i].OriginalEptView);
+            g_GuestState[i].OriginalEptView = NULL;
+        }
+    }
+}
+
+/**
+ * @brief Request a paging table for the view (EPT_VIEW_TABLE_MEMORY)
+ * @details the tables are requested from the pre-allocated pools as
+ * we're in VMX-root mode
+ *
+ * @param Context not used
+ *
+ * @return PEPT_VIEW_PAGING_TABLE NULL if the pools are empty
+ */
+static PEPT_VIEW_PAGING_TABLE
+EptViewAllocatePagingTable(PVOID Context)
+{
+    UNREFERENCED_PARAMETER(Context);
+
+    return (PEPT_VIEW_PAGING_TABLE)PoolManagerRequestPool(EPT_VIEW_PAGING_STRUCTURE, TRUE, sizeof(EPT_VIEW_PAGING_TABLE));
+}
+
+/**
+ * @brief Get the physical address of a paging table (EPT_VIEW_TABLE_MEMORY)
+ *
+ * @param Table
+ * @param Context not used
+ *
+ * @return UINT64
+ */
+static UINT64
+EptViewPagingTableToPhysical(PVOID Table, PVOID Context)
+{
+    UNREFERENCED_PARAMETER(Context);
+
+    return VirtualAddressToPhysicalAddress(Table);
+}
+
+/**
+ * @brief Get the paging table at a physical address (EPT_VIEW_TABLE_MEMORY)
+ *
+ * @param Address
+ * @param Context not used
+ *
+ * @return PVOID
+ */
+static PVOID
+EptViewPhysicalToPagingTable(UINT64 Address, PVOID Context)
+{
+    UNREFERENCED_PARAMETER(Context);
+
+    return (PVOID)PhysicalAddressToVirtualAddress(Address);
+}
+
+/**
+ * @brief Put the original entries of the hooked pages of a 2MB region
+ * in a copied PML1 table (EPT_VIEW_TABLE_MEMORY)
+ *
+ * @param Table The copied PML1 table
+ * @param PhysicalAddress The physical address of the 2MB region
+ * @param Context not used
+ *
+ * @return VOID
+ */
+static VOID
+EptViewRestoreOriginalEntries(PEPT_VIEW_PAGING_TABLE Table, UINT64 PhysicalAddress, PVOID Context)
+{
+    UNREFERENCED_PARAMETER(Context);
+
+    LIST_FOR_EACH_LINK(g_EptState->HookedPagesList, EPT_HOOKED_PAGE_DETAIL, PageHookList, HookedEntry)
+    {
+        if ((HookedEntry->PhysicalBaseAddress & ~(SIZE_2_MB - 1)) == PhysicalAddress)
+        {
+            Table->Entries[ADDRMASK_EPT_PML1_INDEX(HookedEntry->PhysicalBaseAddress)] = HookedEntry->OriginalEntry.AsUInt;
+        }
+    }
+}
+
+/**
+ * @brief Routines of the paging tables of the views
+ *
+ */
+static EPT_VIEW_TABLE_MEMORY EptViewTableMemory = {
+    EptViewAllocatePagingTable,
+    EptViewPagingTableToPhysical,
+    EptViewPhysicalToPagingTable,
+    EptViewRestoreOriginalEntries,
+    NULL,
+};
+
+/**
+ * @brief Get the PML1 entry of a physical address in a view, if the
+ * address is mapped by a large page then the PML2 entry is returned
+ * @details the entry might belong to the core's EPT if the paging
+ * structure is not copied for the view
+ *
+ * @param View The EPT view
+ * @param PhysicalAddress The target physical address
+ * @param IsLargePage Shows whether it's a large page or not
+ *
+ * @return PVOID Return PEPT_PML1_ENTRY or PEPT_PML2_ENTRY
+ */
+PVOID
+EptViewGetPml1OrPml2Entry(PEPT_VIEW View, SIZE_T PhysicalAddress, BOOLEAN * IsLargePage)
+{
+    return EptViewTableGetPml1OrPml2Entry(&View->PML3[0], PhysicalAddress, IsLargePage, &EptViewTableMemory);
+}
+
+/**
+ * @brief Get the PML1 entry of a physical address in a view
+ * @details the entry might belong to the core's EPT if the PML1 is
+ * not copied for the view
+ *
+ * @param View The EPT view
+ * @param PhysicalAddress The target physical address
+ *
+ * @return PEPT_PML1_ENTRY NULL if the page is not mapped by a PML1
+ */
+PEPT_PML1_ENTRY
+EptViewGetPml1Entry(PEPT_VIEW View, SIZE_T PhysicalAddress)
+{
+    return EptViewTableGetPml1Entry(&View->PML3[0], PhysicalAddress, &EptViewTableMemory);
+}
+
+/**
+ * @brief Set the original entry of a hooked page in the original view of a core
+ * @details should be called after the page is split in the core's EPT, the PML2
+ * and the PML1 of the page are copied (once) from the core's EPT, other paging
+ * tables remain shared
+ *
+ * @param VCpu The virtual processor's state
+ * @param PhysicalAddress The physical address of the hooked page
+ * @param OriginalEntry The entry of the page before applying the hook
+ *
+ * @return BOOLEAN FALSE if the view is not available (the EPT entry is changed
+ * for each access to the page)
+ */
+BOOLEAN
+EptViewSetOriginalEntry(VIRTUAL_MACHINE_STATE * VCpu, SIZE_T PhysicalAddress, EPT_PML1_ENTRY OriginalEntry)
+{
+    PEPT_VIEW View = VCpu->OriginalEptView;
+
+    if (View == NULL)
+    {
+        return FALSE;
+    }
+
+    //
+    // The PML2 and the PML1 of the page are copied (once) for the view
+    //
+    if (!EptViewTableSetEntry(&View->PML3[0], &VCpu->EptPageTable->PML3[0], PhysicalAddress, OriginalEntry, &EptViewTableMemory))
+    {
+        return FALSE;
+    }
+
+    //
+    // The cached paging-structures of the view are invalidated before using it again
+    //
+    View->IsModified = TRUE;
+
+    return TRUE;
+}
+
+/**
+ * @brief Switch the current core to its original view for a hooked page
+ * @details should be called from vmx-root mode, the caller sets the MTF
+ * to switch back after executing the instruction
+ *
+ * @param VCpu The virtual processor's state
+ * @param HookedEntry The hooked page that is accessed
+ *
+ * @return BOOLEAN FALSE if the view can't be used for the page
+ */
+BOOLEAN
+EptViewSwitchToOriginalView(VIRTUAL_MACHINE_STATE * VCpu, PEPT_HOOKED_PAGE_DETAIL HookedEntry)
+{
+    PEPT_PML1_ENTRY Entry;
+
+    //
+    // Other EPTPs (MBEC, execute-only) are not viewed
+    //
+    if (VCpu->OriginalEptView == NULL || VCpu->NotNormalEptp)
+    {
+        return FALSE;
+    }
+
+    //
+    // Make sure the view contains the original entry of the page
+    //
+    Entry = EptViewGetPml1Entry(VCpu->OriginalEptView, HookedEntry->PhysicalBaseAddress);
+
+    if (Entry == NULL || Entry->AsUInt != HookedEntry->OriginalEntry.AsUInt)
+    {
+        return FALSE;
+    }
+
+    __vmx_vmwrite(VMCS_CTRL_EPT_POINTER, VCpu->OriginalEptView->EptPointer.AsUInt);
+
+    //
+    // The caches are tagged by the EPTP, so the view needs invalidation only
+    // if its tables are changed since the last switch
+    //
+    if (VCpu->OriginalEptView->IsModified)
+    {
+        VCpu->OriginalEptView->IsModified = FALSE;
+        EptInveptSingleContext(VCpu->OriginalEptView->EptPointer.AsUInt);
+    }
+
+    VCpu->IsOnOriginalEptView = TRUE;
+
+    return TRUE;
+}
+
+/**
+ * @brief Switch the current core back from its original view
+ * @details should be called from vmx-root mode
+ *
+ * @param VCpu The virtual processor's state
+ *
+ * @return BOOLEAN FALSE if the core was not on the original view
+ */
+BOOLEAN
+EptViewRestoreNormalView(VIRTUAL_MACHINE_STATE * VCpu)
+{
+    UINT64 CurrentEptPointer = 0;
+
+    if (!VCpu->IsOnOriginalEptView)
+    {
+        return FALSE;
+    }
+
+    VCpu->IsOnOriginalEptView = FALSE;
+
+    //
+    // The EPTP might be changed meanwhile (e.g., by the execution traps)
+    //
+    __vmx_vmread(VMCS_CTRL_EPT_POINTER, &CurrentEptPointer);
+
+    if (CurrentEptPointer == VCpu->OriginalEptView->EptPointer.AsUInt)
+    {
+        __vmx_vmwrite(VMCS_CTRL_EPT_POINTER, VCpu->EptPointer.AsUInt);
+    }
+
+    return TRUE;
+}
@@ -55,3 +55,77 @@ EptInveptAllContexts()
 {
     return EptInvept(InveptAllContext, NULL);
 }
+
+/**
+ * @brief Defer the invalidation of the EPT caches of the current core
+ * @details the invalidation is performed once before the next VM-entry, thus,
+ * several edits in a single VM-exit only need a single INVEPT. Should be called
+ * from vmx-root mode
+ *
+ * @param VCpu The virtual processor's state
+ * @param InvalidationType type of invalidation
+ *
+ * @return VOID
+ */
+VOID
+EptInveptDefer(VIRTUAL_MACHINE_STATE * VCpu, INVEPT_TYPE InvalidationType)
+{
+    if (!InveptDeferralRequest(&VCpu->EptInvalidation, InvalidationType))
+    {
+        LogError("Err, invalid invalidation parameter");
+    }
+}
+
+/**
+ * @brief Defer the invalidation of the EPT caches of all the cores
+ * @details should be called after editing the EPT of other cores, each core
+ * invalidates its EPT caches (all contexts) once before its next VM-entry,
+ * the cores that are executing the guest should be forced to exit (e.g., by
+ * a broadcast) if the edit should be visible immediately
+ *
+ * @return VOID
+ */
+VOID
+EptInveptDeferAllCores()
+{
+    InveptDeferralAdvanceGeneration(&g_EptState->InvalidationGeneration);
+}
+
+/**
+ * @brief Perform the deferred invalidations of the current core
+ * @details called before each VM-entry, it can also be called directly
+ * if the edits should be visible to the current core immediately
+ *
+ * @param VCpu The virtual processor's state
+ *
+ * @return VOID
+ */
+VOID
+EptInveptPerformDeferred(VIRTUAL_MACHINE_STATE * VCpu)
+{
+    UINT32 InvalidationType = InveptDeferralTake(&VCpu->EptInvalidation, &g_EptState->InvalidationGeneration);
+
+    if (InvalidationType == InveptAllContext)
+    {
+        EptInveptAllContexts();
+    }
+    else if (InvalidationType == InveptSingleContext)
+    {
+        EptInveptSingleContext(VCpu->EptPointer.AsUInt);
+    }
+}
+
+/**
+ * @brief Check whether an invalidation is pending for the current core
+ * @details the EPT caches of the core might still hold the entries that are
+ * changed (e.g., by other cores) until the next VM-entry
+ *
+ * @param VCpu The virtual processor's state
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+EptInveptIsDeferred(VIRTUAL_MACHINE_STATE * VCpu)
+{
+    return InveptDeferralIsPending(&VCpu->EptInvalidation, &g_EptState->InvalidationGeneration);
+}
@@ -52,7 +52,10 @@ VmxHandleXsetbv(VIRTUAL_MACHINE_STATE * VCpu)
 VOID
 VmxHandleVmxPreemptionTimerVmexit(VIRTUAL_MACHINE_STATE * VCpu)
 {
-    LogError("Why vm-exit for VMX preemption timer happened?");
+    //
+    // The VMX-preemption timer is only used by the profiler
+    //
+    ProfilerHandleVmxPreemptionTimerVmexit(VCpu);
 
     //
     // Not increase the RIP by default
@@ -724,6 +724,43 @@ HvSetModeBasedExecutionEnableFlag(BOOLEAN Set)
     VmxVmwrite64(VMCS_CTRL_SECONDARY_PROCESSOR_BASED_VM_EXECUTION_CONTROLS, AdjSecCtrl);
 }
 
+/**
+ * @brief Set Sub-page Write Permissions (SPP) Enable bit
+ *
+ * @param Set Set or unset the SPP
+ * @return VOID
+ */
+VOID
+HvSetSubPageWritePermissionsEnableFlag(BOOLEAN Set)
+{
+    UINT32 AdjSecCtrl;
+    UINT32 SecondaryProcBasedVmExecControls = 0;
+
+    //
+    // Read the previous flags
+    //
+    VmxVmread32P(VMCS_CTRL_SECONDARY_PROCESSOR_BASED_VM_EXECUTION_CONTROLS, &SecondaryProcBasedVmExecControls);
+
+    //
+    // SPP enable flag
+    //
+    if (Set)
+    {
+        SecondaryProcBasedVmExecControls |= CPU_BASED_CTL2_SUB_PAGE_WRITE_PERMISSIONS;
+    }
+    else
+    {
+        SecondaryProcBasedVmExecControls &= ~CPU_BASED_CTL2_SUB_PAGE_WRITE_PERMISSIONS;
+    }
+
+    AdjSecCtrl = HvAdjustControls(SecondaryProcBasedVmExecControls, IA32_VMX_PROCBASED_CTLS2);
+
+    //
+    // Set the new value
+    //
+    VmxVmwrite64(VMCS_CTRL_SECONDARY_PROCESSOR_BASED_VM_EXECUTION_CONTROLS, AdjSecCtrl);
+}
+
 /**
  * @brief Set NMI-window exiting
  *
@@ -1030,6 +1067,40 @@ HvSetVmxPreemptionTimerExiting(BOOLEAN Set)
     VmxVmwrite64(VMCS_CTRL_PIN_BASED_VM_EXECUTION_CONTROLS, PinBasedControls);
 }
 
+/**
+ * @brief Set the saving of the VMX-preemption timer value on vm-exits
+ * @details If it's not set, the timer is loaded with the value in VMCS
+ * on each vm-entry, so the timer never expires if the vm-exits (for
+ * other reasons) are more frequent than the timer
+ *
+ * @param Set Set or unset the saving of the VMX-preemption timer value
+ * @return VOID
+ */
+VOID
+HvSetSaveVmxPreemptionTimerValue(BOOLEAN Set)
+{
+    UINT32 VmExitControls = 0;
+
+    //
+    // Read the previous flags
+    //
+    VmxVmread32P(VMCS_CTRL_PRIMARY_VMEXIT_CONTROLS, &VmExitControls);
+
+    if (Set)
+    {
+        VmExitControls |= VM_EXIT_SAVE_VMX_PREEMPTION_TIMER;
+    }
+    else
+    {
+        VmExitControls &= ~VM_EXIT_SAVE_VMX_PREEMPTION_TIMER;
+    }
+
+    //
+    // Set the new value
+    //
+    VmxVmwrite64(VMCS_CTRL_PRIMARY_VMEXIT_CONTROLS, VmExitControls);
+}
+
 /**
  * @brief Set exception bitmap in VMCS
  * @details Should be called in vmx-root
@@ -229,6 +229,33 @@ IoHandleSetIoBitmap(VIRTUAL_MACHINE_STATE * VCpu, UINT32 Port)
     return TRUE;
 }
 
+/**
+ * @brief Unset bits in I/O Bitmap
+ *
+ * @param VCpu The virtual processor's state
+ * @param Port Port
+ *
+ * @return BOOLEAN Returns true if the I/O Bitmap is successfully applied or false if not applied
+ */
+BOOLEAN
+IoHandleUnSetIoBitmap(VIRTUAL_MACHINE_STATE * VCpu, UINT32 Port)
+{
+    if (Port <= 0x7FFF)
+    {
+        ClearBit(Port, (unsigned long *)VCpu->IoBitmapVirtualAddressA);
+    }
+    else if ((0x8000 <= Port) && (Port <= 0xFFFF))
+    {
+        ClearBit(Port - 0x8000, (unsigned long *)VCpu->IoBitmapVirtualAddressB);
+    }
+    else
+    {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 /**
  * @brief Change I/O Bitmap
  * @details should be called in vmx-root mode
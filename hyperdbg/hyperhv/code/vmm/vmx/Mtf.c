@@ -72,6 +72,24 @@ MtfHandleVmexit(VIRTUAL_MACHINE_STATE * VCpu)
         HvEnableAndCheckForPreviousExternalInterrupts(VCpu);
     }
 
+    //
+    // Protect the pages of the monitored ranges again
+    //
+    if (VCpu->NumberOfMtfMonitorRangeRestoreAddresses != 0 || VCpu->MtfMonitorRangeRestorePoint != NULL)
+    {
+        //
+        // MTF is handled
+        //
+        IsMtfHandled = TRUE;
+
+        MonitorRangeHandleMonitorTrapFlag(VCpu);
+
+        //
+        // Check for reenabling external interrupts
+        //
+        HvEnableAndCheckForPreviousExternalInterrupts(VCpu);
+    }
+
     //
     // Check for instrumentation step-in
     //
@@ -185,13 +185,25 @@ VmxVmcallHandler(VIRTUAL_MACHINE_STATE * VCpu,
     }
     case VMCALL_INVEPT_SINGLE_CONTEXT:
     {
-        EptInveptSingleContext(OptionalParam1);
+        //
+        // The invalidation of the core's EPTP is coalesced with the other
+        // (deferred) invalidations and is performed before the VM-entry
+        //
+        if (OptionalParam1 == VCpu->EptPointer.AsUInt)
+        {
+            EptInveptDefer(VCpu, InveptSingleContext);
+        }
+        else
+        {
+            EptInveptSingleContext(OptionalParam1);
+        }
+
         VmcallStatus = STATUS_SUCCESS;
         break;
     }
     case VMCALL_INVEPT_ALL_CONTEXTS:
     {
-        EptInveptAllContexts();
+        EptInveptDefer(VCpu, InveptAllContext);
         VmcallStatus = STATUS_SUCCESS;
         break;
     }
@@ -210,6 +222,15 @@ VmxVmcallHandler(VIRTUAL_MACHINE_STATE * VCpu,
 
         break;
     }
+    case VMCALL_REMOVE_MONITOR_RANGE:
+    {
+        if (MonitorRangeRemoveByHookingTag(OptionalParam1))
+            VmcallStatus = STATUS_SUCCESS;
+        else
+            VmcallStatus = STATUS_UNSUCCESSFUL;
+
+        break;
+    }
     case VMCALL_ENABLE_SYSCALL_HOOK_EFER:
     {
         SyscallHookConfigureEFER(VCpu, TRUE);
@@ -437,6 +458,26 @@ VmxVmcallHandler(VIRTUAL_MACHINE_STATE * VCpu,
         VmcallStatus = STATUS_SUCCESS;
         break;
     }
+    case VMCALL_ENABLE_PROFILER:
+    {
+        if (ProfilerEnable(VCpu))
+        {
+            VmcallStatus = STATUS_SUCCESS;
+        }
+        else
+        {
+            VmcallStatus = STATUS_UNSUCCESSFUL;
+        }
+
+        break;
+    }
+    case VMCALL_DISABLE_PROFILER:
+    {
+        ProfilerDisable(VCpu);
+
+        VmcallStatus = STATUS_SUCCESS;
+        break;
+    }
     case VMCALL_CHANGE_TO_MBEC_SUPPORTED_EPTP:
     {
         ExecTrapChangeToUserDisabledMbecEptp(VCpu);
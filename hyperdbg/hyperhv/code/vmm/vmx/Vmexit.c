@@ -314,6 +314,15 @@ VmxVmexitHandler(_Inout_ PGUEST_REGS GuestRegs)
 
         break;
     }
+    case SPP_VMX_EXIT_REASON_SPP_RELATED_EVENT:
+    {
+        //
+        // Handle SPPT misses and misconfigurations
+        //
+        SppHandleVmexit(VCpu);
+
+        break;
+    }
     default:
     {
         LogError("Err, unknown vmexit, reason : 0x%llx", ExitReason);
@@ -353,6 +362,14 @@ VmxVmexitHandler(_Inout_ PGUEST_REGS GuestRegs)
         Result = TRUE;
     }
 
+    //
+    // Perform the deferred EPT invalidations (at most one INVEPT) before resuming the guest
+    //
+    if (!VCpu->VmxoffState.IsVmxoffExecuted)
+    {
+        EptInveptPerformDeferred(VCpu);
+    }
+
     //
     // Set indicator of Vmx non root mode to false
     //
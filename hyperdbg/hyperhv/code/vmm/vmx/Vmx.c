@@ -472,6 +472,11 @@ VmxPerformVirtualizationOnAllCores()
         return FALSE;
     }
 
+    //
+    // Initialize the sub-page write permissions (not mandatory)
+    //
+    SppInitialize();
+
     if (!EptLogicalProcessorInitialize())
     {
         //
@@ -480,6 +485,11 @@ VmxPerformVirtualizationOnAllCores()
         return FALSE;
     }
 
+    //
+    // Initialize the original views of the EPT (not mandatory)
+    //
+    EptViewInitialize();
+
     //
     // Broadcast to run vmx-specific task to virtualize cores
     //
@@ -891,6 +901,11 @@ VmxSetupVmcs(VIRTUAL_MACHINE_STATE * VCpu, PVOID GuestStack)
 
     LogDebugInfo("Secondary Proc Based VM Exec Controls (IA32_VMX_PROCBASED_CTLS2) : 0x%x", SecondaryProcBasedVmExecControls);
 
+    //
+    // Enable sub-page write permissions (if supported) for the monitors
+    //
+    SppEnable(VCpu);
+
     VmxVmwrite64(VMCS_CTRL_PIN_BASED_VM_EXECUTION_CONTROLS, HvAdjustControls(0, VmxBasicMsr.VmxControls ? IA32_VMX_TRUE_PINBASED_CTLS : IA32_VMX_PINBASED_CTLS));
 
     VmxVmwrite64(VMCS_CTRL_PRIMARY_VMEXIT_CONTROLS, HvAdjustControls(VM_EXIT_HOST_ADDR_SPACE_SIZE, VmxBasicMsr.VmxControls ? IA32_VMX_TRUE_EXIT_CTLS : IA32_VMX_EXIT_CTLS));
@@ -1245,6 +1260,11 @@ VmxPerformTermination()
     PlatformMemFreePool(g_MsrBitmapInvalidMsrs);
     g_MsrBitmapInvalidMsrs = NULL;
 
+    //
+    // Free the original views of the EPT
+    //
+    EptViewUninitialize();
+
     //
     // Free Identity Page Table
     //
@@ -1258,6 +1278,11 @@ VmxPerformTermination()
         g_GuestState[i].EptPageTable = NULL;
     }
 
+    //
+    // Free the SPP table
+    //
+    SppUninitialize();
+
     //
     // Free EptState
     //
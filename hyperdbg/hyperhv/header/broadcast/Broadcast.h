@@ -33,6 +33,12 @@ BroadcastEnablePmlOnAllProcessors();
 VOID
 BroadcastDisablePmlOnAllProcessors();
 
+VOID
+BroadcastEnableProfilerOnAllProcessors();
+
+VOID
+BroadcastDisableProfilerOnAllProcessors();
+
 VOID
 BroadcastChangeToMbecSupportedEptpOnAllProcessors();
 
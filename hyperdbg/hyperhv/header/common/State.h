@@ -37,6 +37,13 @@ typedef EPT_PTE     EPT_PML1_ENTRY, *PEPT_PML1_ENTRY;
  */
 #define MaximumHiddenBreakpointsOnPage 40
 
+/**
+ * @brief Maximum number of pages of the monitored ranges that are
+ * accessible for a single instruction (until the next MTF)
+ *
+ */
+#define MAXIMUM_MONITOR_RANGE_RESTORE_POINTS 4
+
 //////////////////////////////////////////////////
 //					  Enums		    			//
 //////////////////////////////////////////////////
@@ -125,6 +132,40 @@ typedef struct _VMM_EPT_PAGE_TABLE
 
 } VMM_EPT_PAGE_TABLE, *PVMM_EPT_PAGE_TABLE;
 
+/**
+ * @brief An alternate view of the core-specific EPT
+ * @details the view has its own PML4 and PML3, the PML2 and PML1 tables are
+ * shared with the core's EPT and they are copied only once they differ
+ *
+ */
+typedef struct _EPT_VIEW
+{
+    /**
+     * @brief The PML4 of the view (only the first entry is used)
+     */
+    DECLSPEC_ALIGN(PAGE_SIZE)
+    EPT_PML4_POINTER PML4[VMM_EPT_PML4E_COUNT];
+
+    /**
+     * @brief The PML3 of the view which points either to the PML2 tables of
+     * the core's EPT or to the PML2 tables that are copied for the view
+     */
+    DECLSPEC_ALIGN(PAGE_SIZE)
+    EPT_PML3_POINTER PML3[VMM_EPT_PML3E_COUNT];
+
+    /**
+     * @brief Extended-Page-Table Pointer of the view
+     */
+    EPT_POINTER EptPointer;
+
+    /**
+     * @brief Whether the paging tables of the view are changed since
+     * the last time that the view is used
+     */
+    BOOLEAN IsModified;
+
+} EPT_VIEW, *PEPT_VIEW;
+
 //////////////////////////////////////////////////
 //					  Structure	    			//
 //////////////////////////////////////////////////
@@ -155,6 +196,21 @@ typedef struct _VMX_VMXOFF_STATE
 
 } VMX_VMXOFF_STATE, *PVMX_VMXOFF_STATE;
 
+/**
+ * @brief The state of tracing the branches (LBR) on a core
+ * @details the debug controls and the LBR bit of the guest are restored
+ * when the tracing is disabled on the core
+ *
+ */
+typedef struct _VMX_BRANCH_TRACE_STATE
+{
+    BOOLEAN IsEnabled;               // Shows whether the LBR is enabled on this core by the branch tracing or not
+    BOOLEAN WereDebugControlsLoaded; // The previous state of the load debug controls (vm-entry controls)
+    BOOLEAN WereDebugControlsSaved;  // The previous state of the save debug controls (vm-exit controls)
+    BOOLEAN WasLbrEnabled;           // The previous state of the LBR bit of the guest's IA32_DEBUGCTL
+
+} VMX_BRANCH_TRACE_STATE, *PVMX_BRANCH_TRACE_STATE;
+
 /**
  * @brief Structure to save the state of each hooked pages
  *
@@ -269,6 +325,26 @@ typedef struct _EPT_HOOKED_PAGE_DETAIL
      */
     CHAR PreviousBytesOnBreakpointAddresses[MaximumHiddenBreakpointsOnPage];
 
+    /**
+     * @brief Trampolines that execute the instructions of BreakpointAddresses
+     * (NULL if the instruction is executed using MTF)
+     * this is only used in hidden breakpoints (not hidden detours)
+     */
+    PCHAR DisplacedTrampolines[MaximumHiddenBreakpointsOnPage];
+
+    /**
+     * @brief Trampolines of the removed breakpoints (NULL if the slot is empty)
+     * they're never freed as a thread might still be executing them
+     * this is only used in hidden breakpoints (not hidden detours)
+     */
+    PCHAR RetiredTrampolines[MaximumHiddenBreakpointsOnPage];
+
+    /**
+     * @brief Address of the breakpoints that RetiredTrampolines were built for
+     * this is only used in hidden breakpoints (not hidden detours)
+     */
+    UINT64 RetiredTrampolineAddresses[MaximumHiddenBreakpointsOnPage];
+
     /**
      * @brief Count of breakpoints (multiple breakpoints on a single page)
      * this is only used in hidden breakpoints (not hidden detours)
@@ -277,6 +353,91 @@ typedef struct _EPT_HOOKED_PAGE_DETAIL
 
 } EPT_HOOKED_PAGE_DETAIL, *PEPT_HOOKED_PAGE_DETAIL;
 
+/**
+ * @brief Structure to save the state of a monitored physical range
+ * @details a single descriptor describes a physically contiguous range of
+ * pages, the large pages that are completely in the range are not split
+ *
+ */
+typedef struct _EPT_MONITOR_RANGE
+{
+    /**
+     * @brief The base address of the first page of the range
+     */
+    SIZE_T PhysicalBaseAddress;
+
+    /**
+     * @brief The last byte of the last page of the range
+     */
+    SIZE_T PhysicalEndAddress;
+
+    /**
+     * @brief Start address of the target physical address.
+     */
+    SIZE_T StartOfTargetPhysicalAddress;
+
+    /**
+     * @brief End address of the target physical address.
+     */
+    SIZE_T EndOfTargetPhysicalAddress;
+
+    /**
+     * @brief The virtual address of the first page of the range from
+     * the caller perspective view (cr3)
+     */
+    UINT64 VirtualAddress;
+
+    /**
+     * @brief Tag used for notifying the caller.
+     */
+    UINT64 HookingTag;
+
+    /**
+     * @brief Mask of the accesses that are monitored (PAGE_ATTRIB_*)
+     */
+    UINT32 PageHookMask;
+
+} EPT_MONITOR_RANGE, *PEPT_MONITOR_RANGE;
+
+/**
+ * @brief The last violation of a monitored range on a core
+ * @details a range might be accessed by multiple cores at the same time,
+ * so the context of its post event is kept per core
+ *
+ */
+typedef struct _EPT_MONITOR_RANGE_VIOLATION
+{
+    /**
+     * @brief Temporary context for the post event monitors
+     * It shows the context of the last address that triggered the monitor
+     */
+    EPT_HOOKS_CONTEXT LastContextState;
+
+    /**
+     * @brief This field shows whether the monitor should call the post event trigger
+     * after restoring the state or not
+     */
+    BOOLEAN IsPostEventTriggerAllowed;
+
+    /**
+     * @brief This field shows the last violation happened to the range
+     */
+    EPT_HOOKED_LAST_VIOLATION LastViolation;
+
+} EPT_MONITOR_RANGE_VIOLATION, *PEPT_MONITOR_RANGE_VIOLATION;
+
+/**
+ * @brief A page of a monitored range that is accessible for a single
+ * instruction (until the next MTF)
+ *
+ */
+typedef struct _EPT_MONITOR_RANGE_RESTORE_POINT
+{
+    SIZE_T  PhysicalAddress;     // The physical address of the page
+    BOOLEAN IsOnOriginalEptView; // Whether the page is unprotected in the original view or in the EPT of the core
+
+} EPT_MONITOR_RANGE_RESTORE_POINT, *PEPT_MONITOR_RANGE_RESTORE_POINT;
+
 /**
  * @brief The status of NMI broadcasting in VMX
  *
@@ -339,11 +500,24 @@ typedef struct _VIRTUAL_MACHINE_STATE
     UINT64                  HostGdt;                                            // host Global Descriptor Table (actual type is SEGMENT_DESCRIPTOR_32* or SEGMENT_DESCRIPTOR_64*)
     UINT64                  HostTss;                                            // host Task State Segment (actual type is TASK_STATE_SEGMENT_64*)
     UINT64                  HostInterruptStack;                                 // host interrupt RSP
+    PPROFILER_SAMPLES_RING  ProfilerSamplesRing;                                // The samples of the profiler on this core
+    VMX_BRANCH_TRACE_STATE  BranchTraceState;                                   // The state of tracing the branches on this core
+
+    //
+    // Monitored ranges
+    //
+    PEPT_MONITOR_RANGE              MtfMonitorRangeRestorePoint;                                            // The monitored range that should trigger its post event in MTF vm-exit
+    EPT_MONITOR_RANGE_RESTORE_POINT MtfMonitorRangeRestoreAddresses[MAXIMUM_MONITOR_RANGE_RESTORE_POINTS]; // The monitored pages that should be protected again in MTF vm-exit
+    UINT32                          NumberOfMtfMonitorRangeRestoreAddresses;                                // Number of the valid entries in MtfMonitorRangeRestoreAddresses
+    EPT_MONITOR_RANGE_VIOLATION     MonitorRangeViolation;                                                  // The last violation of a monitored range on this core (for its post event)
 
     //
     // EPT Descriptors
     //
-    EPT_POINTER         EptPointer;   // Extended-Page-Table Pointer
-    PVMM_EPT_PAGE_TABLE EptPageTable; // Details of core-specific page-table
+    EPT_POINTER         EptPointer;          // Extended-Page-Table Pointer
+    PVMM_EPT_PAGE_TABLE EptPageTable;        // Details of core-specific page-table
+    PEPT_VIEW           OriginalEptView;     // View of the core-specific page-table in which the hooked pages have their original entries
+    BOOLEAN             IsOnOriginalEptView; // Indicate that the processor is on the original EPT view (until the next MTF)
+    INVEPT_DEFERRAL     EptInvalidation;     // The deferred invalidations of the EPT caches of this core (performed before the next VM-entry)
 
 } VIRTUAL_MACHINE_STATE, *PVIRTUAL_MACHINE_STATE;
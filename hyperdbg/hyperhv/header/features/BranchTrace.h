@@ -0,0 +1,65 @@
+/**
+ * @file BranchTrace.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of tracing the branches (last branch records)
+ * @details
+ * @version 0.11
+ * @date 2024-11-08
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//				   Constants					//
+//////////////////////////////////////////////////
+
+/**
+ * @brief MSR of the performance capabilities (format of the LBRs)
+ *
+ */
+#define BRANCH_TRACE_MSR_PERF_CAPABILITIES 0x345
+
+/**
+ * @brief MSR of the top of the stack of the last branch records
+ *
+ */
+#define BRANCH_TRACE_MSR_LASTBRANCH_TOS 0x1c9
+
+/**
+ * @brief The first MSR of the sources of the last branch records
+ *
+ */
+#define BRANCH_TRACE_MSR_LASTBRANCH_0_FROM_IP 0x680
+
+/**
+ * @brief The first MSR of the destinations of the last branch records
+ *
+ */
+#define BRANCH_TRACE_MSR_LASTBRANCH_0_TO_IP 0x6c0
+
+/**
+ * @brief Mask of the format of the LBRs in IA32_PERF_CAPABILITIES
+ *
+ */
+#define BRANCH_TRACE_PERF_CAPABILITIES_LBR_FORMAT_MASK 0x3f
+
+//////////////////////////////////////////////////
+//				   Functions					//
+//////////////////////////////////////////////////
+
+static VOID
+BranchTraceClearStack();
+
+BOOLEAN
+BranchTraceQuerySupport(UINT32 * LbrFormat);
+
+VOID
+BranchTraceEnableOnCurrentCore(VIRTUAL_MACHINE_STATE * VCpu, BOOLEAN Enable);
+
+UINT32
+BranchTraceDrainOnCurrentCore(VIRTUAL_MACHINE_STATE *       VCpu,
+                              PDEBUGGER_BRANCH_TRACE_RECORD Records,
+                              UINT32                        MaximumNumberOfRecords,
+                              BOOLEAN *                     IsOverflowed);
@@ -22,13 +22,18 @@
  */
 typedef struct _COMPATIBILITY_CHECKS_STATUS
 {
-    BOOLEAN IsX2Apic;                  // X2APIC or XAPIC routine
-    BOOLEAN RtmSupport;                // check for RTM support
-    BOOLEAN PmlSupport;                // check Page Modification Logging (PML) support
-    BOOLEAN ModeBasedExecutionSupport; // check for mode based execution support (processors after Kaby Lake release will support this feature)
-    BOOLEAN ExecuteOnlySupport;        // Support for execute-only pages (indicating that data accesses are not allowed while instruction fetches are allowed)
-    UINT32  VirtualAddressWidth;       // Virtual address width for x86 processors
-    UINT32  PhysicalAddressWidth;      // Physical address width for x86 processors
+    BOOLEAN IsX2Apic;                       // X2APIC or XAPIC routine
+    BOOLEAN RtmSupport;                     // check for RTM support
+    BOOLEAN PmlSupport;                     // check Page Modification Logging (PML) support
+    BOOLEAN ModeBasedExecutionSupport;      // check for mode based execution support (processors after Kaby Lake release will support this feature)
+    BOOLEAN ExecuteOnlySupport;             // Support for execute-only pages (indicating that data accesses are not allowed while instruction fetches are allowed)
+    BOOLEAN SubPageWritePermissionsSupport; // Support for sub-page write permissions (SPP) for EPT
+    BOOLEAN VmxPreemptionTimerSupport;      // Support for the VMX-preemption timer (and saving its value on vm-exits)
+    BOOLEAN LastBranchRecordSupport;        // Support for the legacy last branch records (LBR)
+    UINT32  LastBranchRecordFormat;         // Format of the last branch records (IA32_PERF_CAPABILITIES)
+    UINT32  LastBranchRecordDepth;          // Number of the entries of the LBR stack (model-specific)
+    UINT32  VirtualAddressWidth;            // Virtual address width for x86 processors
+    UINT32  PhysicalAddressWidth;           // Physical address width for x86 processors
 
 } COMPATIBILITY_CHECKS_STATUS, *PCOMPATIBILITY_CHECKS_STATUS;
 
@@ -0,0 +1,65 @@
+/**
+ * @file Profiler.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of the sampling profiler (VMX-preemption timer)
+ * @details
+ * @version 0.11
+ * @date 2024-11-01
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//				   Constants					//
+//////////////////////////////////////////////////
+
+/**
+ * @brief Number of the stack entries (from the RSP of the guest) that
+ * are checked for the return addresses of each sample
+ *
+ */
+#define PROFILER_STACK_SCAN_WINDOW 64
+
+/**
+ * @brief The values on the stack that are closer than this distance to
+ * the RSP of the guest are considered as the stack pointers (not return
+ * addresses)
+ *
+ */
+#define PROFILER_STACK_POINTER_DISTANCE 0x10000
+
+//////////////////////////////////////////////////
+//				   Functions					//
+//////////////////////////////////////////////////
+
+static VOID
+ProfilerFreeSamplesRings();
+
+static VOID
+ProfilerCollectStack(VIRTUAL_MACHINE_STATE * VCpu, PDEBUGGER_PROFILER_SAMPLE Sample);
+
+static VOID
+ProfilerTakeSample(VIRTUAL_MACHINE_STATE * VCpu, PPROFILER_SAMPLES_RING Ring);
+
+BOOLEAN
+ProfilerStart(PDEBUGGER_PROFILER_REQUEST ProfilerRequest, UINT64 SamplingPeriod);
+
+VOID
+ProfilerStop();
+
+VOID
+ProfilerUninitialize();
+
+BOOLEAN
+ProfilerEnable(VIRTUAL_MACHINE_STATE * VCpu);
+
+VOID
+ProfilerDisable(VIRTUAL_MACHINE_STATE * VCpu);
+
+VOID
+ProfilerHandleVmxPreemptionTimerVmexit(VIRTUAL_MACHINE_STATE * VCpu);
+
+BOOLEAN
+ProfilerReadSamples(PDEBUGGER_PROFILER_REQUEST ProfilerRequest, UINT32 MaximumNumberOfSamples);
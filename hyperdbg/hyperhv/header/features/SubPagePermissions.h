@@ -0,0 +1,66 @@
+/**
+ * @file SubPagePermissions.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers for the sub-page write permissions (SPP) of EPT
+ * @details
+ * @version 0.11
+ * @date 2024-10-28
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//				   Constants					//
+//////////////////////////////////////////////////
+
+/**
+ * @brief Bit 61 of an EPT PTE that maps a 4-KByte page enables
+ * sub-page write permissions for the page
+ *
+ */
+#define SPP_EPT_ENTRY_SUB_PAGE_WRITE_PERMISSIONS_FLAG (1ULL << 61)
+
+/**
+ * @brief VMCS field encoding of the SPP-table pointer (SPPTP)
+ *
+ */
+#define SPP_VMCS_CTRL_TABLE_POINTER 0x00002030
+
+/**
+ * @brief The exit reason of the SPP-related events
+ *
+ */
+#define SPP_VMX_EXIT_REASON_SPP_RELATED_EVENT 66
+
+/**
+ * @brief Bit 11 of the exit qualification of SPP-related events shows
+ * an SPPT misconfiguration (otherwise, it's an SPPT miss)
+ *
+ */
+#define SPP_EXIT_QUALIFICATION_MISCONFIGURATION_FLAG (1ULL << 11)
+
+//////////////////////////////////////////////////
+//				   Functions					//
+//////////////////////////////////////////////////
+
+BOOLEAN
+SppInitialize();
+
+VOID
+SppUninitialize();
+
+BOOLEAN
+SppEnable(VIRTUAL_MACHINE_STATE * VCpu);
+
+BOOLEAN
+SppSetWritePermissions(UINT64 PhysicalBaseAddress, UINT64 WritePermissions);
+
+BOOLEAN
+SppApplyToMonitoredPage(UINT64 PhysicalBaseAddress,
+                        UINT64 StartOfTargetPhysicalAddress,
+                        UINT64 EndOfTargetPhysicalAddress);
+
+VOID
+SppHandleVmexit(VIRTUAL_MACHINE_STATE * VCpu);
@@ -195,3 +195,31 @@ UINT64 g_PageFaultInjectionAddressTo;
  *
  */
 UINT32 g_PageFaultInjectionErrorCode;
+
+//////////////////////////////////////////////////
+//		    Global Variable (profiler)		    //
+//////////////////////////////////////////////////
+
+/**
+ * @brief Shows whether the profiler is running or not
+ *
+ */
+BOOLEAN g_ProfilerIsRunning;
+
+/**
+ * @brief The value of the VMX-preemption timer for each sample
+ *
+ */
+UINT32 g_ProfilerTimerValue;
+
+/**
+ * @brief Maximum number of the stack entries of each sample
+ *
+ */
+UINT32 g_ProfilerStackDepth;
+
+/**
+ * @brief The process that is sampled by the profiler
+ *
+ */
+UINT32 g_ProfilerProcessId;
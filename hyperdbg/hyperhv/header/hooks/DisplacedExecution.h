@@ -0,0 +1,27 @@
+/**
+ * @file DisplacedExecution.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of the displaced execution of hidden breakpoints
+ * @details
+ * @version 0.11
+ * @date 2024-10-30
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//				   Functions					//
+//////////////////////////////////////////////////
+
+BOOLEAN
+DisplacedExecutionBuildTrampoline(PEPT_HOOKED_PAGE_DETAIL HookedEntry, UINT32 BreakpointIndex);
+
+VOID
+DisplacedExecutionRetireTrampoline(PEPT_HOOKED_PAGE_DETAIL HookedEntry, UINT32 BreakpointIndex);
+
+BOOLEAN
+DisplacedExecutionResumeInTrampoline(VIRTUAL_MACHINE_STATE * VCpu,
+                                     PEPT_HOOKED_PAGE_DETAIL HookedEntry,
+                                     UINT64                  GuestRip);
@@ -479,6 +479,16 @@ EptHookModifyPageWriteState(VIRTUAL_MACHINE_STATE * VCpu,
                             PVOID                   PhysicalAddress,
                             BOOLEAN                 IsUnset);
 
+/**
+ * @brief Trigger the post event of the last violation of a hooked page
+ *
+ * @param VCpu The virtual processor's state
+ * @param HookedEntry
+ * @return VOID
+ */
+VOID
+EptHookTriggerPostEvent(VIRTUAL_MACHINE_STATE * VCpu, PEPT_HOOKED_PAGE_DETAIL HookedEntry);
+
 /**
  * @brief Handle vm-exits for Monitor Trap Flag to restore previous state
  *
@@ -0,0 +1,21 @@
+/**
+ * @file MonitorEmulationHandler.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of the emulation of the memory accesses to the monitored pages
+ * @details
+ * @version 0.11
+ * @date 2024-10-27
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//				      Functions					//
+//////////////////////////////////////////////////
+
+BOOLEAN
+MonitorEmulationHandleAccess(VIRTUAL_MACHINE_STATE *              VCpu,
+                             VMX_EXIT_QUALIFICATION_EPT_VIOLATION ViolationQualification,
+                             UINT64                               GuestPhysicalAddr);
@@ -0,0 +1,48 @@
+/**
+ * @file MonitorRange.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of the range descriptors of the memory monitors
+ * @details
+ * @version 0.11
+ * @date 2024-10-31
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//				   Functions					//
+//////////////////////////////////////////////////
+
+PEPT_MONITOR_RANGE
+MonitorRangeFind(SIZE_T PhysicalAddress);
+
+BOOLEAN
+MonitorRangeIsOverlapping(SIZE_T PhysicalBaseAddress, SIZE_T PhysicalEndAddress);
+
+BOOLEAN
+MonitorRangeApply(PVOID HookingDetails, CR3_TYPE ProcessCr3, UINT32 PageHookMask);
+
+BOOLEAN
+MonitorRangeRemoveByHookingTag(UINT64 HookingTag);
+
+VOID
+MonitorRangeRemoveAll();
+
+BOOLEAN
+MonitorRangeHandleViolation(VIRTUAL_MACHINE_STATE *              VCpu,
+                            PEPT_MONITOR_RANGE                   Range,
+                            VMX_EXIT_QUALIFICATION_EPT_VIOLATION ViolationQualification,
+                            SIZE_T                               PhysicalAddress,
+                            BOOLEAN *                            IgnoreReadOrWriteOrExec,
+                            BOOLEAN *                            IsExecViolation);
+
+VOID
+MonitorRangeTriggerPostEvent(VIRTUAL_MACHINE_STATE * VCpu);
+
+BOOLEAN
+MonitorRangeUnprotectForInstruction(VIRTUAL_MACHINE_STATE * VCpu, SIZE_T PhysicalAddress);
+
+VOID
+MonitorRangeHandleMonitorTrapFlag(VIRTUAL_MACHINE_STATE * VCpu);
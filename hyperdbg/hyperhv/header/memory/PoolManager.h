@@ -22,6 +22,12 @@
 #define MaximumRequestsQueueDepth   300
 #define NumberOfPreAllocatedBuffers 10
 
+/**
+ * @brief Interval of checking the replenishment requests by the worker (in milliseconds)
+ *
+ */
+#define POOL_MANAGER_REPLENISHMENT_INTERVAL 10
+
 //////////////////////////////////////////////////
 //                   Structures		   			//
 //////////////////////////////////////////////////
@@ -94,6 +100,43 @@ BOOLEAN g_IsNewRequestForDeAllocation;
  */
 LIST_ENTRY g_ListOfAllocatedPoolsHead;
 
+/**
+ * @brief State of the pools of each intention (protected by LockForReadingPool)
+ *
+ */
+POOL_WATERMARK_STATE g_PoolManagerIntentionStates[POOL_ALLOCATION_INTENTION_COUNT];
+
+/**
+ * @brief We set it when an intention needs to be replenished
+ *
+ */
+BOOLEAN g_IsPoolReplenishmentRequested;
+
+/**
+ * @brief Shows whether the pool manager is initialized or not
+ *
+ */
+BOOLEAN g_IsPoolManagerInitialized;
+
+/**
+ * @brief Mutex for performing the allocations and deallocations from
+ * PASSIVE_LEVEL (IOCTLs and the replenishment worker)
+ *
+ */
+FAST_MUTEX g_PoolManagerAllocationMutex;
+
+/**
+ * @brief The thread object of the replenishment worker
+ *
+ */
+PVOID g_PoolManagerWorkerThread;
+
+/**
+ * @brief Set to stop the replenishment worker
+ *
+ */
+volatile BOOLEAN g_PoolManagerWorkerStopRequested;
+
 //////////////////////////////////////////////////
 //                   Functions		  			//
 //////////////////////////////////////////////////
@@ -110,6 +153,12 @@ PlmgrAllocateRequestNewAllocation(SIZE_T NumberOfBytes);
 
 static VOID PlmgrFreeRequestNewAllocation(VOID);
 
+static BOOLEAN
+PlmgrReplenishPools();
+
+static VOID
+PlmgrReplenishmentWorker(PVOID Context);
+
 // ----------------------------------------------------------------------------
 // Public Interfaces
 //
@@ -60,6 +60,12 @@
  */
 #define ADDRMASK_EPT_PML4_INDEX(_VAR_) (((_VAR_) & 0xFF8000000000ULL) >> 39)
 
+/**
+ * @brief Maximum number of the monitored physical ranges
+ *
+ */
+#define MAXIMUM_NUMBER_OF_MONITOR_RANGES 256
+
 //////////////////////////////////////////////////
 //			     Structs Cont.                	//
 //////////////////////////////////////////////////
@@ -124,6 +130,11 @@ typedef struct _EPT_STATE
     EPT_POINTER           ModeBasedUserDisabledEptPointer;     // Extended-Page-Table Pointer for user-disabled mode-based execution
     EPT_POINTER           ModeBasedKernelDisabledEptPointer;   // Extended-Page-Table Pointer for kernel-disabled mode-based execution
     EPT_POINTER           ExecuteOnlyEptPointer;               // Extended-Page-Table Pointer for execute-only execution
+    PSPP_TABLE            SppTable;                            // Root (SPPL4) of the sub-page permission table, shared by all cores
+    volatile LONG64       InvalidationGeneration;              // Generation of the EPT edits that need all the cores to invalidate their EPT caches
+    PEPT_MONITOR_RANGE    MonitorRanges[MAXIMUM_NUMBER_OF_MONITOR_RANGES]; // Descriptors of the monitored physical ranges (sorted by their base address)
+    UINT32                NumberOfMonitorRanges;               // Number of the descriptors in MonitorRanges
+    volatile LONG         MonitorRangesLock;                   // Lock of the list of the monitored ranges
     UINT8                 DefaultMemoryType;
 } EPT_STATE, *PEPT_STATE;
 
@@ -174,6 +185,11 @@ EptHandlePageHookExit(_Inout_ VIRTUAL_MACHINE_STATE *           VCpu,
                       _In_ VMX_EXIT_QUALIFICATION_EPT_VIOLATION ViolationQualification,
                       _In_ UINT64                               GuestPhysicalAddr);
 
+BOOLEAN
+EptHandleMonitorRangeExit(VIRTUAL_MACHINE_STATE *              VCpu,
+                          VMX_EXIT_QUALIFICATION_EPT_VIOLATION ViolationQualification,
+                          UINT64                               GuestPhysicalAddr);
+
 // ----------------------------------------------------------------------------
 // Public Interfaces
 //
@@ -0,0 +1,37 @@
+/**
+ * @file EptView.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of the alternate views of the EPT
+ * @details
+ * @version 0.11
+ * @date 2024-10-29
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//					Functions					//
+//////////////////////////////////////////////////
+
+BOOLEAN
+EptViewInitialize();
+
+VOID
+EptViewUninitialize();
+
+PVOID
+EptViewGetPml1OrPml2Entry(PEPT_VIEW View, SIZE_T PhysicalAddress, BOOLEAN * IsLargePage);
+
+PEPT_PML1_ENTRY
+EptViewGetPml1Entry(PEPT_VIEW View, SIZE_T PhysicalAddress);
+
+BOOLEAN
+EptViewSetOriginalEntry(VIRTUAL_MACHINE_STATE * VCpu, SIZE_T PhysicalAddress, EPT_PML1_ENTRY OriginalEntry);
+
+BOOLEAN
+EptViewSwitchToOriginalView(VIRTUAL_MACHINE_STATE * VCpu, PEPT_HOOKED_PAGE_DETAIL HookedEntry);
+
+BOOLEAN
+EptViewRestoreNormalView(VIRTUAL_MACHINE_STATE * VCpu);
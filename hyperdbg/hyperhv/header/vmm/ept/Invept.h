@@ -27,3 +27,15 @@ EptInveptAllContexts();
 
 UCHAR
 EptInveptSingleContext(_In_ UINT64 EptPonter);
+
+VOID
+EptInveptDefer(VIRTUAL_MACHINE_STATE * VCpu, INVEPT_TYPE InvalidationType);
+
+VOID
+EptInveptDeferAllCores();
+
+VOID
+EptInveptPerformDeferred(VIRTUAL_MACHINE_STATE * VCpu);
+
+BOOLEAN
+EptInveptIsDeferred(VIRTUAL_MACHINE_STATE * VCpu);
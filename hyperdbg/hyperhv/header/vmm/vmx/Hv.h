@@ -215,6 +215,15 @@ HvSetPmlEnableFlag(BOOLEAN Set);
 VOID
 HvSetModeBasedExecutionEnableFlag(BOOLEAN Set);
 
+/**
+ * @brief Set Sub-page Write Permissions (SPP) Enable bit
+ *
+ * @param Set Set or unset the SPP
+ * @return VOID
+ */
+VOID
+HvSetSubPageWritePermissionsEnableFlag(BOOLEAN Set);
+
 /**
  * @brief Set NMI-window exiting
  *
@@ -260,6 +269,15 @@ HvSetNmiExiting(BOOLEAN Set);
 VOID
 HvSetVmxPreemptionTimerExiting(BOOLEAN Set);
 
+/**
+ * @brief Set the saving of the VMX-preemption timer value on vm-exits
+ *
+ * @param Set
+ * @return VOID
+ */
+VOID
+HvSetSaveVmxPreemptionTimerValue(BOOLEAN Set);
+
 /**
  * @brief Set exception bitmap in VMCS
  * @details Should be called in vmx-root
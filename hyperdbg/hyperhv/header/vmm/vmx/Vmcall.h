@@ -321,6 +321,24 @@
  */
 #define VMCALL_WRITE_PHYSICAL_MEMORY 0x00000031
 
+/**
+ * @brief VMCALL to remove a monitored physical range by its tag
+ *
+ */
+#define VMCALL_REMOVE_MONITOR_RANGE 0x00000032
+
+/**
+ * @brief VMCALL to enable the profiler (VMX-preemption timer)
+ *
+ */
+#define VMCALL_ENABLE_PROFILER 0x00000033
+
+/**
+ * @brief VMCALL to disable the profiler (VMX-preemption timer)
+ *
+ */
+#define VMCALL_DISABLE_PROFILER 0x00000034
+
 //////////////////////////////////////////////////
 //				    Functions					//
 //////////////////////////////////////////////////
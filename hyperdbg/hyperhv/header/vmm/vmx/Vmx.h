@@ -75,6 +75,7 @@
 #define CPU_BASED_CTL2_ENABLE_INVPCID             0x1000
 #define CPU_BASED_CTL2_ENABLE_VMFUNC              0x2000
 #define CPU_BASED_CTL2_ENABLE_XSAVE_XRSTORS       0x100000
+#define CPU_BASED_CTL2_SUB_PAGE_WRITE_PERMISSIONS 0x800000
 
 /**
  * @brief VM-exit Control Bits
@@ -70,6 +70,8 @@
 //
 // The core's state
 //
+#include "components/invept/header/InveptDeferral.h"
+#include "components/profiler/header/SamplesRing.h"
 #include "common/State.h"
 
 //
@@ -77,6 +79,8 @@
 //
 #include "vmm/vmx/Vmx.h"
 #include "vmm/vmx/VmxRegions.h"
+#include "components/spp/header/SppTable.h"
+#include "features/SubPagePermissions.h"
 #include "vmm/ept/Ept.h"
 #include "SDK/imports/kernel/HyperDbgVmmImports.h"
 
@@ -90,6 +94,7 @@
 #include "common/Dpc.h"
 #include "vmm/vmx/HypervTlfs.h"
 #include "common/Msr.h"
+#include "components/pool/header/PoolWatermark.h"
 #include "memory/PoolManager.h"
 #include "common/Trace.h"
 #include "assembly/InlineAsm.h"
@@ -110,6 +115,8 @@
 #include "vmm/vmx/Counters.h"
 #include "vmm/vmx/IdtEmulation.h"
 #include "vmm/ept/Invept.h"
+#include "components/ept-view/header/EptViewTable.h"
+#include "vmm/ept/EptView.h"
 #include "vmm/vmx/Vmcall.h"
 #include "interface/DirectVmcall.h"
 #include "vmm/vmx/Hv.h"
@@ -119,8 +126,17 @@
 #include "vmm/vmx/VmxMechanisms.h"
 #include "hooks/Hooks.h"
 #include "hooks/ModeBasedExecHook.h"
+#include "components/emulation/header/MonitorEmulation.h"
+#include "hooks/MonitorEmulationHandler.h"
+#include "components/relocation/header/InstructionRelocation.h"
+#include "hooks/DisplacedExecution.h"
+#include "components/monitor-range/header/MonitorRangeTable.h"
+#include "hooks/MonitorRange.h"
 #include "interface/Callback.h"
+#include "components/branch-trace/header/LbrStack.h"
+#include "features/BranchTrace.h"
 #include "features/DirtyLogging.h"
+#include "features/Profiler.h"
 #include "features/CompatibilityChecks.h"
 #include "mmio/MmioShadowing.h"
 
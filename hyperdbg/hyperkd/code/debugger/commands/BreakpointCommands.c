@@ -241,6 +241,14 @@ BreakpointCheckAndHandleDebugBreakpoint(UINT32 CoreId)
     PROCESSOR_DEBUGGING_STATE * DbgState                  = &g_DbgState[CoreId];
     BOOLEAN                     HandledByDebuggerRoutines = TRUE;
 
+    //
+    // Check whether it's a context switch while tracing the branches
+    //
+    if (BranchTracingCheckAndHandleDebugBreakpoint(DbgState))
+    {
+        return TRUE;
+    }
+
     //
     // *** Check whether anything should be changed with trap-flags
     // and also it indicates whether the debugger itself set this trap
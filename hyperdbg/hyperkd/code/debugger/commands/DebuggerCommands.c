@@ -678,6 +678,10 @@ DebuggerCommandEditMemoryVmxRoot(PDEBUGGER_EDIT_MEMORY EditMemRequest)
  * @param IsDebuggeePaused Set to true when the search is performed in
  * the debugger mode
  * @param CountOfMatchedCases Number of matched cases
+ * @param Cursor if not NULL, the search stops (at a page boundary) once
+ * the slice of the cursor is expired
+ * @param NextAddress The address that the search should be continued from,
+ * it's the end address if the search is finished
  * @return BOOLEAN Whether the search was successful or not
  */
 BOOLEAN
@@ -686,7 +690,9 @@ PerformSearchAddress(UINT64 *                AddressToSaveResults,
                      UINT64                  StartAddress,
                      UINT64                  EndAddress,
                      BOOLEAN                 IsDebuggeePaused,
-                     PUINT32                 CountOfMatchedCases)
+                     PUINT32                 CountOfMatchedCases,
+                     PKD_CURSOR              Cursor,
+                     PUINT64                 NextAddress)
 {
     UINT32   CountOfOccurance      = 0;
     UINT64   Cmp64                 = 0;
@@ -698,6 +704,8 @@ PerformSearchAddress(UINT64 *                AddressToSaveResults,
     UINT64   TempValue             = (UINT64)NULL;
     CR3_TYPE CurrentProcessCr3     = {0};
 
+    *NextAddress = EndAddress;
+
     //
     // set chunk size in each modification
     //
@@ -758,6 +766,19 @@ PerformSearchAddress(UINT64 *                AddressToSaveResults,
 
         for (size_t BaseIterator = (size_t)StartAddress; BaseIterator < ((UINT64)EndAddress); BaseIterator += LengthOfEachChunk)
         {
+            //
+            // Check whether the slice is expired at the first chunk of each
+            // page (at least one page is searched in each slice)
+            //
+            if (Cursor != NULL &&
+                BaseIterator != (size_t)StartAddress &&
+                (BaseIterator & (PAGE_SIZE - 1)) < LengthOfEachChunk &&
+                KdCursorIsSliceExpired(Cursor))
+            {
+                *NextAddress = BaseIterator;
+                break;
+            }
+
             //
             // *** Search the memory ***
             //
@@ -899,10 +920,10 @@ PerformSearchAddress(UINT64 *                AddressToSaveResults,
                     else
                     {
                         //
-                        // The result buffer is full!
+                        // The result buffer is full! (the previous memory
+                        // layout is restored below)
                         //
-                        *CountOfMatchedCases = CountOfOccurance;
-                        return TRUE;
+                        break;
                     }
                 }
             }
@@ -964,6 +985,11 @@ PerformSearchAddress(UINT64 *                AddressToSaveResults,
  * @param IsDebuggeePaused Set to true when the search is performed in
  * the debugger mode
  * @param CountOfMatchedCases Number of matched cases
+ * @param Cursor if not NULL, the search stops once the slice of the
+ * cursor is expired
+ * @param NextAddress The address (of the same type as the start address)
+ * that the search should be continued from, it's the end address if the
+ * search is finished
  * @return BOOLEAN Whether there was any error or not
  */
 BOOLEAN
@@ -972,13 +998,16 @@ SearchAddressWrapper(PUINT64                 AddressToSaveResults,
                      UINT64                  StartAddress,
                      UINT64                  EndAddress,
                      BOOLEAN                 IsDebuggeePaused,
-                     PUINT32                 CountOfMatchedCases)
+                     PUINT32                 CountOfMatchedCases,
+                     PKD_CURSOR              Cursor,
+                     PUINT64                 NextAddress)
 {
     CR3_TYPE CurrentProcessCr3;
     UINT64   BaseAddress         = 0;
     UINT64   RealPhysicalAddress = 0;
     UINT64   TempValue           = (UINT64)NULL;
     UINT64   TempStartAddress    = (UINT64)NULL;
+    UINT64   RealEndAddress      = EndAddress;
     BOOLEAN  DoesBaseAddrSaved   = FALSE;
     BOOLEAN  SearchResult        = FALSE;
 
@@ -986,6 +1015,7 @@ SearchAddressWrapper(PUINT64                 AddressToSaveResults,
     // Reset the count of matched cases
     //
     *CountOfMatchedCases = 0;
+    *NextAddress         = EndAddress;
 
     if (SearchMemRequest->MemoryType == SEARCH_VIRTUAL_MEMORY)
     {
@@ -1067,7 +1097,9 @@ SearchAddressWrapper(PUINT64                 AddressToSaveResults,
                                                 BaseAddress,
                                                 EndAddress,
                                                 IsDebuggeePaused,
-                                                CountOfMatchedCases);
+                                                CountOfMatchedCases,
+                                                Cursor,
+                                                NextAddress);
         }
         else
         {
@@ -1120,7 +1152,15 @@ SearchAddressWrapper(PUINT64                 AddressToSaveResults,
                                             SearchMemRequest->Address,
                                             EndAddress,
                                             IsDebuggeePaused,
-                                            CountOfMatchedCases);
+                                            CountOfMatchedCases,
+                                            Cursor,
+                                            NextAddress);
+
+        //
+        // The next address of the search is a physical address (the
+        // physical range is mapped contiguously)
+        //
+        *NextAddress = *NextAddress == EndAddress ? RealEndAddress : StartAddress + (*NextAddress - SearchMemRequest->Address);
 
         //
         // Restore the previous state
@@ -1148,6 +1188,7 @@ DebuggerCommandSearchMemory(PDEBUGGER_SEARCH_MEMORY SearchMemRequest)
     UINT64  CurrentValue         = 0;
     UINT32  ResultsIndex         = 0;
     UINT32  CountOfResults       = 0;
+    UINT64  NextAddress          = 0;
 
     //
     // Check if process id is valid or not
@@ -1185,7 +1226,7 @@ DebuggerCommandSearchMemory(PDEBUGGER_SEARCH_MEMORY SearchMemRequest)
     //
     // Call the wrapper
     //
-    SearchAddressWrapper(SearchResultsStorage, SearchMemRequest, AddressFrom, AddressTo, FALSE, &CountOfResults);
+    SearchAddressWrapper(SearchResultsStorage, SearchMemRequest, AddressFrom, AddressTo, FALSE, &CountOfResults, NULL, &NextAddress);
 
     //
     // In this point, we to store the results (if any) to the user-mode
@@ -1233,6 +1274,210 @@ DebuggerCommandSearchMemory(PDEBUGGER_SEARCH_MEMORY SearchMemRequest)
     return STATUS_SUCCESS;
 }
 
+/**
+ * @brief Read a part of a page for the multi-pattern search
+ *
+ * @details This function can be called from vmx-root mode
+ * the virtual addresses are read from the memory layout that is
+ * already switched to
+ *
+ * @param SearchRequest request of the multi-pattern search
+ * @param Address the address to read
+ * @param Buffer the buffer to save the memory
+ * @param Size the size to read (not crossing the page)
+ * @param Context a pointer to a BOOLEAN that is set to true when the
+ * search is performed in the debugger mode
+ * @return BOOLEAN whether the memory is readable or not
+ */
+BOOLEAN
+SearchMultiplePatternsReadChunk(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS SearchRequest,
+                                UINT64                             Address,
+                                PVOID                              Buffer,
+                                UINT32                             Size,
+                                PVOID                              Context)
+{
+    BOOLEAN IsDebuggeePaused = *(BOOLEAN *)Context;
+    SIZE_T  ReturnSize       = 0;
+
+    if (SearchRequest->MemoryType == SEARCH_PHYSICAL_MEMORY)
+    {
+        if (IsDebuggeePaused)
+        {
+            if (!CheckAddressPhysical(Address))
+            {
+                return FALSE;
+            }
+
+            return MemoryMapperReadMemorySafeByPhysicalAddress(Address, (UINT64)Buffer, Size);
+        }
+        else
+        {
+            return MemoryManagerReadProcessMemoryNormal((HANDLE)SearchRequest->ProcessId,
+                                                        (PVOID)Address,
+                                                        DEBUGGER_READ_PHYSICAL_ADDRESS,
+                                                        Buffer,
+                                                        Size,
+                                                        &ReturnSize) &&
+                   ReturnSize == Size;
+        }
+    }
+
+    //
+    // It's a virtual address, check whether the page is present or not
+    //
+    if (VirtualAddressToPhysicalAddress((PVOID)Address) == (UINT64)NULL)
+    {
+        return FALSE;
+    }
+
+    if (IsDebuggeePaused)
+    {
+        return MemoryMapperReadMemorySafe(Address, Buffer, Size);
+    }
+    else
+    {
+        RtlCopyMemory(Buffer, (PVOID)Address, Size);
+        return TRUE;
+    }
+}
+
+/**
+ * @brief Search several patterns in several ranges of memory
+ *
+ * @details This function can be called from vmx-root mode
+ * The search continues from where the previous call stopped (the
+ * automaton should be compiled by SearchMultiplePatternsCompile before
+ * the first call)
+ *
+ * @param SearchRequest request of the multi-pattern search
+ * @param Automaton the compiled automaton
+ * @param Results the buffer to save the results (MaximumSearchMultiplePatternsResults)
+ * @param IsDebuggeePaused Set to true when the search is performed in
+ * the debugger mode
+ * @param Cursor if not NULL, the search stops once the slice of the cursor
+ * is expired
+ * @return BOOLEAN TRUE if the search is finished, FALSE if it's stopped because
+ * the results are full or the slice is expired
+ */
+BOOLEAN
+SearchMultiplePatternsResume(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS        SearchRequest,
+                             PSEARCH_MULTIPLE_PATTERNS_AUTOMATON       Automaton,
+                             PDEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT Results,
+                             BOOLEAN                                   IsDebuggeePaused,
+                             PKD_CURSOR                                Cursor)
+{
+    CR3_TYPE CurrentProcessCr3 = {0};
+    BOOLEAN  IsLayoutSwitched  = FALSE;
+    BOOLEAN  IsFinished;
+
+    //
+    // Change the memory layout (cr3) for virtual addresses
+    //
+    if (SearchRequest->MemoryType == SEARCH_VIRTUAL_MEMORY)
+    {
+        if (IsDebuggeePaused)
+        {
+            CurrentProcessCr3 = SwitchToProcessMemoryLayoutByCr3(LayoutGetCurrentProcessCr3());
+            IsLayoutSwitched  = TRUE;
+        }
+        else if (SearchRequest->ProcessId != HANDLE_TO_UINT32(PsGetCurrentProcessId()))
+        {
+            CurrentProcessCr3 = SwitchToProcessMemoryLayout(SearchRequest->ProcessId);
+            IsLayoutSwitched  = TRUE;
+        }
+    }
+
+    IsFinished = SearchMultiplePatternsScanRanges(SearchRequest,
+                                                  Automaton,
+                                                  Results,
+                                                  SearchMultiplePatternsReadChunk,
+                                                  &IsDebuggeePaused,
+                                                  Cursor);
+
+    //
+    // Restore the previous memory layout (cr3)
+    //
+    if (IsLayoutSwitched)
+    {
+        SwitchToPreviousProcess(CurrentProcessCr3);
+    }
+
+    return IsFinished;
+}
+
+/**
+ * @brief Search several patterns in several ranges of memory
+ *
+ * @details This function should not be called from vmx-root mode
+ * the search stops once all of the patterns reached their limit or
+ * the results are full
+ *
+ * @param SearchRequest request of the multi-pattern search
+ * @param Automaton the buffer of the automaton
+ * @param Results the buffer to save the results (MaximumSearchMultiplePatternsResults)
+ * @return BOOLEAN Whether the search was successful or not
+ */
+BOOLEAN
+SearchMultiplePatterns(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS        SearchRequest,
+                       PSEARCH_MULTIPLE_PATTERNS_AUTOMATON       Automaton,
+                       PDEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT Results)
+{
+    SearchRequest->NumberOfResults          = 0;
+    SearchRequest->Cursor.IsFinished        = TRUE;
+    SearchRequest->Cursor.ContinuationToken = (UINT64)NULL;
+
+    if (!SearchMultiplePatternsCompile(SearchRequest, Automaton))
+    {
+        SearchRequest->KernelStatus = DEBUGGER_ERROR_INVALID_SEARCH_PATTERNS;
+        return FALSE;
+    }
+
+    SearchMultiplePatternsResume(SearchRequest, Automaton, Results, FALSE, NULL);
+
+    return TRUE;
+}
+
+/**
+ * @brief Start searching several patterns in memory
+ *
+ * @param SearchRequest Request to search memory, the results are
+ * saved after the request
+ * @return NTSTATUS
+ */
+NTSTATUS
+DebuggerCommandSearchMultiplePatterns(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS SearchRequest)
+{
+    PSEARCH_MULTIPLE_PATTERNS_AUTOMATON Automaton;
+
+    //
+    // Check if process id is valid or not
+    //
+    if (SearchRequest->ProcessId != HANDLE_TO_UINT32(PsGetCurrentProcessId()) && !CommonIsProcessExist(SearchRequest->ProcessId))
+    {
+        SearchRequest->NumberOfResults = 0;
+        SearchRequest->KernelStatus    = DEBUGGER_ERROR_INVALID_PROCESS_ID;
+        return STATUS_SUCCESS;
+    }
+
+    Automaton = PlatformMemAllocateNonPagedPool(sizeof(SEARCH_MULTIPLE_PATTERNS_AUTOMATON));
+
+    if (Automaton == NULL)
+    {
+        //
+        // Not enough memory
+        //
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    SearchMultiplePatterns(SearchRequest,
+                           Automaton,
+                           (PDEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT)((CHAR *)SearchRequest + SIZEOF_DEBUGGER_SEARCH_MULTIPLE_PATTERNS));
+
+    PlatformMemFreePool(Automaton);
+
+    return STATUS_SUCCESS;
+}
+
 /**
  * @brief Perform the flush requests to vmx-root and vmx non-root buffers
  *
@@ -1316,6 +1561,34 @@ DebuggerCommandSendGeneralBufferToDebugger(PDEBUGGEE_SEND_GENERAL_PACKET_FROM_DE
     return STATUS_SUCCESS;
 }
 
+/**
+ * @brief Raise the watermarks of an intention that is replenished in the background
+ * @details otherwise, the reserved buffers are not replenished after they're used
+ *
+ * @param PreallocRequest Request details of needed buffers to be reserved
+ * @param Intention The intention of the buffers
+ * @param Size Size of each buffer
+ *
+ * @return VOID
+ */
+static VOID
+DebuggerCommandRaisePoolWatermarks(PDEBUGGER_PREALLOC_COMMAND PreallocRequest,
+                                   POOL_ALLOCATION_INTENTION  Intention,
+                                   SIZE_T                     Size)
+{
+    PPOOL_MANAGER_INTENTION_STATISTICS Statistics = &PreallocRequest->Statistics[Intention];
+
+    PoolManagerQueryStatistics(PreallocRequest->Statistics, POOL_ALLOCATION_INTENTION_COUNT);
+
+    if (Statistics->HighWatermark != 0)
+    {
+        PoolManagerSetWatermarks(Intention,
+                                 Size,
+                                 Statistics->LowWatermark + PreallocRequest->Count,
+                                 Statistics->HighWatermark + PreallocRequest->Count);
+    }
+}
+
 /**
  * @brief Reserve and allocate pre-allocated buffers
  *
@@ -1424,6 +1697,16 @@ DebuggerCommandReservePreallocatedPools(PDEBUGGER_PREALLOC_COMMAND PreallocReque
 
         break;
 
+    case DEBUGGER_PREALLOC_COMMAND_TYPE_QUERY_STATISTICS:
+
+        //
+        // Only query the usage statistics (used for recommending the sizes)
+        //
+        PoolManagerQueryStatistics(PreallocRequest->Statistics, POOL_ALLOCATION_INTENTION_COUNT);
+
+        PreallocRequest->KernelStatus = DEBUGGER_OPERATION_WAS_SUCCESSFUL;
+        return STATUS_SUCCESS;
+
     default:
 
         PreallocRequest->KernelStatus = DEBUGGER_ERROR_COULD_NOT_FIND_ALLOCATION_TYPE;
@@ -1435,6 +1718,42 @@ DebuggerCommandReservePreallocatedPools(PDEBUGGER_PREALLOC_COMMAND PreallocReque
     //
     PoolManagerCheckAndPerformAllocationAndDeallocation();
 
+    //
+    // The buffers of the instant events are kept in reserve if they're replenished
+    // based on the watermarks (raised after the allocations are performed)
+    //
+    switch (PreallocRequest->Type)
+    {
+    case DEBUGGER_PREALLOC_COMMAND_TYPE_REGULAR_EVENT:
+
+        DebuggerCommandRaisePoolWatermarks(PreallocRequest, INSTANT_REGULAR_EVENT_BUFFER, REGULAR_INSTANT_EVENT_CONDITIONAL_BUFFER);
+        DebuggerCommandRaisePoolWatermarks(PreallocRequest, INSTANT_REGULAR_EVENT_ACTION_BUFFER, REGULAR_INSTANT_EVENT_ACTION_BUFFER);
+
+        break;
+
+    case DEBUGGER_PREALLOC_COMMAND_TYPE_BIG_EVENT:
+
+        DebuggerCommandRaisePoolWatermarks(PreallocRequest, INSTANT_BIG_EVENT_BUFFER, BIG_INSTANT_EVENT_CONDITIONAL_BUFFER);
+        DebuggerCommandRaisePoolWatermarks(PreallocRequest, INSTANT_BIG_EVENT_ACTION_BUFFER, BIG_INSTANT_EVENT_ACTION_BUFFER);
+
+        break;
+
+    case DEBUGGER_PREALLOC_COMMAND_TYPE_REGULAR_SAFE_BUFFER:
+
+        DebuggerCommandRaisePoolWatermarks(PreallocRequest, INSTANT_REGULAR_SAFE_BUFFER_FOR_EVENTS, REGULAR_INSTANT_EVENT_REQUESTED_SAFE_BUFFER);
+
+        break;
+
+    case DEBUGGER_PREALLOC_COMMAND_TYPE_BIG_SAFE_BUFFER:
+
+        DebuggerCommandRaisePoolWatermarks(PreallocRequest, INSTANT_BIG_SAFE_BUFFER_FOR_EVENTS, BIG_INSTANT_EVENT_REQUESTED_SAFE_BUFFER);
+
+        break;
+
+    default:
+        break;
+    }
+
     PreallocRequest->KernelStatus = DEBUGGER_OPERATION_WAS_SUCCESSFUL;
 
     return STATUS_SUCCESS;
@@ -832,3 +832,73 @@ ExtensionCommandPcidevinfo(PDEBUGGEE_PCIDEVINFO_REQUEST_RESPONSE_PACKET Pcidevin
         PcidevinfoPacket->KernelStatus                                 = DEBUGGER_ERROR_INVALID_ADDRESS;
     }
 }
+
+/**
+ * @brief Perform the requests of the profiler
+ * @details should be called in PASSIVE_LEVEL, for reading the samples,
+ * the request should be followed by a buffer that can store at least
+ * MaximumProfilerSamplesPerRequest samples
+ *
+ * @param ProfilerRequest
+ *
+ * @return UINT32 Size to send to the user-mode
+ */
+UINT32
+ExtensionCommandPerformProfilerRequest(PDEBUGGER_PROFILER_REQUEST ProfilerRequest)
+{
+    UINT32 Size = SIZEOF_DEBUGGER_PROFILER_REQUEST;
+
+    SpinlockLock(&ExtensionCommandProfilerLock);
+
+    switch (ProfilerRequest->RequestType)
+    {
+    case DEBUGGER_PROFILER_REQUEST_START:
+
+        //
+        // The sampling period is computed based on the frequency of the
+        // time stamp counter (measured on initialization)
+        //
+        if (g_TscFrequency == (UINT64)NULL)
+        {
+            ProfilerRequest->KernelStatus = DEBUGGER_ERROR_PROFILER_IS_NOT_SUPPORTED;
+            break;
+        }
+
+        if (ProfilerRequest->SamplingFrequency == 0 || ProfilerRequest->SamplingFrequency > MaximumProfilerSamplingFrequency)
+        {
+            ProfilerRequest->KernelStatus = DEBUGGER_ERROR_INVALID_PROFILER_OPTIONS;
+            break;
+        }
+
+        ConfigureProfilerStartOnAllProcessors(ProfilerRequest, g_TscFrequency / ProfilerRequest->SamplingFrequency);
+
+        break;
+
+    case DEBUGGER_PROFILER_REQUEST_STOP:
+
+        ConfigureProfilerStopOnAllProcessors();
+
+        ProfilerRequest->KernelStatus = DEBUGGER_OPERATION_WAS_SUCCESSFUL;
+
+        break;
+
+    case DEBUGGER_PROFILER_REQUEST_READ_SAMPLES:
+
+        if (VmFuncProfilerReadSamples(ProfilerRequest, MaximumProfilerSamplesPerRequest))
+        {
+            Size += ProfilerRequest->NumberOfSamples * sizeof(DEBUGGER_PROFILER_SAMPLE);
+        }
+
+        break;
+
+    default:
+
+        ProfilerRequest->KernelStatus = DEBUGGER_ERROR_INVALID_PROFILER_OPTIONS;
+
+        break;
+    }
+
+    SpinlockUnlock(&ExtensionCommandProfilerLock);
+
+    return Size;
+}
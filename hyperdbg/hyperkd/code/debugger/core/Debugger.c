@@ -148,6 +148,56 @@ DebuggerInitialize()
     //
     RtlZeroMemory(g_ScriptGlobalVariables, MAX_VAR_COUNT * sizeof(UINT64));
 
+    //
+    // Initialize the holder of the result of batch operations
+    //
+    if (!g_KdBatchResponseBuffer)
+    {
+        g_KdBatchResponseBuffer = PlatformMemAllocateNonPagedPool(MaxBatchPacketSize);
+    }
+
+    if (!g_KdBatchResponseBuffer)
+    {
+        //
+        // Out of resource
+        //
+        return FALSE;
+    }
+
+    //
+    // Initialize the automaton and the holder of the result of the
+    // multi-pattern search
+    //
+    if (!g_KdSearchAutomaton)
+    {
+        g_KdSearchAutomaton = PlatformMemAllocateNonPagedPool(sizeof(SEARCH_MULTIPLE_PATTERNS_AUTOMATON));
+    }
+
+    if (!g_KdSearchResponseBuffer)
+    {
+        g_KdSearchResponseBuffer = PlatformMemAllocateNonPagedPool(SIZEOF_DEBUGGER_SEARCH_MULTIPLE_PATTERNS +
+                                                                   MaximumSearchMultiplePatternsResults * sizeof(DEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT));
+    }
+
+    if (!g_KdSearchAutomaton || !g_KdSearchResponseBuffer)
+    {
+        //
+        // Out of resource
+        //
+        return FALSE;
+    }
+
+    //
+    // Initialize the buffers of the branch tracing
+    //
+    if (!BranchTracingInitialize())
+    {
+        //
+        // Out of resource
+        //
+        return FALSE;
+    }
+
     //
     // Zero the TRAP FLAG state memory
     //
@@ -179,6 +229,14 @@ DebuggerInitialize()
         RtlZeroMemory(CurrentDebuggerState->ScriptEngineCoreSpecificStackBuffer, MAX_STACK_BUFFER_COUNT * sizeof(UINT64));
     }
 
+    //
+    // Initialize the sampling and rate limiting of the events
+    //
+    if (!EventThrottleInitialize())
+    {
+        return FALSE;
+    }
+
     //
     // Initialize NMI broadcasting mechanism
     //
@@ -264,6 +322,16 @@ DebuggerUninitialize()
     //
     UdUninitializeUserDebugger();
 
+    //
+    // Stop re-arming the throttled events
+    //
+    EventThrottleUninitialize();
+
+    //
+    // Stop the profiler and free its samples
+    //
+    ConfigureProfilerUninitializeOnAllProcessors();
+
     //
     // Uninitialize NMI broadcasting mechanism
     //
@@ -283,6 +351,35 @@ DebuggerUninitialize()
         g_ScriptGlobalVariables = NULL;
     }
 
+    //
+    // Free g_KdBatchResponseBuffer
+    //
+    if (g_KdBatchResponseBuffer != NULL)
+    {
+        PlatformMemFreePool(g_KdBatchResponseBuffer);
+        g_KdBatchResponseBuffer = NULL;
+    }
+
+    //
+    // Free the buffers of the multi-pattern search
+    //
+    if (g_KdSearchAutomaton != NULL)
+    {
+        PlatformMemFreePool(g_KdSearchAutomaton);
+        g_KdSearchAutomaton = NULL;
+    }
+
+    if (g_KdSearchResponseBuffer != NULL)
+    {
+        PlatformMemFreePool(g_KdSearchResponseBuffer);
+        g_KdSearchResponseBuffer = NULL;
+    }
+
+    //
+    // Free the buffers of the branch tracing
+    //
+    BranchTracingUninitialize();
+
     //
     // Free core specific local and temp variables
     //
@@ -1086,6 +1183,21 @@ DebuggerTriggerEvents(VMM_EVENT_TYPE_ENUM                   EventType,
     //
     DbgState->Regs = Regs;
 
+    //
+    // Pseudo-registers that are resolved by the previous events are no
+    // longer valid
+    //
+    DbgState->PseudoRegistersMemo.ValidMask = 0;
+
+    //
+    // The 'all' stage events that are suppressed by the throttling options
+    // are only kept from the pre-event until the post-event of the same hit
+    //
+    if (CallingStage == VMM_CALLBACK_CALLING_STAGE_PRE_EVENT_EMULATION)
+    {
+        DbgState->EventThrottle.NumberOfSuppressedPreEvents = 0;
+    }
+
     //
     // Find the debugger events list base on the type of the event
     //
@@ -1413,6 +1525,15 @@ DebuggerTriggerEvents(VMM_EVENT_TYPE_ENUM                   EventType,
             }
         }
 
+        //
+        // Check the sampling and rate limiting options before running the
+        // conditions and the actions
+        //
+        if (CurrentEvent->Throttle.IsThrottled && EventThrottleIsHitSuppressed(DbgState, CurrentEvent, CallingStage, Context))
+        {
+            continue;
+        }
+
         //
         // Check if condition is met or not , if the condition
         // is not met then we have to avoid performing the actions
@@ -1616,6 +1737,12 @@ DebuggerPerformRunScript(PROCESSOR_DEBUGGING_STATE *        DbgState,
         CodeBuffer.Head    = (SYMBOL *)((CHAR *)ScriptDetails + sizeof(DEBUGGEE_SCRIPT_PACKET));
         CodeBuffer.Size    = ScriptDetails->ScriptBufferSize;
         CodeBuffer.Pointer = ScriptDetails->ScriptBufferPointer;
+
+        //
+        // The core might be halted by something other than an event, so the
+        // memoized pseudo-registers might belong to an older event
+        //
+        DbgState->PseudoRegistersMemo.ValidMask = 0;
     }
     else
     {
@@ -2647,6 +2774,16 @@ DebuggerValidateEvent(PDEBUGGER_GENERAL_EVENT_DETAIL    EventDetails,
         return FALSE;
     }
 
+    //
+    // Check whether the sampling and rate limiting options are valid
+    //
+    if (!EventThrottleValidateOptions(EventDetails))
+    {
+        ResultsToReturn->IsSuccessful = FALSE;
+        ResultsToReturn->Error        = DEBUGGER_ERROR_INVALID_EVENT_THROTTLING_OPTIONS;
+        return FALSE;
+    }
+
     //
     // Check whether the core Id is valid or not, we read cores count
     // here because we use it in later parts
@@ -3107,6 +3244,12 @@ DebuggerParseEvent(PDEBUGGER_GENERAL_EVENT_DETAIL    EventDetails,
         return FALSE;
     }
 
+    //
+    // Set the sampling and rate limiting options before the event is
+    // registered (the event is not zeroed if it's from the pre-allocated pools)
+    //
+    EventThrottleSetOptions(Event, &EventDetails->Throttle);
+
     //
     // Register the event
     //
@@ -3670,6 +3813,13 @@ DebuggerParseEventsModification(PDEBUGGER_MODIFY_EVENTS DebuggerEventModificatio
             DebuggerClearEvent(DebuggerEventModificationRequest->Tag, InputFromVmxRoot, PoolManagerAllocatedMemory);
         }
     }
+    else if (DebuggerEventModificationRequest->TypeOfAction == DEBUGGER_MODIFY_EVENTS_QUERY_SUPPRESSED_HITS)
+    {
+        //
+        // Query the hits that are suppressed by the throttling options
+        //
+        return EventThrottleQuerySuppressedHits(DebuggerEventModificationRequest);
+    }
     else if (DebuggerEventModificationRequest->TypeOfAction == DEBUGGER_MODIFY_EVENTS_QUERY_STATE)
     {
         //
@@ -300,6 +300,15 @@ HaltedCorePerformTargetTask(PROCESSOR_DEBUGGING_STATE * DbgState,
 
         break;
     }
+    case DEBUGGER_HALTED_CORE_TASK_SET_BRANCH_TRACING:
+    {
+        //
+        // Enable or disable tracing the branches (context switch detection and LBR)
+        //
+        BranchTracingEnableOrDisableOnCore(DbgState, PVOID_TO_BOOLEAN(Context));
+
+        break;
+    }
     default:
         LogWarning("Warning, unknown broadcast on halted core received");
         break;
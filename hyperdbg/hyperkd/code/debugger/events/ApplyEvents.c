@@ -12,6 +12,64 @@
  */
 #include "pch.h"
 
+/**
+ * @brief Get the end of the physically contiguous part of a monitored range
+ * @details the physically contiguous pages are monitored by a single range
+ * descriptor, the physical ranges are always contiguous
+ *
+ * @param StartAddress The start of the range
+ * @param EndAddress The end of the range (inclusive)
+ * @param MemoryType Whether the range is physical or virtual
+ * @param ProcessId The process id to translate based on that process's cr3
+ * @param InputFromVmxRoot Whether the input comes from VMX root-mode or IOCTL
+ *
+ * @return UINT64 The last address of the contiguous part
+ */
+static UINT64
+ApplyEventGetEndOfContiguousRange(UINT64                    StartAddress,
+                                  UINT64                    EndAddress,
+                                  DEBUGGER_HOOK_MEMORY_TYPE MemoryType,
+                                  UINT32                    ProcessId,
+                                  BOOLEAN                   InputFromVmxRoot)
+{
+    UINT64 PhysicalAddress;
+    UINT64 ExpectedPhysicalAddress;
+    UINT64 Page;
+
+    if (MemoryType == DEBUGGER_MEMORY_HOOK_PHYSICAL_ADDRESS)
+    {
+        return EndAddress;
+    }
+
+    Page = (UINT64)PAGE_ALIGN(StartAddress);
+
+    ExpectedPhysicalAddress = InputFromVmxRoot ? VirtualAddressToPhysicalAddressOnTargetProcess((PVOID)Page)
+                                               : VirtualAddressToPhysicalAddressByProcessId((PVOID)Page, ProcessId);
+
+    if (ExpectedPhysicalAddress == NULL64_ZERO)
+    {
+        //
+        // The page is not mapped, it's passed alone (and fails)
+        //
+        return EndAddress < Page + PAGE_SIZE - 1 ? EndAddress : Page + PAGE_SIZE - 1;
+    }
+
+    for (Page = Page + PAGE_SIZE; Page <= (UINT64)PAGE_ALIGN(EndAddress); Page += PAGE_SIZE)
+    {
+        ExpectedPhysicalAddress += PAGE_SIZE;
+
+        PhysicalAddress = InputFromVmxRoot ? VirtualAddressToPhysicalAddressOnTargetProcess((PVOID)Page)
+                                           : VirtualAddressToPhysicalAddressByProcessId((PVOID)Page, ProcessId);
+
+        if (PhysicalAddress != ExpectedPhysicalAddress)
+        {
+            return Page - 1;
+        }
+    }
+
+    return EndAddress;
+}
+
 /**
  * @brief Applying monitor memory hook events
  *
@@ -29,12 +87,9 @@ ApplyEventMonitorEvent(PDEBUGGER_EVENT                   Event,
 {
     UINT32                                       TempProcessId;
     BOOLEAN                                      ResultOfApplyingEvent = FALSE;
-    UINT64                                       RemainingSize;
-    UINT64                                       PagesBytes;
     UINT64                                       ConstEndAddress;
     UINT64                                       TempStartAddress;
     UINT64                                       TempEndAddress;
-    UINT64                                       TempNextPageAddr;
     EPT_HOOKS_ADDRESS_DETAILS_FOR_MEMORY_MONITOR HookingAddresses = {0};
 
     if (InputFromVmxRoot)
@@ -122,52 +177,33 @@ ApplyEventMonitorEvent(PDEBUGGER_EVENT                   Event,
     //
     HookingAddresses.Tag = Event->Tag;
 
-    TempStartAddress = Event->InitOptions.OptionalParam1;
-    TempEndAddress   = Event->InitOptions.OptionalParam2;
-    ConstEndAddress  = TempEndAddress;
-
-    PagesBytes = (UINT64)PAGE_ALIGN(TempStartAddress);
-    PagesBytes = TempEndAddress - PagesBytes;
-    PagesBytes = PagesBytes / PAGE_SIZE;
-
-    RemainingSize = TempEndAddress - TempStartAddress;
+    if ((DEBUGGER_HOOK_MEMORY_TYPE)Event->InitOptions.OptionalParam3 == DEBUGGER_MEMORY_HOOK_PHYSICAL_ADDRESS)
+    {
+        HookingAddresses.MemoryType = DEBUGGER_MEMORY_HOOK_PHYSICAL_ADDRESS;
+    }
+    else
+    {
+        HookingAddresses.MemoryType = DEBUGGER_MEMORY_HOOK_VIRTUAL_ADDRESS;
+    }
 
-    // LogInfo("Start address: %llx, end address: %llx", TempStartAddress, TempEndAddress, RemainingSize);
+    TempStartAddress = Event->InitOptions.OptionalParam1;
+    ConstEndAddress  = Event->InitOptions.OptionalParam2;
 
-    for (size_t i = 0; i <= PagesBytes; i++)
+    //
+    // Each physically contiguous part of the range is monitored by a single
+    // hook (the parts that are larger than a page are kept as range descriptors)
+    //
+    while (TempStartAddress <= ConstEndAddress)
     {
-        if (RemainingSize >= PAGE_SIZE)
-        {
-            TempEndAddress = (TempStartAddress + ((UINT64)PAGE_ALIGN(TempStartAddress + PAGE_SIZE) - TempStartAddress)) - 1;
-            RemainingSize  = ConstEndAddress - TempEndAddress - 1;
-        }
-        else
-        {
-            TempNextPageAddr = (UINT64)PAGE_ALIGN(TempStartAddress + RemainingSize);
-
-            //
-            // Check if by adding the remaining size, we'll go to the next
-            // page boundary or not
-            //
-            if (TempNextPageAddr > ((UINT64)PAGE_ALIGN(TempStartAddress)))
-            {
-                //
-                // It goes to the next page boundary
-                //
-                TempEndAddress = TempNextPageAddr - 1;
-                RemainingSize  = RemainingSize - (TempEndAddress - TempStartAddress) - 1;
-            }
-            else
-            {
-                TempEndAddress = TempStartAddress + RemainingSize;
-                RemainingSize  = 0;
-            }
-        }
+        TempEndAddress = ApplyEventGetEndOfContiguousRange(TempStartAddress,
+                                                           ConstEndAddress,
+                                                           HookingAddresses.MemoryType,
+                                                           TempProcessId,
+                                                           InputFromVmxRoot);
 
-        // LogInfo("Start address: %llx, end address: %llx, remaining size: %llx",
+        // LogInfo("Start address: %llx, end address: %llx",
         //         TempStartAddress,
-        //         TempEndAddress,
-        //         RemainingSize);
+        //         TempEndAddress);
 
         //
         // Setup hooking addresses
@@ -175,15 +211,6 @@ ApplyEventMonitorEvent(PDEBUGGER_EVENT                   Event,
         HookingAddresses.StartAddress = TempStartAddress;
         HookingAddresses.EndAddress   = TempEndAddress;
 
-        if ((DEBUGGER_HOOK_MEMORY_TYPE)Event->InitOptions.OptionalParam3 == DEBUGGER_MEMORY_HOOK_PHYSICAL_ADDRESS)
-        {
-            HookingAddresses.MemoryType = DEBUGGER_MEMORY_HOOK_PHYSICAL_ADDRESS;
-        }
-        else
-        {
-            HookingAddresses.MemoryType = DEBUGGER_MEMORY_HOOK_VIRTUAL_ADDRESS;
-        }
-
         //
         // Apply the hook
         //
@@ -236,6 +263,14 @@ ApplyEventMonitorEvent(PDEBUGGER_EVENT                   Event,
             }
         }
 
+        //
+        // The range is finished (also avoid overflowing the end of the address space)
+        //
+        if (TempEndAddress >= ConstEndAddress)
+        {
+            break;
+        }
+
         //
         // Swap the temporary start address and temporary end address
         //
@@ -115,6 +115,14 @@ DebuggerCheckProcessOrThreadChange(_In_ UINT32 CoreId)
 {
     PROCESSOR_DEBUGGING_STATE * DbgState = &g_DbgState[CoreId];
 
+    //
+    // Check whether the branches of the traced thread should be drained
+    //
+    if (DbgState->ThreadOrProcessTracingDetails.InterceptClockInterruptsForBranchTracing)
+    {
+        BranchTracingHandleClockInterrupt(DbgState);
+    }
+
     //
     // Check whether intercepting this process or thread is active or not
     //
@@ -0,0 +1,584 @@
+/**
+ * @file EventThrottle.c
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Sampling and rate limiting of the events
+ * @details Hot events (e.g., !syscall, !msrread, !ioin, !cpuid, !monitor)
+ * might be triggered hundreds of thousands of times per second, the
+ * throttling options are evaluated before the conditions and actions of
+ * the event, so the suppressed hits cost a few instructions
+ * @version 0.11
+ * @date 2024-10-31
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Measure the frequency of the time stamp counter
+ * @details should be called in PASSIVE_LEVEL
+ *
+ * @return UINT64 ticks of the time stamp counter in each second or
+ * zero if it cannot be measured
+ */
+UINT64
+EventThrottleCalibrateTsc()
+{
+    LARGE_INTEGER Frequency;
+    LARGE_INTEGER Start;
+    LARGE_INTEGER End;
+    UINT64        TscStart;
+    UINT64        TscEnd;
+    KIRQL         OldIrql;
+
+    //
+    // Avoid being preempted or moved to another core in the middle of
+    // the measurement
+    //
+    KeRaiseIrql(DISPATCH_LEVEL, &OldIrql);
+
+    Start    = KeQueryPerformanceCounter(&Frequency);
+    TscStart = __rdtsc();
+
+    KeStallExecutionProcessor(EVENT_THROTTLE_TSC_CALIBRATION_DURATION);
+
+    End    = KeQueryPerformanceCounter(NULL);
+    TscEnd = __rdtsc();
+
+    KeLowerIrql(OldIrql);
+
+    if (End.QuadPart <= Start.QuadPart || TscEnd <= TscStart)
+    {
+        return (UINT64)NULL;
+    }
+
+    return ((TscEnd - TscStart) * (UINT64)Frequency.QuadPart) / (UINT64)(End.QuadPart - Start.QuadPart);
+}
+
+/**
+ * @brief Check whether another event needs the exiting bit of the target
+ * @details should be called in vmx-root mode
+ *
+ * @param Event The event that is going to disarm the exiting bit
+ * @param CoreId The core that its bitmap is going to be changed
+ * @param Target The MSR or the I/O port
+ *
+ * @return BOOLEAN TRUE if the exiting bit should be kept
+ */
+BOOLEAN
+EventThrottleIsExitingShared(PDEBUGGER_EVENT Event, UINT32 CoreId, UINT32 Target)
+{
+    PLIST_ENTRY TempList;
+    PLIST_ENTRY ListHeads[2] = {0};
+    UINT64      AllTargets;
+
+    if (Event->EventType == RDMSR_INSTRUCTION_EXECUTION)
+    {
+        ListHeads[0] = &g_Events->RdmsrInstructionExecutionEventsHead;
+        AllTargets   = DEBUGGER_EVENT_MSR_READ_OR_WRITE_ALL_MSRS;
+    }
+    else if (Event->EventType == WRMSR_INSTRUCTION_EXECUTION)
+    {
+        ListHeads[0] = &g_Events->WrmsrInstructionExecutionEventsHead;
+        AllTargets   = DEBUGGER_EVENT_MSR_READ_OR_WRITE_ALL_MSRS;
+    }
+    else
+    {
+        //
+        // IN and OUT instructions share the same I/O bitmap
+        //
+        ListHeads[0] = &g_Events->InInstructionExecutionEventsHead;
+        ListHeads[1] = &g_Events->OutInstructionExecutionEventsHead;
+        AllTargets   = DEBUGGER_EVENT_ALL_IO_PORTS;
+    }
+
+    for (UINT32 i = 0; i < RTL_NUMBER_OF(ListHeads) && ListHeads[i] != NULL; i++)
+    {
+        TempList = ListHeads[i];
+
+        while (ListHeads[i] != TempList->Flink)
+        {
+            TempList                     = TempList->Flink;
+            PDEBUGGER_EVENT CurrentEvent = CONTAINING_RECORD(TempList, DEBUGGER_EVENT, EventsOfSameTypeList);
+
+            if (CurrentEvent == Event || !CurrentEvent->Enabled)
+            {
+                continue;
+            }
+
+            if (CurrentEvent->CoreId != DEBUGGER_EVENT_APPLY_TO_ALL_CORES && CurrentEvent->CoreId != CoreId)
+            {
+                continue;
+            }
+
+            if (CurrentEvent->Options.OptionalParam1 == AllTargets || CurrentEvent->Options.OptionalParam1 == Target)
+            {
+                return TRUE;
+            }
+        }
+    }
+
+    return FALSE;
+}
+
+/**
+ * @brief Clear the exiting bit of the event on the current core until
+ * the rate budget is refilled
+ * @details should be called in vmx-root mode, the bit is re-armed by
+ * the re-arming worker
+ *
+ * @param DbgState The state of the debugger on the current core
+ * @param Event The throttled event
+ * @param Target The MSR or the I/O port that caused the hit
+ * @param RearmTime The time stamp counter that the next hit conforms to the rate
+ *
+ * @return VOID
+ */
+VOID
+EventThrottleDisarmExiting(PROCESSOR_DEBUGGING_STATE * DbgState, PDEBUGGER_EVENT Event, UINT32 Target, UINT64 RearmTime)
+{
+    PROCESSOR_EVENT_THROTTLE_STATE * State = &DbgState->EventThrottle;
+    BOOLEAN                          Result;
+
+    if (EventThrottleIsExitingShared(Event, DbgState->CoreId, Target))
+    {
+        return;
+    }
+
+    //
+    // The worker might hold the lock while this core exits, so we don't
+    // wait for it here (the hit is suppressed anyway)
+    //
+    if (!SpinlockTryLock(&State->DisarmedExitingsLock))
+    {
+        return;
+    }
+
+    if (State->NumberOfDisarmedExitings == EVENT_THROTTLE_MAXIMUM_DISARMED_EXITINGS)
+    {
+        SpinlockUnlock(&State->DisarmedExitingsLock);
+        return;
+    }
+
+    switch (Event->EventType)
+    {
+    case RDMSR_INSTRUCTION_EXECUTION:
+        Result = VmFuncUnsetMsrBitmap(DbgState->CoreId, Target, TRUE, FALSE);
+        break;
+
+    case WRMSR_INSTRUCTION_EXECUTION:
+        Result = VmFuncUnsetMsrBitmap(DbgState->CoreId, Target, FALSE, TRUE);
+        break;
+
+    default:
+        Result = VmFuncUnsetIoBitmap(DbgState->CoreId, Target);
+        break;
+    }
+
+    if (Result)
+    {
+        State->DisarmedExitings[State->NumberOfDisarmedExitings].EventTag  = Event->Tag;
+        State->DisarmedExitings[State->NumberOfDisarmedExitings].EventType = Event->EventType;
+        State->DisarmedExitings[State->NumberOfDisarmedExitings].Target    = Target;
+        State->DisarmedExitings[State->NumberOfDisarmedExitings].RearmTime = RearmTime;
+
+        State->NumberOfDisarmedExitings++;
+
+        g_EventThrottleIsRearmRequested = TRUE;
+    }
+
+    SpinlockUnlock(&State->DisarmedExitingsLock);
+}
+
+/**
+ * @brief Re-arm the exiting bits that their rate budget is refilled
+ * @details should be called in PASSIVE_LEVEL
+ *
+ * @return VOID
+ */
+VOID
+EventThrottleRearmExitings()
+{
+    ULONG                           ProcessorsCount = KeQueryActiveProcessorCount(0);
+    EVENT_THROTTLE_DISARMED_EXITING DueExitings[EVENT_THROTTLE_MAXIMUM_DISARMED_EXITINGS];
+    UINT32                          NumberOfDueExitings;
+    UINT64                          Now;
+
+    for (UINT32 i = 0; i < ProcessorsCount; i++)
+    {
+        PROCESSOR_EVENT_THROTTLE_STATE * State = &g_DbgState[i].EventThrottle;
+
+        if (State->NumberOfDisarmedExitings == 0)
+        {
+            continue;
+        }
+
+        NumberOfDueExitings = 0;
+        Now                 = __rdtsc();
+
+        SpinlockLock(&State->DisarmedExitingsLock);
+
+        for (UINT32 j = 0; j < State->NumberOfDisarmedExitings;)
+        {
+            if (State->DisarmedExitings[j].RearmTime > Now)
+            {
+                j++;
+                continue;
+            }
+
+            DueExitings[NumberOfDueExitings++] = State->DisarmedExitings[j];
+
+            //
+            // Move the last entry to this slot
+            //
+            State->NumberOfDisarmedExitings--;
+            State->DisarmedExitings[j] = State->DisarmedExitings[State->NumberOfDisarmedExitings];
+        }
+
+        if (State->NumberOfDisarmedExitings != 0)
+        {
+            //
+            // Check the remaining entries again in the next interval
+            //
+            g_EventThrottleIsRearmRequested = TRUE;
+        }
+
+        SpinlockUnlock(&State->DisarmedExitingsLock);
+
+        for (UINT32 j = 0; j < NumberOfDueExitings; j++)
+        {
+            //
+            // If the event is cleared in the meantime, its termination already
+            // restored the bitmaps
+            //
+            if (!DebuggerIsTagValid(DueExitings[j].EventTag))
+            {
+                continue;
+            }
+
+            switch (DueExitings[j].EventType)
+            {
+            case RDMSR_INSTRUCTION_EXECUTION:
+                ConfigureChangeMsrBitmapReadOnSingleCore(i, DueExitings[j].Target);
+                break;
+
+            case WRMSR_INSTRUCTION_EXECUTION:
+                ConfigureChangeMsrBitmapWriteOnSingleCore(i, DueExitings[j].Target);
+                break;
+
+            default:
+                ConfigureChangeIoBitmapOnSingleCore(i, DueExitings[j].Target);
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * @brief The worker that re-arms the disarmed exiting bits from PASSIVE_LEVEL
+ * @details vmx-root cannot set a timer, so the worker checks the flag that
+ * is set by the disarming cores every EVENT_THROTTLE_REARM_INTERVAL
+ *
+ * @param Context
+ *
+ * @return VOID
+ */
+VOID
+EventThrottleRearmWorker(PVOID Context)
+{
+    LARGE_INTEGER Interval;
+
+    UNREFERENCED_PARAMETER(Context);
+
+    //
+    // Relative time in 100-nanosecond units
+    //
+    Interval.QuadPart = -10000LL * EVENT_THROTTLE_REARM_INTERVAL;
+
+    while (!g_EventThrottleWorkerStopRequested)
+    {
+        KeDelayExecutionThread(KernelMode, FALSE, &Interval);
+
+        if (g_EventThrottleIsRearmRequested)
+        {
+            g_EventThrottleIsRearmRequested = FALSE;
+
+            EventThrottleRearmExitings();
+        }
+    }
+
+    PsTerminateSystemThread(STATUS_SUCCESS);
+}
+
+// ----------------------------------------------------------------------------
+// Public Interfaces
+//
+
+/**
+ * @brief Initialize the throttling of the events
+ * @details should be called in PASSIVE_LEVEL after the debugging state
+ * of the cores is allocated
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+EventThrottleInitialize()
+{
+    ULONG  ProcessorsCount = KeQueryActiveProcessorCount(0);
+    HANDLE WorkerHandle;
+    UINT64 Seed = __rdtsc();
+
+    g_TscFrequency = EventThrottleCalibrateTsc();
+
+    if (g_TscFrequency == (UINT64)NULL)
+    {
+        LogWarning("Warning, unable to measure the frequency of the time stamp counter, rate limiting of the events is not available");
+    }
+
+    for (UINT32 i = 0; i < ProcessorsCount; i++)
+    {
+        RtlZeroMemory(&g_DbgState[i].EventThrottle, sizeof(PROCESSOR_EVENT_THROTTLE_STATE));
+
+        //
+        // The seed should not be zero for xorshift
+        //
+        g_DbgState[i].EventThrottle.RandomState = (Seed ^ ((i + 1) * 0x9E3779B97F4A7C15ULL)) | 1;
+    }
+
+    g_EventThrottleIsRearmRequested    = FALSE;
+    g_EventThrottleWorkerStopRequested = FALSE;
+    g_EventThrottleWorkerThread        = NULL;
+
+    //
+    // The disarming mode is not available without the worker, but the
+    // sampling and rate limiting still work
+    //
+    if (NT_SUCCESS(PsCreateSystemThread(&WorkerHandle, THREAD_ALL_ACCESS, NULL, NULL, NULL, EventThrottleRearmWorker, NULL)))
+    {
+        ObReferenceObjectByHandle(WorkerHandle, THREAD_ALL_ACCESS, *PsThreadType, KernelMode, &g_EventThrottleWorkerThread, NULL);
+        ZwClose(WorkerHandle);
+    }
+    else
+    {
+        LogWarning("Warning, unable to create the worker of re-arming the throttled events");
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Uninitialize the throttling of the events
+ * @details should be called in PASSIVE_LEVEL before the debugging state
+ * of the cores is freed
+ *
+ * @return VOID
+ */
+VOID
+EventThrottleUninitialize()
+{
+    if (g_EventThrottleWorkerThread != NULL)
+    {
+        g_EventThrottleWorkerStopRequested = TRUE;
+
+        KeWaitForSingleObject(g_EventThrottleWorkerThread, Executive, KernelMode, FALSE, NULL);
+        ObDereferenceObject(g_EventThrottleWorkerThread);
+
+        g_EventThrottleWorkerThread = NULL;
+    }
+}
+
+/**
+ * @brief Validate the sampling and rate limiting options of an event
+ *
+ * @param EventDetails The details of the event
+ *
+ * @return BOOLEAN TRUE if the options are valid
+ */
+BOOLEAN
+EventThrottleValidateOptions(PDEBUGGER_GENERAL_EVENT_DETAIL EventDetails)
+{
+    DEBUGGER_EVENT_THROTTLE_OPTIONS * Options = &EventDetails->Throttle;
+
+    if (Options->SampleProbability > DEBUGGER_EVENT_THROTTLE_PROBABILITY_SCALE)
+    {
+        return FALSE;
+    }
+
+    if (Options->MaximumHitsPerSecond != 0 && g_TscFrequency == (UINT64)NULL)
+    {
+        return FALSE;
+    }
+
+    if (Options->DisableExitingWhenThrottled)
+    {
+        //
+        // Only the events that are controlled by the MSR and I/O bitmaps can
+        // be disarmed, and the exiting bit is re-armed once the rate budget
+        // is refilled
+        //
+        if (Options->MaximumHitsPerSecond == 0 || g_EventThrottleWorkerThread == NULL)
+        {
+            return FALSE;
+        }
+
+        if (EventDetails->EventType != RDMSR_INSTRUCTION_EXECUTION &&
+            EventDetails->EventType != WRMSR_INSTRUCTION_EXECUTION &&
+            EventDetails->EventType != IN_INSTRUCTION_EXECUTION &&
+            EventDetails->EventType != OUT_INSTRUCTION_EXECUTION)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Set the sampling and rate limiting options of an event
+ * @details should be called before the event is registered
+ *
+ * @param Event The target event
+ * @param Options The options from the user-mode
+ *
+ * @return VOID
+ */
+VOID
+EventThrottleSetOptions(PDEBUGGER_EVENT Event, DEBUGGER_EVENT_THROTTLE_OPTIONS * Options)
+{
+    RtlZeroMemory(&Event->Throttle, sizeof(DEBUGGER_EVENT_THROTTLE_STATE));
+
+    memcpy(&Event->Throttle.Options, Options, sizeof(DEBUGGER_EVENT_THROTTLE_OPTIONS));
+
+    if (Options->MaximumHitsPerSecond != 0)
+    {
+        ThrottleSetRate(&Event->Throttle.Rate, g_TscFrequency, Options->MaximumHitsPerSecond, Options->BurstSize);
+    }
+
+    Event->Throttle.IsThrottled = ThrottleIsEnabled(Options);
+}
+
+/**
+ * @brief Check whether the hit of the event should be suppressed
+ * @details The event should be filtered for the core, process, and its
+ * target before calling this function, 'all' stage events are evaluated
+ * once in the pre-event and the same decision is used for their post-event
+ *
+ * @param DbgState The state of the debugger on the current core
+ * @param Event The triggered event
+ * @param CallingStage Stage of calling (pre-event or post-event)
+ * @param Context The context of the event
+ *
+ * @return BOOLEAN TRUE if the conditions and actions of the event should
+ * not be performed for this hit
+ */
+BOOLEAN
+EventThrottleIsHitSuppressed(PROCESSOR_DEBUGGING_STATE *          DbgState,
+                             PDEBUGGER_EVENT                       Event,
+                             VMM_CALLBACK_EVENT_CALLING_STAGE_TYPE CallingStage,
+                             PVOID                                 Context)
+{
+    PROCESSOR_EVENT_THROTTLE_STATE *  State        = &DbgState->EventThrottle;
+    DEBUGGER_EVENT_THROTTLE_OPTIONS * Options      = &Event->Throttle.Options;
+    BOOLEAN                           IsSuppressed = FALSE;
+    UINT64                            RearmTime    = 0;
+
+    if (Event->EventMode == VMM_CALLBACK_CALLING_STAGE_ALL_EVENT_EMULATION &&
+        CallingStage == VMM_CALLBACK_CALLING_STAGE_POST_EVENT_EMULATION)
+    {
+        for (UINT32 i = 0; i < State->NumberOfSuppressedPreEvents; i++)
+        {
+            if (State->SuppressedPreEvents[i] == Event)
+            {
+                State->NumberOfSuppressedPreEvents--;
+                State->SuppressedPreEvents[i] = State->SuppressedPreEvents[State->NumberOfSuppressedPreEvents];
+
+                return TRUE;
+            }
+        }
+
+        return FALSE;
+    }
+
+    //
+    // Sampling
+    //
+    if (ThrottleIsSampledOut(Options, &Event->Throttle.NumberOfHits, &State->RandomState))
+    {
+        IsSuppressed = TRUE;
+    }
+
+    //
+    // Rate limiting (only the sampled hits are charged)
+    //
+    else if (Options->MaximumHitsPerSecond != 0 && !ThrottleConsumeRateBudget(&Event->Throttle.Rate, __rdtsc(), &RearmTime))
+    {
+        IsSuppressed = TRUE;
+
+        if (Options->DisableExitingWhenThrottled)
+        {
+            EventThrottleDisarmExiting(DbgState, Event, (UINT32)(UINT64)Context, RearmTime);
+        }
+    }
+
+    if (!IsSuppressed)
+    {
+        return FALSE;
+    }
+
+    State->SuppressedHits++;
+    InterlockedIncrement64(&Event->Throttle.SuppressedHits);
+
+    //
+    // If there is no room, the post-event of the 'all' stage event is
+    // not suppressed, this is harmless as the post-event is then
+    // treated as a separate hit
+    //
+    if (Event->EventMode == VMM_CALLBACK_CALLING_STAGE_ALL_EVENT_EMULATION &&
+        State->NumberOfSuppressedPreEvents < EVENT_THROTTLE_MAXIMUM_SUPPRESSED_PRE_EVENTS)
+    {
+        State->SuppressedPreEvents[State->NumberOfSuppressedPreEvents++] = Event;
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Query the number of suppressed hits of an event or a core
+ * @details If the tag is DEBUGGER_MODIFY_EVENTS_APPLY_TO_ALL_TAG then the
+ * hits that are suppressed on the core (for all events) are queried
+ *
+ * @param QueryRequest The query request
+ *
+ * @return BOOLEAN TRUE if the query was successful
+ */
+BOOLEAN
+EventThrottleQuerySuppressedHits(PDEBUGGER_MODIFY_EVENTS QueryRequest)
+{
+    PDEBUGGER_EVENT Event;
+
+    if (QueryRequest->Tag == DEBUGGER_MODIFY_EVENTS_APPLY_TO_ALL_TAG)
+    {
+        if (!CommonValidateCoreNumber(QueryRequest->CoreId))
+        {
+            QueryRequest->KernelStatus = DEBUGGER_ERROR_INVALID_CORE_ID;
+            return FALSE;
+        }
+
+        QueryRequest->SuppressedHits = g_DbgState[QueryRequest->CoreId].EventThrottle.SuppressedHits;
+    }
+    else
+    {
+        Event = DebuggerGetEventByTag(QueryRequest->Tag);
+
+        if (Event == NULL)
+        {
+            QueryRequest->KernelStatus = DEBUGGER_ERROR_TAG_NOT_EXISTS;
+            return FALSE;
+        }
+
+        QueryRequest->SuppressedHits = (UINT64)Event->Throttle.SuppressedHits;
+    }
+
+    QueryRequest->KernelStatus = DEBUGGER_OPERATION_WAS_SUCCESSFUL;
+    return TRUE;
+}
@@ -1407,7 +1407,9 @@ TerminateQueryDebuggerResourceExternalInterruptExiting(UINT32
     if (KdQueryDebuggerQueryThreadOrProcessTracingDetailsByCoreId(CoreId,
                                                                   DEBUGGER_THREAD_PROCESS_TRACING_INTERCEPT_CLOCK_INTERRUPTS_FOR_THREAD_CHANGE) ||
         KdQueryDebuggerQueryThreadOrProcessTracingDetailsByCoreId(CoreId,
-                                                                  DEBUGGER_THREAD_PROCESS_TRACING_INTERCEPT_CLOCK_INTERRUPTS_FOR_PROCESS_CHANGE))
+                                                                  DEBUGGER_THREAD_PROCESS_TRACING_INTERCEPT_CLOCK_INTERRUPTS_FOR_PROCESS_CHANGE) ||
+        KdQueryDebuggerQueryThreadOrProcessTracingDetailsByCoreId(CoreId,
+                                                                  DEBUGGER_THREAD_PROCESS_TRACING_INTERCEPT_CLOCK_INTERRUPTS_FOR_BRANCH_TRACING))
     {
         //
         // Terminate the operation
@@ -169,6 +169,21 @@ KdInitializeInstantEventPools()
         // BTW, won't fail the starting phase because of this
         //
     }
+
+    //
+    // The regular instant events are refilled in the background once they
+    // drop to the low watermark (set after the allocations to avoid
+    // replenishing the pools that are already requested)
+    //
+    PoolManagerSetWatermarks(INSTANT_REGULAR_EVENT_BUFFER,
+                             REGULAR_INSTANT_EVENT_CONDITIONAL_BUFFER,
+                             REGULAR_INSTANT_EVENTS_LOW_WATERMARK,
+                             MAXIMUM_REGULAR_INSTANT_EVENTS);
+
+    PoolManagerSetWatermarks(INSTANT_REGULAR_EVENT_ACTION_BUFFER,
+                             REGULAR_INSTANT_EVENT_ACTION_BUFFER,
+                             REGULAR_INSTANT_EVENTS_LOW_WATERMARK,
+                             MAXIMUM_REGULAR_INSTANT_EVENTS);
 }
 
 /**
@@ -248,6 +263,12 @@ KdQueryDebuggerQueryThreadOrProcessTracingDetailsByCoreId(UINT32
 
         break;
 
+    case DEBUGGER_THREAD_PROCESS_TRACING_INTERCEPT_CLOCK_INTERRUPTS_FOR_BRANCH_TRACING:
+
+        Result = DbgState->ThreadOrProcessTracingDetails.InterceptClockInterruptsForBranchTracing;
+
+        break;
+
     default:
 
         LogError("Err, debugger encountered an unknown query type for querying process or thread interception details");
@@ -541,6 +562,17 @@ KdApplyTasksPreHaltCore(PROCESSOR_DEBUGGING_STATE * DbgState)
                                                  FALSE,
                                                  DbgState->ThreadOrProcessTracingDetails.InitialSetByClockInterrupt);
     }
+
+    //
+    // Check to drain the branches and stop tracing the branches
+    //
+    if (DbgState->ThreadOrProcessTracingDetails.InitialSetBranchTracing == TRUE)
+    {
+        //
+        // Disable the LBR and the context switch detection
+        //
+        BranchTracingEnableOrDisableOnCore(DbgState, FALSE);
+    }
 }
 
 /**
@@ -596,6 +628,11 @@ KdContinueDebuggee(PROCESSOR_DEBUGGING_STATE *             DbgState,
     //
     VmFuncCheckAndEnableExternalInterrupts(DbgState->CoreId);
 
+    //
+    // The resumable operations are not valid after continuing
+    //
+    KdCursorInvalidateAll();
+
     //
     // Unlock all the cores
     //
@@ -621,6 +658,11 @@ KdContinueDebuggeeJustCurrentCore(PROCESSOR_DEBUGGING_STATE * DbgState)
     //
     DbgState->DoNotNmiNotifyOtherCoresByThisCore = TRUE;
 
+    //
+    // The resumable operations are not valid after continuing
+    //
+    KdCursorInvalidateAll();
+
     //
     // Unlock the current core
     //
@@ -1875,6 +1917,364 @@ KdBringPagein(PROCESSOR_DEBUGGING_STATE * DbgState,
     }
 }
 
+/**
+ * @brief Perform a slice of the multi-pattern search while the debuggee
+ * is halted
+ * @details the search is started, continued, or cancelled based on the
+ * action of the cursor, the request of the running search is kept at the
+ * start of the search response buffer and the results of each slice are
+ * written after it
+ *
+ * @param SearchPacket
+ * @param SearchPacketSize size of the received buffer
+ *
+ * @return UINT32 size of the result in the search response buffer
+ */
+UINT32
+KdPerformSearchMultiplePatterns(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS SearchPacket, UINT32 SearchPacketSize)
+{
+    PDEBUGGER_SEARCH_MULTIPLE_PATTERNS SearchResult = (PDEBUGGER_SEARCH_MULTIPLE_PATTERNS)g_KdSearchResponseBuffer;
+    BOOLEAN                            IsFinished;
+
+    if (SearchPacketSize < SIZEOF_DEBUGGER_SEARCH_MULTIPLE_PATTERNS)
+    {
+        RtlZeroMemory(SearchResult, SIZEOF_DEBUGGER_SEARCH_MULTIPLE_PATTERNS);
+        SearchResult->KernelStatus      = DEBUGGER_ERROR_INVALID_SEARCH_PATTERNS;
+        SearchResult->Cursor.IsFinished = TRUE;
+
+        return SIZEOF_DEBUGGER_SEARCH_MULTIPLE_PATTERNS;
+    }
+
+    switch (SearchPacket->Cursor.Action)
+    {
+    case DEBUGGER_OPERATION_CURSOR_ACTION_START:
+
+        //
+        // A new search replaces the previous one (if any)
+        //
+        RtlCopyMemory(SearchResult, SearchPacket, SIZEOF_DEBUGGER_SEARCH_MULTIPLE_PATTERNS);
+
+        SearchResult->NumberOfResults          = 0;
+        SearchResult->Cursor.IsFinished        = TRUE;
+        SearchResult->Cursor.ContinuationToken = (UINT64)NULL;
+
+        if (!SearchMultiplePatternsCompile(SearchResult, g_KdSearchAutomaton))
+        {
+            KdCursorClose(&g_KdSearchCursor);
+            SearchResult->KernelStatus = DEBUGGER_ERROR_INVALID_SEARCH_PATTERNS;
+
+            return SIZEOF_DEBUGGER_SEARCH_MULTIPLE_PATTERNS;
+        }
+
+        KdCursorOpen(&g_KdSearchCursor);
+
+        break;
+
+    case DEBUGGER_OPERATION_CURSOR_ACTION_CONTINUE:
+
+        if (!KdCursorIsValid(&g_KdSearchCursor, SearchPacket->Cursor.ContinuationToken))
+        {
+            //
+            // The search is not resumable anymore (e.g., the debuggee is continued),
+            // the running search (if any) is also discarded
+            //
+            RtlCopyMemory(SearchResult, SearchPacket, SIZEOF_DEBUGGER_SEARCH_MULTIPLE_PATTERNS);
+
+            SearchResult->NumberOfResults          = 0;
+            SearchResult->KernelStatus             = DEBUGGER_ERROR_INVALID_CONTINUATION_TOKEN;
+            SearchResult->Cursor.IsFinished        = TRUE;
+            SearchResult->Cursor.ContinuationToken = (UINT64)NULL;
+
+            KdCursorClose(&g_KdSearchCursor);
+
+            return SIZEOF_DEBUGGER_SEARCH_MULTIPLE_PATTERNS;
+        }
+
+        break;
+
+    default:
+
+        //
+        // Cancel the search
+        //
+        KdCursorClose(&g_KdSearchCursor);
+
+        RtlCopyMemory(SearchResult, SearchPacket, SIZEOF_DEBUGGER_SEARCH_MULTIPLE_PATTERNS);
+
+        SearchResult->NumberOfResults          = 0;
+        SearchResult->KernelStatus             = DEBUGGER_OPERATION_WAS_SUCCESSFUL;
+        SearchResult->Cursor.IsFinished        = TRUE;
+        SearchResult->Cursor.ContinuationToken = (UINT64)NULL;
+
+        return SIZEOF_DEBUGGER_SEARCH_MULTIPLE_PATTERNS;
+    }
+
+    //
+    // Perform a slice of the search
+    //
+    KdCursorStartSlice(&g_KdSearchCursor);
+
+    IsFinished = SearchMultiplePatternsResume(SearchResult,
+                                              g_KdSearchAutomaton,
+                                              (PDEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT)(g_KdSearchResponseBuffer + SIZEOF_DEBUGGER_SEARCH_MULTIPLE_PATTERNS),
+                                              TRUE,
+                                              &g_KdSearchCursor);
+
+    if (IsFinished)
+    {
+        KdCursorClose(&g_KdSearchCursor);
+        SearchResult->Cursor.ContinuationToken = (UINT64)NULL;
+    }
+    else
+    {
+        SearchResult->Cursor.ContinuationToken = g_KdSearchCursor.Token;
+    }
+
+    return SIZEOF_DEBUGGER_SEARCH_MULTIPLE_PATTERNS +
+           SearchResult->NumberOfResults * sizeof(DEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT);
+}
+
+/**
+ * @brief Perform a slice of the memory search (s*) while the debuggee
+ * is halted
+ * @details the search is started, continued, or cancelled based on the
+ * action of the cursor, the debugger continues the search from the next
+ * address of the previous slice, the results are shown (logged) by the
+ * search itself
+ *
+ * @param SearchPacket
+ * @param SearchResult
+ *
+ * @return VOID
+ */
+VOID
+KdPerformSearchMemory(PDEBUGGER_SEARCH_MEMORY SearchPacket, PDEBUGGEE_RESULT_OF_SEARCH_PACKET SearchResult)
+{
+    UINT64 EndAddress = SearchPacket->Address + SearchPacket->Length;
+
+    SearchResult->CountOfResults           = 0;
+    SearchResult->NextAddress              = EndAddress;
+    SearchResult->Cursor.Action            = SearchPacket->Cursor.Action;
+    SearchResult->Cursor.IsFinished        = TRUE;
+    SearchResult->Cursor.ContinuationToken = (UINT64)NULL;
+
+    switch (SearchPacket->Cursor.Action)
+    {
+    case DEBUGGER_OPERATION_CURSOR_ACTION_START:
+
+        //
+        // A new search replaces the previous one (if any)
+        //
+        KdCursorOpen(&g_KdSearchMemoryCursor);
+
+        break;
+
+    case DEBUGGER_OPERATION_CURSOR_ACTION_CONTINUE:
+
+        if (!KdCursorIsValid(&g_KdSearchMemoryCursor, SearchPacket->Cursor.ContinuationToken))
+        {
+            //
+            // The search is not resumable anymore (e.g., the debuggee is continued)
+            //
+            KdCursorClose(&g_KdSearchMemoryCursor);
+            SearchResult->Result = DEBUGGER_ERROR_INVALID_CONTINUATION_TOKEN;
+
+            return;
+        }
+
+        break;
+
+    default:
+
+        //
+        // Cancel the search
+        //
+        KdCursorClose(&g_KdSearchMemoryCursor);
+        SearchResult->Result = DEBUGGER_OPERATION_WAS_SUCCESSFUL;
+
+        return;
+    }
+
+    //
+    // Perform a slice of the search
+    //
+    KdCursorStartSlice(&g_KdSearchMemoryCursor);
+
+    if (!SearchAddressWrapper(NULL,
+                              SearchPacket,
+                              SearchPacket->Address,
+                              EndAddress,
+                              TRUE,
+                              &SearchResult->CountOfResults,
+                              &g_KdSearchMemoryCursor,
+                              &SearchResult->NextAddress))
+    {
+        //
+        // There was an error, probably the address was not valid
+        //
+        KdCursorClose(&g_KdSearchMemoryCursor);
+        SearchResult->Result      = DEBUGGER_ERROR_INVALID_ADDRESS;
+        SearchResult->NextAddress = EndAddress;
+
+        return;
+    }
+
+    SearchResult->Result = DEBUGGER_OPERATION_WAS_SUCCESSFUL;
+
+    if (SearchResult->NextAddress >= EndAddress)
+    {
+        KdCursorClose(&g_KdSearchMemoryCursor);
+    }
+    else
+    {
+        SearchResult->Cursor.IsFinished        = FALSE;
+        SearchResult->Cursor.ContinuationToken = g_KdSearchMemoryCursor.Token;
+    }
+}
+
+/**
+ * @brief Read the memory of a batch operation
+ *
+ * @param ReadMemRequest
+ * @param TargetBuffer
+ * @param ReturnSize
+ * @param Context not used
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+KdBatchReadMemory(PDEBUGGER_READ_MEMORY ReadMemRequest, UCHAR * TargetBuffer, UINT32 * ReturnSize, PVOID Context)
+{
+    UNREFERENCED_PARAMETER(Context);
+
+    return DebuggerCommandReadMemoryVmxRoot(ReadMemRequest, TargetBuffer, ReturnSize);
+}
+
+/**
+ * @brief Edit the memory of a batch operation
+ *
+ * @param EditMemRequest
+ * @param Context not used
+ *
+ * @return VOID
+ */
+static VOID
+KdBatchEditMemory(PDEBUGGER_EDIT_MEMORY EditMemRequest, PVOID Context)
+{
+    UNREFERENCED_PARAMETER(Context);
+
+    DebuggerCommandEditMemoryVmxRoot(EditMemRequest);
+}
+
+/**
+ * @brief Read the register(s) of a batch operation
+ *
+ * @param ReadRegisterRequest
+ * @param Context The state of the debugger on the current core
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+KdBatchReadRegister(PDEBUGGEE_REGISTER_READ_DESCRIPTION ReadRegisterRequest, PVOID Context)
+{
+    return KdReadRegisters((PROCESSOR_DEBUGGING_STATE *)Context, ReadRegisterRequest);
+}
+
+/**
+ * @brief Write the register of a batch operation
+ *
+ * @param RegisterId
+ * @param Value
+ * @param Context The state of the debugger on the current core
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+KdBatchWriteRegister(UINT32 RegisterId, UINT64 Value, PVOID Context)
+{
+    return SetRegValue(((PROCESSOR_DEBUGGING_STATE *)Context)->Regs, RegisterId, Value);
+}
+
+/**
+ * @brief Set the breakpoint of a batch operation
+ *
+ * @param BpRequest
+ * @param Context not used
+ *
+ * @return VOID
+ */
+static VOID
+KdBatchSetBreakpoint(PDEBUGGEE_BP_PACKET BpRequest, PVOID Context)
+{
+    UNREFERENCED_PARAMETER(Context);
+
+    BreakpointAddNew(BpRequest);
+}
+
+/**
+ * @brief Modify (or clear) the breakpoint of a batch operation
+ *
+ * @param BpModifyRequest
+ * @param Context not used
+ *
+ * @return VOID
+ */
+static VOID
+KdBatchModifyBreakpoint(PDEBUGGEE_BP_LIST_OR_MODIFY_PACKET BpModifyRequest, PVOID Context)
+{
+    UNREFERENCED_PARAMETER(Context);
+
+    BreakpointListOrModify(BpModifyRequest);
+}
+
+/**
+ * @brief Bring the pages of a batch operation in (once the debuggee continues)
+ *
+ * @param PageinRequest
+ * @param Context The state of the debugger on the current core
+ *
+ * @return VOID
+ */
+static VOID
+KdBatchPagein(PDEBUGGER_PAGE_IN_REQUEST PageinRequest, PVOID Context)
+{
+    KdBringPagein((PROCESSOR_DEBUGGING_STATE *)Context, PageinRequest);
+}
+
+/**
+ * @brief Perform a batch of operations while the debuggee is halted
+ * @details the packet is validated and performed by the batch operations
+ * component, the result is written into the batch response buffer
+ *
+ * @param DbgState The state of the debugger on the current core
+ * @param BatchPacket
+ * @param BatchPacketSize size of the received buffer
+ *
+ * @return UINT32 size of the result in the batch response buffer
+ */
+UINT32
+KdPerformBatchOperations(PROCESSOR_DEBUGGING_STATE * DbgState,
+                         PDEBUGGEE_BATCH_PACKET      BatchPacket,
+                         UINT32                      BatchPacketSize)
+{
+    BATCH_OPERATIONS_BACK_END BackEnd = {
+        KdBatchReadMemory,
+        KdBatchEditMemory,
+        KdBatchReadRegister,
+        KdBatchWriteRegister,
+        KdBatchSetBreakpoint,
+        KdBatchModifyBreakpoint,
+        KdBatchPagein,
+        DbgState,
+    };
+
+    return BatchOperationsPerform(BatchPacket,
+                                  BatchPacketSize,
+                                  g_KdBatchResponseBuffer,
+                                  MaxBatchPacketSize,
+                                  &BackEnd);
+}
+
 /**
  * @brief Perform the test packet's operation
  *
@@ -2138,6 +2538,13 @@ KdPerformEventQueryAndModification(PDEBUGGER_MODIFY_EVENTS ModifyAndQueryEvent)
             ModifyAndQueryEvent->KernelStatus = DEBUGGER_OPERATION_WAS_SUCCESSFUL;
         }
     }
+    else if (ModifyAndQueryEvent->TypeOfAction == DEBUGGER_MODIFY_EVENTS_QUERY_SUPPRESSED_HITS)
+    {
+        //
+        // Query the hits that are suppressed by the throttling options
+        //
+        EventThrottleQuerySuppressedHits(ModifyAndQueryEvent);
+    }
     else if (ModifyAndQueryEvent->TypeOfAction == DEBUGGER_MODIFY_EVENTS_ENABLE)
     {
         if (IsForAllEvents)
@@ -2318,8 +2725,13 @@ KdDispatchAndPerformCommandsFromDebugger(PROCESSOR_DEBUGGING_STATE * DbgState)
     PDEBUGGEE_EVENT_AND_ACTION_HEADER_FOR_REMOTE_PACKET AddActionPacket;
     PDEBUGGER_MODIFY_EVENTS                             QueryAndModifyEventPacket;
     PDEBUGGER_SHORT_CIRCUITING_EVENT                    ShortCircuitingEventPacket;
+    PDEBUGGEE_BATCH_PACKET                              BatchPacket;
+    PDEBUGGER_SEARCH_MULTIPLE_PATTERNS                  SearchMultiplePatternsPacket;
+    PDEBUGGER_BRANCH_TRACE_REQUEST                      BranchTracePacket;
+    PDEBUGGER_BRANCH_TRACE_REQUEST                      BranchTraceResult;
     UINT32                                              SizeToSend                   = 0;
     BOOLEAN                                             UnlockTheNewCore             = FALSE;
+    BOOLEAN                                             IsBranchTraceStarted         = FALSE;
     UINT32                                              ReturnSize                   = 0;
     DEBUGGEE_RESULT_OF_SEARCH_PACKET                    SearchPacketResult           = {0};
     DEBUGGER_EVENT_AND_ACTION_RESULT                    DebuggerEventAndActionResult = {0};
@@ -2823,37 +3235,80 @@ KdDispatchAndPerformCommandsFromDebugger(PROCESSOR_DEBUGGING_STATE * DbgState)
                 SearchQueryPacket = (DEBUGGER_SEARCH_MEMORY *)(((CHAR *)TheActualPacket) + sizeof(DEBUGGER_REMOTE_PACKET));
 
                 //
-                // Perform the search in debuggee debuggee
-                // Call the search wrapper
+                // Perform a slice of the search in debuggee
+                //
+                KdPerformSearchMemory(SearchQueryPacket, &SearchPacketResult);
+
+                //
+                // Send the result of the 's*' back to the debuggee
+                //
+                KdResponsePacketToDebugger(DEBUGGER_REMOTE_PACKET_TYPE_DEBUGGEE_TO_DEBUGGER,
+                                           DEBUGGER_REMOTE_PACKET_REQUESTED_ACTION_DEBUGGEE_RELOAD_SEARCH_QUERY,
+                                           (CHAR *)&SearchPacketResult,
+                                           sizeof(DEBUGGEE_RESULT_OF_SEARCH_PACKET));
+
+                break;
+
+            case DEBUGGER_REMOTE_PACKET_REQUESTED_ACTION_ON_VMX_ROOT_SEARCH_MULTIPLE_PATTERNS:
+
+                SearchMultiplePatternsPacket = (DEBUGGER_SEARCH_MULTIPLE_PATTERNS *)(((CHAR *)TheActualPacket) + sizeof(DEBUGGER_REMOTE_PACKET));
+
+                //
+                // Perform a slice of the search
+                //
+                SizeToSend = KdPerformSearchMultiplePatterns(SearchMultiplePatternsPacket,
+                                                             RecvBufferLength > sizeof(DEBUGGER_REMOTE_PACKET) ? RecvBufferLength - sizeof(DEBUGGER_REMOTE_PACKET) : 0);
+
+                //
+                // Send the result of the 'sm' back to the debugger
                 //
+                KdResponsePacketToDebugger(DEBUGGER_REMOTE_PACKET_TYPE_DEBUGGEE_TO_DEBUGGER,
+                                           DEBUGGER_REMOTE_PACKET_REQUESTED_ACTION_DEBUGGEE_RESULT_OF_SEARCH_MULTIPLE_PATTERNS,
+                                           g_KdSearchResponseBuffer,
+                                           SizeToSend);
 
-                if (SearchAddressWrapper(NULL,
-                                         SearchQueryPacket,
-                                         SearchQueryPacket->Address,
-                                         SearchQueryPacket->Address + SearchQueryPacket->Length,
-                                         TRUE,
-                                         &SearchPacketResult.CountOfResults))
+                break;
+
+            case DEBUGGER_REMOTE_PACKET_REQUESTED_ACTION_ON_VMX_ROOT_BRANCH_TRACE:
+
+                BranchTracePacket = (DEBUGGER_BRANCH_TRACE_REQUEST *)(((CHAR *)TheActualPacket) + sizeof(DEBUGGER_REMOTE_PACKET));
+                BranchTraceResult = (DEBUGGER_BRANCH_TRACE_REQUEST *)g_BranchTracingState.ResponseBuffer;
+
+                RtlZeroMemory(BranchTraceResult, SIZEOF_DEBUGGER_BRANCH_TRACE_REQUEST);
+
+                if (RecvBufferLength < sizeof(DEBUGGER_REMOTE_PACKET) + SIZEOF_DEBUGGER_BRANCH_TRACE_REQUEST)
                 {
-                    //
-                    // The search was successful
-                    //
-                    SearchPacketResult.Result = DEBUGGER_OPERATION_WAS_SUCCESSFUL;
+                    BranchTraceResult->KernelStatus = DEBUGGER_ERROR_INVALID_BRANCH_TRACE_REQUEST;
+                    IsBranchTraceStarted            = FALSE;
                 }
                 else
                 {
+                    RtlCopyMemory(BranchTraceResult, BranchTracePacket, SIZEOF_DEBUGGER_BRANCH_TRACE_REQUEST);
+
                     //
-                    // There was an error, probably the address was not valid
+                    // Start the tracing or read a slice of the records
                     //
-                    SearchPacketResult.Result = DEBUGGER_ERROR_INVALID_ADDRESS;
+                    IsBranchTraceStarted = BranchTracingPerformRequest(DbgState, BranchTraceResult);
                 }
 
                 //
-                // Send the result of the 's*' back to the debuggee
+                // Send the result of the '!track lbr' back to the debugger
                 //
                 KdResponsePacketToDebugger(DEBUGGER_REMOTE_PACKET_TYPE_DEBUGGEE_TO_DEBUGGER,
-                                           DEBUGGER_REMOTE_PACKET_REQUESTED_ACTION_DEBUGGEE_RELOAD_SEARCH_QUERY,
-                                           (CHAR *)&SearchPacketResult,
-                                           sizeof(DEBUGGEE_RESULT_OF_SEARCH_PACKET));
+                                           DEBUGGER_REMOTE_PACKET_REQUESTED_ACTION_DEBUGGEE_RESULT_OF_BRANCH_TRACE,
+                                           g_BranchTracingState.ResponseBuffer,
+                                           SIZEOF_DEBUGGER_BRANCH_TRACE_REQUEST + BranchTraceResult->NumberOfRecords * sizeof(DEBUGGER_BRANCH_TRACE_RECORD));
+
+                if (IsBranchTraceStarted)
+                {
+                    IsBranchTraceStarted = FALSE;
+
+                    //
+                    // Continue the debuggee until the branches are traced
+                    //
+                    KdContinueDebuggee(DbgState, FALSE, DEBUGGER_REMOTE_PACKET_REQUESTED_ACTION_NO_ACTION);
+                    EscapeFromTheLoop = TRUE;
+                }
 
                 break;
 
@@ -3036,6 +3491,27 @@ KdDispatchAndPerformCommandsFromDebugger(PROCESSOR_DEBUGGING_STATE * DbgState)
 
                 break;
 
+            case DEBUGGER_REMOTE_PACKET_REQUESTED_ACTION_ON_VMX_ROOT_PERFORM_BATCH_OPERATIONS:
+
+                BatchPacket = (DEBUGGEE_BATCH_PACKET *)(((CHAR *)TheActualPacket) + sizeof(DEBUGGER_REMOTE_PACKET));
+
+                //
+                // Perform the operations of the batch
+                //
+                SizeToSend = KdPerformBatchOperations(DbgState,
+                                                      BatchPacket,
+                                                      RecvBufferLength > sizeof(DEBUGGER_REMOTE_PACKET) ? RecvBufferLength - sizeof(DEBUGGER_REMOTE_PACKET) : 0);
+
+                //
+                // Send the result of all of the operations back to the debugger
+                //
+                KdResponsePacketToDebugger(DEBUGGER_REMOTE_PACKET_TYPE_DEBUGGEE_TO_DEBUGGER,
+                                           DEBUGGER_REMOTE_PACKET_REQUESTED_ACTION_DEBUGGEE_RESULT_OF_BATCH_OPERATIONS,
+                                           g_KdBatchResponseBuffer,
+                                           SizeToSend);
+
+                break;
+
             case DEBUGGER_REMOTE_PACKET_REQUESTED_ACTION_ON_VMX_ROOT_INJECT_PAGE_FAULT:
 
                 PageinPacket = (DEBUGGER_PAGE_IN_REQUEST *)(((CHAR *)TheActualPacket) + sizeof(DEBUGGER_REMOTE_PACKET));
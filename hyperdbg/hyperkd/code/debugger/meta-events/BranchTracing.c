@@ -0,0 +1,610 @@
+/**
+ * @file BranchTracing.c
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Tracing the branches of a thread (LBR)
+ * @details Instead of a vm-exit for each instruction (MTF) or branch, the
+ * LBR is only enabled on the core that runs the target thread, and the whole
+ * stack is drained at the drain points (the target thread is switched out,
+ * the debuggee is halted, and optionally the clock interrupts), the context
+ * switches are detected by the debug register on gs:[188]
+ *
+ * @version 0.11
+ * @date 2024-11-08
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Allocate the buffers of the branch tracing
+ * @details should be called in vmx non-root mode
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+BranchTracingInitialize()
+{
+    if (!g_BranchTracingState.Records)
+    {
+        g_BranchTracingState.Records = PlatformMemAllocateNonPagedPool(MaximumBranchTraceRecords * sizeof(DEBUGGER_BRANCH_TRACE_RECORD));
+    }
+
+    if (!g_BranchTracingState.ResponseBuffer)
+    {
+        g_BranchTracingState.ResponseBuffer = PlatformMemAllocateNonPagedPool(SIZEOF_DEBUGGER_BRANCH_TRACE_REQUEST +
+                                                                              MaximumBranchTraceRecordsPerRequest * sizeof(DEBUGGER_BRANCH_TRACE_RECORD));
+    }
+
+    if (!g_BranchTracingState.Records || !g_BranchTracingState.ResponseBuffer)
+    {
+        return FALSE;
+    }
+
+    g_BranchTracingState.Lock            = 0;
+    g_BranchTracingState.IsActive        = FALSE;
+    g_BranchTracingState.NumberOfRecords = 0;
+
+    return TRUE;
+}
+
+/**
+ * @brief Free the buffers of the branch tracing
+ *
+ * @return VOID
+ */
+VOID
+BranchTracingUninitialize()
+{
+    g_BranchTracingState.IsActive = FALSE;
+
+    if (g_BranchTracingState.Records != NULL)
+    {
+        PlatformMemFreePool(g_BranchTracingState.Records);
+        g_BranchTracingState.Records = NULL;
+    }
+
+    if (g_BranchTracingState.ResponseBuffer != NULL)
+    {
+        PlatformMemFreePool(g_BranchTracingState.ResponseBuffer);
+        g_BranchTracingState.ResponseBuffer = NULL;
+    }
+}
+
+/**
+ * @brief Check whether the target thread is running on the current core
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+BranchTracingIsTargetThread()
+{
+    return g_BranchTracingState.ProcessId == HANDLE_TO_UINT32(PsGetCurrentProcessId()) &&
+           g_BranchTracingState.ThreadId == HANDLE_TO_UINT32(PsGetCurrentThreadId());
+}
+
+/**
+ * @brief Drain the branches of the target thread from the LBR stack of
+ * the current core
+ * @details should be called in vmx-root mode
+ *
+ * @param DbgState The state of the debugger on the current core
+ *
+ * @return BOOLEAN Shows whether the number of branches is reached or not
+ */
+static BOOLEAN
+BranchTracingDrainOnCore(PROCESSOR_DEBUGGING_STATE * DbgState)
+{
+    PDEBUGGER_BRANCH_TRACE_RECORD Records;
+    UINT32                        Count;
+    BOOLEAN                       IsOverflowed;
+    BOOLEAN                       IsFinished = FALSE;
+
+    SpinlockLock(&g_BranchTracingState.Lock);
+
+    Records = &g_BranchTracingState.Records[g_BranchTracingState.NumberOfRecords];
+
+    Count = VmFuncBranchTraceDrainOnCurrentCore(DbgState->CoreId,
+                                                Records,
+                                                g_BranchTracingState.NumberOfBranches - g_BranchTracingState.NumberOfRecords,
+                                                &IsOverflowed);
+
+    for (UINT32 i = 0; i < Count; i++)
+    {
+        Records[i].CoreId = (UINT16)DbgState->CoreId;
+    }
+
+    if (Count != 0)
+    {
+        //
+        // The first drained branch is not continued from the previous record
+        // if the older branches are overwritten or the thread is switched in
+        //
+        if (IsOverflowed)
+        {
+            Records[0].Flags |= DEBUGGER_BRANCH_TRACE_RECORD_FLAG_BRANCHES_LOST;
+        }
+
+        if (DbgState->ThreadOrProcessTracingDetails.IsBranchTracingThreadResumed)
+        {
+            Records[0].Flags |= DEBUGGER_BRANCH_TRACE_RECORD_FLAG_THREAD_RESUMED;
+
+            DbgState->ThreadOrProcessTracingDetails.IsBranchTracingThreadResumed = FALSE;
+        }
+
+        g_BranchTracingState.NumberOfRecords += Count;
+    }
+
+    if (g_BranchTracingState.IsActive &&
+        g_BranchTracingState.NumberOfRecords >= g_BranchTracingState.NumberOfBranches)
+    {
+        g_BranchTracingState.IsActive = FALSE;
+        IsFinished                    = TRUE;
+    }
+
+    SpinlockUnlock(&g_BranchTracingState.Lock);
+
+    return IsFinished;
+}
+
+/**
+ * @brief Enable the LBR on the current core as the target thread is running
+ * on it
+ * @details should be called in vmx-root mode
+ *
+ * @param DbgState The state of the debugger on the current core
+ * @param IsResumed Whether the target thread is switched in or not
+ *
+ * @return VOID
+ */
+static VOID
+BranchTracingStartOnCore(PROCESSOR_DEBUGGING_STATE * DbgState, BOOLEAN IsResumed)
+{
+    VmFuncBranchTraceEnableOnCurrentCore(DbgState->CoreId, TRUE);
+
+    DbgState->ThreadOrProcessTracingDetails.IsTracingBranchesOnCore      = TRUE;
+    DbgState->ThreadOrProcessTracingDetails.IsBranchTracingThreadResumed = IsResumed;
+
+    if (g_BranchTracingState.DrainPoints & DEBUGGER_BRANCH_TRACE_DRAIN_ON_CLOCK_INTERRUPTS)
+    {
+        //
+        // We should get the clock interrupts
+        //
+        DbgState->ThreadOrProcessTracingDetails.InterceptClockInterruptsForBranchTracing = TRUE;
+
+        //
+        // Intercept external interrupts (for monitoring clock interrupts)
+        //
+        VmFuncSetExternalInterruptExiting(DbgState->CoreId, TRUE);
+    }
+}
+
+/**
+ * @brief Disable the LBR on the current core as the target thread is no
+ * longer running on it
+ * @details should be called in vmx-root mode after draining the branches
+ *
+ * @param DbgState The state of the debugger on the current core
+ *
+ * @return VOID
+ */
+static VOID
+BranchTracingStopOnCore(PROCESSOR_DEBUGGING_STATE * DbgState)
+{
+    //
+    // The previous LBR bit and debug controls are restored
+    //
+    VmFuncBranchTraceEnableOnCurrentCore(DbgState->CoreId, FALSE);
+
+    DbgState->ThreadOrProcessTracingDetails.IsTracingBranchesOnCore      = FALSE;
+    DbgState->ThreadOrProcessTracingDetails.IsBranchTracingThreadResumed = FALSE;
+
+    if (DbgState->ThreadOrProcessTracingDetails.InterceptClockInterruptsForBranchTracing)
+    {
+        //
+        // We should ignore intercepting any further clock interrupts
+        //
+        DbgState->ThreadOrProcessTracingDetails.InterceptClockInterruptsForBranchTracing = FALSE;
+
+        //
+        // Undo intercepting external interrupts
+        //
+        VmFuncSetExternalInterruptExiting(DbgState->CoreId, FALSE);
+    }
+}
+
+/**
+ * @brief Finish tracing the branches and halt the debuggee
+ * @details should be called in vmx-root mode, the branches of other cores
+ * are drained and the LBRs are disabled before halting the cores
+ *
+ * @param DbgState The state of the debugger on the current core
+ *
+ * @return VOID
+ */
+static VOID
+BranchTracingFinish(PROCESSOR_DEBUGGING_STATE * DbgState)
+{
+    DEBUGGER_TRIGGERED_EVENT_DETAILS TargetContext = {0};
+
+    //
+    // The debugger shows the results instead of the current instruction
+    //
+    DbgState->IgnoreDisasmInNextPacket = TRUE;
+
+    TargetContext.Context = (PVOID)VmFuncGetLastVmexitRip(DbgState->CoreId);
+
+    KdHandleBreakpointAndDebugBreakpoints(DbgState,
+                                          DEBUGGEE_PAUSING_REASON_DEBUGGEE_BRANCH_TRACE_FINISHED,
+                                          &TargetContext);
+}
+
+/**
+ * @brief Enable or disable tracing the branches on the current core
+ * @details should be called in vmx-root mode (halted core task or before
+ * halting the core), the context switches are detected on all cores, but
+ * the LBR is only enabled on the core that runs the target thread
+ *
+ * @param DbgState The state of the debugger on the current core
+ * @param Enable
+ *
+ * @return VOID
+ */
+VOID
+BranchTracingEnableOrDisableOnCore(PROCESSOR_DEBUGGING_STATE * DbgState, BOOLEAN Enable)
+{
+    if (Enable)
+    {
+        DbgState->ThreadOrProcessTracingDetails.InitialSetBranchTracing = TRUE;
+
+        ThreadDetectChangeByDebugRegisterOnGs(DbgState, TRUE);
+
+        if (BranchTracingIsTargetThread())
+        {
+            BranchTracingStartOnCore(DbgState, FALSE);
+        }
+    }
+    else if (DbgState->ThreadOrProcessTracingDetails.InitialSetBranchTracing)
+    {
+        //
+        // The branches are drained before halting the core, the number of
+        // branches is not checked as the debuggee is already halting
+        //
+        if (DbgState->ThreadOrProcessTracingDetails.IsTracingBranchesOnCore)
+        {
+            BranchTracingDrainOnCore(DbgState);
+            BranchTracingStopOnCore(DbgState);
+        }
+
+        ThreadDetectChangeByDebugRegisterOnGs(DbgState, FALSE);
+
+        DbgState->ThreadOrProcessTracingDetails.InitialSetBranchTracing = FALSE;
+    }
+}
+
+/**
+ * @brief Classify the branch based on the instruction at its source
+ * @details should be called in the memory layout of the target process
+ *
+ * @param Address The source of the branch
+ *
+ * @return UINT32 DEBUGGER_BRANCH_TRACE_TYPE
+ */
+static UINT32
+BranchTracingClassifyBranch(UINT64 Address)
+{
+    BYTE    Buffer[MAXIMUM_INSTR_SIZE] = {0};
+    UINT32  Length;
+    UINT32  Index   = 0;
+    BOOLEAN Is32Bit = g_BranchTracingState.IsUsermode32Bit && Address < 0x8000000000000000;
+
+    Length = CheckAddressMaximumInstructionLength((PVOID)Address);
+
+    if (Length == 0 || !MemoryMapperReadMemorySafe(Address, Buffer, Length))
+    {
+        return DEBUGGER_BRANCH_TRACE_TYPE_UNKNOWN;
+    }
+
+    //
+    // Skip the legacy prefixes and the REX prefix (only in 64-bit mode)
+    //
+    while (Index < Length - 1)
+    {
+        BYTE Prefix = Buffer[Index];
+
+        if (Prefix == 0xf0 || Prefix == 0xf2 || Prefix == 0xf3 || Prefix == 0x2e ||
+            Prefix == 0x36 || Prefix == 0x3e || Prefix == 0x26 || Prefix == 0x64 ||
+            Prefix == 0x65 || Prefix == 0x66 || Prefix == 0x67 ||
+            (!Is32Bit && (Prefix & 0xf0) == 0x40))
+        {
+            Index++;
+            continue;
+        }
+
+        break;
+    }
+
+    switch (Buffer[Index])
+    {
+    case 0xe8: // call rel
+    case 0x9a: // call far
+        return DEBUGGER_BRANCH_TRACE_TYPE_CALL;
+
+    case 0xc2: // ret imm16
+    case 0xc3: // ret
+    case 0xca: // ret far imm16
+    case 0xcb: // ret far
+        return DEBUGGER_BRANCH_TRACE_TYPE_RET;
+
+    case 0xcf: // iret
+        return DEBUGGER_BRANCH_TRACE_TYPE_IRET;
+
+    case 0xe9: // jmp rel32
+    case 0xeb: // jmp rel8
+    case 0xea: // jmp far
+        return DEBUGGER_BRANCH_TRACE_TYPE_JMP;
+
+    case 0xcc: // int3
+    case 0xcd: // int imm8
+    case 0xce: // into
+    case 0xf1: // int1
+        return DEBUGGER_BRANCH_TRACE_TYPE_SYSCALL;
+
+    case 0xff:
+
+        if (Index + 1 >= Length)
+        {
+            break;
+        }
+
+        //
+        // The reg field of the ModR/M selects the operation
+        //
+        switch ((Buffer[Index + 1] >> 3) & 0x7)
+        {
+        case 2: // call r/m
+        case 3: // call far m
+            return DEBUGGER_BRANCH_TRACE_TYPE_CALL;
+
+        case 4: // jmp r/m
+        case 5: // jmp far m
+            return DEBUGGER_BRANCH_TRACE_TYPE_JMP;
+
+        default:
+            break;
+        }
+
+        break;
+
+    case 0x0f:
+
+        if (Index + 1 >= Length)
+        {
+            break;
+        }
+
+        if (Buffer[Index + 1] >= 0x80 && Buffer[Index + 1] <= 0x8f)
+        {
+            //
+            // jcc rel32
+            //
+            return DEBUGGER_BRANCH_TRACE_TYPE_JCC;
+        }
+        else if (Buffer[Index + 1] == 0x05 || Buffer[Index + 1] == 0x07 ||
+                 Buffer[Index + 1] == 0x34 || Buffer[Index + 1] == 0x35)
+        {
+            //
+            // syscall, sysret, sysenter, sysexit
+            //
+            return DEBUGGER_BRANCH_TRACE_TYPE_SYSCALL;
+        }
+
+        break;
+
+    default:
+
+        if ((Buffer[Index] >= 0x70 && Buffer[Index] <= 0x7f) ||
+            (Buffer[Index] >= 0xe0 && Buffer[Index] <= 0xe3))
+        {
+            //
+            // jcc rel8, loop, jcxz
+            //
+            return DEBUGGER_BRANCH_TRACE_TYPE_JCC;
+        }
+
+        break;
+    }
+
+    //
+    // Not a branch instruction (e.g., interrupts or exceptions)
+    //
+    return DEBUGGER_BRANCH_TRACE_TYPE_UNKNOWN;
+}
+
+/**
+ * @brief Perform the requests of the branch tracing
+ * @details should be called in vmx-root mode while all cores are halted
+ *
+ * @param DbgState The state of the debugger on the current core
+ * @param BranchTraceRequest The request, the records are placed after it
+ *
+ * @return BOOLEAN Shows whether the debuggee should be continued or not
+ */
+BOOLEAN
+BranchTracingPerformRequest(PROCESSOR_DEBUGGING_STATE * DbgState, PDEBUGGER_BRANCH_TRACE_REQUEST BranchTraceRequest)
+{
+    PDEBUGGER_BRANCH_TRACE_RECORD Records;
+    UINT32                        NumberOfRecords;
+    CR3_TYPE                      CurrentProcessCr3;
+
+    BranchTraceRequest->NumberOfRecords = 0;
+
+    switch (BranchTraceRequest->RequestType)
+    {
+    case DEBUGGER_BRANCH_TRACE_REQUEST_START:
+
+        if (!VmFuncBranchTraceQuerySupport(&BranchTraceRequest->LbrFormat))
+        {
+            BranchTraceRequest->KernelStatus = DEBUGGER_ERROR_BRANCH_TRACE_NOT_SUPPORTED;
+            return FALSE;
+        }
+
+        if (BranchTraceRequest->NumberOfBranches == 0 ||
+            BranchTraceRequest->NumberOfBranches > MaximumBranchTraceRecords)
+        {
+            BranchTraceRequest->NumberOfBranches = MaximumBranchTraceRecords;
+        }
+
+        //
+        // The previous tracing (if any) is already stopped before halting
+        // the cores, so the records are discarded
+        //
+        g_BranchTracingState.ProcessId        = HANDLE_TO_UINT32(PsGetCurrentProcessId());
+        g_BranchTracingState.ThreadId         = HANDLE_TO_UINT32(PsGetCurrentThreadId());
+        g_BranchTracingState.ProcessCr3       = LayoutGetCurrentProcessCr3();
+        g_BranchTracingState.IsUsermode32Bit  = KdIsGuestOnUsermode32Bit();
+        g_BranchTracingState.NumberOfBranches = BranchTraceRequest->NumberOfBranches;
+        g_BranchTracingState.LbrFormat        = BranchTraceRequest->LbrFormat;
+        g_BranchTracingState.DrainPoints      = BranchTraceRequest->DrainPoints;
+        g_BranchTracingState.NumberOfRecords  = 0;
+        g_BranchTracingState.IsActive         = TRUE;
+
+        //
+        // Detect the context switches on all cores as the thread might be
+        // scheduled on any of them
+        //
+        HaltedCoreBroadcastTaskAllCores(DbgState,
+                                        DEBUGGER_HALTED_CORE_TASK_SET_BRANCH_TRACING,
+                                        TRUE,
+                                        TRUE,
+                                        (PVOID)TRUE);
+
+        BranchTraceRequest->KernelStatus = DEBUGGER_OPERATION_WAS_SUCCESSFUL;
+
+        return TRUE;
+
+    case DEBUGGER_BRANCH_TRACE_REQUEST_READ_RECORDS:
+
+        BranchTraceRequest->LbrFormat    = g_BranchTracingState.LbrFormat;
+        BranchTraceRequest->TotalRecords = g_BranchTracingState.NumberOfRecords;
+
+        if (BranchTraceRequest->StartIndex > g_BranchTracingState.NumberOfRecords)
+        {
+            BranchTraceRequest->KernelStatus = DEBUGGER_ERROR_INVALID_BRANCH_TRACE_REQUEST;
+            return FALSE;
+        }
+
+        NumberOfRecords = g_BranchTracingState.NumberOfRecords - BranchTraceRequest->StartIndex;
+
+        if (NumberOfRecords > MaximumBranchTraceRecordsPerRequest)
+        {
+            NumberOfRecords = MaximumBranchTraceRecordsPerRequest;
+        }
+
+        Records = (PDEBUGGER_BRANCH_TRACE_RECORD)((CHAR *)BranchTraceRequest + SIZEOF_DEBUGGER_BRANCH_TRACE_REQUEST);
+
+        RtlCopyMemory(Records,
+                      &g_BranchTracingState.Records[BranchTraceRequest->StartIndex],
+                      NumberOfRecords * sizeof(DEBUGGER_BRANCH_TRACE_RECORD));
+
+        //
+        // The branches are classified in the memory layout of the target
+        // process as the debuggee might be halted in another process, the
+        // flags (e.g., mispredicted) might be in the upper bits of the source
+        // (based on the format of the LBRs), so it's sign-extended
+        //
+        CurrentProcessCr3 = SwitchToProcessMemoryLayoutByCr3(g_BranchTracingState.ProcessCr3);
+
+        for (UINT32 i = 0; i < NumberOfRecords; i++)
+        {
+            Records[i].Type = BranchTracingClassifyBranch((UINT64)(((INT64)Records[i].From << 16) >> 16));
+        }
+
+        SwitchToPreviousProcess(CurrentProcessCr3);
+
+        BranchTraceRequest->NumberOfRecords = NumberOfRecords;
+        BranchTraceRequest->KernelStatus    = DEBUGGER_OPERATION_WAS_SUCCESSFUL;
+
+        return FALSE;
+
+    default:
+
+        BranchTraceRequest->KernelStatus = DEBUGGER_ERROR_INVALID_BRANCH_TRACE_REQUEST;
+        return FALSE;
+    }
+}
+
+/**
+ * @brief Check and handle the context switches for tracing the branches
+ * @details should be called in vmx-root mode, the context switches are
+ * detected by the debug register on gs:[188] (#DB)
+ *
+ * @param DbgState The state of the debugger on the current core
+ *
+ * @return BOOLEAN Shows whether the #DB is handled or not
+ */
+BOOLEAN
+BranchTracingCheckAndHandleDebugBreakpoint(PROCESSOR_DEBUGGING_STATE * DbgState)
+{
+    BOOLEAN IsFinished     = FALSE;
+    BOOLEAN IsTargetThread = FALSE;
+
+    //
+    // The exit qualification of #DBs shows the hit debug registers (B0-B3)
+    //
+    if (!DbgState->ThreadOrProcessTracingDetails.InitialSetBranchTracing ||
+        !(VmFuncGetExitQualification(DbgState->CoreId) & (1 << DEBUGGER_DEBUG_REGISTER_FOR_THREAD_MANAGEMENT)))
+    {
+        return FALSE;
+    }
+
+    IsTargetThread = BranchTracingIsTargetThread();
+
+    if (DbgState->ThreadOrProcessTracingDetails.IsTracingBranchesOnCore && !IsTargetThread)
+    {
+        //
+        // The target thread is switched out
+        //
+        IsFinished = BranchTracingDrainOnCore(DbgState);
+
+        BranchTracingStopOnCore(DbgState);
+    }
+    else if (!DbgState->ThreadOrProcessTracingDetails.IsTracingBranchesOnCore &&
+             IsTargetThread &&
+             g_BranchTracingState.IsActive)
+    {
+        //
+        // The target thread is switched in
+        //
+        BranchTracingStartOnCore(DbgState, TRUE);
+    }
+
+    if (IsFinished)
+    {
+        BranchTracingFinish(DbgState);
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Drain the branches of the target thread on the clock interrupts
+ * @details should be called in vmx-root mode
+ *
+ * @param DbgState The state of the debugger on the current core
+ *
+ * @return VOID
+ */
+VOID
+BranchTracingHandleClockInterrupt(PROCESSOR_DEBUGGING_STATE * DbgState)
+{
+    if (!DbgState->ThreadOrProcessTracingDetails.IsTracingBranchesOnCore)
+    {
+        return;
+    }
+
+    if (BranchTracingDrainOnCore(DbgState))
+    {
+        BranchTracingFinish(DbgState);
+    }
+}
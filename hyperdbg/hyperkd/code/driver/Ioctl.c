@@ -36,12 +36,14 @@ DrvDispatchIoControl(PDEVICE_OBJECT DeviceObject, PIRP Irp)
     PDEBUGGER_VA2PA_AND_PA2VA_COMMANDS                      DebuggerVa2paAndPa2vaRequest;
     PDEBUGGER_EDIT_MEMORY                                   DebuggerEditMemoryRequest;
     PDEBUGGER_SEARCH_MEMORY                                 DebuggerSearchMemoryRequest;
+    PDEBUGGER_SEARCH_MULTIPLE_PATTERNS                      DebuggerSearchMultiplePatternsRequest;
     PDEBUGGER_GENERAL_EVENT_DETAIL                          DebuggerNewEventRequest;
     PDEBUGGER_MODIFY_EVENTS                                 DebuggerModifyEventRequest;
     PDEBUGGER_FLUSH_LOGGING_BUFFERS                         DebuggerFlushBuffersRequest;
     PDEBUGGER_PREALLOC_COMMAND                              DebuggerReservePreallocPoolRequest;
     PDEBUGGER_PREACTIVATE_COMMAND                           DebuggerPreactivationRequest;
     PDEBUGGER_APIC_REQUEST                                  DebuggerApicRequest;
+    PDEBUGGER_PROFILER_REQUEST                              DebuggerProfilerRequest;
     PINTERRUPT_DESCRIPTOR_TABLE_ENTRIES_PACKETS             DebuggerQueryIdtRequest;
     PDEBUGGER_UD_COMMAND_PACKET                             DebuggerUdCommandRequest;
     PUSERMODE_LOADED_MODULE_DETAILS                         DebuggerUsermodeModulesRequest;
@@ -601,6 +603,50 @@ DrvDispatchIoControl(PDEVICE_OBJECT DeviceObject, PIRP Irp)
 
             break;
 
+        case IOCTL_DEBUGGER_SEARCH_MULTIPLE_PATTERNS:
+
+            //
+            // First validate the parameters.
+            //
+            if (IrpStack->Parameters.DeviceIoControl.InputBufferLength != SIZEOF_DEBUGGER_SEARCH_MULTIPLE_PATTERNS || Irp->AssociatedIrp.SystemBuffer == NULL)
+            {
+                Status = STATUS_INVALID_PARAMETER;
+                LogError("Err, invalid parameter to IOCTL dispatcher");
+                break;
+            }
+
+            OutBuffLength = IrpStack->Parameters.DeviceIoControl.OutputBufferLength;
+
+            //
+            // The OutBuffLength should have enough space to store the request
+            // and MaximumSearchMultiplePatternsResults results after it
+            //
+            if (OutBuffLength < SIZEOF_DEBUGGER_SEARCH_MULTIPLE_PATTERNS +
+                                    MaximumSearchMultiplePatternsResults * sizeof(DEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT))
+            {
+                Status = STATUS_INVALID_PARAMETER;
+                break;
+            }
+
+            DebuggerSearchMultiplePatternsRequest = (PDEBUGGER_SEARCH_MULTIPLE_PATTERNS)Irp->AssociatedIrp.SystemBuffer;
+
+            Status = DebuggerCommandSearchMultiplePatterns(DebuggerSearchMultiplePatternsRequest);
+
+            if (Status != STATUS_SUCCESS)
+            {
+                break;
+            }
+
+            Irp->IoStatus.Information = SIZEOF_DEBUGGER_SEARCH_MULTIPLE_PATTERNS +
+                                        DebuggerSearchMultiplePatternsRequest->NumberOfResults * sizeof(DEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT);
+
+            //
+            // Avoid zeroing it
+            //
+            DoNotChangeInformation = TRUE;
+
+            break;
+
         case IOCTL_DEBUGGER_MODIFY_EVENTS:
 
             //
@@ -1120,6 +1166,51 @@ DrvDispatchIoControl(PDEVICE_OBJECT DeviceObject, PIRP Irp)
 
             break;
 
+        case IOCTL_DEBUGGER_PROFILER:
+
+            //
+            // First validate the parameters.
+            //
+            if (IrpStack->Parameters.DeviceIoControl.InputBufferLength < SIZEOF_DEBUGGER_PROFILER_REQUEST || Irp->AssociatedIrp.SystemBuffer == NULL)
+            {
+                Status = STATUS_INVALID_PARAMETER;
+                LogError("Err, invalid parameter to IOCTL dispatcher");
+                break;
+            }
+
+            OutBuffLength = IrpStack->Parameters.DeviceIoControl.OutputBufferLength;
+
+            //
+            // Both usermode and to send to usermode and the coming buffer are
+            // at the same place
+            //
+            DebuggerProfilerRequest = (PDEBUGGER_PROFILER_REQUEST)Irp->AssociatedIrp.SystemBuffer;
+
+            //
+            // The OutBuffLength should have enough space to store the request
+            // and MaximumProfilerSamplesPerRequest samples after it
+            //
+            if (OutBuffLength < SIZEOF_DEBUGGER_PROFILER_REQUEST ||
+                (DebuggerProfilerRequest->RequestType == DEBUGGER_PROFILER_REQUEST_READ_SAMPLES &&
+                 OutBuffLength < SIZEOF_DEBUGGER_PROFILER_REQUEST + MaximumProfilerSamplesPerRequest * sizeof(DEBUGGER_PROFILER_SAMPLE)))
+            {
+                Status = STATUS_INVALID_PARAMETER;
+                break;
+            }
+
+            //
+            // Perform the actions relating to the profiler request
+            //
+            Irp->IoStatus.Information = ExtensionCommandPerformProfilerRequest(DebuggerProfilerRequest);
+            Status                    = STATUS_SUCCESS;
+
+            //
+            // Avoid zeroing it
+            //
+            DoNotChangeInformation = TRUE;
+
+            break;
+
         case IOCTL_QUERY_IDT_ENTRY:
 
             //
@@ -56,10 +56,34 @@ DebuggerCommandReservePreallocatedPools(PDEBUGGER_PREALLOC_COMMAND PreallocReque
 NTSTATUS
 DebuggerCommandPreactivateFunctionality(PDEBUGGER_PREACTIVATE_COMMAND PreactivateRequest);
 
+BOOLEAN
+SearchMultiplePatternsReadChunk(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS SearchRequest,
+                                UINT64                             Address,
+                                PVOID                              Buffer,
+                                UINT32                             Size,
+                                PVOID                              Context);
+
+NTSTATUS
+DebuggerCommandSearchMultiplePatterns(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS SearchRequest);
+
+BOOLEAN
+SearchMultiplePatternsResume(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS        SearchRequest,
+                             PSEARCH_MULTIPLE_PATTERNS_AUTOMATON       Automaton,
+                             PDEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT Results,
+                             BOOLEAN                                   IsDebuggeePaused,
+                             PKD_CURSOR                                Cursor);
+
+BOOLEAN
+SearchMultiplePatterns(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS        SearchRequest,
+                       PSEARCH_MULTIPLE_PATTERNS_AUTOMATON       Automaton,
+                       PDEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT Results);
+
 BOOLEAN
 SearchAddressWrapper(PUINT64                 AddressToSaveResults,
                      PDEBUGGER_SEARCH_MEMORY SearchMemRequest,
                      UINT64                  StartAddress,
                      UINT64                  EndAddress,
                      BOOLEAN                 IsDebuggeePaused,
-                     PUINT32                 CountOfMatchedCases);
+                     PUINT32                 CountOfMatchedCases,
+                     PKD_CURSOR              Cursor,
+                     PUINT64                 NextAddress);
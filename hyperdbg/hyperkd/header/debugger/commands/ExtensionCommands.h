@@ -11,6 +11,16 @@
  */
 #pragma once
 
+//////////////////////////////////////////////////
+//				      Locks 	    			//
+//////////////////////////////////////////////////
+
+/**
+ * @brief The lock for serializing the requests of the profiler
+ *
+ */
+volatile LONG ExtensionCommandProfilerLock;
+
 //////////////////////////////////////////////////
 //				     Functions		      		//
 //////////////////////////////////////////////////
@@ -95,3 +105,6 @@ ExtensionCommandPcitree(PDEBUGGEE_PCITREE_REQUEST_RESPONSE_PACKET PcitreePacket,
 
 VOID
 ExtensionCommandPcidevinfo(PDEBUGGEE_PCIDEVINFO_REQUEST_RESPONSE_PACKET PcidevinfoPacket, BOOLEAN OperateOnVmxRoot);
+
+UINT32
+ExtensionCommandPerformProfilerRequest(PDEBUGGER_PROFILER_REQUEST ProfilerRequest);
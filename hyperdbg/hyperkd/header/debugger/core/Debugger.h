@@ -97,6 +97,24 @@ typedef struct _DEBUGGER_EVENT_ACTION
 
 } DEBUGGER_EVENT_ACTION, *PDEBUGGER_EVENT_ACTION;
 
+/* ==============================================================================================
+ */
+
+/**
+ * @brief The sampling and rate limiting state of events
+ * @details The rate budget is on the time stamp counter
+ *
+ */
+typedef struct _DEBUGGER_EVENT_THROTTLE_STATE
+{
+    DEBUGGER_EVENT_THROTTLE_OPTIONS Options;
+    BOOLEAN                         IsThrottled;    // whether any of the sampling or rate limiting options is set
+    volatile LONG64                 NumberOfHits;   // hits that passed the filters (for 1-in-N sampling)
+    THROTTLE_RATE                   Rate;           // the rate budget of the event
+    volatile LONG64                 SuppressedHits; // total hits that are suppressed on all cores
+
+} DEBUGGER_EVENT_THROTTLE_STATE, *PDEBUGGER_EVENT_THROTTLE_STATE;
+
 /* ==============================================================================================
  */
 
@@ -130,6 +148,8 @@ typedef struct _DEBUGGER_EVENT
 
     DEBUGGER_EVENT_OPTIONS Options; // The options of the event (used when event is applied in the debugger)
 
+    DEBUGGER_EVENT_THROTTLE_STATE Throttle; // Sampling and rate limiting state of the event
+
     UINT32 ConditionsBufferSize;   // if null, means uncoditional
     PVOID  ConditionBufferAddress; // Address of the condition buffer (most of the
                                    // time at the end of this buffer)
@@ -186,6 +186,13 @@
  */
 #define DEBUGGER_HALTED_CORE_TASK_DISABLE_MOV_TO_CR_EXITING_ONLY_FOR_CR_EVENTS 0x0000001c
 
+/**
+ * @brief Halted core task for enabling or disabling the LBR
+ * for tracing the branches (!track lbr)
+ *
+ */
+#define DEBUGGER_HALTED_CORE_TASK_SET_BRANCH_TRACING 0x0000001d
+
 //////////////////////////////////////////////////
 //			    	 Functions  	      		//
 //////////////////////////////////////////////////
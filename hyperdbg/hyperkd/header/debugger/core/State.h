@@ -62,6 +62,14 @@ typedef struct _DEBUGGEE_PROCESS_OR_THREAD_TRACING_DETAILS
     BOOLEAN IsWatingForMovCr3VmExits;
     BOOLEAN InterceptClockInterruptsForProcessChange;
 
+    //
+    // For tracing the branches of a thread
+    //
+    BOOLEAN InitialSetBranchTracing;                  // context switches are detected for tracing the branches
+    BOOLEAN IsTracingBranchesOnCore;                  // the traced thread is running on this core (LBR is enabled)
+    BOOLEAN InterceptClockInterruptsForBranchTracing; // the branches are drained on the clock interrupts
+    BOOLEAN IsBranchTracingThreadResumed;             // the next drained branch is the first branch after the context switch
+
 } DEBUGGEE_PROCESS_OR_THREAD_TRACING_DETAILS, *PDEBUGGEE_PROCESS_OR_THREAD_TRACING_DETAILS;
 
 /**
@@ -155,6 +163,81 @@ typedef struct _DATE_TIME_HOLDER
 
 } DATE_TIME_HOLDER, *PDATE_TIME_HOLDER;
 
+/**
+ * @brief Number of pseudo-registers that are memoized for each event
+ * @details Pseudo-registers from $pid up to $teb (see PSEUDO_REGISTER_*),
+ * $ip is not memoized as it might be changed by the script itself
+ *
+ */
+#define PSEUDO_REGISTERS_MEMO_COUNT (PSEUDO_REGISTER_TEB + 1)
+
+/**
+ * @brief Bit of the valid mask of the memo for the interned id of $pname
+ *
+ */
+#define PSEUDO_REGISTERS_MEMO_PNAME_ID PSEUDO_REGISTERS_MEMO_COUNT
+
+/**
+ * @brief Pseudo-registers that are resolved once for each event
+ * @details The values are only valid for the thread that is saved in
+ * OwnerThread and they are discarded each time the events are triggered
+ *
+ */
+typedef struct _PSEUDO_REGISTERS_MEMO
+{
+    UINT32 ValidMask;
+    PVOID  OwnerThread;
+    UINT64 Values[PSEUDO_REGISTERS_MEMO_COUNT];
+    UINT64 PnameId[2]; // interned id of $pname (see ScriptEnginePseudoRegGetPnameId)
+
+} PSEUDO_REGISTERS_MEMO, *PPSEUDO_REGISTERS_MEMO;
+
+/**
+ * @brief Maximum number of 'all' stage events that their pre-event is
+ * suppressed by the throttling options on a single core
+ *
+ */
+#define EVENT_THROTTLE_MAXIMUM_SUPPRESSED_PRE_EVENTS 4
+
+/**
+ * @brief Maximum number of exiting bits (MSR and I/O bitmaps) that are
+ * disarmed by the throttling options on a single core
+ *
+ */
+#define EVENT_THROTTLE_MAXIMUM_DISARMED_EXITINGS 8
+
+/**
+ * @brief An exiting bit that is cleared until the rate budget of the
+ * event is refilled
+ *
+ */
+typedef struct _EVENT_THROTTLE_DISARMED_EXITING
+{
+    UINT64              EventTag;
+    VMM_EVENT_TYPE_ENUM EventType;
+    UINT32              Target;    // MSR or I/O port
+    UINT64              RearmTime; // Time stamp counter of re-arming the exiting bit
+
+} EVENT_THROTTLE_DISARMED_EXITING, *PEVENT_THROTTLE_DISARMED_EXITING;
+
+/**
+ * @brief Throttling state of the events on each core
+ * @details The counters are only written by the owner core, the disarmed
+ * exitings are also read by the re-arming worker (under the lock)
+ *
+ */
+typedef struct _PROCESSOR_EVENT_THROTTLE_STATE
+{
+    UINT64                          SuppressedHits;
+    UINT64                          RandomState;
+    UINT32                          NumberOfSuppressedPreEvents;
+    PVOID                           SuppressedPreEvents[EVENT_THROTTLE_MAXIMUM_SUPPRESSED_PRE_EVENTS];
+    volatile LONG                   DisarmedExitingsLock;
+    UINT32                          NumberOfDisarmedExitings;
+    EVENT_THROTTLE_DISARMED_EXITING DisarmedExitings[EVENT_THROTTLE_MAXIMUM_DISARMED_EXITINGS];
+
+} PROCESSOR_EVENT_THROTTLE_STATE, *PPROCESSOR_EVENT_THROTTLE_STATE;
+
 /**
  * @brief Saves the debugger state
  * @details Each logical processor contains one of this structure which describes about the
@@ -182,6 +265,8 @@ typedef struct _PROCESSOR_DEBUGGING_STATE
     UINT16                                     InstructionLengthHint;
     UINT64                                     HardwareDebugRegisterForStepping;
     UINT64 *                                   ScriptEngineCoreSpecificStackBuffer;
+    PSEUDO_REGISTERS_MEMO                      PseudoRegistersMemo;
+    PROCESSOR_EVENT_THROTTLE_STATE             EventThrottle;
     PKDPC                                      KdDpcObject;                       // DPC object to be used in kernel debugger
     CHAR                                       KdRecvBuffer[MaxSerialPacketSize]; // Used for debugging buffers (receiving buffers from serial devices)
 
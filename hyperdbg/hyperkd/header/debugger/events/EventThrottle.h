@@ -0,0 +1,70 @@
+/**
+ * @file EventThrottle.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of sampling and rate limiting of the events
+ * @details
+ * @version 0.11
+ * @date 2024-10-31
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//				   Constants					//
+//////////////////////////////////////////////////
+
+/**
+ * @brief The interval of checking for the disarmed exiting bits
+ * that should be re-armed (in milliseconds)
+ *
+ */
+#define EVENT_THROTTLE_REARM_INTERVAL 10
+
+/**
+ * @brief The duration of calibrating the time stamp counter against
+ * the performance counter (in microseconds)
+ *
+ */
+#define EVENT_THROTTLE_TSC_CALIBRATION_DURATION 1000
+
+//////////////////////////////////////////////////
+//				   Functions					//
+//////////////////////////////////////////////////
+
+static UINT64
+EventThrottleCalibrateTsc();
+
+static BOOLEAN
+EventThrottleIsExitingShared(PDEBUGGER_EVENT Event, UINT32 CoreId, UINT32 Target);
+
+static VOID
+EventThrottleDisarmExiting(PROCESSOR_DEBUGGING_STATE * DbgState, PDEBUGGER_EVENT Event, UINT32 Target, UINT64 RearmTime);
+
+static VOID
+EventThrottleRearmExitings();
+
+static VOID
+EventThrottleRearmWorker(PVOID Context);
+
+BOOLEAN
+EventThrottleInitialize();
+
+VOID
+EventThrottleUninitialize();
+
+BOOLEAN
+EventThrottleValidateOptions(PDEBUGGER_GENERAL_EVENT_DETAIL EventDetails);
+
+VOID
+EventThrottleSetOptions(PDEBUGGER_EVENT Event, DEBUGGER_EVENT_THROTTLE_OPTIONS * Options);
+
+BOOLEAN
+EventThrottleIsHitSuppressed(PROCESSOR_DEBUGGING_STATE *          DbgState,
+                             PDEBUGGER_EVENT                       Event,
+                             VMM_CALLBACK_EVENT_CALLING_STAGE_TYPE CallingStage,
+                             PVOID                                 Context);
+
+BOOLEAN
+EventThrottleQuerySuppressedHits(PDEBUGGER_MODIFY_EVENTS QueryRequest);
@@ -161,6 +161,38 @@ KdCheckTargetCoreIsLocked(UINT32 CoreNumber);
 static BOOLEAN
 KdPerformEventQueryAndModification(PDEBUGGER_MODIFY_EVENTS ModifyAndQueryEvent);
 
+static UINT32
+KdPerformSearchMultiplePatterns(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS SearchPacket, UINT32 SearchPacketSize);
+
+VOID
+KdPerformSearchMemory(PDEBUGGER_SEARCH_MEMORY SearchPacket, PDEBUGGEE_RESULT_OF_SEARCH_PACKET SearchResult);
+
+static BOOLEAN
+KdBatchReadMemory(PDEBUGGER_READ_MEMORY ReadMemRequest, UCHAR * TargetBuffer, UINT32 * ReturnSize, PVOID Context);
+
+static VOID
+KdBatchEditMemory(PDEBUGGER_EDIT_MEMORY EditMemRequest, PVOID Context);
+
+static BOOLEAN
+KdBatchReadRegister(PDEBUGGEE_REGISTER_READ_DESCRIPTION ReadRegisterRequest, PVOID Context);
+
+static BOOLEAN
+KdBatchWriteRegister(UINT32 RegisterId, UINT64 Value, PVOID Context);
+
+static VOID
+KdBatchSetBreakpoint(PDEBUGGEE_BP_PACKET BpRequest, PVOID Context);
+
+static VOID
+KdBatchModifyBreakpoint(PDEBUGGEE_BP_LIST_OR_MODIFY_PACKET BpModifyRequest, PVOID Context);
+
+static VOID
+KdBatchPagein(PDEBUGGER_PAGE_IN_REQUEST PageinRequest, PVOID Context);
+
+static UINT32
+KdPerformBatchOperations(PROCESSOR_DEBUGGING_STATE * DbgState,
+                         PDEBUGGEE_BATCH_PACKET      BatchPacket,
+                         UINT32                      BatchPacketSize);
+
 static VOID
 KdDispatchAndPerformCommandsFromDebugger(PROCESSOR_DEBUGGING_STATE * DbgState);
 
@@ -0,0 +1,80 @@
+/**
+ * @file BranchTracing.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers for tracing the branches of a thread (LBR)
+ * @details
+ * @version 0.11
+ * @date 2024-11-08
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//				   Structures					//
+//////////////////////////////////////////////////
+
+/**
+ * @brief The state of tracing the branches of the target thread
+ * @details the LBR is only enabled on the core that runs the target thread,
+ * the records are drained from the cores under the lock (e.g., when all
+ * cores are halted at the same time)
+ *
+ */
+typedef struct _BRANCH_TRACING_STATE
+{
+    volatile LONG                 Lock;
+    volatile BOOLEAN              IsActive; // branches of the target thread are recorded
+    UINT32                        ProcessId;
+    UINT32                        ThreadId;
+    CR3_TYPE                      ProcessCr3;       // for reading the instructions of the branches
+    BOOLEAN                       IsUsermode32Bit;  // the target thread is a 32-bit user-mode thread
+    UINT32                        NumberOfBranches; // stop after tracing this number of branches
+    UINT32                        NumberOfRecords;
+    UINT32                        LbrFormat;
+    UINT32                        DrainPoints;    // DEBUGGER_BRANCH_TRACE_DRAIN_*
+    PDEBUGGER_BRANCH_TRACE_RECORD Records;        // MaximumBranchTraceRecords records
+    CHAR *                        ResponseBuffer; // the request and MaximumBranchTraceRecordsPerRequest records
+
+} BRANCH_TRACING_STATE, *PBRANCH_TRACING_STATE;
+
+//////////////////////////////////////////////////
+//				   Functions					//
+//////////////////////////////////////////////////
+
+static BOOLEAN
+BranchTracingIsTargetThread();
+
+static UINT32
+BranchTracingClassifyBranch(UINT64 Address);
+
+static BOOLEAN
+BranchTracingDrainOnCore(PROCESSOR_DEBUGGING_STATE * DbgState);
+
+static VOID
+BranchTracingStartOnCore(PROCESSOR_DEBUGGING_STATE * DbgState, BOOLEAN IsResumed);
+
+static VOID
+BranchTracingStopOnCore(PROCESSOR_DEBUGGING_STATE * DbgState);
+
+static VOID
+BranchTracingFinish(PROCESSOR_DEBUGGING_STATE * DbgState);
+
+BOOLEAN
+BranchTracingInitialize();
+
+VOID
+BranchTracingUninitialize();
+
+VOID
+BranchTracingEnableOrDisableOnCore(PROCESSOR_DEBUGGING_STATE * DbgState, BOOLEAN Enable);
+
+BOOLEAN
+BranchTracingPerformRequest(PROCESSOR_DEBUGGING_STATE * DbgState, PDEBUGGER_BRANCH_TRACE_REQUEST BranchTraceRequest);
+
+BOOLEAN
+BranchTracingCheckAndHandleDebugBreakpoint(PROCESSOR_DEBUGGING_STATE * DbgState);
+
+VOID
+BranchTracingHandleClockInterrupt(PROCESSOR_DEBUGGING_STATE * DbgState);
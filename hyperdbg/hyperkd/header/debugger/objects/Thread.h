@@ -28,6 +28,10 @@ ThreadEnableOrDisableThreadChangeMonitor(PROCESSOR_DEBUGGING_STATE * DbgState,
 BOOLEAN
 ThreadHandleThreadChange(PROCESSOR_DEBUGGING_STATE * DbgState);
 
+VOID
+ThreadDetectChangeByDebugRegisterOnGs(PROCESSOR_DEBUGGING_STATE * DbgState,
+                                      BOOLEAN                     Enable);
+
 BOOLEAN
 ThreadQueryCount(PDEBUGGER_QUERY_ACTIVE_PROCESSES_OR_THREADS DebuggerUsermodeProcessOrThreadQueryRequest);
 
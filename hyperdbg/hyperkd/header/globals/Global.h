@@ -22,6 +22,42 @@ PROCESSOR_DEBUGGING_STATE * g_DbgState;
  */
 UINT64 * g_ScriptGlobalVariables;
 
+/**
+ * @brief Holder of the result of batch operations
+ * @details only the halted core that communicates with the debugger
+ * uses this buffer
+ *
+ */
+CHAR * g_KdBatchResponseBuffer;
+
+/**
+ * @brief Automaton of the multi-pattern search that is performed
+ * while the debuggee is halted
+ *
+ */
+PSEARCH_MULTIPLE_PATTERNS_AUTOMATON g_KdSearchAutomaton;
+
+/**
+ * @brief Holder of the result of the multi-pattern search that is
+ * performed while the debuggee is halted
+ *
+ */
+CHAR * g_KdSearchResponseBuffer;
+
+/**
+ * @brief Cursor of the multi-pattern search that is performed while
+ * the debuggee is halted
+ *
+ */
+KD_CURSOR g_KdSearchCursor;
+
+/**
+ * @brief Cursor of the memory search (s*) that is performed while
+ * the debuggee is halted
+ *
+ */
+KD_CURSOR g_KdSearchMemoryCursor;
+
 /**
  * @brief State of the trap-flag
  *
@@ -164,3 +200,34 @@ BOOLEAN g_IsWaitingForUserModeProcessEntryToBeCalled;
  *
  */
 BOOLEAN g_InterceptBreakpointsAndEventsForCommandsInRemoteComputer;
+
+/**
+ * @brief Ticks of the time stamp counter in each second (used for
+ * rate limiting the events and the sampling period of the profiler)
+ *
+ */
+UINT64 g_TscFrequency;
+
+/**
+ * @brief Set when an exiting bit is disarmed by the throttled events
+ *
+ */
+volatile BOOLEAN g_EventThrottleIsRearmRequested;
+
+/**
+ * @brief The thread object of the worker that re-arms the throttled events
+ *
+ */
+PVOID g_EventThrottleWorkerThread;
+
+/**
+ * @brief Set to stop the worker that re-arms the throttled events
+ *
+ */
+volatile BOOLEAN g_EventThrottleWorkerStopRequested;
+
+/**
+ * @brief The state of tracing the branches of a thread (!track lbr)
+ *
+ */
+BRANCH_TRACING_STATE g_BranchTracingState;
@@ -93,6 +93,26 @@
 #include "components/optimizations/header/BinarySearch.h"
 #include "components/optimizations/header/InsertionSort.h"
 
+//
+// Resumable operations (cursor) component
+//
+#include "components/cursor/header/KdCursor.h"
+
+//
+// Multi-pattern search component
+//
+#include "components/search/header/MultiPatternSearch.h"
+
+//
+// Sampling and rate limiting component
+//
+#include "components/throttle/header/Throttle.h"
+
+//
+// Batch operations component
+//
+#include "components/batch/header/BatchOperations.h"
+
 //
 // Debugger Types
 //
@@ -145,7 +165,9 @@
 #include "header/debugger/events/Termination.h"
 #include "header/debugger/events/DebuggerEvents.h"
 #include "header/debugger/events/ValidateEvents.h"
+#include "header/debugger/events/EventThrottle.h"
 #include "header/debugger/meta-events/Tracing.h"
+#include "header/debugger/meta-events/BranchTracing.h"
 #include "header/debugger/meta-events/MetaDispatch.h"
 
 //
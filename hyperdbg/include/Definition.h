@@ -84,6 +84,23 @@
  */
 #define TEST_CASE_PARAMETER_FOR_SCRIPT_SEMANTIC_TEST_CASES "test-script-semantic-test-cases"
 
+/**
+ * @brief Test case parameter for running the unit tests (optionally
+ * followed by the name of a unit test)
+ */
+#define TEST_CASE_PARAMETER_FOR_UNIT_TESTS "test-unit-tests"
+
+/**
+ * @brief Test case parameter for running the benchmarks (optionally
+ * followed by the name of a unit test)
+ */
+#define TEST_CASE_PARAMETER_FOR_BENCHMARKS "test-benchmarks"
+
+/**
+ * @brief Test case parameter for showing the list of the unit tests
+ */
+#define TEST_CASE_PARAMETER_FOR_UNIT_TESTS_LIST "test-unit-tests-list"
+
 /**
  * @brief Test cases file name
  */
@@ -109,6 +126,25 @@
  */
 #define HWDBG_SCRIPT_TEST_CASE_SAMPLE_TESTS_DIRECTORY "..\\..\\..\\tests\\hwdbg-tests\\scripts\\sample-tests"
 
+/**
+ * @brief Name of the module that is resolved by the tests of the compiled
+ * scripts (e.g., 'testmod!func_1230')
+ *
+ */
+#define SCRIPT_ENGINE_TEST_MODULE_NAME "testmod"
+
+/**
+ * @brief Base of the test module while parsing the test scripts
+ *
+ */
+#define SCRIPT_ENGINE_TEST_MODULE_PARSE_BASE 0xfffff80000000000
+
+/**
+ * @brief Base of the test module while loading the compiled test scripts
+ *
+ */
+#define SCRIPT_ENGINE_TEST_MODULE_LOAD_BASE 0xfffff80123450000
+
 //////////////////////////////////////////////////
 //				Delay Speeds                    //
 //////////////////////////////////////////////////
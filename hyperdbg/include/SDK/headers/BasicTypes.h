@@ -111,16 +111,35 @@ typedef struct GUEST_EXTRA_REGISTERS
     UINT64 RIP;
 } GUEST_EXTRA_REGISTERS, *PGUEST_EXTRA_REGISTERS;
 
+/**
+ * @brief Number of registers that are kept in the registers snapshot
+ * of the script engine
+ *
+ */
+#define SCRIPT_ENGINE_REGISTERS_SNAPSHOT_COUNT 23
+
+/**
+ * @brief Registers (segment selectors, RFLAGS, RIP, descriptor table,
+ * control and debug registers) that are read at most once per script run
+ *
+ */
+typedef struct _SCRIPT_ENGINE_REGISTERS_SNAPSHOT
+{
+    UINT32 ValidMask;
+    UINT64 Registers[SCRIPT_ENGINE_REGISTERS_SNAPSHOT_COUNT];
+} SCRIPT_ENGINE_REGISTERS_SNAPSHOT, *PSCRIPT_ENGINE_REGISTERS_SNAPSHOT;
+
 /**
  * @brief List of different variables
  */
 typedef struct _SCRIPT_ENGINE_GENERAL_REGISTERS
 {
-    UINT64 * StackBuffer;
-    UINT64 * GlobalVariablesList;
-    UINT64   StackIndx;
-    UINT64   StackBaseIndx;
-    UINT64   ReturnValue;
+    UINT64 *                         StackBuffer;
+    UINT64 *                         GlobalVariablesList;
+    UINT64                           StackIndx;
+    UINT64                           StackBaseIndx;
+    UINT64                           ReturnValue;
+    SCRIPT_ENGINE_REGISTERS_SNAPSHOT RegistersSnapshot;
 } SCRIPT_ENGINE_GENERAL_REGISTERS, *PSCRIPT_ENGINE_GENERAL_REGISTERS;
 
 /**
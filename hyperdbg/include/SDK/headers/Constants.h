@@ -193,6 +193,13 @@ const unsigned char BuildSignature[] = {
  */
 #define MaxSerialPacketSize 20 * NORMAL_PAGE_SIZE
 
+/**
+ * @brief maximum size of a batch of operations (and its result)
+ * @details one page of the serial packet is kept for the headers
+ *
+ */
+#define MaxBatchPacketSize (MaxSerialPacketSize - NORMAL_PAGE_SIZE)
+
 /**
  * @brief Final storage size of message tracing
  *
@@ -275,6 +282,14 @@ const unsigned char BuildSignature[] = {
  */
 #define MAXIMUM_BIG_INSTANT_EVENTS 0
 
+/**
+ * @brief Low watermark of the pre-allocated (regular) instant events
+ * @details once the number of free buffers drops to this value, they are
+ * refilled up to MAXIMUM_REGULAR_INSTANT_EVENTS in the background
+ *
+ */
+#define REGULAR_INSTANT_EVENTS_LOW_WATERMARK 5
+
 /**
  * @brief Pre-allocated size for a regular event + conditions buffer
  *
@@ -513,6 +528,74 @@ const unsigned char BuildSignature[] = {
  */
 #define MaximumSearchResults 0x1000
 
+/**
+ * @brief maximum number of patterns of the multi-pattern search
+ * (sm !sm commands)
+ *
+ */
+#define MaximumSearchPatterns 16
+
+/**
+ * @brief maximum length of each pattern of the multi-pattern search
+ *
+ */
+#define MaximumSearchPatternLength 32
+
+/**
+ * @brief maximum number of ranges of the multi-pattern search
+ *
+ */
+#define MaximumSearchRanges 16
+
+/**
+ * @brief maximum results that will be returned by the multi-pattern
+ * search (sm !sm commands)
+ *
+ */
+#define MaximumSearchMultiplePatternsResults 0x400
+
+/**
+ * @brief maximum number of stack entries that are recorded for each
+ * sample of the profiler (!profile command)
+ *
+ */
+#define MaximumProfilerStackDepth 8
+
+/**
+ * @brief maximum number of samples that are returned for each request
+ * of reading the samples of the profiler
+ *
+ */
+#define MaximumProfilerSamplesPerRequest 0x200
+
+/**
+ * @brief default sampling frequency of the profiler (samples per
+ * second on each core)
+ *
+ */
+#define DefaultProfilerSamplingFrequency 1000
+
+/**
+ * @brief maximum sampling frequency of the profiler (samples per
+ * second on each core)
+ *
+ */
+#define MaximumProfilerSamplingFrequency 100000
+
+/**
+ * @brief maximum number of branches that are recorded by the branch
+ * tracing (LBR) backend of the '!track' command
+ *
+ */
+#define MaximumBranchTraceRecords 0x4000
+
+/**
+ * @brief maximum number of branch records that are returned for each
+ * request of reading the records of the branch tracing
+ *
+ */
+#define MaximumBranchTraceRecordsPerRequest 0x800
+
 //////////////////////////////////////////////////
 //                 Script Engine                //
 //////////////////////////////////////////////////
@@ -626,6 +709,14 @@ const unsigned char BuildSignature[] = {
  */
 #define DEBUGGER_EVENT_MSR_READ_OR_WRITE_ALL_MSRS 0xffffffff
 
+/**
+ * @brief The scale of the sampling probability of the events
+ * @details 10000 means 100%, thus the probability has two
+ * fractional digits (e.g., 1250 is 12.50%)
+ *
+ */
+#define DEBUGGER_EVENT_THROTTLE_PROBABILITY_SCALE 10000
+
 /**
  * @brief Apply to all first 32 exceptions
  *
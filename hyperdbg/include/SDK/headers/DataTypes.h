@@ -44,6 +44,9 @@ typedef enum _POOL_ALLOCATION_INTENTION
     DETOUR_HOOK_DETAILS,
     BREAKPOINT_DEFINITION_STRUCTURE,
     PROCESS_THREAD_HOLDER,
+    SUB_PAGE_PERMISSION_TABLE,
+    EPT_VIEW_PAGING_STRUCTURE,
+    MONITOR_RANGE_DESCRIPTOR,
 
     //
     // Instant event buffers
@@ -59,6 +62,11 @@ typedef enum _POOL_ALLOCATION_INTENTION
     INSTANT_REGULAR_SAFE_BUFFER_FOR_EVENTS,
     INSTANT_BIG_SAFE_BUFFER_FOR_EVENTS,
 
+    //
+    // Number of the intentions (should be the last item)
+    //
+    POOL_ALLOCATION_INTENTION_COUNT,
+
 } POOL_ALLOCATION_INTENTION;
 
 //////////////////////////////////////////////////
@@ -107,6 +115,7 @@ typedef enum _DEBUGGER_THREAD_PROCESS_TRACING
     DEBUGGER_THREAD_PROCESS_TRACING_INTERCEPT_CLOCK_INTERRUPTS_FOR_PROCESS_CHANGE,
     DEBUGGER_THREAD_PROCESS_TRACING_INTERCEPT_CLOCK_DEBUG_REGISTER_INTERCEPTION,
     DEBUGGER_THREAD_PROCESS_TRACING_INTERCEPT_CLOCK_WAITING_FOR_MOV_CR3_VM_EXITS,
+    DEBUGGER_THREAD_PROCESS_TRACING_INTERCEPT_CLOCK_INTERRUPTS_FOR_BRANCH_TRACING,
 
 } DEBUGGER_THREAD_PROCESS_TRACING;
 
@@ -551,6 +551,75 @@
  */
 #define DEBUGGER_ERROR_DEBUGGER_ALREADY_UNHIDE 0xc0000054
 
+/**
+ * @brief error, the operation of the batch is invalid or doesn't
+ * fit in the batch
+ *
+ */
+#define DEBUGGER_ERROR_INVALID_BATCH_OPERATION 0xc0000055
+
+/**
+ * @brief error, the patterns or the ranges of the multi-pattern
+ * search are invalid
+ *
+ */
+#define DEBUGGER_ERROR_INVALID_SEARCH_PATTERNS 0xc0000056
+
+/**
+ * @brief error, the continuation token of the resumable operation is
+ * invalid (e.g., the operation is finished, cancelled, or the debuggee
+ * is continued)
+ *
+ */
+#define DEBUGGER_ERROR_INVALID_CONTINUATION_TOKEN 0xc0000057
+
+/**
+ * @brief error, the maximum number of the monitored physical ranges
+ * is reached
+ *
+ */
+#define DEBUGGER_ERROR_MAXIMUM_MONITOR_RANGES_IS_HIT 0xc0000058
+
+/**
+ * @brief error, the sampling or rate limiting options of the event
+ * are invalid
+ *
+ */
+#define DEBUGGER_ERROR_INVALID_EVENT_THROTTLING_OPTIONS 0xc0000059
+
+/**
+ * @brief error, the processor doesn't support the VMX-preemption timer
+ * which is needed by the profiler
+ *
+ */
+#define DEBUGGER_ERROR_PROFILER_IS_NOT_SUPPORTED 0xc000005a
+
+/**
+ * @brief error, the profiler is already running
+ *
+ */
+#define DEBUGGER_ERROR_PROFILER_IS_ALREADY_RUNNING 0xc000005b
+
+/**
+ * @brief error, the options of the profiler are invalid or the buffers
+ * of the profiler are not allocated
+ *
+ */
+#define DEBUGGER_ERROR_INVALID_PROFILER_OPTIONS 0xc000005c
+
+/**
+ * @brief error, the processor doesn't support the last branch records
+ * (LBR) that are used for branch tracing
+ *
+ */
+#define DEBUGGER_ERROR_BRANCH_TRACE_NOT_SUPPORTED 0xc000005d
+
+/**
+ * @brief error, the request of the branch tracing is invalid
+ *
+ */
+#define DEBUGGER_ERROR_INVALID_BRANCH_TRACE_REQUEST 0xc000005e
+
 //
 // WHEN YOU ADD ANYTHING TO THIS LIST OF ERRORS, THEN
 // MAKE SURE TO ADD AN ERROR MESSAGE TO ShowErrorMessage(UINT32 Error)
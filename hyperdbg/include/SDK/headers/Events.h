@@ -232,6 +232,7 @@ typedef enum _DEBUGGER_MODIFY_EVENTS_TYPE
     DEBUGGER_MODIFY_EVENTS_ENABLE,
     DEBUGGER_MODIFY_EVENTS_DISABLE,
     DEBUGGER_MODIFY_EVENTS_CLEAR,
+    DEBUGGER_MODIFY_EVENTS_QUERY_SUPPRESSED_HITS,
 } DEBUGGER_MODIFY_EVENTS_TYPE;
 
 /**
@@ -243,8 +244,10 @@ typedef struct _DEBUGGER_MODIFY_EVENTS
     UINT64 Tag;          // Tag of the target event that we want to modify
     UINT64 KernelStatus; // Kernel put the status in this field
     DEBUGGER_MODIFY_EVENTS_TYPE
-    TypeOfAction;      // Determines what's the action (enable | disable | clear)
-    BOOLEAN IsEnabled; // Determines what's the action (enable | disable | clear)
+    TypeOfAction;           // Determines what's the action (enable | disable | clear)
+    BOOLEAN IsEnabled;      // Determines what's the action (enable | disable | clear)
+    UINT32  CoreId;         // Target core of querying suppressed hits (if the tag is DEBUGGER_MODIFY_EVENTS_APPLY_TO_ALL_TAG)
+    UINT64  SuppressedHits; // Kernel put the number of hits that are suppressed by the throttling options in this field
 
 } DEBUGGER_MODIFY_EVENTS, *PDEBUGGER_MODIFY_EVENTS;
 
@@ -278,6 +281,23 @@ typedef struct _DEBUGGER_EVENT_OPTIONS
 
 } DEBUGGER_EVENT_OPTIONS, *PDEBUGGER_EVENT_OPTIONS;
 
+/**
+ * @brief Sampling and rate limiting options of the events
+ * @details These options are evaluated before the conditions and the
+ * actions of the event, sampling is applied first and the sampled hits
+ * are then charged against the rate limit
+ *
+ */
+typedef struct _DEBUGGER_EVENT_THROTTLE_OPTIONS
+{
+    UINT32  SampleEveryNthHit;           // Run the actions once every N hits (0 or 1 means every hit)
+    UINT32  SampleProbability;           // Probability of running the actions out of DEBUGGER_EVENT_THROTTLE_PROBABILITY_SCALE (0 means every hit)
+    UINT32  MaximumHitsPerSecond;        // Maximum rate of running the actions (0 means unlimited)
+    UINT32  BurstSize;                   // Number of hits that are allowed back-to-back before the rate applies (0 means 1)
+    BOOLEAN DisableExitingWhenThrottled; // Clear the exiting bit of the MSR or I/O port while the rate budget is exhausted
+
+} DEBUGGER_EVENT_THROTTLE_OPTIONS, *PDEBUGGER_EVENT_THROTTLE_OPTIONS;
+
 //////////////////////////////////////////////////
 //    Enums For Event And Debugger Resources    //
 //////////////////////////////////////////////////
@@ -390,6 +410,8 @@ typedef struct _DEBUGGER_GENERAL_EVENT_DETAIL
 
     DEBUGGER_EVENT_OPTIONS Options;
 
+    DEBUGGER_EVENT_THROTTLE_OPTIONS Throttle; // Sampling and rate limiting options of the event
+
     PVOID CommandStringBuffer;
 
     UINT32 ConditionBufferSize;
@@ -316,3 +316,19 @@
  */
 #define IOCTL_QUERY_IDT_ENTRY \
     CTL_CODE(FILE_DEVICE_UNKNOWN, 0x824, METHOD_BUFFERED, FILE_ANY_ACCESS)
+
+/**
+ * @brief ioctl, request to search several patterns in virtual and
+ * physical memory
+ *
+ */
+#define IOCTL_DEBUGGER_SEARCH_MULTIPLE_PATTERNS \
+    CTL_CODE(FILE_DEVICE_UNKNOWN, 0x825, METHOD_BUFFERED, FILE_ANY_ACCESS)
+
+/**
+ * @brief ioctl, request to start, stop, or read the samples of the
+ * profiler
+ *
+ */
+#define IOCTL_DEBUGGER_PROFILER \
+    CTL_CODE(FILE_DEVICE_UNKNOWN, 0x826, METHOD_BUFFERED, FILE_ANY_ACCESS)
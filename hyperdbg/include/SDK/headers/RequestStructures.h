@@ -161,9 +161,30 @@ typedef enum _DEBUGGER_PREALLOC_COMMAND_TYPE
     DEBUGGER_PREALLOC_COMMAND_TYPE_BIG_EVENT,
     DEBUGGER_PREALLOC_COMMAND_TYPE_REGULAR_SAFE_BUFFER,
     DEBUGGER_PREALLOC_COMMAND_TYPE_BIG_SAFE_BUFFER,
+    DEBUGGER_PREALLOC_COMMAND_TYPE_QUERY_STATISTICS,
 
 } DEBUGGER_PREALLOC_COMMAND_TYPE;
 
+/**
+ * @brief Usage statistics of the pre-allocated pools of an intention
+ *
+ */
+typedef struct _POOL_MANAGER_INTENTION_STATISTICS
+{
+    UINT64 Size;
+    UINT32 NumberOfFreePools;
+    UINT32 NumberOfBusyPools;
+    UINT32 PeakNumberOfBusyPools;
+    UINT32 PeakDemand;   // Maximum number of pools that were needed at the same time (including failed requests)
+    UINT32 MaximumBurst; // Maximum number of requests between crossing the low watermark and replenishment
+    UINT32 LowWatermark;
+    UINT32 HighWatermark;
+    UINT64 NumberOfRequests;
+    UINT64 NumberOfFailedRequests;
+    UINT64 NumberOfReplenishedPools;
+
+} POOL_MANAGER_INTENTION_STATISTICS, *PPOOL_MANAGER_INTENTION_STATISTICS;
+
 #define SIZEOF_DEBUGGER_PREALLOC_COMMAND \
     sizeof(DEBUGGER_PREALLOC_COMMAND)
 
@@ -173,9 +194,10 @@ typedef enum _DEBUGGER_PREALLOC_COMMAND_TYPE
  */
 typedef struct _DEBUGGER_PREALLOC_COMMAND
 {
-    DEBUGGER_PREALLOC_COMMAND_TYPE Type;
-    UINT32                         Count;
-    UINT32                         KernelStatus;
+    DEBUGGER_PREALLOC_COMMAND_TYPE    Type;
+    UINT32                            Count;
+    UINT32                            KernelStatus;
+    POOL_MANAGER_INTENTION_STATISTICS Statistics[POOL_ALLOCATION_INTENTION_COUNT]; // Filled for the statistics queries
 
 } DEBUGGER_PREALLOC_COMMAND, *PDEBUGGER_PREALLOC_COMMAND;
 
@@ -491,6 +513,36 @@ typedef struct _DEBUGGER_EDIT_MEMORY
 
 } DEBUGGER_EDIT_MEMORY, *PDEBUGGER_EDIT_MEMORY;
 
+/* ==============================================================================================
+ */
+
+/**
+ * @brief actions of the resumable (time-sliced) operations
+ *
+ */
+typedef enum _DEBUGGER_OPERATION_CURSOR_ACTION
+{
+    DEBUGGER_OPERATION_CURSOR_ACTION_START,
+    DEBUGGER_OPERATION_CURSOR_ACTION_CONTINUE,
+    DEBUGGER_OPERATION_CURSOR_ACTION_CANCEL,
+
+} DEBUGGER_OPERATION_CURSOR_ACTION;
+
+/**
+ * @brief cursor of the resumable (time-sliced) operations
+ * @details the debuggee performs a part of the operation and returns the
+ * partial results with a continuation token, the operation is finished
+ * once the token is zero
+ *
+ */
+typedef struct _DEBUGGER_OPERATION_CURSOR
+{
+    DEBUGGER_OPERATION_CURSOR_ACTION Action; // set by the debugger
+    UINT32                           IsFinished;
+    UINT64                           ContinuationToken; // opaque
+
+} DEBUGGER_OPERATION_CURSOR, *PDEBUGGER_OPERATION_CURSOR;
+
 /* ==============================================================================================
  */
 
@@ -533,9 +585,224 @@ typedef struct _DEBUGGER_SEARCH_MEMORY
     DEBUGGER_SEARCH_MEMORY_BYTE_SIZE ByteSize;   // Modification size
     UINT32                           CountOf64Chunks;
     UINT32                           FinalStructureSize;
+    DEBUGGER_OPERATION_CURSOR        Cursor; // the search is resumable in the debugger mode
 
 } DEBUGGER_SEARCH_MEMORY, *PDEBUGGER_SEARCH_MEMORY;
 
+/* ==============================================================================================
+ */
+
+#define SIZEOF_DEBUGGER_SEARCH_MULTIPLE_PATTERNS sizeof(DEBUGGER_SEARCH_MULTIPLE_PATTERNS)
+
+/**
+ * @brief a range of memory for the multi-pattern search
+ *
+ */
+typedef struct _DEBUGGER_SEARCH_RANGE
+{
+    UINT64 Address;
+    UINT64 Length;
+
+} DEBUGGER_SEARCH_RANGE, *PDEBUGGER_SEARCH_RANGE;
+
+/**
+ * @brief a pattern of the multi-pattern search
+ * @details a byte of memory matches if (Byte & Mask) == (Bytes[i] & Masks[i]),
+ * so a zero mask is a wildcard
+ *
+ */
+typedef struct _DEBUGGER_SEARCH_PATTERN
+{
+    UINT32 Length;
+    UINT32 Reserved;
+    BYTE   Bytes[MaximumSearchPatternLength];
+    BYTE   Masks[MaximumSearchPatternLength];
+
+} DEBUGGER_SEARCH_PATTERN, *PDEBUGGER_SEARCH_PATTERN;
+
+/**
+ * @brief a result of the multi-pattern search
+ *
+ */
+typedef struct _DEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT
+{
+    UINT64 Address;
+    UINT32 PatternId;
+    UINT32 Reserved;
+
+} DEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT, *PDEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT;
+
+/**
+ * @brief request for searching several patterns in several ranges
+ * @details the results (DEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT) are
+ * placed after this structure, if the search is not finished (e.g., the
+ * results are full), Cursor.IsFinished is not set
+ *
+ */
+typedef struct _DEBUGGER_SEARCH_MULTIPLE_PATTERNS
+{
+    UINT32                      ProcessId;  // specifies the process id
+    DEBUGGER_SEARCH_MEMORY_TYPE MemoryType; // Type of memory (virtual or physical)
+    UINT32                      NumberOfRanges;
+    UINT32                      NumberOfPatterns;
+    UINT32                      MaximumResultsPerPattern; // zero means no limit
+    UINT32                      NumberOfResults;
+    UINT32                      KernelStatus;
+    UINT32                      Reserved;
+    DEBUGGER_OPERATION_CURSOR   Cursor; // the search is resumable in the debugger mode
+    DEBUGGER_SEARCH_RANGE       Ranges[MaximumSearchRanges];
+    DEBUGGER_SEARCH_PATTERN     Patterns[MaximumSearchPatterns];
+
+} DEBUGGER_SEARCH_MULTIPLE_PATTERNS, *PDEBUGGER_SEARCH_MULTIPLE_PATTERNS;
+
+/* ==============================================================================================
+ */
+
+#define SIZEOF_DEBUGGER_PROFILER_REQUEST sizeof(DEBUGGER_PROFILER_REQUEST)
+
+/**
+ * @brief different types of the profiler requests
+ *
+ */
+typedef enum _DEBUGGER_PROFILER_REQUEST_TYPE
+{
+    DEBUGGER_PROFILER_REQUEST_START,
+    DEBUGGER_PROFILER_REQUEST_STOP,
+    DEBUGGER_PROFILER_REQUEST_READ_SAMPLES,
+
+} DEBUGGER_PROFILER_REQUEST_TYPE;
+
+/**
+ * @brief a sample of the profiler
+ * @details the stack contains the values on the stack of the guest that
+ * might be return addresses (it's not an unwound call stack)
+ *
+ */
+typedef struct _DEBUGGER_PROFILER_SAMPLE
+{
+    UINT64  Cr3;
+    UINT64  Rip;
+    UINT32  ProcessId;
+    UINT32  ThreadId;
+    UINT16  CoreId;
+    BOOLEAN IsUserMode;
+    UINT8   StackDepth;
+    UINT32  Reserved;
+    UINT64  Stack[MaximumProfilerStackDepth];
+
+} DEBUGGER_PROFILER_SAMPLE, *PDEBUGGER_PROFILER_SAMPLE;
+
+/**
+ * @brief request for the profiler
+ * @details for reading the samples, the samples (DEBUGGER_PROFILER_SAMPLE)
+ * are placed after this structure
+ *
+ */
+typedef struct _DEBUGGER_PROFILER_REQUEST
+{
+    DEBUGGER_PROFILER_REQUEST_TYPE RequestType;
+    UINT32                         SamplingFrequency; // samples per second on each core (start)
+    UINT32                         StackDepth;        // number of stack entries of each sample (start)
+    UINT32                         ProcessId;         // the process that is sampled (start)
+    UINT32                         CoreId;            // the core that its samples are read (read)
+    UINT32                         NumberOfSamples;   // number of the returned samples (read)
+    UINT64                         TotalSamples;      // samples taken on the core (read)
+    UINT64                         DroppedSamples;    // samples dropped as the buffer was full (read)
+    UINT32                         KernelStatus;
+    UINT32                         Reserved;
+
+} DEBUGGER_PROFILER_REQUEST, *PDEBUGGER_PROFILER_REQUEST;
+
+/* ==============================================================================================
+ */
+
+#define SIZEOF_DEBUGGER_BRANCH_TRACE_REQUEST sizeof(DEBUGGER_BRANCH_TRACE_REQUEST)
+
+/**
+ * @brief different types of the branch tracing requests
+ *
+ */
+typedef enum _DEBUGGER_BRANCH_TRACE_REQUEST_TYPE
+{
+    DEBUGGER_BRANCH_TRACE_REQUEST_START,
+    DEBUGGER_BRANCH_TRACE_REQUEST_READ_RECORDS,
+
+} DEBUGGER_BRANCH_TRACE_REQUEST_TYPE;
+
+/**
+ * @brief type of the branch instructions (based on the source of the branch)
+ *
+ */
+typedef enum _DEBUGGER_BRANCH_TRACE_TYPE
+{
+    DEBUGGER_BRANCH_TRACE_TYPE_UNKNOWN,
+    DEBUGGER_BRANCH_TRACE_TYPE_CALL,
+    DEBUGGER_BRANCH_TRACE_TYPE_RET,
+    DEBUGGER_BRANCH_TRACE_TYPE_JMP,
+    DEBUGGER_BRANCH_TRACE_TYPE_JCC,
+    DEBUGGER_BRANCH_TRACE_TYPE_SYSCALL,
+    DEBUGGER_BRANCH_TRACE_TYPE_IRET,
+
+} DEBUGGER_BRANCH_TRACE_TYPE;
+
+/**
+ * @brief the records are also drained on the clock interrupts (and the
+ * IPIs) of the core that runs the traced thread, the records are always
+ * drained when the thread is switched out and when the debuggee is paused
+ *
+ */
+#define DEBUGGER_BRANCH_TRACE_DRAIN_ON_CLOCK_INTERRUPTS 0x1
+
+/**
+ * @brief the LBR stack was full when the record was drained, so the
+ * branches before the record might be lost
+ *
+ */
+#define DEBUGGER_BRANCH_TRACE_RECORD_FLAG_BRANCHES_LOST 0x1
+
+/**
+ * @brief the record is the first branch after the traced thread is
+ * switched in
+ *
+ */
+#define DEBUGGER_BRANCH_TRACE_RECORD_FLAG_THREAD_RESUMED 0x2
+
+/**
+ * @brief a record of the branch tracing
+ * @details the source and the destination are the raw values of the last
+ * branch record (LBR) MSRs, they are decoded in the debugger based on the
+ * format of the records
+ *
+ */
+typedef struct _DEBUGGER_BRANCH_TRACE_RECORD
+{
+    UINT64 From;
+    UINT64 To;
+    UINT32 Type; // DEBUGGER_BRANCH_TRACE_TYPE
+    UINT16 CoreId;
+    UINT16 Flags; // DEBUGGER_BRANCH_TRACE_RECORD_FLAG_*
+
+} DEBUGGER_BRANCH_TRACE_RECORD, *PDEBUGGER_BRANCH_TRACE_RECORD;
+
+/**
+ * @brief request for the branch tracing ('!track' command)
+ * @details for reading the records, the records (DEBUGGER_BRANCH_TRACE_RECORD)
+ * are placed after this structure
+ *
+ */
+typedef struct _DEBUGGER_BRANCH_TRACE_REQUEST
+{
+    DEBUGGER_BRANCH_TRACE_REQUEST_TYPE RequestType;
+    UINT32                             NumberOfBranches; // stop after tracing this number of branches (start)
+    UINT32                             StartIndex;       // the index of the first record (read)
+    UINT32                             NumberOfRecords;  // number of the returned records (read)
+    UINT32                             TotalRecords;     // number of the recorded branches (read)
+    UINT32                             LbrFormat;        // format of the last branch records
+    UINT32                             KernelStatus;
+    UINT32                             DrainPoints; // DEBUGGER_BRANCH_TRACE_DRAIN_* (start)
+
+} DEBUGGER_BRANCH_TRACE_REQUEST, *PDEBUGGER_BRANCH_TRACE_REQUEST;
+
 /* ==============================================================================================
  */
 
@@ -1342,8 +1609,10 @@ typedef struct _DEBUGGEE_SCRIPT_PACKET
  */
 typedef struct _DEBUGGEE_RESULT_OF_SEARCH_PACKET
 {
-    UINT32 CountOfResults;
-    UINT32 Result;
+    UINT32                    CountOfResults;
+    UINT32                    Result;
+    UINT64                    NextAddress; // where the next slice continues the search
+    DEBUGGER_OPERATION_CURSOR Cursor;
 
 } DEBUGGEE_RESULT_OF_SEARCH_PACKET, *PDEBUGGEE_RESULT_OF_SEARCH_PACKET;
 
@@ -1377,6 +1646,73 @@ typedef struct _DEBUGGEE_REGISTER_WRITE_DESCRIPTION
 
 } DEBUGGEE_REGISTER_WRITE_DESCRIPTION, *PDEBUGGEE_REGISTER_WRITE_DESCRIPTION;
 
+/* ==============================================================================================
+ */
+
+/**
+ * @brief Types of the operations of a batch
+ *
+ */
+typedef enum _DEBUGGEE_BATCH_OPERATION_TYPE
+{
+    DEBUGGEE_BATCH_OPERATION_TYPE_READ_MEMORY = 1,  // DEBUGGER_READ_MEMORY (the response is followed by the memory)
+    DEBUGGEE_BATCH_OPERATION_TYPE_EDIT_MEMORY,      // DEBUGGER_EDIT_MEMORY followed by the 64-bit chunks
+    DEBUGGEE_BATCH_OPERATION_TYPE_READ_REGISTER,    // DEBUGGEE_REGISTER_READ_DESCRIPTION
+    DEBUGGEE_BATCH_OPERATION_TYPE_WRITE_REGISTER,   // DEBUGGEE_REGISTER_WRITE_DESCRIPTION
+    DEBUGGEE_BATCH_OPERATION_TYPE_SET_BREAKPOINT,   // DEBUGGEE_BP_PACKET
+    DEBUGGEE_BATCH_OPERATION_TYPE_MODIFY_BREAKPOINT, // DEBUGGEE_BP_LIST_OR_MODIFY_PACKET
+    DEBUGGEE_BATCH_OPERATION_TYPE_PAGE_IN,          // DEBUGGER_PAGE_IN_REQUEST
+
+} DEBUGGEE_BATCH_OPERATION_TYPE;
+
+/**
+ * @brief Size of each operation of a batch (including its header) is
+ * aligned to this value
+ *
+ */
+#define DEBUGGEE_BATCH_OPERATION_ALIGNMENT 8
+
+/**
+ * @brief Size of an operation of a batch (the header and the aligned request or result)
+ *
+ */
+#define DEBUGGEE_BATCH_OPERATION_SIZE(Size) \
+    (sizeof(DEBUGGEE_BATCH_OPERATION_HEADER) + (((Size) + DEBUGGEE_BATCH_OPERATION_ALIGNMENT - 1) & ~(DEBUGGEE_BATCH_OPERATION_ALIGNMENT - 1)))
+
+/**
+ * @brief Header of each operation of a batch
+ * @details the request (or the result) of the operation is appended
+ * to the header, the size of the result might differ from the request
+ * (e.g., reading memory)
+ *
+ */
+typedef struct _DEBUGGEE_BATCH_OPERATION_HEADER
+{
+    UINT32 Type;         // DEBUGGEE_BATCH_OPERATION_TYPE
+    UINT32 Size;         // size of the appended request or result (without the alignment)
+    UINT32 KernelStatus; // result of the operation
+    UINT32 Reserved;
+
+} DEBUGGEE_BATCH_OPERATION_HEADER, *PDEBUGGEE_BATCH_OPERATION_HEADER;
+
+/**
+ * @brief A list of operations that are performed by the debuggee
+ * while it's halted, and answered by a single response
+ *
+ */
+typedef struct _DEBUGGEE_BATCH_PACKET
+{
+    UINT32 NumberOfOperations;
+    UINT32 TotalSize;                   // size of the packet (including this header)
+    UINT32 NumberOfPerformedOperations; // operations after an invalid operation are not performed
+    UINT32 KernelStatus;
+
+    //
+    // Here is the list of operations (DEBUGGEE_BATCH_OPERATION_HEADER + request/result)
+    //
+
+} DEBUGGEE_BATCH_PACKET, *PDEBUGGEE_BATCH_PACKET;
+
 /* ==============================================================================================
  */
 
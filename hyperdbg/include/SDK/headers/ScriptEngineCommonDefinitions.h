@@ -185,6 +185,62 @@ static const char *const SymbolTypeNames[] = {
 #define FUNC_MEMCPY 96
 #define FUNC_MEMCPY_PA 97
 #define FUNC_WCSNCMP 98
+#define FUNC_SPECIALIZED_OPERATORS_START 99
+#define FUNC_OR_TMP_TMP_IMM 99
+#define FUNC_OR_TMP_TMP_TMP 100
+#define FUNC_OR_TMP_REG_IMM 101
+#define FUNC_XOR_TMP_TMP_IMM 102
+#define FUNC_XOR_TMP_TMP_TMP 103
+#define FUNC_XOR_TMP_REG_IMM 104
+#define FUNC_AND_TMP_TMP_IMM 105
+#define FUNC_AND_TMP_TMP_TMP 106
+#define FUNC_AND_TMP_REG_IMM 107
+#define FUNC_ASR_TMP_TMP_IMM 108
+#define FUNC_ASR_TMP_TMP_TMP 109
+#define FUNC_ASR_TMP_REG_IMM 110
+#define FUNC_ASL_TMP_TMP_IMM 111
+#define FUNC_ASL_TMP_TMP_TMP 112
+#define FUNC_ASL_TMP_REG_IMM 113
+#define FUNC_ADD_TMP_TMP_IMM 114
+#define FUNC_ADD_TMP_TMP_TMP 115
+#define FUNC_ADD_TMP_REG_IMM 116
+#define FUNC_SUB_TMP_TMP_IMM 117
+#define FUNC_SUB_TMP_TMP_TMP 118
+#define FUNC_SUB_TMP_REG_IMM 119
+#define FUNC_MUL_TMP_TMP_IMM 120
+#define FUNC_MUL_TMP_TMP_TMP 121
+#define FUNC_MUL_TMP_REG_IMM 122
+#define FUNC_GT_TMP_TMP_IMM 123
+#define FUNC_GT_TMP_TMP_TMP 124
+#define FUNC_GT_TMP_REG_IMM 125
+#define FUNC_LT_TMP_TMP_IMM 126
+#define FUNC_LT_TMP_TMP_TMP 127
+#define FUNC_LT_TMP_REG_IMM 128
+#define FUNC_EGT_TMP_TMP_IMM 129
+#define FUNC_EGT_TMP_TMP_TMP 130
+#define FUNC_EGT_TMP_REG_IMM 131
+#define FUNC_ELT_TMP_TMP_IMM 132
+#define FUNC_ELT_TMP_TMP_TMP 133
+#define FUNC_ELT_TMP_REG_IMM 134
+#define FUNC_EQUAL_TMP_TMP_IMM 135
+#define FUNC_EQUAL_TMP_TMP_TMP 136
+#define FUNC_EQUAL_TMP_REG_IMM 137
+#define FUNC_NEQ_TMP_TMP_IMM 138
+#define FUNC_NEQ_TMP_TMP_TMP 139
+#define FUNC_NEQ_TMP_REG_IMM 140
+#define FUNC_ADD_GLB_GLB_IMM 141
+#define FUNC_SUB_GLB_GLB_IMM 142
+#define FUNC_MOV_TMP_IMM 143
+#define FUNC_MOV_TMP_TMP 144
+#define FUNC_MOV_TMP_REG 145
+#define FUNC_MOV_REG_TMP 146
+#define FUNC_MOV_GLB_IMM 147
+#define FUNC_MOV_GLB_TMP 148
+#define FUNC_MOV_TMP_GLB 149
+#define FUNC_JZ_TMP 150
+#define FUNC_JNZ_TMP 151
+#define FUNC_STRCMP_TMP_PNAME_STR 152
+#define FUNC_STRCMP_TMP_STR_PNAME 153
 
 static const char *const FunctionNames[] = {
 "FUNC_UNDEFINED",
@@ -286,6 +342,61 @@ static const char *const FunctionNames[] = {
 "FUNC_MEMCPY",
 "FUNC_MEMCPY_PA",
 "FUNC_WCSNCMP",
+"FUNC_OR_TMP_TMP_IMM",
+"FUNC_OR_TMP_TMP_TMP",
+"FUNC_OR_TMP_REG_IMM",
+"FUNC_XOR_TMP_TMP_IMM",
+"FUNC_XOR_TMP_TMP_TMP",
+"FUNC_XOR_TMP_REG_IMM",
+"FUNC_AND_TMP_TMP_IMM",
+"FUNC_AND_TMP_TMP_TMP",
+"FUNC_AND_TMP_REG_IMM",
+"FUNC_ASR_TMP_TMP_IMM",
+"FUNC_ASR_TMP_TMP_TMP",
+"FUNC_ASR_TMP_REG_IMM",
+"FUNC_ASL_TMP_TMP_IMM",
+"FUNC_ASL_TMP_TMP_TMP",
+"FUNC_ASL_TMP_REG_IMM",
+"FUNC_ADD_TMP_TMP_IMM",
+"FUNC_ADD_TMP_TMP_TMP",
+"FUNC_ADD_TMP_REG_IMM",
+"FUNC_SUB_TMP_TMP_IMM",
+"FUNC_SUB_TMP_TMP_TMP",
+"FUNC_SUB_TMP_REG_IMM",
+"FUNC_MUL_TMP_TMP_IMM",
+"FUNC_MUL_TMP_TMP_TMP",
+"FUNC_MUL_TMP_REG_IMM",
+"FUNC_GT_TMP_TMP_IMM",
+"FUNC_GT_TMP_TMP_TMP",
+"FUNC_GT_TMP_REG_IMM",
+"FUNC_LT_TMP_TMP_IMM",
+"FUNC_LT_TMP_TMP_TMP",
+"FUNC_LT_TMP_REG_IMM",
+"FUNC_EGT_TMP_TMP_IMM",
+"FUNC_EGT_TMP_TMP_TMP",
+"FUNC_EGT_TMP_REG_IMM",
+"FUNC_ELT_TMP_TMP_IMM",
+"FUNC_ELT_TMP_TMP_TMP",
+"FUNC_ELT_TMP_REG_IMM",
+"FUNC_EQUAL_TMP_TMP_IMM",
+"FUNC_EQUAL_TMP_TMP_TMP",
+"FUNC_EQUAL_TMP_REG_IMM",
+"FUNC_NEQ_TMP_TMP_IMM",
+"FUNC_NEQ_TMP_TMP_TMP",
+"FUNC_NEQ_TMP_REG_IMM",
+"FUNC_ADD_GLB_GLB_IMM",
+"FUNC_SUB_GLB_GLB_IMM",
+"FUNC_MOV_TMP_IMM",
+"FUNC_MOV_TMP_TMP",
+"FUNC_MOV_TMP_REG",
+"FUNC_MOV_REG_TMP",
+"FUNC_MOV_GLB_IMM",
+"FUNC_MOV_GLB_TMP",
+"FUNC_MOV_TMP_GLB",
+"FUNC_JZ_TMP",
+"FUNC_JNZ_TMP",
+"FUNC_STRCMP_TMP_PNAME_STR",
+"FUNC_STRCMP_TMP_STR_PNAME",
 };
 
 typedef enum REGS_ENUM {
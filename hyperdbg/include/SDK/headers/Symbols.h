@@ -57,6 +57,29 @@ typedef struct _USERMODE_LOADED_MODULE_DETAILS
 
 } USERMODE_LOADED_MODULE_DETAILS, *PUSERMODE_LOADED_MODULE_DETAILS;
 
+/**
+ * @brief Details of a PE image that is parsed (and cached) by the
+ * symbol parser
+ * @details MappedBase is a read-only view of the whole file, the image
+ * is pinned by SymPeGetImageDetails and the view remains valid (even if
+ * the file is modified, the image is evicted or the cache is cleared)
+ * until SymPeReleaseImageDetails is called
+ *
+ */
+typedef struct _PE_IMAGE_DETAILS
+{
+    PVOID   ImageHandle; // the pinned image (released by SymPeReleaseImageDetails)
+    PVOID   MappedBase;
+    UINT64  FileSize;
+    BOOLEAN Is32Bit; // TRUE for PE32 and FALSE for PE32+
+    UINT16  Machine;
+    UINT32  NtHeadersOffset;
+    UINT32  NumberOfSections;
+    UINT32  NumberOfExports;
+    BOOLEAN IsCodeViewAvailable; // TRUE if the image has a RSDS debug directory entry
+
+} PE_IMAGE_DETAILS, *PPE_IMAGE_DETAILS;
+
 /**
  * @brief Callback type that should be used to add
  * list of Addresses to ObjectNames
@@ -64,6 +87,15 @@ typedef struct _USERMODE_LOADED_MODULE_DETAILS
  */
 typedef VOID (*SymbolMapCallback)(UINT64 Address, char * ModuleName, char * ObjectName, unsigned int ObjectSize);
 
+/**
+ * @brief Callback type that downloads a pdb file from the symbol server
+ * to a local file (it's used instead of URLDownloadToFile in the tests)
+ * @details returns zero (S_OK) if the file is downloaded, otherwise the
+ * error is shown as the result of the download
+ *
+ */
+typedef UINT32 (*SymbolPdbDownloadCallback)(const char * Url, const char * FilePath);
+
 /**
  * @brief request to add new symbol detail or update a previous
  * symbol table entry
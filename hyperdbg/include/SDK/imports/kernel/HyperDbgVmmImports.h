@@ -83,6 +83,12 @@ VmFuncSetExceptionBitmap(UINT32 CoreId, UINT32 IdtIndex);
 IMPORT_EXPORT_VMM VOID
 VmFuncUnsetExceptionBitmap(UINT32 CoreId, UINT32 IdtIndex);
 
+IMPORT_EXPORT_VMM BOOLEAN
+VmFuncUnsetMsrBitmap(UINT32 CoreId, UINT32 Msr, BOOLEAN ReadDetection, BOOLEAN WriteDetection);
+
+IMPORT_EXPORT_VMM BOOLEAN
+VmFuncUnsetIoBitmap(UINT32 CoreId, UINT32 Port);
+
 IMPORT_EXPORT_VMM VOID
 VmFuncSetExternalInterruptExiting(UINT32 CoreId, BOOLEAN Set);
 
@@ -168,6 +174,9 @@ VmFuncReadExceptionBitmap();
 IMPORT_EXPORT_VMM UINT64
 VmFuncGetLastVmexitRip(UINT32 CoreId);
 
+IMPORT_EXPORT_VMM UINT32
+VmFuncGetExitQualification(UINT32 CoreId);
+
 IMPORT_EXPORT_VMM UINT64
 VmFuncGetRflags();
 
@@ -225,6 +234,21 @@ VmFuncApicStoreLocalApicFields(PLAPIC_PAGE LocalApicBuffer, PBOOLEAN IsUsingX2AP
 IMPORT_EXPORT_VMM BOOLEAN
 VmFuncApicStoreIoApicFields(IO_APIC_ENTRY_PACKETS * IoApicPackets);
 
+IMPORT_EXPORT_VMM BOOLEAN
+VmFuncProfilerReadSamples(PDEBUGGER_PROFILER_REQUEST ProfilerRequest, UINT32 MaximumNumberOfSamples);
+
+IMPORT_EXPORT_VMM BOOLEAN
+VmFuncBranchTraceQuerySupport(UINT32 * LbrFormat);
+
+IMPORT_EXPORT_VMM VOID
+VmFuncBranchTraceEnableOnCurrentCore(UINT32 CoreId, BOOLEAN Enable);
+
+IMPORT_EXPORT_VMM UINT32
+VmFuncBranchTraceDrainOnCurrentCore(UINT32                        CoreId,
+                                    PDEBUGGER_BRANCH_TRACE_RECORD Records,
+                                    UINT32                        MaximumNumberOfRecords,
+                                    BOOLEAN *                     IsOverflowed);
+
 //////////////////////////////////////////////////
 //            Configuration Functions 	   		//
 //////////////////////////////////////////////////
@@ -280,6 +304,15 @@ ConfigureDirtyLoggingInitializeOnAllProcessors();
 IMPORT_EXPORT_VMM VOID
 ConfigureDirtyLoggingUninitializeOnAllProcessors();
 
+IMPORT_EXPORT_VMM BOOLEAN
+ConfigureProfilerStartOnAllProcessors(PDEBUGGER_PROFILER_REQUEST ProfilerRequest, UINT64 SamplingPeriod);
+
+IMPORT_EXPORT_VMM VOID
+ConfigureProfilerStopOnAllProcessors();
+
+IMPORT_EXPORT_VMM VOID
+ConfigureProfilerUninitializeOnAllProcessors();
+
 IMPORT_EXPORT_VMM VOID
 ConfigureModeBasedExecHookUninitializeOnAllProcessors();
 
@@ -680,6 +713,15 @@ PoolManagerFreePool(UINT64 AddressToFree);
 IMPORT_EXPORT_VMM VOID
 PoolManagerShowPreAllocatedPools();
 
+IMPORT_EXPORT_VMM BOOLEAN
+PoolManagerSetWatermarks(POOL_ALLOCATION_INTENTION Intention,
+                         SIZE_T                    Size,
+                         UINT32                    LowWatermark,
+                         UINT32                    HighWatermark);
+
+IMPORT_EXPORT_VMM VOID
+PoolManagerQueryStatistics(PPOOL_MANAGER_INTENTION_STATISTICS Statistics, UINT32 NumberOfIntentions);
+
 //////////////////////////////////////////////////
 //          VMX Registers Modification  		//
 //////////////////////////////////////////////////
@@ -64,6 +64,51 @@ hyperdbg_u_test_command_parser(CHAR *   command,
 IMPORT_EXPORT_LIBHYPERDBG VOID
 hyperdbg_u_test_command_parser_show_tokens(CHAR * command);
 
+//
+// Testing the components (used by the unit tests of the test process)
+//
+IMPORT_EXPORT_LIBHYPERDBG BOOLEAN
+hyperdbg_u_test_script_statement(const CHAR * expr, UINT64 expected_value, BOOLEAN expect_error);
+
+IMPORT_EXPORT_LIBHYPERDBG BOOLEAN
+hyperdbg_u_test_script_operator_specialization(const CHAR * expr);
+
+IMPORT_EXPORT_LIBHYPERDBG BOOLEAN
+hyperdbg_u_test_script_compiled_round_trip(const CHAR * expr, UINT64 parse_base, UINT64 load_base, UINT32 * number_of_relocations);
+
+IMPORT_EXPORT_LIBHYPERDBG VOID
+hyperdbg_u_test_script_set_module_base(UINT64 base);
+
+IMPORT_EXPORT_LIBHYPERDBG BOOLEAN
+hyperdbg_u_test_script_execute(PVOID symbol_buffer, UINT64 * number_of_operators);
+
+IMPORT_EXPORT_LIBHYPERDBG UINT64
+hyperdbg_u_test_script_get_register(GUEST_REGS * guest_regs, SCRIPT_ENGINE_REGISTERS_SNAPSHOT * snapshot, REGS_ENUM reg_id);
+
+IMPORT_EXPORT_LIBHYPERDBG BOOLEAN
+hyperdbg_u_test_script_set_register(GUEST_REGS * guest_regs, SCRIPT_ENGINE_REGISTERS_SNAPSHOT * snapshot, REGS_ENUM reg_id, UINT64 value);
+
+IMPORT_EXPORT_LIBHYPERDBG CHAR *
+hyperdbg_u_test_script_get_pname();
+
+IMPORT_EXPORT_LIBHYPERDBG UINT64
+hyperdbg_u_test_script_get_peb();
+
+IMPORT_EXPORT_LIBHYPERDBG UINT64
+hyperdbg_u_test_script_compare_pname(const CHAR * string, BOOLEAN is_pname_first);
+
+IMPORT_EXPORT_LIBHYPERDBG UINT32
+hyperdbg_u_test_load_symbol_file(UINT64 base_address, const CHAR * pdb_file_name, const CHAR * module_name);
+
+IMPORT_EXPORT_LIBHYPERDBG UINT32
+hyperdbg_u_test_unload_module_symbol(const CHAR * module_name);
+
+IMPORT_EXPORT_LIBHYPERDBG BOOLEAN
+hyperdbg_u_test_assembler_has_cached_result();
+
+IMPORT_EXPORT_LIBHYPERDBG BOOLEAN
+hyperdbg_u_test_search_convert_pattern(const CHAR * pattern_string, DEBUGGER_SEARCH_PATTERN * pattern);
+
 //
 // General imports/exports
 //
@@ -269,6 +314,68 @@ hyperdbg_u_assemble_get_length(const CHAR * assembly_code, UINT64 start_address,
 IMPORT_EXPORT_LIBHYPERDBG BOOLEAN
 hyperdbg_u_assemble(const CHAR * assembly_code, UINT64 start_address, PVOID buffer_to_store_assembled_data, UINT32 buffer_size);
 
+IMPORT_EXPORT_LIBHYPERDBG BOOLEAN
+hyperdbg_u_assemble_batch(const CHAR * assembly_code,
+                          UINT64       start_address,
+                          PVOID        buffer_to_store_assembled_data,
+                          UINT32       buffer_size,
+                          UINT32 *     statement_offsets,
+                          UINT32 *     statement_lengths,
+                          UINT32       max_statements,
+                          UINT32 *     number_of_statements,
+                          UINT32 *     length);
+
+//
+// Batch operations
+// Performing a list of operations in the debuggee with a single packet
+//
+IMPORT_EXPORT_LIBHYPERDBG PVOID
+hyperdbg_u_batch_create();
+
+IMPORT_EXPORT_LIBHYPERDBG BOOLEAN
+hyperdbg_u_batch_add_read_memory(PVOID                     batch,
+                                 UINT64                    address,
+                                 DEBUGGER_READ_MEMORY_TYPE memory_type,
+                                 UINT32                    size,
+                                 UINT32 *                  index);
+
+IMPORT_EXPORT_LIBHYPERDBG BOOLEAN
+hyperdbg_u_batch_add_write_memory(PVOID                     batch,
+                                  UINT64                    address,
+                                  DEBUGGER_EDIT_MEMORY_TYPE memory_type,
+                                  const BYTE *              buffer,
+                                  UINT32                    size,
+                                  UINT32 *                  index);
+
+IMPORT_EXPORT_LIBHYPERDBG BOOLEAN
+hyperdbg_u_batch_add_read_register(PVOID batch, UINT32 register_id, UINT32 * index);
+
+IMPORT_EXPORT_LIBHYPERDBG BOOLEAN
+hyperdbg_u_batch_add_write_register(PVOID batch, UINT32 register_id, UINT64 value, UINT32 * index);
+
+IMPORT_EXPORT_LIBHYPERDBG BOOLEAN
+hyperdbg_u_batch_add_set_breakpoint(PVOID batch, UINT64 address, UINT32 pid, UINT32 tid, UINT32 core_numer, UINT32 * index);
+
+IMPORT_EXPORT_LIBHYPERDBG BOOLEAN
+hyperdbg_u_batch_add_clear_breakpoint(PVOID batch, UINT64 breakpoint_id, UINT32 * index);
+
+IMPORT_EXPORT_LIBHYPERDBG BOOLEAN
+hyperdbg_u_batch_add_pagein(PVOID batch, UINT64 address_from, UINT64 address_to, UINT32 page_fault_error_code, UINT32 * index);
+
+IMPORT_EXPORT_LIBHYPERDBG BOOLEAN
+hyperdbg_u_batch_execute(PVOID batch, UINT32 * number_of_performed_operations);
+
+IMPORT_EXPORT_LIBHYPERDBG BOOLEAN
+hyperdbg_u_batch_get_result(PVOID    batch,
+                            UINT32   index,
+                            UINT32 * kernel_status,
+                            PVOID    buffer,
+                            UINT32   buffer_size,
+                            UINT32 * return_length);
+
+IMPORT_EXPORT_LIBHYPERDBG VOID
+hyperdbg_u_batch_free(PVOID batch);
+
 //
 // hwdbg functions
 // Exported functionality of the '!hw' and '!hw_*' commands
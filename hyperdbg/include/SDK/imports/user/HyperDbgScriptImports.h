@@ -64,6 +64,12 @@ ScriptEngineParse(char * str);
 IMPORT_EXPORT_HYPERDBG_SCRIPT_ENGINE BOOLEAN
 ScriptEngineSetHwdbgInstanceInfo(HWDBG_INSTANCE_INFORMATION * InstancInfo);
 
+IMPORT_EXPORT_HYPERDBG_SCRIPT_ENGINE VOID
+ScriptEngineSetOperatorSpecialization(BOOLEAN Enable);
+
+IMPORT_EXPORT_HYPERDBG_SCRIPT_ENGINE VOID
+ScriptEngineSetParserContextReuse(BOOLEAN Enable);
+
 IMPORT_EXPORT_HYPERDBG_SCRIPT_ENGINE void
 PrintSymbolBuffer(const PVOID SymbolBuffer);
 
@@ -103,6 +109,12 @@ ScriptEngineConvertFileToPdbPath(const char * LocalFilePath, char * ResultPath,
 IMPORT_EXPORT_HYPERDBG_SCRIPT_ENGINE BOOLEAN
 ScriptEngineConvertFileToPdbFileAndGuidAndAgeDetails(const char * LocalFilePath, char * PdbFilePath, char * GuidAndAgeDetails, BOOLEAN Is32BitModule);
 
+IMPORT_EXPORT_HYPERDBG_SCRIPT_ENGINE BOOLEAN
+ScriptEngineGetPeImageDetails(const WCHAR * FilePath, PPE_IMAGE_DETAILS ImageDetails);
+
+IMPORT_EXPORT_HYPERDBG_SCRIPT_ENGINE VOID
+ScriptEngineReleasePeImageDetails(PPE_IMAGE_DETAILS ImageDetails);
+
 IMPORT_EXPORT_HYPERDBG_SCRIPT_ENGINE BOOLEAN
 ScriptEngineSymbolInitLoad(PVOID BufferToStoreDetails, UINT32 StoredLength, BOOLEAN DownloadIfAvailable, const char * SymbolPath, BOOLEAN IsSilentLoad);
 
@@ -112,9 +124,30 @@ ScriptEngineShowDataBasedOnSymbolTypes(const char * TypeName, UINT64 Address, BO
 IMPORT_EXPORT_HYPERDBG_SCRIPT_ENGINE VOID
 ScriptEngineSymbolAbortLoading();
 
+IMPORT_EXPORT_HYPERDBG_SCRIPT_ENGINE VOID
+ScriptEngineSymbolSetPdbDownloadCallback(PVOID Callback, UINT32 MaximumWorkers);
+
+IMPORT_EXPORT_HYPERDBG_SCRIPT_ENGINE VOID
+ScriptEngineSymbolSetTypeMembersCache(BOOLEAN Enable);
+
 IMPORT_EXPORT_HYPERDBG_SCRIPT_ENGINE VOID
 ScriptEngineSetTextMessageCallback(PVOID Handler);
 
+IMPORT_EXPORT_HYPERDBG_SCRIPT_ENGINE VOID
+ScriptEngineSetSymbolAddressCallbacks(PVOID NameToAddressCallback, PVOID ModuleBaseAddressCallback);
+
+//
+// Compiled scripts
+//
+IMPORT_EXPORT_HYPERDBG_SCRIPT_ENGINE BOOLEAN
+ScriptEngineSerializeCompiledScript(PVOID SymbolBuffer, PVOID * CompiledScript, UINT32 * CompiledScriptSize);
+
+IMPORT_EXPORT_HYPERDBG_SCRIPT_ENGINE PVOID
+ScriptEngineLoadCompiledScript(PVOID CompiledScript, UINT32 CompiledScriptSize);
+
+IMPORT_EXPORT_HYPERDBG_SCRIPT_ENGINE VOID
+ScriptEngineFreeCompiledScript(PVOID CompiledScript);
+
 #ifdef __cplusplus
 }
 #endif
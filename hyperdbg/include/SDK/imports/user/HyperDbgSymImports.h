@@ -30,9 +30,18 @@ SymSetTextMessageCallback(PVOID Handler);
 IMPORT_EXPORT_HYPERDBG_SYMBOL_PARSER VOID
 SymbolAbortLoading();
 
+IMPORT_EXPORT_HYPERDBG_SYMBOL_PARSER VOID
+SymSetPdbDownloadCallback(PVOID Callback, UINT32 MaximumWorkers);
+
+IMPORT_EXPORT_HYPERDBG_SYMBOL_PARSER VOID
+SymSetTypeMembersCache(BOOLEAN Enable);
+
 IMPORT_EXPORT_HYPERDBG_SYMBOL_PARSER UINT64
 SymConvertNameToAddress(const char * FunctionOrVariableName, PBOOLEAN WasFound);
 
+IMPORT_EXPORT_HYPERDBG_SYMBOL_PARSER UINT64
+SymGetModuleBaseAddress(const char * ModuleName, PBOOLEAN WasFound);
+
 IMPORT_EXPORT_HYPERDBG_SYMBOL_PARSER UINT32
 SymLoadFileSymbol(UINT64 BaseAddress, const char * PdbFileName, const char * CustomModuleName);
 
@@ -63,6 +72,21 @@ SymConvertFileToPdbFileAndGuidAndAgeDetails(const char * LocalFilePath,
                                             char *       GuidAndAgeDetails,
                                             BOOLEAN      Is32BitModule);
 
+IMPORT_EXPORT_HYPERDBG_SYMBOL_PARSER BOOLEAN
+SymPeGetImageDetails(const WCHAR * FilePath, PPE_IMAGE_DETAILS ImageDetails);
+
+IMPORT_EXPORT_HYPERDBG_SYMBOL_PARSER VOID
+SymPeReleaseImageDetails(PPE_IMAGE_DETAILS ImageDetails);
+
+IMPORT_EXPORT_HYPERDBG_SYMBOL_PARSER BOOLEAN
+SymPeGetExportRva(const WCHAR * FilePath, const char * ExportName, UINT32 * Rva);
+
+IMPORT_EXPORT_HYPERDBG_SYMBOL_PARSER BOOLEAN
+SymPeGetExportRvaByOrdinal(const WCHAR * FilePath, UINT32 Ordinal, UINT32 * Rva);
+
+IMPORT_EXPORT_HYPERDBG_SYMBOL_PARSER VOID
+SymPeClearImagesCache();
+
 IMPORT_EXPORT_HYPERDBG_SYMBOL_PARSER BOOLEAN
 SymbolInitLoad(PVOID        BufferToStoreDetails,
                UINT32       StoredLength,
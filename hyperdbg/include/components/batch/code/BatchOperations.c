@@ -0,0 +1,280 @@
+/**
+ * @file BatchOperations.c
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Validation and execution of the batch operations
+ * @details the packet is validated and each operation is performed on its
+ * copy in the response by the routines of the back end, so the same code is
+ * used by the kernel debugger and by the tests
+ * @version 0.11
+ * @date 2024-10-25
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Perform a batch of operations
+ * @details operations are performed in order and the result of each
+ * operation (with its status) is written into the response buffer,
+ * the operations after an invalid operation are not performed
+ *
+ * @param BatchPacket
+ * @param BatchPacketSize size of the received buffer
+ * @param ResponseBuffer
+ * @param ResponseBufferSize
+ * @param BackEnd The routines that perform the operations
+ *
+ * @return UINT32 size of the result in the response buffer
+ */
+UINT32
+BatchOperationsPerform(PDEBUGGEE_BATCH_PACKET     BatchPacket,
+                       UINT32                     BatchPacketSize,
+                       CHAR *                     ResponseBuffer,
+                       UINT32                     ResponseBufferSize,
+                       PBATCH_OPERATIONS_BACK_END BackEnd)
+{
+    PDEBUGGEE_BATCH_PACKET           BatchResult       = (PDEBUGGEE_BATCH_PACKET)ResponseBuffer;
+    UINT32                           RequestOffset     = sizeof(DEBUGGEE_BATCH_PACKET);
+    UINT32                           ResultOffset      = sizeof(DEBUGGEE_BATCH_PACKET);
+    BOOLEAN                          IsPageinRequested = FALSE;
+    BOOLEAN                          IsValid           = TRUE;
+    PDEBUGGEE_BATCH_OPERATION_HEADER Operation;
+    PDEBUGGEE_BATCH_OPERATION_HEADER Result;
+    CHAR *                           OperationBuffer;
+    CHAR *                           ResultBuffer;
+    UINT64                           RequiredSize;
+    UINT32                           ReturnSize;
+
+    BatchResult->NumberOfOperations          = BatchPacket->NumberOfOperations;
+    BatchResult->NumberOfPerformedOperations = 0;
+    BatchResult->KernelStatus                = DEBUGGER_OPERATION_WAS_SUCCESSFUL;
+
+    if (BatchPacketSize < sizeof(DEBUGGEE_BATCH_PACKET) ||
+        BatchPacket->TotalSize > BatchPacketSize ||
+        BatchPacket->TotalSize > ResponseBufferSize)
+    {
+        IsValid = FALSE;
+    }
+
+    for (UINT32 i = 0; IsValid && i < BatchPacket->NumberOfOperations; i++)
+    {
+        //
+        // Check whether the operation is inside the packet
+        //
+        if (RequestOffset + sizeof(DEBUGGEE_BATCH_OPERATION_HEADER) > BatchPacket->TotalSize)
+        {
+            IsValid = FALSE;
+            break;
+        }
+
+        Operation       = (PDEBUGGEE_BATCH_OPERATION_HEADER)((CHAR *)BatchPacket + RequestOffset);
+        OperationBuffer = (CHAR *)Operation + sizeof(DEBUGGEE_BATCH_OPERATION_HEADER);
+
+        if (Operation->Size > BatchPacket->TotalSize - RequestOffset - sizeof(DEBUGGEE_BATCH_OPERATION_HEADER))
+        {
+            IsValid = FALSE;
+            break;
+        }
+
+        //
+        // Validate the size of the request and compute the size of its result
+        //
+        RequiredSize = Operation->Size;
+
+        switch (Operation->Type)
+        {
+        case DEBUGGEE_BATCH_OPERATION_TYPE_READ_MEMORY:
+
+            IsValid = Operation->Size == sizeof(DEBUGGER_READ_MEMORY);
+
+            if (IsValid)
+            {
+                RequiredSize += ((PDEBUGGER_READ_MEMORY)OperationBuffer)->Size;
+            }
+
+            break;
+
+        case DEBUGGEE_BATCH_OPERATION_TYPE_EDIT_MEMORY:
+
+            IsValid = Operation->Size >= SIZEOF_DEBUGGER_EDIT_MEMORY &&
+                      Operation->Size == SIZEOF_DEBUGGER_EDIT_MEMORY +
+                                             ((UINT64)((PDEBUGGER_EDIT_MEMORY)OperationBuffer)->CountOf64Chunks * sizeof(UINT64));
+            break;
+
+        case DEBUGGEE_BATCH_OPERATION_TYPE_READ_REGISTER:
+
+            IsValid = Operation->Size == sizeof(DEBUGGEE_REGISTER_READ_DESCRIPTION);
+
+            if (IsValid && ((PDEBUGGEE_REGISTER_READ_DESCRIPTION)OperationBuffer)->RegisterId == DEBUGGEE_SHOW_ALL_REGISTERS)
+            {
+                RequiredSize += sizeof(GUEST_REGS) + sizeof(GUEST_EXTRA_REGISTERS);
+            }
+
+            break;
+
+        case DEBUGGEE_BATCH_OPERATION_TYPE_WRITE_REGISTER:
+
+            IsValid = Operation->Size == sizeof(DEBUGGEE_REGISTER_WRITE_DESCRIPTION);
+            break;
+
+        case DEBUGGEE_BATCH_OPERATION_TYPE_SET_BREAKPOINT:
+
+            IsValid = Operation->Size == sizeof(DEBUGGEE_BP_PACKET);
+            break;
+
+        case DEBUGGEE_BATCH_OPERATION_TYPE_MODIFY_BREAKPOINT:
+
+            //
+            // Listing breakpoints is not a batch operation as it has no result
+            //
+            IsValid = Operation->Size == sizeof(DEBUGGEE_BP_LIST_OR_MODIFY_PACKET) &&
+                      ((PDEBUGGEE_BP_LIST_OR_MODIFY_PACKET)OperationBuffer)->Request != DEBUGGEE_BREAKPOINT_MODIFICATION_REQUEST_LIST_BREAKPOINTS;
+            break;
+
+        case DEBUGGEE_BATCH_OPERATION_TYPE_PAGE_IN:
+
+            //
+            // Only one range could be paged-in each time that the debuggee continues
+            //
+            IsValid = Operation->Size == sizeof(DEBUGGER_PAGE_IN_REQUEST) && !IsPageinRequested;
+            break;
+
+        default:
+
+            IsValid = FALSE;
+            break;
+        }
+
+        //
+        // Check whether the result fits in the response
+        //
+        if (!IsValid ||
+            ResultOffset + DEBUGGEE_BATCH_OPERATION_SIZE(RequiredSize) > ResponseBufferSize)
+        {
+            IsValid = FALSE;
+            break;
+        }
+
+        //
+        // The operation is performed on its copy in the response
+        //
+        Result       = (PDEBUGGEE_BATCH_OPERATION_HEADER)(ResponseBuffer + ResultOffset);
+        ResultBuffer = (CHAR *)Result + sizeof(DEBUGGEE_BATCH_OPERATION_HEADER);
+
+        memcpy(Result, Operation, sizeof(DEBUGGEE_BATCH_OPERATION_HEADER) + Operation->Size);
+
+        switch (Operation->Type)
+        {
+        case DEBUGGEE_BATCH_OPERATION_TYPE_READ_MEMORY:
+
+            ReturnSize = 0;
+
+            if (BackEnd->ReadMemory((PDEBUGGER_READ_MEMORY)ResultBuffer,
+                                    (UCHAR *)ResultBuffer + sizeof(DEBUGGER_READ_MEMORY),
+                                    &ReturnSize,
+                                    BackEnd->Context))
+            {
+                ((PDEBUGGER_READ_MEMORY)ResultBuffer)->KernelStatus = DEBUGGER_OPERATION_WAS_SUCCESSFUL;
+            }
+            else
+            {
+                ((PDEBUGGER_READ_MEMORY)ResultBuffer)->KernelStatus = DEBUGGER_ERROR_INVALID_ADDRESS;
+            }
+
+            ((PDEBUGGER_READ_MEMORY)ResultBuffer)->ReturnLength = ReturnSize;
+
+            Result->KernelStatus = ((PDEBUGGER_READ_MEMORY)ResultBuffer)->KernelStatus;
+            Result->Size         = sizeof(DEBUGGER_READ_MEMORY) + ReturnSize;
+
+            break;
+
+        case DEBUGGEE_BATCH_OPERATION_TYPE_EDIT_MEMORY:
+
+            BackEnd->EditMemory((PDEBUGGER_EDIT_MEMORY)ResultBuffer, BackEnd->Context);
+
+            //
+            // The chunks are not sent back
+            //
+            Result->KernelStatus = ((PDEBUGGER_EDIT_MEMORY)ResultBuffer)->Result;
+            Result->Size         = SIZEOF_DEBUGGER_EDIT_MEMORY;
+
+            break;
+
+        case DEBUGGEE_BATCH_OPERATION_TYPE_READ_REGISTER:
+
+            if (BackEnd->ReadRegister((PDEBUGGEE_REGISTER_READ_DESCRIPTION)ResultBuffer, BackEnd->Context))
+            {
+                ((PDEBUGGEE_REGISTER_READ_DESCRIPTION)ResultBuffer)->KernelStatus = DEBUGGER_OPERATION_WAS_SUCCESSFUL;
+            }
+            else
+            {
+                ((PDEBUGGEE_REGISTER_READ_DESCRIPTION)ResultBuffer)->KernelStatus = DEBUGGER_ERROR_INVALID_REGISTER_NUMBER;
+            }
+
+            Result->KernelStatus = ((PDEBUGGEE_REGISTER_READ_DESCRIPTION)ResultBuffer)->KernelStatus;
+            Result->Size         = (UINT32)RequiredSize;
+
+            break;
+
+        case DEBUGGEE_BATCH_OPERATION_TYPE_WRITE_REGISTER:
+
+            if (BackEnd->WriteRegister(((PDEBUGGEE_REGISTER_WRITE_DESCRIPTION)ResultBuffer)->RegisterId,
+                                       ((PDEBUGGEE_REGISTER_WRITE_DESCRIPTION)ResultBuffer)->Value,
+                                       BackEnd->Context))
+            {
+                ((PDEBUGGEE_REGISTER_WRITE_DESCRIPTION)ResultBuffer)->KernelStatus = DEBUGGER_OPERATION_WAS_SUCCESSFUL;
+            }
+            else
+            {
+                ((PDEBUGGEE_REGISTER_WRITE_DESCRIPTION)ResultBuffer)->KernelStatus = DEBUGGER_ERROR_INVALID_REGISTER_NUMBER;
+            }
+
+            Result->KernelStatus = ((PDEBUGGEE_REGISTER_WRITE_DESCRIPTION)ResultBuffer)->KernelStatus;
+
+            break;
+
+        case DEBUGGEE_BATCH_OPERATION_TYPE_SET_BREAKPOINT:
+
+            BackEnd->SetBreakpoint((PDEBUGGEE_BP_PACKET)ResultBuffer, BackEnd->Context);
+
+            Result->KernelStatus = ((PDEBUGGEE_BP_PACKET)ResultBuffer)->Result;
+
+            break;
+
+        case DEBUGGEE_BATCH_OPERATION_TYPE_MODIFY_BREAKPOINT:
+
+            BackEnd->ModifyBreakpoint((PDEBUGGEE_BP_LIST_OR_MODIFY_PACKET)ResultBuffer, BackEnd->Context);
+
+            Result->KernelStatus = ((PDEBUGGEE_BP_LIST_OR_MODIFY_PACKET)ResultBuffer)->Result;
+
+            break;
+
+        case DEBUGGEE_BATCH_OPERATION_TYPE_PAGE_IN:
+
+            //
+            // Pages are brought in once the debuggee continues
+            //
+            BackEnd->Pagein((PDEBUGGER_PAGE_IN_REQUEST)ResultBuffer, BackEnd->Context);
+            IsPageinRequested = TRUE;
+
+            Result->KernelStatus = ((PDEBUGGER_PAGE_IN_REQUEST)ResultBuffer)->KernelStatus;
+
+            break;
+        }
+
+        RequestOffset += DEBUGGEE_BATCH_OPERATION_SIZE(Operation->Size);
+        ResultOffset += DEBUGGEE_BATCH_OPERATION_SIZE(Result->Size);
+
+        BatchResult->NumberOfPerformedOperations++;
+    }
+
+    if (!IsValid)
+    {
+        BatchResult->KernelStatus = DEBUGGER_ERROR_INVALID_BATCH_OPERATION;
+    }
+
+    BatchResult->TotalSize = ResultOffset;
+
+    return ResultOffset;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file BatchOperations.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of the validation and execution of the batch operations
+ * @details
+ * @version 0.11
+ * @date 2024-10-25
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//				    Structures	    			//
+//////////////////////////////////////////////////
+
+/**
+ * @brief The routine that reads the memory of a batch operation
+ * @details returns FALSE if the memory is not accessible
+ *
+ */
+typedef BOOLEAN (*BATCH_OPERATIONS_READ_MEMORY)(PDEBUGGER_READ_MEMORY ReadMemRequest,
+                                               UCHAR *               TargetBuffer,
+                                               UINT32 *              ReturnSize,
+                                               PVOID                 Context);
+
+/**
+ * @brief The routine that edits the memory of a batch operation
+ * @details the result is written into the request
+ *
+ */
+typedef VOID (*BATCH_OPERATIONS_EDIT_MEMORY)(PDEBUGGER_EDIT_MEMORY EditMemRequest, PVOID Context);
+
+/**
+ * @brief The routine that reads a register (or all registers) of a batch
+ * operation
+ * @details returns FALSE if the register is not valid
+ *
+ */
+typedef BOOLEAN (*BATCH_OPERATIONS_READ_REGISTER)(PDEBUGGEE_REGISTER_READ_DESCRIPTION ReadRegisterRequest, PVOID Context);
+
+/**
+ * @brief The routine that writes a register of a batch operation
+ * @details returns FALSE if the register is not valid
+ *
+ */
+typedef BOOLEAN (*BATCH_OPERATIONS_WRITE_REGISTER)(UINT32 RegisterId, UINT64 Value, PVOID Context);
+
+/**
+ * @brief The routine that sets a breakpoint of a batch operation
+ * @details the result is written into the request
+ *
+ */
+typedef VOID (*BATCH_OPERATIONS_SET_BREAKPOINT)(PDEBUGGEE_BP_PACKET BpRequest, PVOID Context);
+
+/**
+ * @brief The routine that modifies (or clears) a breakpoint of a batch
+ * operation
+ * @details the result is written into the request
+ *
+ */
+typedef VOID (*BATCH_OPERATIONS_MODIFY_BREAKPOINT)(PDEBUGGEE_BP_LIST_OR_MODIFY_PACKET BpModifyRequest, PVOID Context);
+
+/**
+ * @brief The routine that brings the pages of a batch operation in
+ * @details the result is written into the request
+ *
+ */
+typedef VOID (*BATCH_OPERATIONS_PAGE_IN)(PDEBUGGER_PAGE_IN_REQUEST PageinRequest, PVOID Context);
+
+/**
+ * @brief Routines that perform the batch operations
+ *
+ */
+typedef struct _BATCH_OPERATIONS_BACK_END
+{
+    BATCH_OPERATIONS_READ_MEMORY       ReadMemory;
+    BATCH_OPERATIONS_EDIT_MEMORY       EditMemory;
+    BATCH_OPERATIONS_READ_REGISTER     ReadRegister;
+    BATCH_OPERATIONS_WRITE_REGISTER    WriteRegister;
+    BATCH_OPERATIONS_SET_BREAKPOINT    SetBreakpoint;
+    BATCH_OPERATIONS_MODIFY_BREAKPOINT ModifyBreakpoint;
+    BATCH_OPERATIONS_PAGE_IN           Pagein;
+    PVOID                              Context; // passed to the routines
+
+} BATCH_OPERATIONS_BACK_END, *PBATCH_OPERATIONS_BACK_END;
+
+//////////////////////////////////////////////////
+//				      Functions					//
+//////////////////////////////////////////////////
+
+UINT32
+BatchOperationsPerform(PDEBUGGEE_BATCH_PACKET     BatchPacket,
+                       UINT32                     BatchPacketSize,
+                       CHAR *                     ResponseBuffer,
+                       UINT32                     ResponseBufferSize,
+                       PBATCH_OPERATIONS_BACK_END BackEnd);
@@ -0,0 +1,171 @@
+/**
+ * @file LbrStack.c
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Draining the stack of the last branch records (LBR)
+ * @details the stack is read by the hypervisor at the drain points of the
+ * branch tracing, the same code is used by the hypervisor and by the tests
+ * @version 0.11
+ * @date 2024-11-08
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Get the number of the entries of the legacy LBR stack
+ * @details the depth is model-specific (family 6), reading the MSRs after
+ * the last entry causes #GP, so the unknown models are not supported
+ *
+ * @param DisplayModel The display model of the processor (family 6)
+ *
+ * @return UINT32 zero if the model is unknown
+ */
+UINT32
+LbrStackGetDepth(UINT32 DisplayModel)
+{
+    switch (DisplayModel)
+    {
+    case 0x0f: // Core 2
+    case 0x16:
+    case 0x17:
+    case 0x1d:
+
+        return 4;
+
+    case 0x1c: // Atom (Bonnell, Saltwell)
+    case 0x26:
+    case 0x27:
+    case 0x35:
+    case 0x36:
+    case 0x37: // Silvermont, Airmont
+    case 0x4a:
+    case 0x4c:
+    case 0x4d:
+    case 0x5a:
+    case 0x5d:
+    case 0x57: // Knights Landing, Knights Mill
+    case 0x85:
+
+        return 8;
+
+    case 0x1a: // Nehalem, Westmere
+    case 0x1e:
+    case 0x1f:
+    case 0x2e:
+    case 0x25:
+    case 0x2c:
+    case 0x2f:
+    case 0x2a: // Sandy Bridge, Ivy Bridge
+    case 0x2d:
+    case 0x3a:
+    case 0x3e:
+    case 0x3c: // Haswell, Broadwell
+    case 0x3f:
+    case 0x45:
+    case 0x46:
+    case 0x3d:
+    case 0x47:
+    case 0x4f:
+    case 0x56:
+
+        return 16;
+
+    case 0x4e: // Skylake and its successors (before the architectural LBRs)
+    case 0x5e:
+    case 0x55:
+    case 0x8e:
+    case 0x9e:
+    case 0x66:
+    case 0x6a:
+    case 0x6c:
+    case 0x7d:
+    case 0x7e:
+    case 0x8c:
+    case 0x8d:
+    case 0xa5:
+    case 0xa6:
+    case 0xa7:
+    case 0x5c: // Goldmont, Goldmont Plus, Tremont
+    case 0x5f:
+    case 0x7a:
+    case 0x86:
+    case 0x96:
+    case 0x9c:
+
+        return 32;
+
+    default:
+
+        return 0;
+    }
+}
+
+/**
+ * @brief Collect the branches that are recorded since the previous drain
+ * @details the entries are cleared after each drain, so the new branches
+ * are the non-zero entries that end at the top of the stack, they are
+ * returned from the oldest to the newest, if all the entries are recorded,
+ * the older branches might be overwritten (lost)
+ *
+ * @param Snapshot The raw values of the LBR stack
+ * @param Records The collected branches (only the source and the destination
+ * are set)
+ * @param MaximumNumberOfRecords Maximum number of the collected branches (the
+ * older branches are kept)
+ * @param IsOverflowed Whether the branches before the collected branches
+ * might be lost or not
+ *
+ * @return UINT32 Number of the collected branches
+ */
+UINT32
+LbrStackCollect(PLBR_STACK_SNAPSHOT           Snapshot,
+                PDEBUGGER_BRANCH_TRACE_RECORD Records,
+                UINT32                        MaximumNumberOfRecords,
+                BOOLEAN *                     IsOverflowed)
+{
+    UINT32 Count = 0;
+    UINT32 Index;
+
+    *IsOverflowed = FALSE;
+
+    if (Snapshot->Depth == 0 || Snapshot->Depth > LBR_STACK_MAXIMUM_DEPTH)
+    {
+        return 0;
+    }
+
+    //
+    // Count the new entries from the newest one
+    //
+    Index = Snapshot->Tos % Snapshot->Depth;
+
+    while (Count < Snapshot->Depth && Snapshot->From[Index] != 0)
+    {
+        Count++;
+        Index = (Index + Snapshot->Depth - 1) % Snapshot->Depth;
+    }
+
+    *IsOverflowed = Count == Snapshot->Depth;
+
+    if (Count > MaximumNumberOfRecords)
+    {
+        Count = MaximumNumberOfRecords;
+    }
+
+    //
+    // The entry after the last counted one is the oldest new entry
+    //
+    Index = (Index + 1) % Snapshot->Depth;
+
+    for (UINT32 i = 0; i < Count; i++)
+    {
+        RtlZeroMemory(&Records[i], sizeof(DEBUGGER_BRANCH_TRACE_RECORD));
+
+        Records[i].From = Snapshot->From[Index];
+        Records[i].To   = Snapshot->To[Index];
+
+        Index = (Index + 1) % Snapshot->Depth;
+    }
+
+    return Count;
+}
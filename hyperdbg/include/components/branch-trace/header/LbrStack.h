@@ -0,0 +1,54 @@
+/**
+ * @file LbrStack.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of draining the stack of the last branch records (LBR)
+ * @details
+ * @version 0.11
+ * @date 2024-11-08
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//				   Constants					//
+//////////////////////////////////////////////////
+
+/**
+ * @brief Maximum number of the entries of the legacy LBR stack
+ *
+ */
+#define LBR_STACK_MAXIMUM_DEPTH 32
+
+//////////////////////////////////////////////////
+//				   Structures					//
+//////////////////////////////////////////////////
+
+/**
+ * @brief The raw values of the LBR stack of a core
+ * @details the entries that are not recorded since the previous drain
+ * are zero, as the stack is cleared after each drain
+ *
+ */
+typedef struct _LBR_STACK_SNAPSHOT
+{
+    UINT32 Depth; // number of the entries of the stack
+    UINT32 Tos;   // index of the newest entry (MSR_LASTBRANCH_TOS)
+    UINT64 From[LBR_STACK_MAXIMUM_DEPTH];
+    UINT64 To[LBR_STACK_MAXIMUM_DEPTH];
+
+} LBR_STACK_SNAPSHOT, *PLBR_STACK_SNAPSHOT;
+
+//////////////////////////////////////////////////
+//				   Functions					//
+//////////////////////////////////////////////////
+
+UINT32
+LbrStackGetDepth(UINT32 DisplayModel);
+
+UINT32
+LbrStackCollect(PLBR_STACK_SNAPSHOT           Snapshot,
+                PDEBUGGER_BRANCH_TRACE_RECORD Records,
+                UINT32                        MaximumNumberOfRecords,
+                BOOLEAN *                     IsOverflowed);
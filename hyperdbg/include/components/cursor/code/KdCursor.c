@@ -0,0 +1,127 @@
+/**
+ * @file KdCursor.c
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Resumable (time-sliced) operations of the kernel debugger
+ * @details Long operations that are performed while the debuggee is
+ * halted run in slices, after each slice the partial results are sent
+ * to the debugger with a continuation token, and the debugger either
+ * continues or cancels the operation
+ * @version 0.11
+ * @date 2024-10-26
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief The last token of the resumable operations
+ *
+ */
+UINT64 g_KdCursorLastToken;
+
+/**
+ * @brief Incremented each time that the debuggee is continued, so
+ * the resumable operations are not resumed after continuing
+ *
+ */
+UINT64 g_KdCursorHaltEpoch;
+
+/**
+ * @brief Start a new resumable operation
+ * @details the previous operation of the cursor (if any) is discarded
+ *
+ * @param Cursor
+ *
+ * @return UINT64 the continuation token
+ */
+UINT64
+KdCursorOpen(PKD_CURSOR Cursor)
+{
+    //
+    // The token is not predictable from the previous tokens, so a stale
+    // token (e.g., from a previous session) is not accepted by accident
+    //
+    g_KdCursorLastToken++;
+
+    Cursor->Token     = (g_KdCursorLastToken << 32) | (__rdtsc() & 0xffffffff);
+    Cursor->HaltEpoch = g_KdCursorHaltEpoch;
+
+    if (Cursor->Token == (UINT64)NULL)
+    {
+        Cursor->Token = 1;
+    }
+
+    return Cursor->Token;
+}
+
+/**
+ * @brief Check whether the continuation token belongs to the operation
+ * of the cursor or not
+ * @details operations are not resumed after the debuggee is continued
+ *
+ * @param Cursor
+ * @param Token
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+KdCursorIsValid(PKD_CURSOR Cursor, UINT64 Token)
+{
+    return Cursor->Token != (UINT64)NULL &&
+           Cursor->Token == Token &&
+           Cursor->HaltEpoch == g_KdCursorHaltEpoch;
+}
+
+/**
+ * @brief Finish (or cancel) the operation of the cursor
+ *
+ * @param Cursor
+ *
+ * @return VOID
+ */
+VOID
+KdCursorClose(PKD_CURSOR Cursor)
+{
+    Cursor->Token = (UINT64)NULL;
+}
+
+/**
+ * @brief Start a new slice of the operation of the cursor
+ *
+ * @param Cursor
+ *
+ * @return VOID
+ */
+VOID
+KdCursorStartSlice(PKD_CURSOR Cursor)
+{
+    Cursor->SliceDeadline = __rdtsc() + KD_CURSOR_SLICE_MAXIMUM_CYCLES;
+}
+
+/**
+ * @brief Check whether the current slice of the operation should be
+ * finished or not
+ * @details operations check it between their units of work (e.g., pages)
+ *
+ * @param Cursor
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+KdCursorIsSliceExpired(PKD_CURSOR Cursor)
+{
+    return __rdtsc() >= Cursor->SliceDeadline;
+}
+
+/**
+ * @brief Invalidate the operations of all of the cursors
+ * @details should be called when the debuggee is continued
+ *
+ * @return VOID
+ */
+VOID
+KdCursorInvalidateAll()
+{
+    g_KdCursorHaltEpoch++;
+}
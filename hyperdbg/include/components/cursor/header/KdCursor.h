@@ -0,0 +1,63 @@
+/**
+ * @file KdCursor.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of the resumable (time-sliced) operations of the kernel debugger
+ * @details
+ * @version 0.11
+ * @date 2024-10-26
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//					Configs                     //
+//////////////////////////////////////////////////
+
+/**
+ * @brief Maximum number of cycles (TSC) that a resumable operation
+ * runs in vmx-root before returning its partial results to the debugger
+ *
+ */
+#define KD_CURSOR_SLICE_MAXIMUM_CYCLES (50 * 1000 * 1000)
+
+//////////////////////////////////////////////////
+//					Structures                  //
+//////////////////////////////////////////////////
+
+/**
+ * @brief The state of a resumable operation
+ * @details the operation itself keeps its progress, the cursor only
+ * keeps the continuation token and the deadline of the current slice
+ *
+ */
+typedef struct _KD_CURSOR
+{
+    UINT64 Token; // zero if there is no operation in progress
+    UINT64 HaltEpoch;
+    UINT64 SliceDeadline;
+
+} KD_CURSOR, *PKD_CURSOR;
+
+//////////////////////////////////////////////////
+//					Functions                   //
+//////////////////////////////////////////////////
+
+UINT64
+KdCursorOpen(PKD_CURSOR Cursor);
+
+BOOLEAN
+KdCursorIsValid(PKD_CURSOR Cursor, UINT64 Token);
+
+VOID
+KdCursorClose(PKD_CURSOR Cursor);
+
+VOID
+KdCursorStartSlice(PKD_CURSOR Cursor);
+
+BOOLEAN
+KdCursorIsSliceExpired(PKD_CURSOR Cursor);
+
+VOID
+KdCursorInvalidateAll();
@@ -0,0 +1,810 @@
+/**
+ * @file MonitorEmulation.c
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Decoder and executor of the emulated memory accesses
+ * @details The instructions are only decoded and executed here, the memory
+ * is accessed through the given routines, so the same emulator is used by
+ * the hypervisor (on the monitored pages) and by the tests
+ *
+ * @version 0.11
+ * @date 2024-10-27
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Operations of the '0x00-0x3f' arithmetic opcodes and the
+ * '0x80-0x83' group (based on the 'reg' field)
+ * @details ADC and SBB are not emulated
+ *
+ */
+static const INT32 MonitorEmulationArithmeticOperations[8] = {
+    MONITOR_EMULATION_OPERATION_ADD,
+    MONITOR_EMULATION_OPERATION_OR,
+    -1,
+    -1,
+    MONITOR_EMULATION_OPERATION_AND,
+    MONITOR_EMULATION_OPERATION_SUB,
+    MONITOR_EMULATION_OPERATION_XOR,
+    MONITOR_EMULATION_OPERATION_CMP,
+};
+
+/**
+ * @brief Read a sign-extended immediate or displacement from the instruction
+ *
+ * @param Buffer
+ * @param Size 1, 2, or 4
+ *
+ * @return INT64
+ */
+static INT64
+MonitorEmulationReadSigned(const UINT8 * Buffer, UINT32 Size)
+{
+    switch (Size)
+    {
+    case 1:
+        return (INT8)Buffer[0];
+    case 2:
+        return (INT16)(Buffer[0] | (Buffer[1] << 8));
+    default:
+        return (INT32)(Buffer[0] | (Buffer[1] << 8) | (Buffer[2] << 16) | ((UINT32)Buffer[3] << 24));
+    }
+}
+
+/**
+ * @brief Decode an instruction that accesses the memory
+ * @details only the 64-bit mode instructions that are emulated by
+ * MonitorEmulationExecute are decoded
+ *
+ * @param Buffer the bytes of the instruction
+ * @param BufferSize number of the available bytes
+ * @param Instruction the decoded instruction
+ *
+ * @return BOOLEAN FALSE if the instruction is not emulated
+ */
+BOOLEAN
+MonitorEmulationDecode(const UINT8 * Buffer, UINT32 BufferSize, PMONITOR_EMULATION_INSTRUCTION Instruction)
+{
+    UINT32  Offset             = 0;
+    UINT8   Rex                = 0;
+    UINT8   RepeatPrefix       = 0;
+    BOOLEAN OperandSizePrefix  = FALSE;
+    BOOLEAN IsByteOperation    = FALSE;
+    BOOLEAN HasModRm           = TRUE;
+    BOOLEAN IsRegisterFullSize = FALSE;
+    UINT32  ImmediateSize      = 0;
+    UINT32  ModRmReg;
+    UINT32  Mod;
+    UINT32  Rm;
+    UINT8   Opcode;
+
+    RtlZeroMemory(Instruction, sizeof(MONITOR_EMULATION_INSTRUCTION));
+
+    Instruction->BaseRegister  = MONITOR_EMULATION_NO_REGISTER;
+    Instruction->IndexRegister = MONITOR_EMULATION_NO_REGISTER;
+
+    //
+    // Legacy prefixes (LOCK and the address-size prefix are not emulated)
+    //
+    for (; Offset < BufferSize; Offset++)
+    {
+        switch (Buffer[Offset])
+        {
+        case 0x66:
+            OperandSizePrefix = TRUE;
+            continue;
+
+        case 0xf2:
+        case 0xf3:
+            RepeatPrefix = Buffer[Offset];
+            continue;
+
+        case 0x26:
+        case 0x2e:
+        case 0x36:
+        case 0x3e:
+
+            //
+            // These segments are ignored in the 64-bit mode
+            //
+            continue;
+
+        case 0x64:
+        case 0x65:
+            Instruction->SegmentPrefix = Buffer[Offset];
+            continue;
+
+        default:
+            break;
+        }
+
+        break;
+    }
+
+    //
+    // The REX prefix should be right before the opcode
+    //
+    if (Offset < BufferSize && (Buffer[Offset] & 0xf0) == 0x40)
+    {
+        Rex = Buffer[Offset++];
+    }
+
+    if (Offset >= BufferSize)
+    {
+        return FALSE;
+    }
+
+    Opcode = Buffer[Offset++];
+
+    Instruction->OperandSize = (Rex & 0x8) ? 8 : (OperandSizePrefix ? 2 : 4);
+
+    if (Opcode < 0x40 && (Opcode & 0x7) < 4)
+    {
+        //
+        // ADD, OR, AND, SUB, XOR, and CMP between a register and the memory
+        //
+        if (MonitorEmulationArithmeticOperations[Opcode >> 3] == -1)
+        {
+            return FALSE;
+        }
+
+        Instruction->Operation           = (MONITOR_EMULATION_OPERATION)MonitorEmulationArithmeticOperations[Opcode >> 3];
+        Instruction->IsMemoryDestination = !(Opcode & 0x2);
+        IsByteOperation                  = !(Opcode & 0x1);
+    }
+    else
+    {
+        switch (Opcode)
+        {
+        case 0x88:
+        case 0x89:
+            Instruction->Operation           = MONITOR_EMULATION_OPERATION_MOV_TO_MEMORY;
+            Instruction->IsMemoryDestination = TRUE;
+            IsByteOperation                  = Opcode == 0x88;
+            break;
+
+        case 0x8a:
+        case 0x8b:
+            Instruction->Operation = MONITOR_EMULATION_OPERATION_MOV_FROM_MEMORY;
+            IsByteOperation        = Opcode == 0x8a;
+            break;
+
+        case 0x84:
+        case 0x85:
+            Instruction->Operation           = MONITOR_EMULATION_OPERATION_TEST;
+            Instruction->IsMemoryDestination = TRUE;
+            IsByteOperation                  = Opcode == 0x84;
+            break;
+
+        case 0x80:
+        case 0x81:
+        case 0x83:
+        case 0xc6:
+        case 0xc7:
+        case 0xf6:
+        case 0xf7:
+
+            //
+            // The operation is selected by the 'reg' field after reading the ModR/M
+            //
+            Instruction->IsMemoryDestination = TRUE;
+            Instruction->HasImmediate        = TRUE;
+            IsByteOperation                  = Opcode == 0x80 || Opcode == 0xc6 || Opcode == 0xf6;
+            ImmediateSize                    = (IsByteOperation || Opcode == 0x83) ? 1 : (Instruction->OperandSize == 2 ? 2 : 4);
+            break;
+
+        case 0x63:
+
+            //
+            // MOVSXD (without REX.W it's a 32-bit move)
+            //
+            if (OperandSizePrefix)
+            {
+                return FALSE;
+            }
+
+            Instruction->Operation  = MONITOR_EMULATION_OPERATION_MOVSX;
+            Instruction->MemorySize = 4;
+            IsRegisterFullSize      = TRUE;
+            break;
+
+        case 0x0f:
+
+            if (Offset >= BufferSize)
+            {
+                return FALSE;
+            }
+
+            Opcode = Buffer[Offset++];
+
+            if (Opcode != 0xb6 && Opcode != 0xb7 && Opcode != 0xbe && Opcode != 0xbf)
+            {
+                return FALSE;
+            }
+
+            Instruction->Operation  = (Opcode & 0x8) ? MONITOR_EMULATION_OPERATION_MOVSX : MONITOR_EMULATION_OPERATION_MOVZX;
+            Instruction->MemorySize = (Opcode & 0x1) ? 2 : 1;
+            IsRegisterFullSize      = TRUE;
+            break;
+
+        case 0xa4:
+        case 0xa5:
+        case 0xaa:
+        case 0xab:
+
+            //
+            // String moves and stores (REPNE also repeats them)
+            //
+            Instruction->Operation           = (Opcode & 0x8) ? MONITOR_EMULATION_OPERATION_STOS : MONITOR_EMULATION_OPERATION_MOVS;
+            Instruction->IsMemoryDestination = TRUE;
+            Instruction->HasRepeatPrefix     = RepeatPrefix != 0;
+            IsByteOperation                  = !(Opcode & 0x1);
+            HasModRm                         = FALSE;
+            RepeatPrefix                     = 0;
+            break;
+
+        default:
+            return FALSE;
+        }
+    }
+
+    //
+    // Only the string instructions are repeated
+    //
+    if (RepeatPrefix != 0)
+    {
+        return FALSE;
+    }
+
+    if (IsByteOperation)
+    {
+        Instruction->OperandSize = 1;
+    }
+
+    if (!IsRegisterFullSize)
+    {
+        Instruction->MemorySize = Instruction->OperandSize;
+    }
+
+    if (HasModRm)
+    {
+        if (Offset >= BufferSize)
+        {
+            return FALSE;
+        }
+
+        Mod      = Buffer[Offset] >> 6;
+        ModRmReg = (Buffer[Offset] >> 3) & 0x7;
+        Rm       = Buffer[Offset] & 0x7;
+        Offset++;
+
+        if (Mod == 3)
+        {
+            //
+            // Register operands don't access the memory
+            //
+            return FALSE;
+        }
+
+        if (Instruction->HasImmediate)
+        {
+            switch (Opcode)
+            {
+            case 0xc6:
+            case 0xc7:
+
+                if (ModRmReg != 0)
+                {
+                    return FALSE;
+                }
+
+                Instruction->Operation = MONITOR_EMULATION_OPERATION_MOV_TO_MEMORY;
+                break;
+
+            case 0xf6:
+            case 0xf7:
+
+                if (ModRmReg != 0)
+                {
+                    return FALSE;
+                }
+
+                Instruction->Operation = MONITOR_EMULATION_OPERATION_TEST;
+                break;
+
+            default:
+
+                if (MonitorEmulationArithmeticOperations[ModRmReg] == -1)
+                {
+                    return FALSE;
+                }
+
+                Instruction->Operation = (MONITOR_EMULATION_OPERATION)MonitorEmulationArithmeticOperations[ModRmReg];
+                break;
+            }
+        }
+        else
+        {
+            Instruction->Register = ModRmReg | ((Rex & 0x4) << 1);
+
+            //
+            // Without REX, the byte registers 4 to 7 are AH, CH, DH, and BH
+            //
+            if (Instruction->OperandSize == 1 && Rex == 0 && Instruction->Register >= 4)
+            {
+                Instruction->Register -= 4;
+                Instruction->IsHighByteRegister = TRUE;
+            }
+        }
+
+        if (Rm == 4)
+        {
+            //
+            // The SIB byte
+            //
+            if (Offset >= BufferSize)
+            {
+                return FALSE;
+            }
+
+            Instruction->Scale         = 1 << (Buffer[Offset] >> 6);
+            Instruction->IndexRegister = ((Buffer[Offset] >> 3) & 0x7) | ((Rex & 0x2) << 2);
+            Instruction->BaseRegister  = (Buffer[Offset] & 0x7) | ((Rex & 0x1) << 3);
+            Offset++;
+
+            if (Instruction->IndexRegister == 4)
+            {
+                Instruction->IndexRegister = MONITOR_EMULATION_NO_REGISTER;
+            }
+
+            if ((Instruction->BaseRegister & 0x7) == 5 && Mod == 0)
+            {
+                Instruction->BaseRegister = MONITOR_EMULATION_NO_REGISTER;
+                Mod                       = 2; // 32-bit displacement
+            }
+        }
+        else if (Rm == 5 && Mod == 0)
+        {
+            Instruction->IsRipRelative = TRUE;
+            Mod                        = 2; // 32-bit displacement
+        }
+        else
+        {
+            Instruction->BaseRegister = Rm | ((Rex & 0x1) << 3);
+        }
+
+        if (Mod != 0)
+        {
+            if (Offset + (Mod == 1 ? 1 : 4) > BufferSize)
+            {
+                return FALSE;
+            }
+
+            Instruction->Displacement = MonitorEmulationReadSigned(&Buffer[Offset], Mod == 1 ? 1 : 4);
+            Offset += Mod == 1 ? 1 : 4;
+        }
+    }
+
+    if (ImmediateSize != 0)
+    {
+        if (Offset + ImmediateSize > BufferSize)
+        {
+            return FALSE;
+        }
+
+        Instruction->Immediate = (UINT64)MonitorEmulationReadSigned(&Buffer[Offset], ImmediateSize);
+        Offset += ImmediateSize;
+    }
+
+    if (Offset > MONITOR_EMULATION_MAXIMUM_INSTRUCTION_LENGTH)
+    {
+        return FALSE;
+    }
+
+    Instruction->Length       = Offset;
+    Instruction->IsMemoryRead = Instruction->Operation != MONITOR_EMULATION_OPERATION_MOV_TO_MEMORY &&
+                                Instruction->Operation != MONITOR_EMULATION_OPERATION_STOS;
+
+    Instruction->IsMemoryWritten = Instruction->IsMemoryDestination &&
+                                   Instruction->Operation != MONITOR_EMULATION_OPERATION_CMP &&
+                                   Instruction->Operation != MONITOR_EMULATION_OPERATION_TEST;
+
+    return TRUE;
+}
+
+/**
+ * @brief Compute the status flags of an arithmetic operation
+ *
+ * @param Operation
+ * @param Size size of the operands
+ * @param Destination
+ * @param Source
+ * @param Result
+ *
+ * @return UINT64 the status flags
+ */
+static UINT64
+MonitorEmulationComputeFlags(MONITOR_EMULATION_OPERATION Operation, UINT32 Size, UINT64 Destination, UINT64 Source, UINT64 Result)
+{
+    UINT64 Mask    = Size == 8 ? ~0ull : (1ull << (Size * 8)) - 1;
+    UINT64 SignBit = 1ull << (Size * 8 - 1);
+    UINT64 Flags   = 0;
+    UINT8  Parity  = (UINT8)Result;
+
+    Destination &= Mask;
+    Source &= Mask;
+    Result &= Mask;
+
+    Parity ^= Parity >> 4;
+    Parity ^= Parity >> 2;
+    Parity ^= Parity >> 1;
+
+    if (!(Parity & 1))
+    {
+        Flags |= X86_FLAGS_PF;
+    }
+
+    if (Result == 0)
+    {
+        Flags |= X86_FLAGS_ZF;
+    }
+
+    if (Result & SignBit)
+    {
+        Flags |= X86_FLAGS_SF;
+    }
+
+    if (Operation == MONITOR_EMULATION_OPERATION_ADD)
+    {
+        Flags |= Result < Destination ? X86_FLAGS_CF : 0;
+        Flags |= ((Destination ^ Result) & (Source ^ Result) & SignBit) ? X86_FLAGS_OF : 0;
+        Flags |= ((Destination ^ Source ^ Result) & 0x10) ? X86_FLAGS_AF : 0;
+    }
+    else if (Operation == MONITOR_EMULATION_OPERATION_SUB || Operation == MONITOR_EMULATION_OPERATION_CMP)
+    {
+        Flags |= Destination < Source ? X86_FLAGS_CF : 0;
+        Flags |= ((Destination ^ Source) & (Destination ^ Result) & SignBit) ? X86_FLAGS_OF : 0;
+        Flags |= ((Destination ^ Source ^ Result) & 0x10) ? X86_FLAGS_AF : 0;
+    }
+
+    //
+    // The logical operations clear CF and OF (AF is undefined and cleared)
+    //
+    return Flags;
+}
+
+/**
+ * @brief Read a register operand
+ *
+ * @param Gprs
+ * @param Register
+ * @param IsHighByteRegister
+ * @param Size
+ *
+ * @return UINT64
+ */
+static UINT64
+MonitorEmulationReadRegister(UINT64 * Gprs, UINT32 Register, BOOLEAN IsHighByteRegister, UINT32 Size)
+{
+    if (IsHighByteRegister)
+    {
+        return (Gprs[Register] >> 8) & 0xff;
+    }
+
+    return Size == 8 ? Gprs[Register] : Gprs[Register] & ((1ull << (Size * 8)) - 1);
+}
+
+/**
+ * @brief Write a register operand
+ * @details 32-bit results are zero-extended, 8-bit and 16-bit results
+ * keep the rest of the register
+ *
+ * @param Gprs
+ * @param Register
+ * @param IsHighByteRegister
+ * @param Size
+ * @param Value
+ *
+ * @return VOID
+ */
+static VOID
+MonitorEmulationWriteRegister(UINT64 * Gprs, UINT32 Register, BOOLEAN IsHighByteRegister, UINT32 Size, UINT64 Value)
+{
+    if (IsHighByteRegister)
+    {
+        Gprs[Register] = (Gprs[Register] & ~0xff00ull) | ((Value & 0xff) << 8);
+    }
+    else if (Size == 1)
+    {
+        Gprs[Register] = (Gprs[Register] & ~0xffull) | (Value & 0xff);
+    }
+    else if (Size == 2)
+    {
+        Gprs[Register] = (Gprs[Register] & ~0xffffull) | (Value & 0xffff);
+    }
+    else if (Size == 4)
+    {
+        Gprs[Register] = Value & 0xffffffff;
+    }
+    else
+    {
+        Gprs[Register] = Value;
+    }
+}
+
+/**
+ * @brief Emulate a (REP) MOVS or STOS instruction
+ * @details the whole destination (and source) should be in a single page
+ * and the source and the destination should not overlap
+ *
+ * @param Instruction
+ * @param Gprs
+ * @param Rflags
+ * @param LinearAddress the linear address that caused the violation
+ * @param PhysicalAddress the physical address that caused the violation
+ * @param IsWriteViolation
+ * @param Memory routines that access the memory
+ *
+ * @return BOOLEAN FALSE if the instruction is not emulated
+ */
+static BOOLEAN
+MonitorEmulationExecuteString(PMONITOR_EMULATION_INSTRUCTION Instruction,
+                              UINT64 *                       Gprs,
+                              UINT64 *                       Rflags,
+                              UINT64                         LinearAddress,
+                              UINT64                         PhysicalAddress,
+                              BOOLEAN                        IsWriteViolation,
+                              PMONITOR_EMULATION_MEMORY      Memory)
+{
+    UINT8   Buffer[MONITOR_EMULATION_MAXIMUM_STRING_SIZE];
+    UINT64  Count      = Instruction->HasRepeatPrefix ? Gprs[MONITOR_EMULATION_REGISTER_RCX] : 1;
+    BOOLEAN IsBackward = (*Rflags & X86_FLAGS_DF) != 0;
+    UINT64  Destination;
+    UINT64  Source;
+    UINT64  Size;
+
+    //
+    // The violation should be caused by the first store
+    //
+    if (!IsWriteViolation || LinearAddress != Gprs[MONITOR_EMULATION_REGISTER_RDI])
+    {
+        return FALSE;
+    }
+
+    if (Count == 0 || Count > MONITOR_EMULATION_MAXIMUM_STRING_SIZE / Instruction->MemorySize)
+    {
+        return FALSE;
+    }
+
+    Size        = Count * Instruction->MemorySize;
+    Destination = IsBackward ? Gprs[MONITOR_EMULATION_REGISTER_RDI] - (Size - Instruction->MemorySize) : Gprs[MONITOR_EMULATION_REGISTER_RDI];
+
+    if (PAGE_ALIGN(Destination) != PAGE_ALIGN(Gprs[MONITOR_EMULATION_REGISTER_RDI]) ||
+        PAGE_ALIGN(Destination + Size - 1) != PAGE_ALIGN(Gprs[MONITOR_EMULATION_REGISTER_RDI]))
+    {
+        return FALSE;
+    }
+
+    if (Instruction->Operation == MONITOR_EMULATION_OPERATION_STOS)
+    {
+        for (UINT64 i = 0; i < Size; i++)
+        {
+            Buffer[i] = (UINT8)(Gprs[MONITOR_EMULATION_REGISTER_RAX] >> ((i % Instruction->MemorySize) * 8));
+        }
+    }
+    else
+    {
+        Source = (IsBackward ? Gprs[MONITOR_EMULATION_REGISTER_RSI] - (Size - Instruction->MemorySize) : Gprs[MONITOR_EMULATION_REGISTER_RSI]) + Instruction->SegmentBase;
+
+        //
+        // The first load is already performed by the guest, so the page of the
+        // source is readable (and not monitored)
+        //
+        if (PAGE_ALIGN(Source) != PAGE_ALIGN(Source + Size - 1) ||
+            (Source < Destination + Size && Destination < Source + Size))
+        {
+            return FALSE;
+        }
+
+        if (!Memory->ReadLinear(Source, Buffer, (UINT32)Size, Memory->Context))
+        {
+            return FALSE;
+        }
+    }
+
+    if (!Memory->WritePhysical(PhysicalAddress - (Gprs[MONITOR_EMULATION_REGISTER_RDI] - Destination), Buffer, (UINT32)Size, Memory->Context))
+    {
+        return FALSE;
+    }
+
+    //
+    // Update the registers as if all of the iterations are performed
+    //
+    if (Instruction->Operation == MONITOR_EMULATION_OPERATION_MOVS)
+    {
+        Gprs[MONITOR_EMULATION_REGISTER_RSI] = IsBackward ? Gprs[MONITOR_EMULATION_REGISTER_RSI] - Size : Gprs[MONITOR_EMULATION_REGISTER_RSI] + Size;
+    }
+
+    Gprs[MONITOR_EMULATION_REGISTER_RDI] = IsBackward ? Gprs[MONITOR_EMULATION_REGISTER_RDI] - Size : Gprs[MONITOR_EMULATION_REGISTER_RDI] + Size;
+
+    if (Instruction->HasRepeatPrefix)
+    {
+        Gprs[MONITOR_EMULATION_REGISTER_RCX] = 0;
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Emulate a decoded instruction
+ * @details the registers and the flags are only changed if the instruction
+ * is emulated, the memory operand should be in a single page
+ *
+ * @param Instruction the decoded instruction
+ * @param Regs the guest registers
+ * @param Rflags the guest flags
+ * @param Rip address of the instruction
+ * @param LinearAddress the linear address that caused the violation
+ * @param PhysicalAddress the physical address that caused the violation
+ * @param IsWriteViolation whether the violation is caused by a write or not
+ * @param Memory routines that access the memory
+ *
+ * @return BOOLEAN FALSE if the instruction is not emulated
+ */
+BOOLEAN
+MonitorEmulationExecute(PMONITOR_EMULATION_INSTRUCTION Instruction,
+                        GUEST_REGS *                   Regs,
+                        UINT64 *                       Rflags,
+                        UINT64                         Rip,
+                        UINT64                         LinearAddress,
+                        UINT64                         PhysicalAddress,
+                        BOOLEAN                        IsWriteViolation,
+                        PMONITOR_EMULATION_MEMORY      Memory)
+{
+    UINT64 * Gprs        = (UINT64 *)Regs;
+    UINT64   Address     = Instruction->SegmentBase + (UINT64)Instruction->Displacement;
+    UINT64   MemoryValue = 0;
+    UINT64   Destination;
+    UINT64   Source;
+    UINT64   Result;
+    UINT64   Flags;
+
+    if (Instruction->Operation == MONITOR_EMULATION_OPERATION_MOVS || Instruction->Operation == MONITOR_EMULATION_OPERATION_STOS)
+    {
+        return MonitorEmulationExecuteString(Instruction, Gprs, Rflags, LinearAddress, PhysicalAddress, IsWriteViolation, Memory);
+    }
+
+    //
+    // A write violation is only caused by the instructions that store
+    //
+    if ((IsWriteViolation && !Instruction->IsMemoryWritten) || (!IsWriteViolation && !Instruction->IsMemoryRead))
+    {
+        return FALSE;
+    }
+
+    //
+    // RSP is not changed by the emulation
+    //
+    if (!Instruction->IsMemoryDestination && Instruction->Register == MONITOR_EMULATION_REGISTER_RSP && !Instruction->IsHighByteRegister)
+    {
+        return FALSE;
+    }
+
+    //
+    // Compute the effective address and check it against the accessed address
+    //
+    if (Instruction->IsRipRelative)
+    {
+        Address += Rip + Instruction->Length;
+    }
+
+    if (Instruction->BaseRegister != MONITOR_EMULATION_NO_REGISTER)
+    {
+        Address += Gprs[Instruction->BaseRegister];
+    }
+
+    if (Instruction->IndexRegister != MONITOR_EMULATION_NO_REGISTER)
+    {
+        Address += Gprs[Instruction->IndexRegister] * Instruction->Scale;
+    }
+
+    if (Address != LinearAddress ||
+        (Address & (PAGE_SIZE - 1)) != (PhysicalAddress & (PAGE_SIZE - 1)) ||
+        (Address & (PAGE_SIZE - 1)) + Instruction->MemorySize > PAGE_SIZE)
+    {
+        return FALSE;
+    }
+
+    if (Instruction->IsMemoryRead &&
+        !Memory->ReadPhysical(PhysicalAddress, &MemoryValue, Instruction->MemorySize, Memory->Context))
+    {
+        return FALSE;
+    }
+
+    switch (Instruction->Operation)
+    {
+    case MONITOR_EMULATION_OPERATION_MOV_TO_MEMORY:
+
+        Result = Instruction->HasImmediate ? Instruction->Immediate : MonitorEmulationReadRegister(Gprs, Instruction->Register, Instruction->IsHighByteRegister, Instruction->OperandSize);
+
+        if (!Memory->WritePhysical(PhysicalAddress, &Result, Instruction->MemorySize, Memory->Context))
+        {
+            return FALSE;
+        }
+
+        break;
+
+    case MONITOR_EMULATION_OPERATION_MOV_FROM_MEMORY:
+    case MONITOR_EMULATION_OPERATION_MOVZX:
+
+        MonitorEmulationWriteRegister(Gprs, Instruction->Register, Instruction->IsHighByteRegister, Instruction->OperandSize, MemoryValue);
+        break;
+
+    case MONITOR_EMULATION_OPERATION_MOVSX:
+
+        Result = (UINT64)MonitorEmulationReadSigned((const UINT8 *)&MemoryValue, Instruction->MemorySize);
+
+        MonitorEmulationWriteRegister(Gprs, Instruction->Register, Instruction->IsHighByteRegister, Instruction->OperandSize, Result);
+        break;
+
+    default:
+
+        //
+        // Arithmetic and logical operations
+        //
+        Source = Instruction->HasImmediate ? Instruction->Immediate : MonitorEmulationReadRegister(Gprs, Instruction->Register, Instruction->IsHighByteRegister, Instruction->OperandSize);
+
+        if (Instruction->IsMemoryDestination)
+        {
+            Destination = MemoryValue;
+        }
+        else
+        {
+            Destination = Source;
+            Source      = MemoryValue;
+        }
+
+        switch (Instruction->Operation)
+        {
+        case MONITOR_EMULATION_OPERATION_ADD:
+            Result = Destination + Source;
+            break;
+        case MONITOR_EMULATION_OPERATION_OR:
+            Result = Destination | Source;
+            break;
+        case MONITOR_EMULATION_OPERATION_SUB:
+        case MONITOR_EMULATION_OPERATION_CMP:
+            Result = Destination - Source;
+            break;
+        case MONITOR_EMULATION_OPERATION_XOR:
+            Result = Destination ^ Source;
+            break;
+        default:
+            Result = Destination & Source;
+            break;
+        }
+
+        Flags = MonitorEmulationComputeFlags(Instruction->Operation, Instruction->OperandSize, Destination, Source, Result);
+
+        if (Instruction->IsMemoryWritten)
+        {
+            if (!Memory->WritePhysical(PhysicalAddress, &Result, Instruction->MemorySize, Memory->Context))
+            {
+                return FALSE;
+            }
+        }
+        else if (!Instruction->IsMemoryDestination &&
+                 Instruction->Operation != MONITOR_EMULATION_OPERATION_CMP &&
+                 Instruction->Operation != MONITOR_EMULATION_OPERATION_TEST)
+        {
+            MonitorEmulationWriteRegister(Gprs, Instruction->Register, Instruction->IsHighByteRegister, Instruction->OperandSize, Result);
+        }
+
+        *Rflags = (*Rflags & ~(UINT64)MONITOR_EMULATION_STATUS_FLAGS) | Flags;
+        break;
+    }
+
+    return TRUE;
+}
@@ -0,0 +1,152 @@
+/**
+ * @file MonitorEmulation.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of the decoder and executor of the emulated memory accesses
+ * @details
+ * @version 0.11
+ * @date 2024-10-27
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//				    Definitions	    			//
+//////////////////////////////////////////////////
+
+/**
+ * @brief Maximum length of an x86 instruction
+ *
+ */
+#define MONITOR_EMULATION_MAXIMUM_INSTRUCTION_LENGTH 15
+
+/**
+ * @brief Maximum number of bytes that are moved or stored by an
+ * emulated string instruction (REP MOVS/STOS)
+ * @details larger string instructions are executed by the guest
+ * (MTF) as they are likely to cross the page anyway
+ *
+ */
+#define MONITOR_EMULATION_MAXIMUM_STRING_SIZE 256
+
+/**
+ * @brief Indexes of the registers (in GUEST_REGS) that are used
+ * implicitly by the emulated instructions
+ *
+ */
+#define MONITOR_EMULATION_REGISTER_RAX 0
+#define MONITOR_EMULATION_REGISTER_RCX 1
+#define MONITOR_EMULATION_REGISTER_RSP 4
+#define MONITOR_EMULATION_REGISTER_RSI 6
+#define MONITOR_EMULATION_REGISTER_RDI 7
+
+/**
+ * @brief Shows that a register operand is not used
+ *
+ */
+#define MONITOR_EMULATION_NO_REGISTER 0xffffffff
+
+/**
+ * @brief The status flags that are changed by the emulated instructions
+ *
+ */
+#define MONITOR_EMULATION_STATUS_FLAGS (X86_FLAGS_CF | X86_FLAGS_PF | X86_FLAGS_AF | X86_FLAGS_ZF | X86_FLAGS_SF | X86_FLAGS_OF)
+
+//////////////////////////////////////////////////
+//				    Structures	    			//
+//////////////////////////////////////////////////
+
+/**
+ * @brief The operations that are emulated
+ *
+ */
+typedef enum _MONITOR_EMULATION_OPERATION
+{
+    MONITOR_EMULATION_OPERATION_MOV_TO_MEMORY,
+    MONITOR_EMULATION_OPERATION_MOV_FROM_MEMORY,
+    MONITOR_EMULATION_OPERATION_MOVZX,
+    MONITOR_EMULATION_OPERATION_MOVSX,
+    MONITOR_EMULATION_OPERATION_ADD,
+    MONITOR_EMULATION_OPERATION_OR,
+    MONITOR_EMULATION_OPERATION_AND,
+    MONITOR_EMULATION_OPERATION_SUB,
+    MONITOR_EMULATION_OPERATION_XOR,
+    MONITOR_EMULATION_OPERATION_CMP,
+    MONITOR_EMULATION_OPERATION_TEST,
+    MONITOR_EMULATION_OPERATION_MOVS,
+    MONITOR_EMULATION_OPERATION_STOS,
+
+} MONITOR_EMULATION_OPERATION;
+
+/**
+ * @brief A decoded instruction that accesses the memory
+ *
+ */
+typedef struct _MONITOR_EMULATION_INSTRUCTION
+{
+    MONITOR_EMULATION_OPERATION Operation;
+    UINT32                      Length;              // length of the instruction
+    UINT32                      OperandSize;         // size of the register (or immediate) operand
+    UINT32                      MemorySize;          // size of each access to the memory
+    BOOLEAN                     IsMemoryDestination; // the memory is the first operand
+    BOOLEAN                     IsMemoryRead;
+    BOOLEAN                     IsMemoryWritten;
+    BOOLEAN                     HasImmediate;       // the source operand is the immediate
+    BOOLEAN                     IsHighByteRegister; // the register is AH, CH, DH, or BH
+    BOOLEAN                     HasRepeatPrefix;
+    UINT8                       SegmentPrefix; // 0x64 (FS), 0x65 (GS), or zero
+    UINT32                      Register;      // index of the register operand (in GUEST_REGS)
+    UINT64                      Immediate;     // sign-extended immediate
+    UINT64                      SegmentBase;   // base of the FS or GS segment (if any)
+
+    //
+    // Effective address = Base + Index * Scale + Displacement
+    //
+    BOOLEAN IsRipRelative;
+    UINT32  BaseRegister;  // MONITOR_EMULATION_NO_REGISTER if there is no base
+    UINT32  IndexRegister; // MONITOR_EMULATION_NO_REGISTER if there is no index
+    UINT32  Scale;
+    INT64   Displacement;
+
+} MONITOR_EMULATION_INSTRUCTION, *PMONITOR_EMULATION_INSTRUCTION;
+
+/**
+ * @brief The routine that reads or writes the memory of an emulated access
+ * @details returns FALSE if the memory is not accessible
+ *
+ */
+typedef BOOLEAN (*MONITOR_EMULATION_ACCESS_MEMORY)(UINT64 Address,
+                                                  PVOID  Buffer,
+                                                  UINT32 Size,
+                                                  PVOID  Context);
+
+/**
+ * @brief Routines that access the memory of the emulated instructions
+ *
+ */
+typedef struct _MONITOR_EMULATION_MEMORY
+{
+    MONITOR_EMULATION_ACCESS_MEMORY ReadPhysical;  // the accessed (monitored) page
+    MONITOR_EMULATION_ACCESS_MEMORY WritePhysical; // the accessed (monitored) page
+    MONITOR_EMULATION_ACCESS_MEMORY ReadLinear;    // the source of MOVS
+    PVOID                           Context;       // passed to the routines
+
+} MONITOR_EMULATION_MEMORY, *PMONITOR_EMULATION_MEMORY;
+
+//////////////////////////////////////////////////
+//				      Functions					//
+//////////////////////////////////////////////////
+
+BOOLEAN
+MonitorEmulationDecode(const UINT8 * Buffer, UINT32 BufferSize, PMONITOR_EMULATION_INSTRUCTION Instruction);
+
+BOOLEAN
+MonitorEmulationExecute(PMONITOR_EMULATION_INSTRUCTION Instruction,
+                        GUEST_REGS *                   Regs,
+                        UINT64 *                       Rflags,
+                        UINT64                         Rip,
+                        UINT64                         LinearAddress,
+                        UINT64                         PhysicalAddress,
+                        BOOLEAN                        IsWriteViolation,
+                        PMONITOR_EMULATION_MEMORY      Memory);
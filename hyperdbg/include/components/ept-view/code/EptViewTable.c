@@ -0,0 +1,224 @@
+/**
+ * @file EptViewTable.c
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief The paging tables of the EPT views
+ * @details A view has its own PML3 and shares the PML2 and PML1 tables with
+ * the EPT of its core until a page of the view differs, the tables are copied
+ * and translated by the given routines, so the same code is used by the
+ * hypervisor (from the pre-allocated pools) and by the tests
+ * @version 0.11
+ * @date 2024-10-29
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Copy a paging table for a view
+ *
+ * @param Source The table to copy
+ * @param Memory Routines that allocate and translate the tables
+ *
+ * @return PEPT_VIEW_PAGING_TABLE NULL if no table is left
+ */
+static PEPT_VIEW_PAGING_TABLE
+EptViewTableCopy(PVOID Source, PEPT_VIEW_TABLE_MEMORY Memory)
+{
+    PEPT_VIEW_PAGING_TABLE Table;
+
+    Table = Memory->AllocateTable(Memory->Context);
+
+    if (Table == NULL)
+    {
+        return NULL;
+    }
+
+    RtlCopyMemory(&Table->Entries[0], Source, sizeof(Table->Entries));
+
+    return Table;
+}
+
+/**
+ * @brief Get the PML1 entry of a physical address in a view, if the
+ * address is mapped by a large page then the PML2 entry is returned
+ * @details the entry might belong to the core's EPT if the paging
+ * table is not copied for the view
+ *
+ * @param ViewPml3 The PML3 of the view
+ * @param PhysicalAddress The target physical address
+ * @param IsLargePage Shows whether it's a large page or not
+ * @param Memory Routines that allocate and translate the tables
+ *
+ * @return PVOID Return EPT_PTE or EPT_PDE_2MB
+ */
+PVOID
+EptViewTableGetPml1OrPml2Entry(EPT_PDPTE *            ViewPml3,
+                               UINT64                 PhysicalAddress,
+                               BOOLEAN *              IsLargePage,
+                               PEPT_VIEW_TABLE_MEMORY Memory)
+{
+    EPT_PDE_2MB * PML2;
+    EPT_PTE *     PML1;
+
+    //
+    // Addresses above 512GB are invalid because it is > physical address bus width
+    //
+    if ((PhysicalAddress >> 39) != 0)
+    {
+        return NULL;
+    }
+
+    PML2 = (EPT_PDE_2MB *)Memory->PhysicalToVirtual((UINT64)ViewPml3[(PhysicalAddress >> 30) & 0x1ff].PageFrameNumber * PAGE_SIZE, Memory->Context);
+
+    if (PML2 == NULL)
+    {
+        return NULL;
+    }
+
+    PML2 = &PML2[(PhysicalAddress >> 21) & 0x1ff];
+
+    if (PML2->LargePage)
+    {
+        *IsLargePage = TRUE;
+        return PML2;
+    }
+
+    *IsLargePage = FALSE;
+
+    PML1 = (EPT_PTE *)Memory->PhysicalToVirtual((UINT64)((EPT_PDE *)PML2)->PageFrameNumber * PAGE_SIZE, Memory->Context);
+
+    if (PML1 == NULL)
+    {
+        return NULL;
+    }
+
+    return &PML1[(PhysicalAddress >> 12) & 0x1ff];
+}
+
+/**
+ * @brief Get the PML1 entry of a physical address in a view
+ * @details the entry might belong to the core's EPT if the PML1 is
+ * not copied for the view
+ *
+ * @param ViewPml3 The PML3 of the view
+ * @param PhysicalAddress The target physical address
+ * @param Memory Routines that allocate and translate the tables
+ *
+ * @return EPT_PTE * NULL if the page is not mapped by a PML1
+ */
+EPT_PTE *
+EptViewTableGetPml1Entry(EPT_PDPTE *            ViewPml3,
+                         UINT64                 PhysicalAddress,
+                         PEPT_VIEW_TABLE_MEMORY Memory)
+{
+    PVOID   Entry;
+    BOOLEAN IsLargePage = FALSE;
+
+    Entry = EptViewTableGetPml1OrPml2Entry(ViewPml3, PhysicalAddress, &IsLargePage, Memory);
+
+    if (Entry == NULL || IsLargePage)
+    {
+        return NULL;
+    }
+
+    return (EPT_PTE *)Entry;
+}
+
+/**
+ * @brief Set the entry of a page in a view
+ * @details should be called after the page is split in the core's EPT, the PML2
+ * and the PML1 of the page are copied (once) from the core's EPT, other paging
+ * tables remain shared and the core's EPT is never changed
+ *
+ * @param ViewPml3 The PML3 of the view
+ * @param BasePml3 The PML3 of the core's EPT
+ * @param PhysicalAddress The physical address of the page
+ * @param Entry The entry of the page in the view
+ * @param Memory Routines that allocate and translate the tables
+ *
+ * @return BOOLEAN FALSE if the page is not split or no table is left
+ */
+BOOLEAN
+EptViewTableSetEntry(EPT_PDPTE *            ViewPml3,
+                     EPT_PDPTE *            BasePml3,
+                     UINT64                 PhysicalAddress,
+                     EPT_PTE                Entry,
+                     PEPT_VIEW_TABLE_MEMORY Memory)
+{
+    PEPT_VIEW_PAGING_TABLE NewTable;
+    EPT_PDE_2MB *          PML2;
+    EPT_PDE_2MB *          BasePML2;
+    EPT_PTE *              PML1;
+    EPT_PDE                NewPointer;
+    UINT64                 PML3Index = (PhysicalAddress >> 30) & 0x1ff;
+    UINT64                 PML2Index = (PhysicalAddress >> 21) & 0x1ff;
+
+    if ((PhysicalAddress >> 39) != 0)
+    {
+        return FALSE;
+    }
+
+    //
+    // The page is split in the core's EPT before reaching here
+    //
+    BasePML2 = (EPT_PDE_2MB *)Memory->PhysicalToVirtual((UINT64)BasePml3[PML3Index].PageFrameNumber * PAGE_SIZE, Memory->Context);
+    BasePML2 = &BasePML2[PML2Index];
+
+    if (BasePML2->LargePage)
+    {
+        return FALSE;
+    }
+
+    //
+    // Copy the PML2 of the 1GB region if it's still shared with the core's EPT
+    //
+    if (ViewPml3[PML3Index].PageFrameNumber == BasePml3[PML3Index].PageFrameNumber)
+    {
+        NewTable = EptViewTableCopy(BasePML2 - PML2Index, Memory);
+
+        if (NewTable == NULL)
+        {
+            return FALSE;
+        }
+
+        ViewPml3[PML3Index].PageFrameNumber = Memory->VirtualToPhysical(NewTable, Memory->Context) / PAGE_SIZE;
+    }
+
+    PML2 = (EPT_PDE_2MB *)Memory->PhysicalToVirtual((UINT64)ViewPml3[PML3Index].PageFrameNumber * PAGE_SIZE, Memory->Context);
+    PML2 = &PML2[PML2Index];
+
+    //
+    // Copy the PML1 of the 2MB region if it's still shared with the core's EPT (or
+    // if the PML2 was copied before the region is split in the core's EPT)
+    //
+    if (PML2->LargePage || ((EPT_PDE *)PML2)->PageFrameNumber == ((EPT_PDE *)BasePML2)->PageFrameNumber)
+    {
+        NewTable = EptViewTableCopy(Memory->PhysicalToVirtual((UINT64)((EPT_PDE *)BasePML2)->PageFrameNumber * PAGE_SIZE, Memory->Context),
+                                    Memory);
+
+        if (NewTable == NULL)
+        {
+            return FALSE;
+        }
+
+        //
+        // The other pages of the region that differ in the view
+        //
+        Memory->RestoreOriginalEntries(NewTable, PhysicalAddress & ~0x1fffffull, Memory->Context);
+
+        //
+        // The table is filled before being linked
+        //
+        NewPointer.AsUInt          = ((EPT_PDE *)BasePML2)->AsUInt;
+        NewPointer.PageFrameNumber = Memory->VirtualToPhysical(NewTable, Memory->Context) / PAGE_SIZE;
+
+        PML2->AsUInt = NewPointer.AsUInt;
+    }
+
+    PML1 = (EPT_PTE *)Memory->PhysicalToVirtual((UINT64)((EPT_PDE *)PML2)->PageFrameNumber * PAGE_SIZE, Memory->Context);
+
+    PML1[(PhysicalAddress >> 12) & 0x1ff].AsUInt = Entry.AsUInt;
+
+    return TRUE;
+}
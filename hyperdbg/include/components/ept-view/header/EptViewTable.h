@@ -0,0 +1,99 @@
+/**
+ * @file EptViewTable.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of the paging tables of the EPT views
+ * @details
+ * @version 0.11
+ * @date 2024-10-29
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//				   Constants					//
+//////////////////////////////////////////////////
+
+/**
+ * @brief Number of entries in each paging table of the EPT
+ *
+ */
+#define EPT_VIEW_TABLE_ENTRIES_COUNT 512
+
+//////////////////////////////////////////////////
+//				   Structures					//
+//////////////////////////////////////////////////
+
+/**
+ * @brief A PML2 or PML1 table that is copied for an EPT view
+ *
+ */
+typedef struct _EPT_VIEW_PAGING_TABLE
+{
+    DECLSPEC_ALIGN(PAGE_SIZE)
+    UINT64 Entries[EPT_VIEW_TABLE_ENTRIES_COUNT];
+
+} EPT_VIEW_PAGING_TABLE, *PEPT_VIEW_PAGING_TABLE;
+
+/**
+ * @brief The routine that allocates a paging table for a view
+ * @details returns NULL if no table is left
+ *
+ */
+typedef PEPT_VIEW_PAGING_TABLE (*EPT_VIEW_TABLE_ALLOCATE)(PVOID Context);
+
+/**
+ * @brief The routine that gets the physical address of a paging table
+ *
+ */
+typedef UINT64 (*EPT_VIEW_TABLE_VIRTUAL_TO_PHYSICAL)(PVOID Table, PVOID Context);
+
+/**
+ * @brief The routine that gets the paging table at a physical address
+ *
+ */
+typedef PVOID (*EPT_VIEW_TABLE_PHYSICAL_TO_VIRTUAL)(UINT64 Address, PVOID Context);
+
+/**
+ * @brief The routine that puts the original entries of the hooked pages of
+ * a 2MB region in the PML1 table that is copied for a view
+ *
+ */
+typedef VOID (*EPT_VIEW_TABLE_RESTORE_ORIGINAL_ENTRIES)(PEPT_VIEW_PAGING_TABLE Table, UINT64 PhysicalAddress, PVOID Context);
+
+/**
+ * @brief Routines that allocate and translate the paging tables of the views
+ *
+ */
+typedef struct _EPT_VIEW_TABLE_MEMORY
+{
+    EPT_VIEW_TABLE_ALLOCATE                 AllocateTable;
+    EPT_VIEW_TABLE_VIRTUAL_TO_PHYSICAL      VirtualToPhysical;
+    EPT_VIEW_TABLE_PHYSICAL_TO_VIRTUAL      PhysicalToVirtual;
+    EPT_VIEW_TABLE_RESTORE_ORIGINAL_ENTRIES RestoreOriginalEntries;
+    PVOID                                   Context; // passed to the routines
+
+} EPT_VIEW_TABLE_MEMORY, *PEPT_VIEW_TABLE_MEMORY;
+
+//////////////////////////////////////////////////
+//				   Functions					//
+//////////////////////////////////////////////////
+
+PVOID
+EptViewTableGetPml1OrPml2Entry(EPT_PDPTE *            ViewPml3,
+                               UINT64                 PhysicalAddress,
+                               BOOLEAN *              IsLargePage,
+                               PEPT_VIEW_TABLE_MEMORY Memory);
+
+EPT_PTE *
+EptViewTableGetPml1Entry(EPT_PDPTE *            ViewPml3,
+                         UINT64                 PhysicalAddress,
+                         PEPT_VIEW_TABLE_MEMORY Memory);
+
+BOOLEAN
+EptViewTableSetEntry(EPT_PDPTE *            ViewPml3,
+                     EPT_PDPTE *            BasePml3,
+                     UINT64                 PhysicalAddress,
+                     EPT_PTE                Entry,
+                     PEPT_VIEW_TABLE_MEMORY Memory);
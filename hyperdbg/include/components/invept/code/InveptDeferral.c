@@ -0,0 +1,106 @@
+/**
+ * @file InveptDeferral.c
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief The deferred invalidations of the EPT caches
+ * @details The edits of the EPT request an invalidation that is performed once
+ * before the next VM-entry of the core, the edits of the EPT of all cores advance
+ * a global generation instead. The INVEPT itself is performed by the caller, so
+ * the same bookkeeping is used by the hypervisor and by the tests
+ * @version 0.11
+ * @date 2024-10-30
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Request an invalidation of the EPT caches of a core
+ *
+ * @param Deferral The deferred invalidations of the core
+ * @param InvalidationType type of invalidation
+ *
+ * @return BOOLEAN FALSE if the type is not valid
+ */
+BOOLEAN
+InveptDeferralRequest(PINVEPT_DEFERRAL Deferral, INVEPT_TYPE InvalidationType)
+{
+    if (InvalidationType == InveptAllContext)
+    {
+        Deferral->Pending = InveptAllContext;
+    }
+    else if (InvalidationType == InveptSingleContext)
+    {
+        //
+        // An all-contexts invalidation covers the single-context one
+        //
+        if (Deferral->Pending != InveptAllContext)
+        {
+            Deferral->Pending = InveptSingleContext;
+        }
+    }
+    else
+    {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Request an invalidation (all contexts) of the EPT caches of all cores
+ *
+ * @param Generation The global generation of the EPT edits
+ *
+ * @return VOID
+ */
+VOID
+InveptDeferralAdvanceGeneration(volatile LONG64 * Generation)
+{
+    InterlockedIncrement64(Generation);
+}
+
+/**
+ * @brief Take the invalidation that should be performed before the next
+ * VM-entry of a core
+ * @details the generation is read before the invalidation, so the edits that
+ * are made during the invalidation are invalidated on the next VM-entry
+ *
+ * @param Deferral The deferred invalidations of the core
+ * @param Generation The global generation of the EPT edits
+ *
+ * @return UINT32 The type of the INVEPT (zero if nothing is pending)
+ */
+UINT32
+InveptDeferralTake(PINVEPT_DEFERRAL Deferral, volatile LONG64 * Generation)
+{
+    UINT64 CurrentGeneration = (UINT64)InterlockedCompareExchange64(Generation, 0, 0);
+    UINT32 InvalidationType  = Deferral->Pending;
+
+    if (Deferral->Generation != CurrentGeneration)
+    {
+        Deferral->Generation = CurrentGeneration;
+        InvalidationType     = InveptAllContext;
+    }
+
+    Deferral->Pending = 0;
+
+    return InvalidationType;
+}
+
+/**
+ * @brief Check whether an invalidation is pending for a core
+ * @details the EPT caches of the core might still hold the entries that are
+ * changed (e.g., by other cores) until the next VM-entry
+ *
+ * @param Deferral The deferred invalidations of the core
+ * @param Generation The global generation of the EPT edits
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+InveptDeferralIsPending(PINVEPT_DEFERRAL Deferral, volatile LONG64 * Generation)
+{
+    return Deferral->Pending != 0 ||
+           Deferral->Generation != (UINT64)InterlockedCompareExchange64(Generation, 0, 0);
+}
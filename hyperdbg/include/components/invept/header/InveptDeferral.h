@@ -0,0 +1,43 @@
+/**
+ * @file InveptDeferral.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of the deferred invalidations of the EPT caches
+ * @details
+ * @version 0.11
+ * @date 2024-10-30
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//				   Structures					//
+//////////////////////////////////////////////////
+
+/**
+ * @brief The deferred invalidations of the EPT caches of a core
+ *
+ */
+typedef struct _INVEPT_DEFERRAL
+{
+    UINT64 Generation; // The generation of the EPT edits that are invalidated on the core
+    UINT32 Pending;    // The type of the INVEPT that should be performed before the next VM-entry (zero if nothing is pending)
+
+} INVEPT_DEFERRAL, *PINVEPT_DEFERRAL;
+
+//////////////////////////////////////////////////
+//				   Functions					//
+//////////////////////////////////////////////////
+
+BOOLEAN
+InveptDeferralRequest(PINVEPT_DEFERRAL Deferral, INVEPT_TYPE InvalidationType);
+
+VOID
+InveptDeferralAdvanceGeneration(volatile LONG64 * Generation);
+
+UINT32
+InveptDeferralTake(PINVEPT_DEFERRAL Deferral, volatile LONG64 * Generation);
+
+BOOLEAN
+InveptDeferralIsPending(PINVEPT_DEFERRAL Deferral, volatile LONG64 * Generation);
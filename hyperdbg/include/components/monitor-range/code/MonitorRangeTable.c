@@ -0,0 +1,153 @@
+/**
+ * @file MonitorRangeTable.c
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief The EPT entries of the monitored ranges
+ * @details the original accesses of a protected entry are kept in the ignored
+ * bits of the entry itself, so they are restored correctly on each core and in
+ * each view, the tables are accessed by the given routines, so the same code is
+ * used by the hypervisor and by the tests
+ * @version 0.11
+ * @date 2024-10-31
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Change the access bits of a PML1 or a (large) PML2 entry
+ * @details the entries that are not protected are only changed by protecting
+ * them, so unprotecting or restoring an entry twice has no effect
+ *
+ * @param Entry The target entry
+ * @param MonitoredAccess The monitored access bits (MONITOR_RANGE_TABLE_ACCESS_MASK)
+ * @param Operation The operation on the entry
+ *
+ * @return VOID
+ */
+VOID
+MonitorRangeTableSetEntry(PVOID Entry, UINT64 MonitoredAccess, MONITOR_RANGE_TABLE_OPERATION Operation)
+{
+    UINT64 Value = *(UINT64 *)Entry;
+    UINT64 OriginalAccess;
+
+    if (!(Value & MONITOR_RANGE_TABLE_PROTECTED_FLAG))
+    {
+        if (Operation != MonitorRangeTableProtect)
+        {
+            return;
+        }
+
+        Value |= MONITOR_RANGE_TABLE_PROTECTED_FLAG | ((Value & MONITOR_RANGE_TABLE_ACCESS_MASK) << MONITOR_RANGE_TABLE_SAVED_ACCESS_SHIFT);
+    }
+
+    OriginalAccess = (Value >> MONITOR_RANGE_TABLE_SAVED_ACCESS_SHIFT) & MONITOR_RANGE_TABLE_ACCESS_MASK;
+    Value &= ~MONITOR_RANGE_TABLE_ACCESS_MASK;
+
+    switch (Operation)
+    {
+    case MonitorRangeTableProtect:
+    case MonitorRangeTableReprotect:
+
+        Value |= OriginalAccess & ~MonitoredAccess;
+        break;
+
+    case MonitorRangeTableUnprotect:
+
+        Value |= OriginalAccess;
+        break;
+
+    default:
+
+        Value |= OriginalAccess;
+        Value &= ~(MONITOR_RANGE_TABLE_PROTECTED_FLAG | (MONITOR_RANGE_TABLE_ACCESS_MASK << MONITOR_RANGE_TABLE_SAVED_ACCESS_SHIFT));
+        break;
+    }
+
+    *(UINT64 *)Entry = Value;
+}
+
+/**
+ * @brief Protect or restore a range in an EPT
+ * @details the large pages that are completely in the range are changed
+ * directly, the large pages at the edges of the range are split to protect
+ * them (or skipped if the tables can't be split) and they're never merged
+ *
+ * @param PhysicalBaseAddress The base address of the first page of the range
+ * @param PhysicalEndAddress The last byte of the last page of the range
+ * @param MonitoredAccess The monitored access bits (MONITOR_RANGE_TABLE_ACCESS_MASK)
+ * @param Operation MonitorRangeTableProtect or MonitorRangeTableRestore
+ * @param Memory Routines that access the tables
+ *
+ * @return BOOLEAN FALSE if an entry is not found or a large page is not split
+ */
+BOOLEAN
+MonitorRangeTableApply(UINT64                        PhysicalBaseAddress,
+                       UINT64                        PhysicalEndAddress,
+                       UINT64                        MonitoredAccess,
+                       MONITOR_RANGE_TABLE_OPERATION Operation,
+                       PMONITOR_RANGE_TABLE_MEMORY   Memory)
+{
+    UINT64    Region;
+    UINT64    StartOfPart;
+    UINT64    EndOfPart;
+    PVOID     Entry;
+    EPT_PTE * Pml1Entry;
+    BOOLEAN   IsLargePage = FALSE;
+
+    for (Region = PhysicalBaseAddress & ~(MONITOR_RANGE_TABLE_LARGE_PAGE_SIZE - 1); Region <= PhysicalEndAddress; Region += MONITOR_RANGE_TABLE_LARGE_PAGE_SIZE)
+    {
+        StartOfPart = Region < PhysicalBaseAddress ? PhysicalBaseAddress : Region;
+        EndOfPart   = Region + MONITOR_RANGE_TABLE_LARGE_PAGE_SIZE - 1 > PhysicalEndAddress ? PhysicalEndAddress : Region + MONITOR_RANGE_TABLE_LARGE_PAGE_SIZE - 1;
+
+        Entry = Memory->GetEntry(Region, &IsLargePage, Memory->Context);
+
+        if (Entry == NULL)
+        {
+            return FALSE;
+        }
+
+        if (IsLargePage)
+        {
+            if (StartOfPart == Region && EndOfPart == Region + MONITOR_RANGE_TABLE_LARGE_PAGE_SIZE - 1)
+            {
+                //
+                // The whole large page is in the range, so it's not split
+                //
+                MonitorRangeTableSetEntry(Entry, MonitoredAccess, Operation);
+                continue;
+            }
+
+            if (Operation != MonitorRangeTableProtect || Memory->SplitLargePage == NULL)
+            {
+                //
+                // The edges are split once they're protected, so this region
+                // is not protected
+                //
+                continue;
+            }
+
+            if (!Memory->SplitLargePage(Region, Memory->Context))
+            {
+                return FALSE;
+            }
+        }
+
+        //
+        // The PML1 entries of a region are in a single table
+        //
+        Pml1Entry = (EPT_PTE *)Memory->GetEntry(StartOfPart, &IsLargePage, Memory->Context);
+
+        if (Pml1Entry == NULL || IsLargePage)
+        {
+            return FALSE;
+        }
+
+        for (UINT64 i = 0; i <= (EndOfPart - StartOfPart) / PAGE_SIZE; i++)
+        {
+            MonitorRangeTableSetEntry(&Pml1Entry[i], MonitoredAccess, Operation);
+        }
+    }
+
+    return TRUE;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file MonitorRangeTable.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of the EPT entries of the monitored ranges
+ * @details
+ * @version 0.11
+ * @date 2024-10-31
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//				   Constants					//
+//////////////////////////////////////////////////
+
+/**
+ * @brief Size of the memory that is mapped by a PML2 entry (large page)
+ *
+ */
+#define MONITOR_RANGE_TABLE_LARGE_PAGE_SIZE (512ull * PAGE_SIZE)
+
+/**
+ * @brief The access bits (read, write, execute) of a PML1 or a PML2 entry
+ *
+ */
+#define MONITOR_RANGE_TABLE_ACCESS_MASK 0x7ull
+
+/**
+ * @brief The original access bits of a protected entry are saved in the
+ * bits 52:54 of the entry (ignored by the processor)
+ *
+ */
+#define MONITOR_RANGE_TABLE_SAVED_ACCESS_SHIFT 52
+
+/**
+ * @brief The entry is protected by a monitored range (bit 55, ignored by
+ * the processor)
+ *
+ */
+#define MONITOR_RANGE_TABLE_PROTECTED_FLAG (1ull << 55)
+
+//////////////////////////////////////////////////
+//				   Structures					//
+//////////////////////////////////////////////////
+
+/**
+ * @brief The operations on the entries of a monitored range
+ *
+ */
+typedef enum _MONITOR_RANGE_TABLE_OPERATION
+{
+    MonitorRangeTableProtect,   // save the original accesses and remove the monitored ones
+    MonitorRangeTableUnprotect, // allow the original accesses of a protected entry (e.g., for an instruction)
+    MonitorRangeTableReprotect, // remove the monitored accesses of a protected entry again
+    MonitorRangeTableRestore,   // restore the original accesses of a protected entry
+
+} MONITOR_RANGE_TABLE_OPERATION;
+
+/**
+ * @brief The routine that gets the PML1 entry of a physical address, or the
+ * PML2 entry if the address is mapped by a large page
+ *
+ */
+typedef PVOID (*MONITOR_RANGE_TABLE_GET_ENTRY)(UINT64 PhysicalAddress, BOOLEAN * IsLargePage, PVOID Context);
+
+/**
+ * @brief The routine that splits the large page of a physical address
+ *
+ */
+typedef BOOLEAN (*MONITOR_RANGE_TABLE_SPLIT_LARGE_PAGE)(UINT64 PhysicalAddress, PVOID Context);
+
+/**
+ * @brief Routines that access the paging tables of an EPT (or an EPT view)
+ *
+ */
+typedef struct _MONITOR_RANGE_TABLE_MEMORY
+{
+    MONITOR_RANGE_TABLE_GET_ENTRY        GetEntry;
+    MONITOR_RANGE_TABLE_SPLIT_LARGE_PAGE SplitLargePage; // NULL if the tables can't be split
+    PVOID                                Context;        // passed to the routines
+
+} MONITOR_RANGE_TABLE_MEMORY, *PMONITOR_RANGE_TABLE_MEMORY;
+
+//////////////////////////////////////////////////
+//				   Functions					//
+//////////////////////////////////////////////////
+
+VOID
+MonitorRangeTableSetEntry(PVOID Entry, UINT64 MonitoredAccess, MONITOR_RANGE_TABLE_OPERATION Operation);
+
+BOOLEAN
+MonitorRangeTableApply(UINT64                        PhysicalBaseAddress,
+                       UINT64                        PhysicalEndAddress,
+                       UINT64                        MonitoredAccess,
+                       MONITOR_RANGE_TABLE_OPERATION Operation,
+                       PMONITOR_RANGE_TABLE_MEMORY   Memory);
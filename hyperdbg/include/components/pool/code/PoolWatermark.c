@@ -0,0 +1,287 @@
+/**
+ * @file PoolWatermark.c
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief The watermarks and the usage statistics of the pre-allocated pools
+ * @details the counters of each intention decide when its pools should be
+ * replenished and how many pools are allocated, the allocations themselves
+ * are performed by the caller, so the same code is used by the pool manager
+ * and by the tests
+ * @version 0.11
+ * @date 2024-10-31
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Set the watermarks of an intention
+ * @details a high watermark of zero disables the replenishment
+ *
+ * @param State The state of the intention
+ * @param Size Size of each chunk
+ * @param LowWatermark Minimum number of free pools before requesting replenishment
+ * @param HighWatermark Number of free pools after replenishment
+ *
+ * @return BOOLEAN TRUE if the intention should be replenished
+ */
+BOOLEAN
+PoolWatermarkSet(PPOOL_WATERMARK_STATE State, SIZE_T Size, UINT32 LowWatermark, UINT32 HighWatermark)
+{
+    State->LowWatermark             = LowWatermark;
+    State->HighWatermark            = HighWatermark;
+    State->IsReplenishmentRequested = FALSE;
+
+    if (HighWatermark != 0)
+    {
+        State->Size = Size;
+
+        //
+        // Fill the intention up to the high watermark
+        //
+        if (State->NumberOfFreePools < HighWatermark)
+        {
+            State->IsReplenishmentRequested = TRUE;
+        }
+    }
+
+    return State->IsReplenishmentRequested;
+}
+
+/**
+ * @brief Update the counters of an intention after a request for a pool
+ * @details this function might be called from vmx-root, so the caller just
+ * sets a flag for the worker once the number of free pools drops to the low
+ * watermark
+ *
+ * @param State The state of the intention
+ * @param IsSuccessful Whether a free pool was found for the request or not
+ *
+ * @return BOOLEAN TRUE if the intention crossed its low watermark
+ */
+BOOLEAN
+PoolWatermarkCountRequest(PPOOL_WATERMARK_STATE State, BOOLEAN IsSuccessful)
+{
+    UINT32 Demand;
+
+    State->NumberOfRequests++;
+
+    if (IsSuccessful)
+    {
+        State->NumberOfFreePools--;
+        State->NumberOfBusyPools++;
+
+        if (State->NumberOfBusyPools > State->PeakNumberOfBusyPools)
+        {
+            State->PeakNumberOfBusyPools = State->NumberOfBusyPools;
+        }
+    }
+    else
+    {
+        State->NumberOfFailedRequests++;
+        State->NumberOfFailuresSinceLastAllocation++;
+    }
+
+    //
+    // The failed requests (since the last allocation) would have needed a pool too
+    //
+    Demand = State->NumberOfBusyPools + State->NumberOfFailuresSinceLastAllocation;
+
+    if (Demand > State->PeakDemand)
+    {
+        State->PeakDemand = Demand;
+    }
+
+    if (State->IsReplenishmentRequested)
+    {
+        //
+        // These requests are served from the pools below the low watermark
+        //
+        State->NumberOfRequestsSinceReplenishmentRequest++;
+
+        if (State->NumberOfRequestsSinceReplenishmentRequest > State->MaximumBurst)
+        {
+            State->MaximumBurst = State->NumberOfRequestsSinceReplenishmentRequest;
+        }
+    }
+    else if (State->HighWatermark != 0 && State->NumberOfFreePools <= State->LowWatermark)
+    {
+        State->IsReplenishmentRequested                  = TRUE;
+        State->NumberOfRequestsSinceReplenishmentRequest = 0;
+
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/**
+ * @brief Count a pool that is added to an intention
+ *
+ * @param State The state of the intention
+ * @param Size Size of the pool
+ *
+ * @return VOID
+ */
+VOID
+PoolWatermarkAddPool(PPOOL_WATERMARK_STATE State, SIZE_T Size)
+{
+    State->Size = Size;
+    State->NumberOfFreePools++;
+    State->NumberOfFailuresSinceLastAllocation = 0;
+}
+
+/**
+ * @brief Count a pool that is freed
+ *
+ * @param State The state of the intention
+ * @param IsBusy Whether the pool was used or not
+ *
+ * @return VOID
+ */
+VOID
+PoolWatermarkRemovePool(PPOOL_WATERMARK_STATE State, BOOLEAN IsBusy)
+{
+    if (IsBusy)
+    {
+        State->NumberOfBusyPools--;
+    }
+    else
+    {
+        State->NumberOfFreePools--;
+    }
+}
+
+/**
+ * @brief Get the number of the pools that should be allocated to replenish
+ * an intention
+ * @details the intention is refilled up to its high watermark in batches of
+ * POOL_WATERMARK_MAXIMUM_REPLENISHMENT_BATCH, the request is dropped if the
+ * intention is already refilled (e.g., by the 'prealloc' command)
+ *
+ * @param State The state of the intention
+ * @param Size Size of each pool
+ *
+ * @return UINT32 The number of pools, zero if nothing should be allocated
+ */
+UINT32
+PoolWatermarkGetReplenishmentCount(PPOOL_WATERMARK_STATE State, SIZE_T * Size)
+{
+    UINT32 Count;
+
+    if (!State->IsReplenishmentRequested)
+    {
+        return 0;
+    }
+
+    if (State->Size == 0 || State->NumberOfFreePools >= State->HighWatermark)
+    {
+        State->IsReplenishmentRequested = FALSE;
+        return 0;
+    }
+
+    Count = State->HighWatermark - State->NumberOfFreePools;
+
+    if (Count > POOL_WATERMARK_MAXIMUM_REPLENISHMENT_BATCH)
+    {
+        Count = POOL_WATERMARK_MAXIMUM_REPLENISHMENT_BATCH;
+    }
+
+    *Size = State->Size;
+
+    return Count;
+}
+
+/**
+ * @brief Update the state of an intention after its pools are allocated
+ *
+ * @param State The state of the intention
+ * @param Count The number of the requested pools
+ * @param IsSuccessful Whether all of the pools are allocated or not
+ *
+ * @return BOOLEAN TRUE if the intention should be replenished again
+ */
+BOOLEAN
+PoolWatermarkCompleteReplenishment(PPOOL_WATERMARK_STATE State, UINT32 Count, BOOLEAN IsSuccessful)
+{
+    if (!IsSuccessful)
+    {
+        //
+        // Don't retry until the next request crosses the low watermark
+        //
+        State->IsReplenishmentRequested = FALSE;
+        return FALSE;
+    }
+
+    State->NumberOfReplenishedPools += Count;
+
+    //
+    // Keep the request if the intention is still below the low watermark (the
+    // batch was not enough, or the pools are consumed in the meantime)
+    //
+    if (State->NumberOfFreePools > State->LowWatermark)
+    {
+        State->IsReplenishmentRequested = FALSE;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Get the usage statistics of an intention
+ *
+ * @param State The state of the intention
+ * @param Statistics The statistics
+ *
+ * @return VOID
+ */
+VOID
+PoolWatermarkQueryStatistics(PPOOL_WATERMARK_STATE State, PPOOL_MANAGER_INTENTION_STATISTICS Statistics)
+{
+    Statistics->Size                     = State->Size;
+    Statistics->NumberOfFreePools        = State->NumberOfFreePools;
+    Statistics->NumberOfBusyPools        = State->NumberOfBusyPools;
+    Statistics->PeakNumberOfBusyPools    = State->PeakNumberOfBusyPools;
+    Statistics->PeakDemand               = State->PeakDemand;
+    Statistics->MaximumBurst             = State->MaximumBurst;
+    Statistics->LowWatermark             = State->LowWatermark;
+    Statistics->HighWatermark            = State->HighWatermark;
+    Statistics->NumberOfRequests         = State->NumberOfRequests;
+    Statistics->NumberOfFailedRequests   = State->NumberOfFailedRequests;
+    Statistics->NumberOfReplenishedPools = State->NumberOfReplenishedPools;
+}
+
+/**
+ * @brief Get the number of the pools that should be pre-allocated for an
+ * intention based on its usage statistics
+ *
+ * @param Statistics The statistics of the intention
+ *
+ * @return UINT32 The number of the missing pools
+ */
+UINT32
+PoolWatermarkGetMissingPools(PPOOL_MANAGER_INTENTION_STATISTICS Statistics)
+{
+    if (Statistics->HighWatermark != 0)
+    {
+        //
+        // The pools are replenished in the background, so the low watermark
+        // should cover the requests until the replenishment is performed
+        //
+        if (Statistics->MaximumBurst > Statistics->LowWatermark)
+        {
+            return Statistics->MaximumBurst - Statistics->LowWatermark;
+        }
+    }
+    else if (Statistics->PeakDemand > Statistics->NumberOfFreePools + Statistics->NumberOfBusyPools)
+    {
+        //
+        // The pools are not enough for the maximum number of pools that were
+        // needed at the same time
+        //
+        return Statistics->PeakDemand - (Statistics->NumberOfFreePools + Statistics->NumberOfBusyPools);
+    }
+
+    return 0;
+}
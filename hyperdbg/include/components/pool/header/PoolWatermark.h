@@ -0,0 +1,85 @@
+/**
+ * @file PoolWatermark.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of the watermarks of the pre-allocated pools
+ * @details
+ * @version 0.11
+ * @date 2024-10-31
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//				   Constants					//
+//////////////////////////////////////////////////
+
+/**
+ * @brief Maximum number of pools that are allocated for an intention in
+ * a single replenishment pass
+ *
+ */
+#define POOL_WATERMARK_MAXIMUM_REPLENISHMENT_BATCH 64
+
+//////////////////////////////////////////////////
+//				   Structures					//
+//////////////////////////////////////////////////
+
+/**
+ * @brief State of the pools of an intention
+ * @details the state is protected by the caller, if the high watermark is
+ * set, the pools are replenished once the number of free pools drops to the
+ * low watermark
+ *
+ */
+typedef struct _POOL_WATERMARK_STATE
+{
+    SIZE_T  Size;
+    UINT32  NumberOfFreePools;
+    UINT32  NumberOfBusyPools;
+    UINT32  LowWatermark;
+    UINT32  HighWatermark;
+    BOOLEAN IsReplenishmentRequested;
+
+    //
+    // Usage statistics
+    //
+    UINT32 PeakNumberOfBusyPools;
+    UINT32 PeakDemand;
+    UINT32 NumberOfFailuresSinceLastAllocation;
+    UINT32 NumberOfRequestsSinceReplenishmentRequest;
+    UINT32 MaximumBurst;
+    UINT64 NumberOfRequests;
+    UINT64 NumberOfFailedRequests;
+    UINT64 NumberOfReplenishedPools;
+
+} POOL_WATERMARK_STATE, *PPOOL_WATERMARK_STATE;
+
+//////////////////////////////////////////////////
+//				   Functions					//
+//////////////////////////////////////////////////
+
+BOOLEAN
+PoolWatermarkSet(PPOOL_WATERMARK_STATE State, SIZE_T Size, UINT32 LowWatermark, UINT32 HighWatermark);
+
+BOOLEAN
+PoolWatermarkCountRequest(PPOOL_WATERMARK_STATE State, BOOLEAN IsSuccessful);
+
+VOID
+PoolWatermarkAddPool(PPOOL_WATERMARK_STATE State, SIZE_T Size);
+
+VOID
+PoolWatermarkRemovePool(PPOOL_WATERMARK_STATE State, BOOLEAN IsBusy);
+
+UINT32
+PoolWatermarkGetReplenishmentCount(PPOOL_WATERMARK_STATE State, SIZE_T * Size);
+
+BOOLEAN
+PoolWatermarkCompleteReplenishment(PPOOL_WATERMARK_STATE State, UINT32 Count, BOOLEAN IsSuccessful);
+
+VOID
+PoolWatermarkQueryStatistics(PPOOL_WATERMARK_STATE State, PPOOL_MANAGER_INTENTION_STATISTICS Statistics);
+
+UINT32
+PoolWatermarkGetMissingPools(PPOOL_MANAGER_INTENTION_STATISTICS Statistics);
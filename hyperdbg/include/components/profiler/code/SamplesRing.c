@@ -0,0 +1,136 @@
+/**
+ * @file SamplesRing.c
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief The ring of the samples of the profiler
+ * @details the samples are written by the vm-exit handler of the owner
+ * core and read by the user-mode, the same code is used by the profiler
+ * and by the tests
+ * @version 0.11
+ * @date 2024-11-01
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Discard the samples and the counters of the ring
+ * @details the samples itself are not needed to be cleared
+ *
+ * @param Ring The samples ring
+ *
+ * @return VOID
+ */
+VOID
+SamplesRingReset(PPROFILER_SAMPLES_RING Ring)
+{
+    Ring->Head           = 0;
+    Ring->Tail           = 0;
+    Ring->TotalSamples   = 0;
+    Ring->DroppedSamples = 0;
+}
+
+/**
+ * @brief Get the entry of the next sample
+ * @details should only be called by the owner core, the sample is not
+ * visible to the reader until it's published
+ *
+ * @param Ring The samples ring
+ *
+ * @return PDEBUGGER_PROFILER_SAMPLE NULL if the ring is full (the sample
+ * is dropped)
+ */
+PDEBUGGER_PROFILER_SAMPLE
+SamplesRingAcquireEntry(PPROFILER_SAMPLES_RING Ring)
+{
+    Ring->TotalSamples++;
+
+    //
+    // The ring is full, the reader is not fast enough
+    //
+    if (Ring->Head - Ring->Tail >= PROFILER_SAMPLES_RING_CAPACITY)
+    {
+        Ring->DroppedSamples++;
+        return NULL;
+    }
+
+    return &Ring->Samples[Ring->Head % PROFILER_SAMPLES_RING_CAPACITY];
+}
+
+/**
+ * @brief Publish the sample that is acquired by SamplesRingAcquireEntry
+ *
+ * @param Ring The samples ring
+ *
+ * @return VOID
+ */
+VOID
+SamplesRingPublishEntry(PPROFILER_SAMPLES_RING Ring)
+{
+    //
+    // The sample should be completely written before it's published
+    //
+    MemoryBarrier();
+
+    Ring->Head++;
+}
+
+/**
+ * @brief Read (and remove) the samples of the ring
+ * @details should only be called by a single reader
+ *
+ * @param Ring The samples ring
+ * @param Samples The buffer of the samples
+ * @param MaximumNumberOfSamples The maximum number of samples that could
+ * be placed in the buffer
+ *
+ * @return UINT32 Number of the samples that are read
+ */
+UINT32
+SamplesRingRead(PPROFILER_SAMPLES_RING Ring, PDEBUGGER_PROFILER_SAMPLE Samples, UINT32 MaximumNumberOfSamples)
+{
+    UINT32 Head = Ring->Head;
+    UINT32 Tail = Ring->Tail;
+    UINT32 Count;
+    UINT32 Index;
+    UINT32 FirstPart;
+
+    //
+    // The samples before the head are completely written
+    //
+    MemoryBarrier();
+
+    Count = Head - Tail;
+
+    if (Count > MaximumNumberOfSamples)
+    {
+        Count = MaximumNumberOfSamples;
+    }
+
+    //
+    // Copy the samples (the ring might be wrapped)
+    //
+    Index     = Tail % PROFILER_SAMPLES_RING_CAPACITY;
+    FirstPart = PROFILER_SAMPLES_RING_CAPACITY - Index;
+
+    if (FirstPart > Count)
+    {
+        FirstPart = Count;
+    }
+
+    RtlCopyMemory(Samples, &Ring->Samples[Index], FirstPart * sizeof(DEBUGGER_PROFILER_SAMPLE));
+
+    if (Count > FirstPart)
+    {
+        RtlCopyMemory(&Samples[FirstPart], &Ring->Samples[0], (Count - FirstPart) * sizeof(DEBUGGER_PROFILER_SAMPLE));
+    }
+
+    //
+    // The samples are copied, the core can reuse their entries
+    //
+    MemoryBarrier();
+
+    Ring->Tail = Tail + Count;
+
+    return Count;
+}
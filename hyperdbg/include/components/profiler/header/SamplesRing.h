@@ -0,0 +1,60 @@
+/**
+ * @file SamplesRing.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of the ring of the samples of the profiler
+ * @details
+ * @version 0.11
+ * @date 2024-11-01
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//				   Constants					//
+//////////////////////////////////////////////////
+
+/**
+ * @brief Capacity of the ring of the samples of the profiler on each core
+ * (should be a power of two)
+ *
+ */
+#define PROFILER_SAMPLES_RING_CAPACITY 4096
+
+//////////////////////////////////////////////////
+//				   Structures					//
+//////////////////////////////////////////////////
+
+/**
+ * @brief The ring of the samples of the profiler on each core
+ * @details It's a single-producer single-consumer ring, the samples are
+ * only added in vmx-root mode of the owner core and the new samples are
+ * dropped if the ring is full, thus the reader never races with the writer
+ *
+ */
+typedef struct _PROFILER_SAMPLES_RING
+{
+    volatile UINT32          Head;           // The next sample that is written (only changed by the owner core)
+    volatile UINT32          Tail;           // The next sample that is read (only changed by the reader)
+    UINT64                   TotalSamples;   // Number of the samples taken on the core
+    UINT64                   DroppedSamples; // Number of the samples dropped as the ring was full
+    DEBUGGER_PROFILER_SAMPLE Samples[PROFILER_SAMPLES_RING_CAPACITY];
+
+} PROFILER_SAMPLES_RING, *PPROFILER_SAMPLES_RING;
+
+//////////////////////////////////////////////////
+//				   Functions					//
+//////////////////////////////////////////////////
+
+VOID
+SamplesRingReset(PPROFILER_SAMPLES_RING Ring);
+
+PDEBUGGER_PROFILER_SAMPLE
+SamplesRingAcquireEntry(PPROFILER_SAMPLES_RING Ring);
+
+VOID
+SamplesRingPublishEntry(PPROFILER_SAMPLES_RING Ring);
+
+UINT32
+SamplesRingRead(PPROFILER_SAMPLES_RING Ring, PDEBUGGER_PROFILER_SAMPLE Samples, UINT32 MaximumNumberOfSamples);
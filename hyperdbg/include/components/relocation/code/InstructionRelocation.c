@@ -0,0 +1,230 @@
+/**
+ * @file InstructionRelocation.c
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Relocation of (64-bit) instructions into trampolines
+ * @details The trampoline executes the instruction and jumps after the original
+ * instruction, it's used by the hypervisor for the displaced execution of the
+ * hidden breakpoints and by the tests
+ * @version 0.11
+ * @date 2024-10-30
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+#include "Zydis/Zydis.h"
+
+/**
+ * @brief Write an absolute jump that doesn't use the stack
+ * @details jmp qword ptr [rip+0] followed by the target address
+ *
+ * @param TargetBuffer
+ * @param TargetAddress
+ *
+ * @return VOID
+ */
+static VOID
+InstructionRelocationWriteAbsoluteJump(PCHAR TargetBuffer, UINT64 TargetAddress)
+{
+    TargetBuffer[0] = (CHAR)0xff;
+    TargetBuffer[1] = 0x25;
+
+    *((PUINT32)&TargetBuffer[2]) = 0;
+    *((PUINT64)&TargetBuffer[6]) = TargetAddress;
+}
+
+/**
+ * @brief Check whether the memory operands of the instruction are safe to be executed
+ * from the trampoline or not
+ * @details the exceptions of the trampoline can't be handled by the exception handlers
+ * (SEH) of the original function, thus, only the instructions that are not expected to
+ * cause exceptions are relocated (the memory operands should be either on the stack or
+ * RIP-relative, or only compute the address)
+ *
+ * @param Instruction
+ * @param Operands
+ * @param IsRipRelative Set if the instruction has a RIP-relative operand
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+InstructionRelocationCheckOperands(ZydisDecodedInstruction * Instruction,
+                                   ZydisDecodedOperand *     Operands,
+                                   BOOLEAN *                 IsRipRelative)
+{
+    *IsRipRelative = FALSE;
+
+    for (UINT32 i = 0; i < Instruction->operand_count; i++)
+    {
+        if (Operands[i].type != ZYDIS_OPERAND_TYPE_MEMORY)
+        {
+            continue;
+        }
+
+        if (Operands[i].mem.type != ZYDIS_MEMOP_TYPE_MEM && Operands[i].mem.type != ZYDIS_MEMOP_TYPE_AGEN)
+        {
+            return FALSE;
+        }
+
+        if (Operands[i].mem.base == ZYDIS_REGISTER_RIP)
+        {
+            *IsRipRelative = TRUE;
+        }
+        else if (Operands[i].mem.type == ZYDIS_MEMOP_TYPE_MEM && Operands[i].mem.base != ZYDIS_REGISTER_RSP)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Relocate a (64-bit) instruction into a trampoline
+ * @details the trampoline executes the instruction and then jumps to the next
+ * instruction of the original address, the relative jumps are converted to absolute
+ * jumps and the displacement of the RIP-relative operands are fixed up
+ *
+ * @param InstructionBuffer The bytes of the instruction
+ * @param BufferLength The number of available bytes in the instruction buffer
+ * @param OriginalAddress The address of the instruction
+ * @param Trampoline The buffer to write the trampoline
+ * @param TrampolineAddress The address that the trampoline will be executed from
+ * @param TrampolineSize The size of the trampoline buffer
+ *
+ * @return UINT32 The size of the trampoline or zero if the instruction can't be relocated
+ */
+UINT32
+InstructionRelocationRelocate(PVOID  InstructionBuffer,
+                              UINT32 BufferLength,
+                              UINT64 OriginalAddress,
+                              PCHAR  Trampoline,
+                              UINT64 TrampolineAddress,
+                              UINT32 TrampolineSize)
+{
+    ZydisDecoder            Decoder;
+    ZydisDecodedInstruction Instruction;
+    ZydisDecodedOperand     Operands[ZYDIS_MAX_OPERAND_COUNT];
+    BOOLEAN                 IsRipRelative;
+    UINT64                  NextInstruction;
+    UINT64                  BranchTarget;
+    INT64                   Displacement;
+    UINT8                   ConditionCode;
+
+    if (!ZYAN_SUCCESS(ZydisDecoderInit(&Decoder, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64)) ||
+        !ZYAN_SUCCESS(ZydisDecoderDecodeFull(&Decoder, InstructionBuffer, BufferLength, &Instruction, Operands)))
+    {
+        return 0;
+    }
+
+    //
+    // The calls and interrupts push the address of the trampoline, and the
+    // faulting instructions report it, so they are not relocated
+    //
+    if (Instruction.meta.category == ZYDIS_CATEGORY_CALL ||
+        Instruction.meta.category == ZYDIS_CATEGORY_INTERRUPT ||
+        Instruction.meta.category == ZYDIS_CATEGORY_SYSCALL ||
+        Instruction.mnemonic == ZYDIS_MNEMONIC_UD0 ||
+        Instruction.mnemonic == ZYDIS_MNEMONIC_UD1 ||
+        Instruction.mnemonic == ZYDIS_MNEMONIC_UD2)
+    {
+        return 0;
+    }
+
+    if (!InstructionRelocationCheckOperands(&Instruction, Operands, &IsRipRelative))
+    {
+        return 0;
+    }
+
+    NextInstruction = OriginalAddress + Instruction.length;
+
+    //
+    // ZYDIS_ATTRIB_IS_RELATIVE is also set for the RIP-relative memory operands,
+    // so the relative branches are recognized by their immediate
+    //
+    if (Instruction.raw.imm[0].is_relative)
+    {
+        BranchTarget = NextInstruction + Instruction.raw.imm[0].value.s;
+
+        if (Instruction.mnemonic == ZYDIS_MNEMONIC_JMP)
+        {
+            if (TrampolineSize < INSTRUCTION_RELOCATION_ABSOLUTE_JUMP_SIZE)
+            {
+                return 0;
+            }
+
+            InstructionRelocationWriteAbsoluteJump(Trampoline, BranchTarget);
+
+            return INSTRUCTION_RELOCATION_ABSOLUTE_JUMP_SIZE;
+        }
+
+        //
+        // Only the Jcc instructions (not JrCXZ, LOOPcc, XBEGIN) can be converted to a
+        // 32-bit conditional jump over the jump back, followed by a jump to the target
+        //
+        if (Instruction.opcode_map == ZYDIS_OPCODE_MAP_DEFAULT && (Instruction.opcode & 0xf0) == 0x70)
+        {
+            ConditionCode = Instruction.opcode & 0xf;
+        }
+        else if (Instruction.opcode_map == ZYDIS_OPCODE_MAP_0F && (Instruction.opcode & 0xf0) == 0x80)
+        {
+            ConditionCode = Instruction.opcode & 0xf;
+        }
+        else
+        {
+            return 0;
+        }
+
+        if (TrampolineSize < INSTRUCTION_RELOCATION_CONDITIONAL_JUMP_SIZE + (2 * INSTRUCTION_RELOCATION_ABSOLUTE_JUMP_SIZE))
+        {
+            return 0;
+        }
+
+        Trampoline[0] = 0x0f;
+        Trampoline[1] = (CHAR)(0x80 | ConditionCode);
+
+        *((PUINT32)&Trampoline[2]) = INSTRUCTION_RELOCATION_ABSOLUTE_JUMP_SIZE;
+
+        InstructionRelocationWriteAbsoluteJump(&Trampoline[INSTRUCTION_RELOCATION_CONDITIONAL_JUMP_SIZE], NextInstruction);
+        InstructionRelocationWriteAbsoluteJump(&Trampoline[INSTRUCTION_RELOCATION_CONDITIONAL_JUMP_SIZE + INSTRUCTION_RELOCATION_ABSOLUTE_JUMP_SIZE],
+                                               BranchTarget);
+
+        return INSTRUCTION_RELOCATION_CONDITIONAL_JUMP_SIZE + (2 * INSTRUCTION_RELOCATION_ABSOLUTE_JUMP_SIZE);
+    }
+
+    if (TrampolineSize < (UINT32)Instruction.length + INSTRUCTION_RELOCATION_ABSOLUTE_JUMP_SIZE)
+    {
+        return 0;
+    }
+
+    if (IsRipRelative)
+    {
+        //
+        // The displacement of a RIP-relative operand is always 32-bit, and
+        // it's relative to the next instruction which is at the same offset
+        // in the trampoline (even if an immediate follows the displacement)
+        //
+        if (Instruction.raw.disp.size != 32 || Instruction.raw.disp.offset + sizeof(INT32) > Instruction.length)
+        {
+            return 0;
+        }
+
+        Displacement = (INT64)(NextInstruction + Instruction.raw.disp.value) - (INT64)(TrampolineAddress + Instruction.length);
+
+        if (Displacement < MINLONG || Displacement > MAXLONG)
+        {
+            return 0;
+        }
+    }
+
+    RtlCopyMemory(Trampoline, InstructionBuffer, Instruction.length);
+
+    if (IsRipRelative)
+    {
+        *((PINT32)&Trampoline[Instruction.raw.disp.offset]) = (INT32)Displacement;
+    }
+
+    InstructionRelocationWriteAbsoluteJump(&Trampoline[Instruction.length], NextInstruction);
+
+    return Instruction.length + INSTRUCTION_RELOCATION_ABSOLUTE_JUMP_SIZE;
+}
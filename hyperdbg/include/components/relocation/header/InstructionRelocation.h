@@ -0,0 +1,40 @@
+/**
+ * @file InstructionRelocation.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of the relocation of instructions into trampolines
+ * @details
+ * @version 0.11
+ * @date 2024-10-30
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//				   Constants					//
+//////////////////////////////////////////////////
+
+/**
+ * @brief Size of the absolute jump (jmp qword ptr [rip+0] followed by the address)
+ *
+ */
+#define INSTRUCTION_RELOCATION_ABSOLUTE_JUMP_SIZE 14
+
+/**
+ * @brief Size of a conditional jump with a 32-bit displacement
+ *
+ */
+#define INSTRUCTION_RELOCATION_CONDITIONAL_JUMP_SIZE 6
+
+//////////////////////////////////////////////////
+//				   Functions					//
+//////////////////////////////////////////////////
+
+UINT32
+InstructionRelocationRelocate(PVOID  InstructionBuffer,
+                              UINT32 BufferLength,
+                              UINT64 OriginalAddress,
+                              PCHAR  Trampoline,
+                              UINT64 TrampolineAddress,
+                              UINT32 TrampolineSize);
@@ -0,0 +1,403 @@
+/**
+ * @file MultiPatternSearch.c
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief The bit-parallel automaton of the multi-pattern search
+ * @details The automaton only scans the buffers that are given to it,
+ * reading the memory (and resuming the search) is up to the caller
+ * @version 0.11
+ * @date 2024-10-26
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Compile the patterns of the multi-pattern search into
+ * the bit-parallel automaton and reset the progress of the search
+ *
+ * @param SearchRequest request of the multi-pattern search
+ * @param Automaton the automaton to be filled
+ * @return BOOLEAN whether the patterns and the ranges are valid or not
+ */
+BOOLEAN
+SearchMultiplePatternsCompile(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS  SearchRequest,
+                              PSEARCH_MULTIPLE_PATTERNS_AUTOMATON Automaton)
+{
+    UINT32                   UsedBits[SEARCH_MULTIPLE_PATTERNS_MAXIMUM_WORDS] = {0};
+    PDEBUGGER_SEARCH_PATTERN Pattern;
+    UINT32                   Word;
+    UINT32                   Bit;
+
+    if (SearchRequest->NumberOfPatterns == 0 || SearchRequest->NumberOfPatterns > MaximumSearchPatterns ||
+        SearchRequest->NumberOfRanges == 0 || SearchRequest->NumberOfRanges > MaximumSearchRanges)
+    {
+        return FALSE;
+    }
+
+    if (SearchRequest->MemoryType != SEARCH_VIRTUAL_MEMORY && SearchRequest->MemoryType != SEARCH_PHYSICAL_MEMORY)
+    {
+        return FALSE;
+    }
+
+    for (UINT32 i = 0; i < SearchRequest->NumberOfRanges; i++)
+    {
+        if (SearchRequest->Ranges[i].Length == 0 ||
+            SearchRequest->Ranges[i].Address + SearchRequest->Ranges[i].Length < SearchRequest->Ranges[i].Address)
+        {
+            return FALSE;
+        }
+    }
+
+    //
+    // The table is larger than anything else, only the used words are cleared
+    //
+    Automaton->NumberOfWords             = 0;
+    Automaton->NumberOfSaturatedPatterns = 0;
+    RtlZeroMemory(Automaton->StartBytes, sizeof(Automaton->StartBytes));
+
+    //
+    // The search starts from the first range
+    //
+    Automaton->RangeIndex = 0;
+    Automaton->Address    = SearchRequest->Ranges[0].Address;
+    SearchMultiplePatternsResetStates(Automaton);
+
+    for (UINT32 i = 0; i < SearchRequest->NumberOfPatterns; i++)
+    {
+        Pattern = &SearchRequest->Patterns[i];
+
+        if (Pattern->Length == 0 || Pattern->Length > MaximumSearchPatternLength)
+        {
+            return FALSE;
+        }
+
+        //
+        // Find the first word that has enough free bits for the pattern
+        //
+        for (Word = 0; Word < Automaton->NumberOfWords; Word++)
+        {
+            if (UsedBits[Word] + Pattern->Length <= 64)
+            {
+                break;
+            }
+        }
+
+        if (Word == Automaton->NumberOfWords)
+        {
+            if (Word == SEARCH_MULTIPLE_PATTERNS_MAXIMUM_WORDS)
+            {
+                return FALSE;
+            }
+
+            Automaton->NumberOfWords++;
+            Automaton->StartMasks[Word] = 0;
+            Automaton->EndMasks[Word]   = 0;
+
+            for (UINT32 Byte = 0; Byte < 256; Byte++)
+            {
+                Automaton->Table[Byte][Word] = 0;
+            }
+        }
+
+        Bit = UsedBits[Word];
+        UsedBits[Word] += Pattern->Length;
+
+        Automaton->PatternStartBits[i]  = (UINT8)Bit;
+        Automaton->ResultsPerPattern[i] = 0;
+
+        Automaton->StartMasks[Word] |= 1ull << Bit;
+        Automaton->EndMasks[Word] |= 1ull << (Bit + Pattern->Length - 1);
+        Automaton->EndBitToPatternId[Word][Bit + Pattern->Length - 1] = (UINT8)i;
+
+        //
+        // Each position accepts the bytes that are equal to the pattern in
+        // the bits of the mask
+        //
+        for (UINT32 Position = 0; Position < Pattern->Length; Position++)
+        {
+            for (UINT32 Byte = 0; Byte < 256; Byte++)
+            {
+                if (((Byte ^ Pattern->Bytes[Position]) & Pattern->Masks[Position]) == 0)
+                {
+                    Automaton->Table[Byte][Word] |= 1ull << (Bit + Position);
+
+                    if (Position == 0)
+                    {
+                        Automaton->StartBytes[Byte] = TRUE;
+                    }
+                }
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Reset the partial matches of the automaton
+ * @details matches don't cross the ranges and the pages that are
+ * not valid
+ *
+ * @param Automaton the compiled automaton
+ * @return VOID
+ */
+VOID
+SearchMultiplePatternsResetStates(PSEARCH_MULTIPLE_PATTERNS_AUTOMATON Automaton)
+{
+    RtlZeroMemory(Automaton->States, sizeof(Automaton->States));
+    Automaton->ActiveStates = 0;
+}
+
+/**
+ * @brief Scan a buffer (a part of a range) with the automaton
+ *
+ * @details This function can be called from vmx-root mode
+ * the partial matches of the previous buffer are continued, and a
+ * result is reported for each (pattern, address) that ends in the
+ * buffer
+ *
+ * @param SearchRequest request of the multi-pattern search
+ * @param Automaton the compiled automaton
+ * @param Buffer the bytes of the memory
+ * @param Size the size of the buffer
+ * @param Address the address of the first byte of the buffer
+ * @param Results the buffer to save the results (MaximumSearchMultiplePatternsResults)
+ * @param NumberOfResults the number of the saved results (updated)
+ * @param IsFinished set to TRUE if all of the patterns reached their limit
+ * @param IsResultsFull set to TRUE if the results are full
+ * @return UINT32 the number of the scanned bytes, it's less than the size
+ * if the scan is stopped because of the results
+ */
+UINT32
+SearchMultiplePatternsScanChunk(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS        SearchRequest,
+                                PSEARCH_MULTIPLE_PATTERNS_AUTOMATON       Automaton,
+                                BYTE *                                    Buffer,
+                                UINT32                                    Size,
+                                UINT64                                    Address,
+                                PDEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT Results,
+                                UINT32 *                                  NumberOfResults,
+                                BOOLEAN *                                 IsFinished,
+                                BOOLEAN *                                 IsResultsFull)
+{
+    UINT64   States[SEARCH_MULTIPLE_PATTERNS_MAXIMUM_WORDS];
+    UINT64   ActiveStates  = Automaton->ActiveStates;
+    UINT32   NumberOfWords = Automaton->NumberOfWords;
+    UINT32   Offset;
+    UINT64   Matches;
+    ULONG    EndBit;
+    UINT32   PatternId;
+    UINT64 * AcceptedBits;
+
+    RtlCopyMemory(States, Automaton->States, sizeof(States));
+
+    for (Offset = 0; Offset < Size; Offset++)
+    {
+        if (ActiveStates == 0)
+        {
+            //
+            // No pattern is partially matched, skip the bytes that
+            // can't start any of the patterns
+            //
+            while (Offset < Size && !Automaton->StartBytes[Buffer[Offset]])
+            {
+                Offset++;
+            }
+
+            if (Offset == Size)
+            {
+                break;
+            }
+        }
+
+        AcceptedBits = Automaton->Table[Buffer[Offset]];
+        ActiveStates = 0;
+
+        for (UINT32 Word = 0; Word < NumberOfWords; Word++)
+        {
+            States[Word] = ((States[Word] << 1) | Automaton->StartMasks[Word]) & AcceptedBits[Word];
+            ActiveStates |= States[Word];
+
+            Matches = States[Word] & Automaton->EndMasks[Word];
+
+            while (Matches != 0)
+            {
+                _BitScanForward64(&EndBit, Matches);
+                Matches &= Matches - 1;
+
+                PatternId = Automaton->EndBitToPatternId[Word][EndBit];
+
+                Results[*NumberOfResults].Address   = Address + Offset + 1 - SearchRequest->Patterns[PatternId].Length;
+                Results[*NumberOfResults].PatternId = PatternId;
+                Results[*NumberOfResults].Reserved  = 0;
+                (*NumberOfResults)++;
+
+                Automaton->ResultsPerPattern[PatternId]++;
+
+                if (SearchRequest->MaximumResultsPerPattern != 0 &&
+                    Automaton->ResultsPerPattern[PatternId] == SearchRequest->MaximumResultsPerPattern)
+                {
+                    //
+                    // The pattern reached its limit, it never starts or matches again
+                    //
+                    Automaton->StartMasks[Word] &= ~(1ull << Automaton->PatternStartBits[PatternId]);
+                    Automaton->EndMasks[Word] &= ~(1ull << EndBit);
+                    Automaton->NumberOfSaturatedPatterns++;
+
+                    if (Automaton->NumberOfSaturatedPatterns == SearchRequest->NumberOfPatterns)
+                    {
+                        *IsFinished = TRUE;
+                    }
+                }
+
+                //
+                // Each byte might match all of the patterns, so the byte is
+                // finished before stopping
+                //
+                if (*NumberOfResults > MaximumSearchMultiplePatternsResults - SearchRequest->NumberOfPatterns)
+                {
+                    *IsResultsFull = TRUE;
+                }
+            }
+        }
+
+        if (*IsFinished || *IsResultsFull)
+        {
+            //
+            // The rest of the buffer is scanned in the next call
+            //
+            Offset++;
+            break;
+        }
+    }
+
+    //
+    // Save the partial matches for the next buffer
+    //
+    RtlCopyMemory(Automaton->States, States, sizeof(States));
+    Automaton->ActiveStates = ActiveStates;
+
+    return Offset;
+}
+
+/**
+ * @brief Search several patterns in the ranges of the request
+ *
+ * @details The search continues from where the previous call stopped (the
+ * automaton should be compiled by SearchMultiplePatternsCompile before
+ * the first call), each range is read once (page by page), the pages
+ * that are not valid are skipped, and a result is reported for each
+ * (pattern, address)
+ *
+ * @param SearchRequest request of the multi-pattern search
+ * @param Automaton the compiled automaton
+ * @param Results the buffer to save the results (MaximumSearchMultiplePatternsResults)
+ * @param ReadChunk the routine that reads the memory
+ * @param Context the context of the routine that reads the memory
+ * @param Cursor if not NULL, the search stops once the slice of the cursor
+ * is expired
+ * @return BOOLEAN TRUE if the search is finished, FALSE if it's stopped because
+ * the results are full or the slice is expired
+ */
+BOOLEAN
+SearchMultiplePatternsScanRanges(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS        SearchRequest,
+                                 PSEARCH_MULTIPLE_PATTERNS_AUTOMATON       Automaton,
+                                 PDEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT Results,
+                                 SEARCH_MULTIPLE_PATTERNS_READ_CHUNK       ReadChunk,
+                                 PVOID                                     Context,
+                                 PKD_CURSOR                                Cursor)
+{
+    UINT64  Address         = Automaton->Address;
+    BOOLEAN IsFinished      = FALSE;
+    BOOLEAN IsStopped       = FALSE;
+    BOOLEAN IsResultsFull   = FALSE;
+    BOOLEAN IsChunkSearched = FALSE;
+    UINT32  NumberOfResults = 0;
+    UINT64  EndAddress;
+    UINT64  ChunkEndAddress;
+    UINT32  ChunkSize;
+    UINT32  Offset;
+
+    while (Automaton->RangeIndex < SearchRequest->NumberOfRanges && !IsFinished && !IsStopped)
+    {
+        EndAddress = SearchRequest->Ranges[Automaton->RangeIndex].Address + SearchRequest->Ranges[Automaton->RangeIndex].Length;
+
+        while (Address < EndAddress && !IsFinished && !IsStopped)
+        {
+            if (Cursor != NULL && IsChunkSearched && KdCursorIsSliceExpired(Cursor))
+            {
+                //
+                // The rest of the range is searched in the next slice (at least
+                // one chunk is searched in each slice)
+                //
+                IsStopped = TRUE;
+                break;
+            }
+
+            ChunkEndAddress = (UINT64)PAGE_ALIGN(Address) + PAGE_SIZE;
+
+            if (ChunkEndAddress > EndAddress || ChunkEndAddress < Address)
+            {
+                ChunkEndAddress = EndAddress;
+            }
+
+            ChunkSize       = (UINT32)(ChunkEndAddress - Address);
+            IsChunkSearched = TRUE;
+
+            if (!ReadChunk(SearchRequest, Address, Automaton->Page, ChunkSize, Context))
+            {
+                //
+                // The page is not valid, matches don't cross it
+                //
+                SearchMultiplePatternsResetStates(Automaton);
+                Address = ChunkEndAddress;
+                continue;
+            }
+
+            Offset = SearchMultiplePatternsScanChunk(SearchRequest,
+                                                     Automaton,
+                                                     Automaton->Page,
+                                                     ChunkSize,
+                                                     Address,
+                                                     Results,
+                                                     &NumberOfResults,
+                                                     &IsFinished,
+                                                     &IsResultsFull);
+
+            //
+            // The rest of the chunk is searched in the next call
+            //
+            IsStopped = IsResultsFull && !IsFinished;
+
+            Address += Offset;
+        }
+
+        if (IsFinished || IsStopped)
+        {
+            break;
+        }
+
+        //
+        // Matches don't cross the ranges
+        //
+        Automaton->RangeIndex++;
+
+        if (Automaton->RangeIndex < SearchRequest->NumberOfRanges)
+        {
+            Address = SearchRequest->Ranges[Automaton->RangeIndex].Address;
+        }
+
+        SearchMultiplePatternsResetStates(Automaton);
+    }
+
+    //
+    // Save the progress for the next call
+    //
+    Automaton->Address = Address;
+
+    SearchRequest->NumberOfResults   = NumberOfResults;
+    SearchRequest->KernelStatus      = DEBUGGER_OPERATION_WAS_SUCCESSFUL;
+    SearchRequest->Cursor.IsFinished = !IsStopped;
+
+    return !IsStopped;
+}
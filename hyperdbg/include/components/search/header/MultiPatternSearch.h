@@ -0,0 +1,102 @@
+/**
+ * @file MultiPatternSearch.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of the bit-parallel automaton of the multi-pattern search
+ * @details This component is shared by hyperkd (sm, !sm) and the
+ * unit tests of libhyperdbg, reading the memory is up to the caller
+ * @version 0.11
+ * @date 2024-10-26
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//				     Constants		      		//
+//////////////////////////////////////////////////
+
+/**
+ * @brief Maximum number of 64-bit words of the bit-parallel automaton
+ * @details patterns are packed (first-fit) into the words, as each
+ * pattern is at most half of a word, all of the words except the last
+ * one hold at least two patterns
+ *
+ */
+#define SEARCH_MULTIPLE_PATTERNS_MAXIMUM_WORDS \
+    ((MaximumSearchPatterns * MaximumSearchPatternLength) / 64)
+
+//////////////////////////////////////////////////
+//				     Structures		      		//
+//////////////////////////////////////////////////
+
+/**
+ * @brief The bit-parallel (shift-and) automaton of the multi-pattern search
+ * @details each pattern occupies a run of bits in one of the words, bit i
+ * of the run is set in the state of the word when the last i + 1 bytes
+ * matched the first i + 1 bytes of the pattern
+ *
+ */
+typedef struct _SEARCH_MULTIPLE_PATTERNS_AUTOMATON
+{
+    UINT32  NumberOfWords;
+    UINT32  NumberOfSaturatedPatterns;
+    UINT64  StartMasks[SEARCH_MULTIPLE_PATTERNS_MAXIMUM_WORDS];
+    UINT64  EndMasks[SEARCH_MULTIPLE_PATTERNS_MAXIMUM_WORDS];
+    UINT8   PatternStartBits[MaximumSearchPatterns];
+    UINT8   EndBitToPatternId[SEARCH_MULTIPLE_PATTERNS_MAXIMUM_WORDS][64];
+    UINT32  ResultsPerPattern[MaximumSearchPatterns];
+    UINT64  Table[256][SEARCH_MULTIPLE_PATTERNS_MAXIMUM_WORDS]; // the bits that accept each byte
+    BOOLEAN StartBytes[256];                                   // the bytes that start at least one pattern
+    BYTE    Page[PAGE_SIZE];
+
+    //
+    // Progress of the search (the search is resumable)
+    //
+    UINT32 RangeIndex;
+    UINT64 Address;
+    UINT64 States[SEARCH_MULTIPLE_PATTERNS_MAXIMUM_WORDS];
+    UINT64 ActiveStates;
+
+} SEARCH_MULTIPLE_PATTERNS_AUTOMATON, *PSEARCH_MULTIPLE_PATTERNS_AUTOMATON;
+
+/**
+ * @brief The routine that reads a part of a page for the multi-pattern search
+ * @details returns FALSE if the memory is not readable
+ *
+ */
+typedef BOOLEAN (*SEARCH_MULTIPLE_PATTERNS_READ_CHUNK)(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS SearchRequest,
+                                                      UINT64                             Address,
+                                                      PVOID                              Buffer,
+                                                      UINT32                             Size,
+                                                      PVOID                              Context);
+
+//////////////////////////////////////////////////
+//				     Functions		      		//
+//////////////////////////////////////////////////
+
+BOOLEAN
+SearchMultiplePatternsCompile(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS  SearchRequest,
+                              PSEARCH_MULTIPLE_PATTERNS_AUTOMATON Automaton);
+
+VOID
+SearchMultiplePatternsResetStates(PSEARCH_MULTIPLE_PATTERNS_AUTOMATON Automaton);
+
+UINT32
+SearchMultiplePatternsScanChunk(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS        SearchRequest,
+                                PSEARCH_MULTIPLE_PATTERNS_AUTOMATON       Automaton,
+                                BYTE *                                    Buffer,
+                                UINT32                                    Size,
+                                UINT64                                    Address,
+                                PDEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT Results,
+                                UINT32 *                                  NumberOfResults,
+                                BOOLEAN *                                 IsFinished,
+                                BOOLEAN *                                 IsResultsFull);
+
+BOOLEAN
+SearchMultiplePatternsScanRanges(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS        SearchRequest,
+                                 PSEARCH_MULTIPLE_PATTERNS_AUTOMATON       Automaton,
+                                 PDEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT Results,
+                                 SEARCH_MULTIPLE_PATTERNS_READ_CHUNK       ReadChunk,
+                                 PVOID                                     Context,
+                                 PKD_CURSOR                                Cursor);
@@ -0,0 +1,132 @@
+/**
+ * @file SppTable.c
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief The builder of the sub-page permission (SPP) table
+ * @details The levels of the table are allocated and translated by the
+ * given routines, so the same builder is used by the hypervisor (from the
+ * pre-allocated pools) and by the tests
+ * @version 0.11
+ * @date 2024-10-28
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Compute the sub-page permission vector of a monitored page
+ * @details the sub-pages that overlap the target range are write-protected
+ * and the writes to the other sub-pages are allowed
+ *
+ * @param PhysicalBaseAddress The physical address of the page
+ * @param StartOfTargetPhysicalAddress Start of the monitored range
+ * @param EndOfTargetPhysicalAddress End of the monitored range (inclusive)
+ *
+ * @return UINT64 The SPPL1 entry (bit 2i allows writes to the sub-page i)
+ */
+UINT64
+SppComputeWritePermissions(UINT64 PhysicalBaseAddress,
+                           UINT64 StartOfTargetPhysicalAddress,
+                           UINT64 EndOfTargetPhysicalAddress)
+{
+    UINT64 WritePermissions = 0;
+    UINT64 StartOfSubPage;
+    UINT64 EndOfSubPage;
+
+    for (UINT32 i = 0; i < SPP_SUB_PAGES_COUNT; i++)
+    {
+        StartOfSubPage = PhysicalBaseAddress + (i * SPP_SUB_PAGE_SIZE);
+        EndOfSubPage   = StartOfSubPage + SPP_SUB_PAGE_SIZE - 1;
+
+        if (EndOfSubPage < StartOfTargetPhysicalAddress || StartOfSubPage > EndOfTargetPhysicalAddress)
+        {
+            //
+            // The sub-page is not monitored, so the writes are allowed
+            //
+            WritePermissions |= 1ULL << (i * 2);
+        }
+    }
+
+    return WritePermissions;
+}
+
+/**
+ * @brief Get (or build) the next level of the SPP table
+ *
+ * @param Entry The entry in the current level
+ * @param Memory Routines that allocate and translate the levels
+ *
+ * @return PSPP_TABLE The next level or NULL if it's not possible to build it
+ */
+static PSPP_TABLE
+SppTableGetOrCreateNextLevel(PSPPT_ENTRY Entry, PSPP_TABLE_MEMORY Memory)
+{
+    PSPP_TABLE NextLevel;
+    SPPT_ENTRY NewEntry = {0};
+
+    if (Entry->Valid)
+    {
+        return Memory->PhysicalToVirtual((UINT64)Entry->PageFrameNumber * PAGE_SIZE, Memory->Context);
+    }
+
+    NextLevel = Memory->AllocateTable(Memory->Context);
+
+    if (NextLevel == NULL)
+    {
+        return NULL;
+    }
+
+    RtlZeroMemory(NextLevel, sizeof(SPP_TABLE));
+
+    //
+    // The table is filled before being linked as other cores might walk the table
+    //
+    NewEntry.Valid           = TRUE;
+    NewEntry.PageFrameNumber = Memory->VirtualToPhysical(NextLevel, Memory->Context) / PAGE_SIZE;
+
+    Entry->AsUInt = NewEntry.AsUInt;
+
+    return NextLevel;
+}
+
+/**
+ * @brief Set the sub-page permission vector of a page
+ * @details the missing levels of the table are built by the allocation
+ * routine
+ *
+ * @param Root The root (SPPL4) of the SPP table
+ * @param PhysicalBaseAddress The physical address of the page
+ * @param WritePermissions The SPPL1 entry of the page
+ * @param Memory Routines that allocate and translate the levels
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+SppTableSetWritePermissions(PSPP_TABLE        Root,
+                            UINT64            PhysicalBaseAddress,
+                            UINT64            WritePermissions,
+                            PSPP_TABLE_MEMORY Memory)
+{
+    PSPP_TABLE Table = Root;
+
+    //
+    // Walk the SPPL4, SPPL3, and SPPL2 tables (indexed by the bits 47:39, 38:30,
+    // and 29:21 of the guest-physical address)
+    //
+    for (UINT32 Shift = 39; Shift > 12; Shift -= 9)
+    {
+        Table = SppTableGetOrCreateNextLevel(&Table->Entries[(PhysicalBaseAddress >> Shift) & (SPP_TABLE_ENTRIES_COUNT - 1)], Memory);
+
+        if (Table == NULL)
+        {
+            return FALSE;
+        }
+    }
+
+    //
+    // The SPPL1 table is indexed by the bits 20:12 of the guest-physical address
+    //
+    Table->Entries[(PhysicalBaseAddress >> 12) & (SPP_TABLE_ENTRIES_COUNT - 1)].AsUInt = WritePermissions;
+
+    return TRUE;
+}
@@ -0,0 +1,117 @@
+/**
+ * @file SppTable.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of the sub-page permission (SPP) table builder
+ * @details
+ * @version 0.11
+ * @date 2024-10-28
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//				   Constants					//
+//////////////////////////////////////////////////
+
+/**
+ * @brief Size of each sub-page (write permissions are managed
+ * in 128-byte granularity)
+ *
+ */
+#define SPP_SUB_PAGE_SIZE 128
+
+/**
+ * @brief Number of sub-pages in a 4-KByte page
+ *
+ */
+#define SPP_SUB_PAGES_COUNT (PAGE_SIZE / SPP_SUB_PAGE_SIZE)
+
+/**
+ * @brief Number of entries in each level of the SPP table
+ *
+ */
+#define SPP_TABLE_ENTRIES_COUNT 512
+
+//////////////////////////////////////////////////
+//				   Structures					//
+//////////////////////////////////////////////////
+
+/**
+ * @brief A non-leaf entry of the SPP table (SPPL4E, SPPL3E, SPPL2E)
+ * @details the leaf entries (SPPL1E) are 64-bit sub-page permission vectors
+ * in which bit 2i allows writes to the sub-page i and odd bits are reserved
+ *
+ */
+typedef union _SPPT_ENTRY
+{
+    struct
+    {
+        UINT64 Valid : 1;
+        UINT64 Reserved1 : 11;
+        UINT64 PageFrameNumber : 36;
+        UINT64 Reserved2 : 16;
+    };
+
+    UINT64 AsUInt;
+
+} SPPT_ENTRY, *PSPPT_ENTRY;
+
+/**
+ * @brief A single level of the SPP table
+ *
+ */
+typedef struct _SPP_TABLE
+{
+    DECLSPEC_ALIGN(PAGE_SIZE)
+    SPPT_ENTRY Entries[SPP_TABLE_ENTRIES_COUNT];
+
+} SPP_TABLE, *PSPP_TABLE;
+
+/**
+ * @brief The routine that allocates a zeroed level of the SPP table
+ * @details returns NULL if no table is left
+ *
+ */
+typedef PSPP_TABLE (*SPP_TABLE_ALLOCATE)(PVOID Context);
+
+/**
+ * @brief The routine that gets the physical address of a level
+ *
+ */
+typedef UINT64 (*SPP_TABLE_VIRTUAL_TO_PHYSICAL)(PSPP_TABLE Table, PVOID Context);
+
+/**
+ * @brief The routine that gets the level at a physical address
+ *
+ */
+typedef PSPP_TABLE (*SPP_TABLE_PHYSICAL_TO_VIRTUAL)(UINT64 Address, PVOID Context);
+
+/**
+ * @brief Routines that allocate and translate the levels of the SPP table
+ *
+ */
+typedef struct _SPP_TABLE_MEMORY
+{
+    SPP_TABLE_ALLOCATE            AllocateTable;
+    SPP_TABLE_VIRTUAL_TO_PHYSICAL VirtualToPhysical;
+    SPP_TABLE_PHYSICAL_TO_VIRTUAL PhysicalToVirtual;
+    PVOID                         Context; // passed to the routines
+
+} SPP_TABLE_MEMORY, *PSPP_TABLE_MEMORY;
+
+//////////////////////////////////////////////////
+//				   Functions					//
+//////////////////////////////////////////////////
+
+UINT64
+SppComputeWritePermissions(UINT64 PhysicalBaseAddress,
+                           UINT64 StartOfTargetPhysicalAddress,
+                           UINT64 EndOfTargetPhysicalAddress);
+
+BOOLEAN
+SppTableSetWritePermissions(PSPP_TABLE        Root,
+                            UINT64            PhysicalBaseAddress,
+                            UINT64            WritePermissions,
+                            PSPP_TABLE_MEMORY Memory);
@@ -0,0 +1,147 @@
+/**
+ * @file Throttle.c
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief The sampling and rate limiting decisions of the events
+ * @details the decisions are shared by hyperkd (on the time stamp counter)
+ * and by the tests (on a simulated clock)
+ * @version 0.11
+ * @date 2024-10-31
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Get the next pseudo-random number (xorshift64*)
+ *
+ * @param RandomState The state of the generator (should not be zero)
+ *
+ * @return UINT64
+ */
+UINT64
+ThrottleNextRandom(UINT64 * RandomState)
+{
+    UINT64 Value = *RandomState;
+
+    Value ^= Value >> 12;
+    Value ^= Value << 25;
+    Value ^= Value >> 27;
+
+    *RandomState = Value;
+
+    return Value * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief Check whether any of the sampling or rate limiting options is set
+ *
+ * @param Options The options of the event
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+ThrottleIsEnabled(DEBUGGER_EVENT_THROTTLE_OPTIONS * Options)
+{
+    return Options->SampleEveryNthHit > 1 ||
+           (Options->SampleProbability != 0 && Options->SampleProbability < DEBUGGER_EVENT_THROTTLE_PROBABILITY_SCALE) ||
+           Options->MaximumHitsPerSecond != 0;
+}
+
+/**
+ * @brief Set the rate budget of an event
+ *
+ * @param Rate The rate budget
+ * @param TicksPerSecond The frequency of the clock
+ * @param MaximumHitsPerSecond Maximum rate of the hits
+ * @param BurstSize Number of hits that are allowed back-to-back (0 means 1)
+ *
+ * @return VOID
+ */
+VOID
+ThrottleSetRate(PTHROTTLE_RATE Rate, UINT64 TicksPerSecond, UINT32 MaximumHitsPerSecond, UINT32 BurstSize)
+{
+    Rate->TheoreticalArrivalTime = 0;
+    Rate->EmissionInterval       = TicksPerSecond / MaximumHitsPerSecond;
+
+    if (Rate->EmissionInterval == 0)
+    {
+        Rate->EmissionInterval = 1;
+    }
+
+    if (BurstSize == 0)
+    {
+        BurstSize = 1;
+    }
+
+    Rate->BurstTolerance = (BurstSize - 1) * Rate->EmissionInterval;
+}
+
+/**
+ * @brief Check whether the hit is dropped by the sampling options
+ * @details the 1-in-N counter is shared between the cores, each core
+ * has its own random generator
+ *
+ * @param Options The options of the event
+ * @param NumberOfHits The hits of the event that passed its filters
+ * @param RandomState The random generator of the current core
+ *
+ * @return BOOLEAN TRUE if the hit is not sampled
+ */
+BOOLEAN
+ThrottleIsSampledOut(DEBUGGER_EVENT_THROTTLE_OPTIONS * Options, volatile LONG64 * NumberOfHits, UINT64 * RandomState)
+{
+    if (Options->SampleEveryNthHit > 1 &&
+        (UINT64)(InterlockedIncrement64(NumberOfHits) - 1) % Options->SampleEveryNthHit != 0)
+    {
+        return TRUE;
+    }
+
+    if (Options->SampleProbability != 0 &&
+        (ThrottleNextRandom(RandomState) >> 11) % DEBUGGER_EVENT_THROTTLE_PROBABILITY_SCALE >= Options->SampleProbability)
+    {
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/**
+ * @brief Charge a hit against the rate budget of the event
+ * @details The hit conforms to the rate if it's not earlier than the
+ * theoretical arrival time minus the burst tolerance, the arrival time
+ * is updated by a compare-exchange so the budget is shared between the
+ * cores without a lock
+ *
+ * @param Rate The rate budget of the event
+ * @param Now The current time
+ * @param RearmTime The time that the next hit conforms to the rate (if
+ * the hit is suppressed)
+ *
+ * @return BOOLEAN TRUE if the hit conforms to the rate
+ */
+BOOLEAN
+ThrottleConsumeRateBudget(PTHROTTLE_RATE Rate, UINT64 Now, UINT64 * RearmTime)
+{
+    UINT64 ArrivalTime;
+    UINT64 NewArrivalTime;
+
+    do
+    {
+        ArrivalTime    = (UINT64)Rate->TheoreticalArrivalTime;
+        NewArrivalTime = ArrivalTime > Now ? ArrivalTime : Now;
+
+        if (NewArrivalTime - Now > Rate->BurstTolerance)
+        {
+            *RearmTime = NewArrivalTime - Rate->BurstTolerance;
+            return FALSE;
+        }
+
+        NewArrivalTime += Rate->EmissionInterval;
+
+    } while ((UINT64)InterlockedCompareExchange64(&Rate->TheoreticalArrivalTime,
+                                                  (LONG64)NewArrivalTime,
+                                                  (LONG64)ArrivalTime) != ArrivalTime);
+
+    return TRUE;
+}
@@ -0,0 +1,50 @@
+/**
+ * @file Throttle.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of the sampling and rate limiting decisions of the events
+ * @details
+ * @version 0.11
+ * @date 2024-10-31
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//				   Structures					//
+//////////////////////////////////////////////////
+
+/**
+ * @brief The rate budget of an event
+ * @details The rate is limited by a generic cell rate algorithm (a token
+ * bucket that only keeps the theoretical arrival time of the next hit), so
+ * it can be updated lock-free from all cores
+ *
+ */
+typedef struct _THROTTLE_RATE
+{
+    volatile LONG64 TheoreticalArrivalTime; // the time that the next hit conforms to the rate
+    UINT64          EmissionInterval;       // ticks of each allowed hit
+    UINT64          BurstTolerance;         // ticks that hits are allowed ahead of the rate
+
+} THROTTLE_RATE, *PTHROTTLE_RATE;
+
+//////////////////////////////////////////////////
+//				   Functions					//
+//////////////////////////////////////////////////
+
+UINT64
+ThrottleNextRandom(UINT64 * RandomState);
+
+BOOLEAN
+ThrottleIsEnabled(DEBUGGER_EVENT_THROTTLE_OPTIONS * Options);
+
+VOID
+ThrottleSetRate(PTHROTTLE_RATE Rate, UINT64 TicksPerSecond, UINT32 MaximumHitsPerSecond, UINT32 BurstSize);
+
+BOOLEAN
+ThrottleIsSampledOut(DEBUGGER_EVENT_THROTTLE_OPTIONS * Options, volatile LONG64 * NumberOfHits, UINT64 * RandomState);
+
+BOOLEAN
+ThrottleConsumeRateBudget(PTHROTTLE_RATE Rate, UINT64 Now, UINT64 * RearmTime);
@@ -35,6 +35,34 @@ typedef struct _RTL_PROCESS_MODULES
     _Field_size_(NumberOfModules) RTL_PROCESS_MODULE_INFORMATION Modules[1];
 } RTL_PROCESS_MODULES, *PRTL_PROCESS_MODULES;
 
+// Compression (ntdll)
+
+extern "C" NTSYSAPI NTSTATUS NTAPI
+RtlGetCompressionWorkSpaceSize(
+    _In_ USHORT  CompressionFormatAndEngine,
+    _Out_ PULONG CompressBufferWorkSpaceSize,
+    _Out_ PULONG CompressFragmentWorkSpaceSize);
+
+extern "C" NTSYSAPI NTSTATUS NTAPI
+RtlCompressBuffer(
+    _In_ USHORT  CompressionFormatAndEngine,
+    _In_ PUCHAR  UncompressedBuffer,
+    _In_ ULONG   UncompressedBufferSize,
+    _Out_ PUCHAR CompressedBuffer,
+    _In_ ULONG   CompressedBufferSize,
+    _In_ ULONG   UncompressedChunkSize,
+    _Out_ PULONG FinalCompressedSize,
+    _In_ PVOID   WorkSpace);
+
+extern "C" NTSYSAPI NTSTATUS NTAPI
+RtlDecompressBuffer(
+    _In_ USHORT  CompressionFormat,
+    _Out_ PUCHAR UncompressedBuffer,
+    _In_ ULONG   UncompressedBufferSize,
+    _In_ PUCHAR  CompressedBuffer,
+    _In_ ULONG   CompressedBufferSize,
+    _Out_ PULONG FinalUncompressedSize);
+
 // Linked lists
 
 FORCEINLINE VOID
@@ -176,3 +204,14 @@ typedef enum _SYSTEM_INFORMATION_CLASS2
     SystemModuleInformation = 11 // q: RTL_PROCESS_MODULES
 
 } SYSTEM_INFORMATION_CLASS2;
+
+//
+// MessageId: STATUS_SUCCESS
+//
+// MessageText:
+//
+// The operation completed successfully.
+//
+#ifndef STATUS_SUCCESS
+#    define STATUS_SUCCESS ((NTSTATUS)0x00000000L)
+#endif
@@ -86,6 +86,218 @@ UnsetTextMessageCallback()
     g_MessageHandlerSharedBuffer = NULL;
 }
 
+//
+// State of the coalesced messages that are sent to the remote debugger
+// (TCP or serial), the pending messages are shared between the threads
+// and protected by the lock, so they're sent in the order of the calls
+//
+static SRWLOCK              g_ShowMessagesLock             = SRWLOCK_INIT;
+static string               g_ShowMessagesPendingBuffer;
+static UINT32               g_ShowMessagesPendingLines     = 0;
+static UINT32               g_ShowMessagesPendingRequestId = 0;
+static thread_local UINT32  g_ShowMessagesCoalescingDepth  = 0;
+static thread_local BOOLEAN g_ShowMessagesIsSending        = FALSE;
+static thread_local string  g_ShowMessagesFormatBuffer;
+
+/**
+ * @brief Send messages to the remote debugger
+ * @details the messages are sent in chunks that fit in the communication
+ * buffer of the remote debugger
+ *
+ * @param Message
+ * @param Length
+ * @return VOID
+ */
+static VOID
+ShowMessagesSendToTransport(const char * Message, SIZE_T Length)
+{
+    UINT32  ChunkSize;
+    BOOLEAN IsSending = g_ShowMessagesIsSending;
+
+    g_ShowMessagesIsSending = TRUE;
+
+    while (Length != 0)
+    {
+        ChunkSize = (UINT32)min(Length, (SIZE_T)(SHOW_MESSAGES_COALESCING_MAX_SIZE));
+
+        if (g_IsConnectedToRemoteDebugger)
+        {
+            RemoteConnectionSendResultsToHost(Message, ChunkSize);
+        }
+        else if (g_IsSerialConnectedToRemoteDebugger)
+        {
+            KdSendUsermodePrints((CHAR *)Message, ChunkSize);
+        }
+
+        Message += ChunkSize;
+        Length -= ChunkSize;
+    }
+
+    g_ShowMessagesIsSending = IsSending;
+}
+
+/**
+ * @brief Send the pending messages to the remote debugger
+ * @details should be called while the lock is held, the messages are sent
+ * as the outputs of the command that coalesced them
+ *
+ * @return VOID
+ */
+static VOID
+ShowMessagesFlushLocked()
+{
+    UINT32 RequestId;
+
+    if (g_ShowMessagesPendingBuffer.empty())
+    {
+        return;
+    }
+
+    RequestId = RemoteFrameGetCurrentRequestId();
+    RemoteFrameSetCurrentRequestId(g_ShowMessagesPendingRequestId);
+
+    ShowMessagesSendToTransport(g_ShowMessagesPendingBuffer.data(), g_ShowMessagesPendingBuffer.size());
+
+    RemoteFrameSetCurrentRequestId(RequestId);
+
+    //
+    // clear() keeps the capacity so the buffer is reused for the next command
+    //
+    g_ShowMessagesPendingBuffer.clear();
+    g_ShowMessagesPendingLines = 0;
+}
+
+/**
+ * @brief Start coalescing the messages of the current thread that
+ * are sent to the remote debugger
+ * @details Messages are sent once the pending buffer is full, enough
+ * lines are accumulated, or ShowMessagesFlush is called
+ *
+ * @return VOID
+ */
+VOID
+ShowMessagesBeginCoalescing()
+{
+    g_ShowMessagesCoalescingDepth++;
+}
+
+/**
+ * @brief Send the pending messages to the remote debugger
+ *
+ * @return VOID
+ */
+VOID
+ShowMessagesFlush()
+{
+    AcquireSRWLockExclusive(&g_ShowMessagesLock);
+
+    ShowMessagesFlushLocked();
+
+    ReleaseSRWLockExclusive(&g_ShowMessagesLock);
+}
+
+/**
+ * @brief Send the pending messages and stop coalescing the messages
+ * of the current thread
+ *
+ * @return VOID
+ */
+VOID
+ShowMessagesEndCoalescing()
+{
+    if (g_ShowMessagesCoalescingDepth == 0)
+    {
+        return;
+    }
+
+    g_ShowMessagesCoalescingDepth--;
+
+    if (g_ShowMessagesCoalescingDepth != 0)
+    {
+        //
+        // A nested command, the outer command sends the messages
+        //
+        return;
+    }
+
+    AcquireSRWLockExclusive(&g_ShowMessagesLock);
+
+    ShowMessagesFlushLocked();
+
+    //
+    // Don't keep the memory of an unusually long output
+    //
+    if (g_ShowMessagesPendingBuffer.capacity() > SHOW_MESSAGES_MAX_RETAINED_SIZE)
+    {
+        string().swap(g_ShowMessagesPendingBuffer);
+    }
+
+    ReleaseSRWLockExclusive(&g_ShowMessagesLock);
+
+    if (g_ShowMessagesFormatBuffer.capacity() > SHOW_MESSAGES_MAX_RETAINED_SIZE)
+    {
+        string().swap(g_ShowMessagesFormatBuffer);
+    }
+}
+
+/**
+ * @brief Queue (or send) a formatted message to the remote debugger
+ * @details messages of the threads that are not coalescing are sent after
+ * the pending messages, so the order of the messages is kept
+ *
+ * @param Message
+ * @param Length
+ * @return VOID
+ */
+static VOID
+ShowMessagesQueueToTransport(const char * Message, SIZE_T Length)
+{
+    if (g_ShowMessagesIsSending)
+    {
+        //
+        // A message of the transport itself (e.g., an error of sending),
+        // the lock is already held by this thread
+        //
+        ShowMessagesSendToTransport(Message, Length);
+        return;
+    }
+
+    AcquireSRWLockExclusive(&g_ShowMessagesLock);
+
+    if (g_ShowMessagesCoalescingDepth == 0)
+    {
+        ShowMessagesFlushLocked();
+        ShowMessagesSendToTransport(Message, Length);
+
+        ReleaseSRWLockExclusive(&g_ShowMessagesLock);
+        return;
+    }
+
+    //
+    // Keep each send smaller than the communication buffer
+    //
+    if (g_ShowMessagesPendingBuffer.size() + Length > SHOW_MESSAGES_COALESCING_MAX_SIZE ||
+        g_ShowMessagesPendingRequestId != RemoteFrameGetCurrentRequestId())
+    {
+        ShowMessagesFlushLocked();
+    }
+
+    g_ShowMessagesPendingRequestId = RemoteFrameGetCurrentRequestId();
+    g_ShowMessagesPendingBuffer.append(Message, Length);
+
+    if (memchr(Message, '\n', Length) != NULL)
+    {
+        g_ShowMessagesPendingLines++;
+
+        if (g_ShowMessagesPendingLines >= SHOW_MESSAGES_COALESCING_MAX_LINES)
+        {
+            ShowMessagesFlushLocked();
+        }
+    }
+
+    ReleaseSRWLockExclusive(&g_ShowMessagesLock);
+}
+
 /**
  * @brief Show messages
  *
@@ -98,7 +310,7 @@ ShowMessages(const char * Fmt, ...)
 {
     va_list ArgList;
     va_list Args;
-    char    TempMessage[COMMUNICATION_BUFFER_SIZE + TCP_END_OF_BUFFER_CHARS_COUNT] = {0};
+    int     SprintfResult;
 
     if (g_MessageHandler == NULL && !g_IsConnectedToRemoteDebugger && !g_IsSerialConnectedToRemoteDebugger)
     {
@@ -114,26 +326,44 @@ ShowMessages(const char * Fmt, ...)
         }
     }
 
+    //
+    // The messages are formatted in a buffer of the thread that grows to
+    // the length of the message, so long messages are not truncated
+    //
     va_start(ArgList, Fmt);
 
-    int SprintfResult = vsprintf_s(TempMessage, Fmt, ArgList);
+    SprintfResult = _vscprintf(Fmt, ArgList);
+
+    va_end(ArgList);
+
+    if (SprintfResult == -1)
+    {
+        return;
+    }
+
+    if (g_ShowMessagesFormatBuffer.size() < (SIZE_T)SprintfResult + 1)
+    {
+        g_ShowMessagesFormatBuffer.resize((SIZE_T)SprintfResult + 1);
+    }
+
+    char * TempMessage = &g_ShowMessagesFormatBuffer[0];
+
+    va_start(ArgList, Fmt);
+
+    SprintfResult = vsprintf_s(TempMessage, g_ShowMessagesFormatBuffer.size(), Fmt, ArgList);
 
     va_end(ArgList);
 
     if (SprintfResult != -1)
     {
-        if (g_IsConnectedToRemoteDebugger)
+        if (g_IsConnectedToRemoteDebugger || g_IsSerialConnectedToRemoteDebugger)
         {
             //
             // vsprintf_s and vswprintf_s return the number of characters written,
             // not including the terminating null character, or a negative value
             // if an output error occurs.
             //
-            RemoteConnectionSendResultsToHost(TempMessage, SprintfResult);
-        }
-        else if (g_IsSerialConnectedToRemoteDebugger)
-        {
-            KdSendUsermodePrints(TempMessage, SprintfResult);
+            ShowMessagesQueueToTransport(TempMessage, SprintfResult);
         }
 
         if (g_LogOpened)
@@ -154,8 +384,19 @@ ShowMessages(const char * Fmt, ...)
             }
             else
             {
-                memcpy(g_MessageHandlerSharedBuffer, TempMessage, strlen(TempMessage) + 1);
-                ((SendMessageWWithSharedBufferCallback)g_MessageHandler)();
+                //
+                // The shared buffer has a fixed size, so long messages
+                // are passed in chunks
+                //
+                for (int Offset = 0; Offset == 0 || Offset < SprintfResult; Offset += COMMUNICATION_BUFFER_SIZE)
+                {
+                    int ChunkSize = min(SprintfResult - Offset, (int)(COMMUNICATION_BUFFER_SIZE));
+
+                    memcpy(g_MessageHandlerSharedBuffer, TempMessage + Offset, ChunkSize);
+                    ((char *)g_MessageHandlerSharedBuffer)[ChunkSize] = '\0';
+
+                    ((SendMessageWWithSharedBufferCallback)g_MessageHandler)();
+                }
             }
         }
     }
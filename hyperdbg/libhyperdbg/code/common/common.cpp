@@ -556,6 +556,59 @@ ConvertTokenToUInt32(CommandToken TargetToken, PUINT32 Result)
     return ConvertStringToUInt32(TargetTokenValue, Result);
 }
 
+/**
+ * @brief check and convert command token to a percentage
+ * @details the percentage is decimal with up to two fractional digits
+ * and an optional '%' (e.g., 12.5%), the result is in hundredths of a
+ * percent (e.g., 1250)
+ *
+ * @param TargetToken the target command token
+ * @param Result result will be save to the pointer
+ *
+ * @return BOOLEAN shows whether the conversion was successful or not
+ */
+BOOLEAN
+ConvertTokenToPercentage(CommandToken TargetToken, PUINT32 Result)
+{
+    std::string TargetTokenValue = std::get<1>(TargetToken);
+    std::string IntegerPart;
+    std::string FractionalPart;
+    size_t      DotPosition;
+
+    if (HasEnding(TargetTokenValue, "%"))
+    {
+        TargetTokenValue.pop_back();
+    }
+
+    DotPosition = TargetTokenValue.find('.');
+
+    if (DotPosition == std::string::npos)
+    {
+        IntegerPart = TargetTokenValue;
+    }
+    else
+    {
+        IntegerPart    = TargetTokenValue.substr(0, DotPosition);
+        FractionalPart = TargetTokenValue.substr(DotPosition + 1);
+    }
+
+    if (IntegerPart.empty() || IntegerPart.length() > 3 || FractionalPart.length() > 2 ||
+        IntegerPart.find_first_not_of("0123456789") != std::string::npos ||
+        FractionalPart.find_first_not_of("0123456789") != std::string::npos)
+    {
+        return FALSE;
+    }
+
+    //
+    // Pad the fractional part to two digits (e.g., .5 is 50 hundredths)
+    //
+    FractionalPart.resize(2, '0');
+
+    *Result = stoi(IntegerPart) * 100 + stoi(FractionalPart);
+
+    return *Result <= 100 * 100;
+}
+
 /**
  * @brief checks whether the string ends with a special string or not
  *
@@ -0,0 +1,368 @@
+/**
+ * @file hex-dump.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Table-driven renderer for hex/ASCII dumps
+ * @details Lines are rendered into a chunk and each chunk is shown
+ * by a single call to ShowMessages
+ * @version 0.11
+ * @date 2024-10-20
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Hex digits in upper case
+ *
+ */
+static const CHAR HexDumpUpperDigits[] = "0123456789ABCDEF";
+
+/**
+ * @brief Hex digits in lower case
+ *
+ */
+static const CHAR HexDumpLowerDigits[] = "0123456789abcdef";
+
+/**
+ * @brief Get the character that is shown for a byte in the characters
+ * column (printable ASCII characters or '.')
+ *
+ * @param Byte
+ * @return CHAR
+ */
+static CHAR
+HexDumpAsciiOfByte(UCHAR Byte)
+{
+    static CHAR    AsciiTable[256];
+    static BOOLEAN AsciiTableInitialized = FALSE;
+
+    if (!AsciiTableInitialized)
+    {
+        for (UINT32 i = 0; i < 256; i++)
+        {
+            AsciiTable[i] = (i >= 0x20 && i <= 0x7e) ? (CHAR)i : '.';
+        }
+
+        AsciiTableInitialized = TRUE;
+    }
+
+    return AsciiTable[Byte];
+}
+
+/**
+ * @brief Render a value as hex digits
+ *
+ * @param Value
+ * @param Digits number of digits to render
+ * @param Table hex digits table
+ * @param Out
+ * @return CHAR * the end of the rendered value
+ */
+static CHAR *
+HexDumpRenderHex(UINT64 Value, UINT32 Digits, const CHAR * Table, CHAR * Out)
+{
+    for (INT32 i = Digits - 1; i >= 0; i--)
+    {
+        Out[i] = Table[Value & 0xf];
+        Value >>= 4;
+    }
+
+    return Out + Digits;
+}
+
+/**
+ * @brief Render one line of the dump
+ *
+ * @param Options layout of the dump
+ * @param Buffer the buffer to show
+ * @param ValidLength number of available bytes in the buffer
+ * @param Offset offset of the line in the buffer
+ * @param Address address of the line
+ * @param Line the output (at least HEX_DUMP_MAX_LINE_SIZE bytes)
+ *
+ * @return UINT32 length of the rendered line (without the null terminator)
+ */
+UINT32
+HexDumpRenderLine(const HEX_DUMP_OPTIONS * Options,
+                  const UCHAR *            Buffer,
+                  UINT64                   ValidLength,
+                  UINT64                   Offset,
+                  UINT64                   Address,
+                  CHAR *                   Line)
+{
+    CHAR *       Out    = Line;
+    const CHAR * Digits = Options->UpperCase ? HexDumpUpperDigits : HexDumpLowerDigits;
+    UINT32       ElementSize;
+
+    ElementSize = Options->ElementSize;
+
+    if (ElementSize != 1 && ElementSize != 2 && ElementSize != 4 && ElementSize != 8)
+    {
+        ElementSize = 1;
+    }
+
+    if (Options->PhysicalPrefix)
+    {
+        *Out++ = '#';
+        *Out++ = '\t';
+    }
+
+    //
+    // Render the address
+    //
+    Out    = HexDumpRenderHex(Address >> 32, 8, HexDumpLowerDigits, Out);
+    *Out++ = '`';
+    Out    = HexDumpRenderHex(Address & 0xffffffff, 8, HexDumpLowerDigits, Out);
+    *Out++ = ' ';
+    *Out++ = ' ';
+
+    //
+    // Render the elements
+    //
+    for (UINT32 j = 0; j < HEX_DUMP_BYTES_PER_LINE; j += ElementSize)
+    {
+        UINT32 ElementWidth = ElementSize * 2 + (ElementSize == 8 ? 1 : 0);
+
+        if (Offset + j >= ValidLength)
+        {
+            //
+            // The element is not available
+            //
+            memset(Out, '?', ElementWidth);
+
+            if (ElementSize == 8)
+            {
+                Out[8] = '`';
+            }
+
+            Out += ElementWidth;
+        }
+        else
+        {
+            UINT64 Value = 0;
+
+            //
+            // Little-endian value of the available bytes of the element
+            //
+            for (INT32 k = ElementSize - 1; k >= 0; k--)
+            {
+                Value <<= 8;
+
+                if (Offset + j + k < ValidLength)
+                {
+                    Value |= Buffer[Offset + j + k];
+                }
+            }
+
+            if (ElementSize == 8)
+            {
+                Out    = HexDumpRenderHex(Value >> 32, 8, Digits, Out);
+                *Out++ = '`';
+                Out    = HexDumpRenderHex(Value & 0xffffffff, 8, Digits, Out);
+            }
+            else
+            {
+                Out = HexDumpRenderHex(Value, ElementSize * 2, Digits, Out);
+            }
+        }
+
+        *Out++ = ' ';
+    }
+
+    //
+    // Render the characters
+    //
+    if (Options->ShowAscii)
+    {
+        *Out++ = ' ';
+
+        for (UINT32 j = 0; j < HEX_DUMP_BYTES_PER_LINE; j++)
+        {
+            if (Offset + j < ValidLength)
+            {
+                *Out++ = HexDumpAsciiOfByte(Buffer[Offset + j]);
+            }
+            else
+            {
+                *Out++ = '.';
+            }
+        }
+    }
+
+    *Out++ = '\n';
+    *Out   = '\0';
+
+    return (UINT32)(Out - Line);
+}
+
+/**
+ * @brief Show the hex dump of a buffer
+ * @details Lines are rendered into a chunk which is shown by a single
+ * call to ShowMessages once it's full
+ *
+ * @param Options layout of the dump
+ * @param Buffer the buffer to show
+ * @param Size number of bytes to show (rounded up to the line size)
+ * @param ValidLength number of available bytes in the buffer
+ * @param Address address of the first byte
+ *
+ * @return VOID
+ */
+VOID
+HexDumpShow(const HEX_DUMP_OPTIONS * Options,
+            const UCHAR *            Buffer,
+            UINT64                   Size,
+            UINT64                   ValidLength,
+            UINT64                   Address)
+{
+    CHAR   Chunk[HEX_DUMP_CHUNK_SIZE];
+    UINT32 ChunkLength = 0;
+
+    //
+    // Bytes after the size are never read
+    //
+    if (ValidLength > Size)
+    {
+        ValidLength = Size;
+    }
+
+    for (UINT64 Offset = 0; Offset < Size; Offset += HEX_DUMP_BYTES_PER_LINE)
+    {
+        if (ChunkLength + HEX_DUMP_MAX_LINE_SIZE > HEX_DUMP_CHUNK_SIZE)
+        {
+            ShowMessages("%s", Chunk);
+            ChunkLength = 0;
+        }
+
+        ChunkLength += HexDumpRenderLine(Options, Buffer, ValidLength, Offset, Address + Offset, &Chunk[ChunkLength]);
+    }
+
+    if (ChunkLength != 0)
+    {
+        ShowMessages("%s", Chunk);
+    }
+}
+
+/**
+ * @brief Render a 32-bit value like '%x' (without the leading zeros)
+ *
+ * @param Value
+ * @param Out
+ * @return CHAR * the end of the rendered value
+ */
+static CHAR *
+HexDumpRenderShortHex(UINT32 Value, CHAR * Out)
+{
+    UINT32 Digits = 1;
+
+    for (UINT32 Temp = Value >> 4; Temp != 0; Temp >>= 4)
+    {
+        Digits++;
+    }
+
+    return HexDumpRenderHex(Value, Digits, HexDumpLowerDigits, Out);
+}
+
+/**
+ * @brief Show the hex dump of a section of a PE file
+ * @details the layout is the same as the dumps of the '!pe' command that
+ * were printed byte by byte (e.g., the addresses are 32-bit '%x' values, the
+ * '|' that follows the last column is shown at the start of the next line,
+ * and the characters column of the last line is not padded)
+ *
+ * @param Buffer the buffer to show
+ * @param Size number of bytes to show
+ * @param Address address of the first byte
+ *
+ * @return VOID
+ */
+VOID
+HexDumpShowSection(const UCHAR * Buffer, UINT32 Size, UINT32 Address)
+{
+    CHAR   Chunk[HEX_DUMP_CHUNK_SIZE];
+    CHAR * Out = Chunk;
+    CHAR   Characters[HEX_DUMP_BYTES_PER_LINE];
+    UINT32 NumberOfCharacters = 0;
+    UINT32 i;
+
+    *Out++ = '\n';
+    *Out++ = '\n';
+    Out    = HexDumpRenderShortHex(Address, Out);
+    *Out++ = ':';
+    *Out++ = ' ';
+    *Out++ = '|';
+
+    for (i = 1; i <= Size; i++)
+    {
+        if ((UINT32)(Out - Chunk) + HEX_DUMP_MAX_LINE_SIZE > HEX_DUMP_CHUNK_SIZE)
+        {
+            *Out = '\0';
+            ShowMessages("%s", Chunk);
+            Out = Chunk;
+        }
+
+        //
+        // Control characters (including the C1 controls) are shown as '.'
+        //
+        UCHAR Byte = Buffer[i - 1];
+
+        Characters[NumberOfCharacters++] = (Byte < 0x20 || (Byte >= 0x7f && Byte <= 0x9f)) ? '.' : (CHAR)Byte;
+
+        Out    = HexDumpRenderHex(Byte, 2, HexDumpLowerDigits, Out);
+        *Out++ = ' ';
+
+        if (i % HEX_DUMP_BYTES_PER_LINE == 0)
+        {
+            *Out++ = ' ';
+            memcpy(Out, Characters, HEX_DUMP_BYTES_PER_LINE);
+            Out += HEX_DUMP_BYTES_PER_LINE;
+            *Out++ = '\n';
+
+            NumberOfCharacters = 0;
+
+            if (i + 1 <= Size)
+            {
+                Address += HEX_DUMP_BYTES_PER_LINE;
+
+                Out    = HexDumpRenderShortHex(Address, Out);
+                *Out++ = ':';
+                *Out++ = ' ';
+            }
+        }
+
+        if (i % 4 == 0)
+        {
+            *Out++ = '|';
+            *Out++ = ' ';
+        }
+    }
+
+    //
+    // The last line (the columns are padded up to the 15th byte)
+    //
+    if (i % HEX_DUMP_BYTES_PER_LINE != 0)
+    {
+        if ((UINT32)(Out - Chunk) + HEX_DUMP_MAX_LINE_SIZE > HEX_DUMP_CHUNK_SIZE)
+        {
+            *Out = '\0';
+            ShowMessages("%s", Chunk);
+            Out = Chunk;
+        }
+
+        for (; i % HEX_DUMP_BYTES_PER_LINE != 0; i++)
+        {
+            *Out++ = ' ';
+            *Out++ = ' ';
+            *Out++ = ' ';
+        }
+
+        *Out++ = ' ';
+        memcpy(Out, Characters, NumberOfCharacters);
+        Out += NumberOfCharacters;
+        *Out++ = '\n';
+    }
+
+    *Out = '\0';
+    ShowMessages("%s", Chunk);
+}
@@ -142,6 +142,34 @@ CommandEvalCheckTestcase()
                     ShowMessages("Test result : Failed\n");
                 }
 
+                //
+                // Test serializing and loading the compiled statement (against
+                // a different base of the test module)
+                //
+                if (ScriptEngineWrapperTestCompiledScriptRoundTrip(Expr,
+                                                                   SCRIPT_ENGINE_TEST_MODULE_PARSE_BASE,
+                                                                   SCRIPT_ENGINE_TEST_MODULE_LOAD_BASE,
+                                                                   NULL))
+                {
+                    ShowMessages("Compiled script round-trip : Passed\n");
+                }
+                else
+                {
+                    ShowMessages("Compiled script round-trip : Failed\n");
+                }
+
+                //
+                // Compare the operand-specialized operators with the generic operators
+                //
+                if (ScriptEngineWrapperTestOperatorSpecialization(Expr))
+                {
+                    ShowMessages("Operator specialization differential : Passed\n");
+                }
+                else
+                {
+                    ShowMessages("Operator specialization differential : Failed\n");
+                }
+
                 //
                 // Test-case end
                 //
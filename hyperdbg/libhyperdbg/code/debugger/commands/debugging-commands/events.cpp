@@ -233,8 +233,10 @@ CommandEventsShowEvents()
     // It's an events without any argument so we have to show
     // all the currently active events
     //
-    PLIST_ENTRY TempList         = 0;
-    BOOLEAN     IsThereAnyEvents = FALSE;
+    PLIST_ENTRY TempList                  = 0;
+    BOOLEAN     IsThereAnyEvents          = FALSE;
+    BOOLEAN     IsThereAnyThrottledEvents = FALSE;
+    UINT64      SuppressedHits;
 
     TempList = &g_EventTrace;
     while (&g_EventTrace != TempList->Blink)
@@ -266,6 +268,21 @@ CommandEventsShowEvents()
                          : "disabled", /* Query is live now */
                      CommandMessage.c_str());
 
+        //
+        // Show the hits that are suppressed by the sampling and rate limiting options
+        //
+        if (CommandDetail->Throttle.SampleEveryNthHit > 1 ||
+            CommandDetail->Throttle.SampleProbability != 0 ||
+            CommandDetail->Throttle.MaximumHitsPerSecond != 0)
+        {
+            IsThereAnyThrottledEvents = TRUE;
+
+            if (CommandEventsQuerySuppressedHits(CommandDetail->Tag, 0, &SuppressedHits))
+            {
+                ShowMessages("\t\t    suppressed hits: %llx\n", SuppressedHits);
+            }
+        }
+
         if (!IsThereAnyEvents)
         {
             IsThereAnyEvents = TRUE;
@@ -276,6 +293,76 @@ CommandEventsShowEvents()
     {
         ShowMessages("no active/disabled events \n");
     }
+    else if (IsThereAnyThrottledEvents)
+    {
+        //
+        // Show the suppressed hits of each core (the cores are queried until
+        // the kernel reports an invalid core)
+        //
+        ShowMessages("\nsuppressed hits on each core:\n");
+
+        for (UINT32 CoreId = 0; CommandEventsQuerySuppressedHits(DEBUGGER_MODIFY_EVENTS_APPLY_TO_ALL_TAG, CoreId, &SuppressedHits); CoreId++)
+        {
+            ShowMessages("core %x\t: %llx\n", CoreId, SuppressedHits);
+        }
+    }
+}
+
+/**
+ * @brief Query the number of hits that are suppressed by the sampling
+ * and rate limiting options
+ * @details if the tag is DEBUGGER_MODIFY_EVENTS_APPLY_TO_ALL_TAG then the
+ * hits that are suppressed on the target core (for all events) are queried
+ *
+ * @param Tag the tag of the target event
+ * @param CoreId the target core (if the tag is DEBUGGER_MODIFY_EVENTS_APPLY_TO_ALL_TAG)
+ * @param SuppressedHits the number of suppressed hits
+ *
+ * @return BOOLEAN if the query was successful
+ */
+BOOLEAN
+CommandEventsQuerySuppressedHits(UINT64 Tag, UINT32 CoreId, UINT64 * SuppressedHits)
+{
+    BOOLEAN                Status;
+    ULONG                  ReturnedLength;
+    DEBUGGER_MODIFY_EVENTS QueryRequest = {0};
+
+    if (g_IsSerialConnectedToRemoteDebuggee)
+    {
+        //
+        // It's a remote debugger in Debugger Mode
+        //
+        return KdSendEventQuerySuppressedHitsPacketToDebuggee(Tag, CoreId, SuppressedHits);
+    }
+
+    //
+    // It's a local debugging in VMI Mode
+    //
+    AssertShowMessageReturnStmt(g_DeviceHandle, ASSERT_MESSAGE_DRIVER_NOT_LOADED, AssertReturnFalse);
+
+    QueryRequest.Tag          = Tag;
+    QueryRequest.CoreId       = CoreId;
+    QueryRequest.TypeOfAction = DEBUGGER_MODIFY_EVENTS_QUERY_SUPPRESSED_HITS;
+
+    Status = DeviceIoControl(g_DeviceHandle,                // Handle to device
+                             IOCTL_DEBUGGER_MODIFY_EVENTS,  // IO Control Code (IOCTL)
+                             &QueryRequest,                 // Input Buffer to driver.
+                             SIZEOF_DEBUGGER_MODIFY_EVENTS, // Input buffer length
+                             &QueryRequest,                 // Output Buffer from driver.
+                             SIZEOF_DEBUGGER_MODIFY_EVENTS, // Length of output
+                                                            // buffer in bytes.
+                             &ReturnedLength,               // Bytes placed in buffer.
+                             NULL                           // synchronous call
+    );
+
+    if (!Status || QueryRequest.KernelStatus != DEBUGGER_OPERATION_WAS_SUCCESSFUL)
+    {
+        return FALSE;
+    }
+
+    *SuppressedHits = QueryRequest.SuppressedHits;
+
+    return TRUE;
 }
 
 /**
@@ -22,6 +22,7 @@ CommandPreallocHelp()
     ShowMessages("prealloc : pre-allocates buffer for special purposes.\n\n");
 
     ShowMessages("syntax : \tprealloc  [Type (string)] [Count (hex)]\n");
+    ShowMessages("syntax : \tprealloc  [stats]\n");
 
     ShowMessages("\n");
     ShowMessages("\t\te.g : prealloc thread-interception 8\n");
@@ -30,6 +31,7 @@ CommandPreallocHelp()
     ShowMessages("\t\te.g : prealloc epthook2 3\n");
     ShowMessages("\t\te.g : prealloc regular-event 12\n");
     ShowMessages("\t\te.g : prealloc big-safe-buffert 1\n");
+    ShowMessages("\t\te.g : prealloc stats\n");
 
     ShowMessages("\n");
     ShowMessages("type of allocations:\n");
@@ -41,6 +43,102 @@ CommandPreallocHelp()
     ShowMessages("\tbig-event: used for pre-allocations of big instant events\n");
     ShowMessages("\tregular-safe-buffer: used for pre-allocations of the regular event safe buffers ($buffer) for instant events\n");
     ShowMessages("\tbig-safe-buffer: used for pre-allocations of the big event safe buffers ($buffer) for instant events\n");
+
+    ShowMessages("\n");
+    ShowMessages("'stats' shows the usage of the pre-allocated pools and recommends the counts for the pre-allocations\n");
+}
+
+/**
+ * @brief Show the usage statistics of the pre-allocated pools and the
+ * recommended pre-allocations
+ *
+ * @param PreallocRequest The result of the statistics query
+ *
+ * @return VOID
+ */
+VOID
+CommandPreallocShowStatistics(PDEBUGGER_PREALLOC_COMMAND PreallocRequest)
+{
+    //
+    // Name of the intentions and the type of pre-allocation that reserves them
+    // (indexed by POOL_ALLOCATION_INTENTION)
+    //
+    const struct
+    {
+        const char * Name;
+        const char * PreallocType;
+    } Intentions[POOL_ALLOCATION_INTENTION_COUNT] = {
+        {"hooked pages", "monitor"},
+        {"exec trampolines", "epthook2"},
+        {"split 2MB pages", NULL},
+        {"detour hook details", "epthook2"},
+        {"breakpoints", NULL},
+        {"thread holders", "thread-interception"},
+        {"sub-page tables", NULL},
+        {"EPT view tables", NULL},
+        {"monitor ranges", "monitor"},
+        {"regular events", "regular-event"},
+        {"big events", "big-event"},
+        {"regular actions", "regular-event"},
+        {"big actions", "big-event"},
+        {"regular safe buffers", "regular-safe-buffer"},
+        {"big safe buffers", "big-safe-buffer"},
+    };
+
+    ShowMessages("%-22s %-8s %-6s %-6s %-6s %-6s %-10s %-8s %-8s %-11s\n",
+                 "intention",
+                 "size",
+                 "free",
+                 "used",
+                 "peak",
+                 "demand",
+                 "requests",
+                 "failed",
+                 "burst",
+                 "watermarks");
+
+    for (UINT32 i = 0; i < POOL_ALLOCATION_INTENTION_COUNT; i++)
+    {
+        PPOOL_MANAGER_INTENTION_STATISTICS Statistics = &PreallocRequest->Statistics[i];
+
+        if (Statistics->Size == 0 && Statistics->NumberOfRequests == 0)
+        {
+            continue;
+        }
+
+        ShowMessages("%-22s %-8llx %-6x %-6x %-6x %-6x %-10llx %-8llx %-8x %x-%x\n",
+                     Intentions[i].Name,
+                     Statistics->Size,
+                     Statistics->NumberOfFreePools,
+                     Statistics->NumberOfBusyPools,
+                     Statistics->PeakNumberOfBusyPools,
+                     Statistics->PeakDemand,
+                     Statistics->NumberOfRequests,
+                     Statistics->NumberOfFailedRequests,
+                     Statistics->MaximumBurst,
+                     Statistics->LowWatermark,
+                     Statistics->HighWatermark);
+    }
+
+    ShowMessages("\n");
+
+    for (UINT32 i = 0; i < POOL_ALLOCATION_INTENTION_COUNT; i++)
+    {
+        PPOOL_MANAGER_INTENTION_STATISTICS Statistics = &PreallocRequest->Statistics[i];
+        UINT32                             Missing;
+
+        if (Intentions[i].PreallocType == NULL)
+        {
+            continue;
+        }
+
+        Missing = PoolWatermarkGetMissingPools(Statistics);
+
+        if (Missing != 0)
+        {
+            ShowMessages("recommended: 'prealloc %s %x' (%s)\n", Intentions[i].PreallocType, Missing, Intentions[i].Name);
+        }
+    }
 }
 
 /**
@@ -60,7 +158,8 @@ CommandPrealloc(vector<CommandToken> CommandTokens, string Command)
     DEBUGGER_PREALLOC_COMMAND PreallocRequest = {0};
     string                    SecondParam;
 
-    if (CommandTokens.size() != 3)
+    if (CommandTokens.size() != 3 &&
+        !(CommandTokens.size() == 2 && !GetLowerStringFromCommandToken(CommandTokens.at(1)).compare("stats")))
     {
         ShowMessages("incorrect use of the '%s'\n\n",
                      GetCaseSensitiveStringFromCommandToken(CommandTokens.at(0)).c_str());
@@ -105,6 +204,10 @@ CommandPrealloc(vector<CommandToken> CommandTokens, string Command)
     {
         PreallocRequest.Type = DEBUGGER_PREALLOC_COMMAND_TYPE_BIG_SAFE_BUFFER;
     }
+    else if (!SecondParam.compare("stats"))
+    {
+        PreallocRequest.Type = DEBUGGER_PREALLOC_COMMAND_TYPE_QUERY_STATISTICS;
+    }
     else
     {
         //
@@ -116,23 +219,26 @@ CommandPrealloc(vector<CommandToken> CommandTokens, string Command)
     }
 
     //
-    // Get the count of needed pre-allocated buffers
+    // Get the count of needed pre-allocated buffers (not needed for the statistics)
     //
-    if (!SymbolConvertNameOrExprToAddress(GetCaseSensitiveStringFromCommandToken(CommandTokens.at(2)), &Count))
+    if (PreallocRequest.Type != DEBUGGER_PREALLOC_COMMAND_TYPE_QUERY_STATISTICS)
     {
+        if (!SymbolConvertNameOrExprToAddress(GetCaseSensitiveStringFromCommandToken(CommandTokens.at(2)), &Count))
+        {
+            //
+            // Couldn't resolve or unknown parameter
+            //
+            ShowMessages("err, couldn't resolve error at '%s'\n",
+                         GetCaseSensitiveStringFromCommandToken(CommandTokens.at(2)).c_str());
+            return;
+        }
+
         //
-        // Couldn't resolve or unknown parameter
+        // Set the counter
         //
-        ShowMessages("err, couldn't resolve error at '%s'\n",
-                     GetCaseSensitiveStringFromCommandToken(CommandTokens.at(2)).c_str());
-        return;
+        PreallocRequest.Count = (UINT32)Count;
     }
 
-    //
-    // Set the counter
-    //
-    PreallocRequest.Count = (UINT32)Count;
-
     AssertShowMessageReturnStmt(g_DeviceHandle, ASSERT_MESSAGE_DRIVER_NOT_LOADED, AssertReturn);
 
     //
@@ -158,7 +264,14 @@ CommandPrealloc(vector<CommandToken> CommandTokens, string Command)
 
     if (PreallocRequest.KernelStatus == DEBUGGER_OPERATION_WAS_SUCCESSFUL)
     {
-        ShowMessages("the requested pools are allocated and reserved\n");
+        if (PreallocRequest.Type == DEBUGGER_PREALLOC_COMMAND_TYPE_QUERY_STATISTICS)
+        {
+            CommandPreallocShowStatistics(&PreallocRequest);
+        }
+        else
+        {
+            ShowMessages("the requested pools are allocated and reserved\n");
+        }
     }
     else
     {
@@ -15,6 +15,7 @@
 // Global Variables
 //
 extern BOOLEAN                  g_IsSerialConnectedToRemoteDebuggee;
+extern BOOLEAN                  g_IsRunningResumableOperation;
 extern ACTIVE_DEBUGGING_PROCESS g_ActiveProcessDebuggingState;
 
 /**
@@ -25,11 +26,12 @@ extern ACTIVE_DEBUGGING_PROCESS g_ActiveProcessDebuggingState;
 VOID
 CommandSearchMemoryHelp()
 {
-    ShowMessages("sb !sb sd !sd sq !sq : searches a contiguous memory for a "
+    ShowMessages("sb !sb sd !sd sq !sq sm !sm : searches a contiguous memory for a "
                  "special byte pattern\n");
     ShowMessages("sb  Byte and ASCII characters\n");
     ShowMessages("sd  Double-word values (4 bytes)\n");
     ShowMessages("sq  Quad-word values (8 bytes). \n");
+    ShowMessages("sm  Several byte patterns in one pass, '?' is a wildcard nibble. \n");
 
     ShowMessages(
         "\n If you want to search in physical (address) memory then add '!' "
@@ -38,6 +40,8 @@ CommandSearchMemoryHelp()
     ShowMessages("syntax : \tsb [StartAddress (hex)] [l Length (hex)] [BytePattern (hex)] [pid ProcessId (hex)]\n");
     ShowMessages("syntax : \tsd [StartAddress (hex)] [l Length (hex)] [BytePattern (hex)] [pid ProcessId (hex)]\n");
     ShowMessages("syntax : \tsq [StartAddress (hex)] [l Length (hex)] [BytePattern (hex)] [pid ProcessId (hex)]\n");
+    ShowMessages("syntax : \tsm [StartAddress (hex)] [l Length (hex)] [Pattern (hex)]... [range StartAddress (hex) Length (hex)]... "
+                 "[max Count (hex)] [pid ProcessId (hex)]\n");
 
     ShowMessages("\n");
     ShowMessages("\t\te.g : sb nt!ExAllocatePoolWithTag 90 85 95 l ffff \n");
@@ -49,6 +53,8 @@ CommandSearchMemoryHelp()
     ShowMessages("\t\te.g : !sq @rdx+r12 9090909090909090 l ffff\n");
     ShowMessages("\t\te.g : !sq 100000 9090909090909090 9090909090909090 "
                  "9090909090909090 l ffffff\n");
+    ShowMessages("\t\te.g : sm nt!ExAllocatePoolWithTag l ffff 4889??24 cccc 0f05 max 10\n");
+    ShowMessages("\t\te.g : !sm 100000 l ffffff 4d5a9000 range 8000000 ffffff\n");
 }
 
 /**
@@ -127,6 +133,510 @@ CommandSearchSendRequest(UINT64 * BufferToSendAsIoctl, UINT32 BufferToSendAsIoct
     free(ResultsBuffer);
 }
 
+/**
+ * @brief Send the request of search to the debuggee
+ * @details the debuggee performs the search in slices and shows the
+ * results of each slice, the search is continued from the next address
+ * of the previous slice, CTRL+C cancels the search
+ *
+ * @param SearchRequestBuffer the request (DEBUGGER_SEARCH_MEMORY) and
+ * the values after it
+ * @param SearchRequestBufferSize
+ * @return VOID
+ */
+VOID
+CommandSearchSendRequestToDebuggee(UINT64 * SearchRequestBuffer, UINT32 SearchRequestBufferSize)
+{
+    PDEBUGGER_SEARCH_MEMORY          SearchRequest = (PDEBUGGER_SEARCH_MEMORY)SearchRequestBuffer;
+    DEBUGGEE_RESULT_OF_SEARCH_PACKET SearchResult  = {0};
+    UINT64                           EndAddress    = SearchRequest->Address + SearchRequest->Length;
+    UINT32                           TotalResults  = 0;
+
+    g_IsRunningResumableOperation = TRUE;
+
+    SearchRequest->Cursor.Action            = DEBUGGER_OPERATION_CURSOR_ACTION_START;
+    SearchRequest->Cursor.ContinuationToken = 0;
+
+    while (TRUE)
+    {
+        ZeroMemory(&SearchResult, sizeof(DEBUGGEE_RESULT_OF_SEARCH_PACKET));
+
+        if (!KdSendSearchRequestPacketToDebuggee(SearchRequestBuffer, SearchRequestBufferSize, &SearchResult))
+        {
+            break;
+        }
+
+        if (SearchResult.Result != DEBUGGER_OPERATION_WAS_SUCCESSFUL)
+        {
+            ShowErrorMessage(SearchResult.Result);
+            break;
+        }
+
+        if (SearchRequest->Cursor.Action == DEBUGGER_OPERATION_CURSOR_ACTION_CANCEL)
+        {
+            ShowMessages("the search is cancelled\n");
+            break;
+        }
+
+        TotalResults += SearchResult.CountOfResults;
+
+        if (SearchResult.Cursor.ContinuationToken == 0 || SearchResult.NextAddress >= EndAddress)
+        {
+            //
+            // The search is finished
+            //
+            if (TotalResults == 0)
+            {
+                ShowMessages("not found\n");
+            }
+
+            break;
+        }
+
+        //
+        // Continue the search from the next address, or cancel it if the
+        // user pressed CTRL+C
+        //
+        SearchRequest->Address                  = SearchResult.NextAddress;
+        SearchRequest->Length                   = EndAddress - SearchResult.NextAddress;
+        SearchRequest->Cursor.Action            = g_IsRunningResumableOperation ? DEBUGGER_OPERATION_CURSOR_ACTION_CONTINUE : DEBUGGER_OPERATION_CURSOR_ACTION_CANCEL;
+        SearchRequest->Cursor.ContinuationToken = SearchResult.Cursor.ContinuationToken;
+    }
+
+    g_IsRunningResumableOperation = FALSE;
+}
+
+/**
+ * @brief Convert a hex pattern with wildcards ('?' for each nibble)
+ * to the pattern of the multi-pattern search
+ *
+ * @param PatternString
+ * @param Pattern
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+CommandSearchConvertStringToPattern(std::string PatternString, PDEBUGGER_SEARCH_PATTERN Pattern)
+{
+    UINT32 NibbleIndex = 0;
+
+    //
+    // Remove the hex notations
+    //
+    if (PatternString.rfind("0x", 0) == 0 || PatternString.rfind("0X", 0) == 0 ||
+        PatternString.rfind("\\x", 0) == 0 || PatternString.rfind("\\X", 0) == 0)
+    {
+        PatternString = PatternString.erase(0, 2);
+    }
+
+    PatternString.erase(remove(PatternString.begin(), PatternString.end(), '`'), PatternString.end());
+
+    if (PatternString.empty() || PatternString.size() % 2 != 0 ||
+        PatternString.size() / 2 > MaximumSearchPatternLength)
+    {
+        return FALSE;
+    }
+
+    ZeroMemory(Pattern, sizeof(DEBUGGER_SEARCH_PATTERN));
+
+    for (char Nibble : PatternString)
+    {
+        BYTE Value;
+        BYTE Mask  = 0xf;
+        BYTE Shift = (NibbleIndex % 2 == 0) ? 4 : 0;
+
+        if (Nibble >= '0' && Nibble <= '9')
+        {
+            Value = Nibble - '0';
+        }
+        else if (Nibble >= 'a' && Nibble <= 'f')
+        {
+            Value = Nibble - 'a' + 10;
+        }
+        else if (Nibble >= 'A' && Nibble <= 'F')
+        {
+            Value = Nibble - 'A' + 10;
+        }
+        else if (Nibble == '?')
+        {
+            Value = 0;
+            Mask  = 0;
+        }
+        else
+        {
+            return FALSE;
+        }
+
+        Pattern->Bytes[NibbleIndex / 2] |= Value << Shift;
+        Pattern->Masks[NibbleIndex / 2] |= Mask << Shift;
+
+        NibbleIndex++;
+    }
+
+    Pattern->Length = NibbleIndex / 2;
+
+    return TRUE;
+}
+
+/**
+ * @brief Show the results of the multi-pattern search
+ *
+ * @param SearchResult the request and the results after it
+ *
+ * @return UINT32 number of the shown results
+ */
+UINT32
+CommandSearchMultiplePatternsShowResults(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS SearchResult)
+{
+    PDEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT Results;
+    UINT32                                    NumberOfResults = SearchResult->NumberOfResults;
+
+    if (NumberOfResults > MaximumSearchMultiplePatternsResults)
+    {
+        NumberOfResults = MaximumSearchMultiplePatternsResults;
+    }
+
+    Results = (PDEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT)((CHAR *)SearchResult + SIZEOF_DEBUGGER_SEARCH_MULTIPLE_PATTERNS);
+
+    for (UINT32 i = 0; i < NumberOfResults; i++)
+    {
+        ShowMessages("%llx  (pattern %d)\n", Results[i].Address, Results[i].PatternId);
+    }
+
+    return NumberOfResults;
+}
+
+/**
+ * @brief Send the request of the multi-pattern search to the kernel
+ * or to the debuggee and show the results
+ * @details in the debugger mode, the debuggee performs the search in
+ * slices and the results of each slice are shown before continuing
+ * the search, CTRL+C cancels the search
+ *
+ * @param SearchRequest
+ *
+ * @return VOID
+ */
+VOID
+CommandSearchMultiplePatternsSendRequest(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS SearchRequest)
+{
+    BOOL                               Status;
+    UINT32                             ResultsBufferSize;
+    PDEBUGGER_SEARCH_MULTIPLE_PATTERNS SearchResult;
+    UINT32                             TotalResults = 0;
+
+    ResultsBufferSize = SIZEOF_DEBUGGER_SEARCH_MULTIPLE_PATTERNS +
+                        MaximumSearchMultiplePatternsResults * sizeof(DEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT);
+
+    //
+    // Allocate a buffer to store the request and the results after it
+    //
+    SearchResult = (PDEBUGGER_SEARCH_MULTIPLE_PATTERNS)malloc(ResultsBufferSize);
+
+    if (SearchResult == NULL)
+    {
+        ShowMessages("unable to allocate memory\n\n");
+        return;
+    }
+
+    ZeroMemory(SearchResult, ResultsBufferSize);
+
+    if (g_IsSerialConnectedToRemoteDebuggee)
+    {
+        g_IsRunningResumableOperation = TRUE;
+
+        SearchRequest->Cursor.Action            = DEBUGGER_OPERATION_CURSOR_ACTION_START;
+        SearchRequest->Cursor.ContinuationToken = 0;
+
+        while (TRUE)
+        {
+            //
+            // The request should be sent to the debuggee
+            //
+            if (!KdSendSearchMultiplePatternsPacketToDebuggee(SearchRequest, SearchResult, ResultsBufferSize))
+            {
+                break;
+            }
+
+            if (SearchResult->KernelStatus != DEBUGGER_OPERATION_WAS_SUCCESSFUL)
+            {
+                ShowErrorMessage(SearchResult->KernelStatus);
+                break;
+            }
+
+            if (SearchRequest->Cursor.Action == DEBUGGER_OPERATION_CURSOR_ACTION_CANCEL)
+            {
+                ShowMessages("the search is cancelled\n");
+                break;
+            }
+
+            TotalResults += CommandSearchMultiplePatternsShowResults(SearchResult);
+
+            if (SearchResult->Cursor.ContinuationToken == 0)
+            {
+                //
+                // The search is finished
+                //
+                if (TotalResults == 0)
+                {
+                    ShowMessages("not found\n");
+                }
+
+                break;
+            }
+
+            //
+            // Continue the search, or cancel it if the user pressed CTRL+C
+            //
+            SearchRequest->Cursor.Action            = g_IsRunningResumableOperation ? DEBUGGER_OPERATION_CURSOR_ACTION_CONTINUE : DEBUGGER_OPERATION_CURSOR_ACTION_CANCEL;
+            SearchRequest->Cursor.ContinuationToken = SearchResult->Cursor.ContinuationToken;
+
+            ZeroMemory(SearchResult, ResultsBufferSize);
+        }
+
+        g_IsRunningResumableOperation = FALSE;
+    }
+    else
+    {
+        //
+        // Fire the IOCTL
+        //
+        Status = DeviceIoControl(g_DeviceHandle,                           // Handle to device
+                                 IOCTL_DEBUGGER_SEARCH_MULTIPLE_PATTERNS,  // IO Control Code (IOCTL)
+                                 SearchRequest,                            // Input Buffer to driver.
+                                 SIZEOF_DEBUGGER_SEARCH_MULTIPLE_PATTERNS, // Input buffer length
+                                 SearchResult,                             // Output Buffer from driver.
+                                 ResultsBufferSize,                        // Length of output buffer in bytes.
+                                 NULL,                                     // Bytes placed in buffer.
+                                 NULL                                      // synchronous call
+        );
+
+        if (!Status)
+        {
+            ShowMessages("ioctl failed with code 0x%x\n", GetLastError());
+        }
+        else if (SearchResult->KernelStatus != DEBUGGER_OPERATION_WAS_SUCCESSFUL)
+        {
+            ShowErrorMessage(SearchResult->KernelStatus);
+        }
+        else
+        {
+            //
+            // Show the results (if any)
+            //
+            if (CommandSearchMultiplePatternsShowResults(SearchResult) == 0)
+            {
+                ShowMessages("not found\n");
+            }
+
+            if (!SearchResult->Cursor.IsFinished)
+            {
+                ShowMessages("the results are truncated, the search stopped at the maximum number of results\n");
+            }
+        }
+    }
+
+    //
+    // Free buffer
+    //
+    free(SearchResult);
+}
+
+/**
+ * @brief !sm sm commands handler
+ *
+ * @param CommandTokens
+ *
+ * @return VOID
+ */
+VOID
+CommandSearchMultiplePatterns(vector<CommandToken> CommandTokens)
+{
+    DEBUGGER_SEARCH_MULTIPLE_PATTERNS SearchRequest = {0};
+    UINT64                            Address       = 0;
+    UINT64                            Length        = 0;
+    UINT32                            ProcId        = 0;
+    BOOLEAN                           SetAddress    = FALSE;
+    BOOLEAN                           SetLength     = FALSE;
+    BOOLEAN                           SetProcId     = FALSE;
+    BOOLEAN                           SetMaximum    = FALSE;
+
+    //
+    // By default if the user-debugger is active, we use these commands
+    // on the memory layout of the debuggee process
+    //
+    if (g_ActiveProcessDebuggingState.IsActive)
+    {
+        ProcId = g_ActiveProcessDebuggingState.ProcessId;
+    }
+
+    if (CompareLowerCaseStrings(CommandTokens.at(0), "!sm"))
+    {
+        SearchRequest.MemoryType = SEARCH_PHYSICAL_MEMORY;
+    }
+    else
+    {
+        SearchRequest.MemoryType = SEARCH_VIRTUAL_MEMORY;
+    }
+
+    for (size_t i = 1; i < CommandTokens.size(); i++)
+    {
+        if (!SetProcId && CompareLowerCaseStrings(CommandTokens.at(i), "pid"))
+        {
+            if (i + 1 >= CommandTokens.size() || !ConvertTokenToUInt32(CommandTokens.at(i + 1), &ProcId))
+            {
+                ShowMessages("please specify a correct hex process id\n\n");
+                CommandSearchMemoryHelp();
+                return;
+            }
+
+            SetProcId = TRUE;
+            i++;
+            continue;
+        }
+
+        if (!SetMaximum && CompareLowerCaseStrings(CommandTokens.at(i), "max"))
+        {
+            if (i + 1 >= CommandTokens.size() || !ConvertTokenToUInt32(CommandTokens.at(i + 1), &SearchRequest.MaximumResultsPerPattern))
+            {
+                ShowMessages("please specify a correct hex value as the maximum results of each pattern\n\n");
+                CommandSearchMemoryHelp();
+                return;
+            }
+
+            SetMaximum = TRUE;
+            i++;
+            continue;
+        }
+
+        if (!SetLength && CompareLowerCaseStrings(CommandTokens.at(i), "l"))
+        {
+            if (i + 1 >= CommandTokens.size() || !ConvertTokenToUInt64(CommandTokens.at(i + 1), &Length))
+            {
+                ShowMessages("please specify a correct hex length\n\n");
+                CommandSearchMemoryHelp();
+                return;
+            }
+
+            SetLength = TRUE;
+            i++;
+            continue;
+        }
+
+        if (CompareLowerCaseStrings(CommandTokens.at(i), "range"))
+        {
+            //
+            // Additional ranges are in the 'range [StartAddress] [Length]' form
+            //
+            if (SearchRequest.NumberOfRanges + 1 >= MaximumSearchRanges)
+            {
+                ShowMessages("err, at most %d ranges can be searched\n\n", MaximumSearchRanges);
+                return;
+            }
+
+            if (i + 2 >= CommandTokens.size() ||
+                !SymbolConvertNameOrExprToAddress(GetCaseSensitiveStringFromCommandToken(CommandTokens.at(i + 1)),
+                                                  &SearchRequest.Ranges[SearchRequest.NumberOfRanges + 1].Address) ||
+                !ConvertTokenToUInt64(CommandTokens.at(i + 2), &SearchRequest.Ranges[SearchRequest.NumberOfRanges + 1].Length))
+            {
+                ShowMessages("please specify a correct range (address and length)\n\n");
+                CommandSearchMemoryHelp();
+                return;
+            }
+
+            SearchRequest.NumberOfRanges++;
+            i += 2;
+            continue;
+        }
+
+        if (!SetAddress)
+        {
+            if (!SymbolConvertNameOrExprToAddress(GetCaseSensitiveStringFromCommandToken(CommandTokens.at(i)), &Address))
+            {
+                ShowMessages("err, couldn't resolve error at '%s'\n\n",
+                             GetCaseSensitiveStringFromCommandToken(CommandTokens.at(i)).c_str());
+                CommandSearchMemoryHelp();
+                return;
+            }
+
+            SetAddress = TRUE;
+            continue;
+        }
+
+        //
+        // Otherwise, it's a pattern
+        //
+        if (SearchRequest.NumberOfPatterns == MaximumSearchPatterns)
+        {
+            ShowMessages("err, at most %d patterns can be searched\n\n", MaximumSearchPatterns);
+            return;
+        }
+
+        if (!CommandSearchConvertStringToPattern(GetCaseSensitiveStringFromCommandToken(CommandTokens.at(i)),
+                                                 &SearchRequest.Patterns[SearchRequest.NumberOfPatterns]))
+        {
+            ShowMessages("please specify a correct hex pattern (up to %d bytes, '?' for wildcard nibbles) at '%s'\n\n",
+                         MaximumSearchPatternLength,
+                         GetCaseSensitiveStringFromCommandToken(CommandTokens.at(i)).c_str());
+            return;
+        }
+
+        SearchRequest.NumberOfPatterns++;
+    }
+
+    //
+    // Check if address, length and patterns are set or not
+    //
+    if (!SetAddress)
+    {
+        ShowMessages("please specify a correct hex address\n\n");
+        CommandSearchMemoryHelp();
+        return;
+    }
+    if (!SetLength)
+    {
+        ShowMessages("please specify a correct hex value as the length\n\n");
+        CommandSearchMemoryHelp();
+        return;
+    }
+    if (SearchRequest.NumberOfPatterns == 0)
+    {
+        ShowMessages("please specify a correct hex pattern as the content to search\n\n");
+        CommandSearchMemoryHelp();
+        return;
+    }
+
+    //
+    // Check to prevent using process id in s* commands
+    //
+    if (g_IsSerialConnectedToRemoteDebuggee && ProcId != 0)
+    {
+        ShowMessages(ASSERT_MESSAGE_CANNOT_SPECIFY_PID);
+        return;
+    }
+
+    if (ProcId == 0)
+    {
+        ProcId = GetCurrentProcessId();
+    }
+
+    //
+    // The first range is the main address and length
+    //
+    SearchRequest.Ranges[0].Address = Address;
+    SearchRequest.Ranges[0].Length  = Length;
+    SearchRequest.NumberOfRanges++;
+
+    SearchRequest.ProcessId = ProcId;
+
+    if (!g_IsSerialConnectedToRemoteDebuggee)
+    {
+        AssertShowMessageReturnStmt(g_DeviceHandle, ASSERT_MESSAGE_DRIVER_NOT_LOADED, AssertReturn);
+    }
+
+    CommandSearchMultiplePatternsSendRequest(&SearchRequest);
+}
+
 /**
  * @brief !s* s* commands handler
  *
@@ -164,6 +674,15 @@ CommandSearchMemory(vector<CommandToken> CommandTokens, string Command)
         ProcId = g_ActiveProcessDebuggingState.ProcessId;
     }
 
+    //
+    // Searching several patterns is handled separately
+    //
+    if (CompareLowerCaseStrings(CommandTokens.at(0), "sm") || CompareLowerCaseStrings(CommandTokens.at(0), "!sm"))
+    {
+        CommandSearchMultiplePatterns(CommandTokens);
+        return;
+    }
+
     if (CommandTokens.size() <= 4)
     {
         ShowMessages("incorrect use of the '%s'\n\n",
@@ -491,7 +1010,7 @@ CommandSearchMemory(vector<CommandToken> CommandTokens, string Command)
         //
         // The buffer should be sent to the debugger
         //
-        KdSendSearchRequestPacketToDebuggee(FinalBuffer, FinalSize);
+        CommandSearchSendRequestToDebuggee(FinalBuffer, FinalSize);
     }
     else
     {
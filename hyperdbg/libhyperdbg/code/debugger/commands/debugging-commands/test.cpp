@@ -38,6 +38,11 @@ CommandTestHelp()
     ShowMessages("\t\te.g : test breakpoint off\n");
     ShowMessages("\t\te.g : test trap on\n");
     ShowMessages("\t\te.g : test trap off\n");
+    ShowMessages("\t\te.g : test unit\n");
+    ShowMessages("\t\te.g : test unit script-operators\n");
+    ShowMessages("\t\te.g : test bench\n");
+    ShowMessages("\t\te.g : test bench script-operators\n");
+    ShowMessages("\t\te.g : test list\n");
 }
 
 /**
@@ -106,6 +111,15 @@ CommandTestAllFunctionalities()
     HANDLE ThreadHandle;
     HANDLE ProcessHandle;
 
+    //
+    // Test the components of the debugger
+    //
+    if (!OpenHyperDbgTestProcess(&ThreadHandle, &ProcessHandle, (CHAR *)TEST_CASE_PARAMETER_FOR_UNIT_TESTS))
+    {
+        ShowMessages("err, start HyperDbg test process for running the unit tests\n");
+        return;
+    }
+
     //
     // Test command parser
     //
@@ -146,6 +160,35 @@ CommandTestAllHwdbg()
     }
 }
 
+/**
+ * @brief run the unit tests or the benchmarks of the components in
+ * the test process
+ *
+ * @param TestCaseParameter The test case of the test process
+ * @param Name Name of the unit test or NULL for all the unit tests
+ *
+ * @return VOID
+ */
+VOID
+CommandTestUnitTests(const CHAR * TestCaseParameter, const CHAR * Name)
+{
+    HANDLE ThreadHandle;
+    HANDLE ProcessHandle;
+    string Args = TestCaseParameter;
+
+    if (Name != NULL)
+    {
+        Args += " ";
+        Args += Name;
+    }
+
+    if (!OpenHyperDbgTestProcess(&ThreadHandle, &ProcessHandle, (CHAR *)Args.c_str()))
+    {
+        ShowMessages("err, start HyperDbg test process for running the unit tests\n");
+        return;
+    }
+}
+
 /**
  * @brief perform test on the remote process
  *
@@ -526,6 +569,43 @@ CommandTest(vector<CommandToken> CommandTokens, string Command)
         //
         CommandTestAllHwdbg();
     }
+    else if (CommandSize == 2 && CompareLowerCaseStrings(CommandTokens.at(1), "unit"))
+    {
+        //
+        // Run all the unit tests of the components
+        //
+        CommandTestUnitTests(TEST_CASE_PARAMETER_FOR_UNIT_TESTS, NULL);
+    }
+    else if (CommandSize == 3 && CompareLowerCaseStrings(CommandTokens.at(1), "unit"))
+    {
+        //
+        // Run a single unit test
+        //
+        CommandTestUnitTests(TEST_CASE_PARAMETER_FOR_UNIT_TESTS,
+                             GetCaseSensitiveStringFromCommandToken(CommandTokens.at(2)).c_str());
+    }
+    else if (CommandSize == 2 && CompareLowerCaseStrings(CommandTokens.at(1), "bench"))
+    {
+        //
+        // Run all the benchmarks of the components
+        //
+        CommandTestUnitTests(TEST_CASE_PARAMETER_FOR_BENCHMARKS, NULL);
+    }
+    else if (CommandSize == 3 && CompareLowerCaseStrings(CommandTokens.at(1), "bench"))
+    {
+        //
+        // Run a single benchmark
+        //
+        CommandTestUnitTests(TEST_CASE_PARAMETER_FOR_BENCHMARKS,
+                             GetCaseSensitiveStringFromCommandToken(CommandTokens.at(2)).c_str());
+    }
+    else if (CommandSize == 2 && CompareLowerCaseStrings(CommandTokens.at(1), "list"))
+    {
+        //
+        // Show the list of the unit tests
+        //
+        CommandTestUnitTests(TEST_CASE_PARAMETER_FOR_UNIT_TESTS_LIST, NULL);
+    }
     else
     {
         ShowMessages("incorrect use of the '%s'\n\n",
@@ -24,6 +24,7 @@ CommandCpuidHelp()
 
     ShowMessages("syntax : \t!cpuid [Eax (hex)] [pid ProcessId (hex)] [core CoreId (hex)] "
                  "[imm IsImmediate (yesno)] [sc EnableShortCircuiting (onoff)] [stage CallingStage (prepostall)] "
+                 "[sample Interval (hex)] [probability Percent (decimal)] [rate HitsPerSecond (hex)] [burst BurstSize (hex)] "
                  "[buffer PreAllocatedBuffer (hex)] [script { Script (string) }] [asm condition { Condition (assembly/hex) }] "
                  "[asm code { Code (assembly/hex) }] [output {OutputName (string)}]\n");
 
@@ -34,6 +35,7 @@ CommandCpuidHelp()
     ShowMessages("\t\te.g : !cpuid core 2 pid 400\n");
     ShowMessages("\t\te.g : !cpuid script { printf(\"CPUID instruction is executed with the 'eax' register equal to: %%llx\\n\", @eax); }\n");
     ShowMessages("\t\te.g : !cpuid asm code { nop; nop; nop }\n");
+    ShowMessages("\t\te.g : !cpuid probability 1%%\n");
 }
 
 /**
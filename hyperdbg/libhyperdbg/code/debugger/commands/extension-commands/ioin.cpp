@@ -24,6 +24,7 @@ CommandIoinHelp()
 
     ShowMessages("syntax : \t!ioin [Port (hex)] [pid ProcessId (hex)] [core CoreId (hex)] "
                  "[imm IsImmediate (yesno)] [sc EnableShortCircuiting (onoff)] [stage CallingStage (prepostall)] "
+                 "[sample Interval (hex)] [probability Percent (decimal)] [rate HitsPerSecond (hex)] [burst BurstSize (hex)] [disarm] "
                  "[buffer PreAllocatedBuffer (hex)] [script { Script (string) }] [asm condition { Condition (assembly/hex) }] "
                  "[asm code { Code (assembly/hex) }] [output {OutputName (string)}]\n");
 
@@ -34,6 +35,7 @@ CommandIoinHelp()
     ShowMessages("\t\te.g : !ioin core 2 pid 400\n");
     ShowMessages("\t\te.g : !ioin script { printf(\"IN instruction is executed at port: %%llx\\n\", $context); }\n");
     ShowMessages("\t\te.g : !ioin asm code { nop; nop; nop }\n");
+    ShowMessages("\t\te.g : !ioin 0x64 rate 64 burst 8 disarm\n");
 }
 
 /**
@@ -24,6 +24,7 @@ CommandIooutHelp()
 
     ShowMessages("syntax : \t!ioout [Port (hex)] [pid ProcessId (hex)] "
                  "[core CoreId (hex)] [imm IsImmediate (yesno)] [sc EnableShortCircuiting (onoff)] "
+                 "[sample Interval (hex)] [probability Percent (decimal)] [rate HitsPerSecond (hex)] [burst BurstSize (hex)] [disarm] "
                  "[stage CallingStage (prepostall)] [buffer PreAllocatedBuffer (hex)] [script { Script (string) }] "
                  "[asm condition { Condition (assembly/hex) }] [asm code { Code (assembly/hex) }] [output {OutputName (string)}]\n");
 
@@ -34,6 +35,7 @@ CommandIooutHelp()
     ShowMessages("\t\te.g : !ioout core 2 pid 400\n");
     ShowMessages("\t\te.g : !ioout script { printf(\"OUT instruction is executed at port: %%llx\\n\", $context); }\n");
     ShowMessages("\t\te.g : !ioout asm code { nop; nop; nop }\n");
+    ShowMessages("\t\te.g : !ioout sample 10 rate 3e8\n");
 }
 
 /**
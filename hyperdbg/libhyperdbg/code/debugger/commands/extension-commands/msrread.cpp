@@ -23,6 +23,7 @@ CommandMsrreadHelp()
 
     ShowMessages("syntax : \t!msrread [Msr (hex)] [pid ProcessId (hex)] "
                  "[core CoreId (hex)] [imm IsImmediate (yesno)] [sc EnableShortCircuiting (onoff)] "
+                 "[sample Interval (hex)] [probability Percent (decimal)] [rate HitsPerSecond (hex)] [burst BurstSize (hex)] [disarm] "
                  "[stage CallingStage (prepostall)] [buffer PreAllocatedBuffer (hex)] [script { Script (string) }] "
                  "[asm condition { Condition (assembly/hex) }] [asm code { Code (assembly/hex) }] [output {OutputName (string)}]\n");
 
@@ -33,6 +34,7 @@ CommandMsrreadHelp()
     ShowMessages("\t\te.g : !msrread core 2 pid 400\n");
     ShowMessages("\t\te.g : !msrread script { printf(\"msr read with the 'ecx' register equal to: %%llx\\n\", $context); }\n");
     ShowMessages("\t\te.g : !msrread asm code { nop; nop; nop }\n");
+    ShowMessages("\t\te.g : !msrread 0xc0000082 rate 64 disarm\n");
 }
 
 /**
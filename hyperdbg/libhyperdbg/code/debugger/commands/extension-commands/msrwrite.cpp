@@ -23,6 +23,7 @@ CommandMsrwriteHelp()
 
     ShowMessages("syntax : \t!msrwrite [Msr (hex)] [pid ProcessId (hex)] [core CoreId (hex)] "
                  "[imm IsImmediate (yesno)] [sc EnableShortCircuiting (onoff)] [stage CallingStage (prepostall)] "
+                 "[sample Interval (hex)] [probability Percent (decimal)] [rate HitsPerSecond (hex)] [burst BurstSize (hex)] [disarm] "
                  "[buffer PreAllocatedBuffer (hex)] [script { Script (string) }] [asm condition { Condition (assembly/hex) }] "
                  "[asm code { Code (assembly/hex) }] [output {OutputName (string)}]\n");
 
@@ -33,6 +34,7 @@ CommandMsrwriteHelp()
     ShowMessages("\t\te.g : !msrwrite core 2 pid 400\n");
     ShowMessages("\t\te.g : !msrwrite script { printf(\"msr write with the 'ecx' register equal to: %%llx\\n\", $context); }\n");
     ShowMessages("\t\te.g : !msrwrite asm code { nop; nop; nop }\n");
+    ShowMessages("\t\te.g : !msrwrite probability 12.5%% rate 3e8\n");
 }
 
 /**
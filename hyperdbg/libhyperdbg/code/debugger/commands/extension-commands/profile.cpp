@@ -0,0 +1,455 @@
+/**
+ * @file profile.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief !profile command
+ * @details
+ * @version 0.11
+ * @date 2024-11-01
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+//
+// Global Variables
+//
+extern BOOLEAN                                      g_IsSerialConnectedToRemoteDebuggee;
+extern std::map<UINT64, LOCAL_FUNCTION_DESCRIPTION> g_DisassemblerSymbolMap;
+extern PROFILER_AGGREGATED_SAMPLES                  g_ProfilerAggregatedSamples;
+extern SRWLOCK                                      g_ProfilerLock;
+extern HANDLE                                       g_ProfilerDrainThread;
+extern volatile BOOLEAN                             g_ProfilerIsRunning;
+
+/**
+ * @brief help of the !profile command
+ *
+ * @return VOID
+ */
+VOID
+CommandProfileHelp()
+{
+    ShowMessages("!profile : samples the running code on all cores by using the VMX-preemption timer "
+                 "and shows the hottest functions and processes.\n\n");
+
+    ShowMessages("syntax : \t!profile [start] [freq Frequency (hex)] [depth StackDepth (hex)] [pid ProcessId (hex)]\n");
+    ShowMessages("syntax : \t!profile [stop]\n");
+    ShowMessages("syntax : \t!profile [show] [count Count (hex)]\n");
+    ShowMessages("syntax : \t!profile [clear]\n");
+
+    ShowMessages("\n");
+    ShowMessages("\t\te.g : !profile start\n");
+    ShowMessages("\t\te.g : !profile start freq 3e8 depth 8\n");
+    ShowMessages("\t\te.g : !profile start pid 1c0\n");
+    ShowMessages("\t\te.g : !profile stop\n");
+    ShowMessages("\t\te.g : !profile show\n");
+    ShowMessages("\t\te.g : !profile show count 30\n");
+    ShowMessages("\t\te.g : !profile clear\n");
+
+    ShowMessages("\n");
+    ShowMessages("note : the frequency is the number of samples per second on each core (default: %x, maximum: %x), "
+                 "the stack entries are the values on the stack that look like return addresses (maximum: %x)\n",
+                 DefaultProfilerSamplingFrequency,
+                 MaximumProfilerSamplingFrequency,
+                 MaximumProfilerStackDepth);
+}
+
+/**
+ * @brief Send the profiler request to the kernel
+ *
+ * @param ProfilerRequest
+ * @param RequestSize
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+CommandProfileSendRequest(PDEBUGGER_PROFILER_REQUEST ProfilerRequest, UINT32 RequestSize)
+{
+    BOOL  Status;
+    ULONG ReturnedLength;
+
+    AssertShowMessageReturnStmt(g_DeviceHandle, ASSERT_MESSAGE_DRIVER_NOT_LOADED, AssertReturnFalse);
+
+    //
+    // Send IOCTL
+    //
+    Status = DeviceIoControl(
+        g_DeviceHandle,                   // Handle to device
+        IOCTL_DEBUGGER_PROFILER,          // IO Control Code (IOCTL)
+        ProfilerRequest,                  // Input Buffer to driver.
+        SIZEOF_DEBUGGER_PROFILER_REQUEST, // Input buffer length
+        ProfilerRequest,                  // Output Buffer from driver.
+        RequestSize,                      // Length of output buffer in bytes.
+        &ReturnedLength,                  // Bytes placed in buffer.
+        NULL                              // synchronous call
+    );
+
+    if (!Status)
+    {
+        ShowMessages("ioctl failed with code 0x%x\n", GetLastError());
+        return FALSE;
+    }
+
+    return ProfilerRequest->KernelStatus == DEBUGGER_OPERATION_WAS_SUCCESSFUL;
+}
+
+/**
+ * @brief Read the samples of all cores and aggregate them
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+CommandProfileDrainSamples()
+{
+    SYSTEM_INFO                SysInfo;
+    PDEBUGGER_PROFILER_REQUEST ProfilerRequest;
+    UINT32                     RequestSize = SIZEOF_DEBUGGER_PROFILER_REQUEST +
+                         MaximumProfilerSamplesPerRequest * sizeof(DEBUGGER_PROFILER_SAMPLE);
+
+    ProfilerRequest = (PDEBUGGER_PROFILER_REQUEST)malloc(RequestSize);
+
+    if (ProfilerRequest == NULL)
+    {
+        return FALSE;
+    }
+
+    GetSystemInfo(&SysInfo);
+
+    for (UINT32 CoreId = 0; CoreId < SysInfo.dwNumberOfProcessors; CoreId++)
+    {
+        //
+        // Read until the samples of the core are completely drained
+        //
+        do
+        {
+            RtlZeroMemory(ProfilerRequest, SIZEOF_DEBUGGER_PROFILER_REQUEST);
+
+            ProfilerRequest->RequestType = DEBUGGER_PROFILER_REQUEST_READ_SAMPLES;
+            ProfilerRequest->CoreId      = CoreId;
+
+            if (!CommandProfileSendRequest(ProfilerRequest, RequestSize))
+            {
+                free(ProfilerRequest);
+                return FALSE;
+            }
+
+            AcquireSRWLockExclusive(&g_ProfilerLock);
+
+            ProfilerAggregateSamples(&g_ProfilerAggregatedSamples,
+                                     (PDEBUGGER_PROFILER_SAMPLE)((CHAR *)ProfilerRequest + SIZEOF_DEBUGGER_PROFILER_REQUEST),
+                                     ProfilerRequest->NumberOfSamples);
+
+            ProfilerAggregateCoreCounters(&g_ProfilerAggregatedSamples,
+                                          CoreId,
+                                          ProfilerRequest->TotalSamples,
+                                          ProfilerRequest->DroppedSamples);
+
+            ReleaseSRWLockExclusive(&g_ProfilerLock);
+
+        } while (ProfilerRequest->NumberOfSamples == MaximumProfilerSamplesPerRequest);
+    }
+
+    free(ProfilerRequest);
+
+    return TRUE;
+}
+
+/**
+ * @brief The thread that drains the samples while the profiler is running
+ *
+ * @param Parameter
+ *
+ * @return DWORD
+ */
+DWORD WINAPI
+CommandProfileDrainThread(PVOID Parameter)
+{
+    UNREFERENCED_PARAMETER(Parameter);
+
+    while (g_ProfilerIsRunning)
+    {
+        if (!CommandProfileDrainSamples())
+        {
+            //
+            // The driver is not available anymore
+            //
+            break;
+        }
+
+        Sleep(PROFILER_DRAIN_INTERVAL);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Show the aggregated samples of the profiler
+ *
+ * @param Count Maximum number of the shown functions
+ *
+ * @return VOID
+ */
+VOID
+CommandProfileShowResults(UINT32 Count)
+{
+    std::vector<PROFILER_FUNCTION_SAMPLES> Functions;
+    std::vector<std::pair<UINT32, UINT64>> Processes;
+    UINT64                                 TotalSamples   = 0;
+    UINT64                                 DroppedSamples = 0;
+    UINT64                                 NumberOfSamples;
+
+    //
+    // Build the symbol map (if not built before) to convert the
+    // addresses to the functions
+    //
+    if (g_DisassemblerSymbolMap.empty())
+    {
+        SymbolCreateDisassemblerSymbolMap();
+    }
+
+    AcquireSRWLockShared(&g_ProfilerLock);
+
+    NumberOfSamples = g_ProfilerAggregatedSamples.NumberOfSamples;
+
+    for (const auto & Core : g_ProfilerAggregatedSamples.TotalSamplesOfCores)
+    {
+        TotalSamples += Core.second;
+    }
+
+    for (const auto & Core : g_ProfilerAggregatedSamples.DroppedSamplesOfCores)
+    {
+        DroppedSamples += Core.second;
+    }
+
+    Processes.assign(g_ProfilerAggregatedSamples.Processes.begin(), g_ProfilerAggregatedSamples.Processes.end());
+
+    Functions = ProfilerFoldToFunctions(&g_ProfilerAggregatedSamples, g_DisassemblerSymbolMap);
+
+    ReleaseSRWLockShared(&g_ProfilerLock);
+
+    if (NumberOfSamples == 0)
+    {
+        ShowMessages("no samples are collected, use '!profile start' to start the profiler\n");
+        return;
+    }
+
+    ShowMessages("collected samples: %llx (taken: %llx, dropped: %llx)\n\n",
+                 NumberOfSamples,
+                 TotalSamples,
+                 DroppedSamples);
+
+    //
+    // Show the processes
+    //
+    std::sort(Processes.begin(), Processes.end(), [](const std::pair<UINT32, UINT64> & A, const std::pair<UINT32, UINT64> & B) {
+        return A.second > B.second;
+    });
+
+    ShowMessages("process id    samples             percent\n");
+
+    for (size_t i = 0; i < Processes.size() && i < Count; i++)
+    {
+        ShowMessages("%-12x  %-18llx  %6.2f%%\n",
+                     Processes[i].first,
+                     Processes[i].second,
+                     (double)Processes[i].second * 100 / NumberOfSamples);
+    }
+
+    //
+    // Show the functions
+    //
+    ShowMessages("\nself       inclusive  function\n");
+
+    for (size_t i = 0; i < Functions.size() && i < Count; i++)
+    {
+        ShowMessages("%6.2f%%   %6.2f%%    %s\n",
+                     (double)Functions[i].SelfSamples * 100 / NumberOfSamples,
+                     (double)Functions[i].InclusiveSamples * 100 / NumberOfSamples,
+                     Functions[i].Name.c_str());
+    }
+}
+
+/**
+ * @brief !profile command handler
+ *
+ * @param CommandTokens
+ * @param Command
+ *
+ * @return VOID
+ */
+VOID
+CommandProfile(vector<CommandToken> CommandTokens, string Command)
+{
+    DEBUGGER_PROFILER_REQUEST ProfilerRequest = {0};
+    UINT32                    Count           = PROFILER_DEFAULT_SHOW_COUNT;
+
+    if (CommandTokens.size() == 1)
+    {
+        ShowMessages("incorrect use of the '%s'\n\n",
+                     GetCaseSensitiveStringFromCommandToken(CommandTokens.at(0)).c_str());
+        CommandProfileHelp();
+        return;
+    }
+
+    //
+    // The samples are drained by polling the kernel, so it's only
+    // supported in the VMI mode
+    //
+    if (g_IsSerialConnectedToRemoteDebuggee)
+    {
+        ShowMessages("err, the profiler is not supported in the Debugger Mode, "
+                     "please use it in the VMI Mode\n");
+        return;
+    }
+
+    if (CompareLowerCaseStrings(CommandTokens.at(1), "start"))
+    {
+        ProfilerRequest.RequestType       = DEBUGGER_PROFILER_REQUEST_START;
+        ProfilerRequest.SamplingFrequency = DefaultProfilerSamplingFrequency;
+        ProfilerRequest.StackDepth        = MaximumProfilerStackDepth;
+        ProfilerRequest.ProcessId         = DEBUGGER_EVENT_APPLY_TO_ALL_PROCESSES;
+
+        if (CommandTokens.size() % 2 != 0)
+        {
+            ShowMessages("incorrect use of the '%s'\n\n",
+                         GetCaseSensitiveStringFromCommandToken(CommandTokens.at(0)).c_str());
+            CommandProfileHelp();
+            return;
+        }
+
+        for (size_t i = 2; i < CommandTokens.size(); i += 2)
+        {
+            UINT32 * Target = NULL;
+
+            if (CompareLowerCaseStrings(CommandTokens.at(i), "freq"))
+            {
+                Target = &ProfilerRequest.SamplingFrequency;
+            }
+            else if (CompareLowerCaseStrings(CommandTokens.at(i), "depth"))
+            {
+                Target = &ProfilerRequest.StackDepth;
+            }
+            else if (CompareLowerCaseStrings(CommandTokens.at(i), "pid"))
+            {
+                Target = &ProfilerRequest.ProcessId;
+            }
+            else
+            {
+                ShowMessages("err, couldn't resolve error at '%s'\n\n",
+                             GetCaseSensitiveStringFromCommandToken(CommandTokens.at(i)).c_str());
+                CommandProfileHelp();
+                return;
+            }
+
+            if (!ConvertTokenToUInt32(CommandTokens.at(i + 1), Target))
+            {
+                ShowMessages("err, couldn't resolve error at '%s'\n\n",
+                             GetCaseSensitiveStringFromCommandToken(CommandTokens.at(i + 1)).c_str());
+                CommandProfileHelp();
+                return;
+            }
+        }
+
+        if (ProfilerRequest.SamplingFrequency == 0 || ProfilerRequest.SamplingFrequency > MaximumProfilerSamplingFrequency ||
+            ProfilerRequest.StackDepth > MaximumProfilerStackDepth)
+        {
+            ShowMessages("err, the frequency should be between 1 and %x and the stack depth should not be more than %x\n",
+                         MaximumProfilerSamplingFrequency,
+                         MaximumProfilerStackDepth);
+            return;
+        }
+
+        if (g_ProfilerIsRunning)
+        {
+            ShowErrorMessage(DEBUGGER_ERROR_PROFILER_IS_ALREADY_RUNNING);
+            return;
+        }
+
+        if (!CommandProfileSendRequest(&ProfilerRequest, SIZEOF_DEBUGGER_PROFILER_REQUEST))
+        {
+            ShowErrorMessage(ProfilerRequest.KernelStatus);
+            return;
+        }
+
+        //
+        // The samples of the previous session are removed in the kernel,
+        // so the aggregated samples are also removed
+        //
+        AcquireSRWLockExclusive(&g_ProfilerLock);
+        ProfilerClearAggregatedSamples(&g_ProfilerAggregatedSamples);
+        ReleaseSRWLockExclusive(&g_ProfilerLock);
+
+        g_ProfilerIsRunning   = TRUE;
+        g_ProfilerDrainThread = CreateThread(NULL, 0, CommandProfileDrainThread, NULL, 0, NULL);
+
+        ShowMessages("the profiler is started, use '!profile stop' to stop it\n");
+    }
+    else if (CompareLowerCaseStrings(CommandTokens.at(1), "stop") && CommandTokens.size() == 2)
+    {
+        if (!g_ProfilerIsRunning)
+        {
+            ShowMessages("err, the profiler is not running\n");
+            return;
+        }
+
+        g_ProfilerIsRunning = FALSE;
+
+        if (g_ProfilerDrainThread != NULL)
+        {
+            WaitForSingleObject(g_ProfilerDrainThread, INFINITE);
+            CloseHandle(g_ProfilerDrainThread);
+            g_ProfilerDrainThread = NULL;
+        }
+
+        ProfilerRequest.RequestType = DEBUGGER_PROFILER_REQUEST_STOP;
+
+        if (!CommandProfileSendRequest(&ProfilerRequest, SIZEOF_DEBUGGER_PROFILER_REQUEST))
+        {
+            ShowErrorMessage(ProfilerRequest.KernelStatus);
+            return;
+        }
+
+        //
+        // Read the remaining samples
+        //
+        CommandProfileDrainSamples();
+
+        ShowMessages("the profiler is stopped, use '!profile show' to see the results\n");
+    }
+    else if (CompareLowerCaseStrings(CommandTokens.at(1), "show"))
+    {
+        if (CommandTokens.size() == 4 && CompareLowerCaseStrings(CommandTokens.at(2), "count"))
+        {
+            if (!ConvertTokenToUInt32(CommandTokens.at(3), &Count))
+            {
+                ShowMessages("err, couldn't resolve error at '%s'\n\n",
+                             GetCaseSensitiveStringFromCommandToken(CommandTokens.at(3)).c_str());
+                CommandProfileHelp();
+                return;
+            }
+        }
+        else if (CommandTokens.size() != 2)
+        {
+            ShowMessages("incorrect use of the '%s'\n\n",
+                         GetCaseSensitiveStringFromCommandToken(CommandTokens.at(0)).c_str());
+            CommandProfileHelp();
+            return;
+        }
+
+        CommandProfileShowResults(Count);
+    }
+    else if (CompareLowerCaseStrings(CommandTokens.at(1), "clear") && CommandTokens.size() == 2)
+    {
+        AcquireSRWLockExclusive(&g_ProfilerLock);
+        ProfilerClearAggregatedSamples(&g_ProfilerAggregatedSamples);
+        ReleaseSRWLockExclusive(&g_ProfilerLock);
+
+        ShowMessages("the collected samples are removed\n");
+    }
+    else
+    {
+        ShowMessages("incorrect use of the '%s'\n\n",
+                     GetCaseSensitiveStringFromCommandToken(CommandTokens.at(0)).c_str());
+        CommandProfileHelp();
+    }
+}
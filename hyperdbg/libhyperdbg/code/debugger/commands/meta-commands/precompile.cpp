@@ -0,0 +1,96 @@
+/**
+ * @file precompile.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief .precompile command
+ * @details
+ * @version 0.11
+ * @date 2024-10-18
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+using namespace std;
+
+/**
+ * @brief help of the .precompile command
+ *
+ * @return VOID
+ */
+VOID
+CommandPrecompileHelp()
+{
+    ShowMessages(".precompile : compiles a script file and saves it in a relocatable format.\n\n");
+
+    ShowMessages("syntax : \t.precompile [ScriptFilePath (string)] [OutputFilePath (string)]\n");
+
+    ShowMessages("\n");
+    ShowMessages("\t\te.g : .precompile c:\\scripts\\monitor.ds c:\\scripts\\monitor.hds\n");
+    ShowMessages("\t\te.g : .precompile \"c:\\my scripts\\monitor.ds\" \"c:\\my scripts\\monitor.hds\"\n");
+
+    ShowMessages("\n");
+    ShowMessages("the compiled script could be used in events as 'script { compiled:c:\\scripts\\monitor.hds }', "
+                 "module!symbol addresses are relocated based on the currently loaded symbols\n");
+}
+
+/**
+ * @brief .precompile command handler
+ *
+ * @param CommandTokens
+ * @param Command
+ * @return VOID
+ */
+VOID
+CommandPrecompile(vector<CommandToken> CommandTokens, string Command)
+{
+    string            InputFilePath;
+    string            OutputFilePath;
+    std::vector<CHAR> CompiledScript;
+
+    if (CommandTokens.size() != 3)
+    {
+        ShowMessages("err, incorrect use of the '%s' command\n\n",
+                     GetCaseSensitiveStringFromCommandToken(CommandTokens.at(0)).c_str());
+        CommandPrecompileHelp();
+        return;
+    }
+
+    InputFilePath  = GetCaseSensitiveStringFromCommandToken(CommandTokens.at(1));
+    OutputFilePath = GetCaseSensitiveStringFromCommandToken(CommandTokens.at(2));
+
+    //
+    // Read the script file
+    //
+    std::ifstream     InputFile(InputFilePath.c_str());
+    std::stringstream Buffer;
+    Buffer << InputFile.rdbuf();
+    string ScriptText = Buffer.str();
+
+    if (ScriptText.empty())
+    {
+        ShowMessages("err, either script file is not found or it's empty\n");
+        return;
+    }
+
+    //
+    // Compile the script, syntax errors are shown by the script engine
+    //
+    if (!ScriptEngineCompileToBufferWrapper((char *)ScriptText.c_str(), CompiledScript))
+    {
+        return;
+    }
+
+    //
+    // Save the compiled script
+    //
+    std::ofstream OutputFile(OutputFilePath.c_str(), std::ios::binary | std::ios::trunc);
+
+    if (!OutputFile.is_open() || !OutputFile.write(CompiledScript.data(), CompiledScript.size()))
+    {
+        ShowMessages("err, unable to write the compiled script to '%s'\n", OutputFilePath.c_str());
+        return;
+    }
+
+    ShowMessages("compiled script is saved at '%s' (%lld bytes)\n", OutputFilePath.c_str(), (UINT64)CompiledScript.size());
+}
@@ -21,6 +21,8 @@ extern BOOLEAN g_IsConnectedToRemoteDebuggee;
 extern BOOLEAN g_IsConnectedToRemoteDebugger;
 extern BOOLEAN g_BreakPrintingOutput;
 extern BOOLEAN g_IsEndOfMessageReceived;
+extern BOOLEAN g_IsRemoteFramedProtocol;
+extern BOOLEAN g_RemoteCommandsReceiverClosed;
 
 extern SOCKET g_SeverSocket;
 extern SOCKET g_ServerListenSocket;
@@ -39,7 +41,11 @@ extern HANDLE g_EndOfMessageReceivedEvent;
 VOID
 RemoteConnectionListen(PCSTR Port)
 {
-    char recvbuf[COMMUNICATION_BUFFER_SIZE] = {0};
+    char              recvbuf[COMMUNICATION_BUFFER_SIZE] = {0};
+    BOOLEAN           IsFramed                           = FALSE;
+    UINT32            RequestId                          = 0;
+    HANDLE            ReceiverThread                     = NULL;
+    std::vector<CHAR> FramePayload;
 
     //
     // Check if the debugger or debuggee is already active
@@ -102,10 +108,18 @@ RemoteConnectionListen(PCSTR Port)
     }
     else
     {
+        //
+        // Check whether the debugger supports the framed protocol or not (the
+        // capability comes after the build signature)
+        //
+        IsFramed = strcmp(recvbuf + strlen(recvbuf) + 1, REMOTE_FRAME_CAPABILITY) == 0;
+
         //
         // Send successful handshake (version match) message
         //
-        if (CommunicationServerSendMessage(g_SeverSocket, "OK", 3) != 0)
+        if (CommunicationServerSendMessage(g_SeverSocket,
+                                           IsFramed ? REMOTE_FRAME_HANDSHAKE_ACCEPTED : "OK",
+                                           3) != 0)
         {
             //
             // Failed
@@ -121,6 +135,12 @@ RemoteConnectionListen(PCSTR Port)
         }
     }
 
+    //
+    // Initialize the frames before any output is sent to the debugger
+    //
+    RemoteFrameInitialize();
+    g_IsRemoteFramedProtocol = IsFramed;
+
     //
     // Indicate that it's a remote debugger
     //
@@ -136,14 +156,56 @@ RemoteConnectionListen(PCSTR Port)
     //
     RtlZeroMemory(recvbuf, COMMUNICATION_BUFFER_SIZE);
 
+    //
+    // The frames are received by another thread, so the breaks (CTRL+C) of
+    // the debugger are handled while a command is executed
+    //
+    if (g_IsRemoteFramedProtocol)
+    {
+        ReceiverThread = CreateThread(NULL, 0, RemoteFrameReceiveCommandsThread, (LPVOID)g_SeverSocket, 0, NULL);
+
+        if (ReceiverThread == NULL)
+        {
+            ShowMessages("err, unable to create the receiver thread (%x)\n", GetLastError());
+
+            //
+            // No command is received, so the connection is closed
+            //
+            g_RemoteCommandsReceiverClosed = TRUE;
+        }
+    }
+
     while (true)
     {
+        CHAR * Command = recvbuf;
+
         //
         // Receive message (this loop works as a command executer,
         // we don't send the results to the remote machine by using
         // this tools
         //
-        if (CommunicationServerReceiveMessage(g_SeverSocket, recvbuf, COMMUNICATION_BUFFER_SIZE) != 0)
+        if (g_IsRemoteFramedProtocol)
+        {
+            //
+            // The commands are executed one at a time, in the order
+            // that they're received
+            //
+            if (!RemoteFrameWaitForCommand(&RequestId, FramePayload))
+            {
+                //
+                // Connection is closed, break
+                //
+                break;
+            }
+
+            Command = FramePayload.data();
+
+            //
+            // Outputs of this thread belong to the command
+            //
+            RemoteFrameSetCurrentRequestId(RequestId);
+        }
+        else if (CommunicationServerReceiveMessage(g_SeverSocket, recvbuf, COMMUNICATION_BUFFER_SIZE) != 0)
         {
             //
             // Failed, break
@@ -152,14 +214,29 @@ RemoteConnectionListen(PCSTR Port)
         }
 
         //
-        // Execute the command
+        // Execute the command, the results are coalesced and sent before
+        // the end of buffer
         //
-        int CommandExecutionResult = HyperDbgInterpreter(recvbuf);
+        int CommandExecutionResult;
+
+        {
+            ShowMessagesCoalescingScope CoalescingScope;
+
+            CommandExecutionResult = HyperDbgInterpreter(Command);
+        }
 
         //
         // Send end of buffer
         //
-        RemoteConnectionSendResultsToHost((const char *)g_EndOfBufferCheckTcp, sizeof(g_EndOfBufferCheckTcp));
+        if (g_IsRemoteFramedProtocol)
+        {
+            RemoteFrameSetCurrentRequestId(0);
+            RemoteFrameSend(g_SeverSocket, TRUE, REMOTE_FRAME_TYPE_COMMAND_FINISHED, RequestId, NULL, 0);
+        }
+        else
+        {
+            RemoteConnectionSendResultsToHost((const char *)g_EndOfBufferCheckTcp, sizeof(g_EndOfBufferCheckTcp));
+        }
 
         //
         // if the debugger encounters an exit state then the return will be 1
@@ -187,6 +264,7 @@ RemoteConnectionListen(PCSTR Port)
     // Indicate that it's note a remote debugger
     //
     g_IsConnectedToRemoteDebugger = FALSE;
+    g_IsRemoteFramedProtocol      = FALSE;
 
     //
     // Indicate that we're not in remote debugger anymore
@@ -198,6 +276,15 @@ RemoteConnectionListen(PCSTR Port)
     //
     CommunicationServerShutdownAndCleanupConnection(g_SeverSocket,
                                                     g_ServerListenSocket);
+
+    //
+    // The receiver thread stops after the socket is closed
+    //
+    if (ReceiverThread != NULL)
+    {
+        WaitForSingleObject(ReceiverThread, INFINITE);
+        CloseHandle(ReceiverThread);
+    }
 }
 
 /**
@@ -210,10 +297,45 @@ RemoteConnectionListen(PCSTR Port)
 DWORD WINAPI
 RemoteConnectionThreadListeningToDebuggee(LPVOID lpParam)
 {
-    char   RecvBuf[COMMUNICATION_BUFFER_SIZE + TCP_END_OF_BUFFER_CHARS_COUNT] = {0};
-    UINT32 BuffLenReceived                                                    = 0;
+    char                RecvBuf[COMMUNICATION_BUFFER_SIZE + TCP_END_OF_BUFFER_CHARS_COUNT] = {0};
+    UINT32              BuffLenReceived                                                    = 0;
+    REMOTE_FRAME_HEADER FrameHeader                                                        = {0};
+    std::vector<CHAR>   FramePayload;
+
+    while (g_IsConnectedToRemoteDebuggee && g_IsRemoteFramedProtocol)
+    {
+        //
+        // Receive frame
+        //
+        if (!RemoteFrameReceive(g_ClientConnectSocket, &FrameHeader, FramePayload))
+        {
+            //
+            // Failed, break
+            //
+            break;
+        }
+
+        if (FrameHeader.Type == REMOTE_FRAME_TYPE_OUTPUT)
+        {
+            //
+            // Show message from remote debuggee (both the outputs of the
+            // commands and the events)
+            //
+            if (!g_BreakPrintingOutput)
+            {
+                ShowMessages("%s", FramePayload.data());
+            }
+        }
+        else if (FrameHeader.Type == REMOTE_FRAME_TYPE_COMMAND_FINISHED)
+        {
+            //
+            // Wake up the waiter of the command
+            //
+            RemoteFrameCompleteCommand(FrameHeader.RequestId);
+        }
+    }
 
-    while (g_IsConnectedToRemoteDebuggee)
+    while (g_IsConnectedToRemoteDebuggee && !g_IsRemoteFramedProtocol)
     {
         //
         // Receive message
@@ -295,6 +417,15 @@ RemoteConnectionThreadListeningToDebuggee(LPVOID lpParam)
     //
     g_IsConnectedToRemoteDebuggee = FALSE;
 
+    //
+    // Wake up the waiters of the commands that won't be finished
+    //
+    if (g_IsRemoteFramedProtocol)
+    {
+        g_IsRemoteFramedProtocol = FALSE;
+        RemoteFrameCompleteCommand(0);
+    }
+
     //
     // Show the signature
     //
@@ -315,8 +446,9 @@ VOID
 RemoteConnectionConnect(PCSTR Ip, PCSTR Port)
 {
     DWORD  ThreadId;
-    CHAR   Recv[3]  = {0};
-    UINT32 BuffRecv = 0;
+    CHAR   Recv[3]                                                             = {0};
+    UINT32 BuffRecv                                                            = 0;
+    CHAR   Handshake[sizeof(BuildSignature) + sizeof(REMOTE_FRAME_CAPABILITY)] = {0};
 
     //
     // Check if the debugger or debuggee is already active
@@ -362,9 +494,13 @@ RemoteConnectionConnect(PCSTR Ip, PCSTR Port)
         //
 
         //
-        // Check to see whether the version of debugger and debuggee matches together or not
+        // Check to see whether the version of debugger and debuggee matches together or not,
+        // the framed protocol is requested after the signature (ignored by old debuggees)
         //
-        if (CommunicationClientSendMessage(g_ClientConnectSocket, (const char *)BuildSignature, sizeof(BuildSignature)) != 0)
+        memcpy(Handshake, BuildSignature, sizeof(BuildSignature));
+        memcpy(Handshake + sizeof(BuildSignature), REMOTE_FRAME_CAPABILITY, sizeof(REMOTE_FRAME_CAPABILITY));
+
+        if (CommunicationClientSendMessage(g_ClientConnectSocket, Handshake, sizeof(Handshake)) != 0)
         {
             //
             // Failed
@@ -388,7 +524,18 @@ RemoteConnectionConnect(PCSTR Ip, PCSTR Port)
         //
         // Check if the handshake was successful or not
         //
-        if (strcmp((const char *)"OK", Recv) != 0)
+        if (strcmp(REMOTE_FRAME_HANDSHAKE_ACCEPTED, Recv) == 0)
+        {
+            g_IsRemoteFramedProtocol = TRUE;
+        }
+        else if (strcmp((const char *)"OK", Recv) == 0)
+        {
+            //
+            // Legacy (text) protocol
+            //
+            g_IsRemoteFramedProtocol = FALSE;
+        }
+        else
         {
             //
             // Build version not matched
@@ -397,6 +544,11 @@ RemoteConnectionConnect(PCSTR Ip, PCSTR Port)
             return;
         }
 
+        //
+        // Initialize the frames before the listening thread starts
+        //
+        RemoteFrameInitialize();
+
         //
         // Indicate that local debugger is not connected
         //
@@ -444,6 +596,11 @@ RemoteConnectionConnect(PCSTR Ip, PCSTR Port)
 int
 RemoteConnectionSendCommand(const char * sendbuf, int len)
 {
+    if (g_IsRemoteFramedProtocol)
+    {
+        return RemoteFrameSendCommandAndWait(g_ClientConnectSocket, sendbuf, len);
+    }
+
     //
     // Send Message
     //
@@ -468,6 +625,29 @@ RemoteConnectionSendCommand(const char * sendbuf, int len)
     return 0;
 }
 
+/**
+ * @brief send a break (CTRL+C) as a client (debugger, host) to the
+ * server (debuggee, guest)
+ * @details in the framed protocol, the break doesn't wait for the
+ * command that is executed by the debuggee
+ *
+ * @return int returning 0 means that there was no error in
+ * executing the function and 1 shows there was an error
+ */
+int
+RemoteConnectionSendBreak()
+{
+    if (g_IsRemoteFramedProtocol)
+    {
+        return RemoteFrameSendBreak(g_ClientConnectSocket) ? 0 : 1;
+    }
+
+    //
+    // Old debuggees only receive the commands
+    //
+    return RemoteConnectionSendCommand("pause", (UINT32)strlen("pause") + 1);
+}
+
 /**
  * @brief Send the results of executing a command from deubggee (server, guest)
  * to the debugger (client, host)
@@ -480,6 +660,15 @@ RemoteConnectionSendCommand(const char * sendbuf, int len)
 int
 RemoteConnectionSendResultsToHost(const char * sendbuf, int len)
 {
+    if (g_IsRemoteFramedProtocol)
+    {
+        //
+        // Outputs of the threads that are not executing a command have
+        // a zero request id
+        //
+        return RemoteFrameSend(g_SeverSocket, TRUE, REMOTE_FRAME_TYPE_OUTPUT, RemoteFrameGetCurrentRequestId(), sendbuf, len) ? 0 : 1;
+    }
+
     //
     // Send the message
     //
@@ -0,0 +1,549 @@
+/**
+ * @file remote-frames.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Framed protocol of the remote (TCP) connections
+ * @details Each frame has a length-prefixed header with a request id,
+ * commands are answered by output frames and a command finished frame
+ * with the same request id, and the outputs that don't belong to any
+ * command (events, logs) use a zero request id. The debuggee executes
+ * the commands one at a time (in order), only the break frames (CTRL+C)
+ * are handled while a command is executed
+ * @version 0.11
+ * @date 2024-10-22
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+//
+// Global Variables
+//
+extern CRITICAL_SECTION                g_RemoteFrameLock;
+extern CRITICAL_SECTION                g_RemoteFrameSendLock;
+extern BOOLEAN                         g_RemoteFrameLockInitialized;
+extern CONDITION_VARIABLE              g_RemoteFrameCommandAvailable;
+extern UINT32                          g_RemoteLastRequestId;
+extern std::map<UINT32, HANDLE>        g_RemotePendingRequests;
+extern std::list<REMOTE_FRAME_COMMAND> g_RemoteReceivedCommands;
+extern BOOLEAN                         g_RemoteCommandsReceiverClosed;
+
+//
+// Request id of the command that is executed by the current thread
+//
+static thread_local UINT32 g_RemoteCurrentRequestId = 0;
+
+/**
+ * @brief Initialize the remote frames
+ * @details should be called before creating any thread that uses
+ * the connection
+ *
+ * @return VOID
+ */
+VOID
+RemoteFrameInitialize()
+{
+    if (!g_RemoteFrameLockInitialized)
+    {
+        InitializeCriticalSection(&g_RemoteFrameLock);
+        InitializeCriticalSection(&g_RemoteFrameSendLock);
+        g_RemoteFrameLockInitialized = TRUE;
+    }
+
+    EnterCriticalSection(&g_RemoteFrameLock);
+
+    g_RemoteLastRequestId          = 0;
+    g_RemoteCommandsReceiverClosed = FALSE;
+    g_RemoteReceivedCommands.clear();
+
+    LeaveCriticalSection(&g_RemoteFrameLock);
+}
+
+/**
+ * @brief Set the request id of the command that is executed by the
+ * current thread
+ *
+ * @param RequestId
+ * @return VOID
+ */
+VOID
+RemoteFrameSetCurrentRequestId(UINT32 RequestId)
+{
+    g_RemoteCurrentRequestId = RequestId;
+}
+
+/**
+ * @brief Get the request id of the command that is executed by the
+ * current thread
+ *
+ * @return UINT32 zero if the thread is not executing a remote command
+ */
+UINT32
+RemoteFrameGetCurrentRequestId()
+{
+    return g_RemoteCurrentRequestId;
+}
+
+/**
+ * @brief Compress the payload of a frame
+ *
+ * @param Payload
+ * @param Size
+ * @param CompressedPayload
+ * @param CompressedSize
+ *
+ * @return BOOLEAN TRUE if the compressed payload is smaller than the payload
+ */
+static BOOLEAN
+RemoteFrameCompress(const CHAR * Payload, UINT32 Size, CHAR * CompressedPayload, PUINT32 CompressedSize)
+{
+    //
+    // Each thread has its own work space, so the frames are compressed
+    // without holding any lock
+    //
+    static thread_local std::vector<UCHAR> WorkSpace;
+    ULONG                                  CompressBufferWorkSpaceSize;
+    ULONG                                  CompressFragmentWorkSpaceSize;
+    ULONG                                  FinalCompressedSize = 0;
+
+    if (WorkSpace.empty())
+    {
+        if (RtlGetCompressionWorkSpaceSize(REMOTE_FRAME_COMPRESSION_FORMAT | COMPRESSION_ENGINE_STANDARD,
+                                           &CompressBufferWorkSpaceSize,
+                                           &CompressFragmentWorkSpaceSize) != STATUS_SUCCESS)
+        {
+            return FALSE;
+        }
+
+        WorkSpace.resize(CompressBufferWorkSpaceSize);
+    }
+
+    if (RtlCompressBuffer(REMOTE_FRAME_COMPRESSION_FORMAT | COMPRESSION_ENGINE_STANDARD,
+                          (PUCHAR)Payload,
+                          Size,
+                          (PUCHAR)CompressedPayload,
+                          Size,
+                          NORMAL_PAGE_SIZE,
+                          &FinalCompressedSize,
+                          WorkSpace.data()) != STATUS_SUCCESS)
+    {
+        //
+        // Not compressible (or the result is not smaller)
+        //
+        return FALSE;
+    }
+
+    if (FinalCompressedSize >= Size)
+    {
+        return FALSE;
+    }
+
+    *CompressedSize = FinalCompressedSize;
+
+    return TRUE;
+}
+
+/**
+ * @brief Send an exact number of bytes
+ * @details it doesn't show any message, because the messages of the
+ * debuggee are sent over the same connection
+ *
+ * @param Socket
+ * @param Buffer
+ * @param Length
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+RemoteFrameSendExact(SOCKET Socket, const CHAR * Buffer, UINT32 Length)
+{
+    while (Length != 0)
+    {
+        int Sent = send(Socket, Buffer, Length, 0);
+
+        if (Sent == SOCKET_ERROR || Sent == 0)
+        {
+            return FALSE;
+        }
+
+        Buffer += Sent;
+        Length -= Sent;
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Send a frame to the remote debugger or debuggee
+ * @details large outputs are compressed, frames are sent atomically so
+ * the outputs of different threads can share the connection; the send
+ * lock is only held while the frame is written to the socket (nothing
+ * is shown while holding it, the messages are sent by this function)
+ *
+ * @param Socket
+ * @param IsServer whether the frame is sent by the debuggee (server)
+ * @param Type
+ * @param RequestId
+ * @param Payload
+ * @param Size
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+RemoteFrameSend(SOCKET Socket, BOOLEAN IsServer, REMOTE_FRAME_TYPE Type, UINT32 RequestId, const CHAR * Payload, UINT32 Size)
+{
+    std::vector<CHAR>    Frame;
+    PREMOTE_FRAME_HEADER Header;
+    UINT32               CompressedSize = 0;
+    BOOLEAN              IsSent;
+    int                  LastError = 0;
+
+    if (Size > REMOTE_FRAME_MAX_PAYLOAD_SIZE)
+    {
+        return FALSE;
+    }
+
+    Frame.resize(sizeof(REMOTE_FRAME_HEADER) + Size);
+
+    Header               = (PREMOTE_FRAME_HEADER)Frame.data();
+    Header->Magic        = REMOTE_FRAME_MAGIC;
+    Header->RequestId    = RequestId;
+    Header->Type         = (UINT16)Type;
+    Header->Flags        = 0;
+    Header->PayloadSize  = Size;
+    Header->OriginalSize = Size;
+
+    if (Type == REMOTE_FRAME_TYPE_OUTPUT &&
+        Size >= REMOTE_FRAME_COMPRESSION_THRESHOLD &&
+        RemoteFrameCompress(Payload, Size, Frame.data() + sizeof(REMOTE_FRAME_HEADER), &CompressedSize))
+    {
+        Header->Flags |= REMOTE_FRAME_FLAG_COMPRESSED;
+        Header->PayloadSize = CompressedSize;
+    }
+    else if (Size != 0)
+    {
+        memcpy(Frame.data() + sizeof(REMOTE_FRAME_HEADER), Payload, Size);
+    }
+
+    //
+    // The header and the payload are sent together
+    //
+    EnterCriticalSection(&g_RemoteFrameSendLock);
+
+    IsSent = RemoteFrameSendExact(Socket, Frame.data(), (UINT32)(sizeof(REMOTE_FRAME_HEADER) + Header->PayloadSize));
+
+    if (!IsSent)
+    {
+        LastError = WSAGetLastError();
+    }
+
+    LeaveCriticalSection(&g_RemoteFrameSendLock);
+
+    //
+    // The errors of the debuggee are not shown, they would be sent over
+    // the same (broken) connection
+    //
+    if (!IsSent && !IsServer)
+    {
+        ShowMessages("err, send failed (%x)\n", LastError);
+    }
+
+    return IsSent;
+}
+
+/**
+ * @brief Receive an exact number of bytes
+ *
+ * @param Socket
+ * @param Buffer
+ * @param Length
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+RemoteFrameReceiveExact(SOCKET Socket, CHAR * Buffer, UINT32 Length)
+{
+    while (Length != 0)
+    {
+        int Received = recv(Socket, Buffer, Length, 0);
+
+        if (Received <= 0)
+        {
+            return FALSE;
+        }
+
+        Buffer += Received;
+        Length -= Received;
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Receive a frame from the remote debugger or debuggee
+ * @details the payload is decompressed (if needed) and null-terminated
+ *
+ * @param Socket
+ * @param Header
+ * @param Payload
+ *
+ * @return BOOLEAN FALSE if the connection is closed or the frame is invalid
+ */
+BOOLEAN
+RemoteFrameReceive(SOCKET Socket, PREMOTE_FRAME_HEADER Header, std::vector<CHAR> & Payload)
+{
+    std::vector<CHAR> CompressedPayload;
+    ULONG             FinalUncompressedSize = 0;
+
+    if (!RemoteFrameReceiveExact(Socket, (CHAR *)Header, sizeof(REMOTE_FRAME_HEADER)))
+    {
+        return FALSE;
+    }
+
+    if (Header->Magic != REMOTE_FRAME_MAGIC ||
+        Header->PayloadSize > REMOTE_FRAME_MAX_PAYLOAD_SIZE ||
+        Header->OriginalSize > REMOTE_FRAME_MAX_PAYLOAD_SIZE)
+    {
+        ShowMessages("err, invalid frame is received from the remote connection\n");
+        return FALSE;
+    }
+
+    Payload.resize(Header->OriginalSize + 1);
+
+    if (!(Header->Flags & REMOTE_FRAME_FLAG_COMPRESSED))
+    {
+        if (Header->PayloadSize != Header->OriginalSize ||
+            !RemoteFrameReceiveExact(Socket, Payload.data(), Header->PayloadSize))
+        {
+            return FALSE;
+        }
+    }
+    else
+    {
+        CompressedPayload.resize(Header->PayloadSize);
+
+        if (!RemoteFrameReceiveExact(Socket, CompressedPayload.data(), Header->PayloadSize))
+        {
+            return FALSE;
+        }
+
+        if (RtlDecompressBuffer(REMOTE_FRAME_COMPRESSION_FORMAT,
+                                (PUCHAR)Payload.data(),
+                                Header->OriginalSize,
+                                (PUCHAR)CompressedPayload.data(),
+                                Header->PayloadSize,
+                                &FinalUncompressedSize) != STATUS_SUCCESS ||
+            FinalUncompressedSize != Header->OriginalSize)
+        {
+            ShowMessages("err, unable to decompress the frame received from the remote connection\n");
+            return FALSE;
+        }
+    }
+
+    Payload[Header->OriginalSize] = '\0';
+
+    return TRUE;
+}
+
+/**
+ * @brief Send a command to the remote debuggee and wait for it to be
+ * finished
+ * @details several commands might be waited at the same time (e.g., pause
+ * while another command is running)
+ *
+ * @param Socket
+ * @param Command
+ * @param Length
+ *
+ * @return int returning 0 means that there was no error in
+ * executing the function and 1 shows there was an error
+ */
+int
+RemoteFrameSendCommandAndWait(SOCKET Socket, const char * Command, int Length)
+{
+    UINT32 RequestId;
+    HANDLE FinishedEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+
+    if (FinishedEvent == NULL)
+    {
+        return 1;
+    }
+
+    //
+    // Register the request before sending it
+    //
+    EnterCriticalSection(&g_RemoteFrameLock);
+
+    RequestId = ++g_RemoteLastRequestId;
+
+    if (RequestId == 0)
+    {
+        //
+        // Zero is reserved for the outputs without a command
+        //
+        RequestId = ++g_RemoteLastRequestId;
+    }
+
+    g_RemotePendingRequests[RequestId] = FinishedEvent;
+
+    LeaveCriticalSection(&g_RemoteFrameLock);
+
+    BOOLEAN IsSent = RemoteFrameSend(Socket, FALSE, REMOTE_FRAME_TYPE_COMMAND, RequestId, Command, Length);
+
+    if (IsSent)
+    {
+        //
+        // We wait for the debuggee to finish the command
+        //
+        WaitForSingleObject(FinishedEvent, INFINITE);
+    }
+
+    EnterCriticalSection(&g_RemoteFrameLock);
+    g_RemotePendingRequests.erase(RequestId);
+    LeaveCriticalSection(&g_RemoteFrameLock);
+
+    CloseHandle(FinishedEvent);
+
+    return IsSent ? 0 : 1;
+}
+
+/**
+ * @brief Send a break (CTRL+C) to the remote debuggee
+ * @details the break is not answered, so it doesn't wait for the
+ * command that is executed by the debuggee
+ *
+ * @param Socket
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+RemoteFrameSendBreak(SOCKET Socket)
+{
+    return RemoteFrameSend(Socket, FALSE, REMOTE_FRAME_TYPE_BREAK, 0, NULL, 0);
+}
+
+/**
+ * @brief Wake up the waiter of a finished command, or all of the
+ * waiters if the connection is closed
+ *
+ * @param RequestId zero for completing all of the commands
+ *
+ * @return VOID
+ */
+VOID
+RemoteFrameCompleteCommand(UINT32 RequestId)
+{
+    EnterCriticalSection(&g_RemoteFrameLock);
+
+    if (RequestId == 0)
+    {
+        for (auto & Request : g_RemotePendingRequests)
+        {
+            SetEvent(Request.second);
+        }
+    }
+    else
+    {
+        auto Request = g_RemotePendingRequests.find(RequestId);
+
+        if (Request != g_RemotePendingRequests.end())
+        {
+            SetEvent(Request->second);
+        }
+    }
+
+    LeaveCriticalSection(&g_RemoteFrameLock);
+}
+
+/**
+ * @brief A thread of the debuggee that receives the frames of the remote
+ * debugger
+ * @details the commands are queued for RemoteFrameWaitForCommand, and the
+ * breaks are handled immediately (while a command might be executed)
+ *
+ * @param Param The socket of the connection
+ *
+ * @return DWORD
+ */
+DWORD WINAPI
+RemoteFrameReceiveCommandsThread(LPVOID Param)
+{
+    SOCKET               Socket = (SOCKET)Param;
+    REMOTE_FRAME_HEADER  FrameHeader;
+    REMOTE_FRAME_COMMAND ReceivedCommand;
+
+    while (RemoteFrameReceive(Socket, &FrameHeader, ReceivedCommand.Command))
+    {
+        if (FrameHeader.Type == REMOTE_FRAME_TYPE_BREAK)
+        {
+            //
+            // Same as pressing CTRL+C on the debuggee
+            //
+            CommandPauseRequest();
+        }
+        else if (FrameHeader.Type == REMOTE_FRAME_TYPE_COMMAND)
+        {
+            ReceivedCommand.RequestId = FrameHeader.RequestId;
+
+            EnterCriticalSection(&g_RemoteFrameLock);
+
+            g_RemoteReceivedCommands.push_back(std::move(ReceivedCommand));
+
+            LeaveCriticalSection(&g_RemoteFrameLock);
+
+            WakeConditionVariable(&g_RemoteFrameCommandAvailable);
+
+            ReceivedCommand.Command.clear();
+        }
+    }
+
+    //
+    // The connection is closed, wake up the executer of the commands
+    //
+    EnterCriticalSection(&g_RemoteFrameLock);
+    g_RemoteCommandsReceiverClosed = TRUE;
+    LeaveCriticalSection(&g_RemoteFrameLock);
+
+    WakeAllConditionVariable(&g_RemoteFrameCommandAvailable);
+
+    return 0;
+}
+
+/**
+ * @brief Wait for the next command that is received by the debuggee
+ *
+ * @param RequestId
+ * @param Command The null-terminated command
+ *
+ * @return BOOLEAN FALSE if the connection is closed
+ */
+BOOLEAN
+RemoteFrameWaitForCommand(PUINT32 RequestId, std::vector<CHAR> & Command)
+{
+    BOOLEAN Result = FALSE;
+
+    EnterCriticalSection(&g_RemoteFrameLock);
+
+    while (g_RemoteReceivedCommands.empty() && !g_RemoteCommandsReceiverClosed)
+    {
+        SleepConditionVariableCS(&g_RemoteFrameCommandAvailable, &g_RemoteFrameLock, INFINITE);
+    }
+
+    //
+    // The commands that are received before closing the connection
+    // are not executed
+    //
+    if (!g_RemoteCommandsReceiverClosed)
+    {
+        *RequestId = g_RemoteReceivedCommands.front().RequestId;
+        Command    = std::move(g_RemoteReceivedCommands.front().Command);
+
+        g_RemoteReceivedCommands.pop_front();
+
+        Result = TRUE;
+    }
+
+    LeaveCriticalSection(&g_RemoteFrameLock);
+
+    return Result;
+}
@@ -21,6 +21,7 @@ extern BOOLEAN                  g_IsConnectedToRemoteDebuggee;
 extern BOOLEAN                  g_IsSerialConnectedToRemoteDebuggee;
 extern BOOLEAN                  g_IsExecutingSymbolLoadingRoutines;
 extern BOOLEAN                  g_IsInstrumentingInstructions;
+extern BOOLEAN                  g_IsRunningResumableOperation;
 extern BOOLEAN                  g_IgnorePauseRequests;
 extern ACTIVE_DEBUGGING_PROCESS g_ActiveProcessDebuggingState;
 
@@ -74,6 +75,10 @@ BreakController(DWORD CtrlType)
             {
                 g_IsInstrumentingInstructions = FALSE;
             }
+            else if (g_IsRunningResumableOperation)
+            {
+                g_IsRunningResumableOperation = FALSE;
+            }
             else
             {
                 KdBreakControlCheckAndPauseDebugger(TRUE);
@@ -99,11 +104,11 @@ BreakController(DWORD CtrlType)
                 g_BreakPrintingOutput = TRUE;
 
                 //
-                // Check if its a remote debuggee then we should send the 'pause' command
+                // Check if its a remote debuggee then we should send a break (pause) to it
                 //
                 if (g_IsConnectedToRemoteDebuggee)
                 {
-                    RemoteConnectionSendCommand("pause", (UINT32)strlen("pause") + 1);
+                    RemoteConnectionSendBreak();
                 }
 
                 Sleep(300);
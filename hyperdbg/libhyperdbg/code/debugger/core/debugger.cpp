@@ -544,6 +544,61 @@ ShowErrorMessage(UINT32 Error)
                      Error);
         break;
 
+    case DEBUGGER_ERROR_INVALID_BATCH_OPERATION:
+        ShowMessages("err, the batch operation is invalid (%x)\n",
+                     Error);
+        break;
+
+    case DEBUGGER_ERROR_INVALID_SEARCH_PATTERNS:
+        ShowMessages("err, the search patterns or ranges are invalid (%x)\n",
+                     Error);
+        break;
+
+    case DEBUGGER_ERROR_INVALID_CONTINUATION_TOKEN:
+        ShowMessages("err, the operation is not resumable anymore, the token is invalid (%x)\n",
+                     Error);
+        break;
+
+    case DEBUGGER_ERROR_MAXIMUM_MONITOR_RANGES_IS_HIT:
+        ShowMessages("err, the maximum number of the monitored physical ranges is reached, "
+                     "please remove some of the '!monitor' events (%x)\n",
+                     Error);
+        break;
+
+    case DEBUGGER_ERROR_INVALID_EVENT_THROTTLING_OPTIONS:
+        ShowMessages("err, the sampling or rate limiting options are invalid, note that 'disarm' "
+                     "needs a 'rate' and is only supported for MSR and I/O events (%x)\n",
+                     Error);
+        break;
+
+    case DEBUGGER_ERROR_PROFILER_IS_NOT_SUPPORTED:
+        ShowMessages("err, the profiler is not supported as the processor doesn't support "
+                     "the VMX-preemption timer or the TSC frequency is unknown (%x)\n",
+                     Error);
+        break;
+
+    case DEBUGGER_ERROR_PROFILER_IS_ALREADY_RUNNING:
+        ShowMessages("err, the profiler is already running, stop it first (%x)\n",
+                     Error);
+        break;
+
+    case DEBUGGER_ERROR_INVALID_PROFILER_OPTIONS:
+        ShowMessages("err, the profiler options are invalid or the profiler buffers are "
+                     "not allocated (%x)\n",
+                     Error);
+        break;
+
+    case DEBUGGER_ERROR_BRANCH_TRACE_NOT_SUPPORTED:
+        ShowMessages("err, tracing the branches is not supported as the processor doesn't "
+                     "support the last branch records (LBR) (%x)\n",
+                     Error);
+        break;
+
+    case DEBUGGER_ERROR_INVALID_BRANCH_TRACE_REQUEST:
+        ShowMessages("err, the branch trace request is invalid (%x)\n",
+                     Error);
+        break;
+
     default:
         ShowMessages("err, error not found (%x)\n",
                      Error);
@@ -769,7 +824,9 @@ InterpretScript(vector<CommandToken> * CommandTokens,
                 PUINT64                ScriptCodeBuffer)
 {
     BOOLEAN IsTextVisited       = FALSE;
+    BOOLEAN IsCompiledScript    = FALSE;
     string  TargetBracketString = "";
+    PVOID   CodeBuffer          = NULL;
 
     vector<int> IndexesToRemove;
     UINT32      Index            = 0;
@@ -824,7 +881,34 @@ InterpretScript(vector<CommandToken> * CommandTokens,
         return FALSE;
     }
 
-    if (TargetBracketString.rfind("file:", 0) == 0)
+    if (TargetBracketString.rfind("compiled:", 0) == 0)
+    {
+        //
+        // It's a precompiled script file (see '.precompile'), it only
+        // needs to be relocated
+        //
+        std::ifstream     t(TargetBracketString.erase(0, 9).c_str(), std::ios::binary);
+        std::vector<CHAR> CompiledScript((std::istreambuf_iterator<char>(t)), std::istreambuf_iterator<char>());
+
+        if (CompiledScript.empty())
+        {
+            ShowMessages("err, either compiled script file is not found or it's empty\n");
+
+            //
+            // There was an error
+            //
+            *ScriptSyntaxErrors = TRUE;
+
+            //
+            // return TRUE to show that this item contains an script
+            //
+            return TRUE;
+        }
+
+        CodeBuffer       = ScriptEngineLoadCompiledScriptWrapper(CompiledScript.data(), (UINT32)CompiledScript.size(), TRUE);
+        IsCompiledScript = TRUE;
+    }
+    else if (TargetBracketString.rfind("file:", 0) == 0)
     {
         //
         // It's a file script
@@ -854,7 +938,10 @@ InterpretScript(vector<CommandToken> * CommandTokens,
     //
     // Run script engine handler
     //
-    PVOID CodeBuffer = ScriptEngineParseWrapper((char *)TargetBracketString.c_str(), TRUE);
+    if (!IsCompiledScript)
+    {
+        CodeBuffer = ScriptEngineParseWrapper((char *)TargetBracketString.c_str(), TRUE);
+    }
 
     if (CodeBuffer == NULL)
     {
@@ -1677,6 +1764,10 @@ InterpretGeneralEventAndActionsFields(
     BOOLEAN                               IsNextCommandImmediateMessaging  = FALSE;
     BOOLEAN                               IsNextCommandExecutionStage      = FALSE;
     BOOLEAN                               IsNextCommandSc                  = FALSE;
+    BOOLEAN                               IsNextCommandSample              = FALSE;
+    BOOLEAN                               IsNextCommandProbability         = FALSE;
+    BOOLEAN                               IsNextCommandRate                = FALSE;
+    BOOLEAN                               IsNextCommandBurst               = FALSE;
     BOOLEAN                               ImmediateMessagePassing          = UseImmediateMessagingByDefaultOnEvents;
     UINT32                                CoreId;
     UINT32                                ProcessId;
@@ -2343,6 +2434,87 @@ InterpretGeneralEventAndActionsFields(
             continue;
         }
 
+        if (IsNextCommandSample)
+        {
+            if (!ConvertTokenToUInt32(Section, &TempEvent->Throttle.SampleEveryNthHit) ||
+                TempEvent->Throttle.SampleEveryNthHit == 0)
+            {
+                ShowMessages("err, the sampling interval is invalid\n");
+                *ReasonForErrorInParsing = DEBUGGER_EVENT_PARSING_ERROR_CAUSE_FORMAT_ERROR;
+                goto ReturnWithError;
+            }
+
+            IsNextCommandSample = FALSE;
+
+            //
+            // Add index to remove it from the command
+            //
+            IndexesToRemove.push_back(Index);
+
+            continue;
+        }
+
+        if (IsNextCommandProbability)
+        {
+            if (!ConvertTokenToPercentage(Section, &TempEvent->Throttle.SampleProbability) ||
+                TempEvent->Throttle.SampleProbability == 0)
+            {
+                ShowMessages("err, the sampling probability is invalid; please specify a percentage "
+                             "greater than 0 and up to 100 (e.g., 12.5%%)\n");
+                *ReasonForErrorInParsing = DEBUGGER_EVENT_PARSING_ERROR_CAUSE_FORMAT_ERROR;
+                goto ReturnWithError;
+            }
+
+            IsNextCommandProbability = FALSE;
+
+            //
+            // Add index to remove it from the command
+            //
+            IndexesToRemove.push_back(Index);
+
+            continue;
+        }
+
+        if (IsNextCommandRate)
+        {
+            if (!ConvertTokenToUInt32(Section, &TempEvent->Throttle.MaximumHitsPerSecond) ||
+                TempEvent->Throttle.MaximumHitsPerSecond == 0)
+            {
+                ShowMessages("err, the rate is invalid\n");
+                *ReasonForErrorInParsing = DEBUGGER_EVENT_PARSING_ERROR_CAUSE_FORMAT_ERROR;
+                goto ReturnWithError;
+            }
+
+            IsNextCommandRate = FALSE;
+
+            //
+            // Add index to remove it from the command
+            //
+            IndexesToRemove.push_back(Index);
+
+            continue;
+        }
+
+        if (IsNextCommandBurst)
+        {
+            if (!ConvertTokenToUInt32(Section, &TempEvent->Throttle.BurstSize) ||
+                TempEvent->Throttle.BurstSize == 0)
+            {
+                ShowMessages("err, the burst size is invalid\n");
+                *ReasonForErrorInParsing = DEBUGGER_EVENT_PARSING_ERROR_CAUSE_FORMAT_ERROR;
+                goto ReturnWithError;
+            }
+
+            IsNextCommandBurst = FALSE;
+
+            //
+            // Add index to remove it from the command
+            //
+            IndexesToRemove.push_back(Index);
+
+            continue;
+        }
+
         if (IsNextCommandPid)
         {
             if (CompareLowerCaseStrings(Section, "all"))
@@ -2478,6 +2650,81 @@ InterpretGeneralEventAndActionsFields(
 
             continue;
         }
+
+        if (CompareLowerCaseStrings(Section, "sample"))
+        {
+            //
+            // the next command is the sampling interval (1-in-N hits)
+            //
+            IsNextCommandSample = TRUE;
+
+            //
+            // Add index to remove it from the command
+            //
+            IndexesToRemove.push_back(Index);
+
+            continue;
+        }
+
+        if (CompareLowerCaseStrings(Section, "probability"))
+        {
+            //
+            // the next command is the sampling probability
+            //
+            IsNextCommandProbability = TRUE;
+
+            //
+            // Add index to remove it from the command
+            //
+            IndexesToRemove.push_back(Index);
+
+            continue;
+        }
+
+        if (CompareLowerCaseStrings(Section, "rate"))
+        {
+            //
+            // the next command is the maximum hits per second
+            //
+            IsNextCommandRate = TRUE;
+
+            //
+            // Add index to remove it from the command
+            //
+            IndexesToRemove.push_back(Index);
+
+            continue;
+        }
+
+        if (CompareLowerCaseStrings(Section, "burst"))
+        {
+            //
+            // the next command is the burst size of the rate limit
+            //
+            IsNextCommandBurst = TRUE;
+
+            //
+            // Add index to remove it from the command
+            //
+            IndexesToRemove.push_back(Index);
+
+            continue;
+        }
+
+        if (CompareLowerCaseStrings(Section, "disarm"))
+        {
+            //
+            // Clear the exiting bit while the rate budget is exhausted
+            //
+            TempEvent->Throttle.DisableExitingWhenThrottled = TRUE;
+
+            //
+            // Add index to remove it from the command
+            //
+            IndexesToRemove.push_back(Index);
+
+            continue;
+        }
     }
 
     //
@@ -2537,6 +2784,28 @@ InterpretGeneralEventAndActionsFields(
         goto ReturnWithError;
     }
 
+    if (IsNextCommandSample || IsNextCommandProbability || IsNextCommandRate || IsNextCommandBurst)
+    {
+        ShowMessages("err, please specify a value for 'sample', 'probability', 'rate', or 'burst'\n");
+
+        *ReasonForErrorInParsing = DEBUGGER_EVENT_PARSING_ERROR_CAUSE_FORMAT_ERROR;
+
+        goto ReturnWithError;
+    }
+
+    //
+    // The burst and disarming mode are only meaningful with a rate limit
+    //
+    if (TempEvent->Throttle.MaximumHitsPerSecond == 0 &&
+        (TempEvent->Throttle.BurstSize != 0 || TempEvent->Throttle.DisableExitingWhenThrottled))
+    {
+        ShowMessages("err, 'burst' and 'disarm' should be used along with 'rate'\n");
+
+        *ReasonForErrorInParsing = DEBUGGER_EVENT_PARSING_ERROR_CAUSE_FORMAT_ERROR;
+
+        goto ReturnWithError;
+    }
+
     //
     // Check to make sure that short-circuiting is not used in post-events
     //
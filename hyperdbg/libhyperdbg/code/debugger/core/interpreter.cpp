@@ -1566,6 +1566,8 @@ InitializeCommandsDictionary()
     g_CommandsList["!sb"] = {&CommandSearchMemory, &CommandSearchMemoryHelp, DEBUGGER_COMMAND_S_ATTRIBUTES};
     g_CommandsList["!sd"] = {&CommandSearchMemory, &CommandSearchMemoryHelp, DEBUGGER_COMMAND_S_ATTRIBUTES};
     g_CommandsList["!sq"] = {&CommandSearchMemory, &CommandSearchMemoryHelp, DEBUGGER_COMMAND_S_ATTRIBUTES};
+    g_CommandsList["sm"]  = {&CommandSearchMemory, &CommandSearchMemoryHelp, DEBUGGER_COMMAND_S_ATTRIBUTES};
+    g_CommandsList["!sm"] = {&CommandSearchMemory, &CommandSearchMemoryHelp, DEBUGGER_COMMAND_S_ATTRIBUTES};
 
     g_CommandsList["r"] = {&CommandR, &CommandRHelp, DEBUGGER_COMMAND_R_ATTRIBUTES};
 
@@ -1597,6 +1599,8 @@ InitializeCommandsDictionary()
 
     g_CommandsList[".pe"] = {&CommandPe, &CommandPeHelp, DEBUGGER_COMMAND_PE_ATTRIBUTES};
 
+    g_CommandsList[".precompile"] = {&CommandPrecompile, &CommandPrecompileHelp, DEBUGGER_COMMAND_PRECOMPILE_ATTRIBUTES};
+
     g_CommandsList["!rev"] = {&CommandRev, &CommandRevHelp, DEBUGGER_COMMAND_REV_ATTRIBUTES};
     g_CommandsList["rev"]  = {&CommandRev, &CommandRevHelp, DEBUGGER_COMMAND_REV_ATTRIBUTES};
 
@@ -1623,6 +1627,9 @@ InitializeCommandsDictionary()
 
     g_CommandsList["!idt"] = {&CommandIdt, &CommandIdtHelp, DEBUGGER_COMMAND_IDT_ATTRIBUTES};
 
+    g_CommandsList["!profile"] = {&CommandProfile, &CommandProfileHelp, DEBUGGER_COMMAND_PROFILE_ATTRIBUTES};
+    g_CommandsList["profile"]  = {&CommandProfile, &CommandProfileHelp, DEBUGGER_COMMAND_PROFILE_ATTRIBUTES};
+
     //
     // hwdbg commands
     //
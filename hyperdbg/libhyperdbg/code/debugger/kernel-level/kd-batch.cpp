@@ -0,0 +1,626 @@
+/**
+ * @file kd-batch.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Batch operations of the kernel debugger
+ * @details A batch is a list of operations (reading/writing memory and
+ * registers, setting/clearing breakpoints and bringing pages in) which is
+ * sent to the halted debuggee as a single packet and is answered by a
+ * single packet containing the status of each operation
+ * @version 0.11
+ * @date 2024-10-25
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+//
+// Global Variables
+//
+extern BOOLEAN g_IsSerialConnectedToRemoteDebuggee;
+extern BOOLEAN g_IsDebuggeeRunning;
+
+/**
+ * @brief Create an empty batch
+ *
+ * @return PKD_BATCH NULL if the batch is not allocated
+ */
+PKD_BATCH
+KdBatchCreate()
+{
+    PKD_BATCH Batch = new (std::nothrow) KD_BATCH;
+
+    if (Batch == NULL)
+    {
+        return NULL;
+    }
+
+    Batch->Request.resize(sizeof(DEBUGGEE_BATCH_PACKET), 0);
+    Batch->ExpectedResultSize = sizeof(DEBUGGEE_BATCH_PACKET);
+    Batch->IsExecuted         = FALSE;
+
+    return Batch;
+}
+
+/**
+ * @brief Free a batch
+ *
+ * @param Batch
+ *
+ * @return VOID
+ */
+VOID
+KdBatchFree(PKD_BATCH Batch)
+{
+    delete Batch;
+}
+
+/**
+ * @brief Add an operation to the batch
+ * @details the operation is rejected if either the request or the
+ * result of the batch doesn't fit in a single packet
+ *
+ * @param Batch
+ * @param Type
+ * @param Operation the request of the operation
+ * @param OperationSize
+ * @param ResultSize size of the result of the operation
+ * @param Index index of the added operation
+ *
+ * @return PVOID the request of the operation inside the batch (NULL if it's not added)
+ */
+static PVOID
+KdBatchAddOperation(PKD_BATCH                     Batch,
+                    DEBUGGEE_BATCH_OPERATION_TYPE Type,
+                    PVOID                         Operation,
+                    UINT32                        OperationSize,
+                    UINT32                        ResultSize,
+                    UINT32 *                      Index)
+{
+    DEBUGGEE_BATCH_OPERATION_HEADER Header = {0};
+    UINT64                          NewRequestSize;
+    UINT64                          NewResultSize;
+    SIZE_T                          Offset;
+
+    if (Batch == NULL)
+    {
+        return NULL;
+    }
+
+    NewRequestSize = Batch->Request.size() + DEBUGGEE_BATCH_OPERATION_SIZE((UINT64)OperationSize);
+    NewResultSize  = Batch->ExpectedResultSize + DEBUGGEE_BATCH_OPERATION_SIZE((UINT64)ResultSize);
+
+    if (NewRequestSize > MaxBatchPacketSize || NewResultSize > MaxBatchPacketSize)
+    {
+        ShowMessages("err, the operation doesn't fit in the batch (%x)\n",
+                     DEBUGGER_ERROR_INVALID_BATCH_OPERATION);
+        return NULL;
+    }
+
+    Header.Type = Type;
+    Header.Size = OperationSize;
+
+    //
+    // The alignment is zero-filled
+    //
+    Offset = Batch->Request.size();
+    Batch->Request.resize((SIZE_T)NewRequestSize, 0);
+
+    memcpy(&Batch->Request[Offset], &Header, sizeof(DEBUGGEE_BATCH_OPERATION_HEADER));
+    memcpy(&Batch->Request[Offset + sizeof(DEBUGGEE_BATCH_OPERATION_HEADER)], Operation, OperationSize);
+
+    Batch->OperationTypes.push_back(Type);
+    Batch->ExpectedResultSize = (UINT32)NewResultSize;
+
+    //
+    // The previous result (if any) doesn't belong to the new list
+    //
+    Batch->IsExecuted = FALSE;
+
+    if (Index != NULL)
+    {
+        *Index = (UINT32)Batch->OperationTypes.size() - 1;
+    }
+
+    return &Batch->Request[Offset + sizeof(DEBUGGEE_BATCH_OPERATION_HEADER)];
+}
+
+/**
+ * @brief Add reading memory to the batch
+ *
+ * @param Batch
+ * @param Address
+ * @param MemoryType
+ * @param Size
+ * @param Index
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+KdBatchAddReadMemory(PKD_BATCH                 Batch,
+                     UINT64                    Address,
+                     DEBUGGER_READ_MEMORY_TYPE MemoryType,
+                     UINT32                    Size,
+                     UINT32 *                  Index)
+{
+    DEBUGGER_READ_MEMORY ReadMem = {0};
+
+    if (Size == 0)
+    {
+        return FALSE;
+    }
+
+    ReadMem.Address     = Address;
+    ReadMem.Size        = Size;
+    ReadMem.MemoryType  = MemoryType;
+    ReadMem.ReadingType = READ_FROM_VMX_ROOT;
+
+    return KdBatchAddOperation(Batch,
+                               DEBUGGEE_BATCH_OPERATION_TYPE_READ_MEMORY,
+                               &ReadMem,
+                               sizeof(DEBUGGER_READ_MEMORY),
+                               sizeof(DEBUGGER_READ_MEMORY) + Size,
+                               Index) != NULL;
+}
+
+/**
+ * @brief Add writing memory to the batch
+ * @details the memory is written in 64-bit chunks if the size is
+ * aligned to 8 bytes, otherwise it's written byte by byte
+ *
+ * @param Batch
+ * @param Address
+ * @param MemoryType
+ * @param Buffer
+ * @param Size
+ * @param Index
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+KdBatchAddWriteMemory(PKD_BATCH                 Batch,
+                      UINT64                    Address,
+                      DEBUGGER_EDIT_MEMORY_TYPE MemoryType,
+                      const BYTE *              Buffer,
+                      UINT32                    Size,
+                      UINT32 *                  Index)
+{
+    DEBUGGER_EDIT_MEMORY EditMem = {0};
+    UINT32               LengthOfEachChunk;
+    UINT64 *             Chunks;
+    UINT64               RequestSize;
+
+    if (Buffer == NULL || Size == 0)
+    {
+        return FALSE;
+    }
+
+    LengthOfEachChunk = (Size % sizeof(UINT64) == 0) ? sizeof(UINT64) : sizeof(BYTE);
+
+    EditMem.Address         = Address;
+    EditMem.MemoryType      = MemoryType;
+    EditMem.ByteSize        = LengthOfEachChunk == sizeof(UINT64) ? EDIT_QWORD : EDIT_BYTE;
+    EditMem.CountOf64Chunks = Size / LengthOfEachChunk;
+
+    RequestSize = SIZEOF_DEBUGGER_EDIT_MEMORY + (UINT64)EditMem.CountOf64Chunks * sizeof(UINT64);
+
+    if (RequestSize > MaxBatchPacketSize)
+    {
+        ShowMessages("err, the operation doesn't fit in the batch (%x)\n",
+                     DEBUGGER_ERROR_INVALID_BATCH_OPERATION);
+        return FALSE;
+    }
+
+    EditMem.FinalStructureSize = (UINT32)RequestSize;
+
+    //
+    // The chunks are added after the request
+    //
+    std::vector<CHAR> Request((SIZE_T)RequestSize, 0);
+
+    memcpy(Request.data(), &EditMem, SIZEOF_DEBUGGER_EDIT_MEMORY);
+
+    Chunks = (UINT64 *)(Request.data() + SIZEOF_DEBUGGER_EDIT_MEMORY);
+
+    for (UINT32 i = 0; i < EditMem.CountOf64Chunks; i++)
+    {
+        memcpy(&Chunks[i], &Buffer[i * LengthOfEachChunk], LengthOfEachChunk);
+    }
+
+    return KdBatchAddOperation(Batch,
+                               DEBUGGEE_BATCH_OPERATION_TYPE_EDIT_MEMORY,
+                               Request.data(),
+                               (UINT32)RequestSize,
+                               SIZEOF_DEBUGGER_EDIT_MEMORY,
+                               Index) != NULL;
+}
+
+/**
+ * @brief Add reading a register to the batch
+ *
+ * @param Batch
+ * @param RegisterId the register or DEBUGGEE_SHOW_ALL_REGISTERS
+ * @param Index
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+KdBatchAddReadRegister(PKD_BATCH Batch, UINT32 RegisterId, UINT32 * Index)
+{
+    DEBUGGEE_REGISTER_READ_DESCRIPTION RegDes     = {0};
+    UINT32                             ResultSize = sizeof(DEBUGGEE_REGISTER_READ_DESCRIPTION);
+
+    RegDes.RegisterId = RegisterId;
+
+    if (RegisterId == DEBUGGEE_SHOW_ALL_REGISTERS)
+    {
+        ResultSize += sizeof(GUEST_REGS) + sizeof(GUEST_EXTRA_REGISTERS);
+    }
+
+    return KdBatchAddOperation(Batch,
+                               DEBUGGEE_BATCH_OPERATION_TYPE_READ_REGISTER,
+                               &RegDes,
+                               sizeof(DEBUGGEE_REGISTER_READ_DESCRIPTION),
+                               ResultSize,
+                               Index) != NULL;
+}
+
+/**
+ * @brief Add writing a register to the batch
+ *
+ * @param Batch
+ * @param RegisterId
+ * @param Value
+ * @param Index
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+KdBatchAddWriteRegister(PKD_BATCH Batch, UINT32 RegisterId, UINT64 Value, UINT32 * Index)
+{
+    DEBUGGEE_REGISTER_WRITE_DESCRIPTION RegDes = {0};
+
+    RegDes.RegisterId = RegisterId;
+    RegDes.Value      = Value;
+
+    return KdBatchAddOperation(Batch,
+                               DEBUGGEE_BATCH_OPERATION_TYPE_WRITE_REGISTER,
+                               &RegDes,
+                               sizeof(DEBUGGEE_REGISTER_WRITE_DESCRIPTION),
+                               sizeof(DEBUGGEE_REGISTER_WRITE_DESCRIPTION),
+                               Index) != NULL;
+}
+
+/**
+ * @brief Add setting a breakpoint to the batch
+ *
+ * @param Batch
+ * @param Address
+ * @param Pid
+ * @param Tid
+ * @param Core
+ * @param Index
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+KdBatchAddSetBreakpoint(PKD_BATCH Batch, UINT64 Address, UINT32 Pid, UINT32 Tid, UINT32 Core, UINT32 * Index)
+{
+    DEBUGGEE_BP_PACKET BpPacket = {0};
+
+    BpPacket.Address = Address;
+    BpPacket.Pid     = Pid;
+    BpPacket.Tid     = Tid;
+    BpPacket.Core    = Core;
+
+    return KdBatchAddOperation(Batch,
+                               DEBUGGEE_BATCH_OPERATION_TYPE_SET_BREAKPOINT,
+                               &BpPacket,
+                               sizeof(DEBUGGEE_BP_PACKET),
+                               sizeof(DEBUGGEE_BP_PACKET),
+                               Index) != NULL;
+}
+
+/**
+ * @brief Add clearing a breakpoint to the batch
+ *
+ * @param Batch
+ * @param BreakpointId
+ * @param Index
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+KdBatchAddClearBreakpoint(PKD_BATCH Batch, UINT64 BreakpointId, UINT32 * Index)
+{
+    DEBUGGEE_BP_LIST_OR_MODIFY_PACKET ModifyPacket = {0};
+
+    ModifyPacket.BreakpointId = BreakpointId;
+    ModifyPacket.Request      = DEBUGGEE_BREAKPOINT_MODIFICATION_REQUEST_CLEAR;
+
+    return KdBatchAddOperation(Batch,
+                               DEBUGGEE_BATCH_OPERATION_TYPE_MODIFY_BREAKPOINT,
+                               &ModifyPacket,
+                               sizeof(DEBUGGEE_BP_LIST_OR_MODIFY_PACKET),
+                               sizeof(DEBUGGEE_BP_LIST_OR_MODIFY_PACKET),
+                               Index) != NULL;
+}
+
+/**
+ * @brief Add bringing pages in to the batch
+ * @details the pages are brought in once the debuggee continues, and only
+ * one page-in operation is accepted in each batch
+ *
+ * @param Batch
+ * @param AddressFrom
+ * @param AddressTo
+ * @param PageFaultErrorCode
+ * @param Index
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+KdBatchAddPagein(PKD_BATCH Batch, UINT64 AddressFrom, UINT64 AddressTo, UINT32 PageFaultErrorCode, UINT32 * Index)
+{
+    DEBUGGER_PAGE_IN_REQUEST PageinRequest = {0};
+
+    if (Batch == NULL ||
+        std::find(Batch->OperationTypes.begin(),
+                  Batch->OperationTypes.end(),
+                  DEBUGGEE_BATCH_OPERATION_TYPE_PAGE_IN) != Batch->OperationTypes.end())
+    {
+        return FALSE;
+    }
+
+    PageinRequest.VirtualAddressFrom = AddressFrom;
+    PageinRequest.VirtualAddressTo   = AddressTo;
+    PageinRequest.PageFaultErrorCode = PageFaultErrorCode;
+
+    return KdBatchAddOperation(Batch,
+                               DEBUGGEE_BATCH_OPERATION_TYPE_PAGE_IN,
+                               &PageinRequest,
+                               sizeof(DEBUGGER_PAGE_IN_REQUEST),
+                               sizeof(DEBUGGER_PAGE_IN_REQUEST),
+                               Index) != NULL;
+}
+
+/**
+ * @brief Check the result of the batch and find the result of each
+ * performed operation
+ *
+ * @param Batch
+ * @param ResultSize size of the received result
+ *
+ * @return BOOLEAN FALSE if the result is malformed
+ */
+BOOLEAN
+KdBatchParseResult(PKD_BATCH Batch, UINT32 ResultSize)
+{
+    PDEBUGGEE_BATCH_PACKET           BatchResult;
+    PDEBUGGEE_BATCH_OPERATION_HEADER Operation;
+    UINT32                           Offset = sizeof(DEBUGGEE_BATCH_PACKET);
+
+    Batch->ResultOffsets.clear();
+
+    if (ResultSize < sizeof(DEBUGGEE_BATCH_PACKET) || ResultSize > Batch->Result.size())
+    {
+        return FALSE;
+    }
+
+    BatchResult = (PDEBUGGEE_BATCH_PACKET)Batch->Result.data();
+
+    if (BatchResult->TotalSize > ResultSize ||
+        BatchResult->NumberOfPerformedOperations > Batch->OperationTypes.size())
+    {
+        return FALSE;
+    }
+
+    for (UINT32 i = 0; i < BatchResult->NumberOfPerformedOperations; i++)
+    {
+        if (Offset + sizeof(DEBUGGEE_BATCH_OPERATION_HEADER) > BatchResult->TotalSize)
+        {
+            return FALSE;
+        }
+
+        Operation = (PDEBUGGEE_BATCH_OPERATION_HEADER)&Batch->Result[Offset];
+
+        if (Operation->Type != (UINT32)Batch->OperationTypes[i] ||
+            Operation->Size > BatchResult->TotalSize - Offset - sizeof(DEBUGGEE_BATCH_OPERATION_HEADER))
+        {
+            return FALSE;
+        }
+
+        Batch->ResultOffsets.push_back(Offset);
+
+        Offset += DEBUGGEE_BATCH_OPERATION_SIZE(Operation->Size);
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Fill the header of the request of the batch and allocate the
+ * buffer of its result
+ *
+ * @param Batch
+ *
+ * @return PDEBUGGEE_BATCH_PACKET the request that is sent to the debuggee
+ */
+PDEBUGGEE_BATCH_PACKET
+KdBatchPrepareRequest(PKD_BATCH Batch)
+{
+    PDEBUGGEE_BATCH_PACKET BatchPacket = (PDEBUGGEE_BATCH_PACKET)Batch->Request.data();
+
+    BatchPacket->NumberOfOperations          = (UINT32)Batch->OperationTypes.size();
+    BatchPacket->TotalSize                   = (UINT32)Batch->Request.size();
+    BatchPacket->NumberOfPerformedOperations = 0;
+    BatchPacket->KernelStatus                = 0;
+
+    Batch->IsExecuted = FALSE;
+    Batch->Result.assign(Batch->ExpectedResultSize, 0);
+
+    return BatchPacket;
+}
+
+/**
+ * @brief Send the batch to the debuggee and wait for the result
+ *
+ * @param Batch
+ * @param NumberOfPerformedOperations
+ *
+ * @return BOOLEAN TRUE if all of the operations are performed (each
+ * operation has its own status)
+ */
+BOOLEAN
+KdBatchExecute(PKD_BATCH Batch, UINT32 * NumberOfPerformedOperations)
+{
+    PDEBUGGEE_BATCH_PACKET BatchPacket;
+    PDEBUGGEE_BATCH_PACKET BatchResult;
+
+    if (NumberOfPerformedOperations != NULL)
+    {
+        *NumberOfPerformedOperations = 0;
+    }
+
+    if (Batch == NULL || Batch->OperationTypes.empty())
+    {
+        return FALSE;
+    }
+
+    //
+    // Operations are performed by the halted debuggee
+    //
+    if (!g_IsSerialConnectedToRemoteDebuggee || g_IsDebuggeeRunning)
+    {
+        ShowMessages("err, batch operations can be used ONLY in the debugger mode "
+                     "while the debuggee is paused\n");
+        return FALSE;
+    }
+
+    BatchPacket = KdBatchPrepareRequest(Batch);
+
+    if (!KdSendBatchPacketToDebuggee(BatchPacket,
+                                     (UINT32)Batch->Request.size(),
+                                     (PDEBUGGEE_BATCH_PACKET)Batch->Result.data(),
+                                     (UINT32)Batch->Result.size()))
+    {
+        return FALSE;
+    }
+
+    BatchResult = (PDEBUGGEE_BATCH_PACKET)Batch->Result.data();
+
+    if (!KdBatchParseResult(Batch, (UINT32)Batch->Result.size()))
+    {
+        ShowMessages("err, invalid result is received for the batch operations\n");
+        return FALSE;
+    }
+
+    Batch->IsExecuted = TRUE;
+
+    if (NumberOfPerformedOperations != NULL)
+    {
+        *NumberOfPerformedOperations = BatchResult->NumberOfPerformedOperations;
+    }
+
+    if (BatchResult->KernelStatus != DEBUGGER_OPERATION_WAS_SUCCESSFUL)
+    {
+        ShowErrorMessage(BatchResult->KernelStatus);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Get the result of an operation of an executed batch
+ * @details the content of the memory is returned for reading memory, and
+ * the value of the register (or GUEST_REGS followed by GUEST_EXTRA_REGISTERS
+ * for all registers) is returned for reading registers
+ *
+ * @param Batch
+ * @param Index index of the operation
+ * @param KernelStatus status of the operation
+ * @param Buffer buffer to store the result (optional)
+ * @param BufferSize
+ * @param ReturnLength size of the result (optional)
+ *
+ * @return BOOLEAN FALSE if the operation is not performed
+ */
+BOOLEAN
+KdBatchGetResult(PKD_BATCH Batch,
+                 UINT32    Index,
+                 UINT32 *  KernelStatus,
+                 PVOID     Buffer,
+                 UINT32    BufferSize,
+                 UINT32 *  ReturnLength)
+{
+    PDEBUGGEE_BATCH_OPERATION_HEADER Operation;
+    CHAR *                           OperationResult;
+    CHAR *                           Data       = NULL;
+    UINT32                           DataLength = 0;
+
+    if (ReturnLength != NULL)
+    {
+        *ReturnLength = 0;
+    }
+
+    if (Batch == NULL || !Batch->IsExecuted || Index >= Batch->ResultOffsets.size())
+    {
+        return FALSE;
+    }
+
+    Operation       = (PDEBUGGEE_BATCH_OPERATION_HEADER)&Batch->Result[Batch->ResultOffsets[Index]];
+    OperationResult = (CHAR *)Operation + sizeof(DEBUGGEE_BATCH_OPERATION_HEADER);
+
+    if (KernelStatus != NULL)
+    {
+        *KernelStatus = Operation->KernelStatus;
+    }
+
+    switch (Operation->Type)
+    {
+    case DEBUGGEE_BATCH_OPERATION_TYPE_READ_MEMORY:
+
+        if (Operation->Size >= sizeof(DEBUGGER_READ_MEMORY))
+        {
+            Data       = OperationResult + sizeof(DEBUGGER_READ_MEMORY);
+            DataLength = Operation->Size - sizeof(DEBUGGER_READ_MEMORY);
+        }
+
+        break;
+
+    case DEBUGGEE_BATCH_OPERATION_TYPE_READ_REGISTER:
+
+        if (Operation->Size > sizeof(DEBUGGEE_REGISTER_READ_DESCRIPTION))
+        {
+            Data       = OperationResult + sizeof(DEBUGGEE_REGISTER_READ_DESCRIPTION);
+            DataLength = Operation->Size - sizeof(DEBUGGEE_REGISTER_READ_DESCRIPTION);
+        }
+        else if (Operation->Size == sizeof(DEBUGGEE_REGISTER_READ_DESCRIPTION))
+        {
+            Data       = (CHAR *)&((PDEBUGGEE_REGISTER_READ_DESCRIPTION)OperationResult)->Value;
+            DataLength = sizeof(UINT64);
+        }
+
+        break;
+
+    default:
+
+        //
+        // Other operations only have a status
+        //
+        break;
+    }
+
+    if (Data != NULL && Buffer != NULL)
+    {
+        memcpy(Buffer, Data, DataLength < BufferSize ? DataLength : BufferSize);
+    }
+
+    if (ReturnLength != NULL)
+    {
+        *ReturnLength = DataLength;
+    }
+
+    return TRUE;
+}
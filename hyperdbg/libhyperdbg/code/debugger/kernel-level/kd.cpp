@@ -38,6 +38,7 @@ extern BOOLEAN g_IsDebuggerModulesLoaded;
 extern BOOLEAN g_SerialConnectionAlreadyClosed;
 extern BOOLEAN g_IgnoreNewLoggingMessages;
 extern BOOLEAN g_SharedEventStatus;
+extern UINT64  g_SharedEventSuppressedHits;
 extern BOOLEAN g_IsRunningInstruction32Bit;
 extern BOOLEAN g_IgnorePauseRequests;
 extern BOOLEAN g_IsDebuggeeInHandshakingPhase;
@@ -305,6 +306,57 @@ KdSendEventQueryAndModifyPacketToDebuggee(
     return TRUE;
 }
 
+/**
+ * @brief Query the number of hits that are suppressed by the throttling
+ * options of the events from the debuggee
+ * @details if the tag is DEBUGGER_MODIFY_EVENTS_APPLY_TO_ALL_TAG then the
+ * hits that are suppressed on the core are queried
+ *
+ * @param Tag
+ * @param CoreId
+ * @param SuppressedHits
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+KdSendEventQuerySuppressedHitsPacketToDebuggee(UINT64   Tag,
+                                               UINT32   CoreId,
+                                               UINT64 * SuppressedHits)
+{
+    DEBUGGER_MODIFY_EVENTS QueryEventPacket = {0};
+
+    g_SharedEventStatus         = FALSE;
+    g_SharedEventSuppressedHits = 0;
+
+    //
+    // Fill the structure of packet
+    //
+    QueryEventPacket.Tag          = Tag;
+    QueryEventPacket.CoreId       = CoreId;
+    QueryEventPacket.TypeOfAction = DEBUGGER_MODIFY_EVENTS_QUERY_SUPPRESSED_HITS;
+
+    //
+    // Send the query as a modify and query event packet
+    //
+    if (!KdCommandPacketAndBufferToDebuggee(
+            DEBUGGER_REMOTE_PACKET_TYPE_DEBUGGER_TO_DEBUGGEE_EXECUTE_ON_VMX_ROOT,
+            DEBUGGER_REMOTE_PACKET_REQUESTED_ACTION_ON_VMX_ROOT_QUERY_AND_MODIFY_EVENT,
+            (CHAR *)&QueryEventPacket,
+            sizeof(DEBUGGER_MODIFY_EVENTS)))
+    {
+        return FALSE;
+    }
+
+    //
+    // Wait until the result of query is received
+    //
+    DbgWaitForKernelResponse(DEBUGGER_SYNCRONIZATION_OBJECT_KERNEL_DEBUGGER_MODIFY_AND_QUERY_EVENT);
+
+    *SuppressedHits = g_SharedEventSuppressedHits;
+
+    return g_SharedEventStatus;
+}
+
 /**
  * @brief Send a flush request to the debuggee
  *
@@ -955,6 +1007,46 @@ KdSendPageinPacketToDebuggee(PDEBUGGER_PAGE_IN_REQUEST PageinPacket)
     return TRUE;
 }
 
+/**
+ * @brief Sends a batch of operations to the debuggee
+ * @param BatchPacket
+ * @param BatchPacketSize
+ * @param BatchResult buffer to store the result of the operations
+ * @param BatchResultSize
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+KdSendBatchPacketToDebuggee(PDEBUGGEE_BATCH_PACKET BatchPacket,
+                            UINT32                 BatchPacketSize,
+                            PDEBUGGEE_BATCH_PACKET BatchResult,
+                            UINT32                 BatchResultSize)
+{
+    //
+    // Set the request data
+    //
+    DbgWaitSetRequestData(DEBUGGER_SYNCRONIZATION_OBJECT_KERNEL_DEBUGGER_BATCH_OPERATIONS, BatchResult, BatchResultSize);
+
+    //
+    // Send all of the operations as a single packet
+    //
+    if (!KdCommandPacketAndBufferToDebuggee(
+            DEBUGGER_REMOTE_PACKET_TYPE_DEBUGGER_TO_DEBUGGEE_EXECUTE_ON_VMX_ROOT,
+            DEBUGGER_REMOTE_PACKET_REQUESTED_ACTION_ON_VMX_ROOT_PERFORM_BATCH_OPERATIONS,
+            (CHAR *)BatchPacket,
+            BatchPacketSize))
+    {
+        return FALSE;
+    }
+
+    //
+    // Wait until the result of all of the operations is received
+    //
+    DbgWaitForKernelResponse(DEBUGGER_SYNCRONIZATION_OBJECT_KERNEL_DEBUGGER_BATCH_OPERATIONS);
+
+    return TRUE;
+}
+
 /**
  * @brief Sends VA2PA and PA2VA packest, or '!va2pa' and '!pa2va' commands packet to the debuggee
  * @param Va2paAndPa2vaPacket
@@ -1241,12 +1333,20 @@ KdSendUserInputPacketToDebuggee(const char * Sendbuf, int Len, BOOLEAN IgnoreBre
  * @brief Sends search query request packet to the debuggee
  * @param SearchRequestBuffer
  * @param SearchRequestBufferSize
+ * @param SearchResult buffer to store the result of the search (slice)
  *
  * @return BOOLEAN
  */
 BOOLEAN
-KdSendSearchRequestPacketToDebuggee(UINT64 * SearchRequestBuffer, UINT32 SearchRequestBufferSize)
+KdSendSearchRequestPacketToDebuggee(UINT64 *                          SearchRequestBuffer,
+                                    UINT32                            SearchRequestBufferSize,
+                                    PDEBUGGEE_RESULT_OF_SEARCH_PACKET SearchResult)
 {
+    //
+    // Set the request data
+    //
+    DbgWaitSetRequestData(DEBUGGER_SYNCRONIZATION_OBJECT_KERNEL_DEBUGGER_SEARCH_QUERY_RESULT, SearchResult, sizeof(DEBUGGEE_RESULT_OF_SEARCH_PACKET));
+
     //
     // Send search request packet
     //
@@ -1267,6 +1367,82 @@ KdSendSearchRequestPacketToDebuggee(UINT64 * SearchRequestBuffer, UINT32 SearchR
     return TRUE;
 }
 
+/**
+ * @brief Sends a multi-pattern search ('sm' and '!sm' commands) packet to the debuggee
+ * @param SearchRequest
+ * @param SearchResult buffer to store the request and the results after it
+ * @param SearchResultSize
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+KdSendSearchMultiplePatternsPacketToDebuggee(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS SearchRequest,
+                                             PDEBUGGER_SEARCH_MULTIPLE_PATTERNS SearchResult,
+                                             UINT32                             SearchResultSize)
+{
+    //
+    // Set the request data
+    //
+    DbgWaitSetRequestData(DEBUGGER_SYNCRONIZATION_OBJECT_KERNEL_DEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT, SearchResult, SearchResultSize);
+
+    //
+    // Send the multi-pattern search request packet
+    //
+    if (!KdCommandPacketAndBufferToDebuggee(
+            DEBUGGER_REMOTE_PACKET_TYPE_DEBUGGER_TO_DEBUGGEE_EXECUTE_ON_VMX_ROOT,
+            DEBUGGER_REMOTE_PACKET_REQUESTED_ACTION_ON_VMX_ROOT_SEARCH_MULTIPLE_PATTERNS,
+            (CHAR *)SearchRequest,
+            SIZEOF_DEBUGGER_SEARCH_MULTIPLE_PATTERNS))
+    {
+        return FALSE;
+    }
+
+    //
+    // Wait until the result of the search is received
+    //
+    DbgWaitForKernelResponse(DEBUGGER_SYNCRONIZATION_OBJECT_KERNEL_DEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT);
+
+    return TRUE;
+}
+
+/**
+ * @brief Sends a branch trace ('!track lbr' command) packet to the debuggee
+ * @param BranchTraceRequest
+ * @param BranchTraceResult buffer to store the request and the records after it
+ * @param BranchTraceResultSize
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+KdSendBranchTracePacketToDebuggee(PDEBUGGER_BRANCH_TRACE_REQUEST BranchTraceRequest,
+                                  PDEBUGGER_BRANCH_TRACE_REQUEST BranchTraceResult,
+                                  UINT32                         BranchTraceResultSize)
+{
+    //
+    // Set the request data
+    //
+    DbgWaitSetRequestData(DEBUGGER_SYNCRONIZATION_OBJECT_KERNEL_DEBUGGER_BRANCH_TRACE_RESULT, BranchTraceResult, BranchTraceResultSize);
+
+    //
+    // Send the branch trace request packet
+    //
+    if (!KdCommandPacketAndBufferToDebuggee(
+            DEBUGGER_REMOTE_PACKET_TYPE_DEBUGGER_TO_DEBUGGEE_EXECUTE_ON_VMX_ROOT,
+            DEBUGGER_REMOTE_PACKET_REQUESTED_ACTION_ON_VMX_ROOT_BRANCH_TRACE,
+            (CHAR *)BranchTraceRequest,
+            SIZEOF_DEBUGGER_BRANCH_TRACE_REQUEST))
+    {
+        return FALSE;
+    }
+
+    //
+    // Wait until the result of the request is received
+    //
+    DbgWaitForKernelResponse(DEBUGGER_SYNCRONIZATION_OBJECT_KERNEL_DEBUGGER_BRANCH_TRACE_RESULT);
+
+    return TRUE;
+}
+
 /**
  * @brief Sends p (step out) and t (step in) packet to the debuggee
  *
@@ -3166,9 +3342,14 @@ KdHandleUserInputInDebuggee(DEBUGGEE_USER_INPUT_PACKET * Descriptor)
     Input = (CHAR *)Descriptor + sizeof(DEBUGGEE_USER_INPUT_PACKET);
 
     //
-    // Run the command
+    // Run the command, the results are coalesced and sent before the
+    // finished signal
     //
-    HyperDbgInterpreter(Input);
+    {
+        ShowMessagesCoalescingScope CoalescingScope;
+
+        HyperDbgInterpreter(Input);
+    }
 
     //
     // Check if it needs to send a signal to indicate that the execution of
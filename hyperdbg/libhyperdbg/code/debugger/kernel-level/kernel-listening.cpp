@@ -25,6 +25,7 @@ extern BOOLEAN                          g_IsSerialConnectedToRemoteDebuggee;
 extern BOOLEAN                          g_IsDebuggeeRunning;
 extern BOOLEAN                          g_IgnoreNewLoggingMessages;
 extern BOOLEAN                          g_SharedEventStatus;
+extern UINT64                           g_SharedEventSuppressedHits;
 extern BOOLEAN                          g_IsRunningInstruction32Bit;
 extern BOOLEAN                          g_OutputSourcesInitialized;
 extern ULONG                            g_CurrentRemoteCore;
@@ -78,6 +79,9 @@ ListeningSerialPortInDebugger()
     PDEBUGGEE_PCITREE_REQUEST_RESPONSE_PACKET    PcitreePacket;
     PINTERRUPT_DESCRIPTOR_TABLE_ENTRIES_PACKETS  IdtEntryRequestPacket;
     PDEBUGGEE_PCIDEVINFO_REQUEST_RESPONSE_PACKET PcidevinfoPacket;
+    PDEBUGGEE_BATCH_PACKET                       BatchPacket;
+    PDEBUGGER_SEARCH_MULTIPLE_PATTERNS           SearchMultiplePatternsPacket;
+    PDEBUGGER_BRANCH_TRACE_REQUEST               BranchTracePacket;
 
 StartAgain:
 
@@ -301,6 +305,12 @@ StartAgain:
 
                 break;
 
+            case DEBUGGEE_PAUSING_REASON_DEBUGGEE_BRANCH_TRACE_FINISHED:
+
+                ShowMessages("tracing the branches is finished\n");
+
+                break;
+
             default:
                 break;
             }
@@ -393,6 +403,15 @@ StartAgain:
 
                 break;
 
+            case DEBUGGEE_PAUSING_REASON_DEBUGGEE_BRANCH_TRACE_FINISHED:
+
+                //
+                // Unpause the debugger to read the records of the branches
+                //
+                DbgReceivedKernelResponse(DEBUGGER_SYNCRONIZATION_OBJECT_KERNEL_DEBUGGER_IS_DEBUGGER_RUNNING);
+
+                break;
+
             case DEBUGGEE_PAUSING_REASON_PAUSE:
 
                 //
@@ -496,22 +515,85 @@ StartAgain:
 
             SearchResultsPacket = (DEBUGGEE_RESULT_OF_SEARCH_PACKET *)(((CHAR *)TheActualPacket) + sizeof(DEBUGGER_REMOTE_PACKET));
 
-            if (SearchResultsPacket->Result == DEBUGGER_OPERATION_WAS_SUCCESSFUL)
+            //
+            // Get the address and size of the caller
+            //
+            DbgWaitGetRequestData(DEBUGGER_SYNCRONIZATION_OBJECT_KERNEL_DEBUGGER_SEARCH_QUERY_RESULT, &CallerAddress, &CallerSize);
+
+            //
+            // Copy the result of the search (slice) for the caller, the results
+            // themselves are shown by the debuggee, and the caller shows the
+            // errors (or whether nothing is found)
+            //
+            if (CallerAddress != NULL)
+            {
+                memcpy(CallerAddress, SearchResultsPacket, sizeof(DEBUGGEE_RESULT_OF_SEARCH_PACKET));
+            }
+
+            //
+            // Signal the event relating to receiving result of search query
+            //
+            DbgReceivedKernelResponse(DEBUGGER_SYNCRONIZATION_OBJECT_KERNEL_DEBUGGER_SEARCH_QUERY_RESULT);
+
+            break;
+
+        case DEBUGGER_REMOTE_PACKET_REQUESTED_ACTION_DEBUGGEE_RESULT_OF_SEARCH_MULTIPLE_PATTERNS:
+
+            SearchMultiplePatternsPacket = (DEBUGGER_SEARCH_MULTIPLE_PATTERNS *)(((CHAR *)TheActualPacket) + sizeof(DEBUGGER_REMOTE_PACKET));
+
+            //
+            // Get the address and size of the caller
+            //
+            DbgWaitGetRequestData(DEBUGGER_SYNCRONIZATION_OBJECT_KERNEL_DEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT, &CallerAddress, &CallerSize);
+
+            //
+            // Copy the request and the results for the caller (the size
+            // differs based on the number of results)
+            //
+            if (LengthReceived > sizeof(DEBUGGER_REMOTE_PACKET))
             {
-                if (SearchResultsPacket->CountOfResults == 0)
+                if (CallerSize > LengthReceived - sizeof(DEBUGGER_REMOTE_PACKET))
                 {
-                    ShowMessages("not found\n");
+                    CallerSize = LengthReceived - sizeof(DEBUGGER_REMOTE_PACKET);
                 }
+
+                memcpy(CallerAddress, SearchMultiplePatternsPacket, CallerSize);
             }
-            else
+
+            //
+            // Signal the event relating to receiving result of the search
+            //
+            DbgReceivedKernelResponse(DEBUGGER_SYNCRONIZATION_OBJECT_KERNEL_DEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT);
+
+            break;
+
+        case DEBUGGER_REMOTE_PACKET_REQUESTED_ACTION_DEBUGGEE_RESULT_OF_BRANCH_TRACE:
+
+            BranchTracePacket = (DEBUGGER_BRANCH_TRACE_REQUEST *)(((CHAR *)TheActualPacket) + sizeof(DEBUGGER_REMOTE_PACKET));
+
+            //
+            // Get the address and size of the caller
+            //
+            DbgWaitGetRequestData(DEBUGGER_SYNCRONIZATION_OBJECT_KERNEL_DEBUGGER_BRANCH_TRACE_RESULT, &CallerAddress, &CallerSize);
+
+            //
+            // Copy the request and the records for the caller (the size
+            // differs based on the number of records)
+            //
+            if (LengthReceived > sizeof(DEBUGGER_REMOTE_PACKET))
             {
-                ShowErrorMessage(SearchResultsPacket->Result);
+                if (CallerSize > LengthReceived - sizeof(DEBUGGER_REMOTE_PACKET))
+                {
+                    CallerSize = LengthReceived - sizeof(DEBUGGER_REMOTE_PACKET);
+                }
+
+                memcpy(CallerAddress, BranchTracePacket, CallerSize);
             }
 
             //
-            // Signal the event relating to receiving result of search query
+            // Signal the event relating to receiving result of the branch trace
             //
-            DbgReceivedKernelResponse(DEBUGGER_SYNCRONIZATION_OBJECT_KERNEL_DEBUGGER_SEARCH_QUERY_RESULT);
+            DbgReceivedKernelResponse(DEBUGGER_SYNCRONIZATION_OBJECT_KERNEL_DEBUGGER_BRANCH_TRACE_RESULT);
 
             break;
 
@@ -736,7 +818,16 @@ StartAgain:
             //
             // Set the result of query
             //
-            if (EventModifyAndQueryPacket->KernelStatus != DEBUGGER_OPERATION_WAS_SUCCESSFUL)
+            if (EventModifyAndQueryPacket->TypeOfAction == DEBUGGER_MODIFY_EVENTS_QUERY_SUPPRESSED_HITS)
+            {
+                //
+                // The caller interprets the errors (e.g., querying the cores until
+                // an invalid core is reached)
+                //
+                g_SharedEventStatus         = EventModifyAndQueryPacket->KernelStatus == DEBUGGER_OPERATION_WAS_SUCCESSFUL;
+                g_SharedEventSuppressedHits = EventModifyAndQueryPacket->SuppressedHits;
+            }
+            else if (EventModifyAndQueryPacket->KernelStatus != DEBUGGER_OPERATION_WAS_SUCCESSFUL)
             {
                 //
                 // There was an error
@@ -877,6 +968,36 @@ StartAgain:
 
             break;
 
+        case DEBUGGER_REMOTE_PACKET_REQUESTED_ACTION_DEBUGGEE_RESULT_OF_BATCH_OPERATIONS:
+
+            BatchPacket = (DEBUGGEE_BATCH_PACKET *)(((CHAR *)TheActualPacket) + sizeof(DEBUGGER_REMOTE_PACKET));
+
+            //
+            // Get the address and size of the caller
+            //
+            DbgWaitGetRequestData(DEBUGGER_SYNCRONIZATION_OBJECT_KERNEL_DEBUGGER_BATCH_OPERATIONS, &CallerAddress, &CallerSize);
+
+            //
+            // Copy the result of the operations for the caller (the size of
+            // the result differs based on the operations)
+            //
+            if (LengthReceived > sizeof(DEBUGGER_REMOTE_PACKET))
+            {
+                if (CallerSize > LengthReceived - sizeof(DEBUGGER_REMOTE_PACKET))
+                {
+                    CallerSize = LengthReceived - sizeof(DEBUGGER_REMOTE_PACKET);
+                }
+
+                memcpy(CallerAddress, BatchPacket, CallerSize);
+            }
+
+            //
+            // Signal the event relating to receiving result of batch operations
+            //
+            DbgReceivedKernelResponse(DEBUGGER_SYNCRONIZATION_OBJECT_KERNEL_DEBUGGER_BATCH_OPERATIONS);
+
+            break;
+
         case DEBUGGER_REMOTE_PACKET_REQUESTED_ACTION_DEBUGGEE_RESULT_OF_READING_MEMORY:
 
             ReadMemoryPacket = (DEBUGGER_READ_MEMORY *)(((CHAR *)TheActualPacket) + sizeof(DEBUGGER_REMOTE_PACKET));
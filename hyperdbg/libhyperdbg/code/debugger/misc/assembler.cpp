@@ -11,6 +11,158 @@
  */
 #include "pch.h"
 
+//
+// Global Variables
+//
+extern std::map<UINT64, ks_engine *> g_AssemblerEngines;
+extern ASSEMBLER_CACHED_RESULT       g_AssemblerLastResult;
+extern std::map<std::string, UINT64> g_AssemblerBatchLabels;
+extern SRWLOCK                       g_AssemblerLock;
+
+/**
+ * @brief Resolve the symbols that are not defined in the assembly code
+ * @details called by Keystone (while holding the assembler lock), the
+ * labels of the other statements of a batch are resolved first
+ *
+ * @param Symbol
+ * @param Value
+ *
+ * @return bool
+ */
+static bool
+AssemblerResolveSymbol(const char * Symbol, uint64_t * Value)
+{
+    UINT64 Address = 0;
+
+    auto Label = g_AssemblerBatchLabels.find(Symbol);
+
+    if (Label != g_AssemblerBatchLabels.end())
+    {
+        *Value = Label->second;
+        return true;
+    }
+
+    if (!SymbolConvertNameOrExprToAddress(std::string(Symbol), &Address))
+    {
+        return false;
+    }
+
+    *Value = Address;
+
+    return true;
+}
+
+/**
+ * @brief Get the key of the cached Keystone engine of an architecture,
+ * mode and syntax
+ *
+ * @param Arch
+ * @param Mode
+ * @param Syntax
+ *
+ * @return UINT64
+ */
+static UINT64
+AssemblerGetEngineKey(ks_arch Arch, INT Mode, INT Syntax)
+{
+    return ((UINT64)(UINT32)Mode << 32) | ((UINT64)Arch << 16) | (UINT16)Syntax;
+}
+
+/**
+ * @brief Get the cached Keystone engine of an architecture, mode and
+ * syntax (the engine is created the first time)
+ * @details should be called while holding the assembler lock
+ *
+ * @param Arch
+ * @param Mode
+ * @param Syntax
+ * @param KsErr
+ *
+ * @return ks_engine * NULL if the engine could not be created
+ */
+static ks_engine *
+AssemblerGetEngine(ks_arch Arch, INT Mode, INT Syntax, ks_err * KsErr)
+{
+    ks_engine * Ks;
+    UINT64      EngineKey = AssemblerGetEngineKey(Arch, Mode, Syntax);
+
+    auto Engine = g_AssemblerEngines.find(EngineKey);
+
+    if (Engine != g_AssemblerEngines.end())
+    {
+        *KsErr = KS_ERR_OK;
+        return Engine->second;
+    }
+
+    *KsErr = ks_open(Arch, Mode, &Ks);
+
+    if (*KsErr != KS_ERR_OK)
+    {
+        ShowMessages("err, failed on ks_open()");
+        return NULL;
+    }
+
+    if (Syntax)
+    {
+        *KsErr = ks_option(Ks, KS_OPT_SYNTAX, Syntax);
+        if (*KsErr != KS_ERR_OK)
+        {
+            ShowMessages("err, failed on ks_option() with error code = %u\n", *KsErr);
+        }
+    }
+
+    //
+    // Symbols are mostly parsed before passing asm code ('<symbol>'), the
+    // resolver is used for the other undefined symbols
+    //
+    *KsErr = ks_option(Ks, KS_OPT_SYM_RESOLVER, (size_t)AssemblerResolveSymbol);
+    if (*KsErr != KS_ERR_OK)
+    {
+        ShowMessages("err, failed on ks_option() with error code = %u\n", *KsErr);
+    }
+
+    g_AssemblerEngines[EngineKey] = Ks;
+
+    *KsErr = KS_ERR_OK;
+
+    return Ks;
+}
+
+/**
+ * @brief Assemble a code with a Keystone engine
+ * @details should be called while holding the assembler lock
+ *
+ * @param Ks
+ * @param Code
+ * @param StartAddr
+ * @param Bytes
+ * @param StatementCount
+ *
+ * @return ks_err
+ */
+static ks_err
+AssemblerAssembleWithEngine(ks_engine *                  Ks,
+                            const std::string &          Code,
+                            UINT64                       StartAddr,
+                            std::vector<unsigned char> & Bytes,
+                            size_t *                     StatementCount)
+{
+    unsigned char * Encoding = NULL;
+    size_t          Size     = 0;
+
+    Bytes.clear();
+
+    if (ks_asm(Ks, Code.c_str(), StartAddr, &Encoding, &Size, StatementCount))
+    {
+        return ks_errno(Ks);
+    }
+
+    Bytes.assign(Encoding, Encoding + Size);
+    ks_free(Encoding);
+
+    return KS_ERR_OK;
+}
+
 /**
  * @brief tries to solve the symbol issue with Keystone, which apparently originates from LLVM-MC.
  *
@@ -27,9 +179,9 @@ AssembleData::ParseAssemblyData()
     RawAsm.erase(std::remove(RawAsm.begin(), RawAsm.end(), '\n'), RawAsm.end());
 
     //
-    // remove multiple spaces
+    // remove multiple spaces (the pattern is compiled once)
     //
-    std::regex MultipleSpaces(" +");
+    static const std::regex MultipleSpaces(" +");
     RawAsm = std::regex_replace(RawAsm, MultipleSpaces, " ");
 
     //
@@ -89,6 +241,42 @@ AssembleData::ParseAssemblyData()
         }
     }
 
+    //
+    // Keep the statements (and the labels that are defined at their start)
+    // for the batch assembly
+    //
+    static const std::regex LabelDefinition("^\\s*([A-Za-z_.$?@][A-Za-z0-9_.$?@]*)\\s*:(?!:)");
+
+    AsmStatements.clear();
+    AsmStatementLabels.clear();
+
+    for (auto & InstructionLine : AssemblyInstructions)
+    {
+        std::vector<std::string> Labels;
+        std::smatch              Match;
+        std::string              Remaining = InstructionLine;
+
+        if (InstructionLine.find_first_not_of(" \t") == std::string::npos)
+        {
+            continue;
+        }
+
+        while (std::regex_search(Remaining, Match, LabelDefinition))
+        {
+            Labels.push_back(Match[1].str());
+            Remaining = Match.suffix().str();
+        }
+
+        AsmStatements.push_back(InstructionLine);
+        AsmStatementLabels.push_back(Labels);
+    }
+
+    if (AssemblyInstructions.empty())
+    {
+        AsmFixed.clear();
+        return;
+    }
+
     //
     // Append ";" between two std::strings
     //
@@ -115,39 +303,66 @@ AssembleData::ParseAssemblyData()
     }
 }
 
+/**
+ * @brief Assemble the code with the cached Keystone engine
+ * @details the result is reused if the same code is assembled again
+ * at the same address (e.g., querying the length and then assembling)
+ *
+ * @param StartAddr
+ * @param Arch
+ * @param Mode
+ * @param Syntax
+ *
+ * @return INT 0 if it was successful
+ */
 INT
 AssembleData::Assemble(UINT64 StartAddr, ks_arch Arch, INT Mode, INT Syntax)
 {
     ks_engine * Ks;
+    UINT64      EngineKey = AssemblerGetEngineKey(Arch, Mode, Syntax);
 
-    KsErr = ks_open(Arch, Mode, &Ks);
-    if (KsErr != KS_ERR_OK)
+    AcquireSRWLockExclusive(&g_AssemblerLock);
+
+    if (g_AssemblerLastResult.IsValid &&
+        g_AssemblerLastResult.EngineKey == EngineKey &&
+        g_AssemblerLastResult.StartAddress == StartAddr &&
+        g_AssemblerLastResult.Code == AsmFixed)
     {
-        ShowMessages("err, failed on ks_open()");
-        return -1;
+        EncodedBytesBuffer = g_AssemblerLastResult.Bytes;
+        StatementCount     = g_AssemblerLastResult.StatementCount;
+        KsErr              = KS_ERR_OK;
     }
-
-    if (Syntax)
+    else
     {
-        KsErr = ks_option(Ks, KS_OPT_SYNTAX, Syntax);
-        if (KsErr != KS_ERR_OK)
+        Ks = AssemblerGetEngine(Arch, Mode, Syntax, &KsErr);
+
+        if (Ks == NULL)
         {
-            ShowMessages("err, failed on ks_option() with error code = %u\n", KsErr);
+            ReleaseSRWLockExclusive(&g_AssemblerLock);
+            return -1;
         }
-    }
 
-    //
-    // as long as symbols are parsed before passing asm code, SymResolver is not needed, for now.
-    //
-    KsErr = ks_option(Ks, KS_OPT_SYM_RESOLVER, 0); // null SymResolver
-    if (KsErr != KS_ERR_OK)
-    {
-        ShowMessages("err, failed on ks_option() with error code = %u\n", KsErr);
+        KsErr = AssemblerAssembleWithEngine(Ks, AsmFixed, StartAddr, EncodedBytesBuffer, &StatementCount);
+
+        g_AssemblerLastResult.IsValid = KsErr == KS_ERR_OK;
+
+        if (g_AssemblerLastResult.IsValid)
+        {
+            g_AssemblerLastResult.EngineKey      = EngineKey;
+            g_AssemblerLastResult.StartAddress   = StartAddr;
+            g_AssemblerLastResult.Code           = AsmFixed;
+            g_AssemblerLastResult.Bytes          = EncodedBytesBuffer;
+            g_AssemblerLastResult.StatementCount = StatementCount;
+        }
     }
 
-    if (ks_asm(Ks, AsmFixed.c_str(), StartAddr, &EncodedBytes, &BytesCount, &StatementCount))
+    ReleaseSRWLockExclusive(&g_AssemblerLock);
+
+    EncodedBytes = EncodedBytesBuffer.data();
+    BytesCount   = EncodedBytesBuffer.size();
+
+    if (KsErr != KS_ERR_OK)
     {
-        KsErr = ks_errno(Ks);
         ShowMessages("err, failed on ks_asm() with count = %lu, error code = %u\n", (int)StatementCount, KsErr);
     }
     else
@@ -169,14 +384,141 @@ AssembleData::Assemble(UINT64 StartAddr, ks_arch Arch, INT Mode, INT Syntax)
             }
             ShowMessages("\n");
 
-            ks_close(Ks);
             return 0;
         }
     }
-    ks_close(Ks);
+
     return -1;
 }
 
+/**
+ * @brief Assemble each statement right after the previous statement
+ * @details all of the statements are assembled by the cached Keystone
+ * engine while holding the lock once, the labels of the other statements
+ * are resolved from their addresses in the previous pass, and the
+ * statements are assembled again until the addresses of the labels
+ * don't change (e.g., a forward jump becomes a near jump)
+ *
+ * @param StartAddr
+ * @param Statements offset and length of each statement
+ * @param Arch
+ * @param Mode
+ * @param Syntax
+ *
+ * @return INT 0 if it was successful
+ */
+INT
+AssembleData::AssembleStatements(UINT64                                    StartAddr,
+                                 std::vector<ASSEMBLER_STATEMENT_RESULT> & Statements,
+                                 ks_arch                                   Arch,
+                                 INT                                       Mode,
+                                 INT                                       Syntax)
+{
+    ks_engine *                Ks;
+    std::vector<unsigned char> StatementBytes;
+    size_t                     Count          = 0;
+    INT                        Result         = 0;
+    BOOLEAN                    IsLabelChanged = TRUE;
+    UINT64                     StatementAddress;
+
+    Statements.clear();
+    EncodedBytesBuffer.clear();
+    StatementCount = 0;
+
+    AcquireSRWLockExclusive(&g_AssemblerLock);
+
+    Ks = AssemblerGetEngine(Arch, Mode, Syntax, &KsErr);
+
+    //
+    // The labels are at the start address until their statement is assembled
+    //
+    g_AssemblerBatchLabels.clear();
+
+    for (auto & Labels : AsmStatementLabels)
+    {
+        for (auto & Label : Labels)
+        {
+            g_AssemblerBatchLabels[Label] = StartAddr;
+        }
+    }
+
+    for (UINT32 Pass = 0; Ks != NULL && Result == 0 && IsLabelChanged; Pass++)
+    {
+        if (Pass == ASSEMBLER_MAXIMUM_LABEL_PASSES)
+        {
+            ShowMessages("err, the addresses of the labels don't converge\n");
+            Result = -1;
+            break;
+        }
+
+        IsLabelChanged = FALSE;
+
+        Statements.clear();
+        EncodedBytesBuffer.clear();
+        StatementCount = 0;
+
+        for (size_t i = 0; i < AsmStatements.size(); i++)
+        {
+            StatementAddress = StartAddr + EncodedBytesBuffer.size();
+
+            for (auto & Label : AsmStatementLabels[i])
+            {
+                if (g_AssemblerBatchLabels[Label] != StatementAddress)
+                {
+                    g_AssemblerBatchLabels[Label] = StatementAddress;
+                    IsLabelChanged                = TRUE;
+                }
+            }
+
+            KsErr = AssemblerAssembleWithEngine(Ks,
+                                                AsmStatements[i],
+                                                StatementAddress,
+                                                StatementBytes,
+                                                &Count);
+
+            if (KsErr != KS_ERR_OK)
+            {
+                ShowMessages("err, failed to assemble statement %llu ('%s') with error code = %u\n",
+                             (UINT64)i,
+                             AsmStatements[i].c_str(),
+                             KsErr);
+                Result = -1;
+                break;
+            }
+
+            Statements.push_back({(UINT32)EncodedBytesBuffer.size(), (UINT32)StatementBytes.size()});
+            EncodedBytesBuffer.insert(EncodedBytesBuffer.end(), StatementBytes.begin(), StatementBytes.end());
+            StatementCount += Count;
+        }
+    }
+
+    g_AssemblerBatchLabels.clear();
+
+    ReleaseSRWLockExclusive(&g_AssemblerLock);
+
+    EncodedBytes = EncodedBytesBuffer.data();
+    BytesCount   = EncodedBytesBuffer.size();
+
+    return Ks == NULL ? -1 : Result;
+}
+
+/**
+ * @brief Invalidate the last assembled code
+ * @details called when the symbols are loaded or unloaded, as the symbols
+ * of the code might be resolved to other addresses
+ *
+ * @return VOID
+ */
+VOID
+AssemblerInvalidateCachedResult()
+{
+    AcquireSRWLockExclusive(&g_AssemblerLock);
+
+    g_AssemblerLastResult.IsValid = FALSE;
+
+    ReleaseSRWLockExclusive(&g_AssemblerLock);
+}
+
 AssembleData *
 create_AssembleData()
 {
@@ -262,3 +604,84 @@ HyperDbgAssemble(const CHAR * AssemblyCode, UINT64 StartAddress, PVOID BufferToS
         return TRUE;
     }
 }
+
+/**
+ * @brief Assemble multiple statements in one pass
+ * @details statements are separated by ';' or new lines, and each
+ * statement is assembled right after the previous statement
+ *
+ * @param AssemblyCode The assembly code
+ * @param StartAddress The start address of the assembly code
+ * @param BufferToStoreAssembledData The buffer to store the assembled data
+ * @param BufferSize The size of the buffer
+ * @param StatementOffsets The offset of each statement in the assembled data (optional)
+ * @param StatementLengths The length of each statement (optional)
+ * @param MaximumStatements The number of entries of offsets and lengths
+ * @param NumberOfStatements The number of statements (to be returned)
+ * @param Length The length of the assembled data (to be returned)
+ *
+ * @return BOOLEAN Returns true if it was successful, the number of statements and
+ * the length are also returned if the buffers are too small
+ */
+BOOLEAN
+HyperDbgAssembleBatch(const CHAR * AssemblyCode,
+                      UINT64       StartAddress,
+                      PVOID        BufferToStoreAssembledData,
+                      UINT32       BufferSize,
+                      UINT32 *     StatementOffsets,
+                      UINT32 *     StatementLengths,
+                      UINT32       MaximumStatements,
+                      UINT32 *     NumberOfStatements,
+                      UINT32 *     Length)
+{
+    AssembleData                            AssembleData;
+    std::vector<ASSEMBLER_STATEMENT_RESULT> Statements;
+
+    *NumberOfStatements = 0;
+    *Length             = 0;
+
+    //
+    // New lines also separate the statements
+    //
+    std::string AsmCode = AssemblyCode;
+    std::replace(AsmCode.begin(), AsmCode.end(), '\r', ';');
+    std::replace(AsmCode.begin(), AsmCode.end(), '\n', ';');
+
+    AssembleData.AsmRaw = AsmCode;
+    AssembleData.ParseAssemblyData();
+
+    if (AssembleData.AsmStatements.empty() ||
+        AssembleData.AssembleStatements(StartAddress, Statements))
+    {
+        return FALSE;
+    }
+
+    *NumberOfStatements = (UINT32)Statements.size();
+    *Length             = (UINT32)AssembleData.BytesCount;
+
+    if (AssembleData.BytesCount > BufferSize ||
+        ((StatementOffsets != NULL || StatementLengths != NULL) && Statements.size() > MaximumStatements))
+    {
+        return FALSE;
+    }
+
+    for (size_t i = 0; i < Statements.size(); i++)
+    {
+        if (StatementOffsets != NULL)
+        {
+            StatementOffsets[i] = Statements[i].Offset;
+        }
+
+        if (StatementLengths != NULL)
+        {
+            StatementLengths[i] = Statements[i].Length;
+        }
+    }
+
+    //
+    // Copy the assembled data to the buffer
+    //
+    memcpy(BufferToStoreAssembledData, AssembleData.EncodedBytes, AssembleData.BytesCount);
+
+    return TRUE;
+}
@@ -0,0 +1,277 @@
+/**
+ * @file branch-trace.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Decoding the branch records and building the coverage
+ * @details The kernel sends the raw values of the last branch records
+ * (LBR), the addresses and the flags are decoded here based on the format
+ * of the records of the debuggee's processor
+ * @version 0.11
+ * @date 2024-11-08
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Sign-extend the address of a branch record from bit 47
+ *
+ * @param Address
+ *
+ * @return UINT64
+ */
+static UINT64
+BranchTraceSignExtendAddress(UINT64 Address)
+{
+    return (UINT64)(((INT64)(Address << 16)) >> 16);
+}
+
+/**
+ * @brief Check whether the format of the records has the mispredicted flag
+ * @details the formats with LBR_INFO have the flag in a separate MSR which
+ * is not read by the kernel
+ *
+ * @param LbrFormat
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+BranchTraceIsMispredictionFlagSupported(UINT32 LbrFormat)
+{
+    return LbrFormat == BRANCH_TRACE_LBR_FORMAT_64BIT_EIP_FLAGS ||
+           LbrFormat == BRANCH_TRACE_LBR_FORMAT_64BIT_EIP_FLAGS_TSX ||
+           LbrFormat == BRANCH_TRACE_LBR_FORMAT_64BIT_EIP_FLAGS_CYCLES;
+}
+
+/**
+ * @brief Decode a branch record based on the format of the records
+ *
+ * @param LbrFormat
+ * @param Record The raw record
+ * @param DecodedRecord
+ *
+ * @return VOID
+ */
+VOID
+BranchTraceDecodeRecord(UINT32                        LbrFormat,
+                        PDEBUGGER_BRANCH_TRACE_RECORD Record,
+                        PBRANCH_TRACE_DECODED_RECORD  DecodedRecord)
+{
+    RtlZeroMemory(DecodedRecord, sizeof(BRANCH_TRACE_DECODED_RECORD));
+
+    DecodedRecord->Type   = Record->Type;
+    DecodedRecord->CoreId = Record->CoreId;
+    DecodedRecord->Flags  = Record->Flags;
+
+    switch (LbrFormat)
+    {
+    case BRANCH_TRACE_LBR_FORMAT_32BIT:
+
+        DecodedRecord->From = Record->From & 0xffffffff;
+        DecodedRecord->To   = Record->To & 0xffffffff;
+
+        break;
+
+    case BRANCH_TRACE_LBR_FORMAT_64BIT_EIP_FLAGS:
+
+        DecodedRecord->IsMispredicted = (Record->From >> 63) & 1;
+
+        DecodedRecord->From = BranchTraceSignExtendAddress(Record->From);
+        DecodedRecord->To   = BranchTraceSignExtendAddress(Record->To);
+
+        break;
+
+    case BRANCH_TRACE_LBR_FORMAT_64BIT_EIP_FLAGS_TSX:
+
+        DecodedRecord->IsMispredicted = (Record->From >> 63) & 1;
+        DecodedRecord->IsInTsx        = (Record->From >> 62) & 1;
+        DecodedRecord->IsTsxAbort     = (Record->From >> 61) & 1;
+
+        DecodedRecord->From = BranchTraceSignExtendAddress(Record->From);
+        DecodedRecord->To   = BranchTraceSignExtendAddress(Record->To);
+
+        break;
+
+    case BRANCH_TRACE_LBR_FORMAT_64BIT_EIP_FLAGS_CYCLES:
+
+        //
+        // The cycles are in the upper bits of the destination
+        //
+        DecodedRecord->IsMispredicted = (Record->From >> 63) & 1;
+        DecodedRecord->Cycles         = (UINT16)(Record->To >> 48);
+
+        DecodedRecord->From = BranchTraceSignExtendAddress(Record->From);
+        DecodedRecord->To   = BranchTraceSignExtendAddress(Record->To);
+
+        break;
+
+    default:
+
+        //
+        // The addresses without flags (the flags of the formats with
+        // LBR_INFO are not in the FROM and TO MSRs)
+        //
+        DecodedRecord->From = BranchTraceSignExtendAddress(Record->From);
+        DecodedRecord->To   = BranchTraceSignExtendAddress(Record->To);
+
+        break;
+    }
+}
+
+/**
+ * @brief Decode the branch records and add them to the decoded records
+ *
+ * @param LbrFormat
+ * @param Records
+ * @param NumberOfRecords
+ * @param DecodedRecords
+ *
+ * @return VOID
+ */
+VOID
+BranchTraceDecodeRecords(UINT32                                     LbrFormat,
+                         PDEBUGGER_BRANCH_TRACE_RECORD              Records,
+                         UINT32                                     NumberOfRecords,
+                         std::vector<BRANCH_TRACE_DECODED_RECORD> & DecodedRecords)
+{
+    BRANCH_TRACE_DECODED_RECORD DecodedRecord;
+
+    for (UINT32 i = 0; i < NumberOfRecords; i++)
+    {
+        BranchTraceDecodeRecord(LbrFormat, &Records[i], &DecodedRecord);
+        DecodedRecords.push_back(DecodedRecord);
+    }
+}
+
+/**
+ * @brief Get the location of an address in the edge bitmap
+ * @details the address is hashed as the basic blocks are not assigned
+ * random ids (unlike the AFL instrumentation)
+ *
+ * @param Address
+ *
+ * @return UINT32
+ */
+UINT32
+BranchTraceGetBitmapLocation(UINT64 Address)
+{
+    Address ^= Address >> 33;
+    Address *= 0xff51afd7ed558ccdULL;
+    Address ^= Address >> 33;
+
+    return (UINT32)(Address & (BRANCH_TRACE_COVERAGE_BITMAP_SIZE - 1));
+}
+
+/**
+ * @brief Check whether some branches might be missed before the record
+ *
+ * @param Record
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+BranchTraceIsAfterGap(const BRANCH_TRACE_DECODED_RECORD & Record)
+{
+    return (Record.Flags & (DEBUGGER_BRANCH_TRACE_RECORD_FLAG_BRANCHES_LOST |
+                            DEBUGGER_BRANCH_TRACE_RECORD_FLAG_THREAD_RESUMED)) != 0;
+}
+
+/**
+ * @brief Build the coverage of the decoded records
+ * @details the previous coverage is removed
+ *
+ * @param DecodedRecords
+ * @param Coverage
+ *
+ * @return VOID
+ */
+VOID
+BranchTraceBuildCoverage(const std::vector<BRANCH_TRACE_DECODED_RECORD> & DecodedRecords,
+                         PBRANCH_TRACE_COVERAGE                           Coverage)
+{
+    UINT32 PreviousLocation = 0;
+    UINT32 CurrentLocation;
+
+    Coverage->BasicBlocks.clear();
+    Coverage->Edges.clear();
+    Coverage->Bitmap.assign(BRANCH_TRACE_COVERAGE_BITMAP_SIZE, 0);
+    Coverage->NumberOfMispredictedBranches = 0;
+    Coverage->NumberOfDiscontinuities      = 0;
+    Coverage->NumberOfGaps                 = 0;
+
+    for (size_t i = 0; i < DecodedRecords.size(); i++)
+    {
+        const BRANCH_TRACE_DECODED_RECORD & Record = DecodedRecords[i];
+
+        Coverage->Edges[std::make_pair(Record.From, Record.To)]++;
+
+        if (Record.IsMispredicted)
+        {
+            Coverage->NumberOfMispredictedBranches++;
+        }
+
+        //
+        // The previous branch is not executed right before this one (e.g.,
+        // the thread was switched out), so the edge starts from nowhere
+        //
+        if (BranchTraceIsAfterGap(Record))
+        {
+            Coverage->NumberOfGaps++;
+            PreviousLocation = 0;
+        }
+
+        //
+        // The destination of the branch is the start of a basic block (the
+        // counter saturates at 0xff)
+        //
+        CurrentLocation = BranchTraceGetBitmapLocation(Record.To);
+
+        if (Coverage->Bitmap[CurrentLocation ^ PreviousLocation] != 0xff)
+        {
+            Coverage->Bitmap[CurrentLocation ^ PreviousLocation]++;
+        }
+
+        PreviousLocation = CurrentLocation >> 1;
+
+        //
+        // The basic block ends at the source of the next branch
+        //
+        if (i + 1 < DecodedRecords.size() && !BranchTraceIsAfterGap(DecodedRecords[i + 1]))
+        {
+            UINT64 Start = Record.To;
+            UINT64 End   = DecodedRecords[i + 1].From;
+
+            if (End >= Start && End - Start <= BRANCH_TRACE_MAXIMUM_BASIC_BLOCK_SIZE)
+            {
+                Coverage->BasicBlocks[std::make_pair(Start, End)]++;
+            }
+            else
+            {
+                Coverage->NumberOfDiscontinuities++;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Get the number of non-zero entries of the edge bitmap
+ *
+ * @param Coverage
+ *
+ * @return UINT32
+ */
+UINT32
+BranchTraceGetNumberOfCoveredBitmapEntries(PBRANCH_TRACE_COVERAGE Coverage)
+{
+    UINT32 Count = 0;
+
+    for (BYTE Entry : Coverage->Bitmap)
+    {
+        if (Entry != 0)
+        {
+            Count++;
+        }
+    }
+
+    return Count;
+}
@@ -0,0 +1,207 @@
+/**
+ * @file profiler.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Aggregating the samples of the profiler
+ * @details The samples are counted based on their raw addresses and only
+ * the unique addresses are converted to the functions (when showing
+ * the results)
+ * @version 0.11
+ * @date 2024-11-01
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+/**
+ * @brief Add the samples to the aggregated samples
+ *
+ * @param Aggregated
+ * @param Samples
+ * @param NumberOfSamples
+ *
+ * @return VOID
+ */
+VOID
+ProfilerAggregateSamples(PPROFILER_AGGREGATED_SAMPLES Aggregated,
+                         PDEBUGGER_PROFILER_SAMPLE    Samples,
+                         UINT32                       NumberOfSamples)
+{
+    std::vector<UINT64> Stack;
+
+    for (UINT32 i = 0; i < NumberOfSamples; i++)
+    {
+        PDEBUGGER_PROFILER_SAMPLE Sample    = &Samples[i];
+        UINT32                    ProcessId = Sample->IsUserMode ? Sample->ProcessId : 0;
+        UINT32                    Depth     = Sample->StackDepth;
+
+        if (Depth > MaximumProfilerStackDepth)
+        {
+            Depth = MaximumProfilerStackDepth;
+        }
+
+        Aggregated->Locations[std::make_pair(ProcessId, Sample->Rip)]++;
+        Aggregated->Processes[Sample->ProcessId]++;
+
+        //
+        // The stack key starts with the process id and the RIP
+        //
+        Stack.clear();
+        Stack.push_back(ProcessId);
+        Stack.push_back(Sample->Rip);
+        Stack.insert(Stack.end(), Sample->Stack, Sample->Stack + Depth);
+
+        Aggregated->Stacks[Stack]++;
+    }
+
+    Aggregated->NumberOfSamples += NumberOfSamples;
+}
+
+/**
+ * @brief Update the counters of a core
+ * @details the counters are reported by the kernel cumulatively
+ *
+ * @param Aggregated
+ * @param CoreId
+ * @param TotalSamples
+ * @param DroppedSamples
+ *
+ * @return VOID
+ */
+VOID
+ProfilerAggregateCoreCounters(PPROFILER_AGGREGATED_SAMPLES Aggregated,
+                              UINT32                       CoreId,
+                              UINT64                       TotalSamples,
+                              UINT64                       DroppedSamples)
+{
+    Aggregated->TotalSamplesOfCores[CoreId]   = TotalSamples;
+    Aggregated->DroppedSamplesOfCores[CoreId] = DroppedSamples;
+}
+
+/**
+ * @brief Remove all of the aggregated samples
+ *
+ * @param Aggregated
+ *
+ * @return VOID
+ */
+VOID
+ProfilerClearAggregatedSamples(PPROFILER_AGGREGATED_SAMPLES Aggregated)
+{
+    Aggregated->Locations.clear();
+    Aggregated->Stacks.clear();
+    Aggregated->Processes.clear();
+    Aggregated->TotalSamplesOfCores.clear();
+    Aggregated->DroppedSamplesOfCores.clear();
+    Aggregated->NumberOfSamples = 0;
+}
+
+/**
+ * @brief Get the name of the function that contains the address
+ * @details the same distance as the disassembler is used for the
+ * functions, if not found, the address is returned
+ *
+ * @param SymbolMap
+ * @param Address
+ *
+ * @return std::string
+ */
+std::string
+ProfilerGetFunctionName(const std::map<UINT64, LOCAL_FUNCTION_DESCRIPTION> & SymbolMap, UINT64 Address)
+{
+    CHAR AddressString[0x20] = {0};
+
+    auto Upper = SymbolMap.upper_bound(Address);
+
+    if (Upper != SymbolMap.begin())
+    {
+        auto Prev = std::prev(Upper);
+
+        if (Address - Prev->first <= DISASSEMBLY_MAXIMUM_DISTANCE_FROM_OBJECT_NAME)
+        {
+            return Prev->second.ObjectName;
+        }
+    }
+
+    sprintf_s(AddressString, sizeof(AddressString), "%016llx", Address);
+
+    return std::string(AddressString);
+}
+
+/**
+ * @brief Fold the aggregated locations and stacks to the functions
+ * @details each unique address is only converted once, the results are
+ * sorted based on the self samples
+ *
+ * @param Aggregated
+ * @param SymbolMap
+ *
+ * @return std::vector<PROFILER_FUNCTION_SAMPLES>
+ */
+std::vector<PROFILER_FUNCTION_SAMPLES>
+ProfilerFoldToFunctions(PPROFILER_AGGREGATED_SAMPLES                         Aggregated,
+                        const std::map<UINT64, LOCAL_FUNCTION_DESCRIPTION> & SymbolMap)
+{
+    std::map<UINT64, std::string>                    Names;
+    std::map<std::string, PROFILER_FUNCTION_SAMPLES> Functions;
+    std::unordered_set<std::string>                  SeenInStack;
+    std::vector<PROFILER_FUNCTION_SAMPLES>           Result;
+
+    auto GetName = [&](UINT64 Address) -> const std::string & {
+        auto Iterate = Names.find(Address);
+
+        if (Iterate == Names.end())
+        {
+            Iterate = Names.emplace(Address, ProfilerGetFunctionName(SymbolMap, Address)).first;
+        }
+
+        return Iterate->second;
+    };
+
+    auto GetFunction = [&](const std::string & Name) -> PROFILER_FUNCTION_SAMPLES & {
+        PROFILER_FUNCTION_SAMPLES & Function = Functions[Name];
+        Function.Name                        = Name;
+        return Function;
+    };
+
+    //
+    // Self samples (RIP of the samples)
+    //
+    for (const auto & Location : Aggregated->Locations)
+    {
+        GetFunction(GetName(Location.first.second)).SelfSamples += Location.second;
+    }
+
+    //
+    // Inclusive samples (each function is counted once for each stack)
+    //
+    for (const auto & Stack : Aggregated->Stacks)
+    {
+        SeenInStack.clear();
+
+        for (size_t i = 1; i < Stack.first.size(); i++)
+        {
+            const std::string & Name = GetName(Stack.first[i]);
+
+            if (SeenInStack.insert(Name).second)
+            {
+                GetFunction(Name).InclusiveSamples += Stack.second;
+            }
+        }
+    }
+
+    for (const auto & Function : Functions)
+    {
+        Result.push_back(Function.second);
+    }
+
+    std::sort(Result.begin(), Result.end(), [](const PROFILER_FUNCTION_SAMPLES & A, const PROFILER_FUNCTION_SAMPLES & B) {
+        if (A.SelfSamples != B.SelfSamples)
+        {
+            return A.SelfSamples > B.SelfSamples;
+        }
+        return A.InclusiveSamples > B.InclusiveSamples;
+    });
+
+    return Result;
+}
@@ -417,60 +417,14 @@ HyperDbgShowMemoryOrDisassemble(DEBUGGER_SHOW_MEMORY_STYLE   Style,
 void
 ShowMemoryCommandDB(unsigned char * OutputBuffer, UINT32 Size, UINT64 Address, DEBUGGER_READ_MEMORY_TYPE MemoryType, UINT64 Length)
 {
-    unsigned int Character;
+    HEX_DUMP_OPTIONS Options = {0};
 
-    for (UINT32 i = 0; i < Size; i += 16)
-    {
-        if (MemoryType == DEBUGGER_READ_PHYSICAL_ADDRESS)
-        {
-            ShowMessages("#\t");
-        }
-
-        //
-        // Print address
-        //
-        ShowMessages("%s  ", SeparateTo64BitValue((UINT64)(Address + i)).c_str());
-
-        //
-        // Print the hex code
-        //
-        for (size_t j = 0; j < 16; j++)
-        {
-            //
-            // check to see if the address is valid or not
-            //
-            if (i + j >= Length)
-            {
-                ShowMessages("?? ");
-            }
-            else
-            {
-                ShowMessages("%02X ", OutputBuffer[i + j]);
-            }
-        }
-
-        //
-        // Print the character
-        //
-        ShowMessages(" ");
-        for (size_t j = 0; j < 16; j++)
-        {
-            Character = (OutputBuffer[i + j]);
-            if (isprint(Character))
-            {
-                ShowMessages("%c", Character);
-            }
-            else
-            {
-                ShowMessages(".");
-            }
-        }
+    Options.ElementSize    = 1;
+    Options.UpperCase      = TRUE;
+    Options.ShowAscii      = TRUE;
+    Options.PhysicalPrefix = MemoryType == DEBUGGER_READ_PHYSICAL_ADDRESS;
 
-        //
-        // Go to new line
-        //
-        ShowMessages("\n");
-    }
+    HexDumpShow(&Options, OutputBuffer, Size, Length, Address);
 }
 
 /**
@@ -485,61 +439,14 @@ ShowMemoryCommandDB(unsigned char * OutputBuffer, UINT32 Size, UINT64 Address, D
 void
 ShowMemoryCommandDC(unsigned char * OutputBuffer, UINT32 Size, UINT64 Address, DEBUGGER_READ_MEMORY_TYPE MemoryType, UINT64 Length)
 {
-    unsigned int Character;
-    for (UINT32 i = 0; i < Size; i += 16)
-    {
-        if (MemoryType == DEBUGGER_READ_PHYSICAL_ADDRESS)
-        {
-            ShowMessages("#\t");
-        }
-
-        //
-        // Print address
-        //
-        ShowMessages("%s  ", SeparateTo64BitValue((UINT64)(Address + i)).c_str());
+    HEX_DUMP_OPTIONS Options = {0};
 
-        //
-        // Print the hex code
-        //
-        for (size_t j = 0; j < 16; j += 4)
-        {
-            //
-            // check to see if the address is valid or not
-            //
-            if (i + j >= Length)
-            {
-                ShowMessages("???????? ");
-            }
-            else
-            {
-                UINT32 OutputBufferVar = *((UINT32 *)&OutputBuffer[i + j]);
-                ShowMessages("%08X ", OutputBufferVar);
-            }
-        }
-
-        //
-        // Print the character
-        //
+    Options.ElementSize    = 4;
+    Options.UpperCase      = TRUE;
+    Options.ShowAscii      = TRUE;
+    Options.PhysicalPrefix = MemoryType == DEBUGGER_READ_PHYSICAL_ADDRESS;
 
-        ShowMessages(" ");
-        for (size_t j = 0; j < 16; j++)
-        {
-            Character = (OutputBuffer[i + j]);
-            if (isprint(Character))
-            {
-                ShowMessages("%c", Character);
-            }
-            else
-            {
-                ShowMessages(".");
-            }
-        }
-
-        //
-        // Go to new line
-        //
-        ShowMessages("\n");
-    }
+    HexDumpShow(&Options, OutputBuffer, Size, Length, Address);
 }
 
 /**
@@ -554,41 +461,14 @@ ShowMemoryCommandDC(unsigned char * OutputBuffer, UINT32 Size, UINT64 Address, D
 void
 ShowMemoryCommandDD(unsigned char * OutputBuffer, UINT32 Size, UINT64 Address, DEBUGGER_READ_MEMORY_TYPE MemoryType, UINT64 Length)
 {
-    for (UINT32 i = 0; i < Size; i += 16)
-    {
-        if (MemoryType == DEBUGGER_READ_PHYSICAL_ADDRESS)
-        {
-            ShowMessages("#\t");
-        }
+    HEX_DUMP_OPTIONS Options = {0};
 
-        //
-        // Print address
-        //
-        ShowMessages("%s  ", SeparateTo64BitValue((UINT64)(Address + i)).c_str());
+    Options.ElementSize    = 4;
+    Options.UpperCase      = TRUE;
+    Options.ShowAscii      = FALSE;
+    Options.PhysicalPrefix = MemoryType == DEBUGGER_READ_PHYSICAL_ADDRESS;
 
-        //
-        // Print the hex code
-        //
-        for (size_t j = 0; j < 16; j += 4)
-        {
-            //
-            // check to see if the address is valid or not
-            //
-            if (i + j >= Length)
-            {
-                ShowMessages("???????? ");
-            }
-            else
-            {
-                UINT32 OutputBufferVar = *((UINT32 *)&OutputBuffer[i + j]);
-                ShowMessages("%08X ", OutputBufferVar);
-            }
-        }
-        //
-        // Go to new line
-        //
-        ShowMessages("\n");
-    }
+    HexDumpShow(&Options, OutputBuffer, Size, Length, Address);
 }
 
 /**
@@ -603,43 +483,12 @@ ShowMemoryCommandDD(unsigned char * OutputBuffer, UINT32 Size, UINT64 Address, D
 void
 ShowMemoryCommandDQ(unsigned char * OutputBuffer, UINT32 Size, UINT64 Address, DEBUGGER_READ_MEMORY_TYPE MemoryType, UINT64 Length)
 {
-    for (UINT32 i = 0; i < Size; i += 16)
-    {
-        if (MemoryType == DEBUGGER_READ_PHYSICAL_ADDRESS)
-        {
-            ShowMessages("#\t");
-        }
+    HEX_DUMP_OPTIONS Options = {0};
 
-        //
-        // Print address
-        //
-        ShowMessages("%s  ", SeparateTo64BitValue((UINT64)(Address + i)).c_str());
+    Options.ElementSize    = 8;
+    Options.UpperCase      = TRUE;
+    Options.ShowAscii      = FALSE;
+    Options.PhysicalPrefix = MemoryType == DEBUGGER_READ_PHYSICAL_ADDRESS;
 
-        //
-        // Print the hex code
-        //
-        for (size_t j = 0; j < 16; j += 8)
-        {
-            //
-            // check to see if the address is valid or not
-            //
-            if (i + j >= Length)
-            {
-                ShowMessages("???????? ");
-            }
-            else
-            {
-                UINT32 OutputBufferVar = *((UINT32 *)&OutputBuffer[i + j + 4]);
-                ShowMessages("%08X`", OutputBufferVar);
-
-                OutputBufferVar = *((UINT32 *)&OutputBuffer[i + j]);
-                ShowMessages("%08X ", OutputBufferVar);
-            }
-        }
-
-        //
-        // Go to new line
-        //
-        ShowMessages("\n");
-    }
+    HexDumpShow(&Options, OutputBuffer, Size, Length, Address);
 }
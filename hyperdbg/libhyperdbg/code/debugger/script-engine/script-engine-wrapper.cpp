@@ -68,7 +68,14 @@ ScriptEngineConvertNameToAddressWrapper(const char * FunctionOrVariableName, PBO
 UINT32
 ScriptEngineLoadFileSymbolWrapper(UINT64 BaseAddress, const char * PdbFileName, const char * CustomModuleName)
 {
-    return ScriptEngineLoadFileSymbol(BaseAddress, PdbFileName, CustomModuleName);
+    UINT32 Result = ScriptEngineLoadFileSymbol(BaseAddress, PdbFileName, CustomModuleName);
+
+    //
+    // The symbols of the last assembled code might be changed
+    //
+    AssemblerInvalidateCachedResult();
+
+    return Result;
 }
 
 /**
@@ -92,7 +99,14 @@ ScriptEngineSetTextMessageCallbackWrapper(PVOID Handler)
 UINT32
 ScriptEngineUnloadAllSymbolsWrapper()
 {
-    return ScriptEngineUnloadAllSymbols();
+    UINT32 Result = ScriptEngineUnloadAllSymbols();
+
+    //
+    // The symbols of the last assembled code might be changed
+    //
+    AssemblerInvalidateCachedResult();
+
+    return Result;
 }
 
 /**
@@ -104,7 +118,14 @@ ScriptEngineUnloadAllSymbolsWrapper()
 UINT32
 ScriptEngineUnloadModuleSymbolWrapper(char * ModuleName)
 {
-    return ScriptEngineUnloadModuleSymbol(ModuleName);
+    UINT32 Result = ScriptEngineUnloadModuleSymbol(ModuleName);
+
+    //
+    // The symbols of the last assembled code might be changed
+    //
+    AssemblerInvalidateCachedResult();
+
+    return Result;
 }
 
 /**
@@ -196,7 +217,14 @@ ScriptEngineSymbolInitLoadWrapper(PMODULE_SYMBOL_DETAIL BufferToStoreDetails,
                                   const char *          SymbolPath,
                                   BOOLEAN               IsSilentLoad)
 {
-    return ScriptEngineSymbolInitLoad(BufferToStoreDetails, StoredLength, DownloadIfAvailable, SymbolPath, IsSilentLoad);
+    BOOLEAN Result = ScriptEngineSymbolInitLoad(BufferToStoreDetails, StoredLength, DownloadIfAvailable, SymbolPath, IsSilentLoad);
+
+    //
+    // The symbols of the last assembled code might be changed
+    //
+    AssemblerInvalidateCachedResult();
+
+    return Result;
 }
 
 /**
@@ -253,6 +281,33 @@ ScriptEngineConvertFileToPdbFileAndGuidAndAgeDetailsWrapper(const char * LocalFi
     return ScriptEngineConvertFileToPdbFileAndGuidAndAgeDetails(LocalFilePath, PdbFilePath, GuidAndAgeDetails, Is32BitModule);
 }
 
+/**
+ * @brief ScriptEngineGetPeImageDetails wrapper
+ *
+ * @param FilePath
+ * @param ImageDetails
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+ScriptEngineGetPeImageDetailsWrapper(const WCHAR * FilePath, PPE_IMAGE_DETAILS ImageDetails)
+{
+    return ScriptEngineGetPeImageDetails(FilePath, ImageDetails);
+}
+
+/**
+ * @brief ScriptEngineReleasePeImageDetails wrapper
+ *
+ * @param ImageDetails
+ *
+ * @return VOID
+ */
+VOID
+ScriptEngineReleasePeImageDetailsWrapper(PPE_IMAGE_DETAILS ImageDetails)
+{
+    ScriptEngineReleasePeImageDetails(ImageDetails);
+}
+
 //
 // *********************** Function links (wrapper) ***********************
 //
@@ -292,6 +347,254 @@ ScriptEngineParseWrapper(char * Expr, BOOLEAN ShowErrorMessageIfAny)
     }
 }
 
+/**
+ * @brief ScriptEngineLoadCompiledScript wrapper
+ *
+ * @param CompiledScript
+ * @param CompiledScriptSize
+ * @param ShowErrorMessageIfAny
+ *
+ * @return PVOID
+ */
+PVOID
+ScriptEngineLoadCompiledScriptWrapper(PVOID CompiledScript, UINT32 CompiledScriptSize, BOOLEAN ShowErrorMessageIfAny)
+{
+    PSYMBOL_BUFFER SymbolBuffer;
+    SymbolBuffer = (PSYMBOL_BUFFER)ScriptEngineLoadCompiledScript(CompiledScript, CompiledScriptSize);
+
+    if (SymbolBuffer == NULL)
+    {
+        return NULL;
+    }
+
+    //
+    // Check if there is an error or not
+    //
+    if (SymbolBuffer->Message == NULL)
+    {
+        return SymbolBuffer;
+    }
+    else
+    {
+        //
+        // Show error message and free the buffer
+        //
+        if (ShowErrorMessageIfAny)
+        {
+            ShowMessages("%s\n", SymbolBuffer->Message);
+        }
+        ScriptEngineWrapperRemoveSymbolBuffer(SymbolBuffer);
+        return NULL;
+    }
+}
+
+/**
+ * @brief Compile a script and save it as a relocatable compiled script
+ *
+ * @param Expr
+ * @param CompiledScript
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+ScriptEngineCompileToBufferWrapper(char * Expr, std::vector<CHAR> & CompiledScript)
+{
+    PVOID  CodeBuffer;
+    PVOID  Image     = NULL;
+    UINT32 ImageSize = 0;
+
+    CodeBuffer = ScriptEngineParseWrapper(Expr, TRUE);
+
+    if (CodeBuffer == NULL)
+    {
+        return FALSE;
+    }
+
+    if (!ScriptEngineSerializeCompiledScript(CodeBuffer, &Image, &ImageSize))
+    {
+        ShowMessages("err, unable to serialize the compiled script\n");
+        ScriptEngineWrapperRemoveSymbolBuffer(CodeBuffer);
+        return FALSE;
+    }
+
+    CompiledScript.assign((CHAR *)Image, (CHAR *)Image + ImageSize);
+
+    ScriptEngineFreeCompiledScript(Image);
+    ScriptEngineWrapperRemoveSymbolBuffer(CodeBuffer);
+
+    return TRUE;
+}
+
+/**
+ * @brief Base of the test module of the compiled scripts
+ *
+ */
+static UINT64 g_CompiledScriptTestModuleBase;
+
+/**
+ * @brief Resolve the names of the test module of the compiled scripts
+ * @details the offset of the names is after their last '_' (in hex), e.g.,
+ * 'testmod!func_1230' is at 0x1230 from the base of the test module
+ *
+ * @param Name
+ * @param WasFound
+ *
+ * @return UINT64
+ */
+static UINT64
+ScriptEngineWrapperTestModuleConvertNameToAddress(const char * Name, PBOOLEAN WasFound)
+{
+    const char * Offset = strrchr(Name, '_');
+
+    *WasFound = _strnicmp(Name, SCRIPT_ENGINE_TEST_MODULE_NAME "!", strlen(SCRIPT_ENGINE_TEST_MODULE_NAME "!")) == 0 &&
+                Offset != NULL;
+
+    return *WasFound ? g_CompiledScriptTestModuleBase + strtoull(Offset + 1, NULL, 16) : NULL;
+}
+
+/**
+ * @brief Get the base of the test module of the compiled scripts
+ *
+ * @param ModuleName
+ * @param WasFound
+ *
+ * @return UINT64
+ */
+static UINT64
+ScriptEngineWrapperTestModuleGetBaseAddress(const char * ModuleName, PBOOLEAN WasFound)
+{
+    *WasFound = _stricmp(ModuleName, SCRIPT_ENGINE_TEST_MODULE_NAME) == 0;
+
+    return *WasFound ? g_CompiledScriptTestModuleBase : NULL;
+}
+
+/**
+ * @brief Resolve the names of the test module of the compiled scripts
+ * instead of the symbols
+ *
+ * @param Base Base of the test module or NULL to use the symbols again
+ *
+ * @return VOID
+ */
+VOID
+ScriptEngineWrapperSetTestModuleBase(UINT64 Base)
+{
+    g_CompiledScriptTestModuleBase = Base;
+
+    if (Base != NULL)
+    {
+        ScriptEngineSetSymbolAddressCallbacks((PVOID)ScriptEngineWrapperTestModuleConvertNameToAddress,
+                                              (PVOID)ScriptEngineWrapperTestModuleGetBaseAddress);
+    }
+    else
+    {
+        ScriptEngineSetSymbolAddressCallbacks(NULL, NULL);
+    }
+}
+
+/**
+ * @brief Check whether a script remains the same after it's serialized
+ * and loaded again while the test module is moved to another base
+ * @details the names of the test module are resolved by
+ * ScriptEngineWrapperTestModuleConvertNameToAddress
+ *
+ * @param Expr
+ * @param ParseBase Base of the test module while parsing the script
+ * @param LoadBase Base of the test module while loading the compiled script
+ * @param NumberOfRelocations Number of the relocated addresses (optional)
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+ScriptEngineWrapperTestCompiledScriptRoundTrip(const string & Expr, UINT64 ParseBase, UINT64 LoadBase, UINT32 * NumberOfRelocations)
+{
+    PSYMBOL_BUFFER      CodeBuffer;
+    PSYMBOL_BUFFER      LoadedCodeBuffer;
+    std::vector<SYMBOL> ExpectedSymbols;
+    PVOID               Image     = NULL;
+    UINT32              ImageSize = 0;
+    UINT32              Count     = 0;
+    UINT64              Type;
+    BOOLEAN             Result    = FALSE;
+
+    ScriptEngineWrapperSetTestModuleBase(ParseBase);
+
+    CodeBuffer = (PSYMBOL_BUFFER)ScriptEngineParse((char *)Expr.c_str());
+
+    if (CodeBuffer->Message != NULL)
+    {
+        //
+        // Nothing to compare for the scripts with syntax errors
+        //
+        ScriptEngineWrapperSetTestModuleBase(NULL);
+        ScriptEngineWrapperRemoveSymbolBuffer(CodeBuffer);
+
+        if (NumberOfRelocations != NULL)
+        {
+            *NumberOfRelocations = 0;
+        }
+
+        return TRUE;
+    }
+
+    //
+    // Only the numbers that are resolved from the names are moved to the
+    // new base, and they don't keep their relocation after loading
+    //
+    ExpectedSymbols.assign(CodeBuffer->Head, CodeBuffer->Head + CodeBuffer->Pointer);
+
+    for (UINT32 i = 0; i < ExpectedSymbols.size();)
+    {
+        //
+        // The arguments of printf keep the position of their format in the
+        // high bits of the type
+        //
+        Type = ExpectedSymbols[i].Type & 0x7fffffff;
+
+        if (Type == SYMBOL_STRING_TYPE || Type == SYMBOL_WSTRING_TYPE)
+        {
+            i += (UINT32)((SIZE_SYMBOL_WITHOUT_LEN + ExpectedSymbols[i].Len) / sizeof(SYMBOL)) + 1;
+            continue;
+        }
+
+        if (Type == SYMBOL_NUM_TYPE && ExpectedSymbols[i].Len != 0)
+        {
+            ExpectedSymbols[i].Value = ExpectedSymbols[i].Value - ParseBase + LoadBase;
+            ExpectedSymbols[i].Len   = 0;
+            Count++;
+        }
+
+        i++;
+    }
+
+    if (ScriptEngineSerializeCompiledScript(CodeBuffer, &Image, &ImageSize))
+    {
+        ScriptEngineWrapperSetTestModuleBase(LoadBase);
+
+        LoadedCodeBuffer = (PSYMBOL_BUFFER)ScriptEngineLoadCompiledScriptWrapper(Image, ImageSize, TRUE);
+
+        if (LoadedCodeBuffer != NULL)
+        {
+            Result = LoadedCodeBuffer->Pointer == CodeBuffer->Pointer &&
+                     memcmp(LoadedCodeBuffer->Head, ExpectedSymbols.data(), CodeBuffer->Pointer * sizeof(SYMBOL)) == 0;
+
+            ScriptEngineWrapperRemoveSymbolBuffer(LoadedCodeBuffer);
+        }
+
+        ScriptEngineFreeCompiledScript(Image);
+    }
+
+    ScriptEngineWrapperSetTestModuleBase(NULL);
+    ScriptEngineWrapperRemoveSymbolBuffer(CodeBuffer);
+
+    if (NumberOfRelocations != NULL)
+    {
+        *NumberOfRelocations = Count;
+    }
+
+    return Result;
+}
+
 /**
  * @brief PrintSymbolBuffer wrapper
  * @details Print symbol buffer wrapper
@@ -492,6 +795,79 @@ ScriptAutomaticStatementsTestWrapper(const string & Expr, UINT64 ExpectationValu
     return FALSE;
 }
 
+/**
+ * @brief Check whether a statement has the same result with the operand-specialized
+ * operators and with the generic operators
+ * @param Expr The expression to test
+ *
+ * @return BOOLEAN whether the results are the same or not
+ */
+BOOLEAN
+ScriptEngineWrapperTestOperatorSpecialization(const string & Expr)
+{
+    UINT64  GenericResult;
+    BOOLEAN GenericResultHasError;
+
+    //
+    // Evaluate the generic form (the reference)
+    //
+    g_CurrentExprEvalResult         = 0;
+    g_CurrentExprEvalResultHasError = FALSE;
+
+    ScriptEngineSetOperatorSpecialization(FALSE);
+    ScriptEngineWrapperTestParser(Expr);
+    ScriptEngineSetOperatorSpecialization(TRUE);
+
+    GenericResult         = g_CurrentExprEvalResult;
+    GenericResultHasError = g_CurrentExprEvalResultHasError;
+
+    //
+    // Evaluate the specialized form
+    //
+    g_CurrentExprEvalResult         = 0;
+    g_CurrentExprEvalResultHasError = FALSE;
+
+    ScriptEngineWrapperTestParser(Expr);
+
+    return GenericResult == g_CurrentExprEvalResult &&
+           GenericResultHasError == g_CurrentExprEvalResultHasError;
+}
+
+/**
+ * @brief Execute a parsed script (in user-mode) and count the executed operators
+ * @param SymbolBuffer The parsed script
+ * @param NumberOfOperators The number of executed operators is added to it
+ *
+ * @return BOOLEAN whether the script is executed without errors or not
+ */
+BOOLEAN
+ScriptEngineWrapperTestExecute(PVOID SymbolBuffer, UINT64 * NumberOfOperators)
+{
+    PSYMBOL_BUFFER                  CodeBuffer             = (PSYMBOL_BUFFER)SymbolBuffer;
+    GUEST_REGS                      GuestRegs              = {0};
+    ACTION_BUFFER                   ActionBuffer           = {0};
+    SYMBOL                          ErrorSymbol            = {0};
+    SCRIPT_ENGINE_GENERAL_REGISTERS ScriptGeneralRegisters = {0};
+    std::vector<UINT64>             StackBuffer(MAX_STACK_BUFFER_COUNT, 0);
+    std::vector<UINT64>             GlobalVariables(MAX_VAR_COUNT, 0);
+
+    ScriptGeneralRegisters.StackBuffer         = StackBuffer.data();
+    ScriptGeneralRegisters.GlobalVariablesList = GlobalVariables.data();
+
+    for (UINT64 i = 0; i < CodeBuffer->Pointer;)
+    {
+        if (ScriptEngineExecute(&GuestRegs, &ActionBuffer, &ScriptGeneralRegisters, CodeBuffer, &i, &ErrorSymbol) ||
+            ScriptGeneralRegisters.StackIndx >= MAX_STACK_BUFFER_COUNT)
+        {
+            return FALSE;
+        }
+
+        (*NumberOfOperators)++;
+    }
+
+    return TRUE;
+}
+
 /**
  * @brief allocate memory and build structure for casting
  * @param AllocationsForCastings Memory details for future deallocations
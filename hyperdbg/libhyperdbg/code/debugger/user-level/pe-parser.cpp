@@ -22,45 +22,7 @@
 VOID
 PeHexDump(CHAR * Ptr, int Size, int SecAddress)
 {
-    int i = 1, Temp = 0;
-
-    //
-    // Buffer to store the character dump displayed at the
-    // right side
-    //
-    wchar_t Buf[18];
-    ShowMessages("\n\n%x: |", SecAddress);
-
-    Buf[Temp]      = ' '; // initial space
-    Buf[Temp + 16] = ' '; // final space
-    Buf[Temp + 17] = 0;   // End of Buf
-    Temp++;               // Temp = 1;
-
-    for (; i <= Size; i++, Ptr++, Temp++)
-    {
-        Buf[Temp] = !iswcntrl((*Ptr) & 0xff) ? (*Ptr) & 0xff : '.';
-        ShowMessages("%-3.2x", (*Ptr) & 0xff);
-
-        if (i % 16 == 0)
-        {
-            //
-            // print the character dump to the right
-            //
-            _putws(Buf);
-            if (i + 1 <= Size)
-                ShowMessages("%x: ", SecAddress += 16);
-            Temp = 0;
-        }
-        if (i % 4 == 0)
-            ShowMessages("| ");
-    }
-    if (i % 16 != 0)
-    {
-        Buf[Temp] = 0;
-        for (; i % 16 != 0; i++)
-            ShowMessages("%-3.2c", ' ');
-        _putws(Buf);
-    }
+    HexDumpShowSection((const UCHAR *)Ptr, Size, (UINT32)SecAddress);
 }
 
 /**
@@ -75,7 +37,7 @@ BOOLEAN
 PeShowSectionInformationAndDump(const WCHAR * AddressOfFile, const CHAR * SectionToShow, BOOLEAN Is32Bit)
 {
     BOOLEAN                 Result = FALSE;
-    HANDLE                  MapObjectHandle, FileHandle; // File Mapping Object
+    PE_IMAGE_DETAILS        ImageDetails;                // Details of the cached image
     UINT32                  NumberOfSections;            // Number of sections
     LPVOID                  BaseAddr;                    // Pointer to the base memory of mapped file
     PIMAGE_DOS_HEADER       DosHeader;                   // Pointer to DOS Header
@@ -87,34 +49,16 @@ PeShowSectionInformationAndDump(const WCHAR * AddressOfFile, const CHAR * Sectio
     PIMAGE_SECTION_HEADER   SecHeader;                   // Section Header or Section Table Header
 
     //
-    // Open the EXE File
+    // Get the mapped (and already parsed) file from the symbol parser,
+    // the image is pinned (so the cache won't unmap it) until it's released
     //
-    FileHandle = CreateFileW(AddressOfFile, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (FileHandle == INVALID_HANDLE_VALUE)
+    if (!ScriptEngineGetPeImageDetailsWrapper(AddressOfFile, &ImageDetails))
     {
         ShowMessages("err, could not open the file specified\n");
         return FALSE;
-    };
-
-    //
-    // Mapping Given EXE file to Memory
-    //
-    MapObjectHandle =
-        CreateFileMapping(FileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
-
-    if (MapObjectHandle == NULL)
-    {
-        CloseHandle(FileHandle);
-        return FALSE;
     }
 
-    BaseAddr = MapViewOfFile(MapObjectHandle, FILE_MAP_READ, 0, 0, 0);
-
-    if (BaseAddr == NULL)
-    {
-        CloseHandle(FileHandle);
-        return FALSE;
-    }
+    BaseAddr = ImageDetails.MappedBase;
 
     //
     // Get the DOS Header Base
@@ -434,7 +378,8 @@ PeShowSectionInformationAndDump(const WCHAR * AddressOfFile, const CHAR * Sectio
         {
             if (!_strcmpi(SectionToShow, (const char *)SecHeader->Name))
             {
-                if (SecHeader->SizeOfRawData != 0)
+                if (SecHeader->SizeOfRawData != 0 &&
+                    (UINT64)SecHeader->PointerToRawData + SecHeader->SizeOfRawData <= ImageDetails.FileSize)
                 {
                     if (Is32Bit)
                     {
@@ -462,11 +407,11 @@ PeShowSectionInformationAndDump(const WCHAR * AddressOfFile, const CHAR * Sectio
     Result = TRUE;
 
 Finished:
+
     //
-    // Unmap and close the handles
+    // The mapped view is not used anymore
     //
-    UnmapViewOfFile(BaseAddr);
-    CloseHandle(MapObjectHandle);
+    ScriptEngineReleasePeImageDetailsWrapper(&ImageDetails);
 
     return Result;
 }
@@ -481,124 +426,37 @@ Finished:
 BOOLEAN
 PeIsPE32BitOr64Bit(const WCHAR * AddressOfFile, PBOOLEAN Is32Bit)
 {
-    BOOLEAN                 Result = FALSE;
-    HANDLE                  MapObjectHandle, FileHandle; // File Mapping Object
-    LPVOID                  BaseAddr;                    // Pointer to the base memory of mapped file
-    PIMAGE_DOS_HEADER       DosHeader;                   // Pointer to DOS Header
-    PIMAGE_NT_HEADERS32     NtHeader32 = NULL;           // Pointer to NT Header 32 bit
-    IMAGE_OPTIONAL_HEADER32 OpHeader32;                  // Optional Header of PE files present in NT Header structure
-    IMAGE_FILE_HEADER       Header;                      // Pointer to image file header of NT Header
+    PE_IMAGE_DETAILS ImageDetails;
 
     //
-    // Open the EXE File
+    // The headers are parsed (and cached) by the symbol parser
     //
-    FileHandle = CreateFileW(AddressOfFile, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (FileHandle == INVALID_HANDLE_VALUE)
+    if (!ScriptEngineGetPeImageDetailsWrapper(AddressOfFile, &ImageDetails))
     {
-        ShowMessages("err, unable to read the file (%x)\n", GetLastError());
+        ShowMessages("err, unable to read the file or the selected file is not in a valid PE format\n");
         return FALSE;
-    };
-
-    //
-    // Mapping Given EXE file to Memory
-    //
-    MapObjectHandle =
-        CreateFileMapping(FileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
-
-    if (MapObjectHandle == NULL)
-    {
-        CloseHandle(FileHandle);
-
-        ShowMessages("err, unable to create file mappings (%x)\n", GetLastError());
-        return FALSE;
-    }
-
-    BaseAddr = MapViewOfFile(MapObjectHandle, FILE_MAP_READ, 0, 0, 0);
-
-    if (BaseAddr == NULL)
-    {
-        CloseHandle(FileHandle);
-
-        ShowMessages("err, unable to create map view of file (%x)\n", GetLastError());
-        return FALSE;
-    }
-
-    //
-    // Get the DOS Header Base
-    //
-    DosHeader = (PIMAGE_DOS_HEADER)BaseAddr; // 0x04000000
-
-    //
-    // Check for Valid DOS file
-    //
-    if (DosHeader->e_magic != IMAGE_DOS_SIGNATURE)
-    {
-        Result = FALSE;
-
-        ShowMessages("err, the selected file is not in a valid PE format\n");
-        goto Finished;
-    }
-
-    //
-    // Offset of NT Header is found at 0x3c location in DOS header specified by
-    // e_lfanew
-    // Get the Base of NT Header(PE Header) 	= DosHeader + RVA address of PE
-    // header
-    //
-
-    NtHeader32 = (PIMAGE_NT_HEADERS32)((UINT64)(DosHeader) + (DosHeader->e_lfanew));
-
-    //
-    // Identify for valid PE file
-    //
-    if (NtHeader32->Signature != IMAGE_NT_SIGNATURE)
-    {
-        Result = FALSE;
-
-        ShowMessages("err, invalid image NT signature\n");
-        goto Finished;
     }
 
     //
-    // Info about Optional Header
-    //
-    OpHeader32 = NtHeader32->OptionalHeader;
-
-    //
-    // Get the IMAGE FILE HEADER Structure
+    // Only the machine is needed, the mapped view is not used
     //
-    Header = NtHeader32->FileHeader;
+    ScriptEngineReleasePeImageDetailsWrapper(&ImageDetails);
 
     //
     // Only few are determined (for remaining refer
     // to the above specification)
     //
-    switch (Header.Machine)
+    switch (ImageDetails.Machine)
     {
     case IMAGE_FILE_MACHINE_I386:
         *Is32Bit = TRUE;
-        Result   = TRUE;
-        goto Finished;
-        break;
+        return TRUE;
     case IMAGE_FILE_MACHINE_AMD64:
         *Is32Bit = FALSE;
-        Result   = TRUE;
-        goto Finished;
-        break;
+        return TRUE;
     default:
         ShowMessages("err, PE file is not i386 or AMD64; thus, it's not supported "
                      "in HyperDbg\n");
-        Result = FALSE;
-        goto Finished;
-        break;
+        return FALSE;
     }
-
-Finished:
-    //
-    // Unmap and close the handles
-    //
-    UnmapViewOfFile(BaseAddr);
-    CloseHandle(MapObjectHandle);
-
-    return Result;
 }
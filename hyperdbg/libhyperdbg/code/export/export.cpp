@@ -10,13 +10,15 @@
  *
  */
 #include "pch.h"
+#include "../script-eval/header/ScriptEngineInternalHeader.h"
 
 //
 // Global Variables
 //
-extern TCHAR   g_DriverLocation[MAX_PATH];
-extern TCHAR   g_DriverName[MAX_PATH];
-extern BOOLEAN g_UseCustomDriverLocation;
+extern TCHAR                   g_DriverLocation[MAX_PATH];
+extern TCHAR                   g_DriverName[MAX_PATH];
+extern BOOLEAN                 g_UseCustomDriverLocation;
+extern ASSEMBLER_CACHED_RESULT g_AssemblerLastResult;
 
 /**
  * @brief Detects the support of VMX
@@ -139,6 +141,214 @@ hyperdbg_u_test_command_parser_show_tokens(CHAR * command)
     return HyperDbgTestCommandParserShowTokens(command);
 }
 
+/**
+ * @brief Evaluate a script statement in user-mode (used for testing purposes)
+ *
+ * @param expr The statement
+ * @param expected_value The expected result of the statement
+ * @param expect_error Whether the statement is expected to fail or not
+ *
+ * @return BOOLEAN returns true if the result is the expected result
+ */
+BOOLEAN
+hyperdbg_u_test_script_statement(const CHAR * expr, UINT64 expected_value, BOOLEAN expect_error)
+{
+    return ScriptAutomaticStatementsTestWrapper(expr, expected_value, expect_error);
+}
+
+/**
+ * @brief Compare the results of the operand-specialized and the generic
+ * operators for a statement (used for testing purposes)
+ *
+ * @param expr The statement
+ *
+ * @return BOOLEAN returns true if the results are the same
+ */
+BOOLEAN
+hyperdbg_u_test_script_operator_specialization(const CHAR * expr)
+{
+    return ScriptEngineWrapperTestOperatorSpecialization(expr);
+}
+
+/**
+ * @brief Compile, serialize, and load a script (used for testing purposes)
+ *
+ * @param expr The script
+ * @param parse_base Base of the test module while parsing the script
+ * @param load_base Base of the test module while loading the script
+ * @param number_of_relocations The number of relocated symbols
+ *
+ * @return BOOLEAN returns true if the loaded script is the same as the parsed script
+ */
+BOOLEAN
+hyperdbg_u_test_script_compiled_round_trip(const CHAR * expr, UINT64 parse_base, UINT64 load_base, UINT32 * number_of_relocations)
+{
+    return ScriptEngineWrapperTestCompiledScriptRoundTrip(expr, parse_base, load_base, number_of_relocations);
+}
+
+/**
+ * @brief Set the base of the test module of the script engine (used for testing purposes)
+ *
+ * @param base The base address or NULL to remove the test module
+ *
+ * @return VOID
+ */
+VOID
+hyperdbg_u_test_script_set_module_base(UINT64 base)
+{
+    ScriptEngineWrapperSetTestModuleBase(base);
+}
+
+/**
+ * @brief Execute a parsed script in user-mode (used for testing purposes)
+ *
+ * @param symbol_buffer The parsed script
+ * @param number_of_operators The number of executed operators is added to it
+ *
+ * @return BOOLEAN returns true if the script is executed without errors
+ */
+BOOLEAN
+hyperdbg_u_test_script_execute(PVOID symbol_buffer, UINT64 * number_of_operators)
+{
+    return ScriptEngineWrapperTestExecute(symbol_buffer, number_of_operators);
+}
+
+/**
+ * @brief Read a register in the script engine (used for testing purposes)
+ *
+ * @param guest_regs The registers
+ * @param snapshot The snapshot of the registers or NULL to read without the snapshot
+ * @param reg_id The register
+ *
+ * @return UINT64 The value of the register
+ */
+UINT64
+hyperdbg_u_test_script_get_register(GUEST_REGS * guest_regs, SCRIPT_ENGINE_REGISTERS_SNAPSHOT * snapshot, REGS_ENUM reg_id)
+{
+    if (snapshot == NULL)
+    {
+        return GetRegValue(guest_regs, reg_id);
+    }
+
+    return GetRegValueUsingSnapshot(guest_regs, snapshot, reg_id);
+}
+
+/**
+ * @brief Modify a register in the script engine (used for testing purposes)
+ *
+ * @param guest_regs The registers
+ * @param snapshot The snapshot of the registers or NULL to modify without the snapshot
+ * @param reg_id The register
+ * @param value The new value of the register
+ *
+ * @return BOOLEAN returns true if the register is modified
+ */
+BOOLEAN
+hyperdbg_u_test_script_set_register(GUEST_REGS * guest_regs, SCRIPT_ENGINE_REGISTERS_SNAPSHOT * snapshot, REGS_ENUM reg_id, UINT64 value)
+{
+    SYMBOL Symbol = {0};
+
+    if (snapshot == NULL)
+    {
+        return SetRegValue(guest_regs, reg_id, value);
+    }
+
+    Symbol.Type  = SYMBOL_REGISTER_TYPE;
+    Symbol.Value = reg_id;
+
+    return SetRegValueUsingSymbol(guest_regs, snapshot, &Symbol, value);
+}
+
+/**
+ * @brief Get the '$pname' pseudo-register in user-mode (used for testing purposes)
+ *
+ * @return CHAR * The name of the current process
+ */
+CHAR *
+hyperdbg_u_test_script_get_pname()
+{
+    return ScriptEnginePseudoRegGetPname();
+}
+
+/**
+ * @brief Get the '$peb' pseudo-register in user-mode (used for testing purposes)
+ *
+ * @return UINT64 The address of the PEB of the current process
+ */
+UINT64
+hyperdbg_u_test_script_get_peb()
+{
+    return ScriptEnginePseudoRegGetPeb();
+}
+
+/**
+ * @brief Compare a string with the '$pname' pseudo-register in user-mode
+ * (used for testing purposes)
+ *
+ * @param string The string
+ * @param is_pname_first Whether '$pname' is the first operand or not
+ *
+ * @return UINT64 The result of the comparison (same as strcmp)
+ */
+UINT64
+hyperdbg_u_test_script_compare_pname(const CHAR * string, BOOLEAN is_pname_first)
+{
+    return ScriptEnginePseudoRegComparePname(string, is_pname_first);
+}
+
+/**
+ * @brief Load the symbols of a PDB file (used for testing purposes)
+ *
+ * @param base_address The base address of the module
+ * @param pdb_file_name The path of the PDB file
+ * @param module_name The name of the module
+ *
+ * @return UINT32 returns zero if the symbols are loaded
+ */
+UINT32
+hyperdbg_u_test_load_symbol_file(UINT64 base_address, const CHAR * pdb_file_name, const CHAR * module_name)
+{
+    return ScriptEngineLoadFileSymbolWrapper(base_address, pdb_file_name, module_name);
+}
+
+/**
+ * @brief Unload the symbols of a module (used for testing purposes)
+ *
+ * @param module_name The name of the module
+ *
+ * @return UINT32 returns zero if the symbols are unloaded
+ */
+UINT32
+hyperdbg_u_test_unload_module_symbol(const CHAR * module_name)
+{
+    return ScriptEngineUnloadModuleSymbolWrapper((char *)module_name);
+}
+
+/**
+ * @brief Check whether the assembler has a cached result (used for testing purposes)
+ *
+ * @return BOOLEAN returns true if the last assembled code is cached
+ */
+BOOLEAN
+hyperdbg_u_test_assembler_has_cached_result()
+{
+    return g_AssemblerLastResult.IsValid;
+}
+
+/**
+ * @brief Convert the pattern of the search commands (used for testing purposes)
+ *
+ * @param pattern_string The hex pattern ('?' for wildcard nibbles)
+ * @param pattern The converted pattern
+ *
+ * @return BOOLEAN returns true if the pattern is valid
+ */
+BOOLEAN
+hyperdbg_u_test_search_convert_pattern(const CHAR * pattern_string, DEBUGGER_SEARCH_PATTERN * pattern)
+{
+    return CommandSearchConvertStringToPattern(pattern_string, pattern);
+}
+
 /**
  * @brief Show the signature of the debugger
  *
@@ -611,6 +821,43 @@ hyperdbg_u_assemble(const CHAR * assembly_code, UINT64 start_address, PVOID buff
     return HyperDbgAssemble(assembly_code, start_address, buffer_to_store_assembled_data, buffer_size);
 }
 
+/**
+ * @brief Assembler function for multiple statements
+ *
+ * @param assembly_code The assembly code (statements are separated by ';' or new lines)
+ * @param start_address The start address of the assembly code
+ * @param buffer_to_store_assembled_data The buffer to store the assembled data
+ * @param buffer_size The size of the buffer
+ * @param statement_offsets The offset of each statement in the assembled data (optional)
+ * @param statement_lengths The length of each statement in bytes (optional)
+ * @param max_statements The number of entries of the offsets and the lengths
+ * @param number_of_statements The number of statements (to be returned)
+ * @param length The length of the assembled data in bytes (to be returned)
+ *
+ * @return BOOLEAN Returns true if it was successful
+ */
+BOOLEAN
+hyperdbg_u_assemble_batch(const CHAR * assembly_code,
+                          UINT64       start_address,
+                          PVOID        buffer_to_store_assembled_data,
+                          UINT32       buffer_size,
+                          UINT32 *     statement_offsets,
+                          UINT32 *     statement_lengths,
+                          UINT32       max_statements,
+                          UINT32 *     number_of_statements,
+                          UINT32 *     length)
+{
+    return HyperDbgAssembleBatch(assembly_code,
+                                 start_address,
+                                 buffer_to_store_assembled_data,
+                                 buffer_size,
+                                 statement_offsets,
+                                 statement_lengths,
+                                 max_statements,
+                                 number_of_statements,
+                                 length);
+}
+
 /**
  * @brief Setip the path for the filename
  *
@@ -783,3 +1030,189 @@ hyperdbg_u_disable_transparent_mode()
 {
     return HyperDbgDisableTransparentMode();
 }
+
+/**
+ * @brief Create a batch of operations
+ *
+ * @return PVOID the batch (NULL if it's not created)
+ */
+PVOID
+hyperdbg_u_batch_create()
+{
+    return KdBatchCreate();
+}
+
+/**
+ * @brief Add reading memory to the batch
+ *
+ * @param batch The batch
+ * @param address The address to read
+ * @param memory_type The type of memory (physical or virtual)
+ * @param size The size of memory to read
+ * @param index The index of the operation in the batch
+ *
+ * @return BOOLEAN TRUE if the operation is added, otherwise FALSE
+ */
+BOOLEAN
+hyperdbg_u_batch_add_read_memory(PVOID                     batch,
+                                 UINT64                    address,
+                                 DEBUGGER_READ_MEMORY_TYPE memory_type,
+                                 UINT32                    size,
+                                 UINT32 *                  index)
+{
+    return KdBatchAddReadMemory((PKD_BATCH)batch, address, memory_type, size, index);
+}
+
+/**
+ * @brief Add writing memory to the batch
+ *
+ * @param batch The batch
+ * @param address The address to write
+ * @param memory_type The type of memory (physical or virtual)
+ * @param buffer The content to write
+ * @param size The number of bytes to write
+ * @param index The index of the operation in the batch
+ *
+ * @return BOOLEAN TRUE if the operation is added, otherwise FALSE
+ */
+BOOLEAN
+hyperdbg_u_batch_add_write_memory(PVOID                     batch,
+                                  UINT64                    address,
+                                  DEBUGGER_EDIT_MEMORY_TYPE memory_type,
+                                  const BYTE *              buffer,
+                                  UINT32                    size,
+                                  UINT32 *                  index)
+{
+    return KdBatchAddWriteMemory((PKD_BATCH)batch, address, memory_type, buffer, size, index);
+}
+
+/**
+ * @brief Add reading a register to the batch
+ *
+ * @param batch The batch
+ * @param register_id The register id (or DEBUGGEE_SHOW_ALL_REGISTERS)
+ * @param index The index of the operation in the batch
+ *
+ * @return BOOLEAN TRUE if the operation is added, otherwise FALSE
+ */
+BOOLEAN
+hyperdbg_u_batch_add_read_register(PVOID batch, UINT32 register_id, UINT32 * index)
+{
+    return KdBatchAddReadRegister((PKD_BATCH)batch, register_id, index);
+}
+
+/**
+ * @brief Add writing a register to the batch
+ *
+ * @param batch The batch
+ * @param register_id The register id
+ * @param value The new value of the register
+ * @param index The index of the operation in the batch
+ *
+ * @return BOOLEAN TRUE if the operation is added, otherwise FALSE
+ */
+BOOLEAN
+hyperdbg_u_batch_add_write_register(PVOID batch, UINT32 register_id, UINT64 value, UINT32 * index)
+{
+    return KdBatchAddWriteRegister((PKD_BATCH)batch, register_id, value, index);
+}
+
+/**
+ * @brief Add setting a breakpoint to the batch
+ *
+ * @param batch The batch
+ * @param address The address of the breakpoint
+ * @param pid The process id
+ * @param tid The thread id
+ * @param core_numer The core number
+ * @param index The index of the operation in the batch
+ *
+ * @return BOOLEAN TRUE if the operation is added, otherwise FALSE
+ */
+BOOLEAN
+hyperdbg_u_batch_add_set_breakpoint(PVOID batch, UINT64 address, UINT32 pid, UINT32 tid, UINT32 core_numer, UINT32 * index)
+{
+    return KdBatchAddSetBreakpoint((PKD_BATCH)batch, address, pid, tid, core_numer, index);
+}
+
+/**
+ * @brief Add clearing a breakpoint to the batch
+ *
+ * @param batch The batch
+ * @param breakpoint_id The id of the breakpoint
+ * @param index The index of the operation in the batch
+ *
+ * @return BOOLEAN TRUE if the operation is added, otherwise FALSE
+ */
+BOOLEAN
+hyperdbg_u_batch_add_clear_breakpoint(PVOID batch, UINT64 breakpoint_id, UINT32 * index)
+{
+    return KdBatchAddClearBreakpoint((PKD_BATCH)batch, breakpoint_id, index);
+}
+
+/**
+ * @brief Add bringing pages in to the batch
+ *
+ * @param batch The batch
+ * @param address_from The start address of the range
+ * @param address_to The end address of the range
+ * @param page_fault_error_code The error code of the injected page-fault
+ * @param index The index of the operation in the batch
+ *
+ * @return BOOLEAN TRUE if the operation is added, otherwise FALSE
+ */
+BOOLEAN
+hyperdbg_u_batch_add_pagein(PVOID batch, UINT64 address_from, UINT64 address_to, UINT32 page_fault_error_code, UINT32 * index)
+{
+    return KdBatchAddPagein((PKD_BATCH)batch, address_from, address_to, page_fault_error_code, index);
+}
+
+/**
+ * @brief Perform all of the operations of the batch in the debuggee
+ *
+ * @param batch The batch
+ * @param number_of_performed_operations The number of performed operations
+ *
+ * @return BOOLEAN TRUE if all of the operations are performed, otherwise FALSE
+ */
+BOOLEAN
+hyperdbg_u_batch_execute(PVOID batch, UINT32 * number_of_performed_operations)
+{
+    return KdBatchExecute((PKD_BATCH)batch, number_of_performed_operations);
+}
+
+/**
+ * @brief Get the result of an operation of the batch
+ *
+ * @param batch The batch
+ * @param index The index of the operation in the batch
+ * @param kernel_status The status of the operation
+ * @param buffer The buffer to store the read memory or register(s)
+ * @param buffer_size The size of the buffer
+ * @param return_length The length of the result
+ *
+ * @return BOOLEAN TRUE if the operation was performed, otherwise FALSE
+ */
+BOOLEAN
+hyperdbg_u_batch_get_result(PVOID    batch,
+                            UINT32   index,
+                            UINT32 * kernel_status,
+                            PVOID    buffer,
+                            UINT32   buffer_size,
+                            UINT32 * return_length)
+{
+    return KdBatchGetResult((PKD_BATCH)batch, index, kernel_status, buffer, buffer_size, return_length);
+}
+
+/**
+ * @brief Free the batch
+ *
+ * @param batch The batch
+ *
+ * @return VOID
+ */
+VOID
+hyperdbg_u_batch_free(PVOID batch)
+{
+    KdBatchFree((PKD_BATCH)batch);
+}
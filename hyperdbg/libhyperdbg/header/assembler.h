@@ -12,16 +12,64 @@
 
 #pragma once
 
+//////////////////////////////////////////////////
+//					Constants                   //
+//////////////////////////////////////////////////
+
+/**
+ * @brief Maximum number of times that the statements of a batch are
+ * assembled until the addresses of their labels don't change
+ *
+ */
+#define ASSEMBLER_MAXIMUM_LABEL_PASSES 8
+
+//////////////////////////////////////////////////
+//					Structures                  //
+//////////////////////////////////////////////////
+
+/**
+ * @brief Offset and length of an assembled statement
+ *
+ */
+typedef struct _ASSEMBLER_STATEMENT_RESULT
+{
+    UINT32 Offset; // offset of the statement in the assembled bytes
+    UINT32 Length;
+
+} ASSEMBLER_STATEMENT_RESULT, *PASSEMBLER_STATEMENT_RESULT;
+
+/**
+ * @brief The last assembled code and its result
+ *
+ */
+typedef struct _ASSEMBLER_CACHED_RESULT
+{
+    BOOLEAN                    IsValid;
+    UINT64                     EngineKey;
+    UINT64                     StartAddress;
+    std::string                Code;
+    std::vector<unsigned char> Bytes;
+    size_t                     StatementCount;
+
+} ASSEMBLER_CACHED_RESULT, *PASSEMBLER_CACHED_RESULT;
+
+//////////////////////////////////////////////////
+//					  Classes                   //
+//////////////////////////////////////////////////
+
 class AssembleData
 {
 public:
-    std::string     AsmRaw {};
-    std::string     AsmFixed {};
-    size_t          StatementCount {};
-    size_t          BytesCount {};
-    unsigned char * EncodedBytes {};
-    vector<UINT64>  EncBytesIntVec {};
-    ks_err          KsErr {};
+    std::string                           AsmRaw {};
+    std::string                           AsmFixed {};
+    std::vector<std::string>              AsmStatements {};
+    std::vector<std::vector<std::string>> AsmStatementLabels {}; // labels which are defined at the start of each statement
+    size_t                                StatementCount {};
+    size_t                                BytesCount {};
+    unsigned char *                       EncodedBytes {}; // points to EncodedBytesBuffer
+    std::vector<unsigned char>            EncodedBytesBuffer {};
+    vector<UINT64>                        EncBytesIntVec {};
+    ks_err                                KsErr {};
 
     AssembleData() = default;
 
@@ -30,10 +78,35 @@ public:
 
     INT
     Assemble(UINT64 StartAddr, ks_arch Arch = KS_ARCH_X86, INT Mode = KS_MODE_64, INT Syntax = KS_OPT_SYNTAX_INTEL);
+
+    INT
+    AssembleStatements(UINT64                                    StartAddr,
+                       std::vector<ASSEMBLER_STATEMENT_RESULT> & Statements,
+                       ks_arch                                   Arch   = KS_ARCH_X86,
+                       INT                                       Mode   = KS_MODE_64,
+                       INT                                       Syntax = KS_OPT_SYNTAX_INTEL);
 };
 
+//////////////////////////////////////////////////
+//					Functions                   //
+//////////////////////////////////////////////////
+
+VOID
+AssemblerInvalidateCachedResult();
+
 BOOLEAN
 HyperDbgAssembleGetLength(const CHAR * AssemblyCode, UINT64 StartAddress, UINT32 * Length);
 
 BOOLEAN
 HyperDbgAssemble(const CHAR * AssemblyCode, UINT64 StartAddress, PVOID BufferToStoreAssembledData, UINT32 BufferSize);
+
+BOOLEAN
+HyperDbgAssembleBatch(const CHAR * AssemblyCode,
+                      UINT64       StartAddress,
+                      PVOID        BufferToStoreAssembledData,
+                      UINT32       BufferSize,
+                      UINT32 *     StatementOffsets,
+                      UINT32 *     StatementLengths,
+                      UINT32       MaximumStatements,
+                      UINT32 *     NumberOfStatements,
+                      UINT32 *     Length);
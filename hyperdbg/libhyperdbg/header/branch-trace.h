@@ -0,0 +1,113 @@
+/**
+ * @file branch-trace.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of decoding the branch records and building the coverage
+ * @details
+ * @version 0.11
+ * @date 2024-11-08
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//					Constants                   //
+//////////////////////////////////////////////////
+
+/**
+ * @brief Formats of the last branch records (IA32_PERF_CAPABILITIES[5:0])
+ *
+ */
+#define BRANCH_TRACE_LBR_FORMAT_32BIT                    0x0
+#define BRANCH_TRACE_LBR_FORMAT_64BIT_LIP                0x1
+#define BRANCH_TRACE_LBR_FORMAT_64BIT_EIP                0x2
+#define BRANCH_TRACE_LBR_FORMAT_64BIT_EIP_FLAGS          0x3
+#define BRANCH_TRACE_LBR_FORMAT_64BIT_EIP_FLAGS_TSX      0x4
+#define BRANCH_TRACE_LBR_FORMAT_64BIT_EIP_FLAGS_INFO     0x5
+#define BRANCH_TRACE_LBR_FORMAT_64BIT_EIP_FLAGS_CYCLES   0x6
+#define BRANCH_TRACE_LBR_FORMAT_64BIT_LIP_FLAGS_INFO     0x7
+
+/**
+ * @brief Maximum size of a basic block, larger distances between the
+ * destination of a branch and the source of the next branch are not
+ * considered as basic blocks (e.g., an interrupt happened in between)
+ *
+ */
+#define BRANCH_TRACE_MAXIMUM_BASIC_BLOCK_SIZE 0x1000
+
+/**
+ * @brief Size of the edge bitmap of the coverage (same as AFL)
+ *
+ */
+#define BRANCH_TRACE_COVERAGE_BITMAP_SIZE 0x10000
+
+//////////////////////////////////////////////////
+//					Structures                  //
+//////////////////////////////////////////////////
+
+/**
+ * @brief A decoded branch record
+ *
+ */
+typedef struct _BRANCH_TRACE_DECODED_RECORD
+{
+    UINT64  From;
+    UINT64  To;
+    UINT32  Type; // DEBUGGER_BRANCH_TRACE_TYPE
+    UINT32  CoreId;
+    UINT16  Flags;  // DEBUGGER_BRANCH_TRACE_RECORD_FLAG_*
+    UINT16  Cycles; // elapsed cycles from the previous branch (if supported)
+    BOOLEAN IsMispredicted;
+    BOOLEAN IsInTsx;
+    BOOLEAN IsTsxAbort;
+
+} BRANCH_TRACE_DECODED_RECORD, *PBRANCH_TRACE_DECODED_RECORD;
+
+/**
+ * @brief The coverage of the traced branches
+ * @details the basic blocks are the ranges between the destination of a
+ * branch and the source of the next branch (both inclusive), the edges
+ * are the branches, and the bitmap is the hashed edges between the basic
+ * blocks (compatible with the AFL-style fuzzers), the records after a gap
+ * (lost branches or context switches) are not connected to the previous one
+ *
+ */
+typedef struct _BRANCH_TRACE_COVERAGE
+{
+    std::map<std::pair<UINT64, UINT64>, UINT64> BasicBlocks;
+    std::map<std::pair<UINT64, UINT64>, UINT64> Edges;
+    std::vector<BYTE>                           Bitmap;
+    UINT64                                      NumberOfMispredictedBranches;
+    UINT64                                      NumberOfDiscontinuities; // records that don't form a basic block
+    UINT64                                      NumberOfGaps;            // records after lost branches or context switches
+
+} BRANCH_TRACE_COVERAGE, *PBRANCH_TRACE_COVERAGE;
+
+//////////////////////////////////////////////////
+//					Functions                   //
+//////////////////////////////////////////////////
+
+BOOLEAN
+BranchTraceIsMispredictionFlagSupported(UINT32 LbrFormat);
+
+VOID
+BranchTraceDecodeRecord(UINT32                        LbrFormat,
+                        PDEBUGGER_BRANCH_TRACE_RECORD Record,
+                        PBRANCH_TRACE_DECODED_RECORD  DecodedRecord);
+
+VOID
+BranchTraceDecodeRecords(UINT32                                     LbrFormat,
+                         PDEBUGGER_BRANCH_TRACE_RECORD              Records,
+                         UINT32                                     NumberOfRecords,
+                         std::vector<BRANCH_TRACE_DECODED_RECORD> & DecodedRecords);
+
+UINT32
+BranchTraceGetBitmapLocation(UINT64 Address);
+
+VOID
+BranchTraceBuildCoverage(const std::vector<BRANCH_TRACE_DECODED_RECORD> & DecodedRecords,
+                         PBRANCH_TRACE_COVERAGE                           Coverage);
+
+UINT32
+BranchTraceGetNumberOfCoveredBitmapEntries(PBRANCH_TRACE_COVERAGE Coverage);
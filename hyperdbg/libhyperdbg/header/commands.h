@@ -46,6 +46,32 @@ ReadCpuDetails();
 VOID
 ShowMessages(const char * Fmt, ...);
 
+VOID
+ShowMessagesBeginCoalescing();
+
+VOID
+ShowMessagesFlush();
+
+VOID
+ShowMessagesEndCoalescing();
+
+/**
+ * @brief Coalesces the messages of the current thread while the object
+ * is alive
+ * @details the pending messages are sent and the coalescing is stopped
+ * even if the command throws an exception
+ *
+ */
+class ShowMessagesCoalescingScope
+{
+public:
+    ShowMessagesCoalescingScope() { ShowMessagesBeginCoalescing(); }
+    ~ShowMessagesCoalescingScope() { ShowMessagesEndCoalescing(); }
+
+    ShowMessagesCoalescingScope(const ShowMessagesCoalescingScope &) = delete;
+    ShowMessagesCoalescingScope & operator=(const ShowMessagesCoalescingScope &) = delete;
+};
+
 string
 SeparateTo64BitValue(UINT64 Value);
 
@@ -148,6 +174,9 @@ ContinuePreviousCommand();
 VOID
 CommandDumpSaveIntoFile(PVOID Buffer, UINT32 Length);
 
+BOOLEAN
+CommandSearchConvertStringToPattern(std::string PatternString, PDEBUGGER_SEARCH_PATTERN Pattern);
+
 //////////////////////////////////////////////////
 //              Type of Commands                //
 //////////////////////////////////////////////////
@@ -437,6 +466,8 @@ typedef std::map<std::string, COMMAND_DETAIL> CommandType;
 
 #define DEBUGGER_COMMAND_PE_ATTRIBUTES NULL
 
+#define DEBUGGER_COMMAND_PRECOMPILE_ATTRIBUTES DEBUGGER_COMMAND_ATTRIBUTE_LOCAL_COMMAND_IN_DEBUGGER_MODE
+
 #define DEBUGGER_COMMAND_REV_ATTRIBUTES NULL
 
 #define DEBUGGER_COMMAND_TRACK_ATTRIBUTES DEBUGGER_COMMAND_ATTRIBUTE_LOCAL_COMMAND_IN_DEBUGGER_MODE
@@ -465,6 +496,9 @@ typedef std::map<std::string, COMMAND_DETAIL> CommandType;
 #define DEBUGGER_COMMAND_IDT_ATTRIBUTES \
     DEBUGGER_COMMAND_ATTRIBUTE_LOCAL_COMMAND_IN_DEBUGGER_MODE
 
+#define DEBUGGER_COMMAND_PROFILE_ATTRIBUTES \
+    DEBUGGER_COMMAND_ATTRIBUTE_LOCAL_COMMAND_IN_DEBUGGER_MODE
+
 //////////////////////////////////////////////////
 //             Command Functions                //
 //////////////////////////////////////////////////
@@ -712,6 +746,9 @@ CommandK(vector<CommandToken> CommandTokens, string Command);
 VOID
 CommandPe(vector<CommandToken> CommandTokens, string Command);
 
+VOID
+CommandPrecompile(vector<CommandToken> CommandTokens, string Command);
+
 VOID
 CommandRev(vector<CommandToken> CommandTokens, string Command);
 
@@ -745,6 +782,9 @@ CommandPcicam(vector<CommandToken> CommandTokens, string Command);
 VOID
 CommandIdt(vector<CommandToken> CommandTokens, string Command);
 
+VOID
+CommandProfile(vector<CommandToken> CommandTokens, string Command);
+
 //
 // hwdbg commands
 //
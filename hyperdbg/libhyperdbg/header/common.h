@@ -148,6 +148,9 @@ ConvertTokenToUInt64(CommandToken TargetToken, PUINT64 Result);
 BOOLEAN
 ConvertTokenToUInt32(CommandToken TargetToken, PUINT32 Result);
 
+BOOLEAN
+ConvertTokenToPercentage(CommandToken TargetToken, PUINT32 Result);
+
 std::string
 GetCaseSensitiveStringFromCommandToken(CommandToken TargetToken);
 
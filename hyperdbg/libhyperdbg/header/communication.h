@@ -20,6 +20,111 @@
 #define COM3_PORT 0x03E8
 #define COM4_PORT 0x02E8
 
+//////////////////////////////////////////
+//			Output Coalescing            //
+//////////////////////////////////////////
+
+/**
+ * @brief Maximum size of the coalesced messages before sending them
+ * to the remote debugger
+ */
+#define SHOW_MESSAGES_COALESCING_MAX_SIZE COMMUNICATION_BUFFER_SIZE
+
+/**
+ * @brief Number of coalesced lines that cause the messages to be sent
+ * to the remote debugger (keeps long outputs streaming)
+ */
+#define SHOW_MESSAGES_COALESCING_MAX_LINES 64
+
+/**
+ * @brief Maximum capacity of the buffers of the messages that is kept
+ * after a command (the buffers of longer outputs are released)
+ */
+#define SHOW_MESSAGES_MAX_RETAINED_SIZE ((COMMUNICATION_BUFFER_SIZE) * 4)
+
+//////////////////////////////////////////
+//			Remote Frames               //
+//////////////////////////////////////////
+
+/**
+ * @brief Capability that is sent after the build signature by the debuggers
+ * that support framed remote connections
+ */
+#define REMOTE_FRAME_CAPABILITY "FRAMED"
+
+/**
+ * @brief Handshake reply of the debuggees that accept the framed protocol
+ * (old debuggees reply with "OK")
+ */
+#define REMOTE_FRAME_HANDSHAKE_ACCEPTED "FR"
+
+/**
+ * @brief Magic of the remote frames ('HDFR')
+ */
+#define REMOTE_FRAME_MAGIC 0x52464448
+
+/**
+ * @brief Maximum size of the payload of a frame
+ */
+#define REMOTE_FRAME_MAX_PAYLOAD_SIZE ((COMMUNICATION_BUFFER_SIZE) * 16)
+
+/**
+ * @brief Payloads smaller than this size are not compressed
+ */
+#define REMOTE_FRAME_COMPRESSION_THRESHOLD 256
+
+/**
+ * @brief Compression format of the compressed frames
+ */
+#define REMOTE_FRAME_COMPRESSION_FORMAT COMPRESSION_FORMAT_LZNT1
+
+/**
+ * @brief The payload of the frame is compressed
+ */
+#define REMOTE_FRAME_FLAG_COMPRESSED 0x1
+
+/**
+ * @brief Types of the remote frames
+ *
+ */
+typedef enum _REMOTE_FRAME_TYPE
+{
+    REMOTE_FRAME_TYPE_COMMAND = 1,       // debugger to debuggee
+    REMOTE_FRAME_TYPE_OUTPUT,            // debuggee to debugger
+    REMOTE_FRAME_TYPE_COMMAND_FINISHED,  // debuggee to debugger
+    REMOTE_FRAME_TYPE_BREAK,             // debugger to debuggee (CTRL+C, not answered)
+
+} REMOTE_FRAME_TYPE;
+
+/**
+ * @brief Header of the remote frames
+ * @details Outputs that don't belong to any command (events, logs) have
+ * a zero request id
+ *
+ */
+typedef struct _REMOTE_FRAME_HEADER
+{
+    UINT32 Magic;
+    UINT32 RequestId;
+    UINT16 Type;
+    UINT16 Flags;
+    UINT32 PayloadSize;  // size of the payload on the wire
+    UINT32 OriginalSize; // size of the payload after decompression
+
+} REMOTE_FRAME_HEADER, *PREMOTE_FRAME_HEADER;
+
+/**
+ * @brief A command that is received by the debuggee and is waiting
+ * to be executed
+ *
+ */
+typedef struct _REMOTE_FRAME_COMMAND
+{
+    UINT32            RequestId;
+    std::vector<CHAR> Command;
+
+} REMOTE_FRAME_COMMAND, *PREMOTE_FRAME_COMMAND;
+
 //////////////////////////////////////////
 //			   	Server 		            //
 //////////////////////////////////////////
@@ -71,8 +176,45 @@ RemoteConnectionConnect(PCSTR Ip, PCSTR Port);
 int
 RemoteConnectionSendCommand(const char * sendbuf, int len);
 
+int
+RemoteConnectionSendBreak();
+
 int
 RemoteConnectionSendResultsToHost(const char * sendbuf, int len);
 
 int
 RemoteConnectionCloseTheConnectionWithDebuggee();
+
+//////////////////////////////////////////
+//            Remote Frames             //
+//////////////////////////////////////////
+
+VOID
+RemoteFrameInitialize();
+
+BOOLEAN
+RemoteFrameSend(SOCKET Socket, BOOLEAN IsServer, REMOTE_FRAME_TYPE Type, UINT32 RequestId, const CHAR * Payload, UINT32 Size);
+
+BOOLEAN
+RemoteFrameReceive(SOCKET Socket, PREMOTE_FRAME_HEADER Header, std::vector<CHAR> & Payload);
+
+VOID
+RemoteFrameSetCurrentRequestId(UINT32 RequestId);
+
+UINT32
+RemoteFrameGetCurrentRequestId();
+
+int
+RemoteFrameSendCommandAndWait(SOCKET Socket, const char * Command, int Length);
+
+BOOLEAN
+RemoteFrameSendBreak(SOCKET Socket);
+
+VOID
+RemoteFrameCompleteCommand(UINT32 RequestId);
+
+DWORD WINAPI
+RemoteFrameReceiveCommandsThread(LPVOID Param);
+
+BOOLEAN
+RemoteFrameWaitForCommand(PUINT32 RequestId, std::vector<CHAR> & Command);
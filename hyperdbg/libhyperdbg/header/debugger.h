@@ -60,6 +60,9 @@
 #define DEBUGGER_SYNCRONIZATION_OBJECT_KERNEL_DEBUGGER_APIC_ACTIONS                        0x1c
 #define DEBUGGER_SYNCRONIZATION_OBJECT_KERNEL_DEBUGGER_PCIDEVINFO_RESULT                   0x1d
 #define DEBUGGER_SYNCRONIZATION_OBJECT_KERNEL_DEBUGGER_IDT_ENTRIES                         0x1e
+#define DEBUGGER_SYNCRONIZATION_OBJECT_KERNEL_DEBUGGER_BATCH_OPERATIONS                    0x1f
+#define DEBUGGER_SYNCRONIZATION_OBJECT_KERNEL_DEBUGGER_SEARCH_MULTIPLE_PATTERNS_RESULT     0x20
+#define DEBUGGER_SYNCRONIZATION_OBJECT_KERNEL_DEBUGGER_BRANCH_TRACE_RESULT                 0x21
 
 //////////////////////////////////////////////////
 //               Event Details                  //
@@ -205,6 +208,9 @@ BOOLEAN
 CommandEventsModifyAndQueryEvents(UINT64                      Tag,
                                   DEBUGGER_MODIFY_EVENTS_TYPE TypeOfAction);
 
+BOOLEAN
+CommandEventsQuerySuppressedHits(UINT64 Tag, UINT32 CoreId, UINT64 * SuppressedHits);
+
 VOID
 CommandEventsHandleModifiedEvent(
     UINT64                  Tag,
@@ -143,6 +143,68 @@ HANDLE g_EndOfMessageReceivedEvent = NULL;
  */
 BOOLEAN g_IsEndOfMessageReceived = FALSE;
 
+/**
+ * @brief Whether the remote connection uses the framed protocol
+ * (negotiated in the handshake)
+ *
+ */
+BOOLEAN g_IsRemoteFramedProtocol = FALSE;
+
+/**
+ * @brief Lock for the pending requests and the received commands
+ * of the remote frames (nothing is sent while holding it)
+ *
+ */
+CRITICAL_SECTION g_RemoteFrameLock;
+
+/**
+ * @brief Lock for sending the remote frames (only the socket is
+ * used while holding it)
+ *
+ */
+CRITICAL_SECTION g_RemoteFrameSendLock;
+
+/**
+ * @brief Whether the locks of remote frames are initialized or not
+ *
+ */
+BOOLEAN g_RemoteFrameLockInitialized = FALSE;
+
+/**
+ * @brief Signaled when a command is received by the debuggee or the
+ * connection is closed
+ *
+ */
+CONDITION_VARIABLE g_RemoteFrameCommandAvailable = CONDITION_VARIABLE_INIT;
+
+/**
+ * @brief Commands that are received by the debuggee and are waiting
+ * to be executed (in order)
+ *
+ */
+std::list<REMOTE_FRAME_COMMAND> g_RemoteReceivedCommands;
+
+/**
+ * @brief Whether the debuggee stopped receiving the commands (the
+ * connection is closed)
+ *
+ */
+BOOLEAN g_RemoteCommandsReceiverClosed = FALSE;
+
+/**
+ * @brief Request id of the last command that is sent to the remote
+ * debuggee
+ *
+ */
+UINT32 g_RemoteLastRequestId = 0;
+
+/**
+ * @brief Commands that are sent to the remote debuggee and are waiting
+ * to be finished (request id to event)
+ *
+ */
+std::map<UINT32, HANDLE> g_RemotePendingRequests;
+
 /**
  * @brief In both debuggee and debugger we save the state of
  * the closed connection to avoid double close
@@ -306,6 +368,12 @@ OVERLAPPED g_OverlappedIoStructureForReadDebuggee = {0};
  */
 BOOLEAN g_SharedEventStatus = FALSE;
 
+/**
+ * @brief The number of suppressed hits of the queried event or core
+ *
+ */
+UINT64 g_SharedEventSuppressedHits = 0;
+
 //////////////////////////////////////////////////
 //				 Global Variables               //
 //////////////////////////////////////////////////
@@ -554,6 +622,12 @@ UINT64 g_RdtscMedian = 0;
  */
 BOOLEAN g_IsInstrumentingInstructions = FALSE;
 
+/**
+ * @brief Shows whether a resumable operation (e.g., 'sm') is running
+ * on the debuggee, CTRL+C cancels the operation
+ */
+BOOLEAN g_IsRunningResumableOperation = FALSE;
+
 /**
  * @brief Shows the kernel base address
  */
@@ -696,3 +770,63 @@ std::vector<UINT32> g_HwdbgPortConfiguration;
  *
  */
 UINT64 * g_HwdbgPinsStatus;
+
+//////////////////////////////////////////////////
+//				     Assembler                  //
+//////////////////////////////////////////////////
+
+/**
+ * @brief Cached Keystone engines (for each architecture, mode and syntax)
+ *
+ */
+std::map<UINT64, ks_engine *> g_AssemblerEngines;
+
+/**
+ * @brief The last assembled code (the length query is usually followed
+ * by assembling the same code)
+ *
+ */
+ASSEMBLER_CACHED_RESULT g_AssemblerLastResult;
+
+/**
+ * @brief Addresses of the labels of the statements of a batch (the
+ * statements are assembled one by one, so the labels of the other
+ * statements are resolved by the symbol resolver)
+ *
+ */
+std::map<std::string, UINT64> g_AssemblerBatchLabels;
+
+/**
+ * @brief Lock of the cached Keystone engines, the last result and the
+ * labels of the batch
+ *
+ */
+SRWLOCK g_AssemblerLock = SRWLOCK_INIT;
+
+//////////////////////////////////////////////////
+//				     Profiler                   //
+//////////////////////////////////////////////////
+
+/**
+ * @brief The aggregated samples of the profiler
+ *
+ */
+PROFILER_AGGREGATED_SAMPLES g_ProfilerAggregatedSamples;
+
+/**
+ * @brief Lock of the aggregated samples of the profiler
+ *
+ */
+SRWLOCK g_ProfilerLock = SRWLOCK_INIT;
+
+/**
+ * @brief The thread that drains the samples of the profiler
+ *
+ */
+HANDLE g_ProfilerDrainThread = NULL;
+
+/**
+ * @brief Shows whether the profiler is running or not
+ *
+ */
+volatile BOOLEAN g_ProfilerIsRunning = FALSE;
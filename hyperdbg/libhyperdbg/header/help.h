@@ -276,6 +276,9 @@ CommandKHelp();
 VOID
 CommandPeHelp();
 
+VOID
+CommandPrecompileHelp();
+
 VOID
 CommandRevHelp();
 
@@ -303,6 +306,9 @@ CommandPcicamHelp();
 VOID
 CommandIdtHelp();
 
+VOID
+CommandProfileHelp();
+
 //
 // hwdbg commands
 //
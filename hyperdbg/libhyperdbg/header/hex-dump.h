@@ -0,0 +1,74 @@
+/**
+ * @file hex-dump.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of the hex/ASCII dump renderer
+ * @details
+ * @version 0.11
+ * @date 2024-10-20
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//					Constants                   //
+//////////////////////////////////////////////////
+
+/**
+ * @brief Number of bytes that are shown in each line of the dump
+ *
+ */
+#define HEX_DUMP_BYTES_PER_LINE 16
+
+/**
+ * @brief Size of the buffer that lines are rendered into before
+ * being shown (should fit in the buffer of ShowMessages)
+ *
+ */
+#define HEX_DUMP_CHUNK_SIZE PacketChunkSize
+
+/**
+ * @brief Maximum size of a single rendered line
+ *
+ */
+#define HEX_DUMP_MAX_LINE_SIZE 160
+
+//////////////////////////////////////////////////
+//					Structures                  //
+//////////////////////////////////////////////////
+
+/**
+ * @brief Layout of the hex dumps
+ *
+ */
+typedef struct _HEX_DUMP_OPTIONS
+{
+    UINT32  ElementSize;    // 1, 2, 4 or 8 bytes for each shown element
+    BOOLEAN UpperCase;      // show hex digits in upper case
+    BOOLEAN ShowAscii;      // show the characters column
+    BOOLEAN PhysicalPrefix; // put '#\t' at the start of lines (physical memory)
+
+} HEX_DUMP_OPTIONS, *PHEX_DUMP_OPTIONS;
+
+//////////////////////////////////////////////////
+//					Functions                   //
+//////////////////////////////////////////////////
+
+UINT32
+HexDumpRenderLine(const HEX_DUMP_OPTIONS * Options,
+                  const UCHAR *            Buffer,
+                  UINT64                   ValidLength,
+                  UINT64                   Offset,
+                  UINT64                   Address,
+                  CHAR *                   Line);
+
+VOID
+HexDumpShow(const HEX_DUMP_OPTIONS * Options,
+            const UCHAR *            Buffer,
+            UINT64                   Size,
+            UINT64                   ValidLength,
+            UINT64                   Address);
+
+VOID
+HexDumpShowSection(const UCHAR * Buffer, UINT32 Size, UINT32 Address);
@@ -0,0 +1,89 @@
+/**
+ * @file kd-batch.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of the batch operations of the kernel debugger
+ * @details
+ * @version 0.11
+ * @date 2024-10-25
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//					Structures                  //
+//////////////////////////////////////////////////
+
+/**
+ * @brief A list of operations that are sent to the debuggee as a
+ * single packet
+ *
+ */
+typedef struct _KD_BATCH
+{
+    std::vector<CHAR>                          Request;         // DEBUGGEE_BATCH_PACKET followed by the operations
+    std::vector<DEBUGGEE_BATCH_OPERATION_TYPE> OperationTypes;  // type of each operation
+    UINT32                                     ExpectedResultSize;
+    std::vector<CHAR>                          Result;          // the result received from the debuggee
+    std::vector<UINT32>                        ResultOffsets;   // offset of the result of each performed operation
+    BOOLEAN                                    IsExecuted;
+
+} KD_BATCH, *PKD_BATCH;
+
+//////////////////////////////////////////////////
+//					Functions                   //
+//////////////////////////////////////////////////
+
+PKD_BATCH
+KdBatchCreate();
+
+VOID
+KdBatchFree(PKD_BATCH Batch);
+
+BOOLEAN
+KdBatchAddReadMemory(PKD_BATCH                 Batch,
+                     UINT64                    Address,
+                     DEBUGGER_READ_MEMORY_TYPE MemoryType,
+                     UINT32                    Size,
+                     UINT32 *                  Index);
+
+BOOLEAN
+KdBatchAddWriteMemory(PKD_BATCH                 Batch,
+                      UINT64                    Address,
+                      DEBUGGER_EDIT_MEMORY_TYPE MemoryType,
+                      const BYTE *              Buffer,
+                      UINT32                    Size,
+                      UINT32 *                  Index);
+
+BOOLEAN
+KdBatchAddReadRegister(PKD_BATCH Batch, UINT32 RegisterId, UINT32 * Index);
+
+BOOLEAN
+KdBatchAddWriteRegister(PKD_BATCH Batch, UINT32 RegisterId, UINT64 Value, UINT32 * Index);
+
+BOOLEAN
+KdBatchAddSetBreakpoint(PKD_BATCH Batch, UINT64 Address, UINT32 Pid, UINT32 Tid, UINT32 Core, UINT32 * Index);
+
+BOOLEAN
+KdBatchAddClearBreakpoint(PKD_BATCH Batch, UINT64 BreakpointId, UINT32 * Index);
+
+BOOLEAN
+KdBatchAddPagein(PKD_BATCH Batch, UINT64 AddressFrom, UINT64 AddressTo, UINT32 PageFaultErrorCode, UINT32 * Index);
+
+PDEBUGGEE_BATCH_PACKET
+KdBatchPrepareRequest(PKD_BATCH Batch);
+
+BOOLEAN
+KdBatchParseResult(PKD_BATCH Batch, UINT32 ResultSize);
+
+BOOLEAN
+KdBatchExecute(PKD_BATCH Batch, UINT32 * NumberOfPerformedOperations);
+
+BOOLEAN
+KdBatchGetResult(PKD_BATCH Batch,
+                 UINT32    Index,
+                 UINT32 *  KernelStatus,
+                 PVOID     Buffer,
+                 UINT32    BufferSize,
+                 UINT32 *  ReturnLength);
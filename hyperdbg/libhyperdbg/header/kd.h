@@ -140,6 +140,11 @@ KdSendEventQueryAndModifyPacketToDebuggee(
     DEBUGGER_MODIFY_EVENTS_TYPE TypeOfAction,
     BOOLEAN *                   IsEnabled);
 
+BOOLEAN
+KdSendEventQuerySuppressedHitsPacketToDebuggee(UINT64   Tag,
+                                               UINT32   CoreId,
+                                               UINT64 * SuppressedHits);
+
 BOOLEAN
 KdSendFlushPacketToDebuggee();
 
@@ -210,6 +215,12 @@ KdSendPtePacketToDebuggee(PDEBUGGER_READ_PAGE_TABLE_ENTRIES_DETAILS PtePacket);
 BOOLEAN
 KdSendPageinPacketToDebuggee(PDEBUGGER_PAGE_IN_REQUEST PageinPacket);
 
+BOOLEAN
+KdSendBatchPacketToDebuggee(PDEBUGGEE_BATCH_PACKET BatchPacket,
+                            UINT32                 BatchPacketSize,
+                            PDEBUGGEE_BATCH_PACKET BatchResult,
+                            UINT32                 BatchResultSize);
+
 BOOLEAN
 KdSendListOrModifyPacketToDebuggee(
     PDEBUGGEE_BP_LIST_OR_MODIFY_PACKET ListOrModifyPacket);
@@ -221,7 +232,19 @@ BOOLEAN
 KdSendUserInputPacketToDebuggee(const char * Sendbuf, int Len, BOOLEAN IgnoreBreakingAgain);
 
 BOOLEAN
-KdSendSearchRequestPacketToDebuggee(UINT64 * SearchRequestBuffer, UINT32 SearchRequestBufferSize);
+KdSendSearchRequestPacketToDebuggee(UINT64 *                          SearchRequestBuffer,
+                                    UINT32                            SearchRequestBufferSize,
+                                    PDEBUGGEE_RESULT_OF_SEARCH_PACKET SearchResult);
+
+BOOLEAN
+KdSendSearchMultiplePatternsPacketToDebuggee(PDEBUGGER_SEARCH_MULTIPLE_PATTERNS SearchRequest,
+                                             PDEBUGGER_SEARCH_MULTIPLE_PATTERNS SearchResult,
+                                             UINT32                             SearchResultSize);
+
+BOOLEAN
+KdSendBranchTracePacketToDebuggee(PDEBUGGER_BRANCH_TRACE_REQUEST BranchTraceRequest,
+                                  PDEBUGGER_BRANCH_TRACE_REQUEST BranchTraceResult,
+                                  UINT32                         BranchTraceResultSize);
 
 BOOLEAN
 KdSendStepPacketToDebuggee(DEBUGGER_REMOTE_STEPPING_REQUEST StepRequestType);
@@ -0,0 +1,89 @@
+/**
+ * @file profiler.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of aggregating the samples of the profiler
+ * @details
+ * @version 0.11
+ * @date 2024-11-01
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//					Constants                   //
+//////////////////////////////////////////////////
+
+/**
+ * @brief The interval of draining the samples of the cores while
+ * the profiler is running (in milliseconds)
+ *
+ */
+#define PROFILER_DRAIN_INTERVAL 100
+
+/**
+ * @brief Default number of the entries that are shown
+ *
+ */
+#define PROFILER_DEFAULT_SHOW_COUNT 0x14
+
+//////////////////////////////////////////////////
+//					Structures                  //
+//////////////////////////////////////////////////
+
+/**
+ * @brief The aggregated samples of the profiler
+ * @details the samples are counted based on the location (process id is
+ * zero for kernel-mode locations), the stack (the first element is the
+ * process id, then the RIP and the stack entries), and the process
+ *
+ */
+typedef struct _PROFILER_AGGREGATED_SAMPLES
+{
+    std::map<std::pair<UINT32, UINT64>, UINT64> Locations;
+    std::map<std::vector<UINT64>, UINT64>       Stacks;
+    std::map<UINT32, UINT64>                    Processes;
+    std::map<UINT32, UINT64>                    TotalSamplesOfCores;
+    std::map<UINT32, UINT64>                    DroppedSamplesOfCores;
+    UINT64                                      NumberOfSamples;
+
+} PROFILER_AGGREGATED_SAMPLES, *PPROFILER_AGGREGATED_SAMPLES;
+
+/**
+ * @brief The samples of a function (the locations are folded to
+ * the functions based on the symbols)
+ *
+ */
+typedef struct _PROFILER_FUNCTION_SAMPLES
+{
+    std::string Name;
+    UINT64      SelfSamples;      // samples that RIP is in the function
+    UINT64      InclusiveSamples; // samples that the function is either RIP or on the stack
+
+} PROFILER_FUNCTION_SAMPLES, *PPROFILER_FUNCTION_SAMPLES;
+
+//////////////////////////////////////////////////
+//					Functions                   //
+//////////////////////////////////////////////////
+
+VOID
+ProfilerAggregateSamples(PPROFILER_AGGREGATED_SAMPLES Aggregated,
+                         PDEBUGGER_PROFILER_SAMPLE    Samples,
+                         UINT32                       NumberOfSamples);
+
+VOID
+ProfilerAggregateCoreCounters(PPROFILER_AGGREGATED_SAMPLES Aggregated,
+                              UINT32                       CoreId,
+                              UINT64                       TotalSamples,
+                              UINT64                       DroppedSamples);
+
+VOID
+ProfilerClearAggregatedSamples(PPROFILER_AGGREGATED_SAMPLES Aggregated);
+
+std::string
+ProfilerGetFunctionName(const std::map<UINT64, LOCAL_FUNCTION_DESCRIPTION> & SymbolMap, UINT64 Address);
+
+std::vector<PROFILER_FUNCTION_SAMPLES>
+ProfilerFoldToFunctions(PPROFILER_AGGREGATED_SAMPLES                         Aggregated,
+                        const std::map<UINT64, LOCAL_FUNCTION_DESCRIPTION> & SymbolMap);
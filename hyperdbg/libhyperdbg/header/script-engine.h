@@ -50,6 +50,12 @@ ScriptEngineConvertFileToPdbFileAndGuidAndAgeDetailsWrapper(const char * LocalFi
                                                             char *       GuidAndAgeDetails,
                                                             BOOLEAN      Is32BitModule);
 
+BOOLEAN
+ScriptEngineGetPeImageDetailsWrapper(const WCHAR * FilePath, PPE_IMAGE_DETAILS ImageDetails);
+
+VOID
+ScriptEngineReleasePeImageDetailsWrapper(PPE_IMAGE_DETAILS ImageDetails);
+
 BOOLEAN
 ScriptEngineSymbolInitLoadWrapper(PMODULE_SYMBOL_DETAIL BufferToStoreDetails,
                                   UINT32                StoredLength,
@@ -84,6 +90,24 @@ ScriptAutomaticStatementsTestWrapper(const string & Expr, UINT64 ExpectationValu
 PVOID
 ScriptEngineParseWrapper(char * Expr, BOOLEAN ShowErrorMessageIfAny);
 
+PVOID
+ScriptEngineLoadCompiledScriptWrapper(PVOID CompiledScript, UINT32 CompiledScriptSize, BOOLEAN ShowErrorMessageIfAny);
+
+BOOLEAN
+ScriptEngineCompileToBufferWrapper(char * Expr, std::vector<CHAR> & CompiledScript);
+
+VOID
+ScriptEngineWrapperSetTestModuleBase(UINT64 Base);
+
+BOOLEAN
+ScriptEngineWrapperTestCompiledScriptRoundTrip(const string & Expr, UINT64 ParseBase, UINT64 LoadBase, UINT32 * NumberOfRelocations);
+
+BOOLEAN
+ScriptEngineWrapperTestOperatorSpecialization(const string & Expr);
+
+BOOLEAN
+ScriptEngineWrapperTestExecute(PVOID SymbolBuffer, UINT64 * NumberOfOperators);
+
 VOID
 PrintSymbolBufferWrapper(PVOID SymbolBuffer);
 
@@ -154,6 +154,7 @@ typedef const wchar_t *LPCWCHAR, *PCWCHAR;
 #include "header/inipp.h"
 #include "header/commands.h"
 #include "header/common.h"
+#include "header/hex-dump.h"
 #include "header/symbol.h"
 #include "header/debugger.h"
 #include "header/script-engine.h"
@@ -166,13 +167,21 @@ typedef const wchar_t *LPCWCHAR, *PCWCHAR;
 #include "header/namedpipe.h"
 #include "header/forwarding.h"
 #include "header/kd.h"
+#include "header/kd-batch.h"
 #include "header/pe-parser.h"
+#include "header/profiler.h"
+#include "header/branch-trace.h"
 #include "header/ud.h"
 #include "header/objects.h"
 #include "header/steppings.h"
 #include "header/rev-ctrl.h"
 #include "header/assembler.h"
 
+//
+// Components (shared with the kernel)
+//
+#include "components/pool/header/PoolWatermark.h"
+
 //
 // hwdbg
 //
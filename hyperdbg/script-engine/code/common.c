@@ -51,8 +51,9 @@ NewUnknownToken()
     strcpy(Token->Value, "");
     Token->Type         = UNKNOWN;
     Token->Len          = 0;
-    Token->MaxLen       = TOKEN_VALUE_MAX_LEN;
-    Token->VariableType = 0;
+    Token->MaxLen          = TOKEN_VALUE_MAX_LEN;
+    Token->VariableType    = 0;
+    Token->RelocationIndex = 0;
 
     return Token;
 }
@@ -76,12 +77,13 @@ NewToken(TOKEN_TYPE Type, char * Value)
     //
     // Init fields
     //
-    unsigned int Len    = (unsigned int)strlen(Value);
-    Token->Type         = Type;
-    Token->Len          = Len;
-    Token->MaxLen       = Len;
-    Token->Value        = (char *)calloc(Token->MaxLen + 1, sizeof(char));
-    Token->VariableType = 0;
+    unsigned int Len       = (unsigned int)strlen(Value);
+    Token->Type            = Type;
+    Token->Len             = Len;
+    Token->MaxLen          = Len;
+    Token->Value           = (char *)calloc(Token->MaxLen + 1, sizeof(char));
+    Token->VariableType    = 0;
+    Token->RelocationIndex = 0;
 
     if (Token->Value == NULL)
     {
@@ -322,7 +324,8 @@ CopyToken(PTOKEN Token)
     TokenCopy->MaxLen       = Token->MaxLen;
     TokenCopy->Len          = Token->Len;
     TokenCopy->Value        = (char *)calloc(strlen(Token->Value) + 1, sizeof(char));
-    TokenCopy->VariableType = Token->VariableType;
+    TokenCopy->VariableType    = Token->VariableType;
+    TokenCopy->RelocationIndex = Token->RelocationIndex;
 
     if (TokenCopy->Value == NULL)
     {
@@ -395,6 +398,26 @@ RemoveTokenList(PTOKEN_LIST TokenList)
     return;
 }
 
+/**
+ * @brief Removes the tokens of a TOKEN_LIST but keeps its buffer
+ * for reusing the list
+ *
+ * @param TokenList
+ */
+void
+ClearTokenList(PTOKEN_LIST TokenList)
+{
+    PTOKEN Token;
+    for (uintptr_t i = 0; i < TokenList->Pointer; i++)
+    {
+        Token = *(TokenList->Head + i);
+        RemoveToken(&Token);
+    }
+    TokenList->Pointer = 0;
+
+    return;
+}
+
 /**
  * @brief Prints each Token inside a TokenList
  *
@@ -0,0 +1,527 @@
+/**
+ * @file compiled-script.c
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Serializing and loading relocatable compiled scripts
+ * @details Addresses of module!symbol names and indexes of global variables
+ * are the only parts of a compiled script that depend on the current session,
+ * so they are saved as relocations and patched at the load time
+ * @version 0.11
+ * @date 2024-10-18
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+//
+// Global Variables
+//
+extern PSCRIPT_ENGINE_SYMBOL_RELOCATION g_SymbolRelocations;
+extern UINT32                           g_SymbolRelocationsCount;
+extern UINT32                           g_SymbolRelocationsCapacity;
+
+/**
+ * @brief Round up the size of the sections in the compiled scripts
+ *
+ */
+#define COMPILED_SCRIPT_ALIGN(Size) (((Size) + 7) & ~((UINT64)7))
+
+/**
+ * @brief Type of a symbol (the arguments of printf keep the position of
+ * their format in the high bits of the type)
+ *
+ */
+#define COMPILED_SCRIPT_SYMBOL_TYPE(Symbol) ((Symbol)->Type & 0x7fffffff)
+
+/**
+ * @brief Record the address of a module!symbol name that is resolved
+ * by the scanner
+ * @details Names that are not in a loaded module are not recorded and
+ * their addresses remain absolute in the compiled script
+ *
+ * @param Name
+ * @param Address
+ * @return UINT32 index of the relocation plus one, zero if it's not recorded
+ */
+UINT32
+ScriptEngineRecordSymbolRelocation(const char * Name, UINT64 Address)
+{
+    const char * Bang             = strchr(Name, '!');
+    BOOLEAN      WasFound         = FALSE;
+    UINT64       ModuleBase       = 0;
+    size_t       ModuleNameLength = 0;
+    CHAR         ModuleName[SCRIPT_ENGINE_RELOCATION_MODULE_NAME_MAX];
+
+    if (Bang == NULL)
+    {
+        return 0;
+    }
+
+    ModuleNameLength = Bang - Name;
+
+    if (ModuleNameLength == 0 || ModuleNameLength >= SCRIPT_ENGINE_RELOCATION_MODULE_NAME_MAX)
+    {
+        return 0;
+    }
+
+    memcpy(ModuleName, Name, ModuleNameLength);
+    ModuleName[ModuleNameLength] = '\0';
+
+    ModuleBase = ScriptEngineGetModuleBaseAddress(ModuleName, &WasFound);
+
+    if (!WasFound || Address < ModuleBase)
+    {
+        return 0;
+    }
+
+    if (g_SymbolRelocationsCount == g_SymbolRelocationsCapacity)
+    {
+        UINT32                           NewCapacity = g_SymbolRelocationsCapacity ? g_SymbolRelocationsCapacity * 2 : 16;
+        PSCRIPT_ENGINE_SYMBOL_RELOCATION NewBuffer   = (PSCRIPT_ENGINE_SYMBOL_RELOCATION)realloc(g_SymbolRelocations,
+                                                                                               NewCapacity * sizeof(SCRIPT_ENGINE_SYMBOL_RELOCATION));
+
+        if (NewBuffer == NULL)
+        {
+            return 0;
+        }
+
+        g_SymbolRelocations         = NewBuffer;
+        g_SymbolRelocationsCapacity = NewCapacity;
+    }
+
+    g_SymbolRelocations[g_SymbolRelocationsCount].Address = Address;
+    g_SymbolRelocations[g_SymbolRelocationsCount].Offset  = Address - ModuleBase;
+    strcpy(g_SymbolRelocations[g_SymbolRelocationsCount].ModuleName, ModuleName);
+
+    return ++g_SymbolRelocationsCount;
+}
+
+/**
+ * @brief Compute a fingerprint of the operators of the script engine
+ * @details The operators are encoded by their index, so a compiled script
+ * is only valid for the script engine that has the same list of operators
+ *
+ * @return UINT64
+ */
+static UINT64
+ScriptEngineGetOperatorsFingerprint()
+{
+    UINT64 Hash = 0xcbf29ce484222325;
+
+    for (UINT32 i = 0; i < sizeof(FunctionNames) / sizeof(FunctionNames[0]); i++)
+    {
+        for (const char * c = FunctionNames[i]; *c != '\0'; c++)
+        {
+            Hash ^= (UCHAR)*c;
+            Hash *= 0x100000001b3;
+        }
+
+        //
+        // Separate the names
+        //
+        Hash ^= 0xff;
+        Hash *= 0x100000001b3;
+    }
+
+    return Hash;
+}
+
+/**
+ * @brief Find or add a name to the names of a compiled script
+ *
+ * @param Names
+ * @param NumberOfNames
+ * @param Name
+ * @return UINT32
+ */
+static UINT32
+ScriptEngineCompiledScriptAddName(const char ** Names, UINT32 * NumberOfNames, const char * Name)
+{
+    for (UINT32 i = 0; i < *NumberOfNames; i++)
+    {
+        if (!strcmp(Names[i], Name))
+        {
+            return i;
+        }
+    }
+
+    Names[*NumberOfNames] = Name;
+    return (*NumberOfNames)++;
+}
+
+/**
+ * @brief Serialize a compiled script into a relocatable buffer
+ * @details It should be called right after the script is parsed as the
+ * module!symbol relocations are recorded by the last parse. The result
+ * should be freed by ScriptEngineFreeCompiledScript
+ *
+ * @param SymbolBuffer
+ * @param CompiledScript
+ * @param CompiledScriptSize
+ * @return BOOLEAN
+ */
+BOOLEAN
+ScriptEngineSerializeCompiledScript(PVOID SymbolBuffer, PVOID * CompiledScript, UINT32 * CompiledScriptSize)
+{
+    PSYMBOL_BUFFER                        CodeBuffer          = (PSYMBOL_BUFFER)SymbolBuffer;
+    PSCRIPT_ENGINE_COMPILED_RELOCATION    Relocations         = NULL;
+    const char **                         Names               = NULL;
+    UINT32                                NumberOfRelocations = 0;
+    UINT32                                NumberOfNames       = 0;
+    UINT64                                StringsSize         = 0;
+    UINT64                                TotalSize           = 0;
+    PSCRIPT_ENGINE_COMPILED_SCRIPT_HEADER Header;
+    PSCRIPT_ENGINE_SYMBOL_RELOCATION      SymbolRelocation;
+    PSYMBOL                               Symbol;
+    CHAR *                                Image;
+    BOOLEAN                               Result = FALSE;
+
+    *CompiledScript     = NULL;
+    *CompiledScriptSize = 0;
+
+    //
+    // Each symbol has at most one relocation and one name
+    //
+    Relocations = (PSCRIPT_ENGINE_COMPILED_RELOCATION)calloc(CodeBuffer->Pointer + 1, sizeof(SCRIPT_ENGINE_COMPILED_RELOCATION));
+    Names       = (const char **)calloc(CodeBuffer->Pointer + 1, sizeof(const char *));
+
+    if (Relocations == NULL || Names == NULL)
+    {
+        goto Cleanup;
+    }
+
+    for (UINT32 i = 0; i < CodeBuffer->Pointer;)
+    {
+        Symbol = CodeBuffer->Head + i;
+
+        if (COMPILED_SCRIPT_SYMBOL_TYPE(Symbol) == SYMBOL_STRING_TYPE || COMPILED_SCRIPT_SYMBOL_TYPE(Symbol) == SYMBOL_WSTRING_TYPE)
+        {
+            i += GetSymbolHeapSize(Symbol);
+            continue;
+        }
+
+        if (COMPILED_SCRIPT_SYMBOL_TYPE(Symbol) == SYMBOL_GLOBAL_ID_TYPE && GlobalIdTable != NULL && Symbol->Value < GlobalIdTable->Pointer)
+        {
+            Relocations[NumberOfRelocations].Type        = SCRIPT_ENGINE_COMPILED_RELOCATION_GLOBAL_VARIABLE;
+            Relocations[NumberOfRelocations].SymbolIndex = i;
+            Relocations[NumberOfRelocations].NameIndex   = ScriptEngineCompiledScriptAddName(Names,
+                                                                                           &NumberOfNames,
+                                                                                           GlobalIdTable->Head[Symbol->Value]->Value);
+            NumberOfRelocations++;
+        }
+        else if (COMPILED_SCRIPT_SYMBOL_TYPE(Symbol) == SYMBOL_NUM_TYPE && Symbol->Len != 0)
+        {
+            //
+            // Only the numbers that are created from a resolved module!symbol
+            // name are relocated (not the other numbers with the same value)
+            //
+            if (Symbol->Len > g_SymbolRelocationsCount ||
+                g_SymbolRelocations[Symbol->Len - 1].Address != Symbol->Value)
+            {
+                //
+                // The symbol buffer is not the result of the last parse
+                //
+                goto Cleanup;
+            }
+
+            SymbolRelocation = &g_SymbolRelocations[Symbol->Len - 1];
+
+            Relocations[NumberOfRelocations].Type        = SCRIPT_ENGINE_COMPILED_RELOCATION_MODULE;
+            Relocations[NumberOfRelocations].SymbolIndex = i;
+            Relocations[NumberOfRelocations].NameIndex   = ScriptEngineCompiledScriptAddName(Names,
+                                                                                           &NumberOfNames,
+                                                                                           SymbolRelocation->ModuleName);
+            Relocations[NumberOfRelocations].Offset      = SymbolRelocation->Offset;
+            NumberOfRelocations++;
+        }
+
+        i++;
+    }
+
+    for (UINT32 i = 0; i < NumberOfNames; i++)
+    {
+        StringsSize += strlen(Names[i]) + 1;
+    }
+
+    TotalSize = COMPILED_SCRIPT_ALIGN(sizeof(SCRIPT_ENGINE_COMPILED_SCRIPT_HEADER)) +
+                COMPILED_SCRIPT_ALIGN((UINT64)CodeBuffer->Pointer * sizeof(SYMBOL)) +
+                COMPILED_SCRIPT_ALIGN((UINT64)NumberOfNames * sizeof(UINT32)) +
+                COMPILED_SCRIPT_ALIGN((UINT64)NumberOfRelocations * sizeof(SCRIPT_ENGINE_COMPILED_RELOCATION)) +
+                StringsSize;
+
+    if (TotalSize > MAXUINT32)
+    {
+        goto Cleanup;
+    }
+
+    Image = (CHAR *)calloc(1, (size_t)TotalSize);
+
+    if (Image == NULL)
+    {
+        goto Cleanup;
+    }
+
+    //
+    // Fill the header and the sections
+    //
+    Header                       = (PSCRIPT_ENGINE_COMPILED_SCRIPT_HEADER)Image;
+    Header->Magic                = SCRIPT_ENGINE_COMPILED_SCRIPT_MAGIC;
+    Header->Version              = SCRIPT_ENGINE_COMPILED_SCRIPT_VERSION;
+    Header->OperatorsFingerprint = ScriptEngineGetOperatorsFingerprint();
+    Header->NumberOfSymbols      = CodeBuffer->Pointer;
+    Header->SymbolsOffset        = (UINT32)COMPILED_SCRIPT_ALIGN(sizeof(SCRIPT_ENGINE_COMPILED_SCRIPT_HEADER));
+    Header->NumberOfNames        = NumberOfNames;
+    Header->NamesOffset          = Header->SymbolsOffset + (UINT32)COMPILED_SCRIPT_ALIGN((UINT64)CodeBuffer->Pointer * sizeof(SYMBOL));
+    Header->NumberOfRelocations  = NumberOfRelocations;
+    Header->RelocationsOffset    = Header->NamesOffset + (UINT32)COMPILED_SCRIPT_ALIGN((UINT64)NumberOfNames * sizeof(UINT32));
+    Header->StringsSize          = (UINT32)StringsSize;
+    Header->StringsOffset        = Header->RelocationsOffset + (UINT32)COMPILED_SCRIPT_ALIGN((UINT64)NumberOfRelocations * sizeof(SCRIPT_ENGINE_COMPILED_RELOCATION));
+
+    memcpy(Image + Header->SymbolsOffset, CodeBuffer->Head, CodeBuffer->Pointer * sizeof(SYMBOL));
+    memcpy(Image + Header->RelocationsOffset, Relocations, NumberOfRelocations * sizeof(SCRIPT_ENGINE_COMPILED_RELOCATION));
+
+    //
+    // The indexes of the recorded relocations are only valid in this session
+    //
+    for (UINT32 i = 0; i < NumberOfRelocations; i++)
+    {
+        if (Relocations[i].Type == SCRIPT_ENGINE_COMPILED_RELOCATION_MODULE)
+        {
+            ((PSYMBOL)(Image + Header->SymbolsOffset))[Relocations[i].SymbolIndex].Len = 0;
+        }
+    }
+
+    StringsSize = 0;
+
+    for (UINT32 i = 0; i < NumberOfNames; i++)
+    {
+        ((UINT32 *)(Image + Header->NamesOffset))[i] = (UINT32)StringsSize;
+
+        strcpy(Image + Header->StringsOffset + StringsSize, Names[i]);
+        StringsSize += strlen(Names[i]) + 1;
+    }
+
+    *CompiledScript     = Image;
+    *CompiledScriptSize = (UINT32)TotalSize;
+    Result              = TRUE;
+
+Cleanup:
+    free(Relocations);
+    free(Names);
+
+    return Result;
+}
+
+/**
+ * @brief Set the error message of a loaded symbol buffer
+ *
+ * @param CodeBuffer
+ * @param Message
+ * @param Name
+ * @return PVOID
+ */
+static PVOID
+ScriptEngineCompiledScriptError(PSYMBOL_BUFFER CodeBuffer, const char * Message, const char * Name)
+{
+    size_t MessageSize = strlen(Message) + (Name != NULL ? strlen(Name) : 0) + 1;
+
+    CodeBuffer->Message = (char *)malloc(MessageSize);
+
+    if (CodeBuffer->Message != NULL)
+    {
+        sprintf(CodeBuffer->Message, Message, Name);
+    }
+
+    return (PVOID)CodeBuffer;
+}
+
+/**
+ * @brief Load a compiled script and relocate it for the current session
+ * @details Similar to ScriptEngineParse, the result is a symbol buffer and
+ * its message is set if there is an error
+ *
+ * @param CompiledScript
+ * @param CompiledScriptSize
+ * @return PVOID
+ */
+PVOID
+ScriptEngineLoadCompiledScript(PVOID CompiledScript, UINT32 CompiledScriptSize)
+{
+    PSCRIPT_ENGINE_COMPILED_SCRIPT_HEADER Header      = (PSCRIPT_ENGINE_COMPILED_SCRIPT_HEADER)CompiledScript;
+    PSYMBOL_BUFFER                        CodeBuffer  = NewSymbolBuffer();
+    UINT64 *                              NameValues  = NULL;
+    BOOLEAN *                             NameIsValid = NULL;
+    PSCRIPT_ENGINE_COMPILED_RELOCATION    Relocations;
+    UINT32 *                              Names;
+    CHAR *                                Strings;
+    PSYMBOL                               Symbol;
+    PSYMBOL                               NewHead;
+
+    if (CodeBuffer == NULL)
+    {
+        return NULL;
+    }
+
+    //
+    // Validate the header and the bounds of the sections
+    //
+    if (CompiledScriptSize < sizeof(SCRIPT_ENGINE_COMPILED_SCRIPT_HEADER) ||
+        Header->Magic != SCRIPT_ENGINE_COMPILED_SCRIPT_MAGIC)
+    {
+        return ScriptEngineCompiledScriptError(CodeBuffer, "err, invalid compiled script", NULL);
+    }
+
+    if (Header->Version != SCRIPT_ENGINE_COMPILED_SCRIPT_VERSION ||
+        Header->OperatorsFingerprint != ScriptEngineGetOperatorsFingerprint())
+    {
+        return ScriptEngineCompiledScriptError(CodeBuffer,
+                                               "err, the script is compiled by a different version of the script engine, please compile it again",
+                                               NULL);
+    }
+
+    if (Header->NumberOfSymbols == 0 ||
+        (UINT64)Header->SymbolsOffset + (UINT64)Header->NumberOfSymbols * sizeof(SYMBOL) > CompiledScriptSize ||
+        (UINT64)Header->NamesOffset + (UINT64)Header->NumberOfNames * sizeof(UINT32) > CompiledScriptSize ||
+        (UINT64)Header->RelocationsOffset + (UINT64)Header->NumberOfRelocations * sizeof(SCRIPT_ENGINE_COMPILED_RELOCATION) > CompiledScriptSize ||
+        (UINT64)Header->StringsOffset + (UINT64)Header->StringsSize > CompiledScriptSize ||
+        Header->SymbolsOffset % 8 != 0 ||
+        Header->NamesOffset % 8 != 0 ||
+        Header->RelocationsOffset % 8 != 0)
+    {
+        return ScriptEngineCompiledScriptError(CodeBuffer, "err, the compiled script is corrupted", NULL);
+    }
+
+    Names       = (UINT32 *)((CHAR *)CompiledScript + Header->NamesOffset);
+    Relocations = (PSCRIPT_ENGINE_COMPILED_RELOCATION)((CHAR *)CompiledScript + Header->RelocationsOffset);
+    Strings     = (CHAR *)CompiledScript + Header->StringsOffset;
+
+    if (Header->NumberOfNames != 0 && (Header->StringsSize == 0 || Strings[Header->StringsSize - 1] != '\0'))
+    {
+        return ScriptEngineCompiledScriptError(CodeBuffer, "err, the compiled script is corrupted", NULL);
+    }
+
+    for (UINT32 i = 0; i < Header->NumberOfNames; i++)
+    {
+        if (Names[i] >= Header->StringsSize)
+        {
+            return ScriptEngineCompiledScriptError(CodeBuffer, "err, the compiled script is corrupted", NULL);
+        }
+    }
+
+    //
+    // Copy the symbols
+    //
+    NewHead = (PSYMBOL)malloc(((size_t)Header->NumberOfSymbols + 1) * sizeof(SYMBOL));
+
+    if (NewHead == NULL)
+    {
+        return ScriptEngineCompiledScriptError(CodeBuffer, "err, could not allocate buffer", NULL);
+    }
+
+    free(CodeBuffer->Head);
+
+    CodeBuffer->Head    = NewHead;
+    CodeBuffer->Size    = Header->NumberOfSymbols + 1;
+    CodeBuffer->Pointer = Header->NumberOfSymbols;
+
+    memcpy(CodeBuffer->Head, (CHAR *)CompiledScript + Header->SymbolsOffset, Header->NumberOfSymbols * sizeof(SYMBOL));
+
+    //
+    // Each name is resolved once, no matter how many relocations refer to it
+    //
+    NameValues  = (UINT64 *)calloc((size_t)Header->NumberOfNames + 1, sizeof(UINT64));
+    NameIsValid = (BOOLEAN *)calloc((size_t)Header->NumberOfNames + 1, sizeof(BOOLEAN));
+
+    if (NameValues == NULL || NameIsValid == NULL)
+    {
+        free(NameValues);
+        free(NameIsValid);
+        return ScriptEngineCompiledScriptError(CodeBuffer, "err, could not allocate buffer", NULL);
+    }
+
+    for (UINT32 i = 0; i < Header->NumberOfRelocations; i++)
+    {
+        PSCRIPT_ENGINE_COMPILED_RELOCATION Relocation = &Relocations[i];
+        const char *                       Name;
+
+        if (Relocation->SymbolIndex >= Header->NumberOfSymbols || Relocation->NameIndex >= Header->NumberOfNames)
+        {
+            ScriptEngineCompiledScriptError(CodeBuffer, "err, the compiled script is corrupted", NULL);
+            break;
+        }
+
+        Symbol = CodeBuffer->Head + Relocation->SymbolIndex;
+        Name   = Strings + Names[Relocation->NameIndex];
+
+        if (Relocation->Type == SCRIPT_ENGINE_COMPILED_RELOCATION_MODULE && COMPILED_SCRIPT_SYMBOL_TYPE(Symbol) == SYMBOL_NUM_TYPE)
+        {
+            if (!NameIsValid[Relocation->NameIndex])
+            {
+                BOOLEAN WasFound = FALSE;
+
+                NameValues[Relocation->NameIndex] = ScriptEngineGetModuleBaseAddress(Name, &WasFound);
+
+                if (!WasFound)
+                {
+                    ScriptEngineCompiledScriptError(CodeBuffer,
+                                                    "err, symbols of module '%s' are not loaded, the compiled script cannot be relocated",
+                                                    Name);
+                    break;
+                }
+
+                NameIsValid[Relocation->NameIndex] = TRUE;
+            }
+
+            Symbol->Value = NameValues[Relocation->NameIndex] + Relocation->Offset;
+        }
+        else if (Relocation->Type == SCRIPT_ENGINE_COMPILED_RELOCATION_GLOBAL_VARIABLE && COMPILED_SCRIPT_SYMBOL_TYPE(Symbol) == SYMBOL_GLOBAL_ID_TYPE)
+        {
+            if (!NameIsValid[Relocation->NameIndex])
+            {
+                PTOKEN Token = NewToken(GLOBAL_ID, (char *)Name);
+                int    Index;
+
+                if (GlobalIdTable == NULL)
+                {
+                    GlobalIdTable = NewTokenList();
+                }
+
+                Index = GetGlobalIdentifierVal(Token);
+
+                if (Index == -1)
+                {
+                    Index = NewGlobalIdentifier(Token);
+                }
+
+                RemoveToken(&Token);
+
+                NameValues[Relocation->NameIndex]  = (UINT64)Index;
+                NameIsValid[Relocation->NameIndex] = TRUE;
+            }
+
+            Symbol->Value = NameValues[Relocation->NameIndex];
+        }
+        else
+        {
+            ScriptEngineCompiledScriptError(CodeBuffer, "err, the compiled script is corrupted", NULL);
+            break;
+        }
+    }
+
+    free(NameValues);
+    free(NameIsValid);
+
+    return (PVOID)CodeBuffer;
+}
+
+/**
+ * @brief Free a buffer that is returned by ScriptEngineSerializeCompiledScript
+ *
+ * @param CompiledScript
+ * @return VOID
+ */
+VOID
+ScriptEngineFreeCompiledScript(PVOID CompiledScript)
+{
+    free(CompiledScript);
+}
@@ -481,13 +481,19 @@ GetToken(char * c, char * str)
                 *c = sgetc(str);
             } while (IsLetter(*c) || IsHex(*c) || (*c == '_') || (*c == '!'));
 
-            BOOLEAN WasFound = FALSE;
-            BOOLEAN HasBang  = strstr(Token->Value, "!") != 0;
-            UINT64  Address  = 0;
+            BOOLEAN WasFound        = FALSE;
+            BOOLEAN HasBang         = strstr(Token->Value, "!") != 0;
+            UINT64  Address         = 0;
+            UINT32  RelocationIndex = 0;
 
             if (HasBang)
             {
                 Address = ScriptEngineConvertNameToAddress(Token->Value, &WasFound);
+
+                if (WasFound)
+                {
+                    RelocationIndex = ScriptEngineRecordSymbolRelocation(Token->Value, Address);
+                }
             }
 
             if (WasFound)
@@ -496,6 +502,7 @@ GetToken(char * c, char * str)
                 char str[20] = {0};
                 sprintf(str, "%llx", Address);
                 Token = NewToken(HEX, str);
+                Token->RelocationIndex = RelocationIndex;
             }
             else
             {
@@ -744,13 +751,19 @@ GetToken(char * c, char * str)
                 }
                 else
                 {
-                    BOOLEAN WasFound = FALSE;
-                    BOOLEAN HasBang  = strstr(Token->Value, "!") != 0;
-                    UINT64  Address  = 0;
+                    BOOLEAN WasFound        = FALSE;
+                    BOOLEAN HasBang         = strstr(Token->Value, "!") != 0;
+                    UINT64  Address         = 0;
+                    UINT32  RelocationIndex = 0;
 
                     if (HasBang)
                     {
                         Address = ScriptEngineConvertNameToAddress(Token->Value, &WasFound);
+
+                        if (WasFound)
+                        {
+                            RelocationIndex = ScriptEngineRecordSymbolRelocation(Token->Value, Address);
+                        }
                     }
 
                     if (WasFound)
@@ -759,6 +772,7 @@ GetToken(char * c, char * str)
                         char str[20] = {0};
                         sprintf(str, "%llx", Address);
                         Token = NewToken(HEX, str);
+                        Token->RelocationIndex = RelocationIndex;
                     }
                     else
                     {
@@ -806,13 +820,19 @@ GetToken(char * c, char * str)
                 }
                 else if (IsId(Token->Value))
                 {
-                    BOOLEAN WasFound = FALSE;
-                    BOOLEAN HasBang  = strstr(Token->Value, "!") != 0;
-                    UINT64  Address  = 0;
+                    BOOLEAN WasFound        = FALSE;
+                    BOOLEAN HasBang         = strstr(Token->Value, "!") != 0;
+                    UINT64  Address         = 0;
+                    UINT32  RelocationIndex = 0;
 
                     if (HasBang)
                     {
                         Address = ScriptEngineConvertNameToAddress(Token->Value, &WasFound);
+
+                        if (WasFound)
+                        {
+                            RelocationIndex = ScriptEngineRecordSymbolRelocation(Token->Value, Address);
+                        }
                     }
 
                     if (WasFound)
@@ -821,6 +841,7 @@ GetToken(char * c, char * str)
                         char str[20] = {0};
                         sprintf(str, "%llx", Address);
                         Token = NewToken(HEX, str);
+                        Token->RelocationIndex = RelocationIndex;
                     }
                     else
                     {
@@ -879,13 +900,19 @@ GetToken(char * c, char * str)
             }
             else
             {
-                BOOLEAN WasFound = FALSE;
-                BOOLEAN HasBang  = strstr(Token->Value, "!") != 0;
-                UINT64  Address  = 0;
+                BOOLEAN WasFound        = FALSE;
+                BOOLEAN HasBang         = strstr(Token->Value, "!") != 0;
+                UINT64  Address         = 0;
+                UINT32  RelocationIndex = 0;
 
                 if (HasBang)
                 {
                     Address = ScriptEngineConvertNameToAddress(Token->Value, &WasFound);
+
+                    if (WasFound)
+                    {
+                        RelocationIndex = ScriptEngineRecordSymbolRelocation(Token->Value, Address);
+                    }
                 }
 
                 if (WasFound)
@@ -894,6 +921,7 @@ GetToken(char * c, char * str)
                     char str[20] = {0};
                     sprintf(str, "%llx", Address);
                     Token = NewToken(HEX, str);
+                    Token->RelocationIndex = RelocationIndex;
                 }
                 else
                 {
@@ -22,6 +22,15 @@
 extern HWDBG_INSTANCE_INFORMATION g_HwdbgInstanceInfo;
 extern BOOLEAN                    g_HwdbgInstanceInfoIsValid;
 extern PVOID                      g_MessageHandler;
+extern PVOID                      g_NameToAddressCallback;
+extern PVOID                      g_ModuleBaseAddressCallback;
+extern UINT64 *                   g_SpecializationCandidates;
+extern UINT32                     g_SpecializationCandidatesCount;
+extern UINT32                     g_SpecializationCandidatesCapacity;
+extern BOOLEAN                    g_IsOperatorSpecializationDisabled;
+extern BOOLEAN                    g_IsParserContextReuseDisabled;
+extern UINT32                     g_SymbolRelocationsCount;
+extern SCRIPT_ENGINE_PARSER_CONTEXT g_ParserContext;
 
 /**
  * @brief Show messages
@@ -67,12 +76,38 @@ ShowMessages(const char * Fmt, ...)
 UINT64
 ScriptEngineConvertNameToAddress(const char * FunctionOrVariableName, PBOOLEAN WasFound)
 {
+    if (g_NameToAddressCallback != NULL)
+    {
+        return ((SCRIPT_ENGINE_SYMBOL_ADDRESS_CALLBACK)g_NameToAddressCallback)(FunctionOrVariableName, WasFound);
+    }
+
     //
     // A wrapper for pdb parser
     //
     return SymConvertNameToAddress(FunctionOrVariableName, WasFound);
 }
 
+/**
+ * @brief Get the base address of a loaded module
+ *
+ * @param ModuleName
+ * @param WasFound
+ * @return UINT64
+ */
+UINT64
+ScriptEngineGetModuleBaseAddress(const char * ModuleName, PBOOLEAN WasFound)
+{
+    if (g_ModuleBaseAddressCallback != NULL)
+    {
+        return ((SCRIPT_ENGINE_SYMBOL_ADDRESS_CALLBACK)g_ModuleBaseAddressCallback)(ModuleName, WasFound);
+    }
+
+    //
+    // A wrapper for pdb parser
+    //
+    return SymGetModuleBaseAddress(ModuleName, WasFound);
+}
+
 /**
  *
 
@@ -113,6 +148,24 @@ ScriptEngineSetTextMessageCallback(PVOID Handler)
     SymSetTextMessageCallback(Handler);
 }
 
+/**
+ * @brief Set the callbacks that resolve the module!symbol names and the
+ * bases of the modules instead of the pdb parser
+ * @details Both callbacks are SCRIPT_ENGINE_SYMBOL_ADDRESS_CALLBACK, NULL
+ * restores the pdb parser (it's used for testing the compiled scripts
+ * against different bases of the modules)
+ *
+ * @param NameToAddressCallback
+ * @param ModuleBaseAddressCallback
+ * @return VOID
+ */
+VOID
+ScriptEngineSetSymbolAddressCallbacks(PVOID NameToAddressCallback, PVOID ModuleBaseAddressCallback)
+{
+    g_NameToAddressCallback     = NameToAddressCallback;
+    g_ModuleBaseAddressCallback = ModuleBaseAddressCallback;
+}
+
 /**
  * @brief Unload all the previously loaded symbols
  *
@@ -281,6 +334,40 @@ ScriptEngineSymbolAbortLoading()
     SymbolAbortLoading();
 }
 
+/**
+ * @brief Set the routine that downloads the pdb files and the maximum
+ * number of the download workers
+ *
+ * @param Callback
+ * @param MaximumWorkers
+ *
+ * @return VOID
+ */
+VOID
+ScriptEngineSymbolSetPdbDownloadCallback(PVOID Callback, UINT32 MaximumWorkers)
+{
+    //
+    // A wrapper for testing the downloads of the pdb files
+    //
+    SymSetPdbDownloadCallback(Callback, MaximumWorkers);
+}
+
+/**
+ * @brief Enable or disable the cache of the type members
+ *
+ * @param Enable
+ *
+ * @return VOID
+ */
+VOID
+ScriptEngineSymbolSetTypeMembersCache(BOOLEAN Enable)
+{
+    //
+    // A wrapper for testing the cache of the type members
+    //
+    SymSetTypeMembersCache(Enable);
+}
+
 /**
  * @brief Convert file to pdb attributes for symbols
  *
@@ -300,6 +387,94 @@ ScriptEngineConvertFileToPdbFileAndGuidAndAgeDetails(const char * LocalFilePath,
     return SymConvertFileToPdbFileAndGuidAndAgeDetails(LocalFilePath, PdbFilePath, GuidAndAgeDetails, Is32BitModule);
 }
 
+/**
+ * @brief Get the details of a (cached) PE image
+ *
+ * @param FilePath
+ * @param ImageDetails
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+ScriptEngineGetPeImageDetails(const WCHAR * FilePath, PPE_IMAGE_DETAILS ImageDetails)
+{
+    //
+    // A wrapper for the cached PE image reader
+    //
+    return SymPeGetImageDetails(FilePath, ImageDetails);
+}
+
+/**
+ * @brief Release the (pinned) PE image of ScriptEngineGetPeImageDetails
+ *
+ * @param ImageDetails
+ *
+ * @return VOID
+ */
+VOID
+ScriptEngineReleasePeImageDetails(PPE_IMAGE_DETAILS ImageDetails)
+{
+    //
+    // A wrapper for the cached PE image reader
+    //
+    SymPeReleaseImageDetails(ImageDetails);
+}
+
+/**
+ * @brief Prepare the parser context for a new parse
+ * @details Buffers are allocated by the first parse and are reused by
+ * the next parses
+ *
+ * @return PSCRIPT_ENGINE_PARSER_CONTEXT
+ */
+PSCRIPT_ENGINE_PARSER_CONTEXT
+ScriptEngineResetParserContext()
+{
+    if (g_ParserContext.IsInitialized && g_IsParserContextReuseDisabled)
+    {
+        //
+        // Allocate the buffers again (like the parses before the context)
+        //
+        RemoveTokenList(g_ParserContext.Stack);
+        RemoveTokenList(g_ParserContext.MatchedStack);
+        RemoveTokenList(g_ParserContext.BooleanExpressionStack);
+        RemoveTokenList(g_ParserContext.MainIdTable);
+        RemoveTokenList(g_ParserContext.MainFunctionParameterIdTable);
+        free(g_ParserContext.MainTempMap);
+
+        g_ParserContext.IsInitialized = FALSE;
+    }
+
+    if (!g_ParserContext.IsInitialized)
+    {
+        g_ParserContext.Stack                        = NewTokenList();
+        g_ParserContext.MatchedStack                 = NewTokenList();
+        g_ParserContext.BooleanExpressionStack       = NewTokenList();
+        g_ParserContext.MainIdTable                  = NewTokenList();
+        g_ParserContext.MainFunctionParameterIdTable = NewTokenList();
+        g_ParserContext.MainTempMap                  = calloc(MAX_TEMP_COUNT, 1);
+        g_ParserContext.IsInitialized                = TRUE;
+    }
+    else
+    {
+        //
+        // The lists are already emptied by the previous parse unless it's
+        // aborted, so these are normally no-op
+        //
+        ClearTokenList(g_ParserContext.Stack);
+        ClearTokenList(g_ParserContext.MatchedStack);
+        ClearTokenList(g_ParserContext.BooleanExpressionStack);
+        ClearTokenList(g_ParserContext.MainIdTable);
+        ClearTokenList(g_ParserContext.MainFunctionParameterIdTable);
+        RtlZeroMemory(g_ParserContext.MainTempMap, MAX_TEMP_COUNT);
+    }
+
+    g_SpecializationCandidatesCount = 0;
+    g_SymbolRelocationsCount        = 0;
+
+    return &g_ParserContext;
+}
+
 /**
  * @brief The entry point of script engine
  *
@@ -309,17 +484,19 @@ ScriptEngineConvertFileToPdbFileAndGuidAndAgeDetails(const char * LocalFilePath,
 PVOID
 ScriptEngineParse(char * str)
 {
-    PTOKEN_LIST Stack = NewTokenList();
+    PSCRIPT_ENGINE_PARSER_CONTEXT Context = ScriptEngineResetParserContext();
+
+    PTOKEN_LIST Stack = Context->Stack;
 
-    PTOKEN_LIST    MatchedStack = NewTokenList();
+    PTOKEN_LIST    MatchedStack = Context->MatchedStack;
     PSYMBOL_BUFFER CodeBuffer   = NewSymbolBuffer();
 
     UserDefinedFunctionHead = malloc(sizeof(USER_DEFINED_FUNCTION_NODE));
     RtlZeroMemory(UserDefinedFunctionHead, sizeof(USER_DEFINED_FUNCTION_NODE));
     UserDefinedFunctionHead->Name                     = _strdup("main");
-    UserDefinedFunctionHead->IdTable                  = (unsigned long long)NewTokenList();
-    UserDefinedFunctionHead->FunctionParameterIdTable = (unsigned long long)NewTokenList();
-    UserDefinedFunctionHead->TempMap                  = calloc(MAX_TEMP_COUNT, 1);
+    UserDefinedFunctionHead->IdTable                  = (unsigned long long)Context->MainIdTable;
+    UserDefinedFunctionHead->FunctionParameterIdTable = (unsigned long long)Context->MainFunctionParameterIdTable;
+    UserDefinedFunctionHead->TempMap                  = Context->MainTempMap;
     UserDefinedFunctionHead->VariableType             = (unsigned long long)VARIABLE_TYPE_VOID;
 
     CurrentUserDefinedFunction = UserDefinedFunctionHead;
@@ -327,11 +504,12 @@ ScriptEngineParse(char * str)
     SCRIPT_ENGINE_ERROR_TYPE Error        = SCRIPT_ENGINE_ERROR_FREE;
     char *                   ErrorMessage = NULL;
 
-    static FirstCall = 1;
-    if (FirstCall)
+    //
+    // Global variables might be already created by loading a compiled script
+    //
+    if (GlobalIdTable == NULL)
     {
         GlobalIdTable = NewTokenList();
-        FirstCall     = 0;
     }
 
     PTOKEN TopToken = NewUnknownToken();
@@ -371,8 +549,8 @@ ScriptEngineParse(char * str)
         ErrorMessage        = HandleError(&Error, str);
         CodeBuffer->Message = ErrorMessage;
 
-        RemoveTokenList(Stack);
-        RemoveTokenList(MatchedStack);
+        ClearTokenList(Stack);
+        ClearTokenList(MatchedStack);
         RemoveToken(&CurrentIn);
         return (PVOID)CodeBuffer;
     }
@@ -582,17 +760,36 @@ ScriptEngineParse(char * str)
         //
         Symbol        = CodeBuffer->Head + 1;
         Symbol->Value = CurrentUserDefinedFunction->MaxTempNumber + CurrentUserDefinedFunction->LocalVariableNumber;
+
+        //
+        // hwdbg only understands the generic operators, otherwise replace
+        // operators with their operand-specialized forms
+        //
+        if (!g_HwdbgInstanceInfoIsValid && !g_IsOperatorSpecializationDisabled)
+        {
+            ScriptEngineSpecializeOperators(CodeBuffer);
+        }
     }
     CodeBuffer->Message = ErrorMessage;
 
-    if (Stack)
-        RemoveTokenList(Stack);
-
-    if (MatchedStack)
-        RemoveTokenList(MatchedStack);
+    //
+    // Empty the lists of the context for the next parse
+    //
+    ClearTokenList(Stack);
+    ClearTokenList(MatchedStack);
 
     if (UserDefinedFunctionHead)
     {
+        //
+        // Tables of the main function belong to the parser context
+        //
+        ClearTokenList(Context->MainIdTable);
+        ClearTokenList(Context->MainFunctionParameterIdTable);
+
+        UserDefinedFunctionHead->IdTable                  = 0;
+        UserDefinedFunctionHead->FunctionParameterIdTable = 0;
+        UserDefinedFunctionHead->TempMap                  = NULL;
+
         PUSER_DEFINED_FUNCTION_NODE Node = UserDefinedFunctionHead;
         while (Node)
         {
@@ -1191,6 +1388,7 @@ CodeGen(PTOKEN_LIST MatchedStack, PSYMBOL_BUFFER CodeBuffer, PTOKEN Operator, PS
         }
         else if (!strcmp(Operator->Value, "@MOV"))
         {
+            ScriptEngineAddSpecializationCandidate(CodeBuffer);
             PushSymbol(CodeBuffer, OperatorSymbol);
             Op0       = Pop(MatchedStack);
             Op0Symbol = ToSymbol(Op0, Error);
@@ -1515,6 +1713,7 @@ CodeGen(PTOKEN_LIST MatchedStack, PSYMBOL_BUFFER CodeBuffer, PTOKEN Operator, PS
         }
         else if (IsAssignmentOperator(Operator))
         {
+            ScriptEngineAddSpecializationCandidate(CodeBuffer);
             PushSymbol(CodeBuffer, OperatorSymbol);
             Op0       = Pop(MatchedStack);
             Op0Symbol = ToSymbol(Op0, Error);
@@ -1537,6 +1736,7 @@ CodeGen(PTOKEN_LIST MatchedStack, PSYMBOL_BUFFER CodeBuffer, PTOKEN Operator, PS
         }
         else if (IsTwoOperandOperator(Operator))
         {
+            ScriptEngineAddSpecializationCandidate(CodeBuffer);
             PushSymbol(CodeBuffer, OperatorSymbol);
             Op0       = Pop(MatchedStack);
             Op0Symbol = ToSymbol(Op0, Error);
@@ -1592,6 +1792,7 @@ CodeGen(PTOKEN_LIST MatchedStack, PSYMBOL_BUFFER CodeBuffer, PTOKEN Operator, PS
         else if (!strcmp(Operator->Value, "@JZ"))
         {
             // UINT64 CurrentPointer = CodeBuffer->Pointer;
+            ScriptEngineAddSpecializationCandidate(CodeBuffer);
             PushSymbol(CodeBuffer, OperatorSymbol);
 
             PSYMBOL JumpAddressSymbol = NewSymbol();
@@ -1787,6 +1988,7 @@ CodeGen(PTOKEN_LIST MatchedStack, PSYMBOL_BUFFER CodeBuffer, PTOKEN Operator, PS
             PSYMBOL JumpInstruction = NewSymbol();
             JumpInstruction->Type   = SYMBOL_SEMANTIC_RULE_TYPE;
             JumpInstruction->Value  = FUNC_JNZ;
+            ScriptEngineAddSpecializationCandidate(CodeBuffer);
             PushSymbol(CodeBuffer, JumpInstruction);
             RemoveSymbol(&JumpInstruction);
 
@@ -1869,6 +2071,7 @@ CodeGen(PTOKEN_LIST MatchedStack, PSYMBOL_BUFFER CodeBuffer, PTOKEN Operator, PS
             PSYMBOL JnzInstruction = NewSymbol();
             JnzInstruction->Type   = SYMBOL_SEMANTIC_RULE_TYPE;
             JnzInstruction->Value  = FUNC_JZ;
+            ScriptEngineAddSpecializationCandidate(CodeBuffer);
             PushSymbol(CodeBuffer, JnzInstruction);
             RemoveSymbol(&JnzInstruction);
 
@@ -2214,6 +2417,7 @@ CodeGen(PTOKEN_LIST MatchedStack, PSYMBOL_BUFFER CodeBuffer, PTOKEN Operator, PS
         }
         else if (IsType10Func(Operator))
         {
+            ScriptEngineAddSpecializationCandidate(CodeBuffer);
             PushSymbol(CodeBuffer, OperatorSymbol);
             Op0       = Pop(MatchedStack);
             Op0Symbol = ToSymbol(Op0, Error);
@@ -2465,7 +2669,10 @@ ScriptEngineBooleanExpresssionParse(
     char *                    c,
     PSCRIPT_ENGINE_ERROR_TYPE Error)
 {
-    PTOKEN_LIST Stack = NewTokenList();
+    //
+    // Boolean expressions are not nested, so they share the same stack
+    //
+    PTOKEN_LIST Stack = g_ParserContext.BooleanExpressionStack;
 
     PTOKEN State = NewToken(STATE_ID, "0");
     Push(Stack, State);
@@ -2617,8 +2824,7 @@ ScriptEngineBooleanExpresssionParse(
     if (EndToken)
         RemoveToken(&EndToken);
 
-    if (Stack)
-        RemoveTokenList(Stack);
+    ClearTokenList(Stack);
 
     if (CurrentIn)
         RemoveToken(&CurrentIn);
@@ -2804,6 +3010,12 @@ ToSymbol(PTOKEN Token, PSCRIPT_ENGINE_ERROR_TYPE Error)
     case HEX:
         Symbol->Value = HexToInt(Token->Value);
         SetType(&Symbol->Type, SYMBOL_NUM_TYPE);
+
+        //
+        // Len is not used by the numbers, so the resolved module!symbol
+        // addresses keep their relocation in it (see compiled-script.c)
+        //
+        Symbol->Len = Token->RelocationIndex;
         return Symbol;
 
     case OCTAL:
@@ -3538,6 +3750,32 @@ ScriptEngineSetHwdbgInstanceInfo(HWDBG_INSTANCE_INFORMATION * InstancInfo)
     return TRUE;
 }
 
+/**
+ * @brief Enable or disable replacing the operators by their
+ * operand-specialized forms after parsing
+ *
+ * @param Enable
+ * @return VOID
+ */
+VOID
+ScriptEngineSetOperatorSpecialization(BOOLEAN Enable)
+{
+    g_IsOperatorSpecializationDisabled = !Enable;
+}
+
+/**
+ * @brief Enable or disable reusing the buffers of the parser between
+ * the parses (the buffers are allocated for each parse if it's disabled)
+ *
+ * @param Enable
+ * @return VOID
+ */
+VOID
+ScriptEngineSetParserContextReuse(BOOLEAN Enable)
+{
+    g_IsParserContextReuseDisabled = !Enable;
+}
+
 /**
  * @brief Script Engine get number of operands
  *
@@ -3731,3 +3969,226 @@ FuncGetNumberOfOperands(UINT64 FuncType, UINT32 * NumberOfGetOperands, UINT32 *
 
     return Result;
 }
+
+/**
+ * @brief List of the operand-specialized forms of the operators
+ * @details Binary operators are placed as (Src0, Src1, Des), MOV as (Src0, Des)
+ * and conditional jumps as (Jump address, Condition)
+ *
+ */
+static const SCRIPT_ENGINE_SPECIALIZED_OPERATOR SpecializedOperatorsList[] = {
+    {FUNC_OR, 3, {SYMBOL_NUM_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_OR_TMP_TMP_IMM},
+    {FUNC_OR, 3, {SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_OR_TMP_TMP_TMP},
+    {FUNC_OR, 3, {SYMBOL_NUM_TYPE, SYMBOL_REGISTER_TYPE, SYMBOL_TEMP_TYPE}, FUNC_OR_TMP_REG_IMM},
+    {FUNC_XOR, 3, {SYMBOL_NUM_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_XOR_TMP_TMP_IMM},
+    {FUNC_XOR, 3, {SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_XOR_TMP_TMP_TMP},
+    {FUNC_XOR, 3, {SYMBOL_NUM_TYPE, SYMBOL_REGISTER_TYPE, SYMBOL_TEMP_TYPE}, FUNC_XOR_TMP_REG_IMM},
+    {FUNC_AND, 3, {SYMBOL_NUM_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_AND_TMP_TMP_IMM},
+    {FUNC_AND, 3, {SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_AND_TMP_TMP_TMP},
+    {FUNC_AND, 3, {SYMBOL_NUM_TYPE, SYMBOL_REGISTER_TYPE, SYMBOL_TEMP_TYPE}, FUNC_AND_TMP_REG_IMM},
+    {FUNC_ASR, 3, {SYMBOL_NUM_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_ASR_TMP_TMP_IMM},
+    {FUNC_ASR, 3, {SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_ASR_TMP_TMP_TMP},
+    {FUNC_ASR, 3, {SYMBOL_NUM_TYPE, SYMBOL_REGISTER_TYPE, SYMBOL_TEMP_TYPE}, FUNC_ASR_TMP_REG_IMM},
+    {FUNC_ASL, 3, {SYMBOL_NUM_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_ASL_TMP_TMP_IMM},
+    {FUNC_ASL, 3, {SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_ASL_TMP_TMP_TMP},
+    {FUNC_ASL, 3, {SYMBOL_NUM_TYPE, SYMBOL_REGISTER_TYPE, SYMBOL_TEMP_TYPE}, FUNC_ASL_TMP_REG_IMM},
+    {FUNC_ADD, 3, {SYMBOL_NUM_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_ADD_TMP_TMP_IMM},
+    {FUNC_ADD, 3, {SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_ADD_TMP_TMP_TMP},
+    {FUNC_ADD, 3, {SYMBOL_NUM_TYPE, SYMBOL_REGISTER_TYPE, SYMBOL_TEMP_TYPE}, FUNC_ADD_TMP_REG_IMM},
+    {FUNC_SUB, 3, {SYMBOL_NUM_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_SUB_TMP_TMP_IMM},
+    {FUNC_SUB, 3, {SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_SUB_TMP_TMP_TMP},
+    {FUNC_SUB, 3, {SYMBOL_NUM_TYPE, SYMBOL_REGISTER_TYPE, SYMBOL_TEMP_TYPE}, FUNC_SUB_TMP_REG_IMM},
+    {FUNC_MUL, 3, {SYMBOL_NUM_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_MUL_TMP_TMP_IMM},
+    {FUNC_MUL, 3, {SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_MUL_TMP_TMP_TMP},
+    {FUNC_MUL, 3, {SYMBOL_NUM_TYPE, SYMBOL_REGISTER_TYPE, SYMBOL_TEMP_TYPE}, FUNC_MUL_TMP_REG_IMM},
+    {FUNC_GT, 3, {SYMBOL_NUM_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_GT_TMP_TMP_IMM},
+    {FUNC_GT, 3, {SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_GT_TMP_TMP_TMP},
+    {FUNC_GT, 3, {SYMBOL_NUM_TYPE, SYMBOL_REGISTER_TYPE, SYMBOL_TEMP_TYPE}, FUNC_GT_TMP_REG_IMM},
+    {FUNC_LT, 3, {SYMBOL_NUM_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_LT_TMP_TMP_IMM},
+    {FUNC_LT, 3, {SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_LT_TMP_TMP_TMP},
+    {FUNC_LT, 3, {SYMBOL_NUM_TYPE, SYMBOL_REGISTER_TYPE, SYMBOL_TEMP_TYPE}, FUNC_LT_TMP_REG_IMM},
+    {FUNC_EGT, 3, {SYMBOL_NUM_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_EGT_TMP_TMP_IMM},
+    {FUNC_EGT, 3, {SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_EGT_TMP_TMP_TMP},
+    {FUNC_EGT, 3, {SYMBOL_NUM_TYPE, SYMBOL_REGISTER_TYPE, SYMBOL_TEMP_TYPE}, FUNC_EGT_TMP_REG_IMM},
+    {FUNC_ELT, 3, {SYMBOL_NUM_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_ELT_TMP_TMP_IMM},
+    {FUNC_ELT, 3, {SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_ELT_TMP_TMP_TMP},
+    {FUNC_ELT, 3, {SYMBOL_NUM_TYPE, SYMBOL_REGISTER_TYPE, SYMBOL_TEMP_TYPE}, FUNC_ELT_TMP_REG_IMM},
+    {FUNC_EQUAL, 3, {SYMBOL_NUM_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_EQUAL_TMP_TMP_IMM},
+    {FUNC_EQUAL, 3, {SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_EQUAL_TMP_TMP_TMP},
+    {FUNC_EQUAL, 3, {SYMBOL_NUM_TYPE, SYMBOL_REGISTER_TYPE, SYMBOL_TEMP_TYPE}, FUNC_EQUAL_TMP_REG_IMM},
+    {FUNC_NEQ, 3, {SYMBOL_NUM_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_NEQ_TMP_TMP_IMM},
+    {FUNC_NEQ, 3, {SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_NEQ_TMP_TMP_TMP},
+    {FUNC_NEQ, 3, {SYMBOL_NUM_TYPE, SYMBOL_REGISTER_TYPE, SYMBOL_TEMP_TYPE}, FUNC_NEQ_TMP_REG_IMM},
+    {FUNC_ADD, 3, {SYMBOL_NUM_TYPE, SYMBOL_GLOBAL_ID_TYPE, SYMBOL_GLOBAL_ID_TYPE}, FUNC_ADD_GLB_GLB_IMM},
+    {FUNC_SUB, 3, {SYMBOL_NUM_TYPE, SYMBOL_GLOBAL_ID_TYPE, SYMBOL_GLOBAL_ID_TYPE}, FUNC_SUB_GLB_GLB_IMM},
+    {FUNC_MOV, 2, {SYMBOL_NUM_TYPE, SYMBOL_TEMP_TYPE}, FUNC_MOV_TMP_IMM},
+    {FUNC_MOV, 2, {SYMBOL_TEMP_TYPE, SYMBOL_TEMP_TYPE}, FUNC_MOV_TMP_TMP},
+    {FUNC_MOV, 2, {SYMBOL_REGISTER_TYPE, SYMBOL_TEMP_TYPE}, FUNC_MOV_TMP_REG},
+    {FUNC_MOV, 2, {SYMBOL_TEMP_TYPE, SYMBOL_REGISTER_TYPE}, FUNC_MOV_REG_TMP},
+    {FUNC_MOV, 2, {SYMBOL_NUM_TYPE, SYMBOL_GLOBAL_ID_TYPE}, FUNC_MOV_GLB_IMM},
+    {FUNC_MOV, 2, {SYMBOL_TEMP_TYPE, SYMBOL_GLOBAL_ID_TYPE}, FUNC_MOV_GLB_TMP},
+    {FUNC_MOV, 2, {SYMBOL_GLOBAL_ID_TYPE, SYMBOL_TEMP_TYPE}, FUNC_MOV_TMP_GLB},
+    {FUNC_JZ, 2, {SYMBOL_NUM_TYPE, SYMBOL_TEMP_TYPE}, FUNC_JZ_TMP},
+    {FUNC_JNZ, 2, {SYMBOL_NUM_TYPE, SYMBOL_TEMP_TYPE}, FUNC_JNZ_TMP},
+};
+
+/**
+ * @brief Record the operator that is about to be pushed into the code buffer
+ * as a candidate for operand specialization
+ *
+ * @param CodeBuffer
+ * @return VOID
+ */
+VOID
+ScriptEngineAddSpecializationCandidate(PSYMBOL_BUFFER CodeBuffer)
+{
+    if (g_SpecializationCandidatesCount == g_SpecializationCandidatesCapacity)
+    {
+        UINT32   NewCapacity = g_SpecializationCandidatesCapacity ? g_SpecializationCandidatesCapacity * 2 : 64;
+        UINT64 * NewBuffer   = (UINT64 *)realloc(g_SpecializationCandidates, NewCapacity * sizeof(UINT64));
+
+        if (NewBuffer == NULL)
+        {
+            //
+            // Not specializing an operator is not an error, it just runs the generic form
+            //
+            return;
+        }
+
+        g_SpecializationCandidates         = NewBuffer;
+        g_SpecializationCandidatesCapacity = NewCapacity;
+    }
+
+    g_SpecializationCandidates[g_SpecializationCandidatesCount++] = CodeBuffer->Pointer;
+}
+
+/**
+ * @brief Replace strcmp of $pname and a string by the comparison of the
+ * interned ids
+ * @details strcmp is placed as (Src0, Src1, Des) where Src1 is the first
+ * argument, and a string operand takes more than one symbol
+ *
+ * @param CodeBuffer
+ * @param Operator
+ * @return VOID
+ */
+static VOID
+ScriptEngineSpecializeProcessNameComparison(PSYMBOL_BUFFER CodeBuffer, PSYMBOL Operator)
+{
+    PSYMBOL Src0 = Operator + 1;
+    PSYMBOL Src1;
+    PSYMBOL Des;
+    PSYMBOL String;
+    PSYMBOL End = CodeBuffer->Head + CodeBuffer->Pointer;
+
+    if (Src0 >= End)
+    {
+        return;
+    }
+
+    Src1 = Src0 + 1 + (Src0->Type == SYMBOL_STRING_TYPE ? (SIZE_SYMBOL_WITHOUT_LEN + Src0->Len) / sizeof(SYMBOL) : 0);
+
+    if (Src1 >= End)
+    {
+        return;
+    }
+
+    Des = Src1 + 1 + (Src1->Type == SYMBOL_STRING_TYPE ? (SIZE_SYMBOL_WITHOUT_LEN + Src1->Len) / sizeof(SYMBOL) : 0);
+
+    if (Des >= End || Des->Type != SYMBOL_TEMP_TYPE)
+    {
+        return;
+    }
+
+    if (Src0->Type == SYMBOL_STRING_TYPE && Src1->Type == SYMBOL_PSEUDO_REG_TYPE && Src1->Value == PSEUDO_REGISTER_PNAME)
+    {
+        String = Src0;
+    }
+    else if (Src0->Type == SYMBOL_PSEUDO_REG_TYPE && Src0->Value == PSEUDO_REGISTER_PNAME && Src1->Type == SYMBOL_STRING_TYPE)
+    {
+        String = Src1;
+    }
+    else
+    {
+        return;
+    }
+
+    //
+    // The interned ids keep the first 15 characters (the maximum length of
+    // the process names)
+    //
+    if (strnlen((const char *)&String->Value, String->Len) > 15)
+    {
+        return;
+    }
+
+    Operator->Value = String == Src0 ? FUNC_STRCMP_TMP_PNAME_STR : FUNC_STRCMP_TMP_STR_PNAME;
+}
+
+/**
+ * @brief Replace the recorded operators by their operand-specialized forms
+ * @details The layout and the number of operands are not changed, so jump
+ * addresses remain valid. It should be called after local ids are converted
+ * to temps
+ *
+ * @param CodeBuffer
+ * @return VOID
+ */
+VOID
+ScriptEngineSpecializeOperators(PSYMBOL_BUFFER CodeBuffer)
+{
+    PSYMBOL Operator;
+    PSYMBOL Operands;
+    UINT32  i;
+    UINT32  j;
+    UINT32  k;
+
+    for (i = 0; i < g_SpecializationCandidatesCount; i++)
+    {
+        if (g_SpecializationCandidates[i] >= CodeBuffer->Pointer)
+        {
+            continue;
+        }
+
+        Operator = CodeBuffer->Head + g_SpecializationCandidates[i];
+        Operands = Operator + 1;
+
+        if (Operator->Type != SYMBOL_SEMANTIC_RULE_TYPE)
+        {
+            continue;
+        }
+
+        if (Operator->Value == FUNC_STRCMP)
+        {
+            ScriptEngineSpecializeProcessNameComparison(CodeBuffer, Operator);
+            continue;
+        }
+
+        for (j = 0; j < sizeof(SpecializedOperatorsList) / sizeof(SpecializedOperatorsList[0]); j++)
+        {
+            if (SpecializedOperatorsList[j].GenericOperator != Operator->Value ||
+                g_SpecializationCandidates[i] + SpecializedOperatorsList[j].NumberOfOperands >= CodeBuffer->Pointer)
+            {
+                continue;
+            }
+
+            //
+            // Operands are checked in order, so a string operand (which takes more
+            // than one symbol) stops the check before reading past it
+            //
+            for (k = 0; k < SpecializedOperatorsList[j].NumberOfOperands; k++)
+            {
+                if (Operands[k].Type != SpecializedOperatorsList[j].OperandTypes[k])
+                {
+                    break;
+                }
+            }
+
+            if (k == SpecializedOperatorsList[j].NumberOfOperands)
+            {
+                Operator->Value = SpecializedOperatorsList[j].SpecializedOperator;
+                break;
+            }
+        }
+    }
+}
@@ -73,6 +73,7 @@ typedef struct _TOKEN
     unsigned int       Len;
     unsigned int       MaxLen;
     unsigned long long VariableType;
+    unsigned int       RelocationIndex;
 } TOKEN, *PTOKEN;
 
 /**
@@ -125,6 +126,9 @@ NewTokenList(void);
 void
 RemoveTokenList(PTOKEN_LIST TokenList);
 
+void
+ClearTokenList(PTOKEN_LIST TokenList);
+
 void
 PrintTokenList(PTOKEN_LIST TokenList);
 
@@ -273,4 +277,22 @@ typedef struct USER_DEFINED_FUNCTION_NODE
     struct USER_DEFINED_FUNCTION_NODE * NextNode;
 } USER_DEFINED_FUNCTION_NODE, *PUSER_DEFINED_FUNCTION_NODE;
 
+/**
+ * @brief Buffers of the parser that are kept between the parses
+ * @details The lists are emptied at the end of each parse, so preparing
+ * the context for the next parse doesn't need any allocation
+ *
+ */
+typedef struct _SCRIPT_ENGINE_PARSER_CONTEXT
+{
+    BOOLEAN     IsInitialized;
+    PTOKEN_LIST Stack;
+    PTOKEN_LIST MatchedStack;
+    PTOKEN_LIST BooleanExpressionStack;
+    PTOKEN_LIST MainIdTable;
+    PTOKEN_LIST MainFunctionParameterIdTable;
+    char *      MainTempMap;
+
+} SCRIPT_ENGINE_PARSER_CONTEXT, *PSCRIPT_ENGINE_PARSER_CONTEXT;
+
 #endif // !COMMON_H
@@ -0,0 +1,121 @@
+/**
+ * @file compiled-script.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers for serializing and loading compiled scripts
+ * @details
+ * @version 0.11
+ * @date 2024-10-18
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//					Definitions                 //
+//////////////////////////////////////////////////
+
+/**
+ * @brief Magic of the compiled script files ('HDSC')
+ *
+ */
+#define SCRIPT_ENGINE_COMPILED_SCRIPT_MAGIC 0x43534448
+
+/**
+ * @brief Version of the compiled script format
+ *
+ */
+#define SCRIPT_ENGINE_COMPILED_SCRIPT_VERSION 1
+
+/**
+ * @brief Maximum length of a module name in the relocations
+ *
+ */
+#define SCRIPT_ENGINE_RELOCATION_MODULE_NAME_MAX 64
+
+//////////////////////////////////////////////////
+//					Structures                  //
+//////////////////////////////////////////////////
+
+/**
+ * @brief Callback that resolves a module!symbol name or the base of a module
+ *
+ */
+typedef UINT64 (*SCRIPT_ENGINE_SYMBOL_ADDRESS_CALLBACK)(const char * Name, PBOOLEAN WasFound);
+
+/**
+ * @brief A module!symbol address that is resolved while scanning
+ * @details The number symbols that are created from the resolved address
+ * keep the index of this relocation plus one in their Len
+ *
+ */
+typedef struct _SCRIPT_ENGINE_SYMBOL_RELOCATION
+{
+    UINT64 Address;
+    UINT64 Offset;
+    CHAR   ModuleName[SCRIPT_ENGINE_RELOCATION_MODULE_NAME_MAX];
+
+} SCRIPT_ENGINE_SYMBOL_RELOCATION, *PSCRIPT_ENGINE_SYMBOL_RELOCATION;
+
+/**
+ * @brief Types of the relocations in the compiled scripts
+ *
+ */
+typedef enum _SCRIPT_ENGINE_COMPILED_RELOCATION_TYPE
+{
+    SCRIPT_ENGINE_COMPILED_RELOCATION_MODULE = 1,
+    SCRIPT_ENGINE_COMPILED_RELOCATION_GLOBAL_VARIABLE,
+
+} SCRIPT_ENGINE_COMPILED_RELOCATION_TYPE;
+
+/**
+ * @brief Header of the compiled scripts
+ * @details All of the offsets are from the start of the header, names
+ * are offsets in the strings table
+ *
+ */
+typedef struct _SCRIPT_ENGINE_COMPILED_SCRIPT_HEADER
+{
+    UINT32 Magic;
+    UINT32 Version;
+    UINT64 OperatorsFingerprint;
+    UINT32 NumberOfSymbols;
+    UINT32 SymbolsOffset;
+    UINT32 NumberOfNames;
+    UINT32 NamesOffset;
+    UINT32 NumberOfRelocations;
+    UINT32 RelocationsOffset;
+    UINT32 StringsSize;
+    UINT32 StringsOffset;
+
+} SCRIPT_ENGINE_COMPILED_SCRIPT_HEADER, *PSCRIPT_ENGINE_COMPILED_SCRIPT_HEADER;
+
+/**
+ * @brief A relocation entry in the compiled scripts
+ * @details NameIndex points to a module name for module relocations
+ * or to a global variable name for global variable relocations
+ *
+ */
+typedef struct _SCRIPT_ENGINE_COMPILED_RELOCATION
+{
+    UINT32 Type;
+    UINT32 SymbolIndex;
+    UINT32 NameIndex;
+    UINT32 Reserved;
+    UINT64 Offset;
+
+} SCRIPT_ENGINE_COMPILED_RELOCATION, *PSCRIPT_ENGINE_COMPILED_RELOCATION;
+
+//////////////////////////////////////////////////
+//				    Functions                   //
+//////////////////////////////////////////////////
+
+//
+// Some of the functions are exported at HyperDbgScriptImports.h
+//
+
+UINT64
+ScriptEngineGetModuleBaseAddress(const char * ModuleName, PBOOLEAN WasFound);
+
+UINT32
+ScriptEngineRecordSymbolRelocation(const char * Name, UINT64 Address);
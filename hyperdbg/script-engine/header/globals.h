@@ -34,3 +34,75 @@ BOOLEAN g_HwdbgInstanceInfoIsValid;
  *
  */
 PVOID g_MessageHandler;
+
+/**
+ * @brief Callback that resolves the module!symbol names instead of the
+ * pdb parser (if not NULL)
+ *
+ */
+PVOID g_NameToAddressCallback;
+
+/**
+ * @brief Callback that resolves the bases of the modules instead of the
+ * pdb parser (if not NULL)
+ *
+ */
+PVOID g_ModuleBaseAddressCallback;
+
+/**
+ * @brief Buffers of the parser that are reused by each parse
+ *
+ */
+SCRIPT_ENGINE_PARSER_CONTEXT g_ParserContext;
+
+/**
+ * @brief Indexes of the operators in the code buffer that might be
+ * replaced by their operand-specialized forms after parsing
+ *
+ */
+UINT64 * g_SpecializationCandidates;
+
+/**
+ * @brief Number of the recorded specialization candidates
+ *
+ */
+UINT32 g_SpecializationCandidatesCount;
+
+/**
+ * @brief Capacity of the specialization candidates buffer
+ *
+ */
+UINT32 g_SpecializationCandidatesCapacity;
+
+/**
+ * @brief Whether replacing the operators by their operand-specialized
+ * forms is disabled (the generic forms are the reference of the tests)
+ *
+ */
+BOOLEAN g_IsOperatorSpecializationDisabled;
+
+/**
+ * @brief Whether the buffers of the parser are allocated for each parse
+ * instead of reusing them (for comparing them in the benchmarks)
+ *
+ */
+BOOLEAN g_IsParserContextReuseDisabled;
+
+/**
+ * @brief Addresses of the module!symbol names that are resolved while
+ * parsing the last script
+ *
+ */
+PSCRIPT_ENGINE_SYMBOL_RELOCATION g_SymbolRelocations;
+
+/**
+ * @brief Number of the recorded symbol relocations
+ *
+ */
+UINT32 g_SymbolRelocationsCount;
+
+/**
+ * @brief Capacity of the symbol relocations buffer
+ *
+ */
+UINT32 g_SymbolRelocationsCapacity;
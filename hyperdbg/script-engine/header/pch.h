@@ -40,6 +40,7 @@
 #include "SDK/headers/HardwareDebugger.h"
 #include "common.h"
 #include "scanner.h"
+#include "compiled-script.h"
 #include "globals.h"
 #include "../include/SDK/headers/ScriptEngineCommonDefinitions.h"
 #include "script-engine.h"
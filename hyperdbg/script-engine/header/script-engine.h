@@ -31,9 +31,27 @@ typedef enum _SCRIPT_ENGINE_ERROR_TYPE
 } SCRIPT_ENGINE_ERROR_TYPE,
     *PSCRIPT_ENGINE_ERROR_TYPE;
 
+/**
+ * @brief Describes an operand-specialized form of an operator
+ * @details Operand types are listed in the order that operands are
+ * placed in the code buffer after the operator
+ *
+ */
+typedef struct _SCRIPT_ENGINE_SPECIALIZED_OPERATOR
+{
+    UINT64 GenericOperator;
+    UINT32 NumberOfOperands;
+    UINT64 OperandTypes[3];
+    UINT64 SpecializedOperator;
+
+} SCRIPT_ENGINE_SPECIALIZED_OPERATOR, *PSCRIPT_ENGINE_SPECIALIZED_OPERATOR;
+
 VOID
 ShowMessages(const char * Fmt, ...);
 
+PSCRIPT_ENGINE_PARSER_CONTEXT
+ScriptEngineResetParserContext();
+
 PSYMBOL
 NewSymbol(void);
 
@@ -120,4 +138,10 @@ GetUserDefinedFunctionNode(PTOKEN Token);
 BOOLEAN
 FuncGetNumberOfOperands(UINT64 FuncType, UINT32 * NumberOfGetOperands, UINT32 * NumberOfSetOperands);
 
+VOID
+ScriptEngineAddSpecializationCandidate(PSYMBOL_BUFFER CodeBuffer);
+
+VOID
+ScriptEngineSpecializeOperators(PSYMBOL_BUFFER CodeBuffer);
+
 #endif
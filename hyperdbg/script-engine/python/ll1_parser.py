@@ -62,6 +62,7 @@ class LL1Parser:
         self.VariableTypeList = []
         self.keywordList = []
         self.SemantiRulesList = []
+        self.SpecializedOperators = []
         self.AssignmentOperator = []
 
 
@@ -359,6 +360,9 @@ class LL1Parser:
                 elif L[0][1:] == "SemantiRules":
                     self.SemantiRulesList += Elements
                     continue
+                elif L[0][1:] == "SpecializedOperators":
+                    self.SpecializedOperators += Elements
+                    continue
                 elif L[0][1:] == "Registers":
                     self.RegistersList += Elements
                     continue
@@ -483,6 +487,19 @@ class LL1Parser:
                     
                 CheckForDuplicateList.append(X)
                 Counter += 1
+
+        #
+        # Specialized operators are only used by the software evaluator, so they
+        # come after all the other functions and are not exported to hwdbg
+        #
+        self.CommonHeaderFile.write("#define " + "FUNC_SPECIALIZED_OPERATORS_START " + str(Counter) + "\n")
+
+        for X in self.SpecializedOperators:
+
+            if X not in CheckForDuplicateList:
+                self.CommonHeaderFile.write("#define " + "FUNC_" + X.upper() + " " + str(Counter) + "\n")
+                CheckForDuplicateList.append(X)
+                Counter += 1
                 
             
         self.CommonHeaderFileScala.write(" = Value\n  }\n} ")
@@ -531,6 +548,11 @@ class LL1Parser:
                 self.CommonHeaderFile.write("\"" + "FUNC_" + X.upper() + "\"" + ",\n")
                 CheckForDuplicateList.append(X)
 
+        for X in self.SpecializedOperators:
+            if X not in CheckForDuplicateList:
+                self.CommonHeaderFile.write("\"" + "FUNC_" + X.upper() + "\"" + ",\n")
+                CheckForDuplicateList.append(X)
+
         self.CommonHeaderFile.write("};\n")
 
 
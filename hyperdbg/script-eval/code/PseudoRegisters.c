@@ -11,6 +11,90 @@
  *
  */
 #include "pch.h"
+#include "../script-eval/header/ScriptEngineInternalHeader.h"
+
+/**
+ * @brief Number of characters of a name that are kept in its interned id
+ * @details process names in EPROCESS are not longer than 15 characters
+ *
+ */
+#define PSEUDO_REGISTERS_NAME_ID_LENGTH 16
+
+/**
+ * @brief The bias of the characters in the interned ids, so comparing the ids
+ * gives the same order as strcmp (the strcmp of the kernel compares signed
+ * characters, while the strcmp of the user-mode compares unsigned characters)
+ *
+ */
+#ifdef SCRIPT_ENGINE_KERNEL_MODE
+#    define PSEUDO_REGISTERS_NAME_ID_CHARACTER_BIAS 0x80
+#else
+#    define PSEUDO_REGISTERS_NAME_ID_CHARACTER_BIAS 0x0
+#endif // SCRIPT_ENGINE_KERNEL_MODE
+
+#ifdef SCRIPT_ENGINE_KERNEL_MODE
+
+/**
+ * @brief Get the memoized pseudo-registers of the current core
+ * @details The memo is discarded whenever the running thread is changed
+ *
+ * @return PPSEUDO_REGISTERS_MEMO
+ */
+static PPSEUDO_REGISTERS_MEMO
+ScriptEnginePseudoRegGetMemo()
+{
+    PPSEUDO_REGISTERS_MEMO Memo          = &g_DbgState[KeGetCurrentProcessorNumberEx(NULL)].PseudoRegistersMemo;
+    PVOID                  CurrentThread = (PVOID)KeGetCurrentThread();
+
+    if (Memo->OwnerThread != CurrentThread)
+    {
+        Memo->OwnerThread = CurrentThread;
+        Memo->ValidMask   = 0;
+    }
+
+    return Memo;
+}
+
+/**
+ * @brief Read a pseudo-register from the memo of the current core
+ *
+ * @param Memo
+ * @param PseudoRegister
+ * @param Value
+ *
+ * @return BOOLEAN
+ */
+static BOOLEAN
+ScriptEnginePseudoRegReadMemo(PPSEUDO_REGISTERS_MEMO Memo, UINT32 PseudoRegister, UINT64 * Value)
+{
+    if (Memo->ValidMask & (1 << PseudoRegister))
+    {
+        *Value = Memo->Values[PseudoRegister];
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/**
+ * @brief Save a pseudo-register in the memo of the current core
+ *
+ * @param Memo
+ * @param PseudoRegister
+ * @param Value
+ *
+ * @return UINT64
+ */
+static UINT64
+ScriptEnginePseudoRegWriteMemo(PPSEUDO_REGISTERS_MEMO Memo, UINT32 PseudoRegister, UINT64 Value)
+{
+    Memo->Values[PseudoRegister] = Value;
+    Memo->ValidMask |= (1 << PseudoRegister);
+
+    return Value;
+}
+
+#endif // SCRIPT_ENGINE_KERNEL_MODE
 
 //
 // *** Pseudo-registers ***
@@ -29,7 +113,15 @@ ScriptEnginePseudoRegGetTid()
 #endif // SCRIPT_ENGINE_USER_MODE
 
 #ifdef SCRIPT_ENGINE_KERNEL_MODE
-    return (UINT64)PsGetCurrentThreadId();
+    PPSEUDO_REGISTERS_MEMO Memo = ScriptEnginePseudoRegGetMemo();
+    UINT64                 Value;
+
+    if (ScriptEnginePseudoRegReadMemo(Memo, PSEUDO_REGISTER_TID, &Value))
+    {
+        return Value;
+    }
+
+    return ScriptEnginePseudoRegWriteMemo(Memo, PSEUDO_REGISTER_TID, (UINT64)PsGetCurrentThreadId());
 #endif // SCRIPT_ENGINE_KERNEL_MODE
 }
 
@@ -63,7 +155,15 @@ ScriptEnginePseudoRegGetPid()
 #endif // SCRIPT_ENGINE_USER_MODE
 
 #ifdef SCRIPT_ENGINE_KERNEL_MODE
-    return (UINT64)PsGetCurrentProcessId();
+    PPSEUDO_REGISTERS_MEMO Memo = ScriptEnginePseudoRegGetMemo();
+    UINT64                 Value;
+
+    if (ScriptEnginePseudoRegReadMemo(Memo, PSEUDO_REGISTER_PID, &Value))
+    {
+        return Value;
+    }
+
+    return ScriptEnginePseudoRegWriteMemo(Memo, PSEUDO_REGISTER_PID, (UINT64)PsGetCurrentProcessId());
 #endif // SCRIPT_ENGINE_KERNEL_MODE
 }
 
@@ -77,6 +177,17 @@ ScriptEnginePseudoRegGetPname()
 {
 #ifdef SCRIPT_ENGINE_USER_MODE
 
+    //
+    // The name of the current process doesn't change, so it's resolved once
+    //
+    static CHAR   CurrentModulePath[MAX_PATH] = {0};
+    static CHAR * CurrentProcessName          = NULL;
+
+    if (CurrentProcessName != NULL)
+    {
+        return CurrentProcessName;
+    }
+
     HANDLE Handle = OpenProcess(
         PROCESS_QUERY_INFORMATION | PROCESS_VM_READ,
         FALSE,
@@ -85,14 +196,14 @@ ScriptEnginePseudoRegGetPname()
 
     if (Handle)
     {
-        CHAR CurrentModulePath[MAX_PATH] = {0};
         if (GetModuleFileNameEx(Handle, 0, CurrentModulePath, MAX_PATH))
         {
             //
             // At this point, buffer contains the full path to the executable
             //
             CloseHandle(Handle);
-            return PathFindFileNameA(CurrentModulePath);
+            CurrentProcessName = PathFindFileNameA(CurrentModulePath);
+            return CurrentProcessName;
         }
         else
         {
@@ -112,10 +223,151 @@ ScriptEnginePseudoRegGetPname()
 #endif // SCRIPT_ENGINE_USER_MODE
 
 #ifdef SCRIPT_ENGINE_KERNEL_MODE
-    return CommonGetProcessNameFromProcessControlBlock(PsGetCurrentProcess());
+    PPSEUDO_REGISTERS_MEMO Memo = ScriptEnginePseudoRegGetMemo();
+    UINT64                 Value;
+
+    if (ScriptEnginePseudoRegReadMemo(Memo, PSEUDO_REGISTER_PNAME, &Value))
+    {
+        return (CHAR *)Value;
+    }
+
+    return (CHAR *)ScriptEnginePseudoRegWriteMemo(Memo, PSEUDO_REGISTER_PNAME, (UINT64)CommonGetProcessNameFromProcessControlBlock(PsGetCurrentProcess()));
+#endif // SCRIPT_ENGINE_KERNEL_MODE
+}
+
+/**
+ * @brief Get the interned id of a name
+ * @details the id is the first characters of the name (zero-padded) as two
+ * big-endian integers, so comparing two ids gives the same result as
+ * comparing the names by strcmp
+ *
+ * @param Name
+ * @param NameId
+ *
+ * @return VOID
+ */
+static VOID
+ScriptEnginePseudoRegGetNameId(const CHAR * Name, UINT64 * NameId)
+{
+    UINT8 Character;
+
+    NameId[0] = 0;
+    NameId[1] = 0;
+
+    for (UINT32 i = 0; i < PSEUDO_REGISTERS_NAME_ID_LENGTH; i++)
+    {
+        //
+        // The characters after the null-terminator are zero
+        //
+        Character = (UINT8)*Name;
+
+        if (Character != 0)
+        {
+            Name++;
+        }
+
+        NameId[i / sizeof(UINT64)] = (NameId[i / sizeof(UINT64)] << 8) |
+                                     (UINT8)(Character ^ PSEUDO_REGISTERS_NAME_ID_CHARACTER_BIAS);
+    }
+}
+
+/**
+ * @brief Get the interned id of $pname
+ *
+ * @param NameId
+ *
+ * @return BOOLEAN FALSE if the name of the process is not available
+ */
+static BOOLEAN
+ScriptEnginePseudoRegGetPnameId(UINT64 * NameId)
+{
+    CHAR * Pname;
+
+#ifdef SCRIPT_ENGINE_USER_MODE
+
+    Pname = ScriptEnginePseudoRegGetPname();
+
+    if (Pname == NULL)
+    {
+        return FALSE;
+    }
+
+    ScriptEnginePseudoRegGetNameId(Pname, NameId);
+
+    return TRUE;
+
+#endif // SCRIPT_ENGINE_USER_MODE
+
+#ifdef SCRIPT_ENGINE_KERNEL_MODE
+
+    PPSEUDO_REGISTERS_MEMO Memo;
+
+    Pname = ScriptEnginePseudoRegGetPname();
+
+    if (Pname == NULL)
+    {
+        return FALSE;
+    }
+
+    Memo = ScriptEnginePseudoRegGetMemo();
+
+    if ((Memo->ValidMask & (1 << PSEUDO_REGISTERS_MEMO_PNAME_ID)) == 0)
+    {
+        ScriptEnginePseudoRegGetNameId(Pname, Memo->PnameId);
+        Memo->ValidMask |= (1 << PSEUDO_REGISTERS_MEMO_PNAME_ID);
+    }
+
+    NameId[0] = Memo->PnameId[0];
+    NameId[1] = Memo->PnameId[1];
+
+    return TRUE;
+
 #endif // SCRIPT_ENGINE_KERNEL_MODE
 }
 
+/**
+ * @brief Compare $pname with a string by the interned ids
+ * @details the string should not be longer than 15 characters, the result
+ * is the same as strcmp
+ *
+ * @param String
+ * @param IsPnameFirst Whether $pname is the first argument of strcmp
+ *
+ * @return UINT64
+ */
+UINT64
+ScriptEnginePseudoRegComparePname(const CHAR * String, BOOLEAN IsPnameFirst)
+{
+    UINT64 PnameId[2];
+    UINT64 StringId[2];
+    INT32  Result;
+
+    if (!ScriptEnginePseudoRegGetPnameId(PnameId))
+    {
+        //
+        // Let strcmp handle the invalid name
+        //
+        return IsPnameFirst ? ScriptEngineFunctionStrcmp(ScriptEnginePseudoRegGetPname(), String) : ScriptEngineFunctionStrcmp(String, ScriptEnginePseudoRegGetPname());
+    }
+
+    ScriptEnginePseudoRegGetNameId(String, StringId);
+
+    if (PnameId[0] != StringId[0])
+    {
+        Result = PnameId[0] < StringId[0] ? -1 : 1;
+    }
+    else if (PnameId[1] != StringId[1])
+    {
+        Result = PnameId[1] < StringId[1] ? -1 : 1;
+    }
+    else
+    {
+        Result = 0;
+    }
+
+    return (UINT64)(INT64)(IsPnameFirst ? Result : -Result);
+}
+
 /**
  * @brief Implementation of $proc pseudo-register
  *
@@ -129,7 +381,15 @@ ScriptEnginePseudoRegGetProc()
 #endif // SCRIPT_ENGINE_USER_MODE
 
 #ifdef SCRIPT_ENGINE_KERNEL_MODE
-    return (UINT64)PsGetCurrentProcess();
+    PPSEUDO_REGISTERS_MEMO Memo = ScriptEnginePseudoRegGetMemo();
+    UINT64                 Value;
+
+    if (ScriptEnginePseudoRegReadMemo(Memo, PSEUDO_REGISTER_PROC, &Value))
+    {
+        return Value;
+    }
+
+    return ScriptEnginePseudoRegWriteMemo(Memo, PSEUDO_REGISTER_PROC, (UINT64)PsGetCurrentProcess());
 #endif // SCRIPT_ENGINE_KERNEL_MODE
 }
 
@@ -146,7 +406,15 @@ ScriptEnginePseudoRegGetThread()
 #endif // SCRIPT_ENGINE_USER_MODE
 
 #ifdef SCRIPT_ENGINE_KERNEL_MODE
-    return (UINT64)PsGetCurrentThread();
+    PPSEUDO_REGISTERS_MEMO Memo = ScriptEnginePseudoRegGetMemo();
+    UINT64                 Value;
+
+    if (ScriptEnginePseudoRegReadMemo(Memo, PSEUDO_REGISTER_THREAD, &Value))
+    {
+        return Value;
+    }
+
+    return ScriptEnginePseudoRegWriteMemo(Memo, PSEUDO_REGISTER_THREAD, (UINT64)PsGetCurrentThread());
 #endif // SCRIPT_ENGINE_KERNEL_MODE
 }
 
@@ -229,6 +497,16 @@ ScriptEnginePseudoRegGetPeb()
     LPCWSTR NTDLL_NAME       = L"ntdll.dll";
     LPCSTR  NTQUERYINFO_NAME = "NtQueryInformationProcess";
 
+    //
+    // The PEB of the current process doesn't change, so it's resolved once
+    //
+    static UINT64 CurrentProcessPeb = NULL64_ZERO;
+
+    if (CurrentProcessPeb != NULL64_ZERO)
+    {
+        return CurrentProcessPeb;
+    }
+
     HMODULE  NtdllMod;
     HANDLE   ThisProcess;
     NTSTATUS NtCallRet;
@@ -267,7 +545,9 @@ ScriptEnginePseudoRegGetPeb()
     //
     PebPtr = (struct PEB *)BasicInfo.PebBaseAddress;
 
-    return (UINT64)PebPtr;
+    CurrentProcessPeb = (UINT64)PebPtr;
+
+    return CurrentProcessPeb;
 
 #endif // SCRIPT_ENGINE_USER_MODE
 
@@ -293,7 +573,15 @@ ScriptEnginePseudoRegGetTeb()
 #endif // SCRIPT_ENGINE_USER_MODE
 
 #ifdef SCRIPT_ENGINE_KERNEL_MODE
-    return (UINT64)PsGetCurrentThreadTeb();
+    PPSEUDO_REGISTERS_MEMO Memo = ScriptEnginePseudoRegGetMemo();
+    UINT64                 Value;
+
+    if (ScriptEnginePseudoRegReadMemo(Memo, PSEUDO_REGISTER_TEB, &Value))
+    {
+        return Value;
+    }
+
+    return ScriptEnginePseudoRegWriteMemo(Memo, PSEUDO_REGISTER_TEB, (UINT64)PsGetCurrentThreadTeb());
 #endif // SCRIPT_ENGINE_KERNEL_MODE
 }
 
@@ -16,6 +16,181 @@
 extern BOOLEAN g_HwdbgInstanceInfoIsValid;
 #endif // defined(SCRIPT_ENGINE_USER_MODE) && defined(HYPERDBG_LIBHYPERDBG)
 
+/**
+ * @brief Sources below this value are indexes of the general purpose registers
+ * in GUEST_REGS, others are slots of the registers snapshot
+ *
+ */
+#define REGISTERS_SNAPSHOT_FIRST_SLOT 16
+
+/**
+ * @brief Shows where a register is read from and how it's extracted
+ *
+ */
+typedef struct _REGISTERS_SNAPSHOT_MAP
+{
+    UINT32 Source;
+    UINT32 Shift;
+    UINT64 Mask;
+
+} REGISTERS_SNAPSHOT_MAP, *PREGISTERS_SNAPSHOT_MAP;
+
+/**
+ * @brief Registers that are kept in each slot of the snapshot
+ *
+ */
+static const REGS_ENUM RegistersSnapshotSlots[SCRIPT_ENGINE_REGISTERS_SNAPSHOT_COUNT] = {
+    REGISTER_DS,
+    REGISTER_ES,
+    REGISTER_FS,
+    REGISTER_GS,
+    REGISTER_CS,
+    REGISTER_SS,
+    REGISTER_RFLAGS,
+    REGISTER_RIP,
+    REGISTER_IDTR,
+    REGISTER_LDTR,
+    REGISTER_GDTR,
+    REGISTER_TR,
+    REGISTER_CR0,
+    REGISTER_CR2,
+    REGISTER_CR3,
+    REGISTER_CR4,
+    REGISTER_CR8,
+    REGISTER_DR0,
+    REGISTER_DR1,
+    REGISTER_DR2,
+    REGISTER_DR3,
+    REGISTER_DR6,
+    REGISTER_DR7};
+
+/**
+ * @brief Source, shift and mask of each register (indexed by REGS_ENUM)
+ *
+ */
+static const REGISTERS_SNAPSHOT_MAP RegistersSnapshotMap[] = {
+    {0, 0, 0xffffffffffffffff}, // rax
+    {0, 0, LOWER_32_BITS}, // eax
+    {0, 0, LOWER_16_BITS}, // ax
+    {0, 8, LOWER_8_BITS}, // ah
+    {0, 0, LOWER_8_BITS}, // al
+    {1, 0, 0xffffffffffffffff}, // rcx
+    {1, 0, LOWER_32_BITS}, // ecx
+    {1, 0, LOWER_16_BITS}, // cx
+    {1, 8, LOWER_8_BITS}, // ch
+    {1, 0, LOWER_8_BITS}, // cl
+    {2, 0, 0xffffffffffffffff}, // rdx
+    {2, 0, LOWER_32_BITS}, // edx
+    {2, 0, LOWER_16_BITS}, // dx
+    {2, 8, LOWER_8_BITS}, // dh
+    {2, 0, LOWER_8_BITS}, // dl
+    {3, 0, 0xffffffffffffffff}, // rbx
+    {3, 0, LOWER_32_BITS}, // ebx
+    {3, 0, LOWER_16_BITS}, // bx
+    {3, 8, LOWER_8_BITS}, // bh
+    {3, 0, LOWER_8_BITS}, // bl
+    {4, 0, 0xffffffffffffffff}, // rsp
+    {4, 0, LOWER_32_BITS}, // esp
+    {4, 0, LOWER_16_BITS}, // sp
+    {4, 0, LOWER_8_BITS}, // spl
+    {5, 0, 0xffffffffffffffff}, // rbp
+    {5, 0, LOWER_32_BITS}, // ebp
+    {5, 0, LOWER_16_BITS}, // bp
+    {5, 0, LOWER_8_BITS}, // bpl
+    {6, 0, 0xffffffffffffffff}, // rsi
+    {6, 0, LOWER_32_BITS}, // esi
+    {6, 0, LOWER_16_BITS}, // si
+    {6, 0, LOWER_8_BITS}, // sil
+    {7, 0, 0xffffffffffffffff}, // rdi
+    {7, 0, LOWER_32_BITS}, // edi
+    {7, 0, LOWER_16_BITS}, // di
+    {7, 0, LOWER_8_BITS}, // dil
+    {8, 0, 0xffffffffffffffff}, // r8
+    {8, 0, LOWER_32_BITS}, // r8d
+    {8, 0, LOWER_16_BITS}, // r8w
+    {8, 8, LOWER_8_BITS}, // r8h
+    {8, 0, LOWER_8_BITS}, // r8l
+    {9, 0, 0xffffffffffffffff}, // r9
+    {9, 0, LOWER_32_BITS}, // r9d
+    {9, 0, LOWER_16_BITS}, // r9w
+    {9, 8, LOWER_8_BITS}, // r9h
+    {9, 0, LOWER_8_BITS}, // r9l
+    {10, 0, 0xffffffffffffffff}, // r10
+    {10, 0, LOWER_32_BITS}, // r10d
+    {10, 0, LOWER_16_BITS}, // r10w
+    {10, 8, LOWER_8_BITS}, // r10h
+    {10, 0, LOWER_8_BITS}, // r10l
+    {11, 0, 0xffffffffffffffff}, // r11
+    {11, 0, LOWER_32_BITS}, // r11d
+    {11, 0, LOWER_16_BITS}, // r11w
+    {11, 8, LOWER_8_BITS}, // r11h
+    {11, 0, LOWER_8_BITS}, // r11l
+    {12, 0, 0xffffffffffffffff}, // r12
+    {12, 0, LOWER_32_BITS}, // r12d
+    {12, 0, LOWER_16_BITS}, // r12w
+    {12, 8, LOWER_8_BITS}, // r12h
+    {12, 0, LOWER_8_BITS}, // r12l
+    {13, 0, 0xffffffffffffffff}, // r13
+    {13, 0, LOWER_32_BITS}, // r13d
+    {13, 0, LOWER_16_BITS}, // r13w
+    {13, 8, LOWER_8_BITS}, // r13h
+    {13, 0, LOWER_8_BITS}, // r13l
+    {14, 0, 0xffffffffffffffff}, // r14
+    {14, 0, LOWER_32_BITS}, // r14d
+    {14, 0, LOWER_16_BITS}, // r14w
+    {14, 8, LOWER_8_BITS}, // r14h
+    {14, 0, LOWER_8_BITS}, // r14l
+    {15, 0, 0xffffffffffffffff}, // r15
+    {15, 0, LOWER_32_BITS}, // r15d
+    {15, 0, LOWER_16_BITS}, // r15w
+    {15, 8, LOWER_8_BITS}, // r15h
+    {15, 0, LOWER_8_BITS}, // r15l
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 0, 0, 0xffffffffffffffff}, // ds
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 1, 0, 0xffffffffffffffff}, // es
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 2, 0, 0xffffffffffffffff}, // fs
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 3, 0, 0xffffffffffffffff}, // gs
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 4, 0, 0xffffffffffffffff}, // cs
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 5, 0, 0xffffffffffffffff}, // ss
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 6, 0, 0xffffffffffffffff}, // rflags
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 6, 0, LOWER_32_BITS}, // eflags
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 6, 0, LOWER_16_BITS}, // flags
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 6, 0, 1}, // cf
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 6, 2, 1}, // pf
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 6, 4, 1}, // af
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 6, 6, 1}, // zf
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 6, 7, 1}, // sf
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 6, 8, 1}, // tf
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 6, 9, 1}, // if
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 6, 10, 1}, // df
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 6, 11, 1}, // of
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 6, X86_FLAGS_IOPL_SHIFT, 0b11}, // iopl
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 6, 14, 1}, // nt
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 6, 16, 1}, // rf
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 6, 17, 1}, // vm
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 6, 18, 1}, // ac
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 6, 19, 1}, // vif
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 6, 20, 1}, // vip
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 6, 21, 1}, // id
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 7, 0, 0xffffffffffffffff}, // rip
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 7, 0, LOWER_32_BITS}, // eip
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 7, 0, LOWER_16_BITS}, // ip
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 8, 0, 0xffffffffffffffff}, // idtr
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 9, 0, 0xffffffffffffffff}, // ldtr
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 10, 0, 0xffffffffffffffff}, // gdtr
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 11, 0, 0xffffffffffffffff}, // tr
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 12, 0, 0xffffffffffffffff}, // cr0
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 13, 0, 0xffffffffffffffff}, // cr2
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 14, 0, 0xffffffffffffffff}, // cr3
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 15, 0, 0xffffffffffffffff}, // cr4
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 16, 0, 0xffffffffffffffff}, // cr8
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 17, 0, 0xffffffffffffffff}, // dr0
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 18, 0, 0xffffffffffffffff}, // dr1
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 19, 0, 0xffffffffffffffff}, // dr2
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 20, 0, 0xffffffffffffffff}, // dr3
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 21, 0, 0xffffffffffffffff}, // dr6
+    {REGISTERS_SNAPSHOT_FIRST_SLOT + 22, 0, 0xffffffffffffffff}, // dr7
+};
+
 /**
  * @brief Get the register value for hardware debugging
  *
@@ -2023,23 +2198,83 @@ SetRegValue(PGUEST_REGS GuestRegs, UINT32 RegisterId, UINT64 Value)
 
 /**
  * @brief Set the register value
+ * @details Registers are written immediately, if the register is kept in
+ * the snapshot, its entry is dropped so the next read fetches it again
  *
  * @param GuestRegs
+ * @param Snapshot
  * @param Symbol
  * @param Value
- * @param ActionBuffer
  *
  * @return BOOLEAN
  */
 BOOLEAN
-SetRegValueUsingSymbol(PGUEST_REGS GuestRegs, PSYMBOL Symbol, UINT64 Value)
+SetRegValueUsingSymbol(PGUEST_REGS GuestRegs, PSCRIPT_ENGINE_REGISTERS_SNAPSHOT Snapshot, PSYMBOL Symbol, UINT64 Value)
 {
 #if defined(SCRIPT_ENGINE_USER_MODE) && defined(HYPERDBG_LIBHYPERDBG)
-    if (g_HwdbgInstanceInfoIsValid == FALSE)
-        return SetRegValue(GuestRegs, (UINT32)Symbol->Value, Value);
-    else
+    if (g_HwdbgInstanceInfoIsValid)
         return SetRegValueHwdbg((UINT64 *)GuestRegs, (UINT32)Symbol->Value, Value);
-#else
+#endif // defined(SCRIPT_ENGINE_USER_MODE) && defined(HYPERDBG_LIBHYPERDBG)
+
+    if (Symbol->Value < sizeof(RegistersSnapshotMap) / sizeof(RegistersSnapshotMap[0]) &&
+        RegistersSnapshotMap[Symbol->Value].Source >= REGISTERS_SNAPSHOT_FIRST_SLOT)
+    {
+        Snapshot->ValidMask &= ~(1 << (RegistersSnapshotMap[Symbol->Value].Source - REGISTERS_SNAPSHOT_FIRST_SLOT));
+    }
+
     return SetRegValue(GuestRegs, (UINT32)Symbol->Value, Value);
+}
+
+/**
+ * @brief Get the register value using the snapshot of the current script run
+ * @details General purpose registers are directly loaded from the guest
+ * registers, other registers are read once and kept in the snapshot
+ *
+ * @param GuestRegs
+ * @param Snapshot
+ * @param RegId
+ * @return UINT64
+ */
+UINT64
+GetRegValueUsingSnapshot(PGUEST_REGS GuestRegs, PSCRIPT_ENGINE_REGISTERS_SNAPSHOT Snapshot, REGS_ENUM RegId)
+{
+    const REGISTERS_SNAPSHOT_MAP * Map;
+    UINT32                         Slot;
+    UINT64                         Value;
+
+#if defined(SCRIPT_ENGINE_USER_MODE) && defined(HYPERDBG_LIBHYPERDBG)
+    if (g_HwdbgInstanceInfoIsValid)
+    {
+        return GetRegValueHwdbg((UINT64 *)GuestRegs, RegId);
+    }
 #endif // defined(SCRIPT_ENGINE_USER_MODE) && defined(HYPERDBG_LIBHYPERDBG)
+
+    if ((UINT32)RegId >= sizeof(RegistersSnapshotMap) / sizeof(RegistersSnapshotMap[0]))
+    {
+        //
+        // Let the original routine show the error
+        //
+        return GetRegValue(GuestRegs, RegId);
+    }
+
+    Map = &RegistersSnapshotMap[RegId];
+
+    if (Map->Source < REGISTERS_SNAPSHOT_FIRST_SLOT)
+    {
+        Value = ((UINT64 *)GuestRegs)[Map->Source];
+    }
+    else
+    {
+        Slot = Map->Source - REGISTERS_SNAPSHOT_FIRST_SLOT;
+
+        if ((Snapshot->ValidMask & (1 << Slot)) == 0)
+        {
+            Snapshot->Registers[Slot] = GetRegValue(GuestRegs, RegistersSnapshotSlots[Slot]);
+            Snapshot->ValidMask |= (1 << Slot);
+        }
+
+        Value = Snapshot->Registers[Slot];
+    }
+
+    return (Value >> Map->Shift) & Map->Mask;
 }
@@ -116,7 +116,7 @@ GetValue(PGUEST_REGS                      GuestRegs,
         if (ReturnReference)
             return (UINT64)NULL; // Not reasonable, you should not dereference a register!
         else
-            return GetRegValue(GuestRegs, (REGS_ENUM)Symbol->Value);
+            return GetRegValueUsingSnapshot(GuestRegs, &ScriptGeneralRegisters->RegistersSnapshot, (REGS_ENUM)Symbol->Value);
 
     case SYMBOL_PSEUDO_REG_TYPE:
 
@@ -185,7 +185,7 @@ SetValue(PGUEST_REGS                       GuestRegs,
         ScriptGeneralRegisters->GlobalVariablesList[Symbol->Value] = Value;
         return;
     case SYMBOL_REGISTER_TYPE:
-        SetRegValueUsingSymbol(GuestRegs, Symbol, Value);
+        SetRegValueUsingSymbol(GuestRegs, &ScriptGeneralRegisters->RegistersSnapshot, Symbol, Value);
         return;
 
     case SYMBOL_STACK_INDEX_TYPE:
@@ -270,6 +270,290 @@ ScriptEngineGetOperatorName(PSYMBOL OperatorSymbol, CHAR * BufferForName)
     }
 }
 
+/**
+ * @brief Execute an operand-specialized operator
+ * @details The operand types of these operators are checked by the script
+ * engine at compile time, so operands are accessed directly instead of
+ * going through GetValue and SetValue
+ *
+ * @param GuestRegs General purpose registers
+ * @param ScriptGeneralRegisters of core specific (and global) variable holders
+ * @param Operator The operator symbol (operands are placed right after it)
+ * @param Indx Script Buffer index (points to the first operand)
+ * @return VOID
+ */
+VOID
+ScriptEngineExecuteSpecializedOperator(PGUEST_REGS                      GuestRegs,
+                                       PSCRIPT_ENGINE_GENERAL_REGISTERS ScriptGeneralRegisters,
+                                       PSYMBOL                          Operator,
+                                       UINT64 *                         Indx)
+{
+    PSYMBOL  Operands = Operator + 1;
+    PSYMBOL  Des;
+    UINT64 * Temps    = &ScriptGeneralRegisters->StackBuffer[ScriptGeneralRegisters->StackBaseIndx];
+    UINT64 * Globals  = ScriptGeneralRegisters->GlobalVariablesList;
+    UINT64   SrcVal0  = 0;
+    UINT64   SrcVal1  = 0;
+    UINT64   DesVal   = 0;
+
+    //
+    // Operators that are not three operand (Src0, Src1, Des) of temps
+    //
+    switch (Operator->Value)
+    {
+    case FUNC_MOV_TMP_IMM:
+
+        Temps[Operands[1].Value] = Operands[0].Value;
+        *Indx                    = *Indx + 2;
+        return;
+
+    case FUNC_MOV_TMP_TMP:
+
+        Temps[Operands[1].Value] = Temps[Operands[0].Value];
+        *Indx                    = *Indx + 2;
+        return;
+
+    case FUNC_MOV_TMP_REG:
+
+        Temps[Operands[1].Value] = GetRegValueUsingSnapshot(GuestRegs, &ScriptGeneralRegisters->RegistersSnapshot, (REGS_ENUM)Operands[0].Value);
+        *Indx                    = *Indx + 2;
+        return;
+
+    case FUNC_MOV_REG_TMP:
+
+        SetRegValueUsingSymbol(GuestRegs, &ScriptGeneralRegisters->RegistersSnapshot, &Operands[1], Temps[Operands[0].Value]);
+        *Indx = *Indx + 2;
+        return;
+
+    case FUNC_MOV_GLB_IMM:
+
+        Globals[Operands[1].Value] = Operands[0].Value;
+        *Indx                      = *Indx + 2;
+        return;
+
+    case FUNC_MOV_GLB_TMP:
+
+        Globals[Operands[1].Value] = Temps[Operands[0].Value];
+        *Indx                      = *Indx + 2;
+        return;
+
+    case FUNC_MOV_TMP_GLB:
+
+        Temps[Operands[1].Value] = Globals[Operands[0].Value];
+        *Indx                    = *Indx + 2;
+        return;
+
+    case FUNC_ADD_GLB_GLB_IMM:
+
+        Globals[Operands[2].Value] = Globals[Operands[1].Value] + Operands[0].Value;
+        *Indx                      = *Indx + 3;
+        return;
+
+    case FUNC_SUB_GLB_GLB_IMM:
+
+        Globals[Operands[2].Value] = Globals[Operands[1].Value] - Operands[0].Value;
+        *Indx                      = *Indx + 3;
+        return;
+
+    case FUNC_JZ_TMP:
+
+        if (Temps[Operands[1].Value] == 0)
+            *Indx = Operands[0].Value;
+        else
+            *Indx = *Indx + 2;
+        return;
+
+    case FUNC_JNZ_TMP:
+
+        if (Temps[Operands[1].Value] != 0)
+            *Indx = Operands[0].Value;
+        else
+            *Indx = *Indx + 2;
+        return;
+
+    case FUNC_STRCMP_TMP_PNAME_STR:
+
+        //
+        // strcmp($pname, "string"), the string is the first operand
+        //
+        Des               = Operands + 2 + (SIZE_SYMBOL_WITHOUT_LEN + Operands[0].Len) / sizeof(SYMBOL);
+        Temps[Des->Value] = ScriptEnginePseudoRegComparePname((const CHAR *)&Operands[0].Value, TRUE);
+        *Indx             = *Indx + (Des - Operands) + 1;
+        return;
+
+    case FUNC_STRCMP_TMP_STR_PNAME:
+
+        //
+        // strcmp("string", $pname), the string is the second operand
+        //
+        Des               = Operands + 2 + (SIZE_SYMBOL_WITHOUT_LEN + Operands[1].Len) / sizeof(SYMBOL);
+        Temps[Des->Value] = ScriptEnginePseudoRegComparePname((const CHAR *)&Operands[1].Value, FALSE);
+        *Indx             = *Indx + (Des - Operands) + 1;
+        return;
+    }
+
+    //
+    // Read the operands of the binary operators
+    //
+    switch (Operator->Value)
+    {
+    case FUNC_OR_TMP_TMP_IMM:
+    case FUNC_XOR_TMP_TMP_IMM:
+    case FUNC_AND_TMP_TMP_IMM:
+    case FUNC_ASR_TMP_TMP_IMM:
+    case FUNC_ASL_TMP_TMP_IMM:
+    case FUNC_ADD_TMP_TMP_IMM:
+    case FUNC_SUB_TMP_TMP_IMM:
+    case FUNC_MUL_TMP_TMP_IMM:
+    case FUNC_GT_TMP_TMP_IMM:
+    case FUNC_LT_TMP_TMP_IMM:
+    case FUNC_EGT_TMP_TMP_IMM:
+    case FUNC_ELT_TMP_TMP_IMM:
+    case FUNC_EQUAL_TMP_TMP_IMM:
+    case FUNC_NEQ_TMP_TMP_IMM:
+
+        SrcVal0 = Operands[0].Value;
+        SrcVal1 = Temps[Operands[1].Value];
+        break;
+
+    case FUNC_OR_TMP_TMP_TMP:
+    case FUNC_XOR_TMP_TMP_TMP:
+    case FUNC_AND_TMP_TMP_TMP:
+    case FUNC_ASR_TMP_TMP_TMP:
+    case FUNC_ASL_TMP_TMP_TMP:
+    case FUNC_ADD_TMP_TMP_TMP:
+    case FUNC_SUB_TMP_TMP_TMP:
+    case FUNC_MUL_TMP_TMP_TMP:
+    case FUNC_GT_TMP_TMP_TMP:
+    case FUNC_LT_TMP_TMP_TMP:
+    case FUNC_EGT_TMP_TMP_TMP:
+    case FUNC_ELT_TMP_TMP_TMP:
+    case FUNC_EQUAL_TMP_TMP_TMP:
+    case FUNC_NEQ_TMP_TMP_TMP:
+
+        SrcVal0 = Temps[Operands[0].Value];
+        SrcVal1 = Temps[Operands[1].Value];
+        break;
+
+    case FUNC_OR_TMP_REG_IMM:
+    case FUNC_XOR_TMP_REG_IMM:
+    case FUNC_AND_TMP_REG_IMM:
+    case FUNC_ASR_TMP_REG_IMM:
+    case FUNC_ASL_TMP_REG_IMM:
+    case FUNC_ADD_TMP_REG_IMM:
+    case FUNC_SUB_TMP_REG_IMM:
+    case FUNC_MUL_TMP_REG_IMM:
+    case FUNC_GT_TMP_REG_IMM:
+    case FUNC_LT_TMP_REG_IMM:
+    case FUNC_EGT_TMP_REG_IMM:
+    case FUNC_ELT_TMP_REG_IMM:
+    case FUNC_EQUAL_TMP_REG_IMM:
+    case FUNC_NEQ_TMP_REG_IMM:
+
+        SrcVal0 = Operands[0].Value;
+        SrcVal1 = GetRegValueUsingSnapshot(GuestRegs, &ScriptGeneralRegisters->RegistersSnapshot, (REGS_ENUM)Operands[1].Value);
+        break;
+
+    default:
+
+        //
+        // Shouldn't reach here
+        //
+        *Indx = *Indx + 3;
+        return;
+    }
+
+    switch (Operator->Value)
+    {
+    case FUNC_OR_TMP_TMP_IMM:
+    case FUNC_OR_TMP_TMP_TMP:
+    case FUNC_OR_TMP_REG_IMM:
+        DesVal = SrcVal1 | SrcVal0;
+        break;
+
+    case FUNC_XOR_TMP_TMP_IMM:
+    case FUNC_XOR_TMP_TMP_TMP:
+    case FUNC_XOR_TMP_REG_IMM:
+        DesVal = SrcVal1 ^ SrcVal0;
+        break;
+
+    case FUNC_AND_TMP_TMP_IMM:
+    case FUNC_AND_TMP_TMP_TMP:
+    case FUNC_AND_TMP_REG_IMM:
+        DesVal = SrcVal1 & SrcVal0;
+        break;
+
+    case FUNC_ASR_TMP_TMP_IMM:
+    case FUNC_ASR_TMP_TMP_TMP:
+    case FUNC_ASR_TMP_REG_IMM:
+        DesVal = SrcVal1 >> SrcVal0;
+        break;
+
+    case FUNC_ASL_TMP_TMP_IMM:
+    case FUNC_ASL_TMP_TMP_TMP:
+    case FUNC_ASL_TMP_REG_IMM:
+        DesVal = SrcVal1 << SrcVal0;
+        break;
+
+    case FUNC_ADD_TMP_TMP_IMM:
+    case FUNC_ADD_TMP_TMP_TMP:
+    case FUNC_ADD_TMP_REG_IMM:
+        DesVal = SrcVal1 + SrcVal0;
+        break;
+
+    case FUNC_SUB_TMP_TMP_IMM:
+    case FUNC_SUB_TMP_TMP_TMP:
+    case FUNC_SUB_TMP_REG_IMM:
+        DesVal = SrcVal1 - SrcVal0;
+        break;
+
+    case FUNC_MUL_TMP_TMP_IMM:
+    case FUNC_MUL_TMP_TMP_TMP:
+    case FUNC_MUL_TMP_REG_IMM:
+        DesVal = SrcVal1 * SrcVal0;
+        break;
+
+    case FUNC_GT_TMP_TMP_IMM:
+    case FUNC_GT_TMP_TMP_TMP:
+    case FUNC_GT_TMP_REG_IMM:
+        DesVal = (INT64)SrcVal1 > (INT64)SrcVal0;
+        break;
+
+    case FUNC_LT_TMP_TMP_IMM:
+    case FUNC_LT_TMP_TMP_TMP:
+    case FUNC_LT_TMP_REG_IMM:
+        DesVal = (INT64)SrcVal1 < (INT64)SrcVal0;
+        break;
+
+    case FUNC_EGT_TMP_TMP_IMM:
+    case FUNC_EGT_TMP_TMP_TMP:
+    case FUNC_EGT_TMP_REG_IMM:
+        DesVal = (INT64)SrcVal1 >= (INT64)SrcVal0;
+        break;
+
+    case FUNC_ELT_TMP_TMP_IMM:
+    case FUNC_ELT_TMP_TMP_TMP:
+    case FUNC_ELT_TMP_REG_IMM:
+        DesVal = (INT64)SrcVal1 <= (INT64)SrcVal0;
+        break;
+
+    case FUNC_EQUAL_TMP_TMP_IMM:
+    case FUNC_EQUAL_TMP_TMP_TMP:
+    case FUNC_EQUAL_TMP_REG_IMM:
+        DesVal = SrcVal1 == SrcVal0;
+        break;
+
+    case FUNC_NEQ_TMP_TMP_IMM:
+    case FUNC_NEQ_TMP_TMP_TMP:
+    case FUNC_NEQ_TMP_REG_IMM:
+        DesVal = SrcVal1 != SrcVal0;
+        break;
+    }
+
+    Temps[Operands[2].Value] = DesVal;
+    *Indx                    = *Indx + 3;
+}
+
 /**
  * @brief Execute the script buffer
  *
@@ -317,6 +601,15 @@ ScriptEngineExecute(PGUEST_REGS                      GuestRegs,
 #endif // SCRIPT_ENGINE_USER_MODE
     };
 
+    //
+    // Operand-specialized operators are placed after all the other functions
+    //
+    if (Operator->Value >= FUNC_SPECIALIZED_OPERATORS_START)
+    {
+        ScriptEngineExecuteSpecializedOperator(GuestRegs, ScriptGeneralRegisters, Operator, Indx);
+        return HasError;
+    }
+
     switch (Operator->Value)
     {
     case FUNC_ED:
@@ -722,6 +1015,12 @@ ScriptEngineExecute(PGUEST_REGS                      GuestRegs,
 
         ScriptEngineFunctionPause(ActionDetail,
                                   GuestRegs);
+
+        //
+        // Registers might be modified by the debugger while the core is halted
+        //
+        ScriptGeneralRegisters->RegistersSnapshot.ValidMask = 0;
+
         break;
 
     case FUNC_FLUSH:
@@ -735,6 +1034,11 @@ ScriptEngineExecute(PGUEST_REGS                      GuestRegs,
 
         ScriptEngineFunctionEventTraceInstrumentationStep();
 
+        //
+        // Stepping might change the guest registers
+        //
+        ScriptGeneralRegisters->RegistersSnapshot.ValidMask = 0;
+
         break;
 
     case FUNC_EVENT_TRACE_STEP:
@@ -742,6 +1046,11 @@ ScriptEngineExecute(PGUEST_REGS                      GuestRegs,
 
         ScriptEngineFunctionEventTraceStepIn();
 
+        //
+        // Stepping changes the trap flag in RFLAGS
+        //
+        ScriptGeneralRegisters->RegistersSnapshot.ValidMask = 0;
+
         break;
 
     case FUNC_EVENT_TRACE_STEP_OUT:
@@ -17,7 +17,10 @@
 //////////////////////////////////////////////////
 
 BOOLEAN
-SetRegValueUsingSymbol(PGUEST_REGS GuestRegs, PSYMBOL Symbol, UINT64 Value);
+SetRegValueUsingSymbol(PGUEST_REGS GuestRegs, PSCRIPT_ENGINE_REGISTERS_SNAPSHOT Snapshot, PSYMBOL Symbol, UINT64 Value);
+
+UINT64
+GetRegValueUsingSnapshot(PGUEST_REGS GuestRegs, PSCRIPT_ENGINE_REGISTERS_SNAPSHOT Snapshot, REGS_ENUM RegId);
 
 //////////////////////////////////////////////////
 //			    Pseudo-registers                //
@@ -35,6 +38,9 @@ ScriptEnginePseudoRegGetPid();
 CHAR *
 ScriptEnginePseudoRegGetPname();
 
+UINT64
+ScriptEnginePseudoRegComparePname(const CHAR * String, BOOLEAN IsPnameFirst);
+
 UINT64
 ScriptEnginePseudoRegGetProc();
 
@@ -0,0 +1,738 @@
+/**
+ * @file pe-image.cpp
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Cached reader of PE images
+ * @details Each image is mapped and its headers, section table, export
+ * table and debug directory are parsed once, the parsed image is cached
+ * by its path and last write time
+ * @version 0.11
+ * @date 2024-10-24
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#include "pch.h"
+
+//
+// Global Variables
+//
+static std::unordered_map<std::wstring, PPE_IMAGE> g_PeImagesCache;
+static SRWLOCK                                     g_PeImagesCacheLock  = SRWLOCK_INIT;
+static UINT64                                      g_PeImagesUseCounter = 0;
+
+/**
+ * @brief Get a pointer to a range of the file
+ *
+ * @param Image
+ * @param Offset file offset
+ * @param Size size of the range
+ *
+ * @return const UCHAR * NULL if the range is not in the file
+ */
+static const UCHAR *
+PeImageFileOffsetToPointer(PPE_IMAGE Image, UINT64 Offset, UINT64 Size)
+{
+    if (Offset > Image->Details.FileSize || Size > Image->Details.FileSize - Offset)
+    {
+        return NULL;
+    }
+
+    return Image->BaseAddress + Offset;
+}
+
+/**
+ * @brief Get a pointer to a range of the image based on its RVA
+ *
+ * @param Image
+ * @param Rva
+ * @param Size size of the range
+ *
+ * @return const UCHAR * NULL if the range is not in the file
+ */
+static const UCHAR *
+PeImageRvaToPointer(PPE_IMAGE Image, UINT32 Rva, UINT64 Size)
+{
+    for (UINT32 i = 0; i < Image->Details.NumberOfSections; i++)
+    {
+        const IMAGE_SECTION_HEADER * Section = &Image->Sections[i];
+        UINT32                       SectionSize =
+            Section->Misc.VirtualSize > Section->SizeOfRawData ? Section->Misc.VirtualSize : Section->SizeOfRawData;
+
+        if (Rva >= Section->VirtualAddress && Rva - Section->VirtualAddress < SectionSize)
+        {
+            return PeImageFileOffsetToPointer(Image, (UINT64)Section->PointerToRawData + (Rva - Section->VirtualAddress), Size);
+        }
+    }
+
+    //
+    // Not in any section, the headers are mapped at the same offsets
+    //
+    if (Image->Details.NumberOfSections == 0 || Rva < Image->Sections[0].VirtualAddress)
+    {
+        return PeImageFileOffsetToPointer(Image, Rva, Size);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Get a null-terminated string of the image based on its RVA
+ *
+ * @param Image
+ * @param Rva
+ *
+ * @return const CHAR * NULL if the string is not terminated in the file
+ */
+static const CHAR *
+PeImageRvaToString(PPE_IMAGE Image, UINT32 Rva)
+{
+    const UCHAR * String = PeImageRvaToPointer(Image, Rva, 1);
+
+    if (String == NULL ||
+        memchr(String, '\0', (SIZE_T)(Image->BaseAddress + Image->Details.FileSize - String)) == NULL)
+    {
+        return NULL;
+    }
+
+    return (const CHAR *)String;
+}
+
+/**
+ * @brief Build the ordinal table and the sorted name index of the exports
+ *
+ * @param Image
+ * @param Directory the export data directory
+ *
+ * @return VOID
+ */
+static VOID
+PeImageParseExports(PPE_IMAGE Image, const IMAGE_DATA_DIRECTORY * Directory)
+{
+    const IMAGE_EXPORT_DIRECTORY * ExportDirectory;
+    const UINT32 *                 Functions;
+    const UINT32 *                 Names;
+    const UINT16 *                 NameOrdinals;
+
+    if (Directory->VirtualAddress == 0 || Directory->Size < sizeof(IMAGE_EXPORT_DIRECTORY))
+    {
+        return;
+    }
+
+    ExportDirectory = (const IMAGE_EXPORT_DIRECTORY *)PeImageRvaToPointer(Image, Directory->VirtualAddress, sizeof(IMAGE_EXPORT_DIRECTORY));
+
+    if (ExportDirectory == NULL)
+    {
+        return;
+    }
+
+    Functions    = (const UINT32 *)PeImageRvaToPointer(Image, ExportDirectory->AddressOfFunctions, (UINT64)ExportDirectory->NumberOfFunctions * sizeof(UINT32));
+    Names        = (const UINT32 *)PeImageRvaToPointer(Image, ExportDirectory->AddressOfNames, (UINT64)ExportDirectory->NumberOfNames * sizeof(UINT32));
+    NameOrdinals = (const UINT16 *)PeImageRvaToPointer(Image, ExportDirectory->AddressOfNameOrdinals, (UINT64)ExportDirectory->NumberOfNames * sizeof(UINT16));
+
+    if (Functions == NULL)
+    {
+        return;
+    }
+
+    Image->ExportOrdinalBase = ExportDirectory->Base;
+    Image->ExportFunctions.assign(Functions, Functions + ExportDirectory->NumberOfFunctions);
+
+    if (Names != NULL && NameOrdinals != NULL)
+    {
+        Image->ExportNames.reserve(ExportDirectory->NumberOfNames);
+
+        for (UINT32 i = 0; i < ExportDirectory->NumberOfNames; i++)
+        {
+            const CHAR * Name = PeImageRvaToString(Image, Names[i]);
+
+            if (Name == NULL || NameOrdinals[i] >= ExportDirectory->NumberOfFunctions)
+            {
+                continue;
+            }
+
+            Image->ExportNames.push_back({Name, Functions[NameOrdinals[i]]});
+        }
+
+        std::sort(Image->ExportNames.begin(), Image->ExportNames.end(), [](const PE_IMAGE_EXPORT_NAME & A, const PE_IMAGE_EXPORT_NAME & B) {
+            return strcmp(A.Name, B.Name) < 0;
+        });
+    }
+
+    Image->Details.NumberOfExports = (UINT32)Image->ExportFunctions.size();
+}
+
+/**
+ * @brief Find the CodeView (RSDS) entry of the debug directory
+ *
+ * @param Image
+ * @param Directory the debug data directory
+ *
+ * @return VOID
+ */
+static VOID
+PeImageParseDebugDirectory(PPE_IMAGE Image, const IMAGE_DATA_DIRECTORY * Directory)
+{
+    const IMAGE_DEBUG_DIRECTORY * DebugDirectory;
+    UINT32                        NumberOfEntries = Directory->Size / sizeof(IMAGE_DEBUG_DIRECTORY);
+
+    if (Directory->VirtualAddress == 0 || NumberOfEntries == 0)
+    {
+        return;
+    }
+
+    DebugDirectory = (const IMAGE_DEBUG_DIRECTORY *)PeImageRvaToPointer(Image, Directory->VirtualAddress, (UINT64)NumberOfEntries * sizeof(IMAGE_DEBUG_DIRECTORY));
+
+    if (DebugDirectory == NULL)
+    {
+        return;
+    }
+
+    for (UINT32 i = 0; i < NumberOfEntries; i++)
+    {
+        //
+        // RSDS signature, GUID, age and the null-terminated path of the pdb
+        //
+        const UINT32  MinimumSize = sizeof(UINT32) + sizeof(GUID) + sizeof(UINT32) + 1;
+        const UCHAR * CodeView;
+        const CHAR *  PdbPath;
+        const CHAR *  PdbFileName;
+        UINT32        PdbPathMaximumLength;
+
+        if (DebugDirectory[i].Type != IMAGE_DEBUG_TYPE_CODEVIEW || DebugDirectory[i].SizeOfData < MinimumSize)
+        {
+            continue;
+        }
+
+        CodeView = PeImageFileOffsetToPointer(Image, DebugDirectory[i].PointerToRawData, DebugDirectory[i].SizeOfData);
+
+        if (CodeView == NULL || *(const UINT32 *)CodeView != PE_IMAGE_CODEVIEW_RSDS_SIGNATURE)
+        {
+            continue;
+        }
+
+        PdbPath              = (const CHAR *)CodeView + sizeof(UINT32) + sizeof(GUID) + sizeof(UINT32);
+        PdbPathMaximumLength = DebugDirectory[i].SizeOfData - (sizeof(UINT32) + sizeof(GUID) + sizeof(UINT32));
+
+        if (memchr(PdbPath, '\0', PdbPathMaximumLength) == NULL)
+        {
+            continue;
+        }
+
+        //
+        // The symbol server only uses the name of the pdb file
+        //
+        PdbFileName = PdbPath;
+
+        for (const CHAR * Current = PdbPath; *Current != '\0'; Current++)
+        {
+            if (*Current == '\\' || *Current == '/')
+            {
+                PdbFileName = Current + 1;
+            }
+        }
+
+        memcpy(&Image->PdbGuid, CodeView + sizeof(UINT32), sizeof(GUID));
+        memcpy(&Image->PdbAge, CodeView + sizeof(UINT32) + sizeof(GUID), sizeof(UINT32));
+        Image->PdbFileName = PdbFileName;
+
+        Image->Details.IsCodeViewAvailable = TRUE;
+
+        return;
+    }
+}
+
+/**
+ * @brief Parse the headers, the section table, the exports and the
+ * debug directory of a mapped image
+ *
+ * @param Image
+ *
+ * @return BOOLEAN FALSE if the file is not a valid PE image
+ */
+static BOOLEAN
+PeImageParse(PPE_IMAGE Image)
+{
+    const IMAGE_DOS_HEADER *     DosHeader;
+    const IMAGE_FILE_HEADER *    FileHeader;
+    const UCHAR *                OptionalHeader;
+    const IMAGE_DATA_DIRECTORY * DataDirectories;
+    UINT32                       NumberOfDataDirectories;
+    UINT32                       DataDirectoriesOffset;
+    UINT16                       Magic;
+
+    DosHeader = (const IMAGE_DOS_HEADER *)PeImageFileOffsetToPointer(Image, 0, sizeof(IMAGE_DOS_HEADER));
+
+    if (DosHeader == NULL || DosHeader->e_magic != IMAGE_DOS_SIGNATURE || DosHeader->e_lfanew < 0)
+    {
+        return FALSE;
+    }
+
+    //
+    // Signature, file header and the magic of the optional header
+    //
+    if (PeImageFileOffsetToPointer(Image, DosHeader->e_lfanew, sizeof(UINT32) + sizeof(IMAGE_FILE_HEADER) + sizeof(UINT16)) == NULL ||
+        *(const UINT32 *)(Image->BaseAddress + DosHeader->e_lfanew) != IMAGE_NT_SIGNATURE)
+    {
+        return FALSE;
+    }
+
+    Image->Details.NtHeadersOffset = DosHeader->e_lfanew;
+
+    FileHeader     = (const IMAGE_FILE_HEADER *)(Image->BaseAddress + DosHeader->e_lfanew + sizeof(UINT32));
+    OptionalHeader = (const UCHAR *)FileHeader + sizeof(IMAGE_FILE_HEADER);
+    Magic          = *(const UINT16 *)OptionalHeader;
+
+    if (Magic == IMAGE_NT_OPTIONAL_HDR32_MAGIC)
+    {
+        Image->Details.Is32Bit = TRUE;
+        DataDirectoriesOffset  = FIELD_OFFSET(IMAGE_OPTIONAL_HEADER32, DataDirectory);
+    }
+    else if (Magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC)
+    {
+        Image->Details.Is32Bit = FALSE;
+        DataDirectoriesOffset  = FIELD_OFFSET(IMAGE_OPTIONAL_HEADER64, DataDirectory);
+    }
+    else
+    {
+        return FALSE;
+    }
+
+    if (PeImageFileOffsetToPointer(Image, (UINT64)(OptionalHeader - Image->BaseAddress), FileHeader->SizeOfOptionalHeader) == NULL)
+    {
+        return FALSE;
+    }
+
+    //
+    // Only the directories that fit in the optional header are used
+    //
+    if (FileHeader->SizeOfOptionalHeader < DataDirectoriesOffset)
+    {
+        NumberOfDataDirectories = 0;
+    }
+    else
+    {
+        NumberOfDataDirectories = Image->Details.Is32Bit ? ((const IMAGE_OPTIONAL_HEADER32 *)OptionalHeader)->NumberOfRvaAndSizes
+                                                         : ((const IMAGE_OPTIONAL_HEADER64 *)OptionalHeader)->NumberOfRvaAndSizes;
+
+        if (NumberOfDataDirectories > (FileHeader->SizeOfOptionalHeader - DataDirectoriesOffset) / sizeof(IMAGE_DATA_DIRECTORY))
+        {
+            NumberOfDataDirectories = (FileHeader->SizeOfOptionalHeader - DataDirectoriesOffset) / sizeof(IMAGE_DATA_DIRECTORY);
+        }
+    }
+
+    DataDirectories = (const IMAGE_DATA_DIRECTORY *)(OptionalHeader + DataDirectoriesOffset);
+
+    Image->Details.Machine = FileHeader->Machine;
+
+    //
+    // The section table is right after the optional header
+    //
+    Image->Sections = (const IMAGE_SECTION_HEADER *)PeImageFileOffsetToPointer(Image,
+                                                                               (UINT64)(OptionalHeader - Image->BaseAddress) + FileHeader->SizeOfOptionalHeader,
+                                                                               (UINT64)FileHeader->NumberOfSections * sizeof(IMAGE_SECTION_HEADER));
+
+    if (Image->Sections == NULL)
+    {
+        return FALSE;
+    }
+
+    Image->Details.NumberOfSections = FileHeader->NumberOfSections;
+
+    if (NumberOfDataDirectories > IMAGE_DIRECTORY_ENTRY_EXPORT)
+    {
+        PeImageParseExports(Image, &DataDirectories[IMAGE_DIRECTORY_ENTRY_EXPORT]);
+    }
+
+    if (NumberOfDataDirectories > IMAGE_DIRECTORY_ENTRY_DEBUG)
+    {
+        PeImageParseDebugDirectory(Image, &DataDirectories[IMAGE_DIRECTORY_ENTRY_DEBUG]);
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Unmap and free an image
+ *
+ * @param Image
+ *
+ * @return VOID
+ */
+static VOID
+PeImageFree(PPE_IMAGE Image)
+{
+    if (Image->BaseAddress != NULL)
+    {
+        UnmapViewOfFile(Image->BaseAddress);
+    }
+
+    if (Image->MapObjectHandle != NULL)
+    {
+        CloseHandle(Image->MapObjectHandle);
+    }
+
+    delete Image;
+}
+
+/**
+ * @brief Release a reference of an image, the image is unmapped once
+ * it's neither cached nor pinned
+ * @details should be called while holding the cache lock
+ *
+ * @param Image
+ *
+ * @return VOID
+ */
+static VOID
+PeImageRelease(PPE_IMAGE Image)
+{
+    Image->ReferenceCount--;
+
+    if (Image->ReferenceCount == 0)
+    {
+        PeImageFree(Image);
+    }
+}
+
+/**
+ * @brief Map and parse an image
+ *
+ * @param FilePath full path of the file
+ * @param FileAttributes
+ *
+ * @return PPE_IMAGE NULL if the file cannot be mapped or it's not a valid PE image
+ */
+static PPE_IMAGE
+PeImageMap(const std::wstring & FilePath, const WIN32_FILE_ATTRIBUTE_DATA & FileAttributes)
+{
+    HANDLE    FileHandle;
+    PPE_IMAGE Image = new PE_IMAGE();
+
+    Image->FilePath            = FilePath;
+    Image->LastWriteTime       = FileAttributes.ftLastWriteTime;
+    Image->ReferenceCount      = 1;
+    Image->Details.FileSize    = ((UINT64)FileAttributes.nFileSizeHigh << 32) | FileAttributes.nFileSizeLow;
+    Image->PdbAge              = 0;
+    Image->ExportOrdinalBase   = 0;
+    Image->Sections            = NULL;
+    Image->BaseAddress         = NULL;
+    Image->MapObjectHandle     = NULL;
+    Image->Details.ImageHandle = Image;
+    Image->Details.MappedBase  = NULL;
+
+    if (Image->Details.FileSize == 0)
+    {
+        PeImageFree(Image);
+        return NULL;
+    }
+
+    //
+    // Other processes are still allowed to replace the file while it's cached
+    //
+    FileHandle = CreateFileW(FilePath.c_str(),
+                             GENERIC_READ,
+                             FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                             NULL,
+                             OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL,
+                             NULL);
+
+    if (FileHandle == INVALID_HANDLE_VALUE)
+    {
+        PeImageFree(Image);
+        return NULL;
+    }
+
+    Image->MapObjectHandle = CreateFileMappingW(FileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+
+    //
+    // The mapping object keeps its own reference to the file
+    //
+    CloseHandle(FileHandle);
+
+    if (Image->MapObjectHandle == NULL)
+    {
+        PeImageFree(Image);
+        return NULL;
+    }
+
+    Image->BaseAddress = (const UCHAR *)MapViewOfFile(Image->MapObjectHandle, FILE_MAP_READ, 0, 0, 0);
+
+    if (Image->BaseAddress == NULL || !PeImageParse(Image))
+    {
+        PeImageFree(Image);
+        return NULL;
+    }
+
+    Image->Details.MappedBase = (PVOID)Image->BaseAddress;
+
+    return Image;
+}
+
+/**
+ * @brief Get an image from the cache, the image is (re)parsed if it's
+ * not cached or the file is modified after being cached
+ * @details should be called while holding the cache lock
+ *
+ * @param FilePath
+ *
+ * @return PPE_IMAGE NULL if the file is not a valid PE image
+ */
+static PPE_IMAGE
+PeImageOpen(const WCHAR * FilePath)
+{
+    WIN32_FILE_ATTRIBUTE_DATA FileAttributes;
+    WCHAR                     FullPath[MAX_PATH];
+    std::wstring              Key;
+    PPE_IMAGE                 Image;
+
+    if (GetFullPathNameW(FilePath, MAX_PATH, FullPath, NULL) == 0 ||
+        !GetFileAttributesExW(FullPath, GetFileExInfoStandard, &FileAttributes))
+    {
+        return NULL;
+    }
+
+    Key = FullPath;
+    std::transform(Key.begin(), Key.end(), Key.begin(), ::towlower);
+
+    auto Cached = g_PeImagesCache.find(Key);
+
+    if (Cached != g_PeImagesCache.end())
+    {
+        Image = Cached->second;
+
+        if (CompareFileTime(&Image->LastWriteTime, &FileAttributes.ftLastWriteTime) == 0 &&
+            Image->Details.FileSize == (((UINT64)FileAttributes.nFileSizeHigh << 32) | FileAttributes.nFileSizeLow))
+        {
+            Image->LastUseTick = ++g_PeImagesUseCounter;
+            return Image;
+        }
+
+        //
+        // The file is modified, parse it again (the old view remains mapped
+        // while it's pinned)
+        //
+        g_PeImagesCache.erase(Cached);
+        PeImageRelease(Image);
+    }
+
+    Image = PeImageMap(FullPath, FileAttributes);
+
+    if (Image == NULL)
+    {
+        return NULL;
+    }
+
+    //
+    // Unmap the least recently used image if the cache is full
+    //
+    if (g_PeImagesCache.size() >= PE_IMAGE_CACHE_MAXIMUM_ENTRIES)
+    {
+        auto LeastRecentlyUsed = g_PeImagesCache.begin();
+
+        for (auto Item = g_PeImagesCache.begin(); Item != g_PeImagesCache.end(); Item++)
+        {
+            if (Item->second->LastUseTick < LeastRecentlyUsed->second->LastUseTick)
+            {
+                LeastRecentlyUsed = Item;
+            }
+        }
+
+        PeImageRelease(LeastRecentlyUsed->second);
+        g_PeImagesCache.erase(LeastRecentlyUsed);
+    }
+
+    Image->LastUseTick   = ++g_PeImagesUseCounter;
+    g_PeImagesCache[Key] = Image;
+
+    return Image;
+}
+
+/**
+ * @brief Get the details of a PE image
+ * @details the image is pinned, so its view is not unmapped until
+ * SymPeReleaseImageDetails is called
+ *
+ * @param FilePath
+ * @param ImageDetails
+ *
+ * @return BOOLEAN FALSE if the file cannot be read or it's not a valid PE image
+ */
+BOOLEAN
+SymPeGetImageDetails(const WCHAR * FilePath, PPE_IMAGE_DETAILS ImageDetails)
+{
+    PPE_IMAGE Image;
+
+    AcquireSRWLockExclusive(&g_PeImagesCacheLock);
+
+    Image = PeImageOpen(FilePath);
+
+    if (Image != NULL)
+    {
+        Image->ReferenceCount++;
+        *ImageDetails = Image->Details;
+    }
+
+    ReleaseSRWLockExclusive(&g_PeImagesCacheLock);
+
+    return Image != NULL;
+}
+
+/**
+ * @brief Release the image that is pinned by SymPeGetImageDetails
+ * @details the view of the image (MappedBase) should not be used after
+ * calling this function
+ *
+ * @param ImageDetails
+ *
+ * @return VOID
+ */
+VOID
+SymPeReleaseImageDetails(PPE_IMAGE_DETAILS ImageDetails)
+{
+    if (ImageDetails->ImageHandle == NULL)
+    {
+        return;
+    }
+
+    AcquireSRWLockExclusive(&g_PeImagesCacheLock);
+
+    PeImageRelease((PPE_IMAGE)ImageDetails->ImageHandle);
+
+    ReleaseSRWLockExclusive(&g_PeImagesCacheLock);
+
+    ImageDetails->ImageHandle = NULL;
+    ImageDetails->MappedBase  = NULL;
+}
+
+/**
+ * @brief Get the RVA of an exported function by its name
+ * @details forwarded exports return the RVA of the forwarder string
+ *
+ * @param FilePath
+ * @param ExportName
+ * @param Rva
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+SymPeGetExportRva(const WCHAR * FilePath, const char * ExportName, UINT32 * Rva)
+{
+    PPE_IMAGE Image;
+    BOOLEAN   Result = FALSE;
+
+    AcquireSRWLockExclusive(&g_PeImagesCacheLock);
+
+    Image = PeImageOpen(FilePath);
+
+    if (Image != NULL)
+    {
+        auto Export = std::lower_bound(Image->ExportNames.begin(), Image->ExportNames.end(), ExportName, [](const PE_IMAGE_EXPORT_NAME & Item, const char * Name) {
+            return strcmp(Item.Name, Name) < 0;
+        });
+
+        if (Export != Image->ExportNames.end() && strcmp(Export->Name, ExportName) == 0)
+        {
+            *Rva   = Export->Rva;
+            Result = TRUE;
+        }
+    }
+
+    ReleaseSRWLockExclusive(&g_PeImagesCacheLock);
+
+    return Result;
+}
+
+/**
+ * @brief Get the RVA of an exported function by its ordinal
+ *
+ * @param FilePath
+ * @param Ordinal
+ * @param Rva
+ *
+ * @return BOOLEAN
+ */
+BOOLEAN
+SymPeGetExportRvaByOrdinal(const WCHAR * FilePath, UINT32 Ordinal, UINT32 * Rva)
+{
+    PPE_IMAGE Image;
+    BOOLEAN   Result = FALSE;
+
+    AcquireSRWLockExclusive(&g_PeImagesCacheLock);
+
+    Image = PeImageOpen(FilePath);
+
+    if (Image != NULL &&
+        Ordinal >= Image->ExportOrdinalBase &&
+        Ordinal - Image->ExportOrdinalBase < Image->ExportFunctions.size() &&
+        Image->ExportFunctions[Ordinal - Image->ExportOrdinalBase] != 0)
+    {
+        *Rva   = Image->ExportFunctions[Ordinal - Image->ExportOrdinalBase];
+        Result = TRUE;
+    }
+
+    ReleaseSRWLockExclusive(&g_PeImagesCacheLock);
+
+    return Result;
+}
+
+/**
+ * @brief Get the pdb file name, GUID and age of an image from its
+ * CodeView debug information
+ *
+ * @param FilePath
+ * @param PdbFileName
+ * @param PdbGuid
+ * @param PdbAge
+ *
+ * @return BOOLEAN FALSE if the image doesn't have RSDS debug information
+ */
+BOOLEAN
+PeImageGetCodeViewDetails(const char * FilePath, std::string & PdbFileName, GUID * PdbGuid, UINT32 * PdbAge)
+{
+    WCHAR     WideFilePath[MAX_PATH];
+    PPE_IMAGE Image;
+    BOOLEAN   Result = FALSE;
+
+    if (MultiByteToWideChar(CP_ACP, 0, FilePath, -1, WideFilePath, MAX_PATH) == 0)
+    {
+        return FALSE;
+    }
+
+    AcquireSRWLockExclusive(&g_PeImagesCacheLock);
+
+    Image = PeImageOpen(WideFilePath);
+
+    if (Image != NULL && Image->Details.IsCodeViewAvailable)
+    {
+        PdbFileName = Image->PdbFileName;
+        *PdbGuid    = Image->PdbGuid;
+        *PdbAge     = Image->PdbAge;
+        Result      = TRUE;
+    }
+
+    ReleaseSRWLockExclusive(&g_PeImagesCacheLock);
+
+    return Result;
+}
+
+/**
+ * @brief Unmap all of the cached images (the pinned images are unmapped
+ * once they're released)
+ *
+ * @return VOID
+ */
+VOID
+SymPeClearImagesCache()
+{
+    AcquireSRWLockExclusive(&g_PeImagesCacheLock);
+
+    for (auto & Item : g_PeImagesCache)
+    {
+        PeImageRelease(Item.second);
+    }
+
+    g_PeImagesCache.clear();
+
+    ReleaseSRWLockExclusive(&g_PeImagesCacheLock);
+}
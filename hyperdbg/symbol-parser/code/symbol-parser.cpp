@@ -17,10 +17,18 @@
 //
 std::vector<PSYMBOL_LOADED_MODULE_DETAILS> g_LoadedModules;
 BOOLEAN                                    g_IsLoadedModulesInitialized = FALSE;
-BOOLEAN                                    g_AbortLoadingExecution      = FALSE;
+volatile BOOLEAN                           g_AbortLoadingExecution      = FALSE;
 CHAR *                                     g_CurrentModuleName          = NULL;
 PVOID                                      g_MessageHandler             = NULL;
 SymbolMapCallback                          g_SymbolMapForDisassembler   = NULL;
+SymbolPdbDownloadCallback                  g_SymbolPdbDownloadCallback  = NULL;
+UINT32                                     g_SymbolDownloadMaxWorkers   = SYMBOL_DOWNLOAD_MAXIMUM_WORKERS;
+BOOLEAN                                    g_IsTypeMembersCacheDisabled = FALSE;
+
+//
+// Cached members of the queried types (module base -> type name -> members)
+//
+std::unordered_map<UINT64, std::unordered_map<std::wstring, SYMBOL_TYPE_MEMBERS>> g_TypeMembersCache;
 
 /**
  * @brief Set the function callback that will be called if any message
@@ -189,19 +197,50 @@ SymGetModuleBaseFromSearchMask(const char * SearchMask, BOOLEAN SetModuleNameGlo
 }
 
 /**
- * @brief Get the offset of a field from the top of a structure
+ * @brief Invalidate the cached types of a module
+ * @param Base
+ *
+ * @return VOID
+ */
+static VOID
+SymInvalidateTypeMembersCache(UINT64 Base)
+{
+    g_TypeMembersCache.erase(Base);
+}
+
+/**
+ * @brief Get the members of a type, the members are queried once and
+ * then cached for the later queries
  * @param Base
  * @param TypeName
- * @param FieldName
- * @param FieldOffset
  * @details This function is derived from: https://github.com/0vercl0k/sic/blob/master/src/sic/sym.cc
  *
- * @return BOOLEAN Whether the module is found successfully or not
+ * @return PSYMBOL_TYPE_MEMBERS NULL if the type is not found
  */
-BOOLEAN
-SymGetFieldOffsetFromModule(UINT64 Base, WCHAR * TypeName, WCHAR * FieldName, UINT32 * FieldOffset)
+static PSYMBOL_TYPE_MEMBERS
+SymGetTypeMembers(UINT64 Base, WCHAR * TypeName)
 {
-    BOOLEAN Found = FALSE;
+    SYMBOL_TYPE_MEMBERS TypeMembers;
+
+    //
+    // Without the cache, only the last queried type is kept (the caller
+    // uses it right after this function)
+    //
+    if (g_IsTypeMembersCacheDisabled)
+    {
+        SymInvalidateTypeMembersCache(Base);
+    }
+
+    //
+    // Check whether the type is already cached or not
+    //
+    auto & ModuleTypes = g_TypeMembersCache[Base];
+    auto   CachedType  = ModuleTypes.find(TypeName);
+
+    if (CachedType != ModuleTypes.end())
+    {
+        return &CachedType->second;
+    }
 
     //
     // Allocate a buffer to back the SYMBOL_INFO structure
@@ -224,143 +263,139 @@ SymGetFieldOffsetFromModule(UINT64 Base, WCHAR * TypeName, WCHAR * FieldName, UI
     {
         // ShowMessages("err, SymGetTypeFromName failed (%x)\n",
         //              GetLastError());
-        return FALSE;
-    }
-
-    //
-    // Now that we have a type, we need to enumerate its children to find the
-    // field we're after. First step is to get the number of children
-    //
-    const ULONG TypeIndex     = SymbolInfo->TypeIndex;
-    DWORD       ChildrenCount = 0;
-    if (!SymGetTypeInfo(GetCurrentProcess(), Base, TypeIndex, TI_GET_CHILDRENCOUNT, &ChildrenCount))
-    {
-        // ShowMessages("err, SymGetTypeInfo failed (%x)\n",
-        //              GetLastError());
-        return FALSE;
+        return NULL;
     }
 
-    //
-    // Allocate enough memory to receive the children ids
-    //
-    auto FindChildrenParamsBacking = std::make_unique<uint8_t[]>(
-        sizeof(_TI_FINDCHILDREN_PARAMS) + ((ChildrenCount - 1) * sizeof(ULONG)));
-    auto FindChildrenParams =
-        (_TI_FINDCHILDREN_PARAMS *)FindChildrenParamsBacking.get();
-
-    //
-    // Initialize the structure with the children count
-    //
-    FindChildrenParams->Count = ChildrenCount;
-
-    //
-    // Get all the children ids
-    //
-    if (!SymGetTypeInfo(GetCurrentProcess(), Base, TypeIndex, TI_FINDCHILDREN, FindChildrenParams))
-    {
-        // ShowMessages("err, SymGetTypeInfo failed (%x)\n",
-        //             GetLastError());
-        return FALSE;
-    }
+    TypeMembers.TypeIndex           = SymbolInfo->TypeIndex;
+    TypeMembers.TypeSize            = 0;
+    TypeMembers.IsTypeSizeAvailable = (BOOLEAN)SymGetTypeInfo(GetCurrentProcess(), Base, TypeMembers.TypeIndex, TI_GET_LENGTH, &TypeMembers.TypeSize);
 
     //
-    // Now that we have all the ids, we can walk them and find the one that
-    // matches the field we're looking for
+    // Now that we have a type, we need to enumerate its children to build
+    // the fields map. First step is to get the number of children (types
+    // without children have no fields)
     //
-
-    for (DWORD ChildIdx = 0; ChildIdx < ChildrenCount; ChildIdx++)
+    DWORD ChildrenCount = 0;
+    if (SymGetTypeInfo(GetCurrentProcess(), Base, TypeMembers.TypeIndex, TI_GET_CHILDRENCOUNT, &ChildrenCount) &&
+        ChildrenCount != 0)
     {
         //
-        // Grab the child name
+        // Allocate enough memory to receive the children ids
         //
-        const ULONG ChildId   = FindChildrenParams->ChildId[ChildIdx];
-        WCHAR *     ChildName = nullptr;
-        SymGetTypeInfo(GetCurrentProcess(), Base, ChildId, TI_GET_SYMNAME, &ChildName);
+        auto FindChildrenParamsBacking = std::make_unique<uint8_t[]>(
+            sizeof(_TI_FINDCHILDREN_PARAMS) + ((ChildrenCount - 1) * sizeof(ULONG)));
+        auto FindChildrenParams =
+            (_TI_FINDCHILDREN_PARAMS *)FindChildrenParamsBacking.get();
 
         //
-        // Grab the child size - this is useful to know if a field is a bit or a
-        // normal field
+        // Initialize the structure with the children count
         //
-        UINT64 ChildSize = 0;
-        SymGetTypeInfo(GetCurrentProcess(), Base, ChildId, TI_GET_LENGTH, &ChildSize);
+        FindChildrenParams->Count = ChildrenCount;
 
         //
-        // Does this child's name match the field we're looking for?
+        // Get all the children ids
         //
-        Found = FALSE;
-        if (wcscmp(ChildName, FieldName) == 0)
+        if (!SymGetTypeInfo(GetCurrentProcess(), Base, TypeMembers.TypeIndex, TI_FINDCHILDREN, FindChildrenParams))
         {
+            // ShowMessages("err, SymGetTypeInfo failed (%x)\n",
+            //             GetLastError());
+            return NULL;
+        }
+
+        for (DWORD ChildIdx = 0; ChildIdx < ChildrenCount; ChildIdx++)
+        {
+            SYMBOL_TYPE_FIELD_DETAILS FieldDetails = {0};
+
             //
-            // If we have found the field, now we need to find its offset if
-            // it's a normal field, or its bit position if it is a bit
+            // Grab the child name
             //
-            const IMAGEHLP_SYMBOL_TYPE_INFO Info =
-                (ChildSize == 1) ? TI_GET_BITPOSITION : TI_GET_OFFSET;
-            SymGetTypeInfo(GetCurrentProcess(), Base, ChildId, Info, FieldOffset);
+            const ULONG ChildId   = FindChildrenParams->ChildId[ChildIdx];
+            WCHAR *     ChildName = nullptr;
+            SymGetTypeInfo(GetCurrentProcess(), Base, ChildId, TI_GET_SYMNAME, &ChildName);
 
-            Found = TRUE;
-        }
+            if (ChildName == nullptr)
+            {
+                continue;
+            }
 
-        //
-        // Even if we have found a match, we need to clean up the memory
-        //
-        LocalFree(ChildName);
-        ChildName = nullptr;
+            //
+            // Grab the child size - this is useful to know if a field is a bit or a
+            // normal field
+            //
+            SymGetTypeInfo(GetCurrentProcess(), Base, ChildId, TI_GET_LENGTH, &FieldDetails.Size);
+            SymGetTypeInfo(GetCurrentProcess(), Base, ChildId, TI_GET_TYPEID, &FieldDetails.TypeIndex);
 
-        //
-        // We can now break out of the loop if we have what we came looking for
-        //
-        if (Found)
-        {
-            break;
+            //
+            // Find the offset if it's a normal field, or the bit position if it
+            // is a bit
+            //
+            const IMAGEHLP_SYMBOL_TYPE_INFO Info =
+                (FieldDetails.Size == 1) ? TI_GET_BITPOSITION : TI_GET_OFFSET;
+            SymGetTypeInfo(GetCurrentProcess(), Base, ChildId, Info, &FieldDetails.Offset);
+
+            //
+            // The first child with the name is kept (same as a linear search)
+            //
+            TypeMembers.Fields.emplace(ChildName, FieldDetails);
+
+            LocalFree(ChildName);
         }
     }
 
-    return Found;
+    return &(ModuleTypes[TypeName] = std::move(TypeMembers));
 }
 
 /**
- * @brief Get the size of a data type (structure)
+ * @brief Get the offset of a field from the top of a structure
  * @param Base
  * @param TypeName
- * @param TypeSize
+ * @param FieldName
+ * @param FieldOffset
  *
  * @return BOOLEAN Whether the module is found successfully or not
  */
 BOOLEAN
-SymGetDataTypeSizeFromModule(UINT64 Base, WCHAR * TypeName, UINT64 * TypeSize)
+SymGetFieldOffsetFromModule(UINT64 Base, WCHAR * TypeName, WCHAR * FieldName, UINT32 * FieldOffset)
 {
-    //
-    // Allocate a buffer to back the SYMBOL_INFO structure
-    //
-    const DWORD SizeOfStruct =
-        sizeof(SYMBOL_INFOW) + ((MAX_SYM_NAME - 1) * sizeof(wchar_t));
-    uint8_t SymbolInfoBuffer[SizeOfStruct];
-    auto    SymbolInfo = PSYMBOL_INFOW(SymbolInfoBuffer);
+    PSYMBOL_TYPE_MEMBERS TypeMembers = SymGetTypeMembers(Base, TypeName);
 
-    //
-    // Initialize the fields that need initialization
-    //
-    SymbolInfo->SizeOfStruct = sizeof(SYMBOL_INFOW);
-    SymbolInfo->MaxNameLen   = MAX_SYM_NAME;
+    if (TypeMembers == NULL)
+    {
+        return FALSE;
+    }
 
-    //
-    // Retrieve a type index for the type we're after
-    //
-    if (!SymGetTypeFromNameW(GetCurrentProcess(), Base, TypeName, SymbolInfo))
+    auto Field = TypeMembers->Fields.find(FieldName);
+
+    if (Field == TypeMembers->Fields.end())
     {
-        // ShowMessages("err, SymGetTypeFromName failed (%x)\n",
-        //              GetLastError());
         return FALSE;
     }
 
-    if (!SymGetTypeInfo(GetCurrentProcess(), Base, SymbolInfo->TypeIndex, TI_GET_LENGTH, TypeSize))
+    *FieldOffset = Field->second.Offset;
+
+    return TRUE;
+}
+
+/**
+ * @brief Get the size of a data type (structure)
+ * @param Base
+ * @param TypeName
+ * @param TypeSize
+ *
+ * @return BOOLEAN Whether the module is found successfully or not
+ */
+BOOLEAN
+SymGetDataTypeSizeFromModule(UINT64 Base, WCHAR * TypeName, UINT64 * TypeSize)
+{
+    PSYMBOL_TYPE_MEMBERS TypeMembers = SymGetTypeMembers(Base, TypeName);
+
+    if (TypeMembers == NULL || !TypeMembers->IsTypeSizeAvailable)
     {
-        // ShowMessages("err, SymGetTypeInfo failed (%x)\n",
-        //              GetLastError());
         return FALSE;
     }
 
+    *TypeSize = TypeMembers->TypeSize;
+
     // ShowMessages("type size : %llx\n", TypeSize);
 
     return TRUE;
@@ -617,6 +652,11 @@ SymLoadFileSymbol(UINT64 BaseAddress, const char * PdbFileName, const char * Cus
         return -1;
     }
 
+    //
+    // Previously cached types at this base are not valid anymore
+    //
+    SymInvalidateTypeMembersCache(ModuleDetails->ModuleBase);
+
 #ifndef DoNotShowDetailedResult
 
     //
@@ -688,6 +728,8 @@ SymUnloadModuleSymbol(char * ModuleName)
                 return -1;
             }
 
+            SymInvalidateTypeMembersCache(item->ModuleBase);
+
             OneModuleFound = TRUE;
 
             free(item);
@@ -773,6 +815,11 @@ SymUnloadAllSymbols()
     //
     g_LoadedModules.clear();
 
+    //
+    // Types of the unloaded modules are not valid anymore
+    //
+    g_TypeMembersCache.clear();
+
     //
     // Uninitialize DbgHelp
     //
@@ -928,6 +975,46 @@ SymConvertNameToAddress(const char * FunctionOrVariableName, PBOOLEAN WasFound)
     return Address;
 }
 
+/**
+ * @brief Get the base address of a loaded module from its name
+ * @details The module is searched by both its original and its alternative
+ * name (e.g., 'nt')
+ *
+ * @param ModuleName
+ * @param WasFound
+ *
+ * @return UINT64
+ */
+UINT64
+SymGetModuleBaseAddress(const char * ModuleName, PBOOLEAN WasFound)
+{
+    string TargetModuleName(ModuleName);
+
+    //
+    // Not found by default
+    //
+    *WasFound = FALSE;
+
+    //
+    // Convert module name to lower-case
+    //
+    std::transform(TargetModuleName.begin(), TargetModuleName.end(), TargetModuleName.begin(), [](unsigned char c) {
+        return std::tolower(c);
+    });
+
+    for (auto item : g_LoadedModules)
+    {
+        if (strcmp((const char *)item->ModuleName, TargetModuleName.c_str()) == 0 ||
+            strcmp((const char *)item->ModuleAlternativeName, TargetModuleName.c_str()) == 0)
+        {
+            *WasFound = TRUE;
+            return item->ModuleBase;
+        }
+    }
+
+    return NULL;
+}
+
 /**
  * @brief Search and show symbols
  * @details mainly used by the 'x' command
@@ -1689,6 +1776,9 @@ SymConvertFileToPdbPath(const char * LocalFilePath, char * ResultPath, size_t Re
     HRESULT           Result;
     BOOL              Ret;
     SYMSRV_INDEX_INFO SymInfo   = {0};
+    std::string       PdbFileName;
+    GUID              PdbGuid;
+    UINT32            PdbAge;
     const char *      FormatStr = "%s/%08x%04x%04x%02x%02x%02x%02x%02x%02x%02x%02x%x/%s";
     SymInfo.sizeofstruct        = sizeof(SYMSRV_INDEX_INFO);
 
@@ -1697,7 +1787,25 @@ SymConvertFileToPdbPath(const char * LocalFilePath, char * ResultPath, size_t Re
         return FALSE;
     }
 
-    Ret = SymSrvGetFileIndexInfo(LocalFilePath, &SymInfo, 0);
+    //
+    // The CodeView details are read from the cached image, the symbol
+    // server is only used for the images without RSDS details
+    //
+    if (PeImageGetCodeViewDetails(LocalFilePath, PdbFileName, &PdbGuid, &PdbAge))
+    {
+        Ret = TRUE;
+    }
+    else
+    {
+        Ret = SymSrvGetFileIndexInfo(LocalFilePath, &SymInfo, 0);
+
+        if (Ret)
+        {
+            PdbFileName = SymInfo.pdbfile;
+            PdbGuid     = SymInfo.guid;
+            PdbAge      = SymInfo.age;
+        }
+    }
 
     if (Ret)
     {
@@ -1705,20 +1813,20 @@ SymConvertFileToPdbPath(const char * LocalFilePath, char * ResultPath, size_t Re
             ResultPath,
             ResultPathSize,
             FormatStr,
-            SymInfo.pdbfile,
-            SymInfo.guid.Data1,
-            SymInfo.guid.Data2,
-            SymInfo.guid.Data3,
-            SymInfo.guid.Data4[0],
-            SymInfo.guid.Data4[1],
-            SymInfo.guid.Data4[2],
-            SymInfo.guid.Data4[3],
-            SymInfo.guid.Data4[4],
-            SymInfo.guid.Data4[5],
-            SymInfo.guid.Data4[6],
-            SymInfo.guid.Data4[7],
-            SymInfo.age,
-            SymInfo.pdbfile);
+            PdbFileName.c_str(),
+            PdbGuid.Data1,
+            PdbGuid.Data2,
+            PdbGuid.Data3,
+            PdbGuid.Data4[0],
+            PdbGuid.Data4[1],
+            PdbGuid.Data4[2],
+            PdbGuid.Data4[3],
+            PdbGuid.Data4[4],
+            PdbGuid.Data4[5],
+            PdbGuid.Data4[6],
+            PdbGuid.Data4[7],
+            PdbAge,
+            PdbFileName.c_str());
 
         if (FAILED(Result))
         {
@@ -1791,7 +1899,11 @@ BOOLEAN
 SymConvertFileToPdbFileAndGuidAndAgeDetails(const char * LocalFilePath, char * PdbFilePath, char * GuidAndAgeDetails, BOOLEAN Is32BitModule)
 {
     SYMSRV_INDEX_INFO SymInfo = {0};
+    BOOL              Ret;
     std::string       Wow64ConvertedPath;
+    std::string       PdbFileName;
+    GUID              PdbGuid;
+    UINT32            PdbAge;
     const char *      FormatStrPdbFilePath = "%s";
     const char *      ActualLocalFilePath  = NULL;
     const char *      FormatStrPdbFileGuidAndAgeDetails =
@@ -1811,26 +1923,44 @@ SymConvertFileToPdbFileAndGuidAndAgeDetails(const char * LocalFilePath, char * P
 
     // ShowMessages("the final (actual) address is: %s\n", ActualLocalFilePath);
 
-    BOOL Ret = SymSrvGetFileIndexInfo(ActualLocalFilePath, &SymInfo, 0);
+    //
+    // The CodeView details are read from the cached image, the symbol
+    // server is only used for the images without RSDS details
+    //
+    if (PeImageGetCodeViewDetails(ActualLocalFilePath, PdbFileName, &PdbGuid, &PdbAge))
+    {
+        Ret = TRUE;
+    }
+    else
+    {
+        Ret = SymSrvGetFileIndexInfo(ActualLocalFilePath, &SymInfo, 0);
+
+        if (Ret)
+        {
+            PdbFileName = SymInfo.pdbfile;
+            PdbGuid     = SymInfo.guid;
+            PdbAge      = SymInfo.age;
+        }
+    }
 
     if (Ret)
     {
-        wsprintfA(PdbFilePath, FormatStrPdbFilePath, SymInfo.pdbfile);
+        wsprintfA(PdbFilePath, FormatStrPdbFilePath, PdbFileName.c_str());
 
         wsprintfA(GuidAndAgeDetails,
                   FormatStrPdbFileGuidAndAgeDetails,
-                  SymInfo.guid.Data1,
-                  SymInfo.guid.Data2,
-                  SymInfo.guid.Data3,
-                  SymInfo.guid.Data4[0],
-                  SymInfo.guid.Data4[1],
-                  SymInfo.guid.Data4[2],
-                  SymInfo.guid.Data4[3],
-                  SymInfo.guid.Data4[4],
-                  SymInfo.guid.Data4[5],
-                  SymInfo.guid.Data4[6],
-                  SymInfo.guid.Data4[7],
-                  SymInfo.age);
+                  PdbGuid.Data1,
+                  PdbGuid.Data2,
+                  PdbGuid.Data3,
+                  PdbGuid.Data4[0],
+                  PdbGuid.Data4[1],
+                  PdbGuid.Data4[2],
+                  PdbGuid.Data4[3],
+                  PdbGuid.Data4[4],
+                  PdbGuid.Data4[5],
+                  PdbGuid.Data4[6],
+                  PdbGuid.Data4[7],
+                  PdbAge);
 
         return TRUE;
     }
@@ -1848,8 +1978,238 @@ SymConvertFileToPdbFileAndGuidAndAgeDetails(const char * LocalFilePath, char * P
     return FALSE;
 }
 
+/**
+ * @brief Download a pdb file (without showing any message)
+ *
+ * @param Job The pdb file to download
+ * @param SymPath The path of symbols
+ *
+ * @return VOID
+ */
+static VOID
+SymbolPdbDownloadFile(PSYMBOL_DOWNLOAD_JOB Job, const std::string & SymPath)
+{
+    vector<string> SplitedSymPath = Split(SymPath, '*');
+
+    if (SplitedSymPath.size() < 3 ||
+        SplitedSymPath[1].find(":\\") == string::npos ||
+        (SplitedSymPath[2].find("http:") == string::npos && SplitedSymPath[2].find("https:") == string::npos))
+    {
+        Job->Status = SYMBOL_DOWNLOAD_STATUS_INVALID_SYMBOL_PATH;
+        return;
+    }
+
+    string SymDir            = SplitedSymPath[1];
+    string SymDownloadServer = SplitedSymPath[2];
+    string DownloadURL       = SymDownloadServer + "/" + Job->SymName + "/" + Job->Guid + "/" + Job->SymName;
+    Job->SymFullDir          = SymDir + "\\" + Job->SymName + "\\" + Job->Guid + "\\";
+
+    if (!CreateDirectoryRecursive(Job->SymFullDir))
+    {
+        Job->Status = SYMBOL_DOWNLOAD_STATUS_UNABLE_TO_CREATE_DIRECTORY;
+        return;
+    }
+
+    if (g_SymbolPdbDownloadCallback != NULL)
+    {
+        Job->Result = (HRESULT)g_SymbolPdbDownloadCallback(DownloadURL.c_str(), (Job->SymFullDir + "\\" + Job->SymName).c_str());
+    }
+    else
+    {
+        Job->Result = URLDownloadToFileA(NULL, DownloadURL.c_str(), (Job->SymFullDir + "\\" + Job->SymName).c_str(), 0, NULL);
+    }
+
+    Job->Status = Job->Result == S_OK ? SYMBOL_DOWNLOAD_STATUS_DOWNLOADED : SYMBOL_DOWNLOAD_STATUS_FAILED;
+}
+
+/**
+ * @brief Show the result of downloading a pdb file
+ *
+ * @param Job The downloaded pdb file
+ *
+ * @return VOID
+ */
+static VOID
+SymbolPdbDownloadShowResult(PSYMBOL_DOWNLOAD_JOB Job)
+{
+    switch (Job->Status)
+    {
+    case SYMBOL_DOWNLOAD_STATUS_UNABLE_TO_CREATE_DIRECTORY:
+        ShowMessages("err, unable to create sympath directory '%s'\n", Job->SymFullDir.c_str());
+        break;
+
+    case SYMBOL_DOWNLOAD_STATUS_DOWNLOADED:
+        ShowMessages("downloading symbol '%s'...\tdownloaded\n", Job->SymName.c_str());
+        break;
+
+    case SYMBOL_DOWNLOAD_STATUS_FAILED:
+        ShowMessages("downloading symbol '%s'...\tcould not be downloaded (%x) \n", Job->SymName.c_str(), Job->Result);
+        break;
+
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Thread that downloads the pdb files of the download queue
+ * @details Jobs are taken in the order of the modules so the module that is
+ * loaded next is always downloaded first
+ *
+ * @param Param The download queue
+ *
+ * @return DWORD
+ */
+static DWORD WINAPI
+SymbolDownloadWorkerThread(LPVOID Param)
+{
+    PSYMBOL_DOWNLOAD_QUEUE Queue = (PSYMBOL_DOWNLOAD_QUEUE)Param;
+
+    while (TRUE)
+    {
+        LONG Index = InterlockedIncrement(&Queue->NextJob) - 1;
+
+        if ((size_t)Index >= Queue->Jobs.size())
+        {
+            break;
+        }
+
+        //
+        // Jobs are still signaled after abort to avoid blocking the waiter
+        //
+        if (!Queue->IsAborted && !g_AbortLoadingExecution)
+        {
+            SymbolPdbDownloadFile(&Queue->Jobs[Index], Queue->SymPath);
+        }
+
+        SetEvent(Queue->Jobs[Index].FinishedEvent);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Wait for a pdb file to be downloaded
+ *
+ * @param Job The pdb file
+ *
+ * @return BOOLEAN FALSE if the loading is aborted
+ */
+static BOOLEAN
+SymbolDownloadWaitForJob(PSYMBOL_DOWNLOAD_JOB Job)
+{
+    while (WaitForSingleObject(Job->FinishedEvent, SYMBOL_DOWNLOAD_WAIT_INTERVAL) == WAIT_TIMEOUT)
+    {
+        if (g_AbortLoadingExecution)
+        {
+            return FALSE;
+        }
+    }
+
+    return !g_AbortLoadingExecution;
+}
+
+/**
+ * @brief Stop the download workers and free the download queue resources
+ *
+ * @param Queue The download queue
+ * @param Workers Handles of the download workers
+ * @param NumberOfWorkers
+ *
+ * @return VOID
+ */
+static VOID
+SymbolDownloadQueueUninitialize(PSYMBOL_DOWNLOAD_QUEUE Queue, HANDLE * Workers, UINT32 NumberOfWorkers)
+{
+    //
+    // Running downloads are not interrupted, the rest of the jobs are skipped
+    //
+    Queue->IsAborted = TRUE;
+
+    if (NumberOfWorkers != 0)
+    {
+        WaitForMultipleObjects(NumberOfWorkers, Workers, TRUE, INFINITE);
+    }
+
+    for (UINT32 i = 0; i < NumberOfWorkers; i++)
+    {
+        CloseHandle(Workers[i]);
+    }
+
+    for (auto & Job : Queue->Jobs)
+    {
+        if (Job.FinishedEvent != NULL)
+        {
+            CloseHandle(Job.FinishedEvent);
+        }
+    }
+}
+
+/**
+ * @brief Load the pdb file of a module
+ *
+ * @param ModuleDetail The module
+ * @param PdbFilePath Path of the pdb file
+ * @param IsSilentLoad
+ *
+ * @return VOID
+ */
+static VOID
+SymbolLoadModulePdb(PMODULE_SYMBOL_DETAIL ModuleDetail, const char * PdbFilePath, BOOLEAN IsSilentLoad)
+{
+    string       CustomModuleNameStr;
+    const char * CustomModuleName = NULL;
+
+    ModuleDetail->IsSymbolPDBAvaliable = TRUE;
+
+    if (!IsSilentLoad)
+    {
+        ShowMessages("loading symbol '%s'...", PdbFilePath);
+    }
+
+    //
+    // Check for alternative module names
+    //
+    if (ModuleDetail->Is32Bit &&
+        SymCheckAndRemoveWow64Prefix(ModuleDetail->FilePath,
+                                     PdbFilePath,
+                                     CustomModuleNameStr))
+    {
+        //
+        // The name of the module contains a prefix which should be removed
+        //
+        CustomModuleName = CustomModuleNameStr.c_str();
+    }
+    else if (!ModuleDetail->Is32Bit &&
+             SymCheckNtoskrnlPrefix(PdbFilePath, CustomModuleNameStr))
+    {
+        //
+        // This is an nt module
+        //
+        CustomModuleName = CustomModuleNameStr.c_str();
+    }
+
+    if (SymLoadFileSymbol(ModuleDetail->BaseAddress, PdbFilePath, CustomModuleName) == 0)
+    {
+        if (!IsSilentLoad)
+        {
+            ShowMessages("\tloaded\n");
+        }
+    }
+    else
+    {
+        if (!IsSilentLoad)
+        {
+            ShowMessages("\tnot loaded (already loaded?)\n");
+        }
+    }
+}
+
 /**
  * @brief check if the pdb files of loaded symbols are available or not
+ * @details Missing pdb files are downloaded by a pool of workers while
+ * the available ones are loaded, the loading itself (dbghelp) is not
+ * thread-safe and is performed in the order of the modules
  *
  * @param BufferToStoreDetails Pointer to a buffer to store the symbols details
  * this buffer will be allocated by this function and needs to be freed by caller
@@ -1867,10 +2227,16 @@ SymbolInitLoad(PVOID        BufferToStoreDetails,
                const char * SymbolPath,
                BOOLEAN      IsSilentLoad)
 {
-    string                Tmp, SymDir, CustomModuleNameStr;
-    const char *          CustomModuleName = NULL;
+    string                SymDir;
     string                SymPath(SymbolPath);
     PMODULE_SYMBOL_DETAIL BufferToStoreDetailsConverted = (PMODULE_SYMBOL_DETAIL)BufferToStoreDetails;
+    size_t                NumberOfModules               = StoredLength / sizeof(MODULE_SYMBOL_DETAIL);
+    vector<string>        PdbPaths(NumberOfModules);
+    vector<INT64>         DownloadJobIndex(NumberOfModules, -1);
+    SYMBOL_DOWNLOAD_QUEUE Queue;
+    HANDLE                Workers[SYMBOL_DOWNLOAD_MAXIMUM_WORKERS];
+    UINT32                NumberOfWorkers = 0;
+    BOOLEAN               Result          = TRUE;
 
     vector<string> SplitedSymPath = Split(SymPath, '*');
     if (SplitedSymPath.size() < 2)
@@ -1878,30 +2244,22 @@ SymbolInitLoad(PVOID        BufferToStoreDetails,
     if (SplitedSymPath[1].find(":\\") == string::npos)
         return FALSE;
 
-    Tmp = SymDir = SplitedSymPath[1];
+    SymDir = SplitedSymPath[1];
+
+    Queue.SymPath   = SymPath;
+    Queue.NextJob   = 0;
+    Queue.IsAborted = FALSE;
 
     //
-    // Split each module and details
+    // Find the pdb path of the modules and the pdb files that should be downloaded
     //
-    for (size_t i = 0; i < StoredLength / sizeof(MODULE_SYMBOL_DETAIL); i++)
+    for (size_t i = 0; i < NumberOfModules; i++)
     {
-        //
-        // Check for abort
-        //
-        if (g_AbortLoadingExecution)
-        {
-            g_AbortLoadingExecution = FALSE;
-            return FALSE;
-        }
-
         //
         // Check if symbol pdb detail is available in the module
         //
         if (!BufferToStoreDetailsConverted[i].IsSymbolDetailsFound)
         {
-            //
-            // Ignore the module
-            //
             continue;
         }
 
@@ -1910,163 +2268,133 @@ SymbolInitLoad(PVOID        BufferToStoreDetails,
         //
         if (BufferToStoreDetailsConverted[i].IsLocalSymbolPath)
         {
-            //
-            // If this is a local driver, then load the pdb
-            //
-            if (IsFileExists(BufferToStoreDetailsConverted[i].ModuleSymbolPath))
-            {
-                BufferToStoreDetailsConverted[i].IsSymbolPDBAvaliable = TRUE;
+            PdbPaths[i] = BufferToStoreDetailsConverted[i].ModuleSymbolPath;
+            continue;
+        }
 
-                //
-                // Load symbol locally
-                //
-                if (!IsSilentLoad)
-                {
-                    ShowMessages("loading symbol '%s'...", Tmp.c_str());
-                }
+        //
+        // It might be a Windows symbol
+        //
+        PdbPaths[i] = SymDir +
+                      "\\" +
+                      BufferToStoreDetailsConverted[i].ModuleSymbolPath +
+                      "\\" +
+                      BufferToStoreDetailsConverted[i].ModuleSymbolGuidAndAge +
+                      "\\" +
+                      BufferToStoreDetailsConverted[i].ModuleSymbolPath;
 
-                //
-                // Check if we need an alternative module name (in 32-bit modules)
-                //
-                CustomModuleName = NULL;
+        if (DownloadIfAvailable && IsFileExists(PdbPaths[i]) == FALSE)
+        {
+            SYMBOL_DOWNLOAD_JOB Job;
 
-                // ShowMessages("name: %s , is 32-bit? %s\n", BufferToStoreDetailsConverted[i].FilePath, BufferToStoreDetailsConverted[i].Is32Bit ? "true" : "false");
+            Job.SymName       = BufferToStoreDetailsConverted[i].ModuleSymbolPath;
+            Job.Guid          = BufferToStoreDetailsConverted[i].ModuleSymbolGuidAndAge;
+            Job.Status        = SYMBOL_DOWNLOAD_STATUS_NOT_STARTED;
+            Job.Result        = S_OK;
+            Job.FinishedEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
 
+            if (Job.FinishedEvent == NULL)
+            {
                 //
-                // Check for alternative module names
+                // The download is ignored
                 //
-                if (BufferToStoreDetailsConverted[i].Is32Bit &&
-                    SymCheckAndRemoveWow64Prefix(BufferToStoreDetailsConverted[i].FilePath,
-                                                 BufferToStoreDetailsConverted[i].ModuleSymbolPath,
-                                                 CustomModuleNameStr))
-                {
-                    //
-                    // The name of the module contains a prefix which should be removed
-                    //
-                    CustomModuleName = CustomModuleNameStr.c_str();
-                }
-                else if (!BufferToStoreDetailsConverted[i].Is32Bit &&
-                         SymCheckNtoskrnlPrefix(BufferToStoreDetailsConverted[i].ModuleSymbolPath, CustomModuleNameStr))
-                {
-                    //
-                    // This is an nt module
-                    //
-                    CustomModuleName = CustomModuleNameStr.c_str();
-                }
-
-                if (SymLoadFileSymbol(BufferToStoreDetailsConverted[i].BaseAddress,
-                                      BufferToStoreDetailsConverted[i].ModuleSymbolPath,
-                                      CustomModuleName) == 0)
-                {
-                    if (!IsSilentLoad)
-                    {
-                        ShowMessages("\tloaded\n");
-                    }
-                }
-                else
-                {
-                    if (!IsSilentLoad)
-                    {
-                        ShowMessages("\tnot loaded (already loaded?)\n");
-                    }
-                }
+                continue;
             }
+
+            DownloadJobIndex[i] = (INT64)Queue.Jobs.size();
+            Queue.Jobs.push_back(Job);
         }
-        else
+    }
+
+    //
+    // Start the download workers, the jobs vector is not changed anymore
+    //
+    while (NumberOfWorkers < g_SymbolDownloadMaxWorkers && NumberOfWorkers < Queue.Jobs.size())
+    {
+        Workers[NumberOfWorkers] = CreateThread(NULL, 0, SymbolDownloadWorkerThread, &Queue, 0, NULL);
+
+        if (Workers[NumberOfWorkers] == NULL)
         {
-            //
-            // It might be a Windows symbol
-            //
-            Tmp = SymDir +
-                  "\\" +
-                  BufferToStoreDetailsConverted[i].ModuleSymbolPath +
-                  "\\" +
-                  BufferToStoreDetailsConverted[i].ModuleSymbolGuidAndAge +
-                  "\\" +
-                  BufferToStoreDetailsConverted[i].ModuleSymbolPath;
+            break;
+        }
+
+        NumberOfWorkers++;
+    }
+
+    if (NumberOfWorkers == 0 && !Queue.Jobs.empty())
+    {
+        //
+        // Unable to create any worker, download the files sequentially
+        // in this thread
+        //
+        SymbolDownloadWorkerThread(&Queue);
+    }
+
+    //
+    // Load the modules in order
+    //
+    for (size_t i = 0; i < NumberOfModules; i++)
+    {
+        //
+        // Check for abort
+        //
+        if (g_AbortLoadingExecution)
+        {
+            Result = FALSE;
+            break;
+        }
 
+        if (PdbPaths[i].empty())
+        {
             //
-            // Download the symbols file if not available
+            // Ignore the module
             //
-            if (DownloadIfAvailable && IsFileExists(Tmp) == FALSE)
+            continue;
+        }
+
+        //
+        // Wait for the symbol to be downloaded (if needed)
+        //
+        if (DownloadJobIndex[i] != -1)
+        {
+            PSYMBOL_DOWNLOAD_JOB Job = &Queue.Jobs[DownloadJobIndex[i]];
+
+            if (!SymbolDownloadWaitForJob(Job))
             {
-                //
-                // Download the symbol
-                //
-                SymbolPdbDownload(BufferToStoreDetailsConverted[i].ModuleSymbolPath,
-                                  BufferToStoreDetailsConverted[i].ModuleSymbolGuidAndAge,
-                                  SymPath,
-                                  IsSilentLoad);
+                Result = FALSE;
+                break;
             }
 
-            //
-            // Check again to see if the symbol already download or not
-            //
-            if (IsFileExists(Tmp))
+            if (!IsSilentLoad)
             {
-                BufferToStoreDetailsConverted[i].IsSymbolPDBAvaliable = TRUE;
-
-                if (!IsSilentLoad)
-                {
-                    ShowMessages("loading symbol '%s'...", Tmp.c_str());
-                }
+                SymbolPdbDownloadShowResult(Job);
+            }
+        }
 
-                //
-                // Check if we need an alternative module name (in 32-bit modules)
-                //
-                CustomModuleName = NULL;
+        //
+        // Check again to see if the symbol already download or not
+        //
+        if (IsFileExists(PdbPaths[i]))
+        {
+            SymbolLoadModulePdb(&BufferToStoreDetailsConverted[i], PdbPaths[i].c_str(), IsSilentLoad);
+        }
+    }
 
-                // ShowMessages("name: %s , is 32-bit? %s\n", BufferToStoreDetailsConverted[i].FilePath, BufferToStoreDetailsConverted[i].Is32Bit ? "true" : "false");
+    SymbolDownloadQueueUninitialize(&Queue, Workers, NumberOfWorkers);
 
-                //
-                // Check for alternative module names
-                //
-                if (BufferToStoreDetailsConverted[i].Is32Bit &&
-                    SymCheckAndRemoveWow64Prefix(BufferToStoreDetailsConverted[i].FilePath,
-                                                 Tmp.c_str(),
-                                                 CustomModuleNameStr))
-                {
-                    //
-                    // The name of the module contains a prefix which should be removed
-                    //
-                    CustomModuleName = CustomModuleNameStr.c_str();
-                }
-                else if (!BufferToStoreDetailsConverted[i].Is32Bit &&
-                         SymCheckNtoskrnlPrefix(Tmp.c_str(), CustomModuleNameStr))
-                {
-                    //
-                    // This is an nt module
-                    //
-                    CustomModuleName = CustomModuleNameStr.c_str();
-                }
-
-                if (SymLoadFileSymbol(BufferToStoreDetailsConverted[i].BaseAddress, Tmp.c_str(), CustomModuleName) == 0)
-                {
-                    if (!IsSilentLoad)
-                    {
-                        ShowMessages("\tloaded\n");
-                    }
-                }
-                else
-                {
-                    if (!IsSilentLoad)
-                    {
-                        ShowMessages("\tnot loaded (already loaded?)\n");
-                    }
-                }
-            }
-        }
+    if (!Result)
+    {
+        g_AbortLoadingExecution = FALSE;
     }
 
-    return TRUE;
+    return Result;
 }
 
 /**
  * @brief download pdb file
  *
- * @param BufferToStoreDetails Pointer to a buffer to store the symbols details
- * this buffer will be allocated by this function and needs to be freed by caller
- * @param StoredLength The length that stored on the BufferToStoreDetails
+ * @param SymName Name of the pdb file
+ * @param GUID Guid and age of the pdb file
  * @param SymPath The path of symbols
  * @param IsSilentLoad Download without any message
  *
@@ -2075,51 +2403,60 @@ SymbolInitLoad(PVOID        BufferToStoreDetails,
 BOOLEAN
 SymbolPdbDownload(std::string SymName, const std::string & GUID, const std::string & SymPath, BOOLEAN IsSilentLoad)
 {
-    vector<string> SplitedSymPath = Split(SymPath, '*');
-    if (SplitedSymPath.size() < 2)
-        return FALSE;
-    if (SplitedSymPath[1].find(":\\") == string::npos)
-        return FALSE;
-    if (SplitedSymPath[2].find("http:") == string::npos && SplitedSymPath[2].find("https:") == string::npos)
-        return FALSE;
+    SYMBOL_DOWNLOAD_JOB Job;
 
-    string SymDir            = SplitedSymPath[1];
-    string SymDownloadServer = SplitedSymPath[2];
-    string DownloadURL       = SymDownloadServer + "/" + SymName + "/" + GUID + "/" + SymName;
-    string SymFullDir        = SymDir + "\\" + SymName + "\\" + GUID + "\\";
-    if (!CreateDirectoryRecursive(SymFullDir))
-    {
-        if (!IsSilentLoad)
-        {
-            ShowMessages("err, unable to create sympath directory '%s'\n", SymFullDir.c_str());
-        }
-        return FALSE;
-    }
+    Job.SymName       = SymName;
+    Job.Guid          = GUID;
+    Job.Status        = SYMBOL_DOWNLOAD_STATUS_NOT_STARTED;
+    Job.Result        = S_OK;
+    Job.FinishedEvent = NULL;
+
+    SymbolPdbDownloadFile(&Job, SymPath);
 
     if (!IsSilentLoad)
     {
-        ShowMessages("downloading symbol '%s'...", SymName.c_str());
+        SymbolPdbDownloadShowResult(&Job);
     }
 
-    HRESULT Result = URLDownloadToFileA(NULL, DownloadURL.c_str(), (SymFullDir + "\\" + SymName).c_str(), 0, NULL);
+    return Job.Status == SYMBOL_DOWNLOAD_STATUS_DOWNLOADED;
+}
+
+/**
+ * @brief Set the routine that downloads the pdb files and the maximum
+ * number of the download workers (it's used for testing the downloads)
+ *
+ * @param Callback SymbolPdbDownloadCallback or NULL for URLDownloadToFile
+ * @param MaximumWorkers Maximum number of the download workers (zero for
+ * the default number of workers)
+ *
+ * @return VOID
+ */
+VOID
+SymSetPdbDownloadCallback(PVOID Callback, UINT32 MaximumWorkers)
+{
+    g_SymbolPdbDownloadCallback = (SymbolPdbDownloadCallback)Callback;
 
-    if (Result == S_OK)
-    {
-        if (!IsSilentLoad)
-        {
-            ShowMessages("\tdownloaded\n");
-        }
-        return TRUE;
-    }
-    else
+    if (MaximumWorkers == 0 || MaximumWorkers > SYMBOL_DOWNLOAD_MAXIMUM_WORKERS)
     {
-        if (!IsSilentLoad)
-        {
-            ShowMessages("\tcould not be downloaded (%x) \n", Result);
-        }
+        MaximumWorkers = SYMBOL_DOWNLOAD_MAXIMUM_WORKERS;
     }
 
-    return FALSE;
+    g_SymbolDownloadMaxWorkers = MaximumWorkers;
+}
+
+/**
+ * @brief Enable or disable the cache of the type members (it's used for
+ * testing and benchmarking the cache)
+ *
+ * @param Enable
+ *
+ * @return VOID
+ */
+VOID
+SymSetTypeMembersCache(BOOLEAN Enable)
+{
+    g_IsTypeMembersCacheDisabled = !Enable;
+    g_TypeMembersCache.clear();
 }
 
 /**
@@ -0,0 +1,74 @@
+/**
+ * @file pe-image.h
+ * @author Sina Karvandi (sina@hyperdbg.org)
+ * @brief Headers of the cached PE image reader
+ * @details
+ * @version 0.11
+ * @date 2024-10-24
+ *
+ * @copyright This project is released under the GNU Public License v3.
+ *
+ */
+#pragma once
+
+//////////////////////////////////////////////////
+//					Configs                     //
+//////////////////////////////////////////////////
+
+/**
+ * @brief Maximum number of images that are kept mapped in the cache
+ * @details the least recently used image is unmapped once the cache is full
+ *
+ */
+#define PE_IMAGE_CACHE_MAXIMUM_ENTRIES 64
+
+/**
+ * @brief Signature of the CodeView (RSDS) debug information
+ *
+ */
+#define PE_IMAGE_CODEVIEW_RSDS_SIGNATURE 0x53445352
+
+//////////////////////////////////////////////////
+//					Structures                  //
+//////////////////////////////////////////////////
+
+/**
+ * @brief An entry of the sorted name index of the exports
+ *
+ */
+typedef struct _PE_IMAGE_EXPORT_NAME
+{
+    const CHAR * Name; // points to the mapped view
+    UINT32       Rva;
+
+} PE_IMAGE_EXPORT_NAME, *PPE_IMAGE_EXPORT_NAME;
+
+/**
+ * @brief A PE image which is mapped and parsed once
+ *
+ */
+typedef struct _PE_IMAGE
+{
+    std::wstring                      FilePath;
+    FILETIME                          LastWriteTime;
+    UINT64                            LastUseTick;
+    UINT32                            ReferenceCount; // the cache and the pins of SymPeGetImageDetails
+    HANDLE                            MapObjectHandle;
+    const UCHAR *                     BaseAddress;
+    PE_IMAGE_DETAILS                  Details;
+    const IMAGE_SECTION_HEADER *      Sections;
+    UINT32                            ExportOrdinalBase;
+    std::vector<UINT32>               ExportFunctions; // the ordinal table (RVAs indexed by ordinal - base)
+    std::vector<PE_IMAGE_EXPORT_NAME> ExportNames;     // sorted by name
+    GUID                              PdbGuid;
+    UINT32                            PdbAge;
+    std::string                       PdbFileName;
+
+} PE_IMAGE, *PPE_IMAGE;
+
+//////////////////////////////////////////////////
+//					Functions                   //
+//////////////////////////////////////////////////
+
+BOOLEAN
+PeImageGetCodeViewDetails(const char * FilePath, std::string & PdbFileName, GUID * PdbGuid, UINT32 * PdbAge);
@@ -17,6 +17,19 @@
 
 #define DoNotShowDetailedResult TRUE
 
+/**
+ * @brief Maximum number of threads that download symbols in parallel
+ *
+ */
+#define SYMBOL_DOWNLOAD_MAXIMUM_WORKERS 8
+
+/**
+ * @brief Interval (in milliseconds) of checking for abort while waiting
+ * for the downloads
+ *
+ */
+#define SYMBOL_DOWNLOAD_WAIT_INTERVAL 100
+
 //////////////////////////////////////////////////
 //					Structures                  //
 //////////////////////////////////////////////////
@@ -35,6 +48,74 @@ typedef struct _SYMBOL_LOADED_MODULE_DETAILS
 
 } SYMBOL_LOADED_MODULE_DETAILS, *PSYMBOL_LOADED_MODULE_DETAILS;
 
+/**
+ * @brief Details of a field of a type
+ *
+ */
+typedef struct _SYMBOL_TYPE_FIELD_DETAILS
+{
+    UINT32 Offset; // bit position for bit fields
+    UINT64 Size;
+    ULONG  TypeIndex;
+
+} SYMBOL_TYPE_FIELD_DETAILS, *PSYMBOL_TYPE_FIELD_DETAILS;
+
+/**
+ * @brief Cached details of a type, built on the first query of the type
+ *
+ */
+typedef struct _SYMBOL_TYPE_MEMBERS
+{
+    ULONG                                                       TypeIndex;
+    BOOLEAN                                                     IsTypeSizeAvailable;
+    UINT64                                                      TypeSize;
+    std::unordered_map<std::wstring, SYMBOL_TYPE_FIELD_DETAILS> Fields;
+
+} SYMBOL_TYPE_MEMBERS, *PSYMBOL_TYPE_MEMBERS;
+
+/**
+ * @brief Result of downloading a pdb file
+ *
+ */
+typedef enum _SYMBOL_DOWNLOAD_STATUS
+{
+    SYMBOL_DOWNLOAD_STATUS_NOT_STARTED = 0,
+    SYMBOL_DOWNLOAD_STATUS_INVALID_SYMBOL_PATH,
+    SYMBOL_DOWNLOAD_STATUS_UNABLE_TO_CREATE_DIRECTORY,
+    SYMBOL_DOWNLOAD_STATUS_FAILED,
+    SYMBOL_DOWNLOAD_STATUS_DOWNLOADED,
+
+} SYMBOL_DOWNLOAD_STATUS;
+
+/**
+ * @brief A pdb file that is downloaded by the download workers
+ *
+ */
+typedef struct _SYMBOL_DOWNLOAD_JOB
+{
+    std::string            SymName;
+    std::string            Guid;
+    std::string            SymFullDir;
+    SYMBOL_DOWNLOAD_STATUS Status;
+    HRESULT                Result;
+    HANDLE                 FinishedEvent;
+
+} SYMBOL_DOWNLOAD_JOB, *PSYMBOL_DOWNLOAD_JOB;
+
+/**
+ * @brief The pdb files that are downloaded in parallel while loading
+ * the symbols
+ *
+ */
+typedef struct _SYMBOL_DOWNLOAD_QUEUE
+{
+    std::vector<SYMBOL_DOWNLOAD_JOB> Jobs;
+    std::string                      SymPath;
+    volatile LONG                    NextJob;
+    volatile BOOLEAN                 IsAborted;
+
+} SYMBOL_DOWNLOAD_QUEUE, *PSYMBOL_DOWNLOAD_QUEUE;
+
 //////////////////////////////////////////////////
 //				Exports & Imports               //
 //////////////////////////////////////////////////
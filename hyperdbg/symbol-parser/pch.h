@@ -29,6 +29,7 @@ using namespace std;
 #include <sstream>
 #include <vector>
 #include <algorithm>
+#include <unordered_map>
 #include <strsafe.h>
 #define _NO_CVCONST_H // for symbol parsing
 #include <DbgHelp.h>
@@ -51,6 +52,7 @@ typedef RFLAGS * PRFLAGS;
 #include "SDK/imports/user/HyperDbgLibImports.h"
 #include "../symbol-parser/header/common-utils.h"
 #include "../symbol-parser/header/symbol-parser.h"
+#include "../symbol-parser/header/pe-image.h"
 
 //
 // Module imports/exports